@@ -10,6 +10,7 @@
 #include <linux/memory.h>
 #include <linux/stop_machine.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/kdebug.h>
 #include <asm/text-patching.h>
 #include <asm/alternative.h>
@@ -726,34 +727,59 @@ static void do_sync_core(void *info)
 	sync_core();
 }
 
-static bool bp_patching_in_progress;
-static void *bp_int3_handler, *bp_int3_addr;
+static struct text_poke_loc *bp_patching_vec;
+static unsigned int bp_patching_nr;
 
 int poke_int3_handler(struct pt_regs *regs)
 {
+	struct text_poke_loc *vec;
+	unsigned int nr;
+	int low, high;
+	void *ip;
+
 	/*
 	 * Having observed our INT3 instruction, we now must observe
-	 * bp_patching_in_progress.
+	 * bp_patching_nr.
 	 *
-	 * 	in_progress = TRUE		INT3
+	 * 	nr_entries != 0			INT3
 	 * 	WMB				RMB
-	 * 	write INT3			if (in_progress)
+	 * 	write INT3			if (nr_entries)
 	 *
-	 * Idem for bp_int3_handler.
+	 * Idem for bp_patching_vec.
 	 */
 	smp_rmb();
 
-	if (likely(!bp_patching_in_progress))
+	nr = READ_ONCE(bp_patching_nr);
+	if (likely(!nr))
 		return 0;
 
-	if (user_mode(regs) || regs->ip != (unsigned long)bp_int3_addr)
+	if (user_mode(regs))
 		return 0;
 
-	/* set up the specified breakpoint handler */
-	regs->ip = (unsigned long) bp_int3_handler;
-
-	return 1;
+	/*
+	 * The vector is sorted by address; find the entry whose INT3
+	 * we trapped on, if it is ours at all.
+	 */
+	vec = READ_ONCE(bp_patching_vec);
+	ip = (void *)regs->ip - sizeof(u8);
+	low = 0;
+	high = nr - 1;
+	while (low <= high) {
+		int mid = (low + high) / 2;
+		struct text_poke_loc *tp = &vec[mid];
+
+		if (ip < tp->addr) {
+			high = mid - 1;
+		} else if (ip > tp->addr) {
+			low = mid + 1;
+		} else {
+			/* set up the specified breakpoint handler */
+			regs->ip = (unsigned long) tp->handler;
+			return 1;
+		}
+	}
 
+	return 0;
 }
 
 /**
@@ -779,27 +805,77 @@ int poke_int3_handler(struct pt_regs *regs)
  * Note: must be called under text_mutex.
  */
 void *text_poke_bp(void *addr, const void *opcode, size_t len, void *handler)
+{
+	struct text_poke_loc tp = {
+		.addr = addr,
+		.handler = handler,
+		.len = len,
+	};
+
+	if (WARN_ON_ONCE(len > POKE_MAX_OPCODE_SIZE))
+		return NULL;
+
+	memcpy(tp.opcode, opcode, len);
+	text_poke_bp_batch(&tp, 1);
+
+	return addr;
+}
+
+static int text_poke_loc_cmp(const void *a, const void *b)
+{
+	const struct text_poke_loc *tpa = a, *tpb = b;
+
+	if (tpa->addr > tpb->addr)
+		return 1;
+	if (tpa->addr < tpb->addr)
+		return -1;
+	return 0;
+}
+
+/**
+ * text_poke_bp_batch() -- update instructions on live kernel on SMP
+ * @tp:			vector of instructions to patch
+ * @nr_entries:		number of entries in the vector
+ *
+ * Same as text_poke_bp(), but for many sites at once: all breakpoints
+ * are installed first, then all replacement instructions are written,
+ * with one machine-wide core sync per step instead of per site, so the
+ * IPI cost is constant in the number of patched sites.  The vector may
+ * be reordered (it is sorted by address for the INT3 handler's lookup).
+ *
+ * Note: must be called under text_mutex.
+ */
+void text_poke_bp_batch(struct text_poke_loc *tp, unsigned int nr_entries)
 {
 	unsigned char int3 = 0xcc;
+	unsigned int i, patched_tail = 0;
+
+	sort(tp, nr_entries, sizeof(*tp), text_poke_loc_cmp, NULL);
 
-	bp_int3_handler = handler;
-	bp_int3_addr = (u8 *)addr + sizeof(int3);
-	bp_patching_in_progress = true;
+	bp_patching_vec = tp;
+	bp_patching_nr = nr_entries;
 	/*
 	 * Corresponding read barrier in int3 notifier for making sure the
-	 * in_progress and handler are correctly ordered wrt. patching.
+	 * nr_entries and vector are correctly ordered wrt. patching.
 	 */
 	smp_wmb();
 
-	text_poke(addr, &int3, sizeof(int3));
+	for (i = 0; i < nr_entries; i++)
+		text_poke(tp[i].addr, &int3, sizeof(int3));
 
 	on_each_cpu(do_sync_core, NULL, 1);
 
-	if (len - sizeof(int3) > 0) {
-		/* patch all but the first byte */
-		text_poke((char *)addr + sizeof(int3),
-			  (const char *) opcode + sizeof(int3),
-			  len - sizeof(int3));
+	for (i = 0; i < nr_entries; i++) {
+		if (tp[i].len - sizeof(int3) > 0) {
+			/* patch all but the first byte */
+			text_poke((char *)tp[i].addr + sizeof(int3),
+				  tp[i].opcode + sizeof(int3),
+				  tp[i].len - sizeof(int3));
+			patched_tail++;
+		}
+	}
+
+	if (patched_tail) {
 		/*
 		 * According to Intel, this core syncing is very likely
 		 * not necessary and we'd be safe even without it. But
@@ -809,15 +885,23 @@ void *text_poke_bp(void *addr, const void *opcode, size_t len, void *handler)
 	}
 
 	/* patch the first byte */
-	text_poke(addr, opcode, sizeof(int3));
+	for (i = 0; i < nr_entries; i++)
+		text_poke(tp[i].addr, tp[i].opcode, sizeof(int3));
 
 	on_each_cpu(do_sync_core, NULL, 1);
 	/*
 	 * sync_core() implies an smp_mb() and orders this store against
-	 * the writing of the new instruction.
+	 * the writing of the new instructions.
 	 */
-	bp_patching_in_progress = false;
-
-	return addr;
+	WRITE_ONCE(bp_patching_nr, 0);
+	/*
+	 * An unrelated INT3 (e.g. a kprobe) may have sampled a nonzero
+	 * nr_entries and be about to search the vector.  The handler runs
+	 * with interrupts disabled, so once every CPU has taken this IPI
+	 * no handler with a stale nr_entries is in flight and any later
+	 * one bails out on nr_entries == 0 before touching the vector.
+	 */
+	on_each_cpu(do_sync_core, NULL, 1);
+	WRITE_ONCE(bp_patching_vec, NULL);
 }
 
@@ -431,7 +431,19 @@ err:
 void arch_optimize_kprobes(struct list_head *oplist)
 {
 	struct optimized_kprobe *op, *tmp;
+	struct text_poke_loc *vec;
 	u8 insn_buf[RELATIVEJUMP_SIZE];
+	unsigned int nr = 0, i = 0;
+
+	list_for_each_entry(op, oplist, list)
+		nr++;
+
+	/*
+	 * Patch all sites with a single breakpoint/sync sequence where
+	 * possible; fall back to one text_poke_bp() per probe if the
+	 * vector cannot be allocated.
+	 */
+	vec = nr > 1 ? kmalloc_array(nr, sizeof(*vec), GFP_KERNEL) : NULL;
 
 	list_for_each_entry_safe(op, tmp, oplist, list) {
 		s32 rel = (s32)((long)op->optinsn.insn -
@@ -446,11 +458,24 @@ void arch_optimize_kprobes(struct list_head *oplist)
 		insn_buf[0] = RELATIVEJUMP_OPCODE;
 		*(s32 *)(&insn_buf[1]) = rel;
 
-		text_poke_bp(op->kp.addr, insn_buf, RELATIVEJUMP_SIZE,
-			     op->optinsn.insn);
+		if (vec) {
+			vec[i].addr = op->kp.addr;
+			vec[i].handler = op->optinsn.insn;
+			vec[i].len = RELATIVEJUMP_SIZE;
+			memcpy(vec[i].opcode, insn_buf, RELATIVEJUMP_SIZE);
+			i++;
+		} else {
+			text_poke_bp(op->kp.addr, insn_buf, RELATIVEJUMP_SIZE,
+				     op->optinsn.insn);
+		}
 
 		list_del_init(&op->list);
 	}
+
+	if (vec) {
+		text_poke_bp_batch(vec, i);
+		kfree(vec);
+	}
 }
 
 /* Replace a relative jump with a breakpoint (int3).  */
@@ -55,6 +55,7 @@
 #include <linux/tboot.h>
 #include <linux/stackprotector.h>
 #include <linux/gfp.h>
+#include <linux/log2.h>
 #include <linux/cpuidle.h>
 
 #include <asm/acpi.h>
@@ -146,6 +147,19 @@ static inline void smpboot_restore_warm_reset_vector(void)
 	*((volatile u32 *)phys_to_virt(TRAMPOLINE_PHYS_LOW)) = 0;
 }
 
+/*
+ * During boot the secondary CPUs are kicked through the trampoline
+ * ahead of their native_cpu_up() calls, so that they run the per-CPU
+ * parts of their initialization concurrently instead of one after the
+ * other, and then park until the control CPU onlines them for real.
+ */
+static cpumask_var_t cpu_kicked_mask;	/* kicked ahead of native_cpu_up() */
+static cpumask_var_t cpu_parked_mask;	/* AP reached the parking point */
+static cpumask_var_t cpu_release_mask;	/* AP may continue past it */
+
+/* Parked APs build their sibling maps concurrently */
+static DEFINE_SPINLOCK(cpu_sibling_map_lock);
+
 /*
  * Report back to the Boot Processor during boot time or to the caller processor
  * during CPU online.
@@ -185,7 +199,20 @@ static void smp_callin(void)
 	 * The topology information must be up to date before
 	 * calibrate_delay() and notify_cpu_starting().
 	 */
+	spin_lock(&cpu_sibling_map_lock);
 	set_cpu_sibling_map(raw_smp_processor_id());
+	spin_unlock(&cpu_sibling_map_lock);
+
+	/*
+	 * CPUs kicked ahead of their native_cpu_up() run the per-CPU
+	 * initialization above concurrently and park here.  Everything
+	 * from calibrate_delay() on - the starting notifiers, the TSC
+	 * sync and going online - must stay serialized against the
+	 * control CPU, which releases us from native_cpu_up().
+	 */
+	cpumask_set_cpu(cpuid, cpu_parked_mask);
+	while (!cpumask_test_cpu(cpuid, cpu_release_mask))
+		cpu_relax();
 
 	/*
 	 * Get our bogomips.
@@ -987,21 +1014,6 @@ static int do_boot_cpu(int apicid, int cpu, struct task_struct *idle,
 		}
 	}
 
-	if (!boot_error) {
-		/*
-		 * Wait till AP completes initial initialization
-		 */
-		while (!cpumask_test_cpu(cpu, cpu_callin_mask)) {
-			/*
-			 * Allow other tasks to run while we wait for the
-			 * AP to come online. This also gives a chance
-			 * for the MTRR work(triggered by the AP coming online)
-			 * to be completed in the stop machine context.
-			 */
-			schedule();
-		}
-	}
-
 	/* mark "stuck" area as not stuck */
 	*trampoline_status = 0;
 
@@ -1015,6 +1027,99 @@ static int do_boot_cpu(int apicid, int cpu, struct task_struct *idle,
 	return boot_error;
 }
 
+static void do_wait_cpu_callin(unsigned int cpu)
+{
+	/*
+	 * Wait till AP completes initial initialization
+	 */
+	while (!cpumask_test_cpu(cpu, cpu_callin_mask)) {
+		/*
+		 * Allow other tasks to run while we wait for the
+		 * AP to come online. This also gives a chance
+		 * for the MTRR work(triggered by the AP coming online)
+		 * to be completed in the stop machine context.
+		 */
+		schedule();
+	}
+}
+
+static bool smp_boot_kick_done;
+
+/*
+ * Kick every present CPU through INIT/SIPI and the trampoline ahead of
+ * the serialized native_cpu_up() calls, so the expensive per-CPU parts
+ * of secondary initialization (cpu_init(), microcode load, CPU
+ * identification) run on all APs concurrently, parking in smp_callin().
+ *
+ * The kicks are issued in passes by SMT sibling index, waiting for each
+ * pass to park before starting the next, so that the microcode load in
+ * cpu_init() never runs on two threads of one core at the same time -
+ * the same constraint the late loader enforces.  Within one kick the
+ * trampoline state (initial_stack, initial_gs) is exclusive until the
+ * AP checks in via cpu_initialized_mask.
+ */
+static void smp_boot_kick_aps(void)
+{
+	unsigned int smt_mask = roundup_pow_of_two(smp_num_siblings) - 1;
+	unsigned int nr_kicked = num_online_cpus();
+	unsigned int thread, cpu;
+	unsigned long timeout;
+	int apicid;
+
+	smp_boot_kick_done = true;
+
+	mtrr_save_state();
+
+	for (thread = 0; thread <= smt_mask; thread++) {
+		bool kicked = false;
+
+		for_each_present_cpu(cpu) {
+			struct task_struct *idle = idle_task(cpu);
+			int cpu0_nmi_registered = 0;
+
+			if (cpu_online(cpu) || nr_kicked >= setup_max_cpus)
+				continue;
+
+			apicid = apic->cpu_present_to_apicid(cpu);
+			if (apicid == BAD_APICID ||
+			    ((unsigned int)apicid & smt_mask) != thread ||
+			    !physid_isset(apicid, phys_cpu_present_map) ||
+			    !apic->apic_id_valid(apicid) || !idle)
+				continue;
+
+			/* the FPU context is blank, nobody can own it */
+			per_cpu(fpu_fpregs_owner_ctx, cpu) = NULL;
+
+			common_cpu_up(cpu, idle);
+
+			if (do_boot_cpu(apicid, cpu, idle,
+					&cpu0_nmi_registered))
+				continue;
+
+			cpumask_set_cpu(cpu, cpu_kicked_mask);
+			kicked = true;
+			nr_kicked++;
+		}
+
+		if (!kicked)
+			continue;
+
+		/*
+		 * Wait for this pass to reach the parking point before
+		 * kicking the siblings.  A CPU that does not make it is
+		 * retried through the normal serialized path later.
+		 */
+		timeout = jiffies + 10*HZ;
+		for_each_cpu(cpu, cpu_kicked_mask) {
+			while (!cpumask_test_cpu(cpu, cpu_parked_mask) &&
+			       time_before(jiffies, timeout))
+				schedule();
+			if (!cpumask_test_cpu(cpu, cpu_parked_mask))
+				cpumask_clear_cpu(cpu, cpu_kicked_mask);
+		}
+	}
+}
+
 int native_cpu_up(unsigned int cpu, struct task_struct *tidle)
 {
 	int apicid = apic->cpu_present_to_apicid(cpu);
@@ -1041,6 +1146,14 @@ int native_cpu_up(unsigned int cpu, struct task_struct *tidle)
 		return -ENOSYS;
 	}
 
+	/*
+	 * First secondary online during boot: kick all the others
+	 * through the trampoline now so they initialize in parallel
+	 * while this loop onlines them one by one.
+	 */
+	if (!smp_boot_kick_done && system_state == SYSTEM_SCHEDULING)
+		smp_boot_kick_aps();
+
 	/*
 	 * Save current MTRR state in case it was changed since early boot
 	 * (e.g. by the ACPI SMI) to initialize new CPUs with MTRRs in sync:
@@ -1052,18 +1165,31 @@ int native_cpu_up(unsigned int cpu, struct task_struct *tidle)
 	if (err && err != -EBUSY)
 		return err;
 
-	/* the FPU context is blank, nobody can own it */
-	per_cpu(fpu_fpregs_owner_ctx, cpu) = NULL;
+	if (cpumask_test_and_clear_cpu(cpu, cpu_kicked_mask)) {
+		/* The parked AP is already running on its idle stack */
+		WARN_ON_ONCE(tidle != idle_task(cpu));
+	} else {
+		/* the FPU context is blank, nobody can own it */
+		per_cpu(fpu_fpregs_owner_ctx, cpu) = NULL;
 
-	common_cpu_up(cpu, tidle);
+		common_cpu_up(cpu, tidle);
 
-	err = do_boot_cpu(apicid, cpu, tidle, &cpu0_nmi_registered);
-	if (err) {
-		pr_err("do_boot_cpu failed(%d) to wakeup CPU#%u\n", err, cpu);
-		ret = -EIO;
-		goto unreg_nmi;
+		err = do_boot_cpu(apicid, cpu, tidle, &cpu0_nmi_registered);
+		if (err) {
+			pr_err("do_boot_cpu failed(%d) to wakeup CPU#%u\n",
+			       err, cpu);
+			ret = -EIO;
+			goto unreg_nmi;
+		}
 	}
 
+	/*
+	 * Let the AP continue past the parking point and finish its
+	 * bringup.
+	 */
+	cpumask_set_cpu(cpu, cpu_release_mask);
+	do_wait_cpu_callin(cpu);
+
 	/*
 	 * Check TSC synchronization with the AP (keep irqs disabled
 	 * while doing so):
@@ -1214,6 +1340,10 @@ void __init native_smp_prepare_cpus(unsigned int max_cpus)
 		zalloc_cpumask_var(&per_cpu(cpu_llc_shared_map, i), GFP_KERNEL);
 	}
 
+	zalloc_cpumask_var(&cpu_kicked_mask, GFP_KERNEL);
+	zalloc_cpumask_var(&cpu_parked_mask, GFP_KERNEL);
+	zalloc_cpumask_var(&cpu_release_mask, GFP_KERNEL);
+
 	/*
 	 * Set 'default' x86 topology, this matches default_topology() in that
 	 * it has NUMA nodes as a topology level. See also
@@ -1449,6 +1579,9 @@ static void remove_cpu_from_maps(int cpu)
 	cpumask_clear_cpu(cpu, cpu_callin_mask);
 	/* was set by cpu_init() */
 	cpumask_clear_cpu(cpu, cpu_initialized_mask);
+	/* was set around the parking point in smp_callin() */
+	cpumask_clear_cpu(cpu, cpu_parked_mask);
+	cpumask_clear_cpu(cpu, cpu_release_mask);
 	numa_remove_cpu(cpu);
 }
 
@@ -694,10 +694,22 @@ static bool bfq_symmetric_scenario(struct bfq_data *bfqd)
  * In most scenarios, the rate at which nodes are created/destroyed
  * should be low too.
  */
+static struct bfq_weight_counter **
+bfq_weights_cache_slot(struct bfq_data *bfqd, struct rb_root *root,
+		       unsigned int weight)
+{
+	struct bfq_weight_counter **cache;
+
+	cache = root == &bfqd->queue_weights_tree ?
+		bfqd->queue_weights_cache : bfqd->group_weights_cache;
+	return &cache[weight & (BFQ_WEIGHTS_CACHE_SIZE - 1)];
+}
+
 void bfq_weights_tree_add(struct bfq_data *bfqd, struct bfq_entity *entity,
 			  struct rb_root *root)
 {
 	struct rb_node **new = &(root->rb_node), *parent = NULL;
+	struct bfq_weight_counter **slot;
 
 	/*
 	 * Do not insert if the entity is already associated with a
@@ -715,6 +727,12 @@ void bfq_weights_tree_add(struct bfq_data *bfqd, struct bfq_entity *entity,
 	if (entity->weight_counter)
 		return;
 
+	slot = bfq_weights_cache_slot(bfqd, root, entity->weight);
+	if (*slot && (*slot)->weight == entity->weight) {
+		entity->weight_counter = *slot;
+		goto inc_counter;
+	}
+
 	while (*new) {
 		struct bfq_weight_counter *__counter = container_of(*new,
 						struct bfq_weight_counter,
@@ -723,6 +741,7 @@ void bfq_weights_tree_add(struct bfq_data *bfqd, struct bfq_entity *entity,
 
 		if (entity->weight == __counter->weight) {
 			entity->weight_counter = __counter;
+			*slot = __counter;
 			goto inc_counter;
 		}
 		if (entity->weight < __counter->weight)
@@ -752,6 +771,7 @@ void bfq_weights_tree_add(struct bfq_data *bfqd, struct bfq_entity *entity,
 	entity->weight_counter->weight = entity->weight;
 	rb_link_node(&entity->weight_counter->weights_node, parent, new);
 	rb_insert_color(&entity->weight_counter->weights_node, root);
+	*slot = entity->weight_counter;
 
 inc_counter:
 	entity->weight_counter->num_active++;
@@ -766,6 +786,8 @@ inc_counter:
 void bfq_weights_tree_remove(struct bfq_data *bfqd, struct bfq_entity *entity,
 			     struct rb_root *root)
 {
+	struct bfq_weight_counter **slot;
+
 	if (!entity->weight_counter)
 		return;
 
@@ -773,6 +795,11 @@ void bfq_weights_tree_remove(struct bfq_data *bfqd, struct bfq_entity *entity,
 	if (entity->weight_counter->num_active > 0)
 		goto reset_entity_pointer;
 
+	slot = bfq_weights_cache_slot(bfqd, root,
+				      entity->weight_counter->weight);
+	if (*slot == entity->weight_counter)
+		*slot = NULL;
+
 	rb_erase(&entity->weight_counter->weights_node, root);
 	kfree(entity->weight_counter);
 
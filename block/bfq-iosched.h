@@ -404,6 +404,9 @@ enum bfq_device_speed {
 	BFQ_BFQD_SLOW,
 };
 
+/* Slots in the per-device weight-counter caches, must be a power-of-2. */
+#define BFQ_WEIGHTS_CACHE_SIZE	64
+
 /**
  * struct bfq_data - per-device data structure.
  *
@@ -437,6 +440,15 @@ struct bfq_data {
 	 */
 	struct rb_root group_weights_tree;
 
+	/*
+	 * Direct-mapped caches over the two weights trees above. In
+	 * practice weights take only a handful of discrete values, so
+	 * nearly every activation hits the cache and skips the rb-tree
+	 * walk; collisions and oddball weights fall back to the tree.
+	 */
+	struct bfq_weight_counter *queue_weights_cache[BFQ_WEIGHTS_CACHE_SIZE];
+	struct bfq_weight_counter *group_weights_cache[BFQ_WEIGHTS_CACHE_SIZE];
+
 	/*
 	 * Number of bfq_queues containing requests (including the
 	 * queue in service, even if it is idling).
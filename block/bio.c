@@ -246,6 +246,73 @@ void bio_uninit(struct bio *bio)
 }
 EXPORT_SYMBOL(bio_uninit);
 
+/*
+ * Try to grab a bio allocation that was freed on the local node. The
+ * pools are keyed by the node backing the allocation, so a hit means
+ * every field touch in the submission and completion path stays local.
+ */
+static void *bio_node_pool_get(struct bio_set *bs)
+{
+	struct bio_node_pool *pool;
+	unsigned long flags;
+	void *p = NULL;
+
+	if (!bs->node_pools)
+		return NULL;
+
+	pool = &bs->node_pools[numa_node_id()];
+	spin_lock_irqsave(&pool->lock, flags);
+	if (pool->nr)
+		p = pool->elems[--pool->nr];
+	spin_unlock_irqrestore(&pool->lock, flags);
+	return p;
+}
+
+static bool bio_node_pool_put(struct bio_set *bs, void *p)
+{
+	struct bio_node_pool *pool;
+	unsigned long flags;
+	bool cached = false;
+
+	if (!bs->node_pools)
+		return false;
+
+	/*
+	 * Tasks sleeping in mempool_alloc() rely on frees replenishing
+	 * the reserve, so only divert a free into the cache while the
+	 * mempool is full; waiters can only exist once it has been dipped
+	 * into, and then every free goes back to it until it refills.
+	 */
+	if (READ_ONCE(bs->bio_pool->curr_nr) < bs->bio_pool->min_nr)
+		return false;
+
+	pool = &bs->node_pools[page_to_nid(virt_to_page(p))];
+	spin_lock_irqsave(&pool->lock, flags);
+	if (pool->nr < BIO_NODE_POOL_SIZE) {
+		pool->elems[pool->nr++] = p;
+		cached = true;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+	return cached;
+}
+
+static void bio_node_pools_free(struct bio_set *bs)
+{
+	int node;
+
+	if (!bs->node_pools)
+		return;
+
+	for_each_node(node) {
+		struct bio_node_pool *pool = &bs->node_pools[node];
+
+		while (pool->nr)
+			mempool_free(pool->elems[--pool->nr], bs->bio_pool);
+	}
+	kfree(bs->node_pools);
+	bs->node_pools = NULL;
+}
+
 static void bio_free(struct bio *bio)
 {
 	struct bio_set *bs = bio->bi_pool;
@@ -262,7 +329,8 @@ static void bio_free(struct bio *bio)
 		p = bio;
 		p -= bs->front_pad;
 
-		mempool_free(p, bs->bio_pool);
+		if (!bio_node_pool_put(bs, p))
+			mempool_free(p, bs->bio_pool);
 	} else {
 		/* Bio was allocated by bio_kmalloc() */
 		kfree(bio);
@@ -483,7 +551,9 @@ struct bio *bio_alloc_bioset(gfp_t gfp_mask, unsigned int nr_iovecs,
 		    bs->rescue_workqueue)
 			gfp_mask &= ~__GFP_DIRECT_RECLAIM;
 
-		p = mempool_alloc(bs->bio_pool, gfp_mask);
+		p = bio_node_pool_get(bs);
+		if (!p)
+			p = mempool_alloc(bs->bio_pool, gfp_mask);
 		if (!p && gfp_mask != saved_gfp) {
 			punt_bios_to_rescuer(bs);
 			gfp_mask = saved_gfp;
@@ -1860,6 +1930,7 @@ void bioset_free(struct bio_set *bs)
 	if (bs->rescue_workqueue)
 		destroy_workqueue(bs->rescue_workqueue);
 
+	bio_node_pools_free(bs);
 	mempool_destroy(bs->bio_pool);
 	mempool_destroy(bs->bvec_pool);
 
@@ -1923,6 +1994,17 @@ struct bio_set *bioset_create(unsigned int pool_size,
 			goto bad;
 	}
 
+	if (flags & BIOSET_NODE_POOLS) {
+		int node;
+
+		bs->node_pools = kcalloc(nr_node_ids,
+					 sizeof(*bs->node_pools), GFP_KERNEL);
+		if (!bs->node_pools)
+			goto bad;
+		for_each_node(node)
+			spin_lock_init(&bs->node_pools[node].lock);
+	}
+
 	if (!(flags & BIOSET_NEED_RESCUER))
 		return bs;
 
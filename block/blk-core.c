@@ -901,7 +901,8 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	if (q->id < 0)
 		goto fail_q;
 
-	q->bio_split = bioset_create(BIO_POOL_SIZE, 0, BIOSET_NEED_BVECS);
+	q->bio_split = bioset_create(BIO_POOL_SIZE, 0, BIOSET_NEED_BVECS |
+				     (nr_node_ids > 1 ? BIOSET_NODE_POOLS : 0));
 	if (!q->bio_split)
 		goto fail_id;
 
@@ -938,6 +939,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 #endif
 	mutex_init(&q->sysfs_lock);
 	spin_lock_init(&q->__queue_lock);
+	spin_lock_init(&q->zone_cache_lock);
 
 	/*
 	 * By default initialize queue_lock to internal lock and driver can
@@ -1814,6 +1816,21 @@ bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
 	else
 		plug_list = &plug->list;
 
+	/*
+	 * Try the indexed back-merge candidate first; a hit saves the
+	 * full plug scan. The entry is only a hint, so recheck that it
+	 * really ends where @bio starts before merging.
+	 */
+	rq = *blk_plug_merge_slot(plug, bio->bi_iter.bi_sector);
+	if (rq && rq->q == q &&
+	    blk_rq_pos(rq) + blk_rq_sectors(rq) == bio->bi_iter.bi_sector &&
+	    blk_rq_merge_ok(rq, bio) &&
+	    blk_try_merge(rq, bio) == ELEVATOR_BACK_MERGE &&
+	    bio_attempt_back_merge(q, rq, bio)) {
+		blk_plug_merge_add(plug, rq);
+		return true;
+	}
+
 	list_for_each_entry_reverse(rq, plug_list, queuelist) {
 		bool merged = false;
 
@@ -1845,8 +1862,10 @@ bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
 			break;
 		}
 
-		if (merged)
+		if (merged) {
+			blk_plug_merge_add(plug, rq);
 			return true;
+		}
 	}
 
 	return false;
@@ -2011,6 +2030,7 @@ get_rq:
 			}
 		}
 		list_add_tail(&req->queuelist, &plug->list);
+		blk_plug_merge_add(plug, req);
 		blk_account_io_start(req, true);
 	} else {
 		spin_lock_irq(q->queue_lock);
@@ -3485,6 +3505,7 @@ void blk_start_plug(struct blk_plug *plug)
 	INIT_LIST_HEAD(&plug->list);
 	INIT_LIST_HEAD(&plug->mq_list);
 	INIT_LIST_HEAD(&plug->cb_list);
+	memset(plug->merge_hash, 0, sizeof(plug->merge_hash));
 	/*
 	 * Store ordering should not be needed here, since a potential
 	 * preempt will imply a full memory barrier
@@ -3573,6 +3594,8 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	LIST_HEAD(list);
 	unsigned int depth;
 
+	memset(plug->merge_hash, 0, sizeof(plug->merge_hash));
+
 	flush_plug_callbacks(plug, from_schedule);
 
 	if (!list_empty(&plug->mq_list))
@@ -135,6 +135,48 @@ int blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 }
 EXPORT_SYMBOL(blkdev_issue_discard);
 
+/**
+ * blkdev_issue_discard_ranges - queue discards for a vector of ranges
+ * @bdev:	blockdev to issue discards for
+ * @ranges:	array of @nr sector ranges to discard
+ * @nr:		number of entries in @ranges
+ * @gfp_mask:	memory allocation flags (for bio_alloc)
+ * @flags:	BLKDEV_DISCARD_* flags to control behaviour
+ *
+ * Description:
+ *    Build the bio chain for all ranges up front and submit it under a
+ *    single plug, waiting on one chained completion rather than paying
+ *    per-bio completion scheduling. Meant for callers that trim large
+ *    numbers of extents in one go.
+ */
+int blkdev_issue_discard_ranges(struct block_device *bdev,
+				const struct blkdev_discard_range *ranges,
+				unsigned int nr, gfp_t gfp_mask,
+				unsigned long flags)
+{
+	struct bio *bio = NULL;
+	struct blk_plug plug;
+	unsigned int i;
+	int ret = 0;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr && !ret; i++)
+		ret = __blkdev_issue_discard(bdev, ranges[i].sector,
+					     ranges[i].nr_sects, gfp_mask,
+					     flags, &bio);
+	if (bio) {
+		int err = submit_bio_wait(bio);
+
+		if (!ret && err && err != -EOPNOTSUPP)
+			ret = err;
+		bio_put(bio);
+	}
+	blk_finish_plug(&plug);
+
+	return ret;
+}
+EXPORT_SYMBOL(blkdev_issue_discard_ranges);
+
 /**
  * __blkdev_issue_write_same - generate number of bios with same page
  * @bdev:	target blockdev
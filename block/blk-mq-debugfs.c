@@ -531,6 +531,35 @@ static ssize_t hctx_io_poll_write(void *data, const char __user *buf,
 	return count;
 }
 
+/*
+ * Issue-to-complete latency histogram. Reading resets the counters so
+ * two reads bracket exactly the I/O issued in between.
+ */
+static int hctx_lat_hist_show(void *data, struct seq_file *m)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	int bucket, cpu;
+
+	if (!hctx->lat_hist)
+		return 0;
+
+	for (bucket = 0; bucket < BLK_MQ_LAT_HIST_BKTS; bucket++) {
+		u64 nr = 0;
+
+		for_each_possible_cpu(cpu) {
+			u64 *bkt = &per_cpu_ptr(hctx->lat_hist, cpu)[bucket];
+
+			nr += *bkt;
+			*bkt = 0;
+		}
+		if (nr)
+			seq_printf(m, "%llu-%llu: %llu\n",
+				   bucket ? 1ULL << bucket : 0,
+				   (2ULL << bucket) - 1, nr);
+	}
+	return 0;
+}
+
 static int hctx_dispatched_show(void *data, struct seq_file *m)
 {
 	struct blk_mq_hw_ctx *hctx = data;
@@ -766,6 +795,7 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_hctx_attrs[] = {
 	{"sched_tags", 0400, hctx_sched_tags_show},
 	{"sched_tags_bitmap", 0400, hctx_sched_tags_bitmap_show},
 	{"io_poll", 0600, hctx_io_poll_show, hctx_io_poll_write},
+	{"lat_hist", 0400, hctx_lat_hist_show},
 	{"dispatched", 0600, hctx_dispatched_show, hctx_dispatched_write},
 	{"queued", 0600, hctx_queued_show, hctx_queued_write},
 	{"run", 0600, hctx_run_show, hctx_run_write},
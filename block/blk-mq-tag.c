@@ -196,6 +196,29 @@ void blk_mq_put_tag(struct blk_mq_hw_ctx *hctx, struct blk_mq_tags *tags,
 	}
 }
 
+/*
+ * Override the wakeup batch of the tag maps waiters actually sleep on.
+ * Batches are clamped so every wait queue can still be satisfied from
+ * the map, which keeps the no-lost-wakeup property of the default
+ * sizing.
+ */
+void blk_mq_tag_update_wake_batch(struct blk_mq_tags *tags,
+				  unsigned int batch)
+{
+	struct sbitmap_queue *bt = &tags->bitmap_tags;
+	unsigned int i;
+
+	batch = clamp_t(unsigned int, batch, 1,
+			max_t(unsigned int, 1,
+			      bt->sb.depth / SBQ_WAIT_QUEUES));
+	if (batch == bt->wake_batch)
+		return;
+
+	WRITE_ONCE(bt->wake_batch, batch);
+	for (i = 0; i < SBQ_WAIT_QUEUES; i++)
+		atomic_set(&bt->ws[i].wait_cnt, batch);
+}
+
 struct bt_iter_data {
 	struct blk_mq_hw_ctx *hctx;
 	busy_iter_fn *fn;
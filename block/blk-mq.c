@@ -20,11 +20,13 @@
 #include <linux/cpu.h>
 #include <linux/cache.h>
 #include <linux/sched/sysctl.h>
+#include <linux/sched/clock.h>
 #include <linux/sched/topology.h>
 #include <linux/sched/signal.h>
 #include <linux/delay.h>
 #include <linux/crash_dump.h>
 #include <linux/prefetch.h>
+#include <linux/interrupt.h>
 
 #include <trace/events/block.h>
 
@@ -40,6 +42,9 @@
 static bool blk_mq_poll(struct request_queue *q, blk_qc_t cookie);
 static void blk_mq_poll_stats_start(struct request_queue *q);
 static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb);
+static void blk_mq_wake_batch_stats_start(struct request_queue *q);
+static void blk_mq_wake_batch_stats_fn(struct blk_stat_callback *cb);
+static int blk_mq_wake_batch_stats_bkt(const struct request *rq);
 
 static int blk_mq_poll_stats_bkt(const struct request *rq)
 {
@@ -525,6 +530,32 @@ static void __blk_mq_complete_request_remote(void *data)
 	rq->q->softirq_done_fn(rq);
 }
 
+/*
+ * Account the issue-to-complete time of @rq in the hardware context's
+ * histogram. Always on: one ktime read and a per-cpu increment.
+ */
+static void blk_mq_lat_hist_add(struct request *rq)
+{
+	struct blk_mq_hw_ctx *hctx;
+	u64 issue, delta;
+	int bucket;
+
+	issue = blk_stat_time(&rq->issue_stat);
+	if (!issue)
+		return;
+
+	delta = __blk_stat_time(ktime_to_ns(ktime_get())) - issue;
+	if ((s64)delta <= 0)
+		return;
+
+	hctx = blk_mq_map_queue(rq->q, rq->mq_ctx->cpu);
+	if (!hctx->lat_hist)
+		return;
+
+	bucket = min(ilog2(delta), BLK_MQ_LAT_HIST_BKTS - 1);
+	this_cpu_inc(hctx->lat_hist[bucket]);
+}
+
 static void __blk_mq_complete_request(struct request *rq)
 {
 	struct blk_mq_ctx *ctx = rq->mq_ctx;
@@ -538,8 +569,10 @@ static void __blk_mq_complete_request(struct request *rq)
 		blk_mq_sched_completed_request(rq);
 	if (rq->rq_flags & RQF_STATS) {
 		blk_mq_poll_stats_start(rq->q);
+		blk_mq_wake_batch_stats_start(rq->q);
 		blk_stat_add(rq);
 	}
+	blk_mq_lat_hist_add(rq);
 
 	if (!test_bit(QUEUE_FLAG_SAME_COMP, &rq->q->queue_flags)) {
 		rq->q->softirq_done_fn(rq);
@@ -660,8 +693,9 @@ void blk_mq_start_request(struct request *rq)
 
 	trace_block_rq_issue(q, rq);
 
+	/* always stamp the issue time, the latency histogram needs it */
+	blk_stat_set_issue(&rq->issue_stat, blk_rq_sectors(rq));
 	if (test_bit(QUEUE_FLAG_STATS, &q->queue_flags)) {
-		blk_stat_set_issue(&rq->issue_stat, blk_rq_sectors(rq));
 		rq->rq_flags |= RQF_STATS;
 		wbt_issue(q->rq_wb, &rq->issue_stat);
 	}
@@ -975,6 +1009,63 @@ static void blk_mq_timeout_work(struct work_struct *work)
 	blk_queue_exit(q);
 }
 
+/*
+ * Push a request onto the software queue dispatch ring. May only be
+ * called by the CPU owning @ctx; fails if the ring is full or the tag
+ * set is shared, in which case the caller must use the locked rq_list.
+ */
+static bool blk_mq_ctx_ring_insert(struct blk_mq_hw_ctx *hctx,
+				   struct blk_mq_ctx *ctx, struct request *rq)
+{
+	unsigned int head, tail;
+
+	if (hctx->flags & BLK_MQ_F_TAG_SHARED)
+		return false;
+
+	tail = ctx->ring_tail;
+	head = READ_ONCE(ctx->ring_head);
+	if (tail - head >= BLK_MQ_CTX_RING_SIZE)
+		return false;
+
+	trace_block_rq_insert(hctx->queue, rq);
+
+	ctx->ring[tail & BLK_MQ_CTX_RING_MASK] = rq;
+	/* pairs with the acquire in blk_mq_ctx_ring_pop() */
+	smp_store_release(&ctx->ring_tail, tail + 1);
+	return true;
+}
+
+/*
+ * Pop one request off the dispatch ring. Unlike the producer side this
+ * can race with other CPUs running the hardware context, so consumers
+ * claim entries with a cmpxchg on the head index.
+ */
+static struct request *blk_mq_ctx_ring_pop(struct blk_mq_ctx *ctx)
+{
+	unsigned int head, tail;
+	struct request *rq;
+
+	do {
+		head = READ_ONCE(ctx->ring_head);
+		/* pairs with the release in blk_mq_ctx_ring_insert() */
+		tail = smp_load_acquire(&ctx->ring_tail);
+		if (head == tail)
+			return NULL;
+		rq = ctx->ring[head & BLK_MQ_CTX_RING_MASK];
+	} while (cmpxchg(&ctx->ring_head, head, head + 1) != head);
+
+	return rq;
+}
+
+static void blk_mq_ctx_ring_drain(struct blk_mq_ctx *ctx,
+				  struct list_head *list)
+{
+	struct request *rq;
+
+	while ((rq = blk_mq_ctx_ring_pop(ctx)) != NULL)
+		list_add_tail(&rq->queuelist, list);
+}
+
 struct flush_busy_ctx_data {
 	struct blk_mq_hw_ctx *hctx;
 	struct list_head *list;
@@ -987,6 +1078,7 @@ static bool flush_busy_ctx(struct sbitmap *sb, unsigned int bitnr, void *data)
 	struct blk_mq_ctx *ctx = hctx->ctxs[bitnr];
 
 	sbitmap_clear_bit(sb, bitnr);
+	blk_mq_ctx_ring_drain(ctx, flush_data->list);
 	spin_lock(&ctx->lock);
 	list_splice_tail_init(&ctx->rq_list, flush_data->list);
 	spin_unlock(&ctx->lock);
@@ -1020,12 +1112,26 @@ static bool dispatch_rq_from_ctx(struct sbitmap *sb, unsigned int bitnr,
 	struct blk_mq_hw_ctx *hctx = dispatch_data->hctx;
 	struct blk_mq_ctx *ctx = hctx->ctxs[bitnr];
 
+	dispatch_data->rq = blk_mq_ctx_ring_pop(ctx);
+	if (dispatch_data->rq)
+		return false;
+
 	spin_lock(&ctx->lock);
 	if (unlikely(!list_empty(&ctx->rq_list))) {
 		dispatch_data->rq = list_entry_rq(ctx->rq_list.next);
 		list_del_init(&dispatch_data->rq->queuelist);
-		if (list_empty(&ctx->rq_list))
+		if (list_empty(&ctx->rq_list)) {
 			sbitmap_clear_bit(sb, bitnr);
+			/*
+			 * Order the clear against re-reading the ring
+			 * tail, so a request pushed onto the ring while
+			 * we held the lock can't be hidden by the clear.
+			 * Pairs with the barrier in the insert path.
+			 */
+			smp_mb__after_atomic();
+			if (ctx->ring_head != READ_ONCE(ctx->ring_tail))
+				sbitmap_set_bit(sb, bitnr);
+		}
 	}
 	spin_unlock(&ctx->lock);
 
@@ -1650,10 +1756,41 @@ void blk_mq_insert_requests(struct blk_mq_hw_ctx *hctx, struct blk_mq_ctx *ctx,
 			    struct list_head *list)
 
 {
+	bool rung = false;
+
 	/*
-	 * preemption doesn't flush plug list, so it's possible ctx->cpu is
-	 * offline now
+	 * The dispatch ring is single-producer: only the CPU owning the
+	 * software queue may feed it. preemption doesn't flush plug list,
+	 * so it's possible we were migrated or ctx->cpu is offline now;
+	 * fall back to the locked list for whatever the ring won't take.
 	 */
+	if (ctx->cpu == get_cpu()) {
+		while (!list_empty(list)) {
+			struct request *rq;
+
+			rq = list_first_entry(list, struct request,
+					      queuelist);
+			BUG_ON(rq->mq_ctx != ctx);
+			if (!blk_mq_ctx_ring_insert(hctx, ctx, rq))
+				break;
+			list_del_init(&rq->queuelist);
+			rung = true;
+		}
+	}
+	put_cpu();
+
+	if (rung) {
+		/*
+		 * Order the ring tail update against setting the pending
+		 * bit. Pairs with the barrier in dispatch_rq_from_ctx().
+		 */
+		smp_mb__before_atomic();
+		blk_mq_hctx_mark_pending(hctx, ctx);
+	}
+
+	if (list_empty(list))
+		return;
+
 	spin_lock(&ctx->lock);
 	while (!list_empty(list)) {
 		struct request *rq;
@@ -1940,6 +2077,7 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 		}
 
 		list_add_tail(&rq->queuelist, &plug->mq_list);
+		blk_plug_merge_add(plug, rq);
 	} else if (plug && !blk_queue_nomerges(q)) {
 		blk_mq_bio_to_request(rq, bio);
 
@@ -1952,9 +2090,12 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 		 */
 		if (list_empty(&plug->mq_list))
 			same_queue_rq = NULL;
-		if (same_queue_rq)
+		if (same_queue_rq) {
 			list_del_init(&same_queue_rq->queuelist);
+			blk_plug_merge_del(plug, same_queue_rq);
+		}
 		list_add_tail(&rq->queuelist, &plug->mq_list);
+		blk_plug_merge_add(plug, rq);
 
 		blk_mq_put_ctx(data.ctx);
 
@@ -1968,6 +2109,17 @@ static blk_qc_t blk_mq_make_request(struct request_queue *q, struct bio *bio)
 		blk_mq_put_ctx(data.ctx);
 		blk_mq_bio_to_request(rq, bio);
 		blk_mq_try_issue_directly(data.hctx, rq, &cookie);
+	} else if (q->nr_hw_queues == 1 && !q->elevator) {
+		/*
+		 * Single hardware queue and no scheduler (the common
+		 * virtio-blk guest setup): nothing is gained by taking
+		 * the detour through the software queue, so hand the
+		 * request straight to ->queue_rq(). If the driver is
+		 * busy this falls back to a regular insert internally.
+		 */
+		blk_mq_put_ctx(data.ctx);
+		blk_mq_bio_to_request(rq, bio);
+		blk_mq_try_issue_directly(data.hctx, rq, &cookie);
 	} else if (q->elevator) {
 		blk_mq_put_ctx(data.ctx);
 		blk_mq_bio_to_request(rq, bio);
@@ -2171,6 +2323,7 @@ static int blk_mq_hctx_notify_dead(unsigned int cpu, struct hlist_node *node)
 	hctx = hlist_entry_safe(node, struct blk_mq_hw_ctx, cpuhp_dead);
 	ctx = __blk_mq_get_ctx(hctx->queue, cpu);
 
+	blk_mq_ctx_ring_drain(ctx, &tmp);
 	spin_lock(&ctx->lock);
 	if (!list_empty(&ctx->rq_list)) {
 		list_splice_init(&ctx->rq_list, &tmp);
@@ -2219,6 +2372,8 @@ static void blk_mq_exit_hctx(struct request_queue *q,
 	blk_mq_remove_cpuhp(hctx);
 	blk_free_flush_queue(hctx->fq);
 	sbitmap_free(&hctx->ctx_map);
+	free_percpu(hctx->lat_hist);
+	hctx->lat_hist = NULL;
 }
 
 static void blk_mq_exit_hw_queues(struct request_queue *q,
@@ -2249,6 +2404,7 @@ static int blk_mq_init_hctx(struct request_queue *q,
 	INIT_LIST_HEAD(&hctx->dispatch);
 	hctx->queue = q;
 	hctx->flags = set->flags & ~BLK_MQ_F_TAG_SHARED;
+	hctx->poll_irq = -1;
 
 	cpuhp_state_add_instance_nocalls(CPUHP_BLK_MQ_DEAD, &hctx->cpuhp_dead);
 
@@ -2258,10 +2414,15 @@ static int blk_mq_init_hctx(struct request_queue *q,
 	 * Allocate space for all possible cpus to avoid allocation at
 	 * runtime
 	 */
+	hctx->lat_hist = __alloc_percpu(BLK_MQ_LAT_HIST_BKTS * sizeof(u64),
+					__alignof__(u64));
+	if (!hctx->lat_hist)
+		goto unregister_cpu_notifier;
+
 	hctx->ctxs = kmalloc_array_node(nr_cpu_ids, sizeof(void *),
 					GFP_KERNEL, node);
 	if (!hctx->ctxs)
-		goto unregister_cpu_notifier;
+		goto free_lat_hist;
 
 	if (sbitmap_init_node(&hctx->ctx_map, nr_cpu_ids, ilog2(8), GFP_KERNEL,
 			      node))
@@ -2304,6 +2465,9 @@ static int blk_mq_init_hctx(struct request_queue *q,
 	sbitmap_free(&hctx->ctx_map);
  free_ctxs:
 	kfree(hctx->ctxs);
+ free_lat_hist:
+	free_percpu(hctx->lat_hist);
+	hctx->lat_hist = NULL;
  unregister_cpu_notifier:
 	blk_mq_remove_cpuhp(hctx);
 	return -1;
@@ -2321,6 +2485,7 @@ static void blk_mq_init_cpu_queues(struct request_queue *q,
 		__ctx->cpu = i;
 		spin_lock_init(&__ctx->lock);
 		INIT_LIST_HEAD(&__ctx->rq_list);
+		__ctx->ring_head = __ctx->ring_tail = 0;
 		__ctx->queue = q;
 
 		/*
@@ -2652,6 +2817,12 @@ struct request_queue *blk_mq_init_allocated_queue(struct blk_mq_tag_set *set,
 	if (!q->poll_cb)
 		goto err_exit;
 
+	q->wake_batch_cb = blk_stat_alloc_callback(blk_mq_wake_batch_stats_fn,
+						   blk_mq_wake_batch_stats_bkt,
+						   1, q);
+	if (!q->wake_batch_cb)
+		goto err_exit;
+
 	q->queue_ctx = alloc_percpu(struct blk_mq_ctx);
 	if (!q->queue_ctx)
 		goto err_exit;
@@ -2699,6 +2870,7 @@ struct request_queue *blk_mq_init_allocated_queue(struct blk_mq_tag_set *set,
 	 * Default to classic polling
 	 */
 	q->poll_nsec = -1;
+	q->tag_wake_batch = -1;
 
 	if (set->ops->complete)
 		blk_queue_softirq_done(q, set->ops->complete);
@@ -3024,6 +3196,48 @@ static void blk_mq_poll_stats_start(struct request_queue *q)
 	blk_stat_activate_msecs(q->poll_cb, 100);
 }
 
+static int blk_mq_wake_batch_stats_bkt(const struct request *rq)
+{
+	return 0;
+}
+
+/* Hook the wake-batch callback up to completion stats, once per queue. */
+static void blk_wake_batch_stats_enable(struct request_queue *q)
+{
+	if (test_bit(QUEUE_FLAG_WAKE_BATCH_STATS, &q->queue_flags) ||
+	    test_and_set_bit(QUEUE_FLAG_WAKE_BATCH_STATS, &q->queue_flags))
+		return;
+	blk_stat_add_callback(q, q->wake_batch_cb);
+}
+
+static void blk_mq_wake_batch_stats_start(struct request_queue *q)
+{
+	if (q->tag_wake_batch != 0 || blk_stat_is_active(q->wake_batch_cb))
+		return;
+
+	blk_wake_batch_stats_enable(q);
+	blk_stat_activate_msecs(q->wake_batch_cb, 100);
+}
+
+static void blk_mq_wake_batch_stats_fn(struct blk_stat_callback *cb)
+{
+	struct request_queue *q = cb->data;
+	unsigned int batch;
+
+	if (q->tag_wake_batch != 0)
+		return;
+
+	/*
+	 * Size wake batches from the completion rate of the last
+	 * window: roughly one wakeup round per 256 completions per
+	 * 100ms, so busy queues coalesce wakeups while lightly loaded
+	 * ones wake waiters immediately.
+	 */
+	batch = clamp_t(unsigned int, cb->stat[0].nr_samples >> 8,
+			1, SBQ_WAKE_BATCH);
+	blk_mq_update_tag_wake_batch(q, batch);
+}
+
 static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb)
 {
 	struct request_queue *q = cb->data;
@@ -3035,6 +3249,42 @@ static void blk_mq_poll_stats_fn(struct blk_stat_callback *cb)
 	}
 }
 
+/*
+ * Apply a tag wakeup batch size to every tag map of the queue,
+ * including the scheduler tags that submitters actually sleep on.
+ */
+void blk_mq_update_tag_wake_batch(struct request_queue *q, unsigned int batch)
+{
+	struct blk_mq_hw_ctx *hctx;
+	int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		blk_mq_tag_update_wake_batch(hctx->tags, batch);
+		if (hctx->sched_tags)
+			blk_mq_tag_update_wake_batch(hctx->sched_tags, batch);
+	}
+}
+
+/**
+ * blk_mq_hctx_set_poll_irq - associate a completion interrupt with a hctx
+ * @hctx: the hardware queue
+ * @irq: the Linux interrupt number completing requests on this queue
+ *
+ * Hybrid polling uses the interrupt's inter-arrival statistics to sleep
+ * until the predicted completion interrupt instead of guessing from past
+ * completion times. Enables interrupt timing instrumentation on first
+ * use; a negative @irq is ignored.
+ */
+void blk_mq_hctx_set_poll_irq(struct blk_mq_hw_ctx *hctx, int irq)
+{
+	if (irq < 0)
+		return;
+
+	hctx->poll_irq = irq;
+	irq_timings_enable();
+}
+EXPORT_SYMBOL_GPL(blk_mq_hctx_set_poll_irq);
+
 static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 				       struct blk_mq_hw_ctx *hctx,
 				       struct request *rq)
@@ -3049,20 +3299,23 @@ static unsigned long blk_mq_poll_nsecs(struct request_queue *q,
 	if (!blk_poll_stats_enable(q))
 		return 0;
 
-	/*
-	 * As an optimistic guess, use half of the mean service time
-	 * for this type of request. We can (and should) make this smarter.
-	 * For instance, if the completion latencies are tight, we can
-	 * get closer than just half the mean. This is especially
-	 * important on devices where the completion latencies are longer
-	 * than ~10 usec. We do use the stats for the relevant IO size
-	 * if available which does lead to better estimates.
-	 */
 	bucket = blk_mq_poll_stats_bkt(rq);
 	if (bucket < 0)
 		return ret;
 
-	if (q->poll_stat[bucket].nr_samples)
+	if (!q->poll_stat[bucket].nr_samples)
+		return ret;
+
+	/*
+	 * In adaptive mode, sleep until the 10th percentile completion
+	 * time of this size class. Half the mean is a poor predictor on
+	 * devices with bimodal completion behavior, where it either
+	 * burns the core spinning on the fast class or oversleeps the
+	 * slow one; p10 means we rarely sleep past an actual completion.
+	 */
+	if (q->poll_nsec == -2)
+		ret = blk_stat_percentile(&q->poll_stat[bucket], 10);
+	else
 		ret = (q->poll_stat[bucket].mean + 1) / 2;
 
 	return ret;
@@ -3083,6 +3336,7 @@ static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
 	/*
 	 * poll_nsec can be:
 	 *
+	 * -2:	sleep until the p10 completion time of the size class
 	 * -1:	don't ever hybrid sleep
 	 *  0:	use half of prev avg
 	 * >0:	use this specific value
@@ -3105,6 +3359,22 @@ static bool blk_mq_poll_hybrid_sleep(struct request_queue *q,
 	 */
 	kt = nsecs;
 
+	/*
+	 * If the driver told us which interrupt completes this queue and
+	 * its arrival pattern is currently stable, sleep until the
+	 * predicted interrupt instead of the statistical guess from past
+	 * completion times. Cap the sleep at twice the fallback target so
+	 * a prediction pointing past the actual completion cannot cost
+	 * more latency than plain hybrid polling could.
+	 */
+	if (hctx->poll_irq >= 0) {
+		u64 now = local_clock();
+		u64 next = irq_timings_next_irq(hctx->poll_irq, now);
+
+		if (next != U64_MAX)
+			kt = min_t(u64, next - now, (u64)nsecs * 2);
+	}
+
 	mode = HRTIMER_MODE_REL;
 	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, mode);
 	hrtimer_set_expires(&hs.timer, kt);
@@ -7,12 +7,32 @@
 
 struct blk_mq_tag_set;
 
+/*
+ * Size of the lock-free dispatch ring in each software queue. Must be a
+ * power-of-2; sized for a couple of full plug batches.
+ */
+#define BLK_MQ_CTX_RING_SIZE	64
+#define BLK_MQ_CTX_RING_MASK	(BLK_MQ_CTX_RING_SIZE - 1)
+
 struct blk_mq_ctx {
 	struct {
 		spinlock_t		lock;
 		struct list_head	rq_list;
 	}  ____cacheline_aligned_in_smp;
 
+	/*
+	 * Lock-free dispatch fast path. The ring is fed only by the CPU
+	 * owning this software queue and drained by whoever runs the
+	 * hardware context, so inserts need no lock at all. Only used
+	 * when the tag set isn't shared; the locked rq_list above is
+	 * the fallback for everything else.
+	 */
+	struct {
+		struct request		*ring[BLK_MQ_CTX_RING_SIZE];
+		unsigned int		ring_head;
+		unsigned int		ring_tail;
+	} ____cacheline_aligned_in_smp;
+
 	unsigned int		cpu;
 	unsigned int		index_hw;
 
@@ -44,6 +64,7 @@ enum mq_rq_state {
 void blk_mq_freeze_queue(struct request_queue *q);
 void blk_mq_free_queue(struct request_queue *q);
 int blk_mq_update_nr_requests(struct request_queue *q, unsigned int nr);
+void blk_mq_update_tag_wake_batch(struct request_queue *q, unsigned int batch);
 void blk_mq_wake_waiters(struct request_queue *q);
 bool blk_mq_dispatch_rq_list(struct request_queue *, struct list_head *, bool);
 void blk_mq_flush_busy_ctxs(struct blk_mq_hw_ctx *hctx, struct list_head *list);
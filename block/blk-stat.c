@@ -22,11 +22,14 @@ static void blk_stat_init(struct blk_rq_stat *stat)
 	stat->min = -1ULL;
 	stat->max = stat->nr_samples = stat->mean = 0;
 	stat->batch = 0;
+	memset(stat->hist, 0, sizeof(stat->hist));
 }
 
 /* src is a per-cpu stat, mean isn't initialized */
 static void blk_stat_sum(struct blk_rq_stat *dst, struct blk_rq_stat *src)
 {
+	int i;
+
 	if (!src->nr_samples)
 		return;
 
@@ -37,14 +40,46 @@ static void blk_stat_sum(struct blk_rq_stat *dst, struct blk_rq_stat *src)
 				dst->nr_samples + src->nr_samples);
 
 	dst->nr_samples += src->nr_samples;
+
+	for (i = 0; i < BLK_RQ_STAT_HIST_BKTS; i++)
+		dst->hist[i] += src->hist[i];
 }
 
 static void __blk_stat_add(struct blk_rq_stat *stat, u64 value)
 {
+	int bucket;
+
 	stat->min = min(stat->min, value);
 	stat->max = max(stat->max, value);
 	stat->batch += value;
 	stat->nr_samples++;
+
+	bucket = value ? min(ilog2(value), BLK_RQ_STAT_HIST_BKTS - 1) : 0;
+	stat->hist[bucket]++;
+}
+
+/*
+ * Estimate the @pct'th percentile completion time from the log2
+ * histogram. Returns the upper bound of the bucket the percentile
+ * falls into, so the result errs towards overestimating slightly
+ * rather than undershooting. 0 if there are no samples.
+ */
+u64 blk_stat_percentile(const struct blk_rq_stat *stat, unsigned int pct)
+{
+	u64 thresh = div_u64((u64)stat->nr_samples * pct, 100);
+	u64 nr = 0;
+	int i;
+
+	if (!stat->nr_samples)
+		return 0;
+
+	for (i = 0; i < BLK_RQ_STAT_HIST_BKTS; i++) {
+		nr += stat->hist[i];
+		if (nr > thresh)
+			return min_t(u64, 2ULL << i, stat->max);
+	}
+
+	return stat->max;
 }
 
 void blk_stat_add(struct request *rq)
@@ -10,11 +10,11 @@
 
 /*
  * from upper:
- * 3 bits: reserved for other usage
+ * 6 bits: reserved for other usage
  * 12 bits: size
- * 49 bits: time
+ * 46 bits: time
  */
-#define BLK_STAT_RES_BITS	3
+#define BLK_STAT_RES_BITS	6
 #define BLK_STAT_SIZE_BITS	12
 #define BLK_STAT_RES_SHIFT	(64 - BLK_STAT_RES_BITS)
 #define BLK_STAT_SIZE_SHIFT	(BLK_STAT_RES_SHIFT - BLK_STAT_SIZE_BITS)
@@ -113,6 +113,16 @@ static inline void blk_stat_set_issue(struct blk_issue_stat *stat,
 /* record time/size info in request but not add a callback */
 void blk_stat_enable_accounting(struct request_queue *q);
 
+/**
+ * blk_stat_percentile() - Estimate a completion time percentile.
+ * @stat: Aggregated statistics to query.
+ * @pct: Percentile, 0-100.
+ *
+ * Return: Upper bound of the log2 histogram bucket containing the
+ * percentile, capped to the observed maximum. 0 without samples.
+ */
+u64 blk_stat_percentile(const struct blk_rq_stat *stat, unsigned int pct);
+
 /**
  * blk_stat_alloc_callback() - Allocate a block statistics callback.
  * @timer_fn: Timer callback function.
@@ -368,8 +368,8 @@ static ssize_t queue_poll_delay_show(struct request_queue *q, char *page)
 {
 	int val;
 
-	if (q->poll_nsec == -1)
-		val = -1;
+	if (q->poll_nsec < 0)
+		val = q->poll_nsec;
 	else
 		val = q->poll_nsec / 1000;
 
@@ -388,14 +388,49 @@ static ssize_t queue_poll_delay_store(struct request_queue *q, const char *page,
 	if (err < 0)
 		return err;
 
-	if (val == -1)
-		q->poll_nsec = -1;
+	if (val == -1 || val == -2)
+		q->poll_nsec = val;
+	else if (val < 0)
+		return -EINVAL;
 	else
 		q->poll_nsec = val * 1000;
 
 	return count;
 }
 
+static ssize_t queue_wake_batch_show(struct request_queue *q, char *page)
+{
+	return sprintf(page, "%d\n", q->tag_wake_batch);
+}
+
+static ssize_t queue_wake_batch_store(struct request_queue *q,
+				      const char *page, size_t count)
+{
+	int err, val;
+
+	if (!q->mq_ops)
+		return -EINVAL;
+
+	err = kstrtoint(page, 10, &val);
+	if (err < 0)
+		return err;
+
+	/*
+	 * -1 stops adjusting (keeping whatever is in place), 0 sizes
+	 * batches from the completion rate, > 0 pins the batch.
+	 */
+	if (val < -1)
+		return -EINVAL;
+
+	q->tag_wake_batch = val;
+	if (val > 0)
+		blk_mq_update_tag_wake_batch(q, val);
+	else if (val == 0)
+		blk_stat_enable_accounting(q);
+
+	return count;
+}
+
 static ssize_t queue_poll_show(struct request_queue *q, char *page)
 {
 	return queue_var_show(test_bit(QUEUE_FLAG_POLL, &q->queue_flags), page);
@@ -653,6 +688,12 @@ static struct queue_sysfs_entry queue_poll_entry = {
 	.store = queue_poll_store,
 };
 
+static struct queue_sysfs_entry queue_wake_batch_entry = {
+	.attr = {.name = "wake_batch", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_wake_batch_show,
+	.store = queue_wake_batch_store,
+};
+
 static struct queue_sysfs_entry queue_poll_delay_entry = {
 	.attr = {.name = "io_poll_delay", .mode = S_IRUGO | S_IWUSR },
 	.show = queue_poll_delay_show,
@@ -716,6 +757,7 @@ static struct attribute *default_attrs[] = {
 	&queue_wc_entry.attr,
 	&queue_dax_entry.attr,
 	&queue_wb_lat_entry.attr,
+	&queue_wake_batch_entry.attr,
 	&queue_poll_delay_entry.attr,
 #ifdef CONFIG_BLK_DEV_THROTTLING_LOW
 	&throtl_sample_time_entry.attr,
@@ -798,6 +840,9 @@ static void __blk_release_queue(struct work_struct *work)
 	if (test_bit(QUEUE_FLAG_POLL_STATS, &q->queue_flags))
 		blk_stat_remove_callback(q, q->poll_cb);
 	blk_stat_free_callback(q->poll_cb);
+	if (test_bit(QUEUE_FLAG_WAKE_BATCH_STATS, &q->queue_flags))
+		blk_stat_remove_callback(q, q->wake_batch_cb);
+	blk_stat_free_callback(q->wake_batch_cb);
 	bdi_put(q->backing_dev_info);
 	blkcg_exit_queue(q);
 
@@ -829,6 +874,8 @@ static void __blk_release_queue(struct work_struct *work)
 	if (q->bio_split)
 		bioset_free(q->bio_split);
 
+	blk_zone_cache_free(q);
+
 	ida_simple_remove(&blk_queue_ida, q->id);
 	call_rcu(&q->rcu_head, blk_free_queue_rcu);
 }
@@ -216,6 +216,11 @@ struct throtl_data
 
 	unsigned int scale;
 
+	/* guarantee capacity lent out by idle cgroups, per busy cgroup */
+	unsigned long low_credit_update_time;
+	uint64_t low_credit_bps[2];
+	unsigned int low_credit_iops[2];
+
 	struct latency_bucket tmp_buckets[2][LATENCY_BUCKET_SIZE];
 	struct avg_latency_bucket avg_buckets[2][LATENCY_BUCKET_SIZE];
 	struct latency_bucket __percpu *latency_buckets[2];
@@ -292,6 +297,65 @@ static uint64_t throtl_adjusted_limit(uint64_t low, struct throtl_data *td)
 	return low + (low >> 1) * td->scale;
 }
 
+static bool throtl_tg_is_idle(struct throtl_grp *tg);
+
+/*
+ * While the queue runs at LIMIT_LOW, the guarantees of cgroups that are
+ * currently idle would simply go unused.  Lend that capacity out: the low
+ * budgets of idle cgroups are pooled and split equally among the busy
+ * cgroups with low limits, which add their share on top of their
+ * configured floor.  The shares are recomputed at most once per
+ * throtl_slice, so a lender waking up reclaims its guarantee within one
+ * slice: its own limit was never reduced, and the borrowers drop back to
+ * their floors at the next refresh.  Called with queue lock held.
+ */
+static void throtl_update_low_credit(struct throtl_data *td)
+{
+	struct cgroup_subsys_state *pos_css;
+	struct blkcg_gq *blkg;
+	uint64_t idle_bps[2] = { 0, 0 };
+	uint64_t idle_iops[2] = { 0, 0 };
+	unsigned int nr_busy = 0;
+
+	if (time_before(jiffies,
+			td->low_credit_update_time + td->throtl_slice))
+		return;
+	td->low_credit_update_time = jiffies;
+
+	rcu_read_lock();
+	blkg_for_each_descendant_post(blkg, pos_css, td->queue->root_blkg) {
+		struct throtl_grp *tg = blkg_to_tg(blkg);
+
+		if (!list_empty(&blkg->blkcg->css.children))
+			continue;
+		if (!tg->bps[READ][LIMIT_LOW] && !tg->bps[WRITE][LIMIT_LOW] &&
+		    !tg->iops[READ][LIMIT_LOW] && !tg->iops[WRITE][LIMIT_LOW])
+			continue;
+		if (throtl_tg_is_idle(tg)) {
+			idle_bps[READ] += tg->bps[READ][LIMIT_LOW];
+			idle_bps[WRITE] += tg->bps[WRITE][LIMIT_LOW];
+			idle_iops[READ] += tg->iops[READ][LIMIT_LOW];
+			idle_iops[WRITE] += tg->iops[WRITE][LIMIT_LOW];
+		} else {
+			nr_busy++;
+		}
+	}
+	rcu_read_unlock();
+
+	if (!nr_busy) {
+		memset(td->low_credit_bps, 0, sizeof(td->low_credit_bps));
+		memset(td->low_credit_iops, 0, sizeof(td->low_credit_iops));
+		return;
+	}
+
+	td->low_credit_bps[READ] = div_u64(idle_bps[READ], nr_busy);
+	td->low_credit_bps[WRITE] = div_u64(idle_bps[WRITE], nr_busy);
+	td->low_credit_iops[READ] = min_t(uint64_t, UINT_MAX,
+				div_u64(idle_iops[READ], nr_busy));
+	td->low_credit_iops[WRITE] = min_t(uint64_t, UINT_MAX,
+				div_u64(idle_iops[WRITE], nr_busy));
+}
+
 static uint64_t tg_bps_limit(struct throtl_grp *tg, int rw)
 {
 	struct blkcg_gq *blkg = tg_to_blkg(tg);
@@ -312,6 +376,13 @@ static uint64_t tg_bps_limit(struct throtl_grp *tg, int rw)
 			return MIN_THROTL_BPS;
 	}
 
+	if (td->limit_index == LIMIT_LOW) {
+		/* busy cgroups may borrow the guarantees of idle ones */
+		throtl_update_low_credit(td);
+		if (td->low_credit_bps[rw] && !throtl_tg_is_idle(tg))
+			ret += td->low_credit_bps[rw];
+	}
+
 	if (td->limit_index == LIMIT_MAX && tg->bps[rw][LIMIT_LOW] &&
 	    tg->bps[rw][LIMIT_LOW] != tg->bps[rw][LIMIT_MAX]) {
 		uint64_t adjusted;
@@ -342,6 +413,14 @@ static unsigned int tg_iops_limit(struct throtl_grp *tg, int rw)
 			return MIN_THROTL_IOPS;
 	}
 
+	if (td->limit_index == LIMIT_LOW) {
+		/* busy cgroups may borrow the guarantees of idle ones */
+		throtl_update_low_credit(td);
+		if (td->low_credit_iops[rw] && !throtl_tg_is_idle(tg))
+			ret = min_t(uint64_t, UINT_MAX,
+				    (uint64_t)ret + td->low_credit_iops[rw]);
+	}
+
 	if (td->limit_index == LIMIT_MAX && tg->iops[rw][LIMIT_LOW] &&
 	    tg->iops[rw][LIMIT_LOW] != tg->iops[rw][LIMIT_MAX]) {
 		uint64_t adjusted;
@@ -1941,6 +2020,10 @@ static void throtl_downgrade_state(struct throtl_data *td, int new)
 
 	td->limit_index = new;
 	td->low_downgrade_time = jiffies;
+	/* recompute lending shares on the first dispatch at the new limit */
+	td->low_credit_update_time = jiffies - td->throtl_slice;
+	memset(td->low_credit_bps, 0, sizeof(td->low_credit_bps));
+	memset(td->low_credit_iops, 0, sizeof(td->low_credit_iops));
 }
 
 static bool throtl_tg_can_downgrade(struct throtl_grp *tg)
@@ -15,11 +15,24 @@ enum wbt_flags {
 	WBT_READ		= 2,	/* read */
 	WBT_KSWAPD		= 4,	/* write, from kswapd */
 
-	WBT_NR_BITS		= 3,	/* number of bits */
+	/*
+	 * Write stream the bio was classified into, from its write
+	 * life-time hint. 0 means no stream, see wbt_bio_stream().
+	 */
+	WBT_STREAM_SHIFT	= 3,
+	WBT_STREAM_MASK		= 7 << WBT_STREAM_SHIFT,
+
+	WBT_NR_BITS		= 6,	/* number of bits */
 };
 
 enum {
-	WBT_NUM_RWQ		= 2,
+	WBT_RWQ_BG = 0,
+	WBT_RWQ_KSWAPD,
+	WBT_RWQ_STREAM,		/* first of WBT_NUM_STREAMS queues */
+
+	/* one queue per write life-time hint beyond NONE */
+	WBT_NUM_STREAMS		= 4,
+	WBT_NUM_RWQ		= WBT_RWQ_STREAM + WBT_NUM_STREAMS,
 };
 
 /*
@@ -12,6 +12,13 @@
 #include <linux/module.h>
 #include <linux/rbtree.h>
 #include <linux/blkdev.h>
+#include <linux/mm.h>
+
+/*
+ * Maximum number of zone report commands issued in parallel by
+ * blkdev_report_zones_batch().
+ */
+#define BLK_ZONE_REPORT_MAX_BIOS	16
 
 static inline sector_t blk_zone_start(struct request_queue *q,
 				      sector_t sector)
@@ -90,6 +97,131 @@ static bool blkdev_report_zone(struct block_device *bdev,
 	return true;
 }
 
+/*
+ * The zone report has a header. So make room for it in the payload.
+ * Also make sure that the report fits in a single BIO that will not
+ * be split down the stack.
+ */
+static unsigned int blkdev_nr_report_pages(struct request_queue *q,
+					   unsigned int nr_zones)
+{
+	size_t rep_bytes;
+	unsigned int nr_pages;
+
+	rep_bytes = sizeof(struct blk_zone_report_hdr) +
+		sizeof(struct blk_zone) * nr_zones;
+	rep_bytes = (rep_bytes + PAGE_SIZE - 1) & PAGE_MASK;
+	if (rep_bytes > (queue_max_sectors(q) << 9))
+		rep_bytes = queue_max_sectors(q) << 9;
+
+	nr_pages = min_t(unsigned int, BIO_MAX_PAGES,
+			 rep_bytes >> PAGE_SHIFT);
+	return min_t(unsigned int, nr_pages, queue_max_segments(q));
+}
+
+/*
+ * Allocate and fill a zone report BIO for the zone containing @sector,
+ * sized to carry up to @nr_zones zone descriptors.
+ */
+static struct bio *blkdev_report_bio_alloc(struct block_device *bdev,
+					   sector_t sector,
+					   unsigned int nr_zones,
+					   gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	unsigned int nr_pages = blkdev_nr_report_pages(q, nr_zones);
+	struct page *page;
+	struct bio *bio;
+	unsigned int i;
+
+	bio = bio_alloc(gfp_mask, nr_pages);
+	if (!bio)
+		return NULL;
+
+	bio_set_dev(bio, bdev);
+	bio->bi_iter.bi_sector = blk_zone_start(q, sector);
+	bio_set_op_attrs(bio, REQ_OP_ZONE_REPORT, 0);
+
+	for (i = 0; i < nr_pages; i++) {
+		page = alloc_page(gfp_mask);
+		if (!page)
+			break;
+		if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
+			__free_page(page);
+			break;
+		}
+	}
+
+	if (!i) {
+		bio_put(bio);
+		return NULL;
+	}
+
+	return bio;
+}
+
+static void blkdev_report_bio_free(struct bio *bio)
+{
+	struct bio_vec *bv;
+	int i;
+
+	bio_for_each_segment_all(bv, bio, i)
+		__free_page(bv->bv_page);
+	bio_put(bio);
+}
+
+/*
+ * Process a completed report BIO: skip the header and go through the
+ * reported zones to fixup the zone information for partitions. At the
+ * same time, return the zone information into the zone array. Returns
+ * the number of zones copied into @zones.
+ */
+static unsigned int blkdev_report_bio_parse(struct block_device *bdev,
+					    struct bio *bio,
+					    struct blk_zone *zones,
+					    unsigned int nrz)
+{
+	struct blk_zone_report_hdr *hdr;
+	unsigned int nr_rep = 0;
+	unsigned int i, n = 0, nz = 0;
+	struct bio_vec *bv;
+	unsigned int ofst;
+	void *addr;
+
+	bio_for_each_segment_all(bv, bio, i) {
+
+		if (!bv->bv_page)
+			break;
+
+		addr = kmap_atomic(bv->bv_page);
+
+		/* Get header in the first page */
+		ofst = 0;
+		if (!nr_rep) {
+			hdr = (struct blk_zone_report_hdr *) addr;
+			nr_rep = hdr->nr_zones;
+			ofst = sizeof(struct blk_zone_report_hdr);
+		}
+
+		/* Fixup and report zones */
+		while (ofst < bv->bv_len &&
+		       n < nr_rep && nz < nrz) {
+			if (blkdev_report_zone(bdev, addr + ofst, &zones[nz]))
+				nz++;
+			ofst += sizeof(struct blk_zone);
+			n++;
+		}
+
+		kunmap_atomic(addr);
+
+		if (n >= nr_rep || nz >= nrz)
+			break;
+
+	}
+
+	return nz;
+}
+
 /**
  * blkdev_report_zones - Get zones information
  * @bdev:	Target block device
@@ -111,17 +243,8 @@ int blkdev_report_zones(struct block_device *bdev,
 			gfp_t gfp_mask)
 {
 	struct request_queue *q = bdev_get_queue(bdev);
-	struct blk_zone_report_hdr *hdr;
 	unsigned int nrz = *nr_zones;
-	struct page *page;
-	unsigned int nr_rep;
-	size_t rep_bytes;
-	unsigned int nr_pages;
 	struct bio *bio;
-	struct bio_vec *bv;
-	unsigned int i, n, nz;
-	unsigned int ofst;
-	void *addr;
 	int ret;
 
 	if (!q)
@@ -138,98 +261,262 @@ int blkdev_report_zones(struct block_device *bdev,
 		return 0;
 	}
 
-	/*
-	 * The zone report has a header. So make room for it in the
-	 * payload. Also make sure that the report fits in a single BIO
-	 * that will not be split down the stack.
-	 */
-	rep_bytes = sizeof(struct blk_zone_report_hdr) +
-		sizeof(struct blk_zone) * nrz;
-	rep_bytes = (rep_bytes + PAGE_SIZE - 1) & PAGE_MASK;
-	if (rep_bytes > (queue_max_sectors(q) << 9))
-		rep_bytes = queue_max_sectors(q) << 9;
+	bio = blkdev_report_bio_alloc(bdev, sector, nrz, gfp_mask);
+	if (!bio)
+		return -ENOMEM;
 
-	nr_pages = min_t(unsigned int, BIO_MAX_PAGES,
-			 rep_bytes >> PAGE_SHIFT);
-	nr_pages = min_t(unsigned int, nr_pages,
-			 queue_max_segments(q));
+	ret = submit_bio_wait(bio);
+	if (!ret)
+		*nr_zones = blkdev_report_bio_parse(bdev, bio, zones, nrz);
 
-	bio = bio_alloc(gfp_mask, nr_pages);
-	if (!bio)
+	blkdev_report_bio_free(bio);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(blkdev_report_zones);
+
+/*
+ * Completion aggregator for a batch of report BIOs in flight.
+ */
+struct blk_zone_report_batch {
+	atomic_t		pending;
+	struct completion	done;
+	blk_status_t		status;
+};
+
+static void blkdev_report_batch_end_io(struct bio *bio)
+{
+	struct blk_zone_report_batch *batch = bio->bi_private;
+
+	/* Any failed report fails the batch; which one does not matter. */
+	if (bio->bi_status)
+		batch->status = bio->bi_status;
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+/**
+ * blkdev_report_zones_batch - Get zones information using parallel commands
+ * @bdev:	Target block device
+ * @sector:	Sector from which to report zones
+ * @zones:	Array of zone structures where to return the zones information
+ * @nr_zones:	Number of zone structures in the zone array
+ * @gfp_mask:	Memory allocation flags (for bio_alloc)
+ *
+ * Description:
+ *    Same as blkdev_report_zones(), but large reports are split into up
+ *    to %BLK_ZONE_REPORT_MAX_BIOS report commands issued concurrently
+ *    instead of one command at a time, which makes a large difference
+ *    when scanning tens of thousands of zones at mount time. The split
+ *    relies on the uniform zone size exposed by the queue limits to
+ *    compute the start sector of each command.
+ */
+int blkdev_report_zones_batch(struct block_device *bdev,
+			      sector_t sector,
+			      struct blk_zone *zones,
+			      unsigned int *nr_zones,
+			      gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_zone_report_batch batch;
+	unsigned int nrz = *nr_zones;
+	unsigned int zones_per_bio, nr_bios;
+	unsigned int i, nz;
+	struct bio **bios;
+	int ret = 0;
+
+	if (!q)
+		return -ENXIO;
+
+	if (!blk_queue_is_zoned(q))
+		return -EOPNOTSUPP;
+
+	if (!nrz)
+		return 0;
+
+	if (sector > bdev->bd_part->nr_sects) {
+		*nr_zones = 0;
+		return 0;
+	}
+
+	zones_per_bio = ((blkdev_nr_report_pages(q, nrz) << PAGE_SHIFT) -
+			 sizeof(struct blk_zone_report_hdr)) /
+			sizeof(struct blk_zone);
+	nr_bios = min_t(unsigned int, DIV_ROUND_UP(nrz, zones_per_bio),
+			BLK_ZONE_REPORT_MAX_BIOS);
+
+	bios = kcalloc(nr_bios, sizeof(struct bio *), gfp_mask);
+	if (!bios)
 		return -ENOMEM;
 
-	bio_set_dev(bio, bdev);
-	bio->bi_iter.bi_sector = blk_zone_start(q, sector);
-	bio_set_op_attrs(bio, REQ_OP_ZONE_REPORT, 0);
+	/* Hold one pending reference while submitting */
+	atomic_set(&batch.pending, 1);
+	init_completion(&batch.done);
+	batch.status = BLK_STS_OK;
 
-	for (i = 0; i < nr_pages; i++) {
-		page = alloc_page(gfp_mask);
-		if (!page) {
-			ret = -ENOMEM;
-			goto out;
-		}
-		if (!bio_add_page(bio, page, PAGE_SIZE, 0)) {
-			__free_page(page);
+	for (i = 0; i < nr_bios; i++) {
+		sector_t s = blk_zone_start(q, sector) +
+			(sector_t)i * zones_per_bio *
+			blk_queue_zone_sectors(q);
+
+		if (s >= bdev->bd_part->nr_sects)
+			break;
+
+		bios[i] = blkdev_report_bio_alloc(bdev, s, zones_per_bio,
+						  gfp_mask);
+		if (!bios[i]) {
+			if (!i)
+				ret = -ENOMEM;
 			break;
 		}
+
+		bios[i]->bi_private = &batch;
+		bios[i]->bi_end_io = blkdev_report_batch_end_io;
+		atomic_inc(&batch.pending);
+		submit_bio(bios[i]);
 	}
 
-	if (i == 0)
-		ret = -ENOMEM;
-	else
-		ret = submit_bio_wait(bio);
-	if (ret)
-		goto out;
+	if (!atomic_dec_and_test(&batch.pending))
+		wait_for_completion_io(&batch.done);
+
+	if (!ret)
+		ret = blk_status_to_errno(batch.status);
 
 	/*
-	 * Process the report result: skip the header and go through the
-	 * reported zones to fixup and fixup the zone information for
-	 * partitions. At the same time, return the zone information into
-	 * the zone array.
+	 * The BIOs were issued in ascending sector order, so their
+	 * results concatenate directly into the zone array.
 	 */
-	n = 0;
 	nz = 0;
-	nr_rep = 0;
-	bio_for_each_segment_all(bv, bio, i) {
+	for (i = 0; i < nr_bios && bios[i]; i++) {
+		if (!ret && nz < nrz)
+			nz += blkdev_report_bio_parse(bdev, bios[i],
+						      &zones[nz], nrz - nz);
+		blkdev_report_bio_free(bios[i]);
+	}
+	kfree(bios);
 
-		if (!bv->bv_page)
+	if (!ret)
+		*nr_zones = nz;
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(blkdev_report_zones_batch);
+
+/*
+ * Reflect a successful zone reset in the cached zone index, if one was
+ * built for the queue.
+ */
+static void blk_zone_cache_reset(struct request_queue *q, sector_t sector,
+				 sector_t end_sector)
+{
+	unsigned int zno;
+
+	spin_lock(&q->zone_cache_lock);
+	for (zno = blk_queue_zone_no(q, sector);
+	     q->zone_cache && zno < q->zone_cache_nr; zno++) {
+		struct blk_zone *zone = &q->zone_cache[zno];
+
+		if (zone->start >= end_sector)
 			break;
+		if (zone->type == BLK_ZONE_TYPE_CONVENTIONAL)
+			continue;
+		zone->wp = zone->start;
+		zone->cond = BLK_ZONE_COND_EMPTY;
+	}
+	spin_unlock(&q->zone_cache_lock);
+}
 
-		addr = kmap_atomic(bv->bv_page);
+/**
+ * blk_revalidate_zone_cache - Build or refresh the cached zone index
+ * @bdev:	Target block device, should be the whole device
+ * @gfp_mask:	Memory allocation flags (for bio_alloc)
+ *
+ * Description:
+ *    Report all zones of @bdev and keep a copy of the result on the
+ *    request queue, so that blk_lookup_zone() can answer zone state
+ *    queries without issuing any command. The cache goes stale as
+ *    writes move the write pointers; users are expected to refresh it
+ *    at natural synchronization points (mount, recovery), not to rely
+ *    on it for exact write pointer positions.
+ */
+int blk_revalidate_zone_cache(struct block_device *bdev, gfp_t gfp_mask)
+{
+	struct request_queue *q = bdev_get_queue(bdev);
+	struct blk_zone *zones, *old;
+	unsigned int nrz;
+	int ret;
 
-		/* Get header in the first page */
-		ofst = 0;
-		if (!nr_rep) {
-			hdr = (struct blk_zone_report_hdr *) addr;
-			nr_rep = hdr->nr_zones;
-			ofst = sizeof(struct blk_zone_report_hdr);
-		}
+	if (!q)
+		return -ENXIO;
 
-		/* Fixup and report zones */
-		while (ofst < bv->bv_len &&
-		       n < nr_rep && nz < nrz) {
-			if (blkdev_report_zone(bdev, addr + ofst, &zones[nz]))
-				nz++;
-			ofst += sizeof(struct blk_zone);
-			n++;
-		}
+	if (!blk_queue_is_zoned(q))
+		return -EOPNOTSUPP;
 
-		kunmap_atomic(addr);
+	nrz = blk_queue_nr_zones(q);
+	if (!nrz)
+		nrz = blk_queue_zone_no(q, bdev->bd_part->nr_sects +
+					blk_queue_zone_sectors(q) - 1);
+	if (!nrz)
+		return -ENXIO;
 
-		if (n >= nr_rep || nz >= nrz)
-			break;
+	zones = kvmalloc_array(nrz, sizeof(struct blk_zone),
+			       gfp_mask | __GFP_ZERO);
+	if (!zones)
+		return -ENOMEM;
 
+	ret = blkdev_report_zones_batch(bdev, 0, zones, &nrz, gfp_mask);
+	if (ret) {
+		kvfree(zones);
+		return ret;
 	}
 
-	*nr_zones = nz;
-out:
-	bio_for_each_segment_all(bv, bio, i)
-		__free_page(bv->bv_page);
-	bio_put(bio);
+	spin_lock(&q->zone_cache_lock);
+	old = q->zone_cache;
+	q->zone_cache = zones;
+	q->zone_cache_nr = nrz;
+	spin_unlock(&q->zone_cache_lock);
+
+	kvfree(old);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(blk_revalidate_zone_cache);
+
+/**
+ * blk_lookup_zone - Query the cached zone index
+ * @q:		Target request queue
+ * @sector:	Sector inside the zone to look up
+ * @zone:	Zone structure to fill from the cache
+ *
+ * Description:
+ *    Copy the cached information of the zone containing @sector into
+ *    @zone without touching the device. Returns -ENODATA if no cache
+ *    was built with blk_revalidate_zone_cache() or if @sector falls
+ *    outside of it.
+ */
+int blk_lookup_zone(struct request_queue *q, sector_t sector,
+		    struct blk_zone *zone)
+{
+	unsigned int zno = blk_queue_zone_no(q, sector);
+	int ret = -ENODATA;
+
+	spin_lock(&q->zone_cache_lock);
+	if (q->zone_cache && zno < q->zone_cache_nr) {
+		*zone = q->zone_cache[zno];
+		ret = 0;
+	}
+	spin_unlock(&q->zone_cache_lock);
 
 	return ret;
 }
-EXPORT_SYMBOL_GPL(blkdev_report_zones);
+EXPORT_SYMBOL_GPL(blk_lookup_zone);
+
+void blk_zone_cache_free(struct request_queue *q)
+{
+	kvfree(q->zone_cache);
+	q->zone_cache = NULL;
+	q->zone_cache_nr = 0;
+}
 
 /**
  * blkdev_reset_zones - Reset zones write pointer
@@ -292,6 +579,8 @@ int blkdev_reset_zones(struct block_device *bdev,
 
 	}
 
+	blk_zone_cache_reset(q, end_sector - nr_sectors, end_sector);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(blkdev_reset_zones);
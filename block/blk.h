@@ -3,6 +3,7 @@
 #define BLK_INTERNAL_H
 
 #include <linux/idr.h>
+#include <linux/hash.h>
 #include <linux/blk-mq.h>
 #include "blk-mq.h"
 
@@ -110,6 +111,33 @@ bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
 			    struct bio *bio);
 bool bio_attempt_discard_merge(struct request_queue *q, struct request *req,
 		struct bio *bio);
+/*
+ * Plug back-merge candidate index. Keyed by the sector a plugged
+ * request ends at; only ever touched by the plug's owning task.
+ */
+static inline struct request **blk_plug_merge_slot(struct blk_plug *plug,
+						   sector_t sector)
+{
+	return &plug->merge_hash[hash_64(sector,
+					 ilog2(BLK_PLUG_MERGE_HASH_SIZE))];
+}
+
+static inline void blk_plug_merge_add(struct blk_plug *plug,
+				      struct request *rq)
+{
+	*blk_plug_merge_slot(plug, blk_rq_pos(rq) + blk_rq_sectors(rq)) = rq;
+}
+
+static inline void blk_plug_merge_del(struct blk_plug *plug,
+				      struct request *rq)
+{
+	int i;
+
+	for (i = 0; i < BLK_PLUG_MERGE_HASH_SIZE; i++)
+		if (plug->merge_hash[i] == rq)
+			plug->merge_hash[i] = NULL;
+}
+
 bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
 			    unsigned int *request_count,
 			    struct request **same_queue_rq);
@@ -19,6 +19,7 @@
 
 #include <linux/kernel.h>
 #include <linux/blkdev.h>
+#include <linux/blk-cgroup.h>
 #include <linux/blk-mq.h>
 #include <linux/elevator.h>
 #include <linux/module.h>
@@ -248,6 +249,139 @@ static void kyber_adjust_other_depth(struct kyber_queue_data *kqd,
 		sbitmap_queue_resize(&kqd->domain_tokens[KYBER_OTHER], depth);
 }
 
+#ifdef CONFIG_BLK_CGROUP
+static struct blkcg_policy blkcg_policy_kyber;
+
+/*
+ * Per-cgroup, per-device latency targets. Zero means "inherit the
+ * queue-wide target". The domain depth budget is still shared across
+ * the whole device; the effective target feeding the depth adjustment
+ * is the strictest one configured on the queue, so a latency-critical
+ * cgroup can tighten it without the batch tier widening it again.
+ */
+struct kyber_group_data {
+	struct blkg_policy_data pd;
+	u64 read_lat_nsec;
+	u64 write_lat_nsec;
+};
+
+static struct kyber_group_data *pd_to_kgd(struct blkg_policy_data *pd)
+{
+	return pd ? container_of(pd, struct kyber_group_data, pd) : NULL;
+}
+
+static struct kyber_group_data *blkg_to_kgd(struct blkcg_gq *blkg)
+{
+	return pd_to_kgd(blkg_to_pd(blkg, &blkcg_policy_kyber));
+}
+
+static struct blkg_policy_data *kyber_pd_alloc(gfp_t gfp, int node)
+{
+	struct kyber_group_data *kgd;
+
+	kgd = kzalloc_node(sizeof(*kgd), gfp, node);
+	return kgd ? &kgd->pd : NULL;
+}
+
+static void kyber_pd_free(struct blkg_policy_data *pd)
+{
+	kfree(pd_to_kgd(pd));
+}
+
+static u64 kyber_prfill_lat(struct seq_file *sf, struct blkg_policy_data *pd,
+			    int off)
+{
+	u64 v = *(u64 *)((void *)pd_to_kgd(pd) + off);
+
+	if (!v)
+		return 0;
+	return __blkg_prfill_u64(sf, pd, v);
+}
+
+static int kyber_print_lat(struct seq_file *sf, void *v)
+{
+	blkcg_print_blkgs(sf, css_to_blkcg(seq_css(sf)), kyber_prfill_lat,
+			  &blkcg_policy_kyber, seq_cft(sf)->private, false);
+	return 0;
+}
+
+static ssize_t kyber_set_lat(struct kernfs_open_file *of, char *buf,
+			     size_t nbytes, loff_t off)
+{
+	struct blkcg *blkcg = css_to_blkcg(of_css(of));
+	struct blkg_conf_ctx ctx;
+	u64 v;
+	int ret;
+
+	ret = blkg_conf_prep(blkcg, &blkcg_policy_kyber, buf, &ctx);
+	if (ret)
+		return ret;
+
+	ret = -EINVAL;
+	if (sscanf(ctx.body, "%llu", &v) == 1) {
+		struct kyber_group_data *kgd = blkg_to_kgd(ctx.blkg);
+
+		*(u64 *)((void *)kgd + of_cft(of)->private) = v;
+		ret = 0;
+	}
+
+	blkg_conf_finish(&ctx);
+	return ret ?: nbytes;
+}
+
+static struct cftype kyber_blkcg_files[] = {
+	{
+		.name = "kyber.read_lat_nsec",
+		.private = offsetof(struct kyber_group_data, read_lat_nsec),
+		.seq_show = kyber_print_lat,
+		.write = kyber_set_lat,
+	},
+	{
+		.name = "kyber.write_lat_nsec",
+		.private = offsetof(struct kyber_group_data, write_lat_nsec),
+		.seq_show = kyber_print_lat,
+		.write = kyber_set_lat,
+	},
+	{ }	/* terminate */
+};
+
+static struct blkcg_policy blkcg_policy_kyber = {
+	.dfl_cftypes		= kyber_blkcg_files,
+	.legacy_cftypes		= kyber_blkcg_files,
+
+	.pd_alloc_fn		= kyber_pd_alloc,
+	.pd_free_fn		= kyber_pd_free,
+};
+
+static u64 kyber_effective_latency(struct kyber_queue_data *kqd, bool read)
+{
+	u64 target = read ? kqd->read_lat_nsec : kqd->write_lat_nsec;
+	struct request_queue *q = kqd->q;
+	struct blkcg_gq *blkg;
+	unsigned long flags;
+
+	spin_lock_irqsave(q->queue_lock, flags);
+	list_for_each_entry(blkg, &q->blkg_list, q_node) {
+		struct kyber_group_data *kgd = blkg_to_kgd(blkg);
+		u64 v;
+
+		if (!kgd)
+			continue;
+		v = read ? kgd->read_lat_nsec : kgd->write_lat_nsec;
+		if (v)
+			target = min(target, v);
+	}
+	spin_unlock_irqrestore(q->queue_lock, flags);
+
+	return target;
+}
+#else /* CONFIG_BLK_CGROUP */
+static u64 kyber_effective_latency(struct kyber_queue_data *kqd, bool read)
+{
+	return read ? kqd->read_lat_nsec : kqd->write_lat_nsec;
+}
+#endif /* CONFIG_BLK_CGROUP */
+
 /*
  * Apply heuristics for limiting queue depths based on gathered latency
  * statistics.
@@ -257,8 +391,10 @@ static void kyber_stat_timer_fn(struct blk_stat_callback *cb)
 	struct kyber_queue_data *kqd = cb->data;
 	int read_status, write_status;
 
-	read_status = kyber_lat_status(cb, KYBER_READ, kqd->read_lat_nsec);
-	write_status = kyber_lat_status(cb, KYBER_SYNC_WRITE, kqd->write_lat_nsec);
+	read_status = kyber_lat_status(cb, KYBER_READ,
+				       kyber_effective_latency(kqd, true));
+	write_status = kyber_lat_status(cb, KYBER_SYNC_WRITE,
+					kyber_effective_latency(kqd, false));
 
 	kyber_adjust_rw_depth(kqd, KYBER_READ, read_status, write_status);
 	kyber_adjust_rw_depth(kqd, KYBER_SYNC_WRITE, write_status, read_status);
@@ -359,6 +495,10 @@ static int kyber_init_sched(struct request_queue *q, struct elevator_type *e)
 
 	blk_stat_add_callback(q, kqd->cb);
 
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_activate_policy(q, &blkcg_policy_kyber);
+#endif
+
 	return 0;
 }
 
@@ -370,6 +510,10 @@ static void kyber_exit_sched(struct elevator_queue *e)
 
 	blk_stat_remove_callback(q, kqd->cb);
 
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_deactivate_policy(q, &blkcg_policy_kyber);
+#endif
+
 	for (i = 0; i < KYBER_NUM_DOMAINS; i++)
 		sbitmap_queue_free(&kqd->domain_tokens[i]);
 	blk_stat_free_callback(kqd->cb);
@@ -850,12 +994,28 @@ static struct elevator_type kyber_sched = {
 
 static int __init kyber_init(void)
 {
-	return elv_register(&kyber_sched);
+	int ret;
+
+#ifdef CONFIG_BLK_CGROUP
+	ret = blkcg_policy_register(&blkcg_policy_kyber);
+	if (ret)
+		return ret;
+#endif
+
+	ret = elv_register(&kyber_sched);
+#ifdef CONFIG_BLK_CGROUP
+	if (ret)
+		blkcg_policy_unregister(&blkcg_policy_kyber);
+#endif
+	return ret;
 }
 
 static void __exit kyber_exit(void)
 {
 	elv_unregister(&kyber_sched);
+#ifdef CONFIG_BLK_CGROUP
+	blkcg_policy_unregister(&blkcg_policy_kyber);
+#endif
 }
 
 module_init(kyber_init);
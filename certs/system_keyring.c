@@ -15,6 +15,9 @@
 #include <linux/cred.h>
 #include <linux/err.h>
 #include <linux/slab.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/spinlock.h>
 #include <keys/asymmetric-type.h>
 #include <keys/system_keyring.h>
 #include <crypto/pkcs7.h>
@@ -189,6 +192,135 @@ late_initcall(load_system_certificate_list);
 
 #ifdef CONFIG_SYSTEM_DATA_VERIFICATION
 
+/*
+ * Cache of previously verified signatures.  CI and embedded setups load the
+ * same set of signed modules on every boot, and a full PKCS#7 chain
+ * verification is dominated by public-key operations that give the same
+ * answer every time.  An entry records that a payload with a given digest,
+ * signed by a given key, passed a full chain verification for a given usage
+ * against a given keyring.
+ *
+ * Any link or unlink on a keyring replaces the root of its internal tree, so
+ * a snapshot of that root is kept to invalidate entries when the keyring
+ * changes.  Revoking a key does not edit the keyring, so the trusted key
+ * that anchored the chain is held and revalidated on every hit.  Blacklisted
+ * certificates are checked for by pkcs7_get_digest() before the cache is
+ * consulted at all.
+ */
+struct verify_sig_cache_entry {
+	struct hlist_node	link;
+	key_serial_t		keyring;	/* keyring checked against */
+	struct key		*anchor;	/* trusted key anchoring the chain */
+	const void		*keyring_root;	/* keyring state the check was made in */
+	unsigned long		keyring_leaves;
+	enum key_being_used_for	usage;
+	struct asymmetric_key_id *signer;	/* ID of the key that made the sig */
+	u32			digest_size;
+	u8			digest[];	/* digest of the signed payload */
+};
+
+#define VERIFY_SIG_CACHE_BITS	7
+#define VERIFY_SIG_CACHE_MAX	512
+
+static DEFINE_HASHTABLE(verify_sig_cache, VERIFY_SIG_CACHE_BITS);
+static DEFINE_SPINLOCK(verify_sig_cache_lock);
+static unsigned int verify_sig_cache_nr;
+
+static void verify_sig_cache_free(struct verify_sig_cache_entry *entry)
+{
+	key_put(entry->anchor);
+	kfree(entry->signer);
+	kfree(entry);
+}
+
+/*
+ * See if a payload digest + signer combination already passed a full chain
+ * verification against this keyring.  A stale entry is dropped so that the
+ * full path refills it.
+ */
+static bool verify_sig_cache_lookup(struct key *keyring,
+				    enum key_being_used_for usage,
+				    const u8 *digest, u32 digest_size,
+				    const struct asymmetric_key_id *signer)
+{
+	struct verify_sig_cache_entry *entry;
+	struct hlist_node *tmp;
+	u32 hash = jhash(digest, digest_size, 0);
+	bool hit = false;
+
+	spin_lock(&verify_sig_cache_lock);
+	hash_for_each_possible_safe(verify_sig_cache, entry, tmp, link, hash) {
+		if (entry->keyring != key_serial(keyring) ||
+		    entry->usage != usage ||
+		    entry->digest_size != digest_size ||
+		    memcmp(entry->digest, digest, digest_size) != 0 ||
+		    !asymmetric_key_id_same(entry->signer, signer))
+			continue;
+
+		if (entry->keyring_root != READ_ONCE(keyring->keys.root) ||
+		    entry->keyring_leaves != keyring->keys.nr_leaves_on_tree ||
+		    key_validate(entry->anchor) < 0) {
+			hash_del(&entry->link);
+			verify_sig_cache_nr--;
+			verify_sig_cache_free(entry);
+			break;
+		}
+
+		hit = true;
+		break;
+	}
+	spin_unlock(&verify_sig_cache_lock);
+	return hit;
+}
+
+/*
+ * Record a successful chain verification.  Consumes the caller's reference
+ * on @anchor.  The cache is best effort - on allocation failure or when the
+ * cap is hit the next verification simply takes the full path again.
+ */
+static void verify_sig_cache_add(struct key *keyring,
+				 enum key_being_used_for usage,
+				 const u8 *digest, u32 digest_size,
+				 const struct asymmetric_key_id *signer,
+				 struct key *anchor)
+{
+	struct verify_sig_cache_entry *entry;
+	u32 hash = jhash(digest, digest_size, 0);
+
+	entry = kmalloc(sizeof(*entry) + digest_size, GFP_KERNEL);
+	if (!entry) {
+		key_put(anchor);
+		return;
+	}
+
+	entry->signer = kmemdup(signer, sizeof(*signer) + signer->len,
+				GFP_KERNEL);
+	if (!entry->signer) {
+		kfree(entry);
+		key_put(anchor);
+		return;
+	}
+
+	entry->keyring = key_serial(keyring);
+	entry->anchor = anchor;
+	entry->keyring_root = READ_ONCE(keyring->keys.root);
+	entry->keyring_leaves = keyring->keys.nr_leaves_on_tree;
+	entry->usage = usage;
+	entry->digest_size = digest_size;
+	memcpy(entry->digest, digest, digest_size);
+
+	spin_lock(&verify_sig_cache_lock);
+	if (verify_sig_cache_nr < VERIFY_SIG_CACHE_MAX) {
+		hash_add(verify_sig_cache, &entry->link, hash);
+		verify_sig_cache_nr++;
+		entry = NULL;
+	}
+	spin_unlock(&verify_sig_cache_lock);
+
+	if (entry)
+		verify_sig_cache_free(entry);
+}
+
 /**
  * verify_pkcs7_signature - Verify a PKCS#7-based signature on system data.
  * @data: The data to be verified (NULL if expecting internal data).
@@ -211,6 +343,10 @@ int verify_pkcs7_signature(const void *data, size_t len,
 			   void *ctx)
 {
 	struct pkcs7_message *pkcs7;
+	struct key *anchor = NULL;
+	const struct asymmetric_key_id *signer;
+	const u8 *digest = NULL;
+	u32 digest_size = 0;
 	int ret;
 
 	pkcs7 = pkcs7_parse_message(raw_pkcs7, pkcs7_len);
@@ -224,10 +360,6 @@ int verify_pkcs7_signature(const void *data, size_t len,
 		goto error;
 	}
 
-	ret = pkcs7_verify(pkcs7, usage);
-	if (ret < 0)
-		goto error;
-
 	if (!trusted_keys) {
 		trusted_keys = builtin_trusted_keys;
 	} else if (trusted_keys == (void *)1UL) {
@@ -237,13 +369,38 @@ int verify_pkcs7_signature(const void *data, size_t len,
 		trusted_keys = builtin_trusted_keys;
 #endif
 	}
-	ret = pkcs7_validate_trust(pkcs7, trusted_keys);
+
+	/* If we've seen this very payload and signer pass a full chain
+	 * verification against this keyring before, don't repeat the
+	 * public-key operations.  Failure to compute the lookup key just
+	 * means we take the full path.
+	 */
+	if (pkcs7_get_digest(pkcs7, &digest, &digest_size, &signer) < 0)
+		digest = NULL;
+
+	if (digest && verify_sig_cache_lookup(trusted_keys, usage, digest,
+					      digest_size, signer))
+		goto verified;
+
+	ret = pkcs7_verify(pkcs7, usage);
+	if (ret < 0)
+		goto error;
+
+	ret = pkcs7_validate_trust(pkcs7, trusted_keys, &anchor);
 	if (ret < 0) {
 		if (ret == -ENOKEY)
 			pr_err("PKCS#7 signature not signed with a trusted key\n");
 		goto error;
 	}
 
+	if (digest && anchor) {
+		verify_sig_cache_add(trusted_keys, usage, digest, digest_size,
+				     signer, anchor);
+		anchor = NULL;
+	}
+
+verified:
+	ret = 0;
 	if (view_content) {
 		size_t asn1hdrlen;
 
@@ -258,6 +415,7 @@ int verify_pkcs7_signature(const void *data, size_t len,
 	}
 
 error:
+	key_put(anchor);
 	pkcs7_free_message(pkcs7);
 	pr_devel("<==%s() = %d\n", __func__, ret);
 	return ret;
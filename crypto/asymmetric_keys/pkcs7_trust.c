@@ -25,7 +25,8 @@
  */
 static int pkcs7_validate_trust_one(struct pkcs7_message *pkcs7,
 				    struct pkcs7_signed_info *sinfo,
-				    struct key *trust_keyring)
+				    struct key *trust_keyring,
+				    struct key **_anchor)
 {
 	struct public_key_signature *sig = sinfo->sig;
 	struct x509_certificate *x509, *last = NULL, *p;
@@ -117,14 +118,20 @@ static int pkcs7_validate_trust_one(struct pkcs7_message *pkcs7,
 
 matched:
 	ret = verify_signature(key, sig);
-	key_put(key);
 	if (ret < 0) {
+		key_put(key);
 		if (ret == -ENOMEM)
 			return ret;
 		kleave(" = -EKEYREJECTED [verify %d]", ret);
 		return -EKEYREJECTED;
 	}
 
+	/* Hand the trusted key that anchored the chain back to the caller */
+	if (_anchor && !*_anchor)
+		*_anchor = key;
+	else
+		key_put(key);
+
 verified:
 	if (x509) {
 		x509->verified = true;
@@ -139,10 +146,15 @@ verified:
  * pkcs7_validate_trust - Validate PKCS#7 trust chain
  * @pkcs7: The PKCS#7 certificate to validate
  * @trust_keyring: Signing certificates to use as starting points
+ * @_anchor: Where to return the trusted key that anchored a chain (or NULL)
  *
  * Validate that the certificate chain inside the PKCS#7 message intersects
  * keys we already know and trust.
  *
+ * If @_anchor is given, a reference to the key in @trust_keyring against
+ * which the first successfully validated chain was checked is returned
+ * through it.  The caller must key_put() it.
+ *
  * Returns, in order of descending priority:
  *
  *  (*) -EKEYREJECTED if a signature failed to match for which we have a valid
@@ -160,7 +172,8 @@ verified:
  * May also return -ENOMEM.
  */
 int pkcs7_validate_trust(struct pkcs7_message *pkcs7,
-			 struct key *trust_keyring)
+			 struct key *trust_keyring,
+			 struct key **_anchor)
 {
 	struct pkcs7_signed_info *sinfo;
 	struct x509_certificate *p;
@@ -171,7 +184,8 @@ int pkcs7_validate_trust(struct pkcs7_message *pkcs7,
 		p->seen = false;
 
 	for (sinfo = pkcs7->signed_infos; sinfo; sinfo = sinfo->next) {
-		ret = pkcs7_validate_trust_one(pkcs7, sinfo, trust_keyring);
+		ret = pkcs7_validate_trust_one(pkcs7, sinfo, trust_keyring,
+					       _anchor);
 		switch (ret) {
 		case -ENOKEY:
 			continue;
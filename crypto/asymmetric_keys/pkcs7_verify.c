@@ -303,11 +303,13 @@ static int pkcs7_verify_one(struct pkcs7_message *pkcs7,
 	kenter(",%u", sinfo->index);
 
 	/* First of all, digest the data in the PKCS#7 message and the
-	 * signed information block
+	 * signed information block - unless pkcs7_get_digest() already did.
 	 */
-	ret = pkcs7_digest(pkcs7, sinfo);
-	if (ret < 0)
-		return ret;
+	if (!sinfo->sig->digest) {
+		ret = pkcs7_digest(pkcs7, sinfo);
+		if (ret < 0)
+			return ret;
+	}
 
 	/* Find the key for the signature if there is one */
 	ret = pkcs7_find_key(pkcs7, sinfo);
@@ -467,3 +469,52 @@ int pkcs7_supply_detached_data(struct pkcs7_message *pkcs7,
 	pkcs7->data_len = datalen;
 	return 0;
 }
+
+/**
+ * pkcs7_get_digest - Get the digest and signer ID of a PKCS#7 message
+ * @pkcs7: The PKCS#7 message
+ * @buf: Where to return a pointer to the message digest
+ * @len: Where to return the length of the digest
+ * @signer: Where to return a pointer to the signer's key ID
+ *
+ * Digest the data in a single-signer PKCS#7 message and return the digest,
+ * its size and the ID of the key that made the signature.  This gives a
+ * caller that keeps a cache of verification results a stable identity for
+ * the signed payload without performing any public-key operations.  The
+ * returned pointers refer into @pkcs7 and are only valid until the message
+ * is freed.
+ *
+ * Returns 0 on success, -EBADMSG if the message does not carry exactly one
+ * signed information block, -EKEYREJECTED if any certificate in the message
+ * is blacklisted, -ENOKEY if the signer cannot be identified or an error
+ * from digesting the message.
+ */
+int pkcs7_get_digest(struct pkcs7_message *pkcs7, const u8 **buf, u32 *len,
+		     const struct asymmetric_key_id **signer)
+{
+	struct pkcs7_signed_info *sinfo = pkcs7->signed_infos;
+	struct x509_certificate *p;
+	int ret;
+
+	if (!sinfo || sinfo->next)
+		return -EBADMSG;
+
+	for (p = pkcs7->certs; p; p = p->next)
+		if (p->blacklisted)
+			return -EKEYREJECTED;
+
+	if (!sinfo->sig->auth_ids[0])
+		return -ENOKEY;
+
+	if (!sinfo->sig->digest) {
+		ret = pkcs7_digest(pkcs7, sinfo);
+		if (ret < 0)
+			return ret;
+	}
+
+	*buf = sinfo->sig->digest;
+	*len = sinfo->sig->digest_size;
+	*signer = sinfo->sig->auth_ids[0];
+	return 0;
+}
+EXPORT_SYMBOL_GPL(pkcs7_get_digest);
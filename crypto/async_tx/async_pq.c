@@ -266,6 +266,54 @@ async_gen_syndrome(struct page **blocks, unsigned int offset, int disks,
 }
 EXPORT_SYMBOL_GPL(async_gen_syndrome);
 
+/**
+ * async_gen_syndrome_batch - compute a queue of syndromes with one completion
+ * @ops: array of gen_syndrome operations to perform
+ * @nr_ops: number of operations in @ops
+ * @submit: submission / completion modifiers
+ *
+ * honored flags: ASYNC_TX_ACK, ASYNC_TX_PQ_XOR_DST
+ *
+ * Each entry follows the async_gen_syndrome() rules for its @blocks
+ * array (P at blocks[disks-2], Q at blocks[disks-1]).  The operations
+ * are chained into a single descriptor train with the ack and callback
+ * suppressed on the intermediate descriptors, so only the descriptor of
+ * the last operation raises an interrupt and runs @submit's callback.
+ * As with async_gen_syndrome() the caller is responsible for issuing
+ * the pending descriptors afterwards.
+ */
+struct dma_async_tx_descriptor *
+async_gen_syndrome_batch(struct async_pq_batch_op *ops, int nr_ops,
+			 struct async_submit_ctl *submit)
+{
+	struct async_submit_ctl chain;
+	int i;
+
+	BUG_ON(nr_ops < 1);
+
+	/* intermediate operations complete silently inside the train */
+	chain = *submit;
+	chain.cb_fn = NULL;
+	chain.cb_param = NULL;
+	chain.flags &= ~ASYNC_TX_ACK;
+
+	for (i = 0; i < nr_ops - 1; i++)
+		chain.depend_tx = async_gen_syndrome(ops[i].blocks,
+						     ops[i].offset,
+						     ops[i].disks,
+						     ops[i].len, &chain);
+
+	/* the final operation carries the caller's callback and flags */
+	chain.flags = submit->flags;
+	chain.cb_fn = submit->cb_fn;
+	chain.cb_param = submit->cb_param;
+
+	i = nr_ops - 1;
+	return async_gen_syndrome(ops[i].blocks, ops[i].offset, ops[i].disks,
+				  ops[i].len, &chain);
+}
+EXPORT_SYMBOL_GPL(async_gen_syndrome_batch);
+
 static inline struct dma_chan *
 pq_val_chan(struct async_submit_ctl *submit, struct page **blocks, int disks, size_t len)
 {
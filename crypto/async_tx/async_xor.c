@@ -31,6 +31,12 @@
 #include <linux/raid/xor.h>
 #include <linux/async_tx.h>
 
+/* strip size for the cache-blocked synchronous path: one strip of the
+ * destination plus a strip of each source in a MAX_XOR_BLOCKS group must
+ * fit in the first-level cache
+ */
+#define SYNC_XOR_STRIP 4096
+
 /* do_async_xor - dma map the pages and perform the xor with an engine */
 static __async_inline struct dma_async_tx_descriptor *
 do_async_xor(struct dma_chan *chan, struct dmaengine_unmap_data *unmap,
@@ -135,14 +141,34 @@ do_sync_xor(struct page *dest, struct page **src_list, unsigned int offset,
 	if (submit->flags & ASYNC_TX_XOR_ZERO_DST)
 		memset(dest_buf, 0, len);
 
-	while (src_cnt > 0) {
-		/* process up to 'MAX_XOR_BLOCKS' sources */
-		xor_src_cnt = min(src_cnt, MAX_XOR_BLOCKS);
-		xor_blocks(xor_src_cnt, len, dest_buf, &srcs[src_off]);
+	while (len > 0) {
+		size_t chunk = len;
+		int chunk_src_cnt = src_cnt;
+
+		/* when more than one xor_blocks() call is needed the
+		 * destination is read back once per group of sources.  Work
+		 * in strips small enough that the strip of the destination
+		 * stays cached across the groups instead of being streamed
+		 * through the cache once per group.
+		 */
+		if (src_cnt > MAX_XOR_BLOCKS)
+			chunk = min_t(size_t, chunk, SYNC_XOR_STRIP);
+
+		src_off = 0;
+		while (chunk_src_cnt > 0) {
+			/* process up to 'MAX_XOR_BLOCKS' sources */
+			xor_src_cnt = min(chunk_src_cnt, MAX_XOR_BLOCKS);
+			xor_blocks(xor_src_cnt, chunk, dest_buf, &srcs[src_off]);
+
+			/* drop completed sources */
+			chunk_src_cnt -= xor_src_cnt;
+			src_off += xor_src_cnt;
+		}
 
-		/* drop completed sources */
-		src_cnt -= xor_src_cnt;
-		src_off += xor_src_cnt;
+		dest_buf += chunk;
+		for (i = 0; i < src_cnt; i++)
+			srcs[i] += chunk;
+		len -= chunk;
 	}
 
 	async_tx_sync_epilog(submit);
@@ -233,6 +259,54 @@ async_xor(struct page *dest, struct page **src_list, unsigned int offset,
 }
 EXPORT_SYMBOL_GPL(async_xor);
 
+/**
+ * async_xor_batch - xor a queue of block sets with one aggregate completion
+ * @ops: array of xor operations to perform
+ * @nr_ops: number of operations in @ops
+ * @submit: submission / completion modifiers
+ *
+ * honored flags: ASYNC_TX_ACK, ASYNC_TX_XOR_ZERO_DST, ASYNC_TX_XOR_DROP_DST
+ *
+ * The operations are chained into a single descriptor train: the
+ * intermediate descriptors are submitted with the ack and callback
+ * suppressed, the same way do_async_xor() suppresses them for the links
+ * of a multi-descriptor xor, so only the descriptor of the last
+ * operation raises an interrupt and runs @submit's callback.  Operations
+ * that fall back to the synchronous path execute in submission order
+ * relative to the rest of the train.  As with async_xor() the caller is
+ * responsible for issuing the pending descriptors afterwards.
+ */
+struct dma_async_tx_descriptor *
+async_xor_batch(struct async_xor_batch_op *ops, int nr_ops,
+		struct async_submit_ctl *submit)
+{
+	struct async_submit_ctl chain;
+	int i;
+
+	BUG_ON(nr_ops < 1);
+
+	/* intermediate operations complete silently inside the train */
+	chain = *submit;
+	chain.cb_fn = NULL;
+	chain.cb_param = NULL;
+	chain.flags &= ~ASYNC_TX_ACK;
+
+	for (i = 0; i < nr_ops - 1; i++)
+		chain.depend_tx = async_xor(ops[i].dest, ops[i].src_list,
+					    ops[i].offset, ops[i].src_cnt,
+					    ops[i].len, &chain);
+
+	/* the final operation carries the caller's callback and flags */
+	chain.flags = submit->flags;
+	chain.cb_fn = submit->cb_fn;
+	chain.cb_param = submit->cb_param;
+
+	i = nr_ops - 1;
+	return async_xor(ops[i].dest, ops[i].src_list, ops[i].offset,
+			 ops[i].src_cnt, ops[i].len, &chain);
+}
+EXPORT_SYMBOL_GPL(async_xor_batch);
+
 static int page_is_zero(struct page *p, unsigned int offset, size_t len)
 {
 	return !memchr_inv(page_address(p) + offset, 0, len);
@@ -105,6 +105,11 @@ struct buf {
 	struct request *rq;
 };
 
+/* per-request state, in the blk-mq request pdu */
+struct aoe_req {
+	unsigned long nr_bios;
+};
+
 enum frame_flags {
 	FFL_PROBE = 1,
 };
@@ -164,6 +169,8 @@ struct aoedev {
 	struct gendisk *gd;
 	struct dentry *debugfs;
 	struct request_queue *blkq;
+	struct blk_mq_tag_set tag_set;
+	struct list_head rq_list; /* queued requests not yet in frames */
 	struct hd_geometry geo;
 	sector_t ssize;
 	struct timer_list timer;
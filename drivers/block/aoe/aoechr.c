@@ -6,6 +6,7 @@
 
 #include <linux/hdreg.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/completion.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
@@ -8,6 +8,7 @@
 #include <linux/slab.h>
 #include <linux/hdreg.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/skbuff.h>
 #include <linux/netdevice.h>
 #include <linux/genhd.h>
@@ -366,12 +367,11 @@ ata_rw_frameinit(struct frame *f)
 }
 
 static int
-aoecmd_ata_rw(struct aoedev *d)
+aoecmd_ata_rw(struct aoedev *d, struct sk_buff_head *queue)
 {
 	struct frame *f;
 	struct buf *buf;
 	struct sk_buff *skb;
-	struct sk_buff_head queue;
 
 	buf = nextbuf(d);
 	if (buf == NULL)
@@ -399,9 +399,7 @@ aoecmd_ata_rw(struct aoedev *d)
 	skb = skb_clone(f->skb, GFP_ATOMIC);
 	if (skb) {
 		f->sent = ktime_get();
-		__skb_queue_head_init(&queue);
-		__skb_queue_tail(&queue, skb);
-		aoenet_xmit(&queue);
+		__skb_queue_tail(queue, skb);
 	}
 	return 1;
 }
@@ -813,7 +811,7 @@ rexmit_timer(struct timer_list *timer)
 out:
 	if ((d->flags & DEVFL_KICKME) && d->blkq) {
 		d->flags &= ~DEVFL_KICKME;
-		d->blkq->request_fn(d->blkq);
+		aoecmd_work(d);
 	}
 
 	d->timer.expires = jiffies + TIMERTICK;
@@ -847,6 +845,7 @@ nextbuf(struct aoedev *d)
 {
 	struct request *rq;
 	struct request_queue *q;
+	struct aoe_req *req;
 	struct buf *buf;
 	struct bio *bio;
 
@@ -857,13 +856,17 @@ nextbuf(struct aoedev *d)
 		return d->ip.buf;
 	rq = d->ip.rq;
 	if (rq == NULL) {
-		rq = blk_peek_request(q);
+		rq = list_first_entry_or_null(&d->rq_list, struct request,
+						queuelist);
 		if (rq == NULL)
 			return NULL;
-		blk_start_request(rq);
+		list_del_init(&rq->queuelist);
+		blk_mq_start_request(rq);
 		d->ip.rq = rq;
 		d->ip.nxbio = rq->bio;
-		rq->special = (void *) rqbiocnt(rq);
+
+		req = blk_mq_rq_to_pdu(rq);
+		req->nr_bios = rqbiocnt(rq);
 	}
 	buf = mempool_alloc(d->bufpool, GFP_ATOMIC);
 	if (buf == NULL) {
@@ -883,9 +886,16 @@ nextbuf(struct aoedev *d)
 void
 aoecmd_work(struct aoedev *d)
 {
+	struct sk_buff_head queue;
+
+	__skb_queue_head_init(&queue);
 	rexmit_deferred(d);
-	while (aoecmd_ata_rw(d))
+	/* collect the frames for all queued requests and hand them to the
+	 * transmit thread in one batch
+	 */
+	while (aoecmd_ata_rw(d, &queue))
 		;
+	aoenet_xmit(&queue);
 }
 
 /* this function performs work that has been deferred until sleeping is OK
@@ -1044,6 +1054,7 @@ aoe_end_request(struct aoedev *d, struct request *rq, int fastfail)
 	struct bio *bio;
 	int bok;
 	struct request_queue *q;
+	blk_status_t err = BLK_STS_OK;
 
 	q = d->blkq;
 	if (rq == d->ip.rq)
@@ -1051,26 +1062,26 @@ aoe_end_request(struct aoedev *d, struct request *rq, int fastfail)
 	do {
 		bio = rq->bio;
 		bok = !fastfail && !bio->bi_status;
-	} while (__blk_end_request(rq, bok ? BLK_STS_OK : BLK_STS_IOERR, bio->bi_iter.bi_size));
+		err = bok ? BLK_STS_OK : BLK_STS_IOERR;
+	} while (blk_update_request(rq, err, bio->bi_iter.bi_size));
+
+	__blk_mq_end_request(rq, err);
 
 	/* cf. http://lkml.org/lkml/2006/10/31/28 */
 	if (!fastfail)
-		__blk_run_queue(q);
+		blk_mq_run_hw_queues(q, true);
 }
 
 static void
 aoe_end_buf(struct aoedev *d, struct buf *buf)
 {
-	struct request *rq;
-	unsigned long n;
+	struct request *rq = buf->rq;
+	struct aoe_req *req = blk_mq_rq_to_pdu(rq);
 
 	if (buf == d->ip.buf)
 		d->ip.buf = NULL;
-	rq = buf->rq;
 	mempool_free(buf, d->bufpool);
-	n = (unsigned long) rq->special;
-	rq->special = (void *) --n;
-	if (n == 0)
+	if (--req->nr_bios == 0)
 		aoe_end_request(d, rq, 0);
 }
 
@@ -6,6 +6,7 @@
 
 #include <linux/hdreg.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/netdevice.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
@@ -159,22 +160,22 @@ dummy_timer(struct timer_list *t)
 static void
 aoe_failip(struct aoedev *d)
 {
+	struct aoe_req *req;
 	struct request *rq;
 	struct bio *bio;
-	unsigned long n;
 
 	aoe_failbuf(d, d->ip.buf);
 
 	rq = d->ip.rq;
 	if (rq == NULL)
 		return;
+	req = blk_mq_rq_to_pdu(rq);
 	while ((bio = d->ip.nxbio)) {
 		bio->bi_status = BLK_STS_IOERR;
 		d->ip.nxbio = bio->bi_next;
-		n = (unsigned long) rq->special;
-		rq->special = (void *) --n;
+		req->nr_bios--;
 	}
-	if ((unsigned long) rq->special == 0)
+	if (req->nr_bios == 0)
 		aoe_end_request(d, rq, 0);
 }
 
@@ -225,8 +226,11 @@ aoedev_downdev(struct aoedev *d)
 
 	/* fast fail all pending I/O */
 	if (d->blkq) {
-		while ((rq = blk_peek_request(d->blkq))) {
-			blk_start_request(rq);
+		/* UP is cleared, so new requests will not be queued */
+		while ((rq = list_first_entry_or_null(&d->rq_list,
+					struct request, queuelist))) {
+			list_del_init(&rq->queuelist);
+			blk_mq_start_request(rq);
 			aoe_end_request(d, rq, 1);
 		}
 	}
@@ -279,6 +283,7 @@ freedev(struct aoedev *d)
 		del_gendisk(d->gd);
 		put_disk(d->gd);
 		blk_cleanup_queue(d->blkq);
+		blk_mq_free_tag_set(&d->tag_set);
 	}
 	t = d->targets;
 	e = t + d->ntargets;
@@ -474,6 +479,7 @@ aoedev_by_aoeaddr(ulong maj, int min, int do_alloc)
 	for (i = 0; i < NFACTIVE; i++)
 		INIT_LIST_HEAD(&d->factive[i]);
 	INIT_LIST_HEAD(&d->rexmitq);
+	INIT_LIST_HEAD(&d->rq_list);
 	d->sysminor = sysminor;
 	d->aoemajor = maj;
 	d->aoeminor = min;
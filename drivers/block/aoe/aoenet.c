@@ -7,6 +7,7 @@
 #include <linux/gfp.h>
 #include <linux/hdreg.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/netdevice.h>
 #include <linux/moduleparam.h>
 #include <net/net_namespace.h>
@@ -112,16 +113,18 @@ set_aoe_iflist(const char __user *user_str, size_t size)
 void
 aoenet_xmit(struct sk_buff_head *queue)
 {
-	struct sk_buff *skb, *tmp;
 	ulong flags;
 
-	skb_queue_walk_safe(queue, skb, tmp) {
-		__skb_unlink(skb, queue);
-		spin_lock_irqsave(&txlock, flags);
-		skb_queue_tail(&skbtxq, skb);
-		spin_unlock_irqrestore(&txlock, flags);
-		wake_up(&txwq);
-	}
+	if (skb_queue_empty(queue))
+		return;
+
+	/* all skbtxq accesses are serialized by txlock, so the whole batch
+	 * can go over with one lock round trip and one wakeup
+	 */
+	spin_lock_irqsave(&txlock, flags);
+	skb_queue_splice_tail_init(queue, &skbtxq);
+	spin_unlock_irqrestore(&txlock, flags);
+	wake_up(&txwq);
 }
 
 /*
@@ -200,6 +200,13 @@ void drbd_bm_unlock(struct drbd_device *device)
 /* pages marked with this "HINT" will be considered for writeout
  * on activity log transactions */
 #define BM_PAGE_HINT_WRITEOUT	27
+/* this page may contain set (out-of-sync) bits.
+ * Used as a coarse dirty log by the resync scanner: a page without this
+ * flag is known to be all clean, and __bm_find_next() can skip it without
+ * mapping and scanning its words.  Set wherever bits may get set, cleared
+ * only by a scan that found the whole page clean.  Both happen under
+ * bm_lock, a stale-set flag merely costs one superfluous page scan. */
+#define BM_PAGE_MAY_BE_SET	26
 
 /* store_page_idx uses non-atomic assignment. It is only used directly after
  * allocating the page.  All other bm_set_page_* and bm_clear_page_* need to
@@ -299,6 +306,21 @@ static void bm_set_page_lazy_writeout(struct page *page)
 	set_bit(BM_PAGE_LAZY_WRITEOUT, &page_private(page));
 }
 
+static void bm_set_page_may_be_set(struct page *page)
+{
+	set_bit(BM_PAGE_MAY_BE_SET, &page_private(page));
+}
+
+static void bm_clear_page_may_be_set(struct page *page)
+{
+	clear_bit(BM_PAGE_MAY_BE_SET, &page_private(page));
+}
+
+static int bm_test_page_may_be_set(struct page *page)
+{
+	return test_bit(BM_PAGE_MAY_BE_SET, &page_private(page));
+}
+
 static int bm_test_page_lazy_writeout(struct page *page)
 {
 	return test_bit(BM_PAGE_LAZY_WRITEOUT, &page_private(page));
@@ -428,6 +450,8 @@ static struct page **bm_realloc_pages(struct drbd_bitmap *b, unsigned long want)
 			/* we want to know which page it is
 			 * from the endio handlers */
 			bm_store_page_idx(page, i);
+			/* content is undefined until set or read in */
+			bm_set_page_may_be_set(page);
 			new_pages[i] = page;
 		}
 	} else {
@@ -569,26 +593,41 @@ static unsigned long bm_count_bits(struct drbd_bitmap *b)
 {
 	unsigned long *p_addr;
 	unsigned long bits = 0;
+	unsigned long weight;
 	unsigned long mask = (1UL << (b->bm_bits & BITS_PER_LONG_MASK)) -1;
 	int idx, last_word;
 
+	/* While we are scanning everything anyway, refresh the per page
+	 * "may contain set bits" hints, so a following resync does not
+	 * need to look at the clean pages even once. */
+
 	/* all but last page */
 	for (idx = 0; idx < b->bm_number_of_pages - 1; idx++) {
 		p_addr = __bm_map_pidx(b, idx);
-		bits += bitmap_weight(p_addr, BITS_PER_PAGE);
+		weight = bitmap_weight(p_addr, BITS_PER_PAGE);
 		__bm_unmap(p_addr);
+		if (weight)
+			bm_set_page_may_be_set(b->bm_pages[idx]);
+		else
+			bm_clear_page_may_be_set(b->bm_pages[idx]);
+		bits += weight;
 		cond_resched();
 	}
 	/* last (or only) page */
 	last_word = ((b->bm_bits - 1) & BITS_PER_PAGE_MASK) >> LN2_BPL;
 	p_addr = __bm_map_pidx(b, idx);
-	bits += bitmap_weight(p_addr, last_word * BITS_PER_LONG);
+	weight = bitmap_weight(p_addr, last_word * BITS_PER_LONG);
 	p_addr[last_word] &= cpu_to_lel(mask);
-	bits += hweight_long(p_addr[last_word]);
+	weight += hweight_long(p_addr[last_word]);
 	/* 32bit arch, may have an unused padding long */
 	if (BITS_PER_LONG == 32 && (last_word & 1) == 0)
 		p_addr[last_word+1] = 0;
 	__bm_unmap(p_addr);
+	if (weight)
+		bm_set_page_may_be_set(b->bm_pages[idx]);
+	else
+		bm_clear_page_may_be_set(b->bm_pages[idx]);
+	bits += weight;
 	return bits;
 }
 
@@ -618,6 +657,8 @@ static void bm_memset(struct drbd_bitmap *b, size_t offset, int c, size_t len)
 			memset(bm, c, do_now * sizeof(long));
 		bm_unmap(p_addr);
 		bm_set_page_need_writeout(b->bm_pages[idx]);
+		if (c)
+			bm_set_page_may_be_set(b->bm_pages[idx]);
 		offset += do_now;
 	}
 }
@@ -854,6 +895,7 @@ void drbd_bm_merge_lel(struct drbd_device *device, size_t offset, size_t number,
 		}
 		bm_unmap(p_addr);
 		bm_set_page_need_writeout(b->bm_pages[idx]);
+		bm_set_page_may_be_set(b->bm_pages[idx]);
 	}
 	/* with 32bit <-> 64bit cross-platform connect
 	 * this is only correct for current usage,
@@ -1279,8 +1321,18 @@ static unsigned long __bm_find_next(struct drbd_device *device, unsigned long bm
 		bm_fo = DRBD_END_OF_BITMAP;
 	} else {
 		while (bm_fo < b->bm_bits) {
+			struct page *page = b->bm_pages[bm_bit_to_page_idx(b, bm_fo)];
+
 			/* bit offset of the first bit in the page */
 			bit_offset = bm_fo & ~BITS_PER_PAGE_MASK;
+
+			/* looking for a set bit in a page known to be all
+			 * clean: don't even map it */
+			if (!find_zero_bit && !bm_test_page_may_be_set(page)) {
+				bm_fo = bit_offset + PAGE_SIZE*8;
+				continue;
+			}
+
 			p_addr = __bm_map_pidx(b, bm_bit_to_page_idx(b, bm_fo));
 
 			if (find_zero_bit)
@@ -1297,6 +1349,11 @@ static unsigned long __bm_find_next(struct drbd_device *device, unsigned long bm
 					break;
 				goto found;
 			}
+			/* we scanned the whole page without finding a set
+			 * bit; if we started at its first bit, remember the
+			 * page as clean so the next pass can skip it */
+			if (!find_zero_bit && bm_fo == bit_offset)
+				bm_clear_page_may_be_set(page);
 			bm_fo = bit_offset + PAGE_SIZE*8;
 		}
 		bm_fo = DRBD_END_OF_BITMAP;
@@ -1381,8 +1438,10 @@ static int __bm_change_bits_to(struct drbd_device *device, const unsigned long s
 				__bm_unmap(p_addr);
 			if (c < 0)
 				bm_set_page_lazy_writeout(b->bm_pages[last_page_nr]);
-			else if (c > 0)
+			else if (c > 0) {
 				bm_set_page_need_writeout(b->bm_pages[last_page_nr]);
+				bm_set_page_may_be_set(b->bm_pages[last_page_nr]);
+			}
 			changed_total += c;
 			c = 0;
 			p_addr = __bm_map_pidx(b, page_nr);
@@ -1397,8 +1456,10 @@ static int __bm_change_bits_to(struct drbd_device *device, const unsigned long s
 		__bm_unmap(p_addr);
 	if (c < 0)
 		bm_set_page_lazy_writeout(b->bm_pages[last_page_nr]);
-	else if (c > 0)
+	else if (c > 0) {
 		bm_set_page_need_writeout(b->bm_pages[last_page_nr]);
+		bm_set_page_may_be_set(b->bm_pages[last_page_nr]);
+	}
 	changed_total += c;
 	b->bm_set += changed_total;
 	return changed_total;
@@ -1465,6 +1526,7 @@ static inline void bm_set_full_words_within_one_page(struct drbd_bitmap *b,
 		 * remote bitmap as well, and is reconstructed during the next
 		 * bitmap exchange, if lost locally due to a crash. */
 		bm_set_page_lazy_writeout(b->bm_pages[page_nr]);
+		bm_set_page_may_be_set(b->bm_pages[page_nr]);
 		b->bm_set += changed;
 	}
 }
@@ -576,7 +576,19 @@ static int drbd_rs_number_requests(struct drbd_device *device)
 		number = drbd_rs_controller(device, sect_in) >> (BM_BLOCK_SHIFT - 9);
 		device->c_sync_rate = number * HZ * (BM_BLOCK_SIZE / 1024) / SLEEP_TIME;
 	} else {
-		device->c_sync_rate = rcu_dereference(device->ldev->disk_conf)->resync_rate;
+		struct disk_conf *dc = rcu_dereference(device->ldev->disk_conf);
+
+		/* The fixed resync_rate is there to protect application I/O
+		 * from resync competition.  As long as there is no
+		 * application I/O at all, that protection buys nothing:
+		 * let the resync speed up to c_max_rate until the
+		 * application gets busy again. */
+		if (dc->c_max_rate > dc->resync_rate &&
+		    atomic_read(&device->ap_bio_cnt) == 0 &&
+		    atomic_read(&device->ap_actlog_cnt) == 0)
+			device->c_sync_rate = dc->c_max_rate;
+		else
+			device->c_sync_rate = dc->resync_rate;
 		number = SLEEP_TIME * device->c_sync_rate  / ((BM_BLOCK_SIZE / 1024) * HZ);
 	}
 	rcu_read_unlock();
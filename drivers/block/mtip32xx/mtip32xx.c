@@ -540,6 +540,91 @@ static void mtip_complete_command(struct mtip_cmd *cmd, blk_status_t status)
 	blk_mq_complete_request(req);
 }
 
+/*
+ * Atomically read and clear the completed register of a slot group.
+ *
+ * Completions are harvested from the interrupt handler, from blk-mq poll
+ * and from the taskfile error handler, so the read/clear cycle on the
+ * hardware register has to be a critical section: whoever clears a bit
+ * owns the completion of the corresponding command.
+ */
+static u32 mtip_claim_completed(struct mtip_port *port, int group)
+{
+	unsigned long flags;
+	u32 completed;
+
+	spin_lock_irqsave(&port->completed_lock[group], flags);
+	completed = readl(port->completed[group]);
+	if (completed)
+		writel(completed, port->completed[group]);
+	spin_unlock_irqrestore(&port->completed_lock[group], flags);
+
+	return completed;
+}
+
+struct mtip_tfe_data {
+	struct driver_data *dd;
+	unsigned long *tagaccum;
+	char *fail_reason;
+	int fail_all_ncq_write;
+	int fail_all_ncq_cmds;
+};
+
+/*
+ * Decide the fate of one in-flight command after a taskfile error:
+ * fail it, re-issue it to the hardware, or retire it.  Called via
+ * blk_mq_tagset_busy_iter so only tags blk-mq considers in flight are
+ * ever touched; idle tags carry stale command state.
+ */
+static void mtip_handle_tfe_cmd(struct request *req, void *data,
+				bool reserved)
+{
+	struct mtip_tfe_data *tfe = data;
+	struct driver_data *dd = tfe->dd;
+	struct mtip_cmd *cmd = blk_mq_rq_to_pdu(req);
+	struct host_to_dev_fis *fis = (struct host_to_dev_fis *)cmd->command;
+	int reissue = 1;
+
+	if (!blk_mq_request_started(req))
+		return;
+
+	/* Should re-issue? */
+	if (reserved || fis->command == ATA_CMD_SET_FEATURES)
+		reissue = 0;
+	else if (tfe->fail_all_ncq_cmds ||
+		 (tfe->fail_all_ncq_write &&
+		  fis->command == ATA_CMD_FPDMA_WRITE)) {
+		dev_warn(&dd->pdev->dev,
+			"  Fail: %s w/tag %d [%s].\n",
+			fis->command == ATA_CMD_FPDMA_WRITE ?
+				"write" : "read",
+			req->tag,
+			tfe->fail_reason != NULL ?
+				tfe->fail_reason : "unknown");
+		mtip_complete_command(cmd, BLK_STS_MEDIUM);
+		return;
+	}
+
+	/*
+	 * First check if this command has
+	 *  exceeded its retries.
+	 */
+	if (reissue && (cmd->retries-- > 0)) {
+
+		set_bit(req->tag, tfe->tagaccum);
+
+		/* Re-issue the command. */
+		mtip_issue_ncq_command(dd->port, req->tag);
+
+		return;
+	}
+
+	/* Retire a command that will not be reissued */
+	dev_warn(&dd->pdev->dev, "retiring tag %d\n", req->tag);
+
+	mtip_complete_command(cmd, BLK_STS_IOERR);
+}
+
 /*
  * Handle an error.
  *
@@ -550,11 +635,11 @@ static void mtip_complete_command(struct mtip_cmd *cmd, blk_status_t status)
  */
 static void mtip_handle_tfe(struct driver_data *dd)
 {
-	int group, tag, bit, reissue, rv;
+	int group, tag, bit, rv;
 	struct mtip_port *port;
 	struct mtip_cmd  *cmd;
 	u32 completed;
-	struct host_to_dev_fis *fis;
+	struct mtip_tfe_data tfe;
 	unsigned long tagaccum[SLOTBITS_IN_LONGS];
 	unsigned int cmd_cnt = 0;
 	unsigned char *buf;
@@ -577,13 +662,10 @@ static void mtip_handle_tfe(struct driver_data *dd)
 
 	/* Loop through all the groups */
 	for (group = 0; group < dd->slot_groups; group++) {
-		completed = readl(port->completed[group]);
+		completed = mtip_claim_completed(port, group);
 
 		dev_warn(&dd->pdev->dev, "g=%u, comp=%x\n", group, completed);
 
-		/* clear completed status register in the hardware.*/
-		writel(completed, port->completed[group]);
-
 		/* Process successfully completed commands */
 		for (bit = 0; bit < 32 && completed; bit++) {
 			if (!(completed & (1<<bit)))
@@ -643,56 +725,18 @@ static void mtip_handle_tfe(struct driver_data *dd)
 	/* clear the tag accumulator */
 	memset(tagaccum, 0, SLOTBITS_IN_LONGS * sizeof(long));
 
-	/* Loop through all the groups */
-	for (group = 0; group < dd->slot_groups; group++) {
-		for (bit = 0; bit < 32; bit++) {
-			reissue = 1;
-			tag = (group << 5) + bit;
-			cmd = mtip_cmd_from_tag(dd, tag);
-
-			fis = (struct host_to_dev_fis *)cmd->command;
-
-			/* Should re-issue? */
-			if (tag == MTIP_TAG_INTERNAL ||
-			    fis->command == ATA_CMD_SET_FEATURES)
-				reissue = 0;
-			else {
-				if (fail_all_ncq_cmds ||
-					(fail_all_ncq_write &&
-					fis->command == ATA_CMD_FPDMA_WRITE)) {
-					dev_warn(&dd->pdev->dev,
-					"  Fail: %s w/tag %d [%s].\n",
-					fis->command == ATA_CMD_FPDMA_WRITE ?
-						"write" : "read",
-					tag,
-					fail_reason != NULL ?
-						fail_reason : "unknown");
-					mtip_complete_command(cmd, BLK_STS_MEDIUM);
-					continue;
-				}
-			}
-
-			/*
-			 * First check if this command has
-			 *  exceeded its retries.
-			 */
-			if (reissue && (cmd->retries-- > 0)) {
-
-				set_bit(tag, tagaccum);
-
-				/* Re-issue the command. */
-				mtip_issue_ncq_command(port, tag);
-
-				continue;
-			}
-
-			/* Retire a command that will not be reissued */
-			dev_warn(&port->dd->pdev->dev,
-				"retiring tag %d\n", tag);
+	/*
+	 * Walk only the commands that are actually in flight; blk-mq
+	 * already tracks them, so there is no need to scan the whole
+	 * tag space.
+	 */
+	tfe.dd = dd;
+	tfe.tagaccum = tagaccum;
+	tfe.fail_reason = fail_reason;
+	tfe.fail_all_ncq_write = fail_all_ncq_write;
+	tfe.fail_all_ncq_cmds = fail_all_ncq_cmds;
+	blk_mq_tagset_busy_iter(&dd->tags, mtip_handle_tfe_cmd, &tfe);
 
-			mtip_complete_command(cmd, BLK_STS_IOERR);
-		}
-	}
 	print_tags(dd, "reissued (TFE)", tagaccum, cmd_cnt);
 }
 
@@ -710,8 +754,11 @@ static inline void mtip_workq_sdbfx(struct mtip_port *port, int group,
 		WARN_ON_ONCE(!completed);
 		return;
 	}
-	/* clear completed status register in the hardware.*/
-	writel(completed, port->completed[group]);
+
+	/*
+	 * The completed bits were already claimed (read and cleared) by
+	 * mtip_handle_irq, so they are ours to complete here.
+	 */
 
 	/* Process completed commands. */
 	for (bit = 0; (bit < 32) && completed; bit++) {
@@ -810,7 +857,8 @@ static inline irqreturn_t mtip_handle_irq(struct driver_data *data)
 			for (i = 0, workers = 0; i < MTIP_MAX_SLOT_GROUPS;
 									i++) {
 				twork = &dd->work[i];
-				twork->completed = readl(port->completed[i]);
+				twork->completed =
+					mtip_claim_completed(port, i);
 				if (twork->completed)
 					workers++;
 			}
@@ -3043,8 +3091,10 @@ static int mtip_hw_init(struct driver_data *dd)
 	sema_init(&dd->port->cmd_slot_unal, dd->unal_qdepth);
 
 	/* Spinlock to prevent concurrent issue */
-	for (i = 0; i < MTIP_MAX_SLOT_GROUPS; i++)
+	for (i = 0; i < MTIP_MAX_SLOT_GROUPS; i++) {
 		spin_lock_init(&dd->port->cmd_issue_lock[i]);
+		spin_lock_init(&dd->port->completed_lock[i]);
+	}
 
 	/* Set the port mmio base address. */
 	dd->port->mmio	= dd->mmio + PORT_OFFSET;
@@ -3734,12 +3784,63 @@ exit_handler:
 	return BLK_EH_RESET_TIMER;
 }
 
+static int mtip_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
+			  unsigned int hctx_idx)
+{
+	struct driver_data *dd = data;
+
+	/* Let hybrid polling sleep until the predicted completion irq. */
+	blk_mq_hctx_set_poll_irq(hctx, dd->pdev->irq);
+	return 0;
+}
+
+/*
+ * Poll for completed commands.
+ *
+ * The hardware reports completions per slot group, out of the same
+ * registers the interrupt handler reads, so every completion found is
+ * processed, not just the polled tag.  mtip_claim_completed keeps the
+ * two paths from harvesting the same bits twice.
+ */
+static int mtip_poll(struct blk_mq_hw_ctx *hctx, unsigned int tag)
+{
+	struct driver_data *dd = hctx->queue->queuedata;
+	struct mtip_port *port = dd->port;
+	int group, bit, found = 0;
+
+	if (unlikely(test_bit(MTIP_DDF_REMOVE_PENDING_BIT, &dd->dd_flag)))
+		return 0;
+
+	for (group = 0; group < dd->slot_groups; group++) {
+		u32 completed = mtip_claim_completed(port, group);
+		int cmdtag;
+
+		for (bit = 0; (bit < 32) && completed; bit++, completed >>= 1) {
+			if (!(completed & 0x01))
+				continue;
+
+			cmdtag = (group << 5) | bit;
+
+			/* skip internal command slot. */
+			if (unlikely(cmdtag == MTIP_TAG_INTERNAL))
+				continue;
+
+			mtip_complete_command(mtip_cmd_from_tag(dd, cmdtag), 0);
+			found++;
+		}
+	}
+
+	return found;
+}
+
 static const struct blk_mq_ops mtip_mq_ops = {
 	.queue_rq	= mtip_queue_rq,
+	.init_hctx	= mtip_init_hctx,
 	.init_request	= mtip_init_cmd,
 	.exit_request	= mtip_free_cmd,
 	.complete	= mtip_softirq_done_fn,
 	.timeout        = mtip_cmd_timeout,
+	.poll		= mtip_poll,
 };
 
 /*
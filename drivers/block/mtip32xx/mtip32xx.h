@@ -440,6 +440,12 @@ struct mtip_port {
 
 	/* Spinlock for working around command-issue bug. */
 	spinlock_t cmd_issue_lock[MTIP_MAX_SLOT_GROUPS];
+
+	/*
+	 * Serializes harvesting of the completed registers between the
+	 * interrupt handler and blk-mq poll.
+	 */
+	spinlock_t completed_lock[MTIP_MAX_SLOT_GROUPS];
 };
 
 /*
@@ -68,20 +68,32 @@ MODULE_PARM_DESC(max_buffer_pages,
 "Maximum number of free pages to keep in each block backend buffer");
 
 /*
- * Maximum number of grants to map persistently in blkback. For maximum
+ * Number of grants to map persistently in blkback. For maximum
  * performance this should be the total numbers of grants that can be used
  * to fill the ring, but since this might become too high, specially with
  * the use of indirect descriptors, we set it to a value that provides good
  * performance without using too much memory.
  *
+ * This is only the starting point: each ring adapts its cap to the
+ * working set of its frontend, growing it up to PGRANT_CAP_MAX_GROW
+ * times this value while the cache keeps overflowing and shrinking it
+ * back once the pressure is gone.
+ *
  * When the list of persistent grants is full we clean it up using a LRU
  * algorithm.
  */
 
-static int xen_blkif_max_pgrants = 1056;
+int xen_blkif_max_pgrants = 1056;
 module_param_named(max_persistent_grants, xen_blkif_max_pgrants, int, 0644);
 MODULE_PARM_DESC(max_persistent_grants,
-                 "Maximum number of grants to map persistently");
+                 "Number of grants to map persistently (per-ring caps adapt around this)");
+
+/*
+ * Upper bound for the adaptive per-ring cap on persistent grants, as a
+ * multiple of max_persistent_grants.  Each cached grant pins a page, so
+ * this bounds the memory a misbehaving frontend can make us pin.
+ */
+#define PGRANT_CAP_MAX_GROW 4
 
 /*
  * Maximum number of rings/queues blkback supports, allow as many queues as there
@@ -215,9 +227,10 @@ static int add_persistent_gnt(struct xen_blkif_ring *ring,
 	struct persistent_gnt *this;
 	struct xen_blkif *blkif = ring->blkif;
 
-	if (ring->persistent_gnt_c >= xen_blkif_max_pgrants) {
+	if (ring->persistent_gnt_c >= ring->persistent_gnt_cap) {
 		if (!blkif->vbd.overflow_max_grants)
 			blkif->vbd.overflow_max_grants = 1;
+		ring->persistent_gnt_overflow++;
 		return -EBUSY;
 	}
 	/* Figure out where to put new node */
@@ -374,8 +387,35 @@ static void purge_persistent_gnt(struct xen_blkif_ring *ring)
 	bool scan_used = false, clean_used = false;
 	struct rb_root *root;
 
-	if (ring->persistent_gnt_c < xen_blkif_max_pgrants ||
-	    (ring->persistent_gnt_c == xen_blkif_max_pgrants &&
+	/*
+	 * Adapt the per-ring cap to the workload before deciding what to
+	 * clean.  If the frontend overflowed the cache since the last pass
+	 * while most cached grants were genuinely held, its working set is
+	 * simply bigger than the cache: grow the cap so that the steady
+	 * state needs no map/unmap hypercalls at all.  Without overflows,
+	 * fall back towards the configured value and let the LRU below
+	 * unmap the surplus.
+	 */
+	if (ring->persistent_gnt_overflow &&
+	    atomic_read(&ring->persistent_gnt_in_use) >
+	    ring->persistent_gnt_cap / 2) {
+		ring->persistent_gnt_cap =
+			min_t(unsigned int,
+			      ring->persistent_gnt_cap +
+			      ring->persistent_gnt_cap / 2,
+			      xen_blkif_max_pgrants * PGRANT_CAP_MAX_GROW);
+	} else if (!ring->persistent_gnt_overflow &&
+		   ring->persistent_gnt_cap > xen_blkif_max_pgrants) {
+		ring->persistent_gnt_cap =
+			max_t(unsigned int,
+			      ring->persistent_gnt_cap -
+			      ring->persistent_gnt_cap / 4,
+			      xen_blkif_max_pgrants);
+	}
+	ring->persistent_gnt_overflow = 0;
+
+	if (ring->persistent_gnt_c < ring->persistent_gnt_cap ||
+	    (ring->persistent_gnt_c == ring->persistent_gnt_cap &&
 	    !ring->blkif->vbd.overflow_max_grants)) {
 		goto out;
 	}
@@ -385,8 +425,8 @@ static void purge_persistent_gnt(struct xen_blkif_ring *ring)
 		goto out;
 	}
 
-	num_clean = (xen_blkif_max_pgrants / 100) * LRU_PERCENT_CLEAN;
-	num_clean = ring->persistent_gnt_c - xen_blkif_max_pgrants + num_clean;
+	num_clean = (ring->persistent_gnt_cap / 100) * LRU_PERCENT_CLEAN;
+	num_clean = ring->persistent_gnt_c - ring->persistent_gnt_cap + num_clean;
 	num_clean = min(ring->persistent_gnt_c, num_clean);
 	if ((num_clean == 0) ||
 	    (num_clean > (ring->persistent_gnt_c - atomic_read(&ring->persistent_gnt_in_use))))
@@ -588,12 +628,12 @@ irqreturn_t xen_blkif_be_int(int irq, void *dev_id)
 static void print_stats(struct xen_blkif_ring *ring)
 {
 	pr_info("(%s): oo %3llu  |  rd %4llu  |  wr %4llu  |  f %4llu"
-		 "  |  ds %4llu | pg: %4u/%4d\n",
+		 "  |  ds %4llu | pg: %4u/%4u\n",
 		 current->comm, ring->st_oo_req,
 		 ring->st_rd_req, ring->st_wr_req,
 		 ring->st_f_req, ring->st_ds_req,
 		 ring->persistent_gnt_c,
-		 xen_blkif_max_pgrants);
+		 ring->persistent_gnt_cap);
 	ring->st_print = jiffies + msecs_to_jiffies(10 * 1000);
 	ring->st_rd_req = 0;
 	ring->st_wr_req = 0;
@@ -794,30 +834,28 @@ static void xen_blkbk_unmap(struct xen_blkif_ring *ring,
 	}
 }
 
-static int xen_blkbk_map(struct xen_blkif_ring *ring,
-			 struct grant_page *pages[],
-			 int num, bool ro)
+/*
+ * Walk the segments of a request, attach the grants that are already
+ * persistently mapped and fill map[..]/pages_to_gnt[..] with one map
+ * operation for each of the others.  Returns the number of map operations
+ * added; the hypercall itself is left to the caller so that the operations
+ * of several requests can be folded into a single gnttab_map_refs.
+ */
+static int xen_blkbk_map_prepare(struct xen_blkif_ring *ring,
+				 struct grant_page *pages[],
+				 int num, bool ro,
+				 struct gnttab_map_grant_ref *map,
+				 struct page **pages_to_gnt)
 {
-	struct gnttab_map_grant_ref map[BLKIF_MAX_SEGMENTS_PER_REQUEST];
-	struct page *pages_to_gnt[BLKIF_MAX_SEGMENTS_PER_REQUEST];
-	struct persistent_gnt *persistent_gnt = NULL;
-	phys_addr_t addr = 0;
-	int i, seg_idx, new_map_idx;
-	int segs_to_map = 0;
-	int ret = 0;
-	int last_map = 0, map_until = 0;
-	int use_persistent_gnts;
 	struct xen_blkif *blkif = ring->blkif;
+	int use_persistent_gnts;
+	int segs_to_map = 0;
+	int i;
 
 	use_persistent_gnts = (blkif->vbd.feature_gnt_persistent);
 
-	/*
-	 * Fill out preq.nr_sects with proper amount of sectors, and setup
-	 * assign map[..] with the PFN of the page in our domain with the
-	 * corresponding grant reference for each page.
-	 */
-again:
-	for (i = map_until; i < num; i++) {
+	for (i = 0; i < num; i++) {
+		struct persistent_gnt *persistent_gnt = NULL;
 		uint32_t flags;
 
 		if (use_persistent_gnts) {
@@ -836,35 +874,52 @@ again:
 		} else {
 			if (get_free_page(ring, &pages[i]->page))
 				goto out_of_memory;
-			addr = vaddr(pages[i]->page);
 			pages_to_gnt[segs_to_map] = pages[i]->page;
 			pages[i]->persistent_gnt = NULL;
 			flags = GNTMAP_host_map;
 			if (!use_persistent_gnts && ro)
 				flags |= GNTMAP_readonly;
-			gnttab_set_map_op(&map[segs_to_map++], addr,
+			gnttab_set_map_op(&map[segs_to_map++],
+					  vaddr(pages[i]->page),
 					  flags, pages[i]->gref,
 					  blkif->domid);
 		}
-		map_until = i + 1;
-		if (segs_to_map == BLKIF_MAX_SEGMENTS_PER_REQUEST)
-			break;
 	}
 
-	if (segs_to_map) {
-		ret = gnttab_map_refs(map, NULL, pages_to_gnt, segs_to_map);
-		BUG_ON(ret);
-	}
+	return segs_to_map;
+
+out_of_memory:
+	pr_alert("%s: out of memory\n", __func__);
+	put_free_pages(ring, pages_to_gnt, segs_to_map);
+	return -ENOMEM;
+}
+
+/*
+ * Consume the results of the map operations prepared for this request.
+ * Returns non-zero if any grant could not be mapped; *nr_ops is set to the
+ * number of entries of map[..] that belonged to this request.
+ */
+static int xen_blkbk_map_finish(struct xen_blkif_ring *ring,
+				struct grant_page *pages[], int num,
+				struct gnttab_map_grant_ref *map,
+				unsigned int *nr_ops)
+{
+	struct persistent_gnt *persistent_gnt = NULL;
+	struct xen_blkif *blkif = ring->blkif;
+	int use_persistent_gnts;
+	int seg_idx, new_map_idx;
+	int ret = 0;
+
+	use_persistent_gnts = (blkif->vbd.feature_gnt_persistent);
 
 	/*
 	 * Now swizzle the MFN in our domain with the MFN from the other domain
 	 * so that when we access vaddr(pending_req,i) it has the contents of
 	 * the page from the other domain.
 	 */
-	for (seg_idx = last_map, new_map_idx = 0; seg_idx < map_until; seg_idx++) {
+	for (seg_idx = 0, new_map_idx = 0; seg_idx < num; seg_idx++) {
 		if (!pages[seg_idx]->persistent_gnt) {
 			/* This is a newly mapped grant */
-			BUG_ON(new_map_idx >= segs_to_map);
 			if (unlikely(map[new_map_idx].status != 0)) {
 				pr_debug("invalid buffer -- could not remap it\n");
 				put_free_pages(ring, &pages[seg_idx]->page, 1);
@@ -877,7 +932,7 @@ again:
 			continue;
 		}
 		if (use_persistent_gnts &&
-		    ring->persistent_gnt_c < xen_blkif_max_pgrants) {
+		    ring->persistent_gnt_c < ring->persistent_gnt_cap) {
 			/*
 			 * We are using persistent grants, the grant is
 			 * not mapped but we might have room for it.
@@ -904,7 +959,7 @@ again:
 			pages[seg_idx]->persistent_gnt = persistent_gnt;
 			pr_debug("grant %u added to the tree of persistent grants, using %u/%u\n",
 				 persistent_gnt->gnt, ring->persistent_gnt_c,
-				 xen_blkif_max_pgrants);
+				 ring->persistent_gnt_cap);
 			goto next;
 		}
 		if (use_persistent_gnts && !blkif->vbd.overflow_max_grants) {
@@ -919,28 +974,38 @@ again:
 next:
 		new_map_idx++;
 	}
-	segs_to_map = 0;
-	last_map = map_until;
-	if (map_until != num)
-		goto again;
 
+	*nr_ops = new_map_idx;
 	return ret;
-
-out_of_memory:
-	pr_alert("%s: out of memory\n", __func__);
-	put_free_pages(ring, pages_to_gnt, segs_to_map);
-	return -ENOMEM;
 }
 
-static int xen_blkbk_map_seg(struct pending_req *pending_req)
+static int xen_blkbk_map(struct xen_blkif_ring *ring,
+			 struct grant_page *pages[],
+			 int num, bool ro)
 {
-	int rc;
+	struct gnttab_map_grant_ref map[BLKIF_MAX_SEGMENTS_PER_REQUEST];
+	struct page *pages_to_gnt[BLKIF_MAX_SEGMENTS_PER_REQUEST];
+	int ret = 0;
 
-	rc = xen_blkbk_map(pending_req->ring, pending_req->segments,
-			   pending_req->nr_segs,
-	                   (pending_req->operation != BLKIF_OP_READ));
+	while (num) {
+		int batch = min(num, BLKIF_MAX_SEGMENTS_PER_REQUEST);
+		unsigned int nr_ops;
+		int segs_to_map;
+
+		segs_to_map = xen_blkbk_map_prepare(ring, pages, batch, ro,
+						    map, pages_to_gnt);
+		if (segs_to_map < 0)
+			return segs_to_map;
+		if (segs_to_map)
+			BUG_ON(gnttab_map_refs(map, NULL, pages_to_gnt,
+					       segs_to_map));
+		ret |= xen_blkbk_map_finish(ring, pages, batch, map, &nr_ops);
+		BUG_ON(nr_ops != segs_to_map);
+		pages += batch;
+		num -= batch;
+	}
 
-	return rc;
+	return ret;
 }
 
 static int xen_blkbk_parse_indirect(struct blkif_request *req,
@@ -1104,7 +1169,161 @@ static void end_block_io_op(struct bio *bio)
 	bio_put(bio);
 }
 
+/*
+ * Transmute a parsed and mapped request to proper 'struct bio's and call
+ * 'submit_bio' to pass them to the underlying storage.  Called from
+ * xen_blkbk_map_flush once the map hypercall for the whole batch is done;
+ * the caller holds a plug across all requests of the batch.
+ */
+static void xen_blkbk_submit_prepared(struct xen_blkif_ring *ring,
+				      struct pending_req *pending_req,
+				      int map_error)
+{
+	struct phys_req *preq = &pending_req->preq;
+	struct seg_buf *seg = pending_req->seg;
+	struct grant_page **pages = pending_req->segments;
+	struct bio **biolist = pending_req->biolist;
+	struct bio *bio = NULL;
+	int nseg = pending_req->nr_segs;
+	int operation;
+	int operation_flags = 0;
+	int i, nbio = 0;
+
+	switch (pending_req->operation) {
+	case BLKIF_OP_READ:
+		operation = REQ_OP_READ;
+		break;
+	case BLKIF_OP_WRITE:
+		operation = REQ_OP_WRITE;
+		operation_flags = REQ_SYNC | REQ_IDLE;
+		break;
+	default:
+		/* BLKIF_OP_WRITE_BARRIER or BLKIF_OP_FLUSH_DISKCACHE */
+		operation = REQ_OP_WRITE;
+		operation_flags = REQ_PREFLUSH;
+		break;
+	}
+
+	/*
+	 * If the mapping has failed, we need to undo the M2P override,
+	 * set gnttab_set_unmap_op on all of the grant references and
+	 * perform the hypercall to unmap the grants - that is all done
+	 * in xen_blkbk_unmap.
+	 */
+	if (map_error)
+		goto fail_flush;
+
+	/*
+	 * This corresponding xen_blkif_put is done in __end_block_io_op, or
+	 * below (in "!bio") if we are handling a BLKIF_OP_DISCARD.
+	 */
+	xen_blkif_get(ring->blkif);
+	atomic_inc(&ring->inflight);
+
+	for (i = 0; i < nseg; i++) {
+		while ((bio == NULL) ||
+		       (bio_add_page(bio,
+				     pages[i]->page,
+				     seg[i].nsec << 9,
+				     seg[i].offset) == 0)) {
+
+			int nr_iovecs = min_t(int, (nseg-i), BIO_MAX_PAGES);
+			bio = bio_alloc(GFP_KERNEL, nr_iovecs);
+			if (unlikely(bio == NULL))
+				goto fail_put_bio;
+
+			biolist[nbio++] = bio;
+			bio_set_dev(bio, preq->bdev);
+			bio->bi_private = pending_req;
+			bio->bi_end_io  = end_block_io_op;
+			bio->bi_iter.bi_sector  = preq->sector_number;
+			bio_set_op_attrs(bio, operation, operation_flags);
+		}
+
+		preq->sector_number += seg[i].nsec;
+	}
+
+	/* This will be hit if the operation was a flush or discard. */
+	if (!bio) {
+		BUG_ON(operation_flags != REQ_PREFLUSH);
+
+		bio = bio_alloc(GFP_KERNEL, 0);
+		if (unlikely(bio == NULL))
+			goto fail_put_bio;
+
+		biolist[nbio++] = bio;
+		bio_set_dev(bio, preq->bdev);
+		bio->bi_private = pending_req;
+		bio->bi_end_io  = end_block_io_op;
+		bio_set_op_attrs(bio, operation, operation_flags);
+	}
+
+	atomic_set(&pending_req->pendcnt, nbio);
+
+	for (i = 0; i < nbio; i++)
+		submit_bio(biolist[i]);
+
+	if (operation == REQ_OP_READ)
+		ring->st_rd_sect += preq->nr_sects;
+	else if (operation == REQ_OP_WRITE)
+		ring->st_wr_sect += preq->nr_sects;
+
+	return;
+
+ fail_flush:
+	xen_blkbk_unmap(ring, pending_req->segments,
+	                pending_req->nr_segs);
+	make_response(ring, pending_req->id, pending_req->operation,
+		      BLKIF_RSP_ERROR);
+	free_req(ring, pending_req);
+	msleep(1); /* back off a bit */
+	return;
+
+ fail_put_bio:
+	for (i = 0; i < nbio; i++)
+		bio_put(biolist[i]);
+	atomic_set(&pending_req->pendcnt, 1);
+	__end_block_io_op(pending_req, BLK_STS_RESOURCE);
+	msleep(1); /* back off a bit */
+}
+
+/*
+ * Map the segments of all batched requests with a single hypercall and
+ * let the resulting I/Os go under a single plug.
+ */
+static void xen_blkbk_map_flush(struct xen_blkif_ring *ring)
+{
+	struct blk_plug plug;
+	unsigned int i, op = 0;
 
+	if (!ring->map_nr_reqs)
+		return;
+
+	if (ring->map_nr_ops)
+		BUG_ON(gnttab_map_refs(ring->map_ops, NULL,
+				       ring->map_pages, ring->map_nr_ops));
+
+	blk_start_plug(&plug);
+
+	for (i = 0; i < ring->map_nr_reqs; i++) {
+		struct pending_req *pending_req = ring->map_reqs[i];
+		unsigned int nr_ops;
+		int err;
+
+		err = xen_blkbk_map_finish(ring, pending_req->segments,
+					   pending_req->nr_segs,
+					   &ring->map_ops[op], &nr_ops);
+		op += nr_ops;
+		BUG_ON(op > ring->map_nr_ops);
+		xen_blkbk_submit_prepared(ring, pending_req, err);
+	}
+
+	/* Let the I/Os go.. */
+	blk_finish_plug(&plug);
+
+	ring->map_nr_ops = 0;
+	ring->map_nr_reqs = 0;
+}
 
 /*
  * Function to copy the from the ring buffer the 'struct blkif_request'
@@ -1176,10 +1395,13 @@ __do_block_io_op(struct xen_blkif_ring *ring)
 			break;
 		case BLKIF_OP_DISCARD:
 			free_req(ring, pending_req);
+			/* Don't reorder the discard past batched writes. */
+			xen_blkbk_map_flush(ring);
 			if (dispatch_discard_io(ring, &req))
 				goto done;
 			break;
 		default:
+			xen_blkbk_map_flush(ring);
 			if (dispatch_other_io(ring, &req, pending_req))
 				goto done;
 			break;
@@ -1189,6 +1411,8 @@ __do_block_io_op(struct xen_blkif_ring *ring)
 		cond_resched();
 	}
 done:
+	/* Map and submit whatever is left in the batch. */
+	xen_blkbk_map_flush(ring);
 	return more_to_do;
 }
 
@@ -1209,8 +1433,9 @@ do_block_io_op(struct xen_blkif_ring *ring)
 	return more_to_do;
 }
 /*
- * Transmutation of the 'struct blkif_request' to a proper 'struct bio'
- * and call the 'submit_bio' to pass it to the underlying storage.
+ * Parse and sanity check a 'struct blkif_request' and queue it for the
+ * next batched map hypercall; xen_blkbk_map_flush turns the batched
+ * requests into proper 'struct bio's and submits them.
  */
 static int dispatch_rw_block_io(struct xen_blkif_ring *ring,
 				struct blkif_request *req,
@@ -1219,12 +1444,9 @@ static int dispatch_rw_block_io(struct xen_blkif_ring *ring,
 	struct phys_req preq;
 	struct seg_buf *seg = pending_req->seg;
 	unsigned int nseg;
-	struct bio *bio = NULL;
-	struct bio **biolist = pending_req->biolist;
-	int i, nbio = 0;
+	int i, nr_ops;
 	int operation;
 	int operation_flags = 0;
-	struct blk_plug plug;
 	bool drain = false;
 	struct grant_page **pages = pending_req->segments;
 	unsigned short req_operation;
@@ -1329,78 +1551,33 @@ static int dispatch_rw_block_io(struct xen_blkif_ring *ring,
 	}
 
 	/* Wait on all outstanding I/O's and once that has been completed
-	 * issue the flush.
+	 * issue the flush.  The batched requests have to go out first, or
+	 * the drain would not cover them.
 	 */
-	if (drain)
+	if (drain) {
+		xen_blkbk_map_flush(ring);
 		xen_blk_drain_io(pending_req->ring);
+	}
 
 	/*
-	 * If we have failed at this point, we need to undo the M2P override,
-	 * set gnttab_set_unmap_op on all of the grant references and perform
-	 * the hypercall to unmap the grants - that is all done in
-	 * xen_blkbk_unmap.
+	 * Queue the request for the next batched map hypercall.  Flush the
+	 * current batch first if the map operations of this request might
+	 * not fit, or if there is no room left for the request itself.
 	 */
-	if (xen_blkbk_map_seg(pending_req))
+	if (ring->map_nr_ops + nseg > ARRAY_SIZE(ring->map_ops) ||
+	    ring->map_nr_reqs == ARRAY_SIZE(ring->map_reqs))
+		xen_blkbk_map_flush(ring);
+
+	nr_ops = xen_blkbk_map_prepare(ring, pages, nseg,
+				       (pending_req->operation != BLKIF_OP_READ),
+				       &ring->map_ops[ring->map_nr_ops],
+				       &ring->map_pages[ring->map_nr_ops]);
+	if (nr_ops < 0)
 		goto fail_flush;
 
-	/*
-	 * This corresponding xen_blkif_put is done in __end_block_io_op, or
-	 * below (in "!bio") if we are handling a BLKIF_OP_DISCARD.
-	 */
-	xen_blkif_get(ring->blkif);
-	atomic_inc(&ring->inflight);
-
-	for (i = 0; i < nseg; i++) {
-		while ((bio == NULL) ||
-		       (bio_add_page(bio,
-				     pages[i]->page,
-				     seg[i].nsec << 9,
-				     seg[i].offset) == 0)) {
-
-			int nr_iovecs = min_t(int, (nseg-i), BIO_MAX_PAGES);
-			bio = bio_alloc(GFP_KERNEL, nr_iovecs);
-			if (unlikely(bio == NULL))
-				goto fail_put_bio;
-
-			biolist[nbio++] = bio;
-			bio_set_dev(bio, preq.bdev);
-			bio->bi_private = pending_req;
-			bio->bi_end_io  = end_block_io_op;
-			bio->bi_iter.bi_sector  = preq.sector_number;
-			bio_set_op_attrs(bio, operation, operation_flags);
-		}
-
-		preq.sector_number += seg[i].nsec;
-	}
-
-	/* This will be hit if the operation was a flush or discard. */
-	if (!bio) {
-		BUG_ON(operation_flags != REQ_PREFLUSH);
-
-		bio = bio_alloc(GFP_KERNEL, 0);
-		if (unlikely(bio == NULL))
-			goto fail_put_bio;
-
-		biolist[nbio++] = bio;
-		bio_set_dev(bio, preq.bdev);
-		bio->bi_private = pending_req;
-		bio->bi_end_io  = end_block_io_op;
-		bio_set_op_attrs(bio, operation, operation_flags);
-	}
-
-	atomic_set(&pending_req->pendcnt, nbio);
-	blk_start_plug(&plug);
-
-	for (i = 0; i < nbio; i++)
-		submit_bio(biolist[i]);
-
-	/* Let the I/Os go.. */
-	blk_finish_plug(&plug);
-
-	if (operation == REQ_OP_READ)
-		ring->st_rd_sect += preq.nr_sects;
-	else if (operation == REQ_OP_WRITE)
-		ring->st_wr_sect += preq.nr_sects;
+	pending_req->preq = preq;
+	ring->map_nr_ops += nr_ops;
+	ring->map_reqs[ring->map_nr_reqs++] = pending_req;
 
 	return 0;
 
@@ -1413,14 +1590,6 @@ static int dispatch_rw_block_io(struct xen_blkif_ring *ring,
 	free_req(ring, pending_req);
 	msleep(1); /* back off a bit */
 	return -EIO;
-
- fail_put_bio:
-	for (i = 0; i < nbio; i++)
-		bio_put(biolist[i]);
-	atomic_set(&pending_req->pendcnt, 1);
-	__end_block_io_op(pending_req, BLK_STS_RESOURCE);
-	msleep(1); /* back off a bit */
-	return -EIO;
 }
 
 
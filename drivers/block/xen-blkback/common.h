@@ -47,6 +47,7 @@
 
 extern unsigned int xen_blkif_max_ring_order;
 extern unsigned int xenblk_max_queues;
+extern int xen_blkif_max_pgrants;
 /*
  * This is the maximum number of segments that would be allowed in indirect
  * requests. This value will also be passed to the frontend.
@@ -232,6 +233,7 @@ struct xen_vbd {
 };
 
 struct backend_info;
+struct pending_req;
 
 /* Number of available flags */
 #define PERSISTENT_GNT_FLAGS_SIZE	2
@@ -281,6 +283,14 @@ struct xen_blkif_ring {
 	spinlock_t		pers_gnts_lock;
 	struct rb_root		persistent_gnts;
 	unsigned int		persistent_gnt_c;
+	/*
+	 * Current cap on the number of cached grants.  Starts at
+	 * xen_blkif_max_pgrants and is adapted to the working set of the
+	 * frontend on every LRU pass.
+	 */
+	unsigned int		persistent_gnt_cap;
+	/* Times the cache was found full since the last LRU pass. */
+	unsigned int		persistent_gnt_overflow;
 	atomic_t		persistent_gnt_in_use;
 	unsigned long           next_lru;
 
@@ -307,6 +317,18 @@ struct xen_blkif_ring {
 	/* Thread shutdown wait queue. */
 	wait_queue_head_t	shutdown_wq;
 	struct xen_blkif 	*blkif;
+
+	/*
+	 * Scratch space used to batch the grant map hypercalls of several
+	 * requests dispatched from __do_block_io_op.  Only ever touched by
+	 * the ring's kthread and always drained before it goes back to
+	 * sleep, so no locking is needed.
+	 */
+	unsigned int		map_nr_ops;
+	unsigned int		map_nr_reqs;
+	struct gnttab_map_grant_ref map_ops[MAX_INDIRECT_SEGMENTS];
+	struct page		*map_pages[MAX_INDIRECT_SEGMENTS];
+	struct pending_req	*map_reqs[XEN_BLKIF_REQS_PER_PAGE];
 };
 
 struct xen_blkif {
@@ -343,6 +365,13 @@ struct grant_page {
 	grant_ref_t		gref;
 };
 
+struct phys_req {
+	unsigned short		dev;
+	blkif_sector_t		nr_sects;
+	struct block_device	*bdev;
+	blkif_sector_t		sector_number;
+};
+
 /*
  * Each outstanding request that we've passed to the lower device layers has a
  * 'pending_req' allocated to it. Each buffer_head that completes decrements
@@ -356,6 +385,8 @@ struct pending_req {
 	atomic_t		pendcnt;
 	unsigned short		operation;
 	int			status;
+	/* Translated request, kept until the deferred bio submission. */
+	struct phys_req		preq;
 	struct list_head	free_list;
 	struct grant_page	*segments[MAX_INDIRECT_SEGMENTS];
 	/* Indirect descriptors */
@@ -379,12 +410,6 @@ struct pending_req {
 			schedule_work(&(_b)->free_work);\
 	} while (0)
 
-struct phys_req {
-	unsigned short		dev;
-	blkif_sector_t		nr_sects;
-	struct block_device	*bdev;
-	blkif_sector_t		sector_number;
-};
 int xen_blkif_interface_init(void);
 
 int xen_blkif_xenbus_init(void);
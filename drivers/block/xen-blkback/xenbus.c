@@ -139,7 +139,8 @@ static int xen_blkif_alloc_rings(struct xen_blkif *blkif)
 {
 	unsigned int r;
 
-	blkif->rings = kzalloc(blkif->nr_rings * sizeof(struct xen_blkif_ring), GFP_KERNEL);
+	/* The map batch scratch space makes the ring struct too big for kmalloc. */
+	blkif->rings = vzalloc(blkif->nr_rings * sizeof(struct xen_blkif_ring));
 	if (!blkif->rings)
 		return -ENOMEM;
 
@@ -157,6 +158,7 @@ static int xen_blkif_alloc_rings(struct xen_blkif *blkif)
 		spin_lock_init(&ring->pending_free_lock);
 		init_waitqueue_head(&ring->pending_free_wq);
 		init_waitqueue_head(&ring->shutdown_wq);
+		ring->persistent_gnt_cap = xen_blkif_max_pgrants;
 		ring->blkif = blkif;
 		ring->st_print = jiffies;
 		ring->active = true;
@@ -311,7 +313,7 @@ static int xen_blkif_disconnect(struct xen_blkif *blkif)
 	 * blkif->rings was allocated in connect_ring, so we should free it in
 	 * here.
 	 */
-	kfree(blkif->rings);
+	vfree(blkif->rings);
 	blkif->rings = NULL;
 	blkif->nr_rings = 0;
 
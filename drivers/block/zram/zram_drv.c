@@ -526,46 +526,6 @@ static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
 		return read_from_bdev_async(zram, bvec, entry, parent);
 }
 
-static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
-					u32 index, struct bio *parent,
-					unsigned long *pentry)
-{
-	struct bio *bio;
-	unsigned long entry;
-
-	bio = bio_alloc(GFP_ATOMIC, 1);
-	if (!bio)
-		return -ENOMEM;
-
-	entry = get_entry_bdev(zram);
-	if (!entry) {
-		bio_put(bio);
-		return -ENOSPC;
-	}
-
-	bio->bi_iter.bi_sector = entry * (PAGE_SIZE >> 9);
-	bio_set_dev(bio, zram->bdev);
-	if (!bio_add_page(bio, bvec->bv_page, bvec->bv_len,
-					bvec->bv_offset)) {
-		bio_put(bio);
-		put_entry_bdev(zram, entry);
-		return -EIO;
-	}
-
-	if (!parent) {
-		bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
-		bio->bi_end_io = zram_page_end_io;
-	} else {
-		bio->bi_opf = parent->bi_opf;
-		bio_chain(bio, parent);
-	}
-
-	submit_bio(bio);
-	*pentry = entry;
-
-	return 0;
-}
-
 static void zram_wb_clear(struct zram *zram, u32 index)
 {
 	unsigned long entry;
@@ -579,13 +539,6 @@ static void zram_wb_clear(struct zram *zram, u32 index)
 #else
 static bool zram_wb_enabled(struct zram *zram) { return false; }
 static inline void reset_bdev(struct zram *zram) {};
-static int write_to_bdev(struct zram *zram, struct bio_vec *bvec,
-					u32 index, struct bio *parent,
-					unsigned long *pentry)
-
-{
-	return -EIO;
-}
 
 static int read_from_bdev(struct zram *zram, struct bio_vec *bvec,
 			unsigned long entry, struct bio *parent, bool sync)
@@ -658,6 +611,53 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+static ssize_t dense_compressor_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	if (zram->dense_compressor[0])
+		sz = zcomp_available_show(zram->dense_compressor, buf);
+	else
+		sz = scnprintf(buf, PAGE_SIZE, "none\n");
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t dense_compressor_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->dense_compressor)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (strcmp(compressor, "none") && !zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	if (!strcmp(compressor, "none"))
+		zram->dense_compressor[0] = 0x00;
+	else
+		strcpy(zram->dense_compressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -798,6 +798,11 @@ static void zram_free_page(struct zram *zram, size_t index)
 {
 	unsigned long handle;
 
+	if (zram_test_flag(zram, index, ZRAM_IDLE))
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+	if (zram_test_flag(zram, index, ZRAM_DENSE))
+		zram_clear_flag(zram, index, ZRAM_DENSE);
+
 	if (zram_wb_enabled(zram) && zram_test_flag(zram, index, ZRAM_WB)) {
 		zram_wb_clear(zram, index);
 		atomic64_dec(&zram->stats.pages_stored);
@@ -856,6 +861,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	}
 
 	zram_slot_lock(zram, index);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -878,12 +884,14 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		kunmap_atomic(dst);
 		ret = 0;
 	} else {
-		struct zcomp_strm *zstrm = zcomp_stream_get(zram->comp);
+		struct zcomp *comp = zram_test_flag(zram, index, ZRAM_DENSE) ?
+					zram->comp_dense : zram->comp;
+		struct zcomp_strm *zstrm = zcomp_stream_get(comp);
 
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
 	zram_slot_unlock(zram, index);
@@ -928,6 +936,39 @@ out:
 	return ret;
 }
 
+/*
+ * Classes of page content as seen by the compressibility probe below.
+ */
+enum zram_wr_class {
+	ZRAM_WR_FAST,	/* low entropy, the fast algorithm is enough */
+	ZRAM_WR_DENSE,	/* mixed content, worth the dense algorithm */
+	ZRAM_WR_RANDOM,	/* near random, don't bother compressing */
+};
+
+/*
+ * Cheap compressibility probe: sample every eighth byte and count the
+ * distinct byte values.  Text and structured data keep reusing a small
+ * set of values, while encrypted or already compressed pages are close
+ * to uniform (512 uniform samples hit ~220 distinct values on average).
+ */
+static enum zram_wr_class zram_classify_page(void *mem)
+{
+	unsigned long seen[BITS_TO_LONGS(256)] = { 0 };
+	unsigned int i, distinct = 0;
+	u8 *p = mem;
+
+	for (i = 0; i < PAGE_SIZE; i += PAGE_SIZE / 512) {
+		if (!__test_and_set_bit(p[i], seen))
+			distinct++;
+	}
+
+	if (distinct <= 96)
+		return ZRAM_WR_FAST;
+	if (distinct <= 200)
+		return ZRAM_WR_DENSE;
+	return ZRAM_WR_RANDOM;
+}
+
 static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 				u32 index, struct bio *bio)
 {
@@ -936,11 +977,12 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	unsigned long handle = 0;
 	unsigned int comp_len = 0;
 	void *src, *dst, *mem;
-	struct zcomp_strm *zstrm;
+	struct zcomp *comp = zram->comp;
+	struct zcomp_strm *zstrm = NULL;
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
-	bool allow_wb = true;
+	enum zram_wr_class class = ZRAM_WR_FAST;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -950,35 +992,38 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 		atomic64_inc(&zram->stats.same_pages);
 		goto out;
 	}
+	if (zram->comp_dense) {
+		class = zram_classify_page(mem);
+		if (class == ZRAM_WR_DENSE)
+			comp = zram->comp_dense;
+	}
 	kunmap_atomic(mem);
 
 compress_again:
-	zstrm = zcomp_stream_get(zram->comp);
-	src = kmap_atomic(page);
-	ret = zcomp_compress(zstrm, src, &comp_len);
-	kunmap_atomic(src);
+	if (class == ZRAM_WR_RANDOM) {
+		/* near random data, store it uncompressed right away */
+		comp_len = PAGE_SIZE;
+	} else {
+		zstrm = zcomp_stream_get(comp);
+		src = kmap_atomic(page);
+		ret = zcomp_compress(zstrm, src, &comp_len);
+		kunmap_atomic(src);
 
-	if (unlikely(ret)) {
-		zcomp_stream_put(zram->comp);
-		pr_err("Compression failed! err=%d\n", ret);
-		zs_free(zram->mem_pool, handle);
-		return ret;
+		if (unlikely(ret)) {
+			zcomp_stream_put(comp);
+			pr_err("Compression failed! err=%d\n", ret);
+			zs_free(zram->mem_pool, handle);
+			return ret;
+		}
 	}
 
-	if (unlikely(comp_len > max_zpage_size)) {
-		if (zram_wb_enabled(zram) && allow_wb) {
-			zcomp_stream_put(zram->comp);
-			ret = write_to_bdev(zram, bvec, index, bio, &element);
-			if (!ret) {
-				flags = ZRAM_WB;
-				ret = 1;
-				goto out;
-			}
-			allow_wb = false;
-			goto compress_again;
-		}
+	/*
+	 * Incompressible pages are stored raw.  The background tiering
+	 * scan moves them out to the backing device once they go idle,
+	 * so the store path never stalls on a single page write.
+	 */
+	if (unlikely(comp_len > max_zpage_size))
 		comp_len = PAGE_SIZE;
-	}
 
 	/*
 	 * handle allocation has 2 paths:
@@ -1000,7 +1045,10 @@ compress_again:
 				__GFP_HIGHMEM |
 				__GFP_MOVABLE);
 	if (!handle) {
-		zcomp_stream_put(zram->comp);
+		if (zstrm) {
+			zcomp_stream_put(comp);
+			zstrm = NULL;
+		}
 		atomic64_inc(&zram->stats.writestall);
 		handle = zs_malloc(zram->mem_pool, comp_len,
 				GFP_NOIO | __GFP_HIGHMEM |
@@ -1014,21 +1062,24 @@ compress_again:
 	update_used_max(zram, alloced_pages);
 
 	if (zram->limit_pages && alloced_pages > zram->limit_pages) {
-		zcomp_stream_put(zram->comp);
+		if (zstrm)
+			zcomp_stream_put(comp);
 		zs_free(zram->mem_pool, handle);
 		return -ENOMEM;
 	}
 
 	dst = zs_map_object(zram->mem_pool, handle, ZS_MM_WO);
 
-	src = zstrm->buffer;
-	if (comp_len == PAGE_SIZE)
+	if (comp_len == PAGE_SIZE) {
 		src = kmap_atomic(page);
-	memcpy(dst, src, comp_len);
-	if (comp_len == PAGE_SIZE)
+		memcpy(dst, src, comp_len);
 		kunmap_atomic(src);
+	} else {
+		memcpy(dst, zstrm->buffer, comp_len);
+	}
 
-	zcomp_stream_put(zram->comp);
+	if (zstrm)
+		zcomp_stream_put(comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
 out:
@@ -1045,6 +1096,8 @@ out:
 	}  else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
+		if (comp == zram->comp_dense && comp_len != PAGE_SIZE)
+			zram_set_flag(zram, index, ZRAM_DENSE);
 	}
 	zram_slot_unlock(zram, index);
 
@@ -1053,6 +1106,316 @@ out:
 	return ret;
 }
 
+/* Interval between background scans that age and tier down idle pages */
+#define ZRAM_SCAN_INTERVAL	(60 * HZ)
+
+#ifdef CONFIG_ZRAM_WRITEBACK
+/*
+ * Writeback of idle incompressible pages is batched: candidates are
+ * copied out, their bios submitted under one plug so the block layer
+ * can merge them, and the table entries are switched to ZRAM_WB only
+ * for pages that hit the backing device and stayed idle meanwhile.
+ */
+#define ZRAM_WB_BATCH	32
+
+struct zram_wb_batch {
+	atomic_t pending;
+	struct completion done;
+	int nr;
+	struct zram_wb_io {
+		struct zram_wb_batch *batch;
+		struct page *page;
+		unsigned long handle;
+		unsigned long entry;
+		u32 index;
+		blk_status_t status;
+	} io[ZRAM_WB_BATCH];
+};
+
+static struct zram_wb_batch *zram_wb_batch_alloc(struct zram *zram)
+{
+	if (!zram_wb_enabled(zram))
+		return NULL;
+	return kzalloc(sizeof(struct zram_wb_batch), GFP_KERNEL);
+}
+
+static void zram_wb_batch_end_io(struct bio *bio)
+{
+	struct zram_wb_io *io = bio->bi_private;
+
+	io->status = bio->bi_status;
+	bio_put(bio);
+	if (atomic_dec_and_test(&io->batch->pending))
+		complete(&io->batch->done);
+}
+
+static void zram_wb_batch_flush(struct zram *zram, struct zram_wb_batch *batch);
+
+/*
+ * Stage an idle huge slot for writeback.  Returns false when the
+ * backing device is full and scanning for candidates should stop.
+ */
+static bool zram_wb_batch_add(struct zram *zram, struct zram_wb_batch *batch,
+			      u32 index)
+{
+	struct zram_wb_io *io;
+	unsigned long handle, entry;
+	struct page *page;
+	void *src;
+
+	if (batch->nr == ZRAM_WB_BATCH)
+		zram_wb_batch_flush(zram, batch);
+
+	entry = get_entry_bdev(zram);
+	if (!entry)
+		return false;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		put_entry_bdev(zram, entry);
+		return false;
+	}
+
+	zram_slot_lock(zram, index);
+	handle = zram_get_handle(zram, index);
+	if (!handle || !zram_test_flag(zram, index, ZRAM_IDLE) ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_WB) ||
+	    zram_get_obj_size(zram, index) != PAGE_SIZE) {
+		zram_slot_unlock(zram, index);
+		__free_page(page);
+		put_entry_bdev(zram, entry);
+		return true;
+	}
+	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	memcpy(page_address(page), src, PAGE_SIZE);
+	zs_unmap_object(zram->mem_pool, handle);
+	zram_slot_unlock(zram, index);
+
+	io = &batch->io[batch->nr++];
+	io->batch = batch;
+	io->page = page;
+	io->handle = handle;
+	io->entry = entry;
+	io->index = index;
+	io->status = BLK_STS_OK;
+	return true;
+}
+
+static void zram_wb_batch_flush(struct zram *zram, struct zram_wb_batch *batch)
+{
+	struct blk_plug plug;
+	int i;
+
+	if (!batch->nr)
+		return;
+
+	atomic_set(&batch->pending, batch->nr);
+	init_completion(&batch->done);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < batch->nr; i++) {
+		struct zram_wb_io *io = &batch->io[i];
+		struct bio *bio = bio_alloc(GFP_NOIO, 1);
+
+		bio->bi_iter.bi_sector = io->entry * (PAGE_SIZE >> 9);
+		bio_set_dev(bio, zram->bdev);
+		bio->bi_opf = REQ_OP_WRITE;
+		bio_add_page(bio, io->page, PAGE_SIZE, 0);
+		bio->bi_end_io = zram_wb_batch_end_io;
+		bio->bi_private = io;
+		submit_bio(bio);
+	}
+	blk_finish_plug(&plug);
+
+	wait_for_completion_io(&batch->done);
+
+	for (i = 0; i < batch->nr; i++) {
+		struct zram_wb_io *io = &batch->io[i];
+
+		if (io->status)
+			goto drop;
+
+		zram_slot_lock(zram, io->index);
+		/* the slot was overwritten or re-accessed while in flight */
+		if (zram_get_handle(zram, io->index) != io->handle ||
+		    !zram_test_flag(zram, io->index, ZRAM_IDLE)) {
+			zram_slot_unlock(zram, io->index);
+			goto drop;
+		}
+		zram_free_page(zram, io->index);
+		zram_set_flag(zram, io->index, ZRAM_WB);
+		zram_set_element(zram, io->index, io->entry);
+		zram_slot_unlock(zram, io->index);
+		atomic64_inc(&zram->stats.pages_stored);
+		__free_page(io->page);
+		continue;
+drop:
+		put_entry_bdev(zram, io->entry);
+		__free_page(io->page);
+	}
+	batch->nr = 0;
+}
+#else
+struct zram_wb_batch;
+static struct zram_wb_batch *zram_wb_batch_alloc(struct zram *zram)
+{
+	return NULL;
+}
+static bool zram_wb_batch_add(struct zram *zram, struct zram_wb_batch *batch,
+			      u32 index)
+{
+	return false;
+}
+static void zram_wb_batch_flush(struct zram *zram, struct zram_wb_batch *batch)
+{
+}
+#endif
+
+/*
+ * Move an idle slot to the dense algorithm.  @page is a bounce buffer
+ * for the decompressed data.
+ */
+static void zram_recompress_slot(struct zram *zram, u32 index,
+				 struct page *page)
+{
+	unsigned int comp_len_old, comp_len_new = 0;
+	unsigned long handle, new_handle;
+	struct zcomp_strm *zstrm;
+	void *src, *dst;
+	int ret;
+
+	zram_slot_lock(zram, index);
+	handle = zram_get_handle(zram, index);
+	comp_len_old = zram_get_obj_size(zram, index);
+	if (!handle || !zram_test_flag(zram, index, ZRAM_IDLE) ||
+	    zram_test_flag(zram, index, ZRAM_SAME) ||
+	    zram_test_flag(zram, index, ZRAM_DENSE) ||
+	    (zram_wb_enabled(zram) && zram_test_flag(zram, index, ZRAM_WB)) ||
+	    comp_len_old == PAGE_SIZE) {
+		zram_slot_unlock(zram, index);
+		return;
+	}
+
+	dst = page_address(page);
+	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	zstrm = zcomp_stream_get(zram->comp);
+	ret = zcomp_decompress(zstrm, src, comp_len_old, dst);
+	zcomp_stream_put(zram->comp);
+	zs_unmap_object(zram->mem_pool, handle);
+	zram_slot_unlock(zram, index);
+	if (ret)
+		return;
+
+	zstrm = zcomp_stream_get(zram->comp_dense);
+	ret = zcomp_compress(zstrm, dst, &comp_len_new);
+	if (ret || comp_len_new >= comp_len_old ||
+	    comp_len_new > max_zpage_size) {
+		zcomp_stream_put(zram->comp_dense);
+		return;
+	}
+
+	/* this is opportunistic work, don't dip into reserves for it */
+	new_handle = zs_malloc(zram->mem_pool, comp_len_new,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!new_handle) {
+		zcomp_stream_put(zram->comp_dense);
+		return;
+	}
+
+	dst = zs_map_object(zram->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len_new);
+	zs_unmap_object(zram->mem_pool, new_handle);
+	zcomp_stream_put(zram->comp_dense);
+
+	zram_slot_lock(zram, index);
+	/*
+	 * Every store to the slot goes through zram_free_page() which
+	 * clears ZRAM_IDLE, so the flag still being set means the old
+	 * object wasn't touched while we worked on it.
+	 */
+	if (zram_get_handle(zram, index) != handle ||
+	    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+		zram_slot_unlock(zram, index);
+		zs_free(zram->mem_pool, new_handle);
+		return;
+	}
+
+	zram_set_handle(zram, index, new_handle);
+	zram_set_obj_size(zram, index, comp_len_new);
+	zram_set_flag(zram, index, ZRAM_DENSE);
+	zram_slot_unlock(zram, index);
+
+	zs_free(zram->mem_pool, handle);
+	atomic64_sub(comp_len_old - comp_len_new,
+			&zram->stats.compr_data_size);
+}
+
+/*
+ * Mark-and-sweep tiering of idle pages.  The first scan over a slot
+ * only ages it; a slot that is still idle on the next scan is tiered
+ * down - incompressible pages go to the backing device in batches,
+ * compressible ones are recompressed with the dense algorithm.
+ */
+static void zram_tier_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(to_delayed_work(work),
+					struct zram, tier_work);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	struct zram_wb_batch *batch;
+	unsigned long index;
+	struct page *page = NULL;
+
+	batch = zram_wb_batch_alloc(zram);
+	if (zram->comp_dense)
+		page = alloc_page(GFP_KERNEL);
+
+	for (index = 0; index < nr_pages; index++) {
+		bool huge;
+
+		zram_slot_lock(zram, index);
+		if (!zram_get_handle(zram, index) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    (zram_wb_enabled(zram) &&
+		     zram_test_flag(zram, index, ZRAM_WB))) {
+			zram_slot_unlock(zram, index);
+			continue;
+		}
+		if (!zram_test_flag(zram, index, ZRAM_IDLE)) {
+			/* age the slot, tier it on the next scan if untouched */
+			zram_set_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			continue;
+		}
+		huge = zram_get_obj_size(zram, index) == PAGE_SIZE;
+		zram_slot_unlock(zram, index);
+
+		if (huge && batch) {
+			if (!zram_wb_batch_add(zram, batch, index)) {
+				/* backing device full, stop collecting */
+				zram_wb_batch_flush(zram, batch);
+				kfree(batch);
+				batch = NULL;
+			}
+		} else if (!huge && page) {
+			zram_recompress_slot(zram, index, page);
+		}
+		cond_resched();
+	}
+
+	if (batch) {
+		zram_wb_batch_flush(zram, batch);
+		kfree(batch);
+	}
+	if (page)
+		__free_page(page);
+	queue_delayed_work(system_unbound_wq, &zram->tier_work,
+			ZRAM_SCAN_INTERVAL);
+}
+
 static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 				u32 index, int offset, struct bio *bio)
 {
@@ -1303,8 +1666,11 @@ out:
 static void zram_reset_device(struct zram *zram)
 {
 	struct zcomp *comp;
+	struct zcomp *comp_dense;
 	u64 disksize;
 
+	cancel_delayed_work_sync(&zram->tier_work);
+
 	down_write(&zram->init_lock);
 
 	zram->limit_pages = 0;
@@ -1315,6 +1681,8 @@ static void zram_reset_device(struct zram *zram)
 	}
 
 	comp = zram->comp;
+	comp_dense = zram->comp_dense;
+	zram->comp_dense = NULL;
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
@@ -1326,6 +1694,8 @@ static void zram_reset_device(struct zram *zram)
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+	if (comp_dense)
+		zcomp_destroy(comp_dense);
 	reset_bdev(zram);
 }
 
@@ -1361,16 +1731,34 @@ static ssize_t disksize_store(struct device *dev,
 		err = PTR_ERR(comp);
 		goto out_free_meta;
 	}
-
 	zram->comp = comp;
+
+	if (zram->dense_compressor[0]) {
+		comp = zcomp_create(zram->dense_compressor);
+		if (IS_ERR(comp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->dense_compressor);
+			err = PTR_ERR(comp);
+			goto out_free_comp;
+		}
+		zram->comp_dense = comp;
+	}
+
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
 
 	revalidate_disk(zram->disk);
 	up_write(&zram->init_lock);
 
+	if (zram->comp_dense || zram_wb_enabled(zram))
+		queue_delayed_work(system_unbound_wq, &zram->tier_work,
+				ZRAM_SCAN_INTERVAL);
+
 	return len;
 
+out_free_comp:
+	zcomp_destroy(zram->comp);
+	zram->comp = NULL;
 out_free_meta:
 	zram_meta_free(zram, disksize);
 out_unlock:
@@ -1453,6 +1841,7 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(dense_compressor);
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 #endif
@@ -1466,6 +1855,7 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_dense_compressor.attr,
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 #endif
@@ -1499,6 +1889,7 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	INIT_DELAYED_WORK(&zram->tier_work, zram_tier_work);
 
 	queue = blk_alloc_queue(GFP_KERNEL);
 	if (!queue) {
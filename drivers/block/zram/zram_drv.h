@@ -16,6 +16,7 @@
 #define _ZRAM_DRV_H_
 
 #include <linux/rwsem.h>
+#include <linux/workqueue.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
 
@@ -64,6 +65,8 @@ enum zram_pageflags {
 	ZRAM_SAME = ZRAM_FLAG_SHIFT,
 	ZRAM_ACCESS,	/* page is now accessed */
 	ZRAM_WB,	/* page is stored on backing_device */
+	ZRAM_DENSE,	/* page is compressed with the dense algorithm */
+	ZRAM_IDLE,	/* page wasn't accessed since the last scan */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -97,6 +100,8 @@ struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
 	struct zcomp *comp;
+	/* optional second backend for cold pages, NULL when not configured */
+	struct zcomp *comp_dense;
 	struct gendisk *disk;
 	/* Prevent concurrent execution of device init */
 	struct rw_semaphore init_lock;
@@ -112,6 +117,12 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+	char dense_compressor[CRYPTO_MAX_ALG_NAME];
+	/*
+	 * Ages idle pages and tiers them down: recompression to the dense
+	 * algorithm and batched writeback to the backing device.
+	 */
+	struct delayed_work tier_work;
 	/*
 	 * zram is claimed so open request will be failed
 	 */
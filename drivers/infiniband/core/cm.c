@@ -38,6 +38,7 @@
 #include <linux/device.h>
 #include <linux/module.h>
 #include <linux/err.h>
+#include <linux/hash.h>
 #include <linux/idr.h>
 #include <linux/interrupt.h>
 #include <linux/random.h>
@@ -114,6 +115,14 @@ static struct ib_client cm_client = {
 	.remove = cm_remove_one
 };
 
+/*
+ * Events for a single connection must be handled in order, but
+ * independent connections need not serialize behind each other.  Work
+ * is therefore spread over a pool of ordered workqueues, sharded by
+ * communication ID, so a connection storm is processed in parallel.
+ */
+#define CM_WORK_QUEUES 8
+
 static struct ib_cm {
 	spinlock_t lock;
 	struct list_head device_list;
@@ -127,11 +136,44 @@ static struct ib_cm {
 	struct idr local_id_table;
 	__be32 random_id_operand;
 	struct list_head timewait_list;
-	struct workqueue_struct *wq;
+	struct workqueue_struct *wq[CM_WORK_QUEUES];
 	/* Sync on cm change port state */
 	spinlock_t state_lock;
 } cm;
 
+static struct workqueue_struct *cm_work_queue(__be32 comm_id)
+{
+	return cm.wq[hash_32((__force u32)comm_id, ilog2(CM_WORK_QUEUES))];
+}
+
+/*
+ * Every CM message carries its sender's communication ID immediately
+ * after the MAD header, followed by the receiver's in all but REQ and
+ * the SIDR messages.  Shard on the receiver's ID when it is present so
+ * that everything for an established connection stays on one queue;
+ * REQ and SIDR messages shard on the sender's ID, which still keeps
+ * their retransmits ordered.
+ */
+static struct workqueue_struct *cm_mad_work_queue(struct ib_mad_recv_wc *wc)
+{
+	struct cm_rtu_msg *msg = (struct cm_rtu_msg *)wc->recv_buf.mad;
+
+	if (msg->hdr.attr_id == CM_REQ_ATTR_ID ||
+	    msg->hdr.attr_id == CM_SIDR_REQ_ATTR_ID ||
+	    msg->hdr.attr_id == CM_SIDR_REP_ATTR_ID)
+		return cm_work_queue(msg->local_comm_id);
+
+	return cm_work_queue(msg->remote_comm_id ?: msg->local_comm_id);
+}
+
+static void cm_flush_work_queues(void)
+{
+	int i;
+
+	for (i = 0; i < CM_WORK_QUEUES; i++)
+		flush_workqueue(cm.wq[i]);
+}
+
 /* Counter indexes ordered by attribute ID */
 enum {
 	CM_REQ_COUNTER,
@@ -911,7 +953,8 @@ static void cm_enter_timewait(struct cm_id_private *cm_id_priv)
 	/* Check if the device started its remove_one */
 	spin_lock_irqsave(&cm.lock, flags);
 	if (!cm_dev->going_down)
-		queue_delayed_work(cm.wq, &cm_id_priv->timewait_info->work.work,
+		queue_delayed_work(cm_work_queue(cm_id_priv->id.local_id),
+				   &cm_id_priv->timewait_info->work.work,
 				   msecs_to_jiffies(wait_time));
 	spin_unlock_irqrestore(&cm.lock, flags);
 
@@ -3834,7 +3877,8 @@ static int cm_establish(struct ib_cm_id *cm_id)
 	/* Check if the device started its remove_one */
 	spin_lock_irqsave(&cm.lock, flags);
 	if (!cm_dev->going_down) {
-		queue_delayed_work(cm.wq, &work->work, 0);
+		queue_delayed_work(cm_work_queue(work->local_id),
+				   &work->work, 0);
 	} else {
 		kfree(work);
 		ret = -ENODEV;
@@ -3966,7 +4010,8 @@ static void cm_recv_handler(struct ib_mad_agent *mad_agent,
 	/* Check if the device started its remove_one */
 	spin_lock_irq(&cm.lock);
 	if (!port->cm_dev->going_down)
-		queue_delayed_work(cm.wq, &work->work, 0);
+		queue_delayed_work(cm_mad_work_queue(mad_recv_wc),
+				   &work->work, 0);
 	else
 		going_down = 1;
 	spin_unlock_irq(&cm.lock);
@@ -4381,11 +4426,11 @@ static void cm_remove_one(struct ib_device *ib_device, void *client_data)
 			cm_id_priv->prim_send_port_not_ready = 1;
 		spin_unlock_irq(&cm.lock);
 		/*
-		 * We flush the queue here after the going_down set, this
+		 * We flush the queues here after the going_down set, this
 		 * verify that no new works will be queued in the recv handler,
 		 * after that we can call the unregister_mad_agent
 		 */
-		flush_workqueue(cm.wq);
+		cm_flush_work_queues();
 		spin_lock_irq(&cm.state_lock);
 		cur_mad_agent = port->mad_agent;
 		port->mad_agent = NULL;
@@ -4400,7 +4445,7 @@ static void cm_remove_one(struct ib_device *ib_device, void *client_data)
 
 static int __init ib_cm_init(void)
 {
-	int ret;
+	int ret, i;
 
 	memset(&cm, 0, sizeof cm);
 	INIT_LIST_HEAD(&cm.device_list);
@@ -4422,10 +4467,12 @@ static int __init ib_cm_init(void)
 		goto error1;
 	}
 
-	cm.wq = alloc_workqueue("ib_cm", 0, 1);
-	if (!cm.wq) {
-		ret = -ENOMEM;
-		goto error2;
+	for (i = 0; i < CM_WORK_QUEUES; i++) {
+		cm.wq[i] = alloc_ordered_workqueue("ib_cm/%d", 0, i);
+		if (!cm.wq[i]) {
+			ret = -ENOMEM;
+			goto error3;
+		}
 	}
 
 	ret = ib_register_client(&cm_client);
@@ -4434,7 +4481,8 @@ static int __init ib_cm_init(void)
 
 	return 0;
 error3:
-	destroy_workqueue(cm.wq);
+	while (i--)
+		destroy_workqueue(cm.wq[i]);
 error2:
 	class_unregister(&cm_class);
 error1:
@@ -4445,6 +4493,7 @@ error1:
 static void __exit ib_cm_cleanup(void)
 {
 	struct cm_timewait_info *timewait_info, *tmp;
+	int i;
 
 	spin_lock_irq(&cm.lock);
 	list_for_each_entry(timewait_info, &cm.timewait_list, list)
@@ -4452,7 +4501,8 @@ static void __exit ib_cm_cleanup(void)
 	spin_unlock_irq(&cm.lock);
 
 	ib_unregister_client(&cm_client);
-	destroy_workqueue(cm.wq);
+	for (i = 0; i < CM_WORK_QUEUES; i++)
+		destroy_workqueue(cm.wq[i]);
 
 	list_for_each_entry_safe(timewait_info, tmp, &cm.timewait_list, list) {
 		list_del(&timewait_info->list);
@@ -37,6 +37,7 @@
 #include <linux/in.h>
 #include <linux/in6.h>
 #include <linux/mutex.h>
+#include <linux/hash.h>
 #include <linux/random.h>
 #include <linux/igmp.h>
 #include <linux/idr.h>
@@ -159,7 +160,15 @@ static struct rdma_addr_client addr_client;
 static LIST_HEAD(dev_list);
 static LIST_HEAD(listen_any_list);
 static DEFINE_MUTEX(lock);
-static struct workqueue_struct *cma_wq;
+/*
+ * Work for a single rdma_cm_id must execute in order, but during a
+ * connection storm independent IDs should not serialize behind each
+ * other.  Work is therefore spread over a pool of ordered workqueues,
+ * sharded by owning ID.
+ */
+#define CMA_WORK_QUEUES 8
+
+static struct workqueue_struct *cma_wq[CMA_WORK_QUEUES];
 static unsigned int cma_pernet_id;
 
 struct cma_pernet {
@@ -368,6 +377,12 @@ struct rdma_id_private {
 	enum ib_gid_type	gid_type;
 };
 
+static void cma_queue_work(struct rdma_id_private *id_priv,
+			   struct work_struct *work)
+{
+	queue_work(cma_wq[hash_ptr(id_priv, ilog2(CMA_WORK_QUEUES))], work);
+}
+
 struct cma_multicast {
 	struct rdma_id_private *id_priv;
 	union {
@@ -2342,7 +2357,7 @@ static void cma_query_handler(int status, struct sa_path_rec *path_rec,
 				     status);
 	}
 
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(work->id, &work->work);
 }
 
 static int cma_query_ib_route(struct rdma_id_private *id_priv, int timeout_ms,
@@ -2596,7 +2611,7 @@ static int cma_resolve_iw_route(struct rdma_id_private *id_priv, int timeout_ms)
 		return -ENOMEM;
 
 	cma_init_resolve_route_work(work, id_priv);
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(id_priv, &work->work);
 	return 0;
 }
 
@@ -2676,7 +2691,7 @@ static int cma_resolve_iboe_route(struct rdma_id_private *id_priv)
 	}
 
 	cma_init_resolve_route_work(work, id_priv);
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(id_priv, &work->work);
 
 	return 0;
 
@@ -2856,7 +2871,7 @@ static int cma_resolve_loopback(struct rdma_id_private *id_priv)
 	rdma_addr_set_dgid(&id_priv->id.route.addr.dev_addr, &gid);
 
 	cma_init_resolve_addr_work(work, id_priv);
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(id_priv, &work->work);
 	return 0;
 err:
 	kfree(work);
@@ -2882,7 +2897,7 @@ static int cma_resolve_ib_addr(struct rdma_id_private *id_priv)
 		&(((struct sockaddr_ib *) &id_priv->id.route.addr.dst_addr)->sib_addr));
 
 	cma_init_resolve_addr_work(work, id_priv);
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(id_priv, &work->work);
 	return 0;
 err:
 	kfree(work);
@@ -4157,7 +4172,7 @@ static int cma_iboe_join_multicast(struct rdma_id_private *id_priv,
 	work->mc = mc;
 	INIT_WORK(&work->work, iboe_mcast_work_handler);
 	kref_get(&mc->mcref);
-	queue_work(cma_wq, &work->work);
+	cma_queue_work(id_priv, &work->work);
 
 	return 0;
 
@@ -4282,7 +4297,7 @@ static int cma_netdev_change(struct net_device *ndev, struct rdma_id_private *id
 		work->id = id_priv;
 		work->event.event = RDMA_CM_EVENT_ADDR_CHANGE;
 		atomic_inc(&id_priv->refcount);
-		queue_work(cma_wq, &work->work);
+		cma_queue_work(id_priv, &work->work);
 	}
 
 	return 0;
@@ -4558,11 +4573,16 @@ static struct pernet_operations cma_pernet_operations = {
 
 static int __init cma_init(void)
 {
-	int ret;
+	int ret, i;
 
-	cma_wq = alloc_ordered_workqueue("rdma_cm", WQ_MEM_RECLAIM);
-	if (!cma_wq)
-		return -ENOMEM;
+	for (i = 0; i < CMA_WORK_QUEUES; i++) {
+		cma_wq[i] = alloc_ordered_workqueue("rdma_cm/%d",
+						    WQ_MEM_RECLAIM, i);
+		if (!cma_wq[i]) {
+			ret = -ENOMEM;
+			goto err_wq;
+		}
+	}
 
 	ret = register_pernet_subsys(&cma_pernet_operations);
 	if (ret)
@@ -4586,12 +4606,15 @@ err:
 	rdma_addr_unregister_client(&addr_client);
 	ib_sa_unregister_client(&sa_client);
 err_wq:
-	destroy_workqueue(cma_wq);
+	while (i--)
+		destroy_workqueue(cma_wq[i]);
 	return ret;
 }
 
 static void __exit cma_cleanup(void)
 {
+	int i;
+
 	cma_configfs_exit();
 	rdma_nl_unregister(RDMA_NL_RDMA_CM);
 	ib_unregister_client(&cma_client);
@@ -4599,7 +4622,8 @@ static void __exit cma_cleanup(void)
 	rdma_addr_unregister_client(&addr_client);
 	ib_sa_unregister_client(&sa_client);
 	unregister_pernet_subsys(&cma_pernet_operations);
-	destroy_workqueue(cma_wq);
+	for (i = 0; i < CMA_WORK_QUEUES; i++)
+		destroy_workqueue(cma_wq[i]);
 }
 
 MODULE_ALIAS_RDMA_NETLINK(RDMA_NL_RDMA_CM, 1);
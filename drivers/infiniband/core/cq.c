@@ -17,6 +17,7 @@
 
 /* # of WCs to poll for with a single call to ib_poll_cq */
 #define IB_POLL_BATCH			16
+#define IB_POLL_BATCH_MAX		64
 #define IB_POLL_BATCH_DIRECT		8
 
 /* # of WCs to iterate over before yielding */
@@ -83,12 +84,29 @@ static void ib_cq_completion_direct(struct ib_cq *cq, void *private)
 	WARN_ONCE(1, "got unsolicited completion for CQ 0x%p\n", cq);
 }
 
+/*
+ * Adapt the number of WCs fetched per ib_poll_cq() call to the observed
+ * arrival rate: grow while the budget keeps being exhausted, shrink once
+ * rounds come back mostly empty.  Each poll context is serialized per CQ,
+ * so comp_batch needs no locking.
+ */
+static void ib_cq_adjust_batch(struct ib_cq *cq, int completed, int budget)
+{
+	int batch = cq->comp_batch;
+
+	if (completed >= budget)
+		cq->comp_batch = min(batch * 2, IB_POLL_BATCH_MAX);
+	else if (batch > IB_POLL_BATCH && completed <= batch / 4)
+		cq->comp_batch = batch / 2;
+}
+
 static int ib_poll_handler(struct irq_poll *iop, int budget)
 {
 	struct ib_cq *cq = container_of(iop, struct ib_cq, iop);
 	int completed;
 
-	completed = __ib_process_cq(cq, budget, cq->wc, IB_POLL_BATCH);
+	completed = __ib_process_cq(cq, budget, cq->wc, cq->comp_batch);
+	ib_cq_adjust_batch(cq, completed, budget);
 	if (completed < budget) {
 		irq_poll_complete(&cq->iop);
 		if (ib_req_notify_cq(cq, IB_POLL_FLAGS) > 0)
@@ -103,22 +121,74 @@ static void ib_cq_completion_softirq(struct ib_cq *cq, void *private)
 	irq_poll_sched(&cq->iop);
 }
 
+static void ib_cq_queue_work(struct ib_cq *cq)
+{
+	struct cpumask *mask = READ_ONCE(cq->comp_cpumask);
+
+	if (mask) {
+		int cpu = cpumask_any_and(mask, cpu_online_mask);
+
+		if (cpu < nr_cpu_ids) {
+			queue_work_on(cpu, ib_comp_wq, &cq->work);
+			return;
+		}
+	}
+	queue_work(ib_comp_wq, &cq->work);
+}
+
 static void ib_cq_poll_work(struct work_struct *work)
 {
 	struct ib_cq *cq = container_of(work, struct ib_cq, work);
 	int completed;
 
 	completed = __ib_process_cq(cq, IB_POLL_BUDGET_WORKQUEUE, cq->wc,
-				    IB_POLL_BATCH);
+				    cq->comp_batch);
+	ib_cq_adjust_batch(cq, completed, IB_POLL_BUDGET_WORKQUEUE);
 	if (completed >= IB_POLL_BUDGET_WORKQUEUE ||
 	    ib_req_notify_cq(cq, IB_POLL_FLAGS) > 0)
-		queue_work(ib_comp_wq, &cq->work);
+		ib_cq_queue_work(cq);
 }
 
 static void ib_cq_completion_workqueue(struct ib_cq *cq, void *private)
 {
-	queue_work(ib_comp_wq, &cq->work);
+	ib_cq_queue_work(cq);
+}
+
+/**
+ * ib_cq_set_affinity - restrict completion processing to a set of CPUs
+ * @cq:		CQ allocated with IB_POLL_WORKQUEUE context
+ * @mask:	CPUs that may run the completion work
+ *
+ * Lets a consumer keep CQE processing local to the CPUs (typically
+ * cpumask_of_node() of the node it allocates from) that consume the
+ * completions, instead of wherever the completion interrupt happens to
+ * fire.  May be called at any time; completions already queued keep
+ * their CPU.  If the mask ends up with no online CPU the work falls
+ * back to the interrupted CPU.
+ */
+int ib_cq_set_affinity(struct ib_cq *cq, const struct cpumask *mask)
+{
+	struct cpumask *new;
+
+	if (cq->poll_ctx != IB_POLL_WORKQUEUE)
+		return -EINVAL;
+	if (cpumask_empty(mask))
+		return -EINVAL;
+
+	if (cq->comp_cpumask) {
+		cpumask_copy(cq->comp_cpumask, mask);
+		return 0;
+	}
+
+	new = kmalloc(cpumask_size(), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+	cpumask_copy(new, mask);
+	/* publish only fully initialized masks */
+	smp_store_release(&cq->comp_cpumask, new);
+	return 0;
 }
+EXPORT_SYMBOL(ib_cq_set_affinity);
 
 /**
  * __ib_alloc_cq - allocate a completion queue
@@ -155,8 +225,10 @@ struct ib_cq *__ib_alloc_cq(struct ib_device *dev, void *private,
 	cq->cq_context = private;
 	cq->poll_ctx = poll_ctx;
 	atomic_set(&cq->usecnt, 0);
+	cq->comp_batch = IB_POLL_BATCH;
+	cq->comp_cpumask = NULL;
 
-	cq->wc = kmalloc_array(IB_POLL_BATCH, sizeof(*cq->wc), GFP_KERNEL);
+	cq->wc = kmalloc_array(IB_POLL_BATCH_MAX, sizeof(*cq->wc), GFP_KERNEL);
 	if (!cq->wc)
 		goto out_destroy_cq;
 
@@ -219,6 +291,7 @@ void ib_free_cq(struct ib_cq *cq)
 		WARN_ON_ONCE(1);
 	}
 
+	kfree(cq->comp_cpumask);
 	kfree(cq->wc);
 	rdma_restrack_del(&cq->res);
 	ret = cq->device->destroy_cq(cq);
@@ -38,11 +38,15 @@
 #include <linux/sched/mm.h>
 #include <linux/export.h>
 #include <linux/hugetlb.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <rdma/ib_umem_odp.h>
 
 #include "uverbs.h"
 
+/* Regions at least this large are pinned by parallel workers */
+#define IB_UMEM_PIN_PARALLEL_MIN_PAGES	(SZ_1G >> PAGE_SHIFT)
+#define IB_UMEM_PIN_WORKERS		8
 
 static void __ib_umem_release(struct ib_device *dev, struct ib_umem *umem, int dirty)
 {
@@ -68,6 +72,202 @@ static void __ib_umem_release(struct ib_device *dev, struct ib_umem *umem, int d
 
 }
 
+/*
+ * If the region is entirely backed by hugetlb VMAs of one page size and
+ * is aligned to it, the umem can be built as one scatterlist entry (and
+ * one page reference) per huge page instead of per PAGE_SIZE page.
+ * Returns the huge page shift to use, or 0 to fall back to the normal
+ * per-page path.  Must be called with mmap_sem held.
+ */
+static unsigned int ib_umem_huge_shift(struct mm_struct *mm,
+				       unsigned long addr, size_t size)
+{
+	unsigned long end = addr + size;
+	unsigned int shift = 0;
+	struct vm_area_struct *vma;
+
+	while (addr < end) {
+		vma = find_vma(mm, addr);
+		if (!vma || vma->vm_start > addr || !is_vm_hugetlb_page(vma))
+			return 0;
+		if (!shift)
+			shift = huge_page_shift(hstate_vma(vma));
+		else if (shift != huge_page_shift(hstate_vma(vma)))
+			return 0;
+		addr = vma->vm_end;
+	}
+
+	if (shift <= PAGE_SHIFT)
+		return 0;
+	if ((end - size) & ((1UL << shift) - 1) || size & ((1UL << shift) - 1))
+		return 0;
+	return shift;
+}
+
+static int ib_umem_pin_huge(struct ib_umem *umem, unsigned long cur_base,
+			    unsigned long nents, unsigned int huge_shift,
+			    unsigned int gup_flags, struct page **page_list)
+{
+	struct scatterlist *sg;
+	unsigned long i;
+	long ret;
+
+	for_each_sg(umem->sg_head.sgl, sg, nents, i) {
+		ret = get_user_pages_longterm(cur_base, 1, gup_flags,
+					      page_list, NULL);
+		if (ret != 1)
+			return ret < 0 ? ret : -EFAULT;
+
+		sg_set_page(sg, page_list[0], 1UL << huge_shift, 0);
+		umem->npages++;
+		cur_base += 1UL << huge_shift;
+	}
+
+	return 0;
+}
+
+struct ib_umem_pin_work {
+	struct work_struct work;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	unsigned long start;
+	unsigned long npages;
+	unsigned int gup_flags;
+	struct scatterlist *sg;
+	long pinned;
+	int ret;
+	bool hugetlb;
+};
+
+static void ib_umem_pin_work_fn(struct work_struct *work)
+{
+	struct ib_umem_pin_work *pw = container_of(work,
+						struct ib_umem_pin_work, work);
+	unsigned long cur_base = pw->start;
+	unsigned long npages = pw->npages;
+	struct scatterlist *sg = pw->sg;
+	struct page **page_list;
+	struct vm_area_struct **vma_list;
+	long ret = 0;
+	int i;
+
+	pw->hugetlb = true;
+
+	page_list = (struct page **) __get_free_page(GFP_KERNEL);
+	vma_list = (struct vm_area_struct **) __get_free_page(GFP_KERNEL);
+	if (!page_list || !vma_list) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	down_read(&pw->mm->mmap_sem);
+	while (npages) {
+		ret = get_user_pages_remote(pw->task, pw->mm, cur_base,
+				     min_t(unsigned long, npages,
+					   PAGE_SIZE / sizeof (struct page *)),
+				     pw->gup_flags, page_list, vma_list, NULL);
+
+		if (ret < 0)
+			break;
+
+		/* match get_user_pages_longterm(): no long-lived fsdax pins */
+		for (i = 0; i < ret; i++)
+			if (vma_is_fsdax(vma_list[i]))
+				break;
+		if (i != ret) {
+			for (i = 0; i < ret; i++)
+				put_page(page_list[i]);
+			ret = -EOPNOTSUPP;
+			break;
+		}
+
+		for (i = 0; i < ret; i++) {
+			if (!is_vm_hugetlb_page(vma_list[i]))
+				pw->hugetlb = false;
+
+			sg_set_page(sg, page_list[i], PAGE_SIZE, 0);
+			sg = sg_next(sg);
+		}
+
+		pw->pinned += ret;
+		cur_base   += ret * PAGE_SIZE;
+		npages     -= ret;
+		ret = 0;
+	}
+	up_read(&pw->mm->mmap_sem);
+out:
+	if (vma_list)
+		free_page((unsigned long) vma_list);
+	if (page_list)
+		free_page((unsigned long) page_list);
+	pw->ret = ret < 0 ? ret : 0;
+}
+
+/*
+ * Pin a large region with one worker per chunk so that registration
+ * time scales with memory bandwidth rather than a single CPU.  Called
+ * without mmap_sem; the workers take it for read themselves.  On
+ * failure everything pinned by the workers is released again before
+ * returning.
+ */
+static int ib_umem_pin_parallel(struct ib_umem *umem, unsigned long cur_base,
+				unsigned long npages, unsigned int gup_flags)
+{
+	struct scatterlist *sg = umem->sg_head.sgl;
+	struct ib_umem_pin_work *works;
+	unsigned long chunk, off = 0;
+	int nr_works, i, ret = 0;
+
+	nr_works = min_t(int, num_online_cpus(), IB_UMEM_PIN_WORKERS);
+	works = kcalloc(nr_works, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return -ENOMEM;
+
+	chunk = DIV_ROUND_UP(npages, nr_works);
+	for (i = 0; i < nr_works && off < npages; i++) {
+		struct ib_umem_pin_work *pw = &works[i];
+		unsigned long j, n = min(chunk, npages - off);
+
+		pw->task = current;
+		pw->mm = current->mm;
+		pw->start = cur_base + (off << PAGE_SHIFT);
+		pw->npages = n;
+		pw->gup_flags = gup_flags;
+		pw->sg = sg;
+		INIT_WORK(&pw->work, ib_umem_pin_work_fn);
+		queue_work(system_unbound_wq, &pw->work);
+
+		for (j = 0; j < n; j++)
+			sg = sg_next(sg);
+		off += n;
+	}
+	nr_works = i;
+
+	for (i = 0; i < nr_works; i++) {
+		flush_work(&works[i].work);
+		if (works[i].ret)
+			ret = works[i].ret;
+		if (!works[i].hugetlb)
+			umem->hugetlb = 0;
+	}
+
+	if (ret) {
+		for (i = 0; i < nr_works; i++) {
+			struct ib_umem_pin_work *pw = &works[i];
+
+			for (sg = pw->sg; pw->pinned; pw->pinned--)  {
+				put_page(sg_page(sg));
+				sg = sg_next(sg);
+			}
+		}
+	} else {
+		umem->npages = npages;
+	}
+
+	kfree(works);
+	return ret;
+}
+
 /**
  * ib_umem_get - Pin and DMA map userspace memory.
  *
@@ -90,6 +290,8 @@ struct ib_umem *ib_umem_get(struct ib_ucontext *context, unsigned long addr,
 	unsigned long lock_limit;
 	unsigned long cur_base;
 	unsigned long npages;
+	unsigned long nents;
+	unsigned int huge_shift = 0;
 	int ret;
 	int i;
 	unsigned long dma_attrs = 0;
@@ -180,7 +382,17 @@ struct ib_umem *ib_umem_get(struct ib_ucontext *context, unsigned long addr,
 		goto out;
 	}
 
-	ret = sg_alloc_table(&umem->sg_head, npages, GFP_KERNEL);
+	/*
+	 * Building the umem at huge page granularity changes how many
+	 * scatterlist entries the region has, so it is strictly opt-in,
+	 * like it is for ODP: consumers that pass IB_ACCESS_HUGETLB must
+	 * walk each entry sg_dma_len() bytes at a time.
+	 */
+	if (access & IB_ACCESS_HUGETLB)
+		huge_shift = ib_umem_huge_shift(current->mm, addr, size);
+	nents = huge_shift ? (size >> huge_shift) : npages;
+
+	ret = sg_alloc_table(&umem->sg_head, nents, GFP_KERNEL);
 	if (ret)
 		goto out;
 
@@ -190,6 +402,29 @@ struct ib_umem *ib_umem_get(struct ib_ucontext *context, unsigned long addr,
 	need_release = 1;
 	sg_list_start = umem->sg_head.sgl;
 
+	if (huge_shift) {
+		ret = ib_umem_pin_huge(umem, cur_base, nents, huge_shift,
+				       gup_flags, page_list);
+		if (ret)
+			goto out;
+		goto map;
+	}
+
+	if (npages >= IB_UMEM_PIN_PARALLEL_MIN_PAGES &&
+	    num_online_cpus() > 1) {
+		/*
+		 * The workers take mmap_sem for read, so it cannot be
+		 * held across the wait; pinned_vm is only updated once
+		 * the write lock has been retaken below.
+		 */
+		up_write(&current->mm->mmap_sem);
+		ret = ib_umem_pin_parallel(umem, cur_base, npages, gup_flags);
+		down_write(&current->mm->mmap_sem);
+		if (ret)
+			goto out;
+		goto map;
+	}
+
 	while (npages) {
 		ret = get_user_pages_longterm(cur_base,
 				     min_t(unsigned long, npages,
@@ -214,6 +449,7 @@ struct ib_umem *ib_umem_get(struct ib_ucontext *context, unsigned long addr,
 		sg_list_start = sg;
 	}
 
+map:
 	umem->nmap = ib_dma_map_sg_attrs(context->device,
 				  umem->sg_head.sgl,
 				  umem->npages,
@@ -234,7 +470,7 @@ out:
 		put_pid(umem->pid);
 		kfree(umem);
 	} else
-		current->mm->pinned_vm = locked;
+		current->mm->pinned_vm += ib_umem_num_pages(umem);
 
 	up_write(&current->mm->mmap_sem);
 	if (vma_list)
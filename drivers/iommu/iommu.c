@@ -1640,7 +1640,8 @@ size_t default_iommu_map_sg(struct iommu_domain *domain, unsigned long iova,
 			 struct scatterlist *sg, unsigned int nents, int prot)
 {
 	struct scatterlist *s;
-	size_t mapped = 0;
+	phys_addr_t start = 0;
+	size_t mapped = 0, len = 0;
 	unsigned int i, min_pagesz;
 	int ret;
 
@@ -1649,6 +1650,14 @@ size_t default_iommu_map_sg(struct iommu_domain *domain, unsigned long iova,
 
 	min_pagesz = 1 << __ffs(domain->pgsize_bitmap);
 
+	/*
+	 * Merge physically contiguous segments into a single iommu_map()
+	 * call each, so the driver walks its page tables once per run
+	 * instead of once per segment and gets the chance to use larger
+	 * page sizes across segment boundaries.  Page-sized segments from
+	 * the page allocator frequently turn out contiguous, making this
+	 * the common case for storage and RDMA scatterlists.
+	 */
 	for_each_sg(sg, s, nents, i) {
 		phys_addr_t phys = page_to_phys(sg_page(s)) + s->offset;
 
@@ -1661,11 +1670,27 @@ size_t default_iommu_map_sg(struct iommu_domain *domain, unsigned long iova,
 		if (!IS_ALIGNED(s->offset, min_pagesz))
 			goto out_err;
 
-		ret = iommu_map(domain, iova + mapped, phys, s->length, prot);
+		if (len && phys == start + len) {
+			len += s->length;
+			continue;
+		}
+
+		if (len) {
+			ret = iommu_map(domain, iova + mapped, start, len,
+					prot);
+			if (ret)
+				goto out_err;
+			mapped += len;
+		}
+		start = phys;
+		len = s->length;
+	}
+
+	if (len) {
+		ret = iommu_map(domain, iova + mapped, start, len, prot);
 		if (ret)
 			goto out_err;
-
-		mapped += s->length;
+		mapped += len;
 	}
 
 	return mapped;
@@ -226,6 +226,8 @@ void nvme_complete_rq(struct request *req)
 
 	trace_nvme_complete_rq(req);
 
+	nvme_mpath_end_request(req);
+
 	if (unlikely(status != BLK_STS_OK && nvme_req_needs_retry(req))) {
 		if (nvme_req_needs_failover(req, status)) {
 			nvme_failover_req(req);
@@ -643,6 +645,9 @@ blk_status_t nvme_setup_cmd(struct nvme_ns *ns, struct request *req,
 		trace_nvme_setup_nvm_cmd(req->q->id, cmd);
 	else
 		trace_nvme_setup_admin_cmd(cmd);
+
+	if (ret == BLK_STS_OK)
+		nvme_mpath_start_request(req);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(nvme_setup_cmd);
@@ -977,7 +982,7 @@ static struct nvme_id_ns *nvme_identify_ns(struct nvme_ctrl *ctrl,
 	return id;
 }
 
-static int nvme_set_features(struct nvme_ctrl *dev, unsigned fid, unsigned dword11,
+int nvme_set_features(struct nvme_ctrl *dev, unsigned fid, unsigned dword11,
 		      void *buffer, size_t buflen, u32 *result)
 {
 	struct nvme_command c;
@@ -995,6 +1000,7 @@ static int nvme_set_features(struct nvme_ctrl *dev, unsigned fid, unsigned dword
 		*result = le32_to_cpu(res.u32);
 	return ret;
 }
+EXPORT_SYMBOL_GPL(nvme_set_features);
 
 int nvme_set_queue_count(struct nvme_ctrl *ctrl, int *count)
 {
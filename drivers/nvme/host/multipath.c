@@ -19,6 +19,86 @@ module_param(multipath, bool, 0644);
 MODULE_PARM_DESC(multipath,
 	"turn on native support for multiple controllers per subsystem");
 
+enum nvme_iopolicy {
+	NVME_IOPOLICY_FIRST,
+	NVME_IOPOLICY_RR,
+	NVME_IOPOLICY_LATENCY,
+};
+
+static const char *const nvme_iopolicy_names[] = {
+	[NVME_IOPOLICY_FIRST]	= "first",
+	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_LATENCY]	= "latency",
+};
+
+static int nvme_iopolicy = NVME_IOPOLICY_FIRST;
+
+static int nvme_set_iopolicy(const char *val, const struct kernel_param *kp)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nvme_iopolicy_names); i++) {
+		if (sysfs_streq(val, nvme_iopolicy_names[i])) {
+			WRITE_ONCE(nvme_iopolicy, i);
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int nvme_get_iopolicy(char *buf, const struct kernel_param *kp)
+{
+	return sprintf(buf, "%s\n",
+			nvme_iopolicy_names[READ_ONCE(nvme_iopolicy)]);
+}
+
+static const struct kernel_param_ops nvme_iopolicy_ops = {
+	.set = nvme_set_iopolicy,
+	.get = nvme_get_iopolicy,
+};
+module_param_cb(iopolicy, &nvme_iopolicy_ops, &nvme_iopolicy, 0644);
+MODULE_PARM_DESC(iopolicy,
+	"path selection policy: first (default), round-robin, latency");
+
+/*
+ * Decay factor for the per-path completion latency estimate: each sample
+ * contributes 1/8th, which tracks persistent port asymmetry without
+ * flapping on individual outliers.
+ */
+#define NVME_PATH_LAT_SHIFT	3
+
+void nvme_mpath_start_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+
+	if (!(rq->cmd_flags & REQ_NVME_MPATH) ||
+	    (nvme_req(rq)->flags & NVME_REQ_PATH_STATS))
+		return;
+
+	nvme_req(rq)->flags |= NVME_REQ_PATH_STATS;
+	nvme_req(rq)->start_time = ktime_get_ns();
+	atomic_inc(&ns->nr_active);
+}
+
+void nvme_mpath_end_request(struct request *rq)
+{
+	struct nvme_ns *ns = rq->q->queuedata;
+	u64 lat, ewma;
+
+	if (!(nvme_req(rq)->flags & NVME_REQ_PATH_STATS))
+		return;
+
+	nvme_req(rq)->flags &= ~NVME_REQ_PATH_STATS;
+	atomic_dec(&ns->nr_active);
+
+	/* Racy updates of the estimate are fine, this is a heuristic. */
+	lat = ktime_get_ns() - nvme_req(rq)->start_time;
+	ewma = READ_ONCE(ns->path_lat);
+	WRITE_ONCE(ns->path_lat, ewma - (ewma >> NVME_PATH_LAT_SHIFT) +
+			(lat >> NVME_PATH_LAT_SHIFT));
+}
+
 void nvme_failover_req(struct request *req)
 {
 	struct nvme_ns *ns = req->q->queuedata;
@@ -66,13 +146,81 @@ static struct nvme_ns *__nvme_find_path(struct nvme_ns_head *head)
 	return NULL;
 }
 
+static struct nvme_ns *nvme_next_ns(struct nvme_ns_head *head,
+		struct nvme_ns *ns)
+{
+	ns = list_next_or_null_rcu(&head->list, &ns->siblings, struct nvme_ns,
+			siblings);
+	if (ns)
+		return ns;
+	return list_first_or_null_rcu(&head->list, struct nvme_ns, siblings);
+}
+
+static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
+		struct nvme_ns *old)
+{
+	struct nvme_ns *ns, *found = NULL;
+
+	if (unlikely(!old))
+		return __nvme_find_path(head);
+
+	for (ns = nvme_next_ns(head, old); ns && ns != old;
+	     ns = nvme_next_ns(head, ns)) {
+		if (ns->ctrl->state == NVME_CTRL_LIVE) {
+			found = ns;
+			break;
+		}
+	}
+
+	if (!found && old->ctrl->state == NVME_CTRL_LIVE)
+		found = old;
+	if (!found)
+		return NULL;
+
+	rcu_assign_pointer(head->current_path, found);
+	return found;
+}
+
+static struct nvme_ns *nvme_latency_path(struct nvme_ns_head *head)
+{
+	struct nvme_ns *ns, *best = NULL;
+	u64 score, best_score = U64_MAX;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (ns->ctrl->state != NVME_CTRL_LIVE)
+			continue;
+
+		/*
+		 * Weigh the latency estimate by the queue depth so that a
+		 * fast but saturated port yields to an idle slower one.
+		 */
+		score = (READ_ONCE(ns->path_lat) + 1) *
+			(atomic_read(&ns->nr_active) + 1);
+		if (score < best_score) {
+			best_score = score;
+			best = ns;
+		}
+	}
+
+	if (best)
+		rcu_assign_pointer(head->current_path, best);
+	return best;
+}
+
 inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 {
 	struct nvme_ns *ns = srcu_dereference(head->current_path, &head->srcu);
 
-	if (unlikely(!ns || ns->ctrl->state != NVME_CTRL_LIVE))
-		ns = __nvme_find_path(head);
-	return ns;
+	switch (READ_ONCE(nvme_iopolicy)) {
+	case NVME_IOPOLICY_RR:
+		return nvme_round_robin_path(head, ns);
+	case NVME_IOPOLICY_LATENCY:
+		return nvme_latency_path(head);
+	default:
+		if (unlikely(!ns || ns->ctrl->state != NVME_CTRL_LIVE))
+			ns = __nvme_find_path(head);
+		return ns;
+	}
 }
 
 static blk_qc_t nvme_ns_head_make_request(struct request_queue *q,
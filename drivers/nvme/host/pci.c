@@ -65,6 +65,26 @@ static int io_queue_depth = 1024;
 module_param_cb(io_queue_depth, &io_queue_depth_ops, &io_queue_depth, 0644);
 MODULE_PARM_DESC(io_queue_depth, "set io queue depth, should >= 2");
 
+static bool irq_coalescing;
+module_param(irq_coalescing, bool, 0444);
+MODULE_PARM_DESC(irq_coalescing,
+	"autotune per-vector interrupt coalescing from completion rates");
+
+/*
+ * Interrupt coalescing autotuning.  The aggregation parameters are set
+ * once; what the controller flips per vector is the Coalescing Disable
+ * bit, based on each queue's completion rate over the last interval.
+ * The on/off thresholds are spread apart so a queue hovering around one
+ * rate doesn't generate a stream of Set Features commands.
+ */
+#define NVME_COALESCE_INTERVAL	HZ
+#define NVME_COALESCE_ON_RATE	30000	/* completions/s to start coalescing */
+#define NVME_COALESCE_OFF_RATE	10000	/* completions/s to stop */
+#define NVME_COALESCE_THR	7	/* aggregate up to 8 completions... */
+#define NVME_COALESCE_TIME	2	/* ...or for 200us, whichever first */
+
+#define NVME_IRQ_CONFIG_CD	(1 << 16)
+
 struct nvme_dev;
 struct nvme_queue;
 
@@ -98,6 +118,7 @@ struct nvme_dev {
 	u32 cmbloc;
 	struct nvme_ctrl ctrl;
 	struct completion ioq_wait;
+	struct delayed_work coalesce_work;
 
 	/* shadow doorbell buffer support: */
 	u32 *dbbuf_dbs;
@@ -146,9 +167,10 @@ static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
 struct nvme_queue {
 	struct device *q_dmadev;
 	struct nvme_dev *dev;
-	spinlock_t q_lock;
+	spinlock_t sq_lock;
 	struct nvme_command *sq_cmds;
 	struct nvme_command __iomem *sq_cmds_io;
+	spinlock_t cq_lock ____cacheline_aligned_in_smp;
 	volatile struct nvme_completion *cqes;
 	struct blk_mq_tags **tags;
 	dma_addr_t sq_dma_addr;
@@ -161,6 +183,9 @@ struct nvme_queue {
 	u16 qid;
 	u8 cq_phase;
 	u8 cqe_seen;
+	bool coalesced;
+	u64 nr_comps;
+	u64 last_nr_comps;
 	u32 *dbbuf_sq_db;
 	u32 *dbbuf_cq_db;
 	u32 *dbbuf_sq_ei;
@@ -394,6 +419,12 @@ static int nvme_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 
 	WARN_ON(dev->tagset.tags[hctx_idx] != hctx->tags);
 	hctx->driver_data = nvmeq;
+
+	/* Let hybrid polling sleep until the predicted completion irq. */
+	if (nvmeq->cq_vector >= 0)
+		blk_mq_hctx_set_poll_irq(hctx,
+					 pci_irq_vector(to_pci_dev(dev->dev),
+							nvmeq->cq_vector));
 	return 0;
 }
 
@@ -886,15 +917,14 @@ static blk_status_t nvme_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	blk_mq_start_request(req);
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->sq_lock);
 	if (unlikely(nvmeq->cq_vector < 0)) {
 		ret = BLK_STS_IOERR;
-		spin_unlock_irq(&nvmeq->q_lock);
+		spin_unlock_irq(&nvmeq->sq_lock);
 		goto out_cleanup_iod;
 	}
 	__nvme_submit_cmd(nvmeq, &cmnd);
-	nvme_process_cq(nvmeq);
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->sq_lock);
 	return BLK_STS_OK;
 out_cleanup_iod:
 	nvme_free_iod(dev, req);
@@ -984,19 +1014,21 @@ static void nvme_process_cq(struct nvme_queue *nvmeq)
 		consumed++;
 	}
 
-	if (consumed)
+	if (consumed) {
+		nvmeq->nr_comps += consumed;
 		nvme_ring_cq_doorbell(nvmeq);
+	}
 }
 
 static irqreturn_t nvme_irq(int irq, void *data)
 {
 	irqreturn_t result;
 	struct nvme_queue *nvmeq = data;
-	spin_lock(&nvmeq->q_lock);
+	spin_lock(&nvmeq->cq_lock);
 	nvme_process_cq(nvmeq);
 	result = nvmeq->cqe_seen ? IRQ_HANDLED : IRQ_NONE;
 	nvmeq->cqe_seen = 0;
-	spin_unlock(&nvmeq->q_lock);
+	spin_unlock(&nvmeq->cq_lock);
 	return result;
 }
 
@@ -1016,7 +1048,7 @@ static int __nvme_poll(struct nvme_queue *nvmeq, unsigned int tag)
 	if (!nvme_cqe_valid(nvmeq, nvmeq->cq_head, nvmeq->cq_phase))
 		return 0;
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->cq_lock);
 	while (nvme_read_cqe(nvmeq, &cqe)) {
 		nvme_handle_cqe(nvmeq, &cqe);
 		consumed++;
@@ -1029,7 +1061,7 @@ static int __nvme_poll(struct nvme_queue *nvmeq, unsigned int tag)
 
 	if (consumed)
 		nvme_ring_cq_doorbell(nvmeq);
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->cq_lock);
 
 	return found;
 }
@@ -1051,9 +1083,9 @@ static void nvme_pci_submit_async_event(struct nvme_ctrl *ctrl)
 	c.common.opcode = nvme_admin_async_event;
 	c.common.command_id = NVME_AQ_BLK_MQ_DEPTH;
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->sq_lock);
 	__nvme_submit_cmd(nvmeq, &c);
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->sq_lock);
 }
 
 static int adapter_delete_queue(struct nvme_dev *dev, u8 opcode, u16 id)
@@ -1310,15 +1342,15 @@ static int nvme_suspend_queue(struct nvme_queue *nvmeq)
 {
 	int vector;
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->cq_lock);
 	if (nvmeq->cq_vector == -1) {
-		spin_unlock_irq(&nvmeq->q_lock);
+		spin_unlock_irq(&nvmeq->cq_lock);
 		return 1;
 	}
 	vector = nvmeq->cq_vector;
 	nvmeq->dev->online_queues--;
 	nvmeq->cq_vector = -1;
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->cq_lock);
 
 	if (!nvmeq->qid && nvmeq->dev->ctrl.admin_q)
 		blk_mq_quiesce_queue(nvmeq->dev->ctrl.admin_q);
@@ -1337,9 +1369,9 @@ static void nvme_disable_admin_queue(struct nvme_dev *dev, bool shutdown)
 	else
 		nvme_disable_ctrl(&dev->ctrl, dev->ctrl.cap);
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->cq_lock);
 	nvme_process_cq(nvmeq);
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->cq_lock);
 }
 
 static int nvme_cmb_qdepth(struct nvme_dev *dev, int nr_io_queues,
@@ -1398,7 +1430,8 @@ static int nvme_alloc_queue(struct nvme_dev *dev, int qid,
 
 	nvmeq->q_dmadev = dev->dev;
 	nvmeq->dev = dev;
-	spin_lock_init(&nvmeq->q_lock);
+	spin_lock_init(&nvmeq->sq_lock);
+	spin_lock_init(&nvmeq->cq_lock);
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
@@ -1434,7 +1467,7 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 {
 	struct nvme_dev *dev = nvmeq->dev;
 
-	spin_lock_irq(&nvmeq->q_lock);
+	spin_lock_irq(&nvmeq->cq_lock);
 	nvmeq->sq_tail = 0;
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
@@ -1442,7 +1475,7 @@ static void nvme_init_queue(struct nvme_queue *nvmeq, u16 qid)
 	memset((void *)nvmeq->cqes, 0, CQ_SIZE(nvmeq->q_depth));
 	nvme_dbbuf_init(dev, nvmeq, qid);
 	dev->online_queues++;
-	spin_unlock_irq(&nvmeq->q_lock);
+	spin_unlock_irq(&nvmeq->cq_lock);
 }
 
 static int nvme_create_queue(struct nvme_queue *nvmeq, int qid)
@@ -1986,14 +2019,14 @@ static void nvme_del_cq_end(struct request *req, blk_status_t error)
 		unsigned long flags;
 
 		/*
-		 * We might be called with the AQ q_lock held
-		 * and the I/O queue q_lock should always
+		 * We might be called with the AQ cq_lock held
+		 * and the I/O queue cq_lock should always
 		 * nest inside the AQ one.
 		 */
-		spin_lock_irqsave_nested(&nvmeq->q_lock, flags,
+		spin_lock_irqsave_nested(&nvmeq->cq_lock, flags,
 					SINGLE_DEPTH_NESTING);
 		nvme_process_cq(nvmeq);
-		spin_unlock_irqrestore(&nvmeq->q_lock, flags);
+		spin_unlock_irqrestore(&nvmeq->cq_lock, flags);
 	}
 
 	nvme_del_queue_end(req, error);
@@ -2179,6 +2212,13 @@ static void nvme_dev_disable(struct nvme_dev *dev, bool shutdown)
 	bool dead = true;
 	struct pci_dev *pdev = to_pci_dev(dev->dev);
 
+	/*
+	 * Not _sync: the work sends admin commands, which nvme_cancel_request
+	 * below will fail out if the controller can't answer them.  The work
+	 * stops rescheduling itself once the state leaves LIVE.
+	 */
+	cancel_delayed_work(&dev->coalesce_work);
+
 	mutex_lock(&dev->shutdown_lock);
 	if (pci_is_enabled(pdev)) {
 		u32 csts = readl(dev->bar + NVME_REG_CSTS);
@@ -2280,6 +2320,87 @@ static void nvme_remove_dead_ctrl(struct nvme_dev *dev, int status)
 		nvme_put_ctrl(&dev->ctrl);
 }
 
+static void nvme_set_irq_config(struct nvme_dev *dev, struct nvme_queue *nvmeq,
+				bool coalesce)
+{
+	u32 dword11 = (u16)nvmeq->cq_vector;
+	int ret;
+
+	if (!coalesce)
+		dword11 |= NVME_IRQ_CONFIG_CD;
+
+	ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_CONFIG, dword11,
+				NULL, 0, NULL);
+	if (!ret)
+		nvmeq->coalesced = coalesce;
+}
+
+static void nvme_coalesce_work(struct work_struct *work)
+{
+	struct nvme_dev *dev =
+		container_of(to_delayed_work(work), struct nvme_dev,
+			     coalesce_work);
+	int i;
+
+	if (dev->ctrl.state != NVME_CTRL_LIVE)
+		return;
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+		u64 rate;
+
+		/* racy snapshot; this is only rate estimation */
+		rate = nvmeq->nr_comps - nvmeq->last_nr_comps;
+		nvmeq->last_nr_comps = nvmeq->nr_comps;
+
+		if (nvmeq->cq_vector < 0)
+			continue;
+
+		if (!nvmeq->coalesced && rate >= NVME_COALESCE_ON_RATE)
+			nvme_set_irq_config(dev, nvmeq, true);
+		else if (nvmeq->coalesced && rate <= NVME_COALESCE_OFF_RATE)
+			nvme_set_irq_config(dev, nvmeq, false);
+	}
+
+	queue_delayed_work(nvme_wq, &dev->coalesce_work,
+			   NVME_COALESCE_INTERVAL);
+}
+
+static void nvme_setup_irq_coalescing(struct nvme_dev *dev)
+{
+	u32 dword11 = NVME_COALESCE_THR | (NVME_COALESCE_TIME << 8);
+	int i, ret;
+
+	if (!irq_coalescing || dev->online_queues < 2)
+		return;
+
+	ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, dword11,
+				NULL, 0, NULL);
+	if (ret) {
+		dev_warn(dev->ctrl.device,
+			 "interrupt coalescing unsupported, not autotuning\n");
+		return;
+	}
+
+	/*
+	 * Start with coalescing disabled on every vector (including the
+	 * admin queue's, which never gets it turned on); the work turns
+	 * it on per vector once the queue is measurably busy.  Polled
+	 * completions bypass nvme_process_cq and don't count towards a
+	 * queue's rate, so latency-sensitive polling traffic doesn't
+	 * drag coalescing onto its own queue.
+	 */
+	for (i = 0; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+
+		nvmeq->last_nr_comps = nvmeq->nr_comps;
+		nvme_set_irq_config(dev, nvmeq, false);
+	}
+
+	queue_delayed_work(nvme_wq, &dev->coalesce_work,
+			   NVME_COALESCE_INTERVAL);
+}
+
 static void nvme_reset_work(struct work_struct *work)
 {
 	struct nvme_dev *dev =
@@ -2381,6 +2502,7 @@ static void nvme_reset_work(struct work_struct *work)
 	}
 
 	nvme_start_ctrl(&dev->ctrl);
+	nvme_setup_irq_coalescing(dev);
 	return;
 
  out:
@@ -2499,6 +2621,7 @@ static int nvme_probe(struct pci_dev *pdev, const struct pci_device_id *id)
 
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
 	INIT_WORK(&dev->remove_work, nvme_remove_dead_ctrl_work);
+	INIT_DELAYED_WORK(&dev->coalesce_work, nvme_coalesce_work);
 	mutex_init(&dev->shutdown_lock);
 	init_completion(&dev->ioq_wait);
 
@@ -2572,6 +2695,7 @@ static void nvme_remove(struct pci_dev *pdev)
 	nvme_stop_ctrl(&dev->ctrl);
 	nvme_remove_namespaces(&dev->ctrl);
 	nvme_dev_disable(dev, true);
+	cancel_delayed_work_sync(&dev->coalesce_work);
 	nvme_free_host_mem(dev);
 	nvme_dev_remove_admin(dev);
 	nvme_free_queues(dev, 0);
@@ -24,6 +24,7 @@
 #include <linux/types.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
+#include <linux/random.h>
 #include <linux/scatterlist.h>
 #include <linux/nvme.h>
 #include <asm/unaligned.h>
@@ -92,6 +93,9 @@ struct nvme_rdma_queue {
 	struct rdma_cm_id	*cm_id;
 	int			cm_error;
 	struct completion	cm_done;
+
+	struct work_struct	start_work;
+	int			start_error;
 };
 
 struct nvme_rdma_ctrl {
@@ -603,20 +607,42 @@ static int nvme_rdma_start_queue(struct nvme_rdma_ctrl *ctrl, int idx)
 	return ret;
 }
 
+static void nvme_rdma_start_queue_work(struct work_struct *work)
+{
+	struct nvme_rdma_queue *queue =
+		container_of(work, struct nvme_rdma_queue, start_work);
+
+	queue->start_error = nvme_rdma_start_queue(queue->ctrl,
+			nvme_rdma_queue_idx(queue));
+}
+
 static int nvme_rdma_start_io_queues(struct nvme_rdma_ctrl *ctrl)
 {
 	int i, ret = 0;
 
+	/*
+	 * Each connect is a full fabric round trip, so establish all I/O
+	 * queues in parallel instead of paying that latency queue by queue.
+	 */
 	for (i = 1; i < ctrl->ctrl.queue_count; i++) {
-		ret = nvme_rdma_start_queue(ctrl, i);
-		if (ret)
-			goto out_stop_queues;
+		INIT_WORK(&ctrl->queues[i].start_work,
+				nvme_rdma_start_queue_work);
+		queue_work(nvme_wq, &ctrl->queues[i].start_work);
 	}
 
+	for (i = 1; i < ctrl->ctrl.queue_count; i++) {
+		flush_work(&ctrl->queues[i].start_work);
+		if (ctrl->queues[i].start_error && !ret)
+			ret = ctrl->queues[i].start_error;
+	}
+
+	if (ret)
+		goto out_stop_queues;
+
 	return 0;
 
 out_stop_queues:
-	for (i--; i >= 1; i--)
+	for (i = 1; i < ctrl->ctrl.queue_count; i++)
 		nvme_rdma_stop_queue(&ctrl->queues[i]);
 	return ret;
 }
@@ -894,10 +920,18 @@ static void nvme_rdma_reconnect_or_remove(struct nvme_rdma_ctrl *ctrl)
 	}
 
 	if (nvmf_should_reconnect(&ctrl->ctrl)) {
+		unsigned long delay = ctrl->ctrl.opts->reconnect_delay * HZ;
+
+		/*
+		 * Controllers that failed together reconnect together.
+		 * Spread the attempts over a second so a fabric-wide blip
+		 * doesn't stampede the target with connect requests.
+		 */
+		delay += prandom_u32_max(HZ);
+
 		dev_info(ctrl->ctrl.device, "Reconnecting in %d seconds...\n",
 			ctrl->ctrl.opts->reconnect_delay);
-		queue_delayed_work(nvme_wq, &ctrl->reconnect_work,
-				ctrl->ctrl.opts->reconnect_delay * HZ);
+		queue_delayed_work(nvme_wq, &ctrl->reconnect_work, delay);
 	} else {
 		dev_info(ctrl->ctrl.device, "Removing controller...\n");
 		nvme_delete_ctrl(&ctrl->ctrl);
@@ -110,6 +110,10 @@ struct vhost_net_virtqueue {
 	struct vhost_net_ubuf_ref *ubufs;
 	struct ptr_ring *rx_ring;
 	struct vhost_net_buf rxq;
+	/* Current busy-poll window in cycles (see busy_clock()); shrinks
+	 * while polls come up empty and snaps back to the configured
+	 * busyloop_timeout while traffic keeps arriving. */
+	unsigned long busyloop_window;
 };
 
 struct vhost_net {
@@ -385,13 +389,31 @@ static inline unsigned long busy_clock(void)
 	return local_clock() >> 10;
 }
 
-static bool vhost_can_busy_poll(struct vhost_dev *dev,
+static bool vhost_can_busy_poll(struct vhost_virtqueue *vq,
 				unsigned long endtime)
 {
 	return likely(!need_resched()) &&
 	       likely(!time_after(busy_clock(), endtime)) &&
 	       likely(!signal_pending(current)) &&
-	       !vhost_has_work(dev);
+	       !vhost_vq_has_work(vq);
+}
+
+/* Adapt the busy-poll window to the recent arrival rate: a poll that
+ * found work earns the full configured timeout again, one that timed
+ * out empty halves the window so an idle ring stops burning cycles. */
+static unsigned long vhost_net_busyloop_window(struct vhost_net_virtqueue *nvq,
+					       u32 timeout)
+{
+	return min_t(unsigned long, nvq->busyloop_window, timeout);
+}
+
+static void vhost_net_busyloop_update(struct vhost_net_virtqueue *nvq,
+				      u32 timeout, bool found)
+{
+	if (found)
+		nvq->busyloop_window = timeout;
+	else
+		nvq->busyloop_window >>= 1;
 }
 
 static void vhost_net_disable_vq(struct vhost_net *n,
@@ -425,20 +447,29 @@ static int vhost_net_tx_get_vq_desc(struct vhost_net *net,
 				    struct iovec iov[], unsigned int iov_size,
 				    unsigned int *out_num, unsigned int *in_num)
 {
+	struct vhost_net_virtqueue *nvq =
+		container_of(vq, struct vhost_net_virtqueue, vq);
 	unsigned long uninitialized_var(endtime);
+	unsigned long window;
 	int r = vhost_get_vq_desc(vq, vq->iov, ARRAY_SIZE(vq->iov),
 				  out_num, in_num, NULL, NULL);
 
 	if (r == vq->num && vq->busyloop_timeout) {
-		preempt_disable();
-		endtime = busy_clock() + vq->busyloop_timeout;
-		while (vhost_can_busy_poll(vq->dev, endtime) &&
-		       vhost_vq_avail_empty(vq->dev, vq))
-			cpu_relax();
-		preempt_enable();
-		r = vhost_get_vq_desc(vq, vq->iov, ARRAY_SIZE(vq->iov),
-				      out_num, in_num, NULL, NULL);
+		window = vhost_net_busyloop_window(nvq, vq->busyloop_timeout);
+		if (window) {
+			preempt_disable();
+			endtime = busy_clock() + window;
+			while (vhost_can_busy_poll(vq, endtime) &&
+			       vhost_vq_avail_empty(vq->dev, vq))
+				cpu_relax();
+			preempt_enable();
+			r = vhost_get_vq_desc(vq, vq->iov, ARRAY_SIZE(vq->iov),
+					      out_num, in_num, NULL, NULL);
+		}
 	}
+	if (vq->busyloop_timeout)
+		vhost_net_busyloop_update(nvq, vq->busyloop_timeout,
+					  r != vq->num);
 
 	return r;
 }
@@ -626,17 +657,21 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk)
 	struct vhost_net_virtqueue *nvq = &net->vqs[VHOST_NET_VQ_TX];
 	struct vhost_virtqueue *vq = &nvq->vq;
 	unsigned long uninitialized_var(endtime);
+	unsigned long window;
 	int len = peek_head_len(rvq, sk);
 
 	if (!len && vq->busyloop_timeout) {
+		window = vhost_net_busyloop_window(rvq, vq->busyloop_timeout);
+		if (!window)
+			goto update;
 		/* Both tx vq and rx socket were polled here */
 		mutex_lock(&vq->mutex);
 		vhost_disable_notify(&net->dev, vq);
 
 		preempt_disable();
-		endtime = busy_clock() + vq->busyloop_timeout;
+		endtime = busy_clock() + window;
 
-		while (vhost_can_busy_poll(&net->dev, endtime) &&
+		while (vhost_can_busy_poll(&rvq->vq, endtime) &&
 		       !sk_has_rx_data(sk) &&
 		       vhost_vq_avail_empty(&net->dev, vq))
 			cpu_relax();
@@ -655,6 +690,10 @@ static int vhost_net_rx_peek_head_len(struct vhost_net *net, struct sock *sk)
 		len = peek_head_len(rvq, sk);
 	}
 
+update:
+	if (vq->busyloop_timeout)
+		vhost_net_busyloop_update(rvq, vq->busyloop_timeout, len);
+
 	return len;
 }
 
@@ -949,12 +988,15 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		n->vqs[i].vhost_hlen = 0;
 		n->vqs[i].sock_hlen = 0;
 		n->vqs[i].rx_ring = NULL;
+		n->vqs[i].busyloop_window = 0;
 		vhost_net_buf_init(&n->vqs[i].rxq);
 	}
 	vhost_dev_init(dev, vqs, VHOST_NET_VQ_MAX);
 
-	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev);
-	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT,
+			dev, &n->vqs[VHOST_NET_VQ_TX].vq);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN,
+			dev, &n->vqs[VHOST_NET_VQ_RX].vq);
 
 	f->private_data = n;
 
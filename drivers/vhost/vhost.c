@@ -186,18 +186,27 @@ EXPORT_SYMBOL_GPL(vhost_work_init);
 
 /* Init poll structure */
 void vhost_poll_init(struct vhost_poll *poll, vhost_work_fn_t fn,
-		     __poll_t mask, struct vhost_dev *dev)
+		     __poll_t mask, struct vhost_dev *dev,
+		     struct vhost_virtqueue *vq)
 {
 	init_waitqueue_func_entry(&poll->wait, vhost_poll_wakeup);
 	init_poll_funcptr(&poll->table, vhost_poll_func);
 	poll->mask = mask;
 	poll->dev = dev;
+	poll->vq = vq;
 	poll->wqh = NULL;
 
 	vhost_work_init(&poll->work, fn);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_init);
 
+/* The worker a poll's work runs on: the virtqueue's worker when the
+ * poll belongs to a virtqueue, the shared device worker otherwise. */
+static struct vhost_worker *vhost_poll_worker(struct vhost_poll *poll)
+{
+	return poll->vq ? poll->vq->worker : &poll->dev->worker;
+}
+
 /* Start polling a file. We add ourselves to file's wait queue. The caller must
  * keep a reference to a file until after vhost_poll_stop is called. */
 int vhost_poll_start(struct vhost_poll *poll, struct file *file)
@@ -232,54 +241,66 @@ void vhost_poll_stop(struct vhost_poll *poll)
 }
 EXPORT_SYMBOL_GPL(vhost_poll_stop);
 
-void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+static void vhost_work_queue_on(struct vhost_worker *worker,
+				struct vhost_work *work)
+{
+	if (!worker->task)
+		return;
+
+	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
+		/* We can only add the work to the list after we're
+		 * sure it was not in the list.
+		 * test_and_set_bit() implies a memory barrier.
+		 */
+		llist_add(&work->node, &worker->work_list);
+		wake_up_process(worker->task);
+	}
+}
+
+static void vhost_work_flush_on(struct vhost_worker *worker,
+				struct vhost_work *work)
 {
 	struct vhost_flush_struct flush;
 
-	if (dev->worker) {
+	if (worker->task) {
 		init_completion(&flush.wait_event);
 		vhost_work_init(&flush.work, vhost_flush_work);
 
-		vhost_work_queue(dev, &flush.work);
+		vhost_work_queue_on(worker, &flush.work);
 		wait_for_completion(&flush.wait_event);
 	}
 }
+
+void vhost_work_flush(struct vhost_dev *dev, struct vhost_work *work)
+{
+	vhost_work_flush_on(&dev->worker, work);
+}
 EXPORT_SYMBOL_GPL(vhost_work_flush);
 
 /* Flush any work that has been scheduled. When calling this, don't hold any
  * locks that are also used by the callback. */
 void vhost_poll_flush(struct vhost_poll *poll)
 {
-	vhost_work_flush(poll->dev, &poll->work);
+	vhost_work_flush_on(vhost_poll_worker(poll), &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_flush);
 
 void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 {
-	if (!dev->worker)
-		return;
-
-	if (!test_and_set_bit(VHOST_WORK_QUEUED, &work->flags)) {
-		/* We can only add the work to the list after we're
-		 * sure it was not in the list.
-		 * test_and_set_bit() implies a memory barrier.
-		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
-	}
+	vhost_work_queue_on(&dev->worker, work);
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
 
 /* A lockless hint for busy polling code to exit the loop */
-bool vhost_has_work(struct vhost_dev *dev)
+bool vhost_vq_has_work(struct vhost_virtqueue *vq)
 {
-	return !llist_empty(&dev->work_list);
+	return !llist_empty(&vq->worker->work_list);
 }
-EXPORT_SYMBOL_GPL(vhost_has_work);
+EXPORT_SYMBOL_GPL(vhost_vq_has_work);
 
 void vhost_poll_queue(struct vhost_poll *poll)
 {
-	vhost_work_queue(poll->dev, &poll->work);
+	vhost_work_queue_on(vhost_poll_worker(poll), &poll->work);
 }
 EXPORT_SYMBOL_GPL(vhost_poll_queue);
 
@@ -289,6 +310,8 @@ static void __vhost_vq_meta_reset(struct vhost_virtqueue *vq)
 
 	for (j = 0; j < VHOST_NUM_ADDRS; j++)
 		vq->meta_iotlb[j] = NULL;
+	for (j = 0; j < VHOST_NUM_XLAT; j++)
+		vq->xlat_cache[j] = NULL;
 }
 
 static void vhost_vq_meta_reset(struct vhost_dev *d)
@@ -331,7 +354,8 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
+	struct vhost_dev *dev = worker->dev;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
 	mm_segment_t oldfs = get_fs();
@@ -348,7 +372,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -422,8 +446,9 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->umem = NULL;
 	dev->iotlb = NULL;
 	dev->mm = NULL;
-	dev->worker = NULL;
-	init_llist_head(&dev->work_list);
+	dev->worker.task = NULL;
+	dev->worker.dev = dev;
+	init_llist_head(&dev->worker.work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -436,11 +461,12 @@ void vhost_dev_init(struct vhost_dev *dev,
 		vq->indirect = NULL;
 		vq->heads = NULL;
 		vq->dev = dev;
+		vq->worker = &dev->worker;
 		mutex_init(&vq->mutex);
 		vhost_vq_reset(dev, vq);
 		if (vq->handle_kick)
 			vhost_poll_init(&vq->poll, vq->handle_kick,
-					EPOLLIN, dev);
+					EPOLLIN, dev, vq);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_dev_init);
@@ -467,17 +493,22 @@ static void vhost_attach_cgroups_work(struct vhost_work *work)
 	s->ret = cgroup_attach_task_all(s->owner, current);
 }
 
-static int vhost_attach_cgroups(struct vhost_dev *dev)
+static int vhost_attach_cgroups_on(struct vhost_worker *worker)
 {
 	struct vhost_attach_cgroups_struct attach;
 
 	attach.owner = current;
 	vhost_work_init(&attach.work, vhost_attach_cgroups_work);
-	vhost_work_queue(dev, &attach.work);
-	vhost_work_flush(dev, &attach.work);
+	vhost_work_queue_on(worker, &attach.work);
+	vhost_work_flush_on(worker, &attach.work);
 	return attach.ret;
 }
 
+static int vhost_attach_cgroups(struct vhost_dev *dev)
+{
+	return vhost_attach_cgroups_on(&dev->worker);
+}
+
 /* Caller should have device mutex */
 bool vhost_dev_has_owner(struct vhost_dev *dev)
 {
@@ -499,13 +530,14 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	/* No owner, become one */
 	dev->mm = get_task_mm(current);
-	worker = kthread_create(vhost_worker, dev, "vhost-%d", current->pid);
+	worker = kthread_create(vhost_worker, &dev->worker, "vhost-%d",
+				current->pid);
 	if (IS_ERR(worker)) {
 		err = PTR_ERR(worker);
 		goto err_worker;
 	}
 
-	dev->worker = worker;
+	dev->worker.task = worker;
 	wake_up_process(worker);	/* avoid contributing to loadavg */
 
 	err = vhost_attach_cgroups(dev);
@@ -519,7 +551,7 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 	return 0;
 err_cgroup:
 	kthread_stop(worker);
-	dev->worker = NULL;
+	dev->worker.task = NULL;
 err_worker:
 	if (dev->mm)
 		mmput(dev->mm);
@@ -607,6 +639,98 @@ static void vhost_clear_msg(struct vhost_dev *dev)
 	spin_unlock(&dev->iotlb_lock);
 }
 
+/* Release a virtqueue's dedicated worker, if it has one, and point the
+ * virtqueue back at the shared device worker.  Caller should have device
+ * mutex, and must have flushed or stopped whatever queues on the worker. */
+static void vhost_vq_detach_worker(struct vhost_virtqueue *vq)
+{
+	struct vhost_worker *worker = vq->worker;
+
+	if (worker == &vq->dev->worker)
+		return;
+
+	vq->worker = &vq->dev->worker;
+	WARN_ON(!llist_empty(&worker->work_list));
+	kthread_stop(worker->task);
+	kfree(worker);
+}
+
+/* Give a virtqueue a dedicated worker bound to @cpu, or move an existing
+ * dedicated worker there; VHOST_VRING_WORKER_SHARED reverts to the shared
+ * device worker.  Caller should have device mutex but not vq mutex: the
+ * old worker is flushed, and its pending handlers may take the latter. */
+static long vhost_vq_attach_worker(struct vhost_virtqueue *vq, u32 idx,
+				   u32 cpu)
+{
+	struct vhost_dev *dev = vq->dev;
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	bool pollstart;
+	long r;
+
+	/* Not while a backend might be queueing work on the old worker */
+	if (vq->private_data)
+		return -EBUSY;
+
+	/* Keep the kick poll off the old worker while we switch */
+	pollstart = vq->kick && vq->handle_kick;
+	if (pollstart)
+		vhost_poll_stop(&vq->poll);
+	vhost_poll_flush(&vq->poll);
+
+	if (cpu == VHOST_VRING_WORKER_SHARED) {
+		vhost_vq_detach_worker(vq);
+		r = 0;
+		goto restart;
+	}
+
+	if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+		r = -EINVAL;
+		goto restart;
+	}
+
+	if (vq->worker != &dev->worker) {
+		r = set_cpus_allowed_ptr(vq->worker->task, cpumask_of(cpu));
+		goto restart;
+	}
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL);
+	if (!worker) {
+		r = -ENOMEM;
+		goto restart;
+	}
+	init_llist_head(&worker->work_list);
+	worker->dev = dev;
+
+	task = kthread_create(vhost_worker, worker, "vhost-%d.%u",
+			      current->pid, idx);
+	if (IS_ERR(task)) {
+		kfree(worker);
+		r = PTR_ERR(task);
+		goto restart;
+	}
+	kthread_bind(task, cpu);
+	worker->task = task;
+	wake_up_process(task);	/* avoid contributing to loadavg */
+
+	r = vhost_attach_cgroups_on(worker);
+	if (r) {
+		kthread_stop(task);
+		kfree(worker);
+		goto restart;
+	}
+
+	vq->worker = worker;
+restart:
+	if (pollstart) {
+		long r2 = vhost_poll_start(&vq->poll, vq->kick);
+
+		if (!r)
+			r = r2;
+	}
+	return r;
+}
+
 void vhost_dev_cleanup(struct vhost_dev *dev)
 {
 	int i;
@@ -618,6 +742,7 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 			fput(dev->vqs[i]->kick);
 		if (dev->vqs[i]->call_ctx)
 			eventfd_ctx_put(dev->vqs[i]->call_ctx);
+		vhost_vq_detach_worker(dev->vqs[i]);
 		vhost_vq_reset(dev, dev->vqs[i]);
 	}
 	vhost_dev_free_iovecs(dev);
@@ -631,10 +756,10 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
+	WARN_ON(!llist_empty(&dev->worker.work_list));
+	if (dev->worker.task) {
+		kthread_stop(dev->worker.task);
+		dev->worker.task = NULL;
 	}
 	if (dev->mm)
 		mmput(dev->mm);
@@ -1324,6 +1449,7 @@ static long vhost_set_memory(struct vhost_dev *d, struct vhost_memory __user *m)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->umem = newumem;
+		__vhost_vq_meta_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -1358,6 +1484,15 @@ long vhost_vring_ioctl(struct vhost_dev *d, int ioctl, void __user *argp)
 
 	vq = d->vqs[idx];
 
+	if (ioctl == VHOST_SET_VRING_WORKER) {
+		/* Handled without the vq mutex: switching workers
+		 * flushes the old one, and its pending handlers may
+		 * take the vq mutex themselves. */
+		if (copy_from_user(&s, argp, sizeof s))
+			return -EFAULT;
+		return vhost_vq_attach_worker(vq, idx, s.num);
+	}
+
 	mutex_lock(&vq->mutex);
 
 	switch (ioctl) {
@@ -1556,6 +1691,7 @@ int vhost_init_device_iotlb(struct vhost_dev *d, bool enabled)
 	for (i = 0; i < d->nvqs; ++i) {
 		mutex_lock(&d->vqs[i]->mutex);
 		d->vqs[i]->iotlb = niotlb;
+		__vhost_vq_meta_reset(d->vqs[i]);
 		mutex_unlock(&d->vqs[i]->mutex);
 	}
 
@@ -1787,6 +1923,40 @@ err:
 }
 EXPORT_SYMBOL_GPL(vhost_vq_init_access);
 
+/* Look up the region covering addr, preferring the per-vq MRU cache
+ * over the interval tree.  Called under vq mutex, which is also held
+ * across every cache reset, so the cached nodes cannot go away under
+ * us.  May return a node starting above addr, like a tree lookup. */
+static const struct vhost_umem_node *
+vhost_find_region(struct vhost_virtqueue *vq, struct vhost_umem *umem,
+		  u64 addr, u64 last)
+{
+	const struct vhost_umem_node *node;
+	int i;
+
+	for (i = 0; i < VHOST_NUM_XLAT; i++) {
+		node = vq->xlat_cache[i];
+		if (!node)
+			break;
+		if (addr >= node->start && addr <= node->last) {
+			/* move to front */
+			while (i--)
+				vq->xlat_cache[i + 1] = vq->xlat_cache[i];
+			vq->xlat_cache[0] = node;
+			return node;
+		}
+	}
+
+	node = vhost_umem_interval_tree_iter_first(&umem->umem_tree,
+						   addr, last);
+	if (node && node->start <= addr) {
+		for (i = VHOST_NUM_XLAT - 1; i > 0; i--)
+			vq->xlat_cache[i] = vq->xlat_cache[i - 1];
+		vq->xlat_cache[0] = node;
+	}
+	return node;
+}
+
 static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			  struct iovec iov[], int iov_size, int access)
 {
@@ -1804,8 +1974,7 @@ static int translate_desc(struct vhost_virtqueue *vq, u64 addr, u32 len,
 			break;
 		}
 
-		node = vhost_umem_interval_tree_iter_first(&umem->umem_tree,
-							addr, addr + len - 1);
+		node = vhost_find_region(vq, umem, addr, addr + len - 1);
 		if (node == NULL || node->start > addr) {
 			if (umem != dev->iotlb) {
 				ret = -EFAULT;
@@ -297,6 +297,59 @@ static bool need_send_readdir(struct ceph_file_info *fi, loff_t pos)
 		return fi->frag != fpos_frag(pos);
 }
 
+/*
+ * Build a readdir request for one chunk of @frag, continuing after
+ * fi->last_name (or at hash position @pos if there is no last name).
+ */
+static struct ceph_mds_request *
+ceph_readdir_prepare_request(struct file *file, int op, unsigned frag,
+			     loff_t pos)
+{
+	struct ceph_file_info *fi = file->private_data;
+	struct inode *inode = file_inode(file);
+	struct ceph_mds_client *mdsc = ceph_inode_to_client(inode)->mdsc;
+	struct ceph_mds_request *req;
+	int err;
+
+	req = ceph_mdsc_create_request(mdsc, op, USE_AUTH_MDS);
+	if (IS_ERR(req))
+		return req;
+	err = ceph_alloc_readdir_reply_buffer(req, inode);
+	if (err) {
+		ceph_mdsc_put_request(req);
+		return ERR_PTR(err);
+	}
+	/* hints to request -> mds selection code */
+	req->r_direct_mode = USE_AUTH_MDS;
+	if (op == CEPH_MDS_OP_READDIR) {
+		req->r_direct_hash = ceph_frag_value(frag);
+		__set_bit(CEPH_MDS_R_DIRECT_IS_HASH, &req->r_req_flags);
+		req->r_inode_drop = CEPH_CAP_FILE_EXCL;
+	}
+	if (fi->last_name) {
+		req->r_path2 = kstrdup(fi->last_name, GFP_KERNEL);
+		if (!req->r_path2) {
+			ceph_mdsc_put_request(req);
+			return ERR_PTR(-ENOMEM);
+		}
+	} else if (is_hash_order(pos)) {
+		req->r_args.readdir.offset_hash = cpu_to_le32(fpos_hash(pos));
+	}
+
+	req->r_dir_release_cnt = fi->dir_release_count;
+	req->r_dir_ordered_cnt = fi->dir_ordered_count;
+	req->r_readdir_cache_idx = fi->readdir_cache_idx;
+	req->r_readdir_offset = fi->next_offset;
+	req->r_args.readdir.frag = cpu_to_le32(frag);
+	req->r_args.readdir.flags =
+			cpu_to_le16(CEPH_READDIR_REPLY_BITFLAGS);
+
+	req->r_inode = inode;
+	ihold(inode);
+	req->r_dentry = dget(file->f_path.dentry);
+	return req;
+}
+
 static int ceph_readdir(struct file *file, struct dir_context *ctx)
 {
 	struct ceph_file_info *fi = file->private_data;
@@ -374,44 +427,23 @@ more:
 
 		dout("readdir fetching %llx.%llx frag %x offset '%s'\n",
 		     ceph_vinop(inode), frag, fi->last_name);
-		req = ceph_mdsc_create_request(mdsc, op, USE_AUTH_MDS);
-		if (IS_ERR(req))
-			return PTR_ERR(req);
-		err = ceph_alloc_readdir_reply_buffer(req, inode);
-		if (err) {
+
+		/* use the prefetched chunk if it is the one we need */
+		req = fi->next_readdir;
+		fi->next_readdir = NULL;
+		if (req && le32_to_cpu(req->r_args.readdir.frag) != frag) {
 			ceph_mdsc_put_request(req);
-			return err;
-		}
-		/* hints to request -> mds selection code */
-		req->r_direct_mode = USE_AUTH_MDS;
-		if (op == CEPH_MDS_OP_READDIR) {
-			req->r_direct_hash = ceph_frag_value(frag);
-			__set_bit(CEPH_MDS_R_DIRECT_IS_HASH, &req->r_req_flags);
-			req->r_inode_drop = CEPH_CAP_FILE_EXCL;
+			req = NULL;
 		}
-		if (fi->last_name) {
-			req->r_path2 = kstrdup(fi->last_name, GFP_KERNEL);
-			if (!req->r_path2) {
-				ceph_mdsc_put_request(req);
-				return -ENOMEM;
-			}
-		} else if (is_hash_order(ctx->pos)) {
-			req->r_args.readdir.offset_hash =
-				cpu_to_le32(fpos_hash(ctx->pos));
+		if (req) {
+			err = ceph_mdsc_wait_request(mdsc, req);
+		} else {
+			req = ceph_readdir_prepare_request(file, op, frag,
+							   ctx->pos);
+			if (IS_ERR(req))
+				return PTR_ERR(req);
+			err = ceph_mdsc_do_request(mdsc, NULL, req);
 		}
-
-		req->r_dir_release_cnt = fi->dir_release_count;
-		req->r_dir_ordered_cnt = fi->dir_ordered_count;
-		req->r_readdir_cache_idx = fi->readdir_cache_idx;
-		req->r_readdir_offset = fi->next_offset;
-		req->r_args.readdir.frag = cpu_to_le32(frag);
-		req->r_args.readdir.flags =
-				cpu_to_le16(CEPH_READDIR_REPLY_BITFLAGS);
-
-		req->r_inode = inode;
-		ihold(inode);
-		req->r_dentry = dget(file->f_path.dentry);
-		err = ceph_mdsc_do_request(mdsc, NULL, req);
 		if (err < 0) {
 			ceph_mdsc_put_request(req);
 			return err;
@@ -472,6 +504,28 @@ more:
 			fi->next_offset = 2;
 			/* keep last name */
 		}
+
+		/*
+		 * Prefetch the next chunk of this frag so it is in
+		 * flight while the current one is consumed.  The reply
+		 * prepopulates the dcache and inode caches off the hot
+		 * path; the usual shared_gen machinery keeps them
+		 * coherent.
+		 */
+		if (op == CEPH_MDS_OP_READDIR && !rinfo->dir_end &&
+		    fi->last_name &&
+		    !ceph_test_mount_opt(fsc, NOASYNCREADDIR)) {
+			struct ceph_mds_request *nreq;
+
+			nreq = ceph_readdir_prepare_request(file, op, frag,
+							    ctx->pos);
+			if (!IS_ERR(nreq)) {
+				if (!ceph_mdsc_submit_request(mdsc, NULL, nreq))
+					fi->next_readdir = nreq;
+				else
+					ceph_mdsc_put_request(nreq);
+			}
+		}
 	}
 
 	rinfo = &fi->last_readdir->r_reply_info;
@@ -579,6 +633,10 @@ static void reset_readdir(struct ceph_file_info *fi)
 		ceph_mdsc_put_request(fi->last_readdir);
 		fi->last_readdir = NULL;
 	}
+	if (fi->next_readdir) {
+		ceph_mdsc_put_request(fi->next_readdir);
+		fi->next_readdir = NULL;
+	}
 	kfree(fi->last_name);
 	fi->last_name = NULL;
 	fi->dir_release_count = 0;
@@ -466,6 +466,8 @@ int ceph_release(struct inode *inode, struct file *file)
 	ceph_put_fmode(ci, cf->fmode);
 	if (cf->last_readdir)
 		ceph_mdsc_put_request(cf->last_readdir);
+	if (cf->next_readdir)
+		ceph_mdsc_put_request(cf->next_readdir);
 	kfree(cf->last_name);
 	kfree(cf->dir_info);
 	WARN_ON(!list_empty(&cf->rw_contexts));
@@ -105,6 +105,7 @@ struct ceph_fs_client {
 	struct workqueue_struct *wb_wq;
 	struct workqueue_struct *pg_inv_wq;
 	struct workqueue_struct *trunc_wq;
+	struct workqueue_struct *cap_wq;
 	atomic_long_t writeback_count;
 
 #ifdef CONFIG_DEBUG_FS
@@ -675,6 +676,7 @@ struct ceph_file_info {
 	/* readdir: position within the dir */
 	u32 frag;
 	struct ceph_mds_request *last_readdir;
+	struct ceph_mds_request *next_readdir; /* prefetched next chunk */
 
 	/* readdir: position within a frag */
 	unsigned next_offset;  /* offset of next chunk (last_name's + 1) */
@@ -995,15 +995,16 @@ struct ext4_inode_info {
 	struct list_head i_prealloc_list;
 	spinlock_t i_prealloc_lock;
 
-	/* extents status tree */
-	struct ext4_es_tree i_es_tree;
-	rwlock_t i_es_lock;
+	/* extents status tree, sharded by logical block range */
+	struct ext4_es_tree i_es_tree[EXT4_ES_NR_SHARDS];
 	struct list_head i_es_list;
-	unsigned int i_es_all_nr;	/* protected by i_es_lock */
-	unsigned int i_es_shk_nr;	/* protected by i_es_lock */
+	atomic_t i_es_all_nr;
+	atomic_t i_es_shk_nr;
 	ext4_lblk_t i_es_shrink_lblk;	/* Offset where we start searching for
 					   extents to shrink. Protected by
-					   i_es_lock  */
+					   shard 0's es_lock */
+	unsigned int i_es_shrink_shard;	/* Shard where we resume shrinking.
+					   Protected by shard 0's es_lock */
 
 	/* ialloc */
 	ext4_group_t	i_last_alloc_group;
@@ -1320,6 +1321,12 @@ struct ext4_super_block {
 /*
  * fourth extended-fs super-block data in memory
  */
+/* per-CPU goal of the last stream allocation (EXT4_MB_STREAM_ALLOC) */
+struct ext4_mb_stream_goal {
+	ext4_group_t group;
+	ext4_grpblk_t start;
+};
+
 struct ext4_sb_info {
 	unsigned long s_desc_size;	/* Size of a group descriptor in bytes */
 	unsigned long s_inodes_per_block;/* Number of inodes per block */
@@ -1414,8 +1421,14 @@ struct ext4_sb_info {
 	unsigned int s_mb_group_prealloc;
 	unsigned int s_max_dir_size_kb;
 	/* where last allocation was done - for stream allocation */
-	unsigned long s_mb_last_group;
-	unsigned long s_mb_last_start;
+	struct ext4_mb_stream_goal __percpu *s_mb_last;
+	/*
+	 * Freespace index: lists of groups keyed by the order of their
+	 * largest free extent, consulted by the allocator to jump
+	 * straight to a group that can satisfy a request.
+	 */
+	struct list_head *s_mb_largest_free_orders;
+	rwlock_t *s_mb_largest_free_orders_locks;
 
 	/* stats for buddy allocator */
 	atomic_t s_bal_reqs;	/* number of reqs with len > 1 */
@@ -2357,6 +2370,8 @@ static inline  unsigned char get_dtype(struct super_block *sb, int filetype)
 }
 extern int ext4_check_all_de(struct inode *dir, struct buffer_head *bh,
 			     void *buf, int buf_size);
+extern void ext4_dir_itable_readahead(struct super_block *sb,
+				      struct buffer_head *bh);
 
 /* fsync.c */
 extern int ext4_sync_file(struct file *, loff_t, loff_t, int);
@@ -2844,6 +2859,8 @@ struct ext4_group_info {
 	ext4_grpblk_t	bb_free;	/* total free blocks */
 	ext4_grpblk_t	bb_fragments;	/* nr of freespace fragments */
 	ext4_grpblk_t	bb_largest_free_order;/* order of largest frag in BG */
+	ext4_group_t	bb_group;	/* Group number */
+	struct          list_head bb_largest_free_order_node;
 	struct          list_head bb_prealloc_list;
 #ifdef DOUBLE_CHECK
 	void            *bb_bitmap;
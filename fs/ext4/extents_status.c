@@ -113,7 +113,10 @@
  *	next extent, adding a extent(a range of blocks) and removing a extent.
  *
  *   --	race on a extent status tree
- *	Extent status tree is protected by inode->i_es_lock.
+ *	The extent status tree is sharded by logical block range; each
+ *	shard is protected by its own es_lock.  Operations covering a
+ *	single stripe take one shard lock; wider operations take all
+ *	shard locks in ascending order.
  *
  *   --	memory consumption
  *      Fragmented extent tree will make extent status tree cost too much
@@ -143,12 +146,17 @@
 
 static struct kmem_cache *ext4_es_cachep;
 
-static int __es_insert_extent(struct inode *inode, struct extent_status *newes);
-static int __es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
-			      ext4_lblk_t end);
-static int es_reclaim_extents(struct ext4_inode_info *ei, int *nr_to_scan);
+static int __es_insert_extent(struct inode *inode, struct ext4_es_tree *tree,
+			      struct extent_status *newes);
+static int __es_remove_extent(struct inode *inode, struct ext4_es_tree *tree,
+			      ext4_lblk_t lblk, ext4_lblk_t end);
+static int es_reclaim_extents(struct ext4_inode_info *ei,
+			      struct ext4_es_tree *locked_tree,
+			      int *nr_to_scan);
+static int es_shrink_inode(struct ext4_inode_info *ei, int *nr_to_scan);
 static int __es_shrink(struct ext4_sb_info *sbi, int nr_to_scan,
-		       struct ext4_inode_info *locked_ei);
+		       struct ext4_inode_info *locked_ei,
+		       struct ext4_es_tree *locked_tree);
 
 int __init ext4_init_es(void)
 {
@@ -166,10 +174,103 @@ void ext4_exit_es(void)
 		kmem_cache_destroy(ext4_es_cachep);
 }
 
-void ext4_es_init_tree(struct ext4_es_tree *tree)
+/*
+ * Shard helpers.  Stripes of 2^EXT4_ES_SHARD_GRAN_BITS blocks go
+ * round-robin to the shards, and extents never cross a stripe boundary
+ * (__es_insert_extent() callers split them), so the shard of an
+ * extent's first block owns the whole extent.
+ *
+ * Lock ordering: shard locks are taken in ascending index order.  Each
+ * shard index has its own lockdep class so that ordered nesting is
+ * understood; all cross-inode acquisitions (the shrinker) use trylock.
+ */
+static struct lock_class_key ext4_es_shard_keys[EXT4_ES_NR_SHARDS];
+
+static inline unsigned int es_shard_idx(ext4_lblk_t lblk)
 {
-	tree->root = RB_ROOT;
-	tree->cache_es = NULL;
+	return (lblk >> EXT4_ES_SHARD_GRAN_BITS) & (EXT4_ES_NR_SHARDS - 1);
+}
+
+static inline struct ext4_es_tree *es_shard(struct inode *inode,
+					    ext4_lblk_t lblk)
+{
+	return &EXT4_I(inode)->i_es_tree[es_shard_idx(lblk)];
+}
+
+/* last block of the stripe containing lblk */
+static inline ext4_lblk_t es_stripe_end(ext4_lblk_t lblk)
+{
+	return lblk | ((1 << EXT4_ES_SHARD_GRAN_BITS) - 1);
+}
+
+/* does [lblk, end] fit within a single stripe (hence a single shard)? */
+static inline int es_one_shard(ext4_lblk_t lblk, ext4_lblk_t end)
+{
+	return end <= es_stripe_end(lblk);
+}
+
+static void es_lock_all_shards(struct inode *inode)
+{
+	int i;
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++)
+		write_lock(&EXT4_I(inode)->i_es_tree[i].es_lock);
+}
+
+static void es_unlock_all_shards(struct inode *inode)
+{
+	int i;
+
+	for (i = EXT4_ES_NR_SHARDS - 1; i >= 0; i--)
+		write_unlock(&EXT4_I(inode)->i_es_tree[i].es_lock);
+}
+
+static void es_read_lock_all_shards(struct inode *inode)
+{
+	int i;
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++)
+		read_lock(&EXT4_I(inode)->i_es_tree[i].es_lock);
+}
+
+static void es_read_unlock_all_shards(struct inode *inode)
+{
+	int i;
+
+	for (i = EXT4_ES_NR_SHARDS - 1; i >= 0; i--)
+		read_unlock(&EXT4_I(inode)->i_es_tree[i].es_lock);
+}
+
+/*
+ * Clamp @newes to the stripe-sized chunk [@cur, @cend], adjusting the
+ * physical block for mapped extents.
+ */
+static void es_chunk_extent(struct extent_status *ches,
+			    struct extent_status *newes,
+			    ext4_lblk_t cur, ext4_lblk_t cend)
+{
+	ches->es_lblk = cur;
+	ches->es_len = cend - cur + 1;
+	if (ext4_es_is_written(newes) || ext4_es_is_unwritten(newes))
+		ext4_es_store_pblock_status(ches,
+				ext4_es_pblock(newes) + (cur - newes->es_lblk),
+				ext4_es_status(newes));
+	else
+		ches->es_pblk = newes->es_pblk;
+}
+
+void ext4_es_init_tree(struct ext4_inode_info *ei)
+{
+	int i;
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++) {
+		struct ext4_es_tree *tree = &ei->i_es_tree[i];
+
+		tree->root = RB_ROOT;
+		tree->cache_es = NULL;
+		rwlock_init(&tree->es_lock);
+		lockdep_set_class(&tree->es_lock, &ext4_es_shard_keys[i]);
+	}
 }
 
 #ifdef ES_DEBUG__
@@ -177,17 +278,20 @@ static void ext4_es_print_tree(struct inode *inode)
 {
 	struct ext4_es_tree *tree;
 	struct rb_node *node;
+	int i;
 
 	printk(KERN_DEBUG "status extents for inode %lu:", inode->i_ino);
-	tree = &EXT4_I(inode)->i_es_tree;
-	node = rb_first(&tree->root);
-	while (node) {
-		struct extent_status *es;
-		es = rb_entry(node, struct extent_status, rb_node);
-		printk(KERN_DEBUG " [%u/%u) %llu %x",
-		       es->es_lblk, es->es_len,
-		       ext4_es_pblock(es), ext4_es_status(es));
-		node = rb_next(node);
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++) {
+		tree = &EXT4_I(inode)->i_es_tree[i];
+		node = rb_first(&tree->root);
+		while (node) {
+			struct extent_status *es;
+			es = rb_entry(node, struct extent_status, rb_node);
+			printk(KERN_DEBUG " [%u/%u) %llu %x",
+			       es->es_lblk, es->es_len,
+			       ext4_es_pblock(es), ext4_es_status(es));
+			node = rb_next(node);
+		}
 	}
 	printk(KERN_DEBUG "\n");
 }
@@ -233,6 +337,28 @@ static struct extent_status *__es_tree_search(struct rb_root *root,
 	return NULL;
 }
 
+/*
+ * Find the extent covering @lblk, or the one with the smallest starting
+ * block after it, across all shards.  The stripes of the shards are
+ * disjoint, so picking the candidate with the smallest es_lblk yields
+ * the global successor.  Caller holds all shard locks.
+ */
+static struct extent_status *__es_search_all_shards(struct inode *inode,
+						    ext4_lblk_t lblk)
+{
+	struct extent_status *es = NULL, *es1;
+	int i;
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++) {
+		es1 = __es_tree_search(&EXT4_I(inode)->i_es_tree[i].root,
+				       lblk);
+		if (es1 && (!es || es1->es_lblk < es->es_lblk))
+			es = es1;
+	}
+
+	return es;
+}
+
 /*
  * ext4_es_find_delayed_extent_range: find the 1st delayed extent covering
  * @es->lblk if it exists, otherwise, the next extent after @es->lblk.
@@ -248,14 +374,13 @@ void ext4_es_find_delayed_extent_range(struct inode *inode,
 {
 	struct ext4_es_tree *tree = NULL;
 	struct extent_status *es1 = NULL;
-	struct rb_node *node;
 
 	BUG_ON(es == NULL);
 	BUG_ON(end < lblk);
 	trace_ext4_es_find_delayed_extent_range_enter(inode, lblk);
 
-	read_lock(&EXT4_I(inode)->i_es_lock);
-	tree = &EXT4_I(inode)->i_es_tree;
+	es_read_lock_all_shards(inode);
+	tree = es_shard(inode, lblk);
 
 	/* find extent in cache firstly */
 	es->es_lblk = es->es_len = es->es_pblk = 0;
@@ -269,29 +394,32 @@ void ext4_es_find_delayed_extent_range(struct inode *inode,
 		}
 	}
 
-	es1 = __es_tree_search(&tree->root, lblk);
+	es1 = __es_search_all_shards(inode, lblk);
 
 out:
-	if (es1 && !ext4_es_is_delayed(es1)) {
-		while ((node = rb_next(&es1->rb_node)) != NULL) {
-			es1 = rb_entry(node, struct extent_status, rb_node);
-			if (es1->es_lblk > end) {
-				es1 = NULL;
-				break;
-			}
-			if (ext4_es_is_delayed(es1))
-				break;
+	while (es1 && !ext4_es_is_delayed(es1)) {
+		ext4_lblk_t next = ext4_es_end(es1) + 1;
+
+		if (!next) {
+			/* wrapped past the end of the file range */
+			es1 = NULL;
+			break;
+		}
+		es1 = __es_search_all_shards(inode, next);
+		if (es1 && es1->es_lblk > end) {
+			es1 = NULL;
+			break;
 		}
 	}
 
 	if (es1 && ext4_es_is_delayed(es1)) {
-		tree->cache_es = es1;
+		es_shard(inode, es1->es_lblk)->cache_es = es1;
 		es->es_lblk = es1->es_lblk;
 		es->es_len = es1->es_len;
 		es->es_pblk = es1->es_pblk;
 	}
 
-	read_unlock(&EXT4_I(inode)->i_es_lock);
+	es_read_unlock_all_shards(inode);
 
 	trace_ext4_es_find_delayed_extent_range_exit(inode, es);
 }
@@ -342,13 +470,13 @@ ext4_es_alloc_extent(struct inode *inode, ext4_lblk_t lblk, ext4_lblk_t len,
 	 * We don't count delayed extent because we never try to reclaim them
 	 */
 	if (!ext4_es_is_delayed(es)) {
-		if (!EXT4_I(inode)->i_es_shk_nr++)
+		if (atomic_inc_return(&EXT4_I(inode)->i_es_shk_nr) == 1)
 			ext4_es_list_add(inode);
 		percpu_counter_inc(&EXT4_SB(inode->i_sb)->
 					s_es_stats.es_stats_shk_cnt);
 	}
 
-	EXT4_I(inode)->i_es_all_nr++;
+	atomic_inc(&EXT4_I(inode)->i_es_all_nr);
 	percpu_counter_inc(&EXT4_SB(inode->i_sb)->s_es_stats.es_stats_all_cnt);
 
 	return es;
@@ -356,13 +484,13 @@ ext4_es_alloc_extent(struct inode *inode, ext4_lblk_t lblk, ext4_lblk_t len,
 
 static void ext4_es_free_extent(struct inode *inode, struct extent_status *es)
 {
-	EXT4_I(inode)->i_es_all_nr--;
+	atomic_dec(&EXT4_I(inode)->i_es_all_nr);
 	percpu_counter_dec(&EXT4_SB(inode->i_sb)->s_es_stats.es_stats_all_cnt);
 
 	/* Decrease the shrink counter when this es is not delayed */
 	if (!ext4_es_is_delayed(es)) {
-		BUG_ON(EXT4_I(inode)->i_es_shk_nr == 0);
-		if (!--EXT4_I(inode)->i_es_shk_nr)
+		BUG_ON(atomic_read(&EXT4_I(inode)->i_es_shk_nr) == 0);
+		if (atomic_dec_and_test(&EXT4_I(inode)->i_es_shk_nr))
 			ext4_es_list_del(inode);
 		percpu_counter_dec(&EXT4_SB(inode->i_sb)->
 					s_es_stats.es_stats_shk_cnt);
@@ -411,9 +539,9 @@ static int ext4_es_can_be_merged(struct extent_status *es1,
 }
 
 static struct extent_status *
-ext4_es_try_to_merge_left(struct inode *inode, struct extent_status *es)
+ext4_es_try_to_merge_left(struct inode *inode, struct ext4_es_tree *tree,
+			  struct extent_status *es)
 {
-	struct ext4_es_tree *tree = &EXT4_I(inode)->i_es_tree;
 	struct extent_status *es1;
 	struct rb_node *node;
 
@@ -435,9 +563,9 @@ ext4_es_try_to_merge_left(struct inode *inode, struct extent_status *es)
 }
 
 static struct extent_status *
-ext4_es_try_to_merge_right(struct inode *inode, struct extent_status *es)
+ext4_es_try_to_merge_right(struct inode *inode, struct ext4_es_tree *tree,
+			   struct extent_status *es)
 {
-	struct ext4_es_tree *tree = &EXT4_I(inode)->i_es_tree;
 	struct extent_status *es1;
 	struct rb_node *node;
 
@@ -630,9 +758,13 @@ static inline void ext4_es_insert_extent_check(struct inode *inode,
 }
 #endif
 
-static int __es_insert_extent(struct inode *inode, struct extent_status *newes)
+/*
+ * Insert @newes into @tree.  The caller guarantees that @newes lies
+ * entirely within one of the tree's stripes and holds the shard lock.
+ */
+static int __es_insert_extent(struct inode *inode, struct ext4_es_tree *tree,
+			      struct extent_status *newes)
 {
-	struct ext4_es_tree *tree = &EXT4_I(inode)->i_es_tree;
 	struct rb_node **p = &tree->root.rb_node;
 	struct rb_node *parent = NULL;
 	struct extent_status *es;
@@ -653,14 +785,14 @@ static int __es_insert_extent(struct inode *inode, struct extent_status *newes)
 				    ext4_es_is_unwritten(es))
 					ext4_es_store_pblock(es,
 							     newes->es_pblk);
-				es = ext4_es_try_to_merge_left(inode, es);
+				es = ext4_es_try_to_merge_left(inode, tree, es);
 				goto out;
 			}
 			p = &(*p)->rb_left;
 		} else if (newes->es_lblk > ext4_es_end(es)) {
 			if (ext4_es_can_be_merged(es, newes)) {
 				es->es_len += newes->es_len;
-				es = ext4_es_try_to_merge_right(inode, es);
+				es = ext4_es_try_to_merge_right(inode, tree, es);
 				goto out;
 			}
 			p = &(*p)->rb_right;
@@ -719,20 +851,49 @@ int ext4_es_insert_extent(struct inode *inode, ext4_lblk_t lblk,
 
 	ext4_es_insert_extent_check(inode, &newes);
 
-	write_lock(&EXT4_I(inode)->i_es_lock);
-	err = __es_remove_extent(inode, lblk, end);
-	if (err != 0)
-		goto error;
-retry:
-	err = __es_insert_extent(inode, &newes);
-	if (err == -ENOMEM && __es_shrink(EXT4_SB(inode->i_sb),
-					  128, EXT4_I(inode)))
-		goto retry;
-	if (err == -ENOMEM && !ext4_es_is_delayed(&newes))
-		err = 0;
+	if (es_one_shard(lblk, end)) {
+		struct ext4_es_tree *tree = es_shard(inode, lblk);
 
+		write_lock(&tree->es_lock);
+		err = __es_remove_extent(inode, tree, lblk, end);
+		if (err != 0)
+			goto error;
+retry:
+		err = __es_insert_extent(inode, tree, &newes);
+		if (err == -ENOMEM && __es_shrink(EXT4_SB(inode->i_sb),
+						  128, EXT4_I(inode), tree))
+			goto retry;
+		if (err == -ENOMEM && !ext4_es_is_delayed(&newes))
+			err = 0;
 error:
-	write_unlock(&EXT4_I(inode)->i_es_lock);
+		write_unlock(&tree->es_lock);
+	} else {
+		ext4_lblk_t cur = lblk;
+		int i;
+
+		es_lock_all_shards(inode);
+		for (i = 0; i < EXT4_ES_NR_SHARDS && !err; i++)
+			err = __es_remove_extent(inode,
+						 &EXT4_I(inode)->i_es_tree[i],
+						 lblk, end);
+		while (!err && cur <= end) {
+			struct extent_status ches;
+			ext4_lblk_t cend = min(es_stripe_end(cur), end);
+
+			es_chunk_extent(&ches, &newes, cur, cend);
+retry_chunk:
+			err = __es_insert_extent(inode, es_shard(inode, cur),
+						 &ches);
+			if (err == -ENOMEM &&
+			    __es_shrink(EXT4_SB(inode->i_sb), 128,
+					EXT4_I(inode), NULL))
+				goto retry_chunk;
+			if (err == -ENOMEM && !ext4_es_is_delayed(&ches))
+				err = 0;
+			cur = cend + 1;
+		}
+		es_unlock_all_shards(inode);
+	}
 
 	ext4_es_print_tree(inode);
 
@@ -762,12 +923,32 @@ void ext4_es_cache_extent(struct inode *inode, ext4_lblk_t lblk,
 
 	BUG_ON(end < lblk);
 
-	write_lock(&EXT4_I(inode)->i_es_lock);
+	if (es_one_shard(lblk, end)) {
+		struct ext4_es_tree *tree = es_shard(inode, lblk);
 
-	es = __es_tree_search(&EXT4_I(inode)->i_es_tree.root, lblk);
-	if (!es || es->es_lblk > end)
-		__es_insert_extent(inode, &newes);
-	write_unlock(&EXT4_I(inode)->i_es_lock);
+		write_lock(&tree->es_lock);
+		es = __es_tree_search(&tree->root, lblk);
+		if (!es || es->es_lblk > end)
+			__es_insert_extent(inode, tree, &newes);
+		write_unlock(&tree->es_lock);
+	} else {
+		ext4_lblk_t cur = lblk;
+
+		es_lock_all_shards(inode);
+		es = __es_search_all_shards(inode, lblk);
+		if (!es || es->es_lblk > end) {
+			while (cur <= end) {
+				struct extent_status ches;
+				ext4_lblk_t cend = min(es_stripe_end(cur), end);
+
+				es_chunk_extent(&ches, &newes, cur, cend);
+				__es_insert_extent(inode, es_shard(inode, cur),
+						   &ches);
+				cur = cend + 1;
+			}
+		}
+		es_unlock_all_shards(inode);
+	}
 }
 
 /*
@@ -789,8 +970,8 @@ int ext4_es_lookup_extent(struct inode *inode, ext4_lblk_t lblk,
 	trace_ext4_es_lookup_extent_enter(inode, lblk);
 	es_debug("lookup extent in block %u\n", lblk);
 
-	tree = &EXT4_I(inode)->i_es_tree;
-	read_lock(&EXT4_I(inode)->i_es_lock);
+	tree = es_shard(inode, lblk);
+	read_lock(&tree->es_lock);
 
 	/* find extent in cache firstly */
 	es->es_lblk = es->es_len = es->es_pblk = 0;
@@ -831,16 +1012,15 @@ out:
 		stats->es_stats_cache_misses++;
 	}
 
-	read_unlock(&EXT4_I(inode)->i_es_lock);
+	read_unlock(&tree->es_lock);
 
 	trace_ext4_es_lookup_extent_exit(inode, es, found);
 	return found;
 }
 
-static int __es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
-			      ext4_lblk_t end)
+static int __es_remove_extent(struct inode *inode, struct ext4_es_tree *tree,
+			      ext4_lblk_t lblk, ext4_lblk_t end)
 {
-	struct ext4_es_tree *tree = &EXT4_I(inode)->i_es_tree;
 	struct rb_node *node;
 	struct extent_status *es;
 	struct extent_status orig_es;
@@ -880,13 +1060,13 @@ retry:
 					orig_es.es_len - len2;
 			ext4_es_store_pblock_status(&newes, block,
 						    ext4_es_status(&orig_es));
-			err = __es_insert_extent(inode, &newes);
+			err = __es_insert_extent(inode, tree, &newes);
 			if (err) {
 				es->es_lblk = orig_es.es_lblk;
 				es->es_len = orig_es.es_len;
 				if ((err == -ENOMEM) &&
 				    __es_shrink(EXT4_SB(inode->i_sb),
-							128, EXT4_I(inode)))
+						128, EXT4_I(inode), tree))
 					goto retry;
 				goto out;
 			}
@@ -958,20 +1138,36 @@ int ext4_es_remove_extent(struct inode *inode, ext4_lblk_t lblk,
 	end = lblk + len - 1;
 	BUG_ON(end < lblk);
 
-	/*
-	 * ext4_clear_inode() depends on us taking i_es_lock unconditionally
-	 * so that we are sure __es_shrink() is done with the inode before it
-	 * is reclaimed.
-	 */
-	write_lock(&EXT4_I(inode)->i_es_lock);
-	err = __es_remove_extent(inode, lblk, end);
-	write_unlock(&EXT4_I(inode)->i_es_lock);
+	if (es_one_shard(lblk, end)) {
+		struct ext4_es_tree *tree = es_shard(inode, lblk);
+
+		write_lock(&tree->es_lock);
+		err = __es_remove_extent(inode, tree, lblk, end);
+		write_unlock(&tree->es_lock);
+	} else {
+		int i;
+
+		/*
+		 * ext4_clear_inode() removes the whole range, which takes
+		 * all shard locks unconditionally.  Queueing on shard 0
+		 * here is what makes sure __es_shrink(), which pins an
+		 * inode by holding shard 0, is done with the inode before
+		 * it is reclaimed.
+		 */
+		es_lock_all_shards(inode);
+		for (i = 0; i < EXT4_ES_NR_SHARDS && !err; i++)
+			err = __es_remove_extent(inode,
+						 &EXT4_I(inode)->i_es_tree[i],
+						 lblk, end);
+		es_unlock_all_shards(inode);
+	}
 	ext4_es_print_tree(inode);
 	return err;
 }
 
 static int __es_shrink(struct ext4_sb_info *sbi, int nr_to_scan,
-		       struct ext4_inode_info *locked_ei)
+		       struct ext4_inode_info *locked_ei,
+		       struct ext4_es_tree *locked_tree)
 {
 	struct ext4_inode_info *ei;
 	struct ext4_es_stats *es_stats;
@@ -1007,18 +1203,22 @@ retry:
 			continue;
 		}
 
-		if (ei == locked_ei || !write_trylock(&ei->i_es_lock)) {
+		if (ei == locked_ei ||
+		    !write_trylock(&ei->i_es_tree[0].es_lock)) {
 			nr_skipped++;
 			continue;
 		}
 		/*
-		 * Now we hold i_es_lock which protects us from inode reclaim
-		 * freeing inode under us
+		 * Now we hold shard 0's es_lock which protects us from
+		 * inode reclaim freeing the inode under us: before the
+		 * inode goes away, ext4_clear_inode() has to remove the
+		 * whole range, which queues on shard 0 (see
+		 * ext4_es_remove_extent()).
 		 */
 		spin_unlock(&sbi->s_es_lock);
 
-		nr_shrunk += es_reclaim_extents(ei, &nr_to_scan);
-		write_unlock(&ei->i_es_lock);
+		nr_shrunk += es_shrink_inode(ei, &nr_to_scan);
+		write_unlock(&ei->i_es_tree[0].es_lock);
 
 		if (nr_to_scan <= 0)
 			goto out;
@@ -1036,7 +1236,8 @@ retry:
 	}
 
 	if (locked_ei && nr_shrunk == 0)
-		nr_shrunk = es_reclaim_extents(locked_ei, &nr_to_scan);
+		nr_shrunk = es_reclaim_extents(locked_ei, locked_tree,
+					       &nr_to_scan);
 
 out:
 	scan_time = ktime_to_ns(ktime_sub(ktime_get(), start_time));
@@ -1084,7 +1285,7 @@ static unsigned long ext4_es_scan(struct shrinker *shrink,
 	if (!nr_to_scan)
 		return ret;
 
-	nr_shrunk = __es_shrink(sbi, nr_to_scan, NULL);
+	nr_shrunk = __es_shrink(sbi, nr_to_scan, NULL, NULL);
 
 	trace_ext4_es_shrink_scan_exit(sbi->s_sb, nr_shrunk, ret);
 	return nr_shrunk;
@@ -1104,7 +1305,8 @@ int ext4_seq_es_shrinker_info_show(struct seq_file *seq, void *v)
 	spin_lock(&sbi->s_es_lock);
 	list_for_each_entry(ei, &sbi->s_es_list, i_es_list) {
 		inode_cnt++;
-		if (max && max->i_es_all_nr < ei->i_es_all_nr)
+		if (max && atomic_read(&max->i_es_all_nr) <
+			   atomic_read(&ei->i_es_all_nr))
 			max = ei;
 		else if (!max)
 			max = ei;
@@ -1127,7 +1329,8 @@ int ext4_seq_es_shrinker_info_show(struct seq_file *seq, void *v)
 		seq_printf(seq,
 		    "maximum:\n  %lu inode (%u objects, %u reclaimable)\n"
 		    "  %llu us max scan time\n",
-		    max->vfs_inode.i_ino, max->i_es_all_nr, max->i_es_shk_nr,
+		    max->vfs_inode.i_ino, atomic_read(&max->i_es_all_nr),
+		    atomic_read(&max->i_es_shk_nr),
 		    div_u64(es_stats->es_stats_max_scan_time, 1000));
 
 	return 0;
@@ -1178,18 +1381,19 @@ void ext4_es_unregister_shrinker(struct ext4_sb_info *sbi)
 }
 
 /*
- * Shrink extents in given inode from ei->i_es_shrink_lblk till end. Scan at
- * most *nr_to_scan extents, update *nr_to_scan accordingly.
+ * Shrink extents in the given shard from ei->i_es_shrink_lblk till end.
+ * Scan at most *nr_to_scan extents, update *nr_to_scan accordingly.
  *
  * Return 0 if we hit end of tree / interval, 1 if we exhausted nr_to_scan.
  * Increment *nr_shrunk by the number of reclaimed extents. Also update
- * ei->i_es_shrink_lblk to where we should continue scanning.
+ * ei->i_es_shrink_lblk to where we should continue scanning.  Caller
+ * holds the shard's es_lock.
  */
-static int es_do_reclaim_extents(struct ext4_inode_info *ei, ext4_lblk_t end,
+static int es_do_reclaim_extents(struct ext4_inode_info *ei,
+				 struct ext4_es_tree *tree, ext4_lblk_t end,
 				 int *nr_to_scan, int *nr_shrunk)
 {
 	struct inode *inode = &ei->vfs_inode;
-	struct ext4_es_tree *tree = &ei->i_es_tree;
 	struct extent_status *es;
 	struct rb_node *node;
 
@@ -1231,25 +1435,92 @@ out_wrap:
 	return 0;
 }
 
-static int es_reclaim_extents(struct ext4_inode_info *ei, int *nr_to_scan)
+static int es_reclaim_extents_shard(struct ext4_inode_info *ei,
+				    struct ext4_es_tree *tree, int *nr_to_scan)
 {
-	struct inode *inode = &ei->vfs_inode;
 	int nr_shrunk = 0;
 	ext4_lblk_t start = ei->i_es_shrink_lblk;
+
+	if (!es_do_reclaim_extents(ei, tree, EXT_MAX_BLOCKS, nr_to_scan,
+				   &nr_shrunk) &&
+	    start != 0)
+		es_do_reclaim_extents(ei, tree, start - 1, nr_to_scan,
+				      &nr_shrunk);
+
+	tree->cache_es = NULL;
+	return nr_shrunk;
+}
+
+/*
+ * Reclaim from the shards the caller already holds locked: either the
+ * single @locked_tree, or all of them when @locked_tree is NULL.
+ */
+static int es_reclaim_extents(struct ext4_inode_info *ei,
+			      struct ext4_es_tree *locked_tree,
+			      int *nr_to_scan)
+{
+	struct inode *inode = &ei->vfs_inode;
+	int nr_shrunk = 0;
+	int i;
 	static DEFINE_RATELIMIT_STATE(_rs, DEFAULT_RATELIMIT_INTERVAL,
 				      DEFAULT_RATELIMIT_BURST);
 
-	if (ei->i_es_shk_nr == 0)
+	if (atomic_read(&ei->i_es_shk_nr) == 0)
 		return 0;
 
 	if (ext4_test_inode_state(inode, EXT4_STATE_EXT_PRECACHED) &&
 	    __ratelimit(&_rs))
 		ext4_warning(inode->i_sb, "forced shrink of precached extents");
 
-	if (!es_do_reclaim_extents(ei, EXT_MAX_BLOCKS, nr_to_scan, &nr_shrunk) &&
-	    start != 0)
-		es_do_reclaim_extents(ei, start - 1, nr_to_scan, &nr_shrunk);
+	if (locked_tree)
+		return es_reclaim_extents_shard(ei, locked_tree, nr_to_scan);
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS && *nr_to_scan > 0; i++)
+		nr_shrunk += es_reclaim_extents_shard(ei, &ei->i_es_tree[i],
+						      nr_to_scan);
+	return nr_shrunk;
+}
 
-	ei->i_es_tree.cache_es = NULL;
+/*
+ * Incremental per-shard reclaim pass over one inode, resuming at the
+ * shard and offset where the previous pass ran out of budget.  Caller
+ * holds shard 0's es_lock, which also pins the inode against reclaim;
+ * the other shards are trylocked so the shrinker never queues behind a
+ * busy writer.
+ */
+static int es_shrink_inode(struct ext4_inode_info *ei, int *nr_to_scan)
+{
+	struct inode *inode = &ei->vfs_inode;
+	struct ext4_es_tree *tree;
+	int nr_shrunk = 0;
+	unsigned int i, s = 0;
+	static DEFINE_RATELIMIT_STATE(_rs, DEFAULT_RATELIMIT_INTERVAL,
+				      DEFAULT_RATELIMIT_BURST);
+
+	if (atomic_read(&ei->i_es_shk_nr) == 0)
+		return 0;
+
+	if (ext4_test_inode_state(inode, EXT4_STATE_EXT_PRECACHED) &&
+	    __ratelimit(&_rs))
+		ext4_warning(inode->i_sb, "forced shrink of precached extents");
+
+	for (i = 0; i < EXT4_ES_NR_SHARDS; i++) {
+		s = (ei->i_es_shrink_shard + i) % EXT4_ES_NR_SHARDS;
+		tree = &ei->i_es_tree[s];
+		if (s != 0 && !write_trylock(&tree->es_lock))
+			continue;
+		nr_shrunk += es_reclaim_extents_shard(ei, tree, nr_to_scan);
+		if (s != 0)
+			write_unlock(&tree->es_lock);
+		if (*nr_to_scan <= 0)
+			break;
+	}
+
+	/*
+	 * When the budget ran out mid-shard, i_es_shrink_lblk already
+	 * points at the first unscanned extent of shard s; otherwise
+	 * start the next pass from the beginning.
+	 */
+	ei->i_es_shrink_shard = (i < EXT4_ES_NR_SHARDS) ? s : 0;
 	return nr_shrunk;
 }
@@ -54,6 +54,7 @@ enum {
 			  EXTENT_STATUS_HOLE) << ES_SHIFT)
 
 struct ext4_sb_info;
+struct ext4_inode_info;
 struct ext4_extent;
 
 struct extent_status {
@@ -63,9 +64,22 @@ struct extent_status {
 	ext4_fsblk_t es_pblk;	/* first physical block */
 };
 
+/*
+ * The extent status tree of an inode is sharded by logical block range
+ * to spread lock contention: stripes of 2^EXT4_ES_SHARD_GRAN_BITS
+ * blocks are assigned round-robin to EXT4_ES_NR_SHARDS trees, each
+ * protected by its own es_lock.  Extents are split on stripe boundaries
+ * on insertion, so a tree only ever holds blocks from its own stripes
+ * and a single-block operation takes exactly one shard lock.
+ */
+#define EXT4_ES_SHARD_BITS	2
+#define EXT4_ES_NR_SHARDS	(1 << EXT4_ES_SHARD_BITS)
+#define EXT4_ES_SHARD_GRAN_BITS	15	/* 32768-block stripes */
+
 struct ext4_es_tree {
 	struct rb_root root;
 	struct extent_status *cache_es;	/* recently accessed extent */
+	rwlock_t es_lock;
 };
 
 struct ext4_es_stats {
@@ -80,7 +94,7 @@ struct ext4_es_stats {
 
 extern int __init ext4_init_es(void);
 extern void ext4_exit_es(void);
-extern void ext4_es_init_tree(struct ext4_es_tree *tree);
+extern void ext4_es_init_tree(struct ext4_inode_info *ei);
 
 extern int ext4_es_insert_extent(struct inode *inode, ext4_lblk_t lblk,
 				 ext4_lblk_t len, ext4_fsblk_t pblk,
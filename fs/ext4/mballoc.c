@@ -685,22 +685,37 @@ static void ext4_mb_mark_free_simple(struct super_block *sb,
 
 /*
  * Cache the order of the largest free extent we have available in this block
- * group.
+ * group, and keep the group on the matching largest-free-order list so
+ * that the allocator can jump straight to a group that fits a request.
  */
 static void
 mb_set_largest_free_order(struct super_block *sb, struct ext4_group_info *grp)
 {
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
 	int i;
-	int bits;
-
-	grp->bb_largest_free_order = -1; /* uninit */
 
-	bits = sb->s_blocksize_bits + 1;
-	for (i = bits; i >= 0; i--) {
-		if (grp->bb_counters[i] > 0) {
-			grp->bb_largest_free_order = i;
+	for (i = sb->s_blocksize_bits + 1; i >= 0; i--)
+		if (grp->bb_counters[i] > 0)
 			break;
-		}
+	/* i is -1 (uninit / no free extents) when the loop falls through */
+	if (grp->bb_largest_free_order == i)
+		return;
+
+	if (grp->bb_largest_free_order >= 0) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
+		list_del_init(&grp->bb_largest_free_order_node);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
+	}
+	grp->bb_largest_free_order = i;
+	if (grp->bb_largest_free_order >= 0 && grp->bb_free) {
+		write_lock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
+		list_add_tail(&grp->bb_largest_free_order_node,
+		      &sbi->s_mb_largest_free_orders[grp->bb_largest_free_order]);
+		write_unlock(&sbi->s_mb_largest_free_orders_locks[
+					      grp->bb_largest_free_order]);
 	}
 }
 
@@ -1666,12 +1681,14 @@ static void ext4_mb_use_best_found(struct ext4_allocation_context *ac,
 	get_page(ac->ac_bitmap_page);
 	ac->ac_buddy_page = e4b->bd_buddy_page;
 	get_page(ac->ac_buddy_page);
-	/* store last allocated for subsequent stream allocation */
+	/*
+	 * Store last allocated for subsequent stream allocation.  The
+	 * goal is per-CPU so parallel streaming writers each follow
+	 * their own stream without bouncing a shared lock.
+	 */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		spin_lock(&sbi->s_md_lock);
-		sbi->s_mb_last_group = ac->ac_f_ex.fe_group;
-		sbi->s_mb_last_start = ac->ac_f_ex.fe_start;
-		spin_unlock(&sbi->s_md_lock);
+		this_cpu_write(sbi->s_mb_last->group, ac->ac_f_ex.fe_group);
+		this_cpu_write(sbi->s_mb_last->start, ac->ac_f_ex.fe_start);
 	}
 }
 
@@ -2094,6 +2111,45 @@ static int ext4_mb_good_group(struct ext4_allocation_context *ac,
 	return 0;
 }
 
+/*
+ * Pick a starting group for the cr 0/1 scan from the largest-free-order
+ * index instead of crawling linearly over groups that cannot satisfy
+ * the request.  Only a brief per-order read lock is taken - no group
+ * locks, no buddy loads; the caller re-validates the group under its
+ * lock as usual.  Falls back to @goal when the index has no candidate
+ * (e.g. buddies not initialized yet).
+ */
+static ext4_group_t ext4_mb_suggest_group(struct ext4_allocation_context *ac,
+					  int cr, ext4_group_t goal)
+{
+	struct super_block *sb = ac->ac_sb;
+	struct ext4_sb_info *sbi = EXT4_SB(sb);
+	struct ext4_group_info *grp;
+	int order, min_order;
+
+	if (cr == 0)
+		min_order = ac->ac_2order;
+	else
+		min_order = fls(ac->ac_g_ex.fe_len);
+	if (min_order < 0)
+		min_order = 0;
+
+	for (order = min_order; order < MB_NUM_ORDERS(sb); order++) {
+		if (list_empty(&sbi->s_mb_largest_free_orders[order]))
+			continue;
+		read_lock(&sbi->s_mb_largest_free_orders_locks[order]);
+		grp = list_first_entry_or_null(
+				&sbi->s_mb_largest_free_orders[order],
+				struct ext4_group_info,
+				bb_largest_free_order_node);
+		read_unlock(&sbi->s_mb_largest_free_orders_locks[order]);
+		if (grp)
+			return grp->bb_group;
+	}
+
+	return goal;
+}
+
 static noinline_for_stack int
 ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 {
@@ -2143,13 +2199,10 @@ ext4_mb_regular_allocator(struct ext4_allocation_context *ac)
 			ac->ac_2order = i - 1;
 	}
 
-	/* if stream allocation is enabled, use global goal */
+	/* if stream allocation is enabled, use this CPU's stream goal */
 	if (ac->ac_flags & EXT4_MB_STREAM_ALLOC) {
-		/* TBD: may be hot point */
-		spin_lock(&sbi->s_md_lock);
-		ac->ac_g_ex.fe_group = sbi->s_mb_last_group;
-		ac->ac_g_ex.fe_start = sbi->s_mb_last_start;
-		spin_unlock(&sbi->s_md_lock);
+		ac->ac_g_ex.fe_group = this_cpu_read(sbi->s_mb_last->group);
+		ac->ac_g_ex.fe_start = this_cpu_read(sbi->s_mb_last->start);
 	}
 
 	/* Let's just scan groups to find more-less suitable blocks */
@@ -2166,6 +2219,14 @@ repeat:
 		 * from the goal value specified
 		 */
 		group = ac->ac_g_ex.fe_group;
+		/*
+		 * On the selective passes, start from a group the
+		 * freespace index says can fit the request; the linear
+		 * scan below continues from there if it does not pan
+		 * out.
+		 */
+		if (cr < 2)
+			group = ext4_mb_suggest_group(ac, cr, group);
 
 		for (i = 0; i < ngroups; group++, i++) {
 			int ret = 0;
@@ -2455,7 +2516,9 @@ int ext4_mb_add_groupinfo(struct super_block *sb, ext4_group_t group,
 	INIT_LIST_HEAD(&meta_group_info[i]->bb_prealloc_list);
 	init_rwsem(&meta_group_info[i]->alloc_sem);
 	meta_group_info[i]->bb_free_root = RB_ROOT;
+	INIT_LIST_HEAD(&meta_group_info[i]->bb_largest_free_order_node);
 	meta_group_info[i]->bb_largest_free_order = -1;  /* uninit */
+	meta_group_info[i]->bb_group = group;
 
 #ifdef DOUBLE_CHECK
 	{
@@ -2663,6 +2726,31 @@ int ext4_mb_init(struct super_block *sb)
 			sbi->s_mb_group_prealloc, sbi->s_stripe);
 	}
 
+	sbi->s_mb_largest_free_orders =
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(struct list_head),
+			      GFP_KERNEL);
+	if (!sbi->s_mb_largest_free_orders) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	sbi->s_mb_largest_free_orders_locks =
+		kmalloc_array(MB_NUM_ORDERS(sb), sizeof(rwlock_t),
+			      GFP_KERNEL);
+	if (!sbi->s_mb_largest_free_orders_locks) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	for (i = 0; i < MB_NUM_ORDERS(sb); i++) {
+		INIT_LIST_HEAD(&sbi->s_mb_largest_free_orders[i]);
+		rwlock_init(&sbi->s_mb_largest_free_orders_locks[i]);
+	}
+
+	sbi->s_mb_last = alloc_percpu(struct ext4_mb_stream_goal);
+	if (sbi->s_mb_last == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 	sbi->s_locality_groups = alloc_percpu(struct ext4_locality_group);
 	if (sbi->s_locality_groups == NULL) {
 		ret = -ENOMEM;
@@ -2688,6 +2776,12 @@ out_free_locality_groups:
 	free_percpu(sbi->s_locality_groups);
 	sbi->s_locality_groups = NULL;
 out:
+	free_percpu(sbi->s_mb_last);
+	sbi->s_mb_last = NULL;
+	kfree(sbi->s_mb_largest_free_orders);
+	sbi->s_mb_largest_free_orders = NULL;
+	kfree(sbi->s_mb_largest_free_orders_locks);
+	sbi->s_mb_largest_free_orders_locks = NULL;
 	kfree(sbi->s_mb_offsets);
 	sbi->s_mb_offsets = NULL;
 	kfree(sbi->s_mb_maxs);
@@ -2740,6 +2834,8 @@ int ext4_mb_release(struct super_block *sb)
 			kfree(sbi->s_group_info[i]);
 		kvfree(sbi->s_group_info);
 	}
+	kfree(sbi->s_mb_largest_free_orders);
+	kfree(sbi->s_mb_largest_free_orders_locks);
 	kfree(sbi->s_mb_offsets);
 	kfree(sbi->s_mb_maxs);
 	iput(sbi->s_buddy_cache);
@@ -2768,6 +2864,7 @@ int ext4_mb_release(struct super_block *sb)
 	}
 
 	free_percpu(sbi->s_locality_groups);
+	free_percpu(sbi->s_mb_last);
 
 	return 0;
 }
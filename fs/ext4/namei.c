@@ -979,6 +979,8 @@ static int htree_dirblock_to_tree(struct file *dir_file,
 	if (IS_ERR(bh))
 		return PTR_ERR(bh);
 
+	ext4_dir_itable_readahead(dir->i_sb, bh);
+
 	de = (struct ext4_dir_entry_2 *) bh->b_data;
 	top = (struct ext4_dir_entry_2 *) ((char *) de +
 					   dir->i_sb->s_blocksize -
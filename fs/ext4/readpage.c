@@ -171,10 +171,17 @@ int ext4_mpage_readpages(struct address_space *mapping,
 
 		/*
 		 * Then do more ext4_map_blocks() calls until we are
-		 * done with this page.
+		 * done with this page.  A lookup that finds nothing
+		 * reports the length of the hole in map.m_len, so we
+		 * can skip straight over it instead of asking again
+		 * for every block; mapped carry-over from a previous
+		 * lookup was already consumed above.
 		 */
 		while (page_block < blocks_per_page) {
-			if (block_in_file < last_block) {
+			if (block_in_file < last_block &&
+			    ((map.m_flags & EXT4_MAP_MAPPED) ||
+			     block_in_file < map.m_lblk ||
+			     block_in_file >= map.m_lblk + map.m_len)) {
 				map.m_lblk = block_in_file;
 				map.m_len = last_block - block_in_file;
 
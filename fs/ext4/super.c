@@ -973,12 +973,12 @@ static struct inode *ext4_alloc_inode(struct super_block *sb)
 	spin_lock_init(&ei->i_raw_lock);
 	INIT_LIST_HEAD(&ei->i_prealloc_list);
 	spin_lock_init(&ei->i_prealloc_lock);
-	ext4_es_init_tree(&ei->i_es_tree);
-	rwlock_init(&ei->i_es_lock);
+	ext4_es_init_tree(ei);
 	INIT_LIST_HEAD(&ei->i_es_list);
-	ei->i_es_all_nr = 0;
-	ei->i_es_shk_nr = 0;
+	atomic_set(&ei->i_es_all_nr, 0);
+	atomic_set(&ei->i_es_shk_nr, 0);
 	ei->i_es_shrink_lblk = 0;
+	ei->i_es_shrink_shard = 0;
 	ei->i_reserved_data_blocks = 0;
 	ei->i_da_metadata_calc_len = 0;
 	ei->i_da_metadata_calc_last_lblock = 0;
@@ -2402,11 +2402,70 @@ static int ext4_check_descriptors(struct super_block *sb,
  * e2fsck was run on this filesystem, and it must have already done the orphan
  * inode cleanup for us, so we can safely abort without any further action.
  */
+/*
+ * Process one inode off the orphan chain: finish the interrupted
+ * truncate if it is still linked, otherwise let iput() complete the
+ * deletion.  Runs on the orphan cleanup workqueue so that independent
+ * inodes are handled in parallel; the chain itself stays consistent
+ * because ext4_orphan_del() journals each unlink just as it would at
+ * runtime.
+ */
+static void ext4_process_orphan(struct inode *inode,
+				atomic_t *nr_orphans, atomic_t *nr_truncates)
+{
+	struct super_block *sb = inode->i_sb;
+	int ret;
+
+	if (inode->i_nlink) {
+		if (test_opt(sb, DEBUG))
+			ext4_msg(sb, KERN_DEBUG,
+				"%s: truncating inode %lu to %lld bytes",
+				__func__, inode->i_ino, inode->i_size);
+		jbd_debug(2, "truncating inode %lu to %lld bytes\n",
+			  inode->i_ino, inode->i_size);
+		inode_lock(inode);
+		truncate_inode_pages(inode->i_mapping, inode->i_size);
+		ret = ext4_truncate(inode);
+		if (ret)
+			ext4_std_error(inode->i_sb, ret);
+		inode_unlock(inode);
+		atomic_inc(nr_truncates);
+	} else {
+		if (test_opt(sb, DEBUG))
+			ext4_msg(sb, KERN_DEBUG,
+				"%s: deleting unreferenced inode %lu",
+				__func__, inode->i_ino);
+		jbd_debug(2, "deleting unreferenced inode %lu\n",
+			  inode->i_ino);
+		atomic_inc(nr_orphans);
+	}
+	iput(inode);  /* The delete magic happens here! */
+}
+
+struct ext4_orphan_work {
+	struct work_struct work;
+	struct inode *inode;
+	atomic_t *nr_orphans;
+	atomic_t *nr_truncates;
+};
+
+static void ext4_orphan_cleanup_work(struct work_struct *work)
+{
+	struct ext4_orphan_work *ow =
+		container_of(work, struct ext4_orphan_work, work);
+
+	ext4_process_orphan(ow->inode, ow->nr_orphans, ow->nr_truncates);
+	kfree(ow);
+}
+
 static void ext4_orphan_cleanup(struct super_block *sb,
 				struct ext4_super_block *es)
 {
 	unsigned int s_flags = sb->s_flags;
-	int ret, nr_orphans = 0, nr_truncates = 0;
+	struct workqueue_struct *wq;
+	atomic_t nr_orphans = ATOMIC_INIT(0), nr_truncates = ATOMIC_INIT(0);
+	bool aborted = false;
+	__u32 next_ino;
 #ifdef CONFIG_QUOTA
 	int quota_update = 0;
 	int i;
@@ -2477,8 +2536,20 @@ static void ext4_orphan_cleanup(struct super_block *sb,
 	}
 #endif
 
-	while (es->s_last_orphan) {
+	/*
+	 * Walk the on-disk chain with our own cursor and farm the
+	 * truncates/deletions out to a worker pool.  The inodes are
+	 * added at the tail of the in-memory orphan list so that it
+	 * mirrors the on-disk chain order; ext4_orphan_del() then keeps
+	 * the chain consistent no matter in which order the workers
+	 * finish, exactly as for deletions during normal operation.
+	 */
+	wq = alloc_workqueue("ext4-orphan-cleanup", WQ_UNBOUND, 0);
+
+	next_ino = le32_to_cpu(es->s_last_orphan);
+	while (next_ino) {
 		struct inode *inode;
+		struct ext4_orphan_work *ow;
 
 		/*
 		 * We may have encountered an error during cleanup; if
@@ -2486,52 +2557,55 @@ static void ext4_orphan_cleanup(struct super_block *sb,
 		 */
 		if (EXT4_SB(sb)->s_mount_state & EXT4_ERROR_FS) {
 			jbd_debug(1, "Skipping orphan recovery on fs with errors.\n");
-			es->s_last_orphan = 0;
+			aborted = true;
 			break;
 		}
 
-		inode = ext4_orphan_get(sb, le32_to_cpu(es->s_last_orphan));
+		inode = ext4_orphan_get(sb, next_ino);
 		if (IS_ERR(inode)) {
-			es->s_last_orphan = 0;
+			aborted = true;
 			break;
 		}
 
-		list_add(&EXT4_I(inode)->i_orphan, &EXT4_SB(sb)->s_orphan);
+		mutex_lock(&EXT4_SB(sb)->s_orphan_lock);
+		list_add_tail(&EXT4_I(inode)->i_orphan, &EXT4_SB(sb)->s_orphan);
+		mutex_unlock(&EXT4_SB(sb)->s_orphan_lock);
 		dquot_initialize(inode);
-		if (inode->i_nlink) {
-			if (test_opt(sb, DEBUG))
-				ext4_msg(sb, KERN_DEBUG,
-					"%s: truncating inode %lu to %lld bytes",
-					__func__, inode->i_ino, inode->i_size);
-			jbd_debug(2, "truncating inode %lu to %lld bytes\n",
-				  inode->i_ino, inode->i_size);
-			inode_lock(inode);
-			truncate_inode_pages(inode->i_mapping, inode->i_size);
-			ret = ext4_truncate(inode);
-			if (ret)
-				ext4_std_error(inode->i_sb, ret);
-			inode_unlock(inode);
-			nr_truncates++;
+		/* i_dtime carries the next orphan in the chain */
+		next_ino = EXT4_I(inode)->i_dtime;
+
+		ow = wq ? kmalloc(sizeof(*ow), GFP_KERNEL) : NULL;
+		if (ow) {
+			INIT_WORK(&ow->work, ext4_orphan_cleanup_work);
+			ow->inode = inode;
+			ow->nr_orphans = &nr_orphans;
+			ow->nr_truncates = &nr_truncates;
+			queue_work(wq, &ow->work);
 		} else {
-			if (test_opt(sb, DEBUG))
-				ext4_msg(sb, KERN_DEBUG,
-					"%s: deleting unreferenced inode %lu",
-					__func__, inode->i_ino);
-			jbd_debug(2, "deleting unreferenced inode %lu\n",
-				  inode->i_ino);
-			nr_orphans++;
+			ext4_process_orphan(inode, &nr_orphans,
+					    &nr_truncates);
 		}
-		iput(inode);  /* The delete magic happens here! */
 	}
 
+	if (wq) {
+		flush_workqueue(wq);
+		destroy_workqueue(wq);
+	}
+	/*
+	 * Only clear the chain head once the workers are done with it:
+	 * their ext4_orphan_del() calls update es->s_last_orphan.
+	 */
+	if (aborted)
+		es->s_last_orphan = 0;
+
 #define PLURAL(x) (x), ((x) == 1) ? "" : "s"
 
-	if (nr_orphans)
+	if (atomic_read(&nr_orphans))
 		ext4_msg(sb, KERN_INFO, "%d orphan inode%s deleted",
-		       PLURAL(nr_orphans));
-	if (nr_truncates)
+		       PLURAL(atomic_read(&nr_orphans)));
+	if (atomic_read(&nr_truncates))
 		ext4_msg(sb, KERN_INFO, "%d truncate%s cleaned up",
-		       PLURAL(nr_truncates));
+		       PLURAL(atomic_read(&nr_truncates)));
 #ifdef CONFIG_QUOTA
 	/* Turn off quotas if they were enabled for orphan cleanup */
 	if (quota_update) {
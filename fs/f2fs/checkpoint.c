@@ -1369,6 +1369,14 @@ int write_checkpoint(struct f2fs_sb_info *sbi, struct cp_control *cpc)
 		goto out;
 	}
 
+	/*
+	 * Pull in the NAT/SIT blocks that the flushes below will want
+	 * while operations are still running, so the frozen window
+	 * does not include their synchronous meta reads.
+	 */
+	ra_dirty_nat_pages(sbi);
+	ra_dirty_sit_pages(sbi);
+
 	trace_f2fs_write_checkpoint(sbi->sb, cpc->reason, "start block_ops");
 
 	err = block_operations(sbi);
@@ -79,7 +79,13 @@ static int gc_thread_func(void *data)
 		if (!mutex_trylock(&sbi->gc_mutex))
 			goto next;
 
-		if (gc_th->gc_urgent) {
+		/*
+		 * Go urgent either on request from sysfs or once free
+		 * sections run low: reclaiming while there is still
+		 * headroom is what keeps foreground GC from having to
+		 * throttle writers under sustained ingest.
+		 */
+		if (gc_th->gc_urgent || has_low_free_secs(sbi)) {
 			wait_ms = gc_th->urgent_sleep_time;
 			goto do_gc;
 		}
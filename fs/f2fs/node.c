@@ -2523,6 +2523,35 @@ static void __flush_nat_entry_set(struct f2fs_sb_info *sbi,
 	}
 }
 
+/*
+ * Read ahead the NAT blocks backing the dirty NAT sets, so that the
+ * flush during checkpoint does not stall on synchronous meta reads
+ * while operations are blocked.  Best effort: sets that end up in the
+ * journal, or get dirtied after this pass, just miss the readahead.
+ */
+void ra_dirty_nat_pages(struct f2fs_sb_info *sbi)
+{
+	struct f2fs_nm_info *nm_i = NM_I(sbi);
+	struct nat_entry_set *setvec[SETVEC_SIZE];
+	unsigned int found;
+	nid_t set_idx = 0;
+
+	if (!nm_i->dirty_nat_cnt)
+		return;
+
+	down_read(&nm_i->nat_tree_lock);
+	while ((found = __gang_lookup_nat_set(nm_i,
+					set_idx, SETVEC_SIZE, setvec))) {
+		unsigned int idx;
+
+		set_idx = setvec[found - 1]->set + 1;
+		for (idx = 0; idx < found; idx++)
+			ra_meta_pages(sbi, setvec[idx]->set, 1,
+							META_NAT, false);
+	}
+	up_read(&nm_i->nat_tree_lock);
+}
+
 /*
  * This function is called during the checkpointing process.
  */
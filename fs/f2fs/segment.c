@@ -473,6 +473,10 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi, bool need)
 	if (has_not_enough_free_secs(sbi, 0, 0)) {
 		mutex_lock(&sbi->gc_mutex);
 		f2fs_gc(sbi, false, false, NULL_SEGNO);
+	} else if (has_low_free_secs(sbi) && sbi->gc_thread) {
+		/* free sections are running low - get background GC going */
+		sbi->gc_thread->gc_wake = 1;
+		wake_up_interruptible_all(&sbi->gc_thread->gc_wait_queue_head);
 	}
 }
 
@@ -3208,6 +3212,33 @@ static void remove_sits_in_journal(struct f2fs_sb_info *sbi)
 	up_write(&curseg->journal_rwsem);
 }
 
+/*
+ * Read ahead the SIT blocks backing the dirty segment entries, so the
+ * flush during checkpoint does not stall on synchronous meta reads
+ * while operations are blocked.  The bitmap is scanned without
+ * sentry_lock; this is only a readahead hint and stale hits are
+ * harmless.
+ */
+void ra_dirty_sit_pages(struct f2fs_sb_info *sbi)
+{
+	struct sit_info *sit_i = SIT_I(sbi);
+	unsigned int last_blk = ~0U;
+	unsigned int segno;
+
+	if (!sit_i->dirty_sentries)
+		return;
+
+	for_each_set_bit(segno, sit_i->dirty_sentries_bitmap,
+						MAIN_SEGS(sbi)) {
+		unsigned int blk = SIT_BLOCK_OFFSET(segno);
+
+		if (blk == last_blk)
+			continue;
+		ra_meta_pages(sbi, blk, 1, META_SIT, false);
+		last_blk = blk;
+	}
+}
+
 /*
  * CP calls this function, which flushes SIT entries including sit_journal,
  * and moves prefree segs to free segs.
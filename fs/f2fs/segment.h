@@ -567,6 +567,19 @@ static inline bool has_not_enough_free_secs(struct f2fs_sb_info *sbi,
 		reserved_sections(sbi) + needed);
 }
 
+/*
+ * Soft watermark for background GC urgency: once the pool of free
+ * sections falls under twice the reserved count, GC should stop
+ * waiting for idle I/O before foreground GC has to throttle writers.
+ */
+static inline bool has_low_free_secs(struct f2fs_sb_info *sbi)
+{
+	if (unlikely(is_sbi_flag_set(sbi, SBI_POR_DOING)))
+		return false;
+
+	return free_sections(sbi) <= 2 * reserved_sections(sbi);
+}
+
 static inline bool excess_prefree_segs(struct f2fs_sb_info *sbi)
 {
 	return prefree_segments(sbi) > SM_I(sbi)->rec_prefree_segments;
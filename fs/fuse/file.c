@@ -326,31 +326,44 @@ u64 fuse_lock_owner_id(struct fuse_conn *fc, fl_owner_t id)
 }
 
 /*
- * Check if any page in a range is under writeback
+ * Find a writepage request intersecting a page range.
  *
- * This is currently done by walking the list of writepage requests
- * for the inode, which can be pretty inefficient.
+ * Called with fc->lock held.
+ */
+static struct fuse_req *fuse_find_writeback(struct fuse_inode *fi,
+					    pgoff_t idx_from, pgoff_t idx_to)
+{
+	struct rb_node *n = fi->writepages.rb_node;
+
+	while (n) {
+		struct fuse_req *req;
+		pgoff_t curr_index;
+
+		req = rb_entry(n, struct fuse_req, writepages_entry);
+		curr_index = req->misc.write.in.offset >> PAGE_SHIFT;
+		if (idx_from >= curr_index + req->num_pages)
+			n = n->rb_right;
+		else if (idx_to < curr_index)
+			n = n->rb_left;
+		else
+			return req;
+	}
+
+	return NULL;
+}
+
+/*
+ * Check if any page in a range is under writeback
  */
 static bool fuse_range_is_writeback(struct inode *inode, pgoff_t idx_from,
 				   pgoff_t idx_to)
 {
 	struct fuse_conn *fc = get_fuse_conn(inode);
 	struct fuse_inode *fi = get_fuse_inode(inode);
-	struct fuse_req *req;
-	bool found = false;
+	bool found;
 
 	spin_lock(&fc->lock);
-	list_for_each_entry(req, &fi->writepages, writepages_entry) {
-		pgoff_t curr_index;
-
-		BUG_ON(req->inode != inode);
-		curr_index = req->misc.write.in.offset >> PAGE_SHIFT;
-		if (idx_from < curr_index + req->num_pages &&
-		    curr_index <= idx_to) {
-			found = true;
-			break;
-		}
-	}
+	found = fuse_find_writeback(fi, idx_from, idx_to) != NULL;
 	spin_unlock(&fc->lock);
 
 	return found;
@@ -1460,6 +1473,49 @@ static void fuse_writepage_free(struct fuse_conn *fc, struct fuse_req *req)
 		fuse_file_put(req->ff, false);
 }
 
+/*
+ * Insert a writepage request into fi->writepages.  Requests never
+ * intersect; if an intersecting request is already in the tree, leave
+ * the tree unchanged and return it, otherwise return NULL.
+ *
+ * Called with fc->lock held.
+ */
+static struct fuse_req *fuse_insert_writeback(struct rb_root *root,
+					      struct fuse_req *req)
+{
+	pgoff_t idx_from = req->misc.write.in.offset >> PAGE_SHIFT;
+	pgoff_t idx_to = idx_from + req->num_pages - 1;
+	struct rb_node **p = &root->rb_node;
+	struct rb_node  *parent = NULL;
+
+	WARN_ON(!req->num_pages);
+	while (*p) {
+		struct fuse_req *curr;
+		pgoff_t curr_index;
+
+		parent = *p;
+		curr = rb_entry(parent, struct fuse_req, writepages_entry);
+		BUG_ON(curr->inode != req->inode);
+		curr_index = curr->misc.write.in.offset >> PAGE_SHIFT;
+
+		if (idx_from >= curr_index + curr->num_pages)
+			p = &(*p)->rb_right;
+		else if (idx_to < curr_index)
+			p = &(*p)->rb_left;
+		else
+			return curr;
+	}
+
+	rb_link_node(&req->writepages_entry, parent, p);
+	rb_insert_color(&req->writepages_entry, root);
+	return NULL;
+}
+
+static void tree_insert(struct rb_root *root, struct fuse_req *req)
+{
+	WARN_ON(fuse_insert_writeback(root, req));
+}
+
 static void fuse_writepage_finish(struct fuse_conn *fc, struct fuse_req *req)
 {
 	struct inode *inode = req->inode;
@@ -1467,7 +1523,6 @@ static void fuse_writepage_finish(struct fuse_conn *fc, struct fuse_req *req)
 	struct backing_dev_info *bdi = inode_to_bdi(inode);
 	int i;
 
-	list_del(&req->writepages_entry);
 	for (i = 0; i < req->num_pages; i++) {
 		dec_wb_stat(&bdi->wb, WB_WRITEBACK);
 		dec_node_page_state(req->pages[i], NR_WRITEBACK_TEMP);
@@ -1504,6 +1559,7 @@ __acquires(fc->lock)
 	return;
 
  out_free:
+	rb_erase(&req->writepages_entry, &fi->writepages);
 	fuse_writepage_finish(fc, req);
 	spin_unlock(&fc->lock);
 	fuse_writepage_free(fc, req);
@@ -1540,6 +1596,7 @@ static void fuse_writepage_end(struct fuse_conn *fc, struct fuse_req *req)
 
 	mapping_set_error(inode->i_mapping, req->out.h.error);
 	spin_lock(&fc->lock);
+	rb_erase(&req->writepages_entry, &fi->writepages);
 	while (req->misc.write.next) {
 		struct fuse_conn *fc = get_fuse_conn(inode);
 		struct fuse_write_in *inarg = &req->misc.write.in;
@@ -1547,7 +1604,7 @@ static void fuse_writepage_end(struct fuse_conn *fc, struct fuse_req *req)
 		req->misc.write.next = next->misc.write.next;
 		next->misc.write.next = NULL;
 		next->ff = fuse_file_get(req->ff);
-		list_add(&next->writepages_entry, &fi->writepages);
+		tree_insert(&fi->writepages, next);
 
 		/*
 		 * Skip fuse_flush_writepages() to make it easy to crop requests
@@ -1663,7 +1720,7 @@ static int fuse_writepage_locked(struct page *page)
 	inc_node_page_state(tmp_page, NR_WRITEBACK_TEMP);
 
 	spin_lock(&fc->lock);
-	list_add(&req->writepages_entry, &fi->writepages);
+	tree_insert(&fi->writepages, req);
 	list_add_tail(&req->list, &fi->queued_writes);
 	fuse_flush_writepages(inode);
 	spin_unlock(&fc->lock);
@@ -1737,25 +1794,15 @@ static bool fuse_writepage_in_flight(struct fuse_req *new_req,
 	struct fuse_inode *fi = get_fuse_inode(new_req->inode);
 	struct fuse_req *tmp;
 	struct fuse_req *old_req;
-	bool found = false;
 	pgoff_t curr_index;
 
 	BUG_ON(new_req->num_pages != 0);
 
 	spin_lock(&fc->lock);
-	list_del(&new_req->writepages_entry);
-	list_for_each_entry(old_req, &fi->writepages, writepages_entry) {
-		BUG_ON(old_req->inode != new_req->inode);
-		curr_index = old_req->misc.write.in.offset >> PAGE_SHIFT;
-		if (curr_index <= page->index &&
-		    page->index < curr_index + old_req->num_pages) {
-			found = true;
-			break;
-		}
-	}
-	if (!found) {
-		list_add(&new_req->writepages_entry, &fi->writepages);
-		goto out_unlock;
+	old_req = fuse_find_writeback(fi, page->index, page->index);
+	if (!old_req) {
+		spin_unlock(&fc->lock);
+		return false;
 	}
 
 	new_req->num_pages = 1;
@@ -1779,15 +1826,13 @@ static bool fuse_writepage_in_flight(struct fuse_req *new_req,
 		wb_writeout_inc(&bdi->wb);
 		fuse_writepage_free(fc, new_req);
 		fuse_request_free(new_req);
-		goto out;
 	} else {
 		new_req->misc.write.next = old_req->misc.write.next;
 		old_req->misc.write.next = new_req;
+		spin_unlock(&fc->lock);
 	}
-out_unlock:
-	spin_unlock(&fc->lock);
-out:
-	return found;
+
+	return true;
 }
 
 static int fuse_writepages_fill(struct page *page,
@@ -1837,13 +1882,11 @@ static int fuse_writepages_fill(struct page *page,
 	 * This is ensured by holding the page lock in page_mkwrite() while
 	 * checking fuse_page_is_writeback().  We already hold the page lock
 	 * since clear_page_dirty_for_io() and keep it held until we add the
-	 * request to the fi->writepages list and increment req->num_pages.
+	 * request to fi->writepages and increment req->num_pages.
 	 * After this fuse_page_is_writeback() will indicate that the page is
 	 * under writeback, so we can release the page lock.
 	 */
 	if (data->req == NULL) {
-		struct fuse_inode *fi = get_fuse_inode(inode);
-
 		err = -ENOMEM;
 		req = fuse_request_alloc_nofs(FUSE_MAX_PAGES_PER_REQ);
 		if (!req) {
@@ -1860,10 +1903,6 @@ static int fuse_writepages_fill(struct page *page,
 		req->end = fuse_writepage_end;
 		req->inode = inode;
 
-		spin_lock(&fc->lock);
-		list_add(&req->writepages_entry, &fi->writepages);
-		spin_unlock(&fc->lock);
-
 		data->req = req;
 	}
 	set_page_writeback(page);
@@ -1886,10 +1925,13 @@ static int fuse_writepages_fill(struct page *page,
 
 	/*
 	 * Protected by fc->lock against concurrent access by
-	 * fuse_page_is_writeback().
+	 * fuse_page_is_writeback().  The request becomes visible in
+	 * fi->writepages once its first page is added.
 	 */
 	spin_lock(&fc->lock);
 	req->num_pages++;
+	if (req->num_pages == 1)
+		tree_insert(&get_fuse_inode(inode)->writepages, req);
 	spin_unlock(&fc->lock);
 
 out_unlock:
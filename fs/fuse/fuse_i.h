@@ -99,8 +99,8 @@ struct fuse_inode {
 	/** Waitq for writepage completion */
 	wait_queue_head_t page_waitq;
 
-	/** List of writepage requestst (pending or sent) */
-	struct list_head writepages;
+	/** Rb tree of writepage requests (pending or sent) */
+	struct rb_root writepages;
 
 	/** Miscellaneous bits describing inode state */
 	unsigned long state;
@@ -373,8 +373,8 @@ struct fuse_req {
 	/** AIO control block */
 	struct fuse_io_priv *io;
 
-	/** Link on fi->writepages */
-	struct list_head writepages_entry;
+	/** Entry on fi->writepages */
+	struct rb_node writepages_entry;
 
 	/** Request completion callback */
 	void (*end)(struct fuse_conn *, struct fuse_req *);
@@ -387,6 +387,9 @@ struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
 
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
 	/** Readers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
@@ -34,6 +34,7 @@
 #include <linux/bit_spinlock.h>
 #include <linux/percpu.h>
 #include <linux/list_sort.h>
+#include <linux/list_lru.h>
 #include <linux/lockref.h>
 #include <linux/rhashtable.h>
 
@@ -65,9 +66,7 @@ static void do_xmote(struct gfs2_glock *gl, struct gfs2_holder *gh, unsigned int
 static struct dentry *gfs2_root;
 static struct workqueue_struct *glock_workqueue;
 struct workqueue_struct *gfs2_delete_workqueue;
-static LIST_HEAD(lru_list);
-static atomic_t lru_count = ATOMIC_INIT(0);
-static DEFINE_SPINLOCK(lru_lock);
+static struct list_lru glock_lru;
 
 #define GFS2_GL_HASH_SHIFT      15
 #define GFS2_GL_HASH_SIZE       BIT(GFS2_GL_HASH_SHIFT)
@@ -183,16 +182,10 @@ static int demote_ok(const struct gfs2_glock *gl)
 
 void gfs2_glock_add_to_lru(struct gfs2_glock *gl)
 {
-	spin_lock(&lru_lock);
-
-	if (!list_empty(&gl->gl_lru))
-		list_del_init(&gl->gl_lru);
-	else
-		atomic_inc(&lru_count);
-
-	list_add_tail(&gl->gl_lru, &lru_list);
+	/* A glock already on the LRU is rotated to the recent end */
+	list_lru_del(&glock_lru, &gl->gl_lru);
+	list_lru_add(&glock_lru, &gl->gl_lru);
 	set_bit(GLF_LRU, &gl->gl_flags);
-	spin_unlock(&lru_lock);
 }
 
 static void gfs2_glock_remove_from_lru(struct gfs2_glock *gl)
@@ -200,13 +193,8 @@ static void gfs2_glock_remove_from_lru(struct gfs2_glock *gl)
 	if (!(gl->gl_ops->go_flags & GLOF_LRU))
 		return;
 
-	spin_lock(&lru_lock);
-	if (!list_empty(&gl->gl_lru)) {
-		list_del_init(&gl->gl_lru);
-		atomic_dec(&lru_count);
+	if (list_lru_del(&glock_lru, &gl->gl_lru))
 		clear_bit(GLF_LRU, &gl->gl_flags);
-	}
-	spin_unlock(&lru_lock);
 }
 
 /*
@@ -1434,15 +1422,11 @@ static int glock_cmp(void *priv, struct list_head *a, struct list_head *b)
  * the glocks by number (i.e. disk location of the inodes) so that if
  * there are any such accesses, they'll be sent in order (mostly).
  *
- * Must be called under the lru_lock, but may drop and retake this
- * lock. While the lru_lock is dropped, entries may vanish from the
- * list, but no new entries will appear on the list (since it is
- * private)
+ * The list is private, so no locks are held while it is walked;
+ * glocks that turn out to be busy are simply put back on the LRU.
  */
 
 static void gfs2_dispose_glock_lru(struct list_head *list)
-__releases(&lru_lock)
-__acquires(&lru_lock)
 {
 	struct gfs2_glock *gl;
 
@@ -1453,8 +1437,7 @@ __acquires(&lru_lock)
 		list_del_init(&gl->gl_lru);
 		if (!spin_trylock(&gl->gl_lockref.lock)) {
 add_back_to_lru:
-			list_add(&gl->gl_lru, &lru_list);
-			atomic_inc(&lru_count);
+			gfs2_glock_add_to_lru(gl);
 			continue;
 		}
 		if (test_and_set_bit(GLF_LOCK, &gl->gl_flags)) {
@@ -1468,66 +1451,53 @@ add_back_to_lru:
 		WARN_ON(!test_and_clear_bit(GLF_LOCK, &gl->gl_flags));
 		__gfs2_glock_queue_work(gl, 0);
 		spin_unlock(&gl->gl_lockref.lock);
-		cond_resched_lock(&lru_lock);
+		cond_resched();
 	}
 }
 
-/**
- * gfs2_scan_glock_lru - Scan the LRU looking for locks to demote
- * @nr: The number of entries to scan
- *
- * This function selects the entries on the LRU which are able to
- * be demoted, and then kicks off the process by calling
- * gfs2_dispose_glock_lru() above.
- */
-
-static long gfs2_scan_glock_lru(int nr)
+static enum lru_status gfs2_glock_isolate(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
 {
-	struct gfs2_glock *gl;
-	LIST_HEAD(skipped);
-	LIST_HEAD(dispose);
-	long freed = 0;
-
-	spin_lock(&lru_lock);
-	while ((nr-- >= 0) && !list_empty(&lru_list)) {
-		gl = list_entry(lru_list.next, struct gfs2_glock, gl_lru);
-
-		/* Test for being demotable */
-		if (!test_bit(GLF_LOCK, &gl->gl_flags)) {
-			list_move(&gl->gl_lru, &dispose);
-			atomic_dec(&lru_count);
-			freed++;
-			continue;
-		}
+	struct list_head *dispose = arg;
+	struct gfs2_glock *gl = list_entry(item, struct gfs2_glock, gl_lru);
 
-		list_move(&gl->gl_lru, &skipped);
-	}
-	list_splice(&skipped, &lru_list);
-	if (!list_empty(&dispose))
-		gfs2_dispose_glock_lru(&dispose);
-	spin_unlock(&lru_lock);
+	/* Test for being demotable */
+	if (test_bit(GLF_LOCK, &gl->gl_flags))
+		return LRU_SKIP;
 
-	return freed;
+	list_lru_isolate_move(lru, &gl->gl_lru, dispose);
+	return LRU_REMOVED;
 }
 
 static unsigned long gfs2_glock_shrink_scan(struct shrinker *shrink,
 					    struct shrink_control *sc)
 {
+	LIST_HEAD(dispose);
+	unsigned long freed;
+
 	if (!(sc->gfp_mask & __GFP_FS))
 		return SHRINK_STOP;
-	return gfs2_scan_glock_lru(sc->nr_to_scan);
+
+	freed = list_lru_shrink_walk(&glock_lru, sc,
+				     gfs2_glock_isolate, &dispose);
+
+	if (!list_empty(&dispose))
+		gfs2_dispose_glock_lru(&dispose);
+
+	return freed;
 }
 
 static unsigned long gfs2_glock_shrink_count(struct shrinker *shrink,
 					     struct shrink_control *sc)
 {
-	return vfs_pressure_ratio(atomic_read(&lru_count));
+	return vfs_pressure_ratio(list_lru_shrink_count(&glock_lru, sc));
 }
 
 static struct shrinker glock_shrinker = {
 	.seeks = DEFAULT_SEEKS,
 	.count_objects = gfs2_glock_shrink_count,
 	.scan_objects = gfs2_glock_shrink_scan,
+	.flags = SHRINKER_NUMA_AWARE,
 };
 
 /**
@@ -1884,9 +1854,16 @@ int __init gfs2_glock_init(void)
 	if (ret < 0)
 		return ret;
 
+	ret = list_lru_init(&glock_lru);
+	if (ret < 0) {
+		rhashtable_destroy(&gl_hash_table);
+		return ret;
+	}
+
 	glock_workqueue = alloc_workqueue("glock_workqueue", WQ_MEM_RECLAIM |
 					  WQ_HIGHPRI | WQ_FREEZABLE, 0);
 	if (!glock_workqueue) {
+		list_lru_destroy(&glock_lru);
 		rhashtable_destroy(&gl_hash_table);
 		return -ENOMEM;
 	}
@@ -1895,6 +1872,7 @@ int __init gfs2_glock_init(void)
 						0);
 	if (!gfs2_delete_workqueue) {
 		destroy_workqueue(glock_workqueue);
+		list_lru_destroy(&glock_lru);
 		rhashtable_destroy(&gl_hash_table);
 		return -ENOMEM;
 	}
@@ -1903,6 +1881,7 @@ int __init gfs2_glock_init(void)
 	if (ret) {
 		destroy_workqueue(gfs2_delete_workqueue);
 		destroy_workqueue(glock_workqueue);
+		list_lru_destroy(&glock_lru);
 		rhashtable_destroy(&gl_hash_table);
 		return ret;
 	}
@@ -1916,6 +1895,7 @@ int __init gfs2_glock_init(void)
 void gfs2_glock_exit(void)
 {
 	unregister_shrinker(&glock_shrinker);
+	list_lru_destroy(&glock_lru);
 	rhashtable_destroy(&gl_hash_table);
 	destroy_workqueue(glock_workqueue);
 	destroy_workqueue(gfs2_delete_workqueue);
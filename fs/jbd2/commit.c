@@ -105,6 +105,34 @@ static void jbd2_commit_block_csum_set(journal_t *j, struct buffer_head *bh)
 	h->h_chksum[0] = cpu_to_be32(csum);
 }
 
+static void journal_end_flush_io(struct bio *bio)
+{
+	struct completion *done = bio->bi_private;
+
+	complete(done);
+	bio_put(bio);
+}
+
+/*
+ * Kick off an asynchronous cache flush of @bdev, signalling @done on
+ * completion.  This lets the commit thread overlap the flush with
+ * waiting for the journal writes instead of stalling on
+ * blkdev_issue_flush().
+ */
+static void journal_submit_flush(struct block_device *bdev,
+				 struct completion *done)
+{
+	struct bio *bio;
+
+	bio = bio_alloc(GFP_NOFS, 0);
+	bio_set_dev(bio, bdev);
+	bio->bi_opf = REQ_OP_WRITE | REQ_PREFLUSH;
+	bio->bi_private = done;
+	bio->bi_end_io = journal_end_flush_io;
+	init_completion(done);
+	submit_bio(bio);
+}
+
 /*
  * Done it all: now submit the commit record.  We should have
  * cleaned up our previous buffers by now, so if we are in abort
@@ -363,6 +391,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	struct buffer_head *cbh = NULL; /* For transactional checksums */
 	__u32 crc32_sum = ~0;
 	struct blk_plug plug;
+	struct completion fs_flush_done;
+	bool fs_flush_pending = false;
 	/* Tail of the journal */
 	unsigned long first_block;
 	tid_t first_tid;
@@ -753,18 +783,26 @@ start_journal_io:
 	commit_transaction->t_state = T_COMMIT_DFLUSH;
 	write_unlock(&journal->j_state_lock);
 
-	/* 
+	/*
 	 * If the journal is not located on the file system device,
 	 * then we must flush the file system device before we issue
-	 * the commit record
+	 * the commit record.  Submit the flush now but only wait for
+	 * it right before the commit record goes out, so that it runs
+	 * while we wait for the journal writes below.
 	 */
 	if (commit_transaction->t_need_data_flush &&
 	    (journal->j_fs_dev != journal->j_dev) &&
-	    (journal->j_flags & JBD2_BARRIER))
-		blkdev_issue_flush(journal->j_fs_dev, GFP_NOFS, NULL);
+	    (journal->j_flags & JBD2_BARRIER)) {
+		journal_submit_flush(journal->j_fs_dev, &fs_flush_done);
+		fs_flush_pending = true;
+	}
 
 	/* Done it all: now write the commit record asynchronously. */
 	if (jbd2_has_feature_async_commit(journal)) {
+		if (fs_flush_pending) {
+			wait_for_completion(&fs_flush_done);
+			fs_flush_pending = false;
+		}
 		err = journal_submit_commit_record(journal, commit_transaction,
 						 &cbh, crc32_sum);
 		if (err)
@@ -856,6 +894,13 @@ start_journal_io:
 	write_unlock(&journal->j_state_lock);
 
 	if (!jbd2_has_feature_async_commit(journal)) {
+		/*
+		 * The file system device flush must have reached stable
+		 * storage before the commit record can claim the
+		 * transaction is durable.
+		 */
+		if (fs_flush_pending)
+			wait_for_completion(&fs_flush_done);
 		err = journal_submit_commit_record(journal, commit_transaction,
 						&cbh, crc32_sum);
 		if (err)
@@ -1156,6 +1156,10 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	journal->j_max_batch_time = 15000; /* 15ms */
 	atomic_set(&journal->j_reserved_credits, 0);
 
+	journal->j_credit_cache = alloc_percpu(struct jbd2_credit_cache);
+	if (!journal->j_credit_cache)
+		goto err_cleanup;
+
 	/* The journal is marked for error until we succeed with recovery! */
 	journal->j_flags = JBD2_ABORT;
 
@@ -1196,6 +1200,7 @@ static journal_t *journal_init_common(struct block_device *bdev,
 err_cleanup:
 	kfree(journal->j_wbuf);
 	jbd2_journal_destroy_revoke(journal);
+	free_percpu(journal->j_credit_cache);
 	kfree(journal);
 	return NULL;
 }
@@ -1771,6 +1776,7 @@ int jbd2_journal_destroy(journal_t *journal)
 		jbd2_journal_destroy_revoke(journal);
 	if (journal->j_chksum_driver)
 		crypto_free_shash(journal->j_chksum_driver);
+	free_percpu(journal->j_credit_cache);
 	kfree(journal->j_wbuf);
 	kfree(journal);
 
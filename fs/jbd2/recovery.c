@@ -59,11 +59,12 @@ static void journal_brelse_array(struct buffer_head *b[], int n)
  * do the IO in reasonably large chunks.
  *
  * This is not so critical that we need to be enormously clever about
- * the readahead size, though.  128K is a purely arbitrary, good-enough
- * fixed value.
+ * the readahead size, though.  1M is a purely arbitrary, good-enough
+ * fixed value: deep enough to keep several requests in flight on the
+ * device while the replay passes chew through the window.
  */
 
-#define MAXBUF 8
+#define MAXBUF 32
 static int do_readahead(journal_t *journal, unsigned int start)
 {
 	int err;
@@ -73,8 +74,8 @@ static int do_readahead(journal_t *journal, unsigned int start)
 
 	struct buffer_head * bufs[MAXBUF];
 
-	/* Do up to 128K of readahead */
-	max = start + (128 * 1024 / journal->j_blocksize);
+	/* Do up to 1M of readahead */
+	max = start + (1024 * 1024 / journal->j_blocksize);
 	if (max > journal->j_maxlen)
 		max = journal->j_maxlen;
 
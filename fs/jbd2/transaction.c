@@ -263,6 +263,69 @@ static int add_transaction_credits(journal_t *journal, int blocks,
 	return 0;
 }
 
+/*
+ * How many credits to batch-charge to the running transaction when
+ * restocking a CPU's credit cache.  Refills are only attempted while
+ * the transaction is below half of its maximum size, so the accounting
+ * overestimate from stocked caches stays bounded.
+ */
+#define JBD2_CREDIT_CACHE_BATCH	64
+
+/*
+ * Try to serve a handle's credits from this CPU's credit cache.  The
+ * cached credits were already added to t_outstanding_credits (and
+ * checked against the log space) when the cache was stocked, so a hit
+ * attaches the handle without touching any shared cacheline.  Called
+ * with j_state_lock held for reading, which keeps t_state and t_tid
+ * stable.  Returns 1 on a hit.
+ */
+static int jbd2_credit_cache_claim(journal_t *journal, transaction_t *t,
+				   int blocks)
+{
+	struct jbd2_credit_cache *cc;
+	int ret = 0;
+
+	cc = get_cpu_ptr(journal->j_credit_cache);
+	if (t->t_state == T_RUNNING && cc->cc_tid == t->t_tid &&
+	    cc->cc_credits >= blocks) {
+		cc->cc_credits -= blocks;
+		ret = 1;
+	}
+	put_cpu_ptr(journal->j_credit_cache);
+	return ret;
+}
+
+/*
+ * Restock this CPU's credit cache from the running transaction.  Best
+ * effort: if the transaction is past half full or log space is tight
+ * we back out and leave the cache empty.  Credits cached for an older
+ * transaction are discarded; they were accounted to a transaction that
+ * has since committed, which only ever overestimates its size.  Called
+ * with j_state_lock held for reading.
+ */
+static void jbd2_credit_cache_refill(journal_t *journal, transaction_t *t)
+{
+	struct jbd2_credit_cache *cc;
+	int needed;
+
+	cc = get_cpu_ptr(journal->j_credit_cache);
+	if (cc->cc_tid == t->t_tid && cc->cc_credits)
+		goto out;
+
+	needed = atomic_add_return(JBD2_CREDIT_CACHE_BATCH,
+				   &t->t_outstanding_credits);
+	if (needed > journal->j_max_transaction_buffers / 2 ||
+	    jbd2_log_space_left(journal) < jbd2_space_needed(journal)) {
+		atomic_sub(JBD2_CREDIT_CACHE_BATCH,
+			   &t->t_outstanding_credits);
+		goto out;
+	}
+	cc->cc_tid = t->t_tid;
+	cc->cc_credits = JBD2_CREDIT_CACHE_BATCH;
+out:
+	put_cpu_ptr(journal->j_credit_cache);
+}
+
 /*
  * start_this_handle: Given a handle, deal with any locking or stalling
  * needed to make sure that there is enough journal space for the handle
@@ -355,9 +418,21 @@ repeat:
 	transaction = journal->j_running_transaction;
 
 	if (!handle->h_reserved) {
-		/* We may have dropped j_state_lock - restart in that case */
-		if (add_transaction_credits(journal, blocks, rsv_blocks))
-			goto repeat;
+		/*
+		 * Reservations need j_reserved_credits accounting, so
+		 * only plain handles can be served from the cache.
+		 */
+		if (rsv_blocks ||
+		    !jbd2_credit_cache_claim(journal, transaction, blocks)) {
+			/*
+			 * We may have dropped j_state_lock - restart in
+			 * that case
+			 */
+			if (add_transaction_credits(journal, blocks,
+						    rsv_blocks))
+				goto repeat;
+			jbd2_credit_cache_refill(journal, transaction);
+		}
 	} else {
 		/*
 		 * We have handle reserved so we are allowed to join T_LOCKED
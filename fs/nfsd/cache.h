@@ -19,7 +19,9 @@
  * is much larger than a sockaddr_in6.
  */
 struct svc_cacherep {
+	struct hlist_node	c_hash;		/* bucket hash chain, RCU */
 	struct list_head	c_lru;
+	struct rcu_head		c_rcu;
 
 	unsigned char		c_state,	/* unused, inprog, done */
 				c_type,		/* status, buffer */
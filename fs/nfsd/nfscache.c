@@ -30,6 +30,7 @@
 #define TARGET_BUCKET_SIZE	64
 
 struct nfsd_drc_bucket {
+	struct hlist_head cache_head;
 	struct list_head lru_head;
 	spinlock_t cache_lock;
 };
@@ -45,8 +46,10 @@ static unsigned int		maskbits;
 static unsigned int		drc_hashsize;
 
 /*
- * Stats and other tracking of on the duplicate reply cache. All of these and
- * the "rc" fields in nfsdstats are protected by the cache_lock
+ * Stats and other tracking of on the duplicate reply cache. The "rc" fields
+ * in nfsdstats are protected by the cache_lock. The chain length stats and
+ * payload_misses are also updated from the lockless lookup path, so they
+ * are approximate.
  */
 
 /* total number of entries */
@@ -129,22 +132,33 @@ nfsd_reply_cache_alloc(void)
 	if (rp) {
 		rp->c_state = RC_UNUSED;
 		rp->c_type = RC_NOCACHE;
+		INIT_HLIST_NODE(&rp->c_hash);
 		INIT_LIST_HEAD(&rp->c_lru);
 	}
 	return rp;
 }
 
+static void
+nfsd_reply_cache_free_rcu(struct rcu_head *head)
+{
+	struct svc_cacherep *rp = container_of(head, struct svc_cacherep, c_rcu);
+
+	if (rp->c_type == RC_REPLBUFF)
+		kfree(rp->c_replvec.iov_base);
+	kmem_cache_free(drc_slab, rp);
+}
+
 static void
 nfsd_reply_cache_free_locked(struct svc_cacherep *rp)
 {
-	if (rp->c_type == RC_REPLBUFF && rp->c_replvec.iov_base) {
+	if (rp->c_type == RC_REPLBUFF && rp->c_replvec.iov_base)
 		drc_mem_usage -= rp->c_replvec.iov_len;
-		kfree(rp->c_replvec.iov_base);
-	}
+	hlist_del_init_rcu(&rp->c_hash);
 	list_del(&rp->c_lru);
 	atomic_dec(&num_drc_entries);
 	drc_mem_usage -= sizeof(*rp);
-	kmem_cache_free(drc_slab, rp);
+	/* Lockless lookups may still see this entry until a grace period */
+	call_rcu(&rp->c_rcu, nfsd_reply_cache_free_rcu);
 }
 
 static void
@@ -183,6 +197,7 @@ int nfsd_reply_cache_init(void)
 	}
 
 	for (i = 0; i < hashsize; i++) {
+		INIT_HLIST_HEAD(&drc_hashtbl[i].cache_head);
 		INIT_LIST_HEAD(&drc_hashtbl[i].lru_head);
 		spin_lock_init(&drc_hashtbl[i].cache_lock);
 	}
@@ -214,6 +229,8 @@ void nfsd_reply_cache_shutdown(void)
 	drc_hashtbl = NULL;
 	drc_hashsize = 0;
 
+	/* Wait for deferred frees before tearing down the slab */
+	rcu_barrier();
 	kmem_cache_destroy(drc_slab);
 	drc_slab = NULL;
 }
@@ -343,7 +360,8 @@ nfsd_cache_match(struct svc_rqst *rqstp, __wsum csum, struct svc_cacherep *rp)
 
 /*
  * Search the request hash for an entry that matches the given rqstp.
- * Must be called with cache_lock held. Returns the found entry or
+ * Must be called under rcu_read_lock(), either alone for a lockless
+ * lookup or together with the bucket lock. Returns the found entry or
  * NULL on failure.
  */
 static struct svc_cacherep *
@@ -351,10 +369,9 @@ nfsd_cache_search(struct nfsd_drc_bucket *b, struct svc_rqst *rqstp,
 		__wsum csum)
 {
 	struct svc_cacherep	*rp, *ret = NULL;
-	struct list_head 	*rh = &b->lru_head;
 	unsigned int		entries = 0;
 
-	list_for_each_entry(rp, rh, c_lru) {
+	hlist_for_each_entry_rcu(rp, &b->cache_head, c_hash) {
 		++entries;
 		if (nfsd_cache_match(rqstp, csum, rp)) {
 			ret = rp;
@@ -377,11 +394,12 @@ nfsd_cache_search(struct nfsd_drc_bucket *b, struct svc_rqst *rqstp,
 }
 
 /*
- * Try to find an entry matching the current call in the cache. When none
- * is found, we try to grab the oldest expired entry off the LRU list. If
- * a suitable one isn't there, then drop the cache_lock and allocate a
- * new one, then search again in case one got inserted while this thread
- * didn't hold the lock.
+ * Try to find an entry matching the current call in the cache. The lookup
+ * is tried first without the bucket lock; hits only need the lock for the
+ * LRU bump. When no entry is found, allocate a new one, take the lock and
+ * search again in case one got inserted while this thread didn't hold it,
+ * then insert. Entries are only published on the hash chain once they are
+ * fully initialized.
  */
 int
 nfsd_cache_lookup(struct svc_rqst *rqstp)
@@ -400,12 +418,32 @@ nfsd_cache_lookup(struct svc_rqst *rqstp)
 
 	rqstp->rq_cacherep = NULL;
 	if (type == RC_NOCACHE) {
+		/*
+		 * This also covers NFSv4: sessions carry their own replay
+		 * cache in the slot table, so v4 compounds never get past
+		 * this point.
+		 */
 		nfsdstats.rcnocache++;
 		return rtn;
 	}
 
 	csum = nfsd_cache_csum(rqstp);
 
+	/* Lockless fast path for retransmissions */
+	rcu_read_lock();
+	found = nfsd_cache_search(b, rqstp, csum);
+	if (found) {
+		spin_lock(&b->cache_lock);
+		if (!hlist_unhashed(&found->c_hash)) {
+			rcu_read_unlock();
+			rp = found;
+			goto found_entry;
+		}
+		/* Raced with eviction; retry under the lock below */
+		spin_unlock(&b->cache_lock);
+	}
+	rcu_read_unlock();
+
 	/*
 	 * Since the common case is a cache miss followed by an insert,
 	 * preallocate an entry.
@@ -420,7 +458,9 @@ nfsd_cache_lookup(struct svc_rqst *rqstp)
 	/* go ahead and prune the cache */
 	prune_bucket(b);
 
+	rcu_read_lock();
 	found = nfsd_cache_search(b, rqstp, csum);
+	rcu_read_unlock();
 	if (found) {
 		if (likely(rp))
 			nfsd_reply_cache_free_locked(rp);
@@ -445,6 +485,7 @@ nfsd_cache_lookup(struct svc_rqst *rqstp)
 	rp->c_len = rqstp->rq_arg.len;
 	rp->c_csum = csum;
 
+	hlist_add_head_rcu(&rp->c_hash, &b->cache_head);
 	lru_put_end(b, rp);
 
 	/* release any buffer */
@@ -288,12 +288,32 @@ void nilfs_truncate_logs(struct list_head *logs,
 	}
 }
 
+/**
+ * nilfs_segbuf_add_checksums - add checksums on a log
+ * @segbuf: segment buffer storing the target log
+ * @seed: checksum seed value
+ */
+static void nilfs_segbuf_add_checksums(struct nilfs_segment_buffer *segbuf,
+				       u32 seed)
+{
+	if (segbuf->sb_super_root)
+		nilfs_segbuf_fill_in_super_root_crc(segbuf, seed);
+	nilfs_segbuf_fill_in_segsum_crc(segbuf, seed);
+	nilfs_segbuf_fill_in_data_crc(segbuf, seed);
+}
+
 int nilfs_write_logs(struct list_head *logs, struct the_nilfs *nilfs)
 {
 	struct nilfs_segment_buffer *segbuf;
 	int ret = 0;
 
 	list_for_each_entry(segbuf, logs, sb_list) {
+		/*
+		 * Checksumming each log right before its submission
+		 * lets the CRC computation of later logs overlap with
+		 * the I/O of the earlier ones.
+		 */
+		nilfs_segbuf_add_checksums(segbuf, nilfs->ns_crc_seed);
 		ret = nilfs_segbuf_write(segbuf, nilfs);
 		if (ret)
 			break;
@@ -314,23 +334,6 @@ int nilfs_wait_on_logs(struct list_head *logs)
 	return ret;
 }
 
-/**
- * nilfs_add_checksums_on_logs - add checksums on the logs
- * @logs: list of segment buffers storing target logs
- * @seed: checksum seed value
- */
-void nilfs_add_checksums_on_logs(struct list_head *logs, u32 seed)
-{
-	struct nilfs_segment_buffer *segbuf;
-
-	list_for_each_entry(segbuf, logs, sb_list) {
-		if (segbuf->sb_super_root)
-			nilfs_segbuf_fill_in_super_root_crc(segbuf, seed);
-		nilfs_segbuf_fill_in_segsum_crc(segbuf, seed);
-		nilfs_segbuf_fill_in_data_crc(segbuf, seed);
-	}
-}
-
 /*
  * BIO operations
  */
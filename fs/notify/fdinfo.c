@@ -160,8 +160,8 @@ void fanotify_show_fdinfo(struct seq_file *m, struct file *f)
 	if (group->fanotify_data.audit)
 		flags |= FAN_ENABLE_AUDIT;
 
-	seq_printf(m, "fanotify flags:%x event-flags:%x\n",
-		   flags, group->fanotify_data.f_flags);
+	seq_printf(m, "fanotify flags:%x event-flags:%x overflows:%u\n",
+		   flags, group->fanotify_data.f_flags, group->q_overflows);
 
 	show_fdinfo(m, f, fanotify_fdinfo);
 }
@@ -113,6 +113,7 @@ int fsnotify_add_event(struct fsnotify_group *group,
 
 	if (group->q_len >= group->max_events) {
 		ret = 2;
+		group->q_overflows++;
 		/* Queue overflow event only if it isn't already queued */
 		if (!list_empty(&group->overflow_event->list)) {
 			spin_unlock(&group->notification_lock);
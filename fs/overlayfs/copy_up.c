@@ -140,6 +140,9 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 	struct file *new_file;
 	loff_t old_pos = 0;
 	loff_t new_pos = 0;
+	loff_t data_pos = -1;
+	loff_t hole_len;
+	bool skip_hole = true;
 	int error = 0;
 
 	if (len == 0)
@@ -162,7 +165,6 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 	/* Couldn't clone, so now we try to copy the data */
 	error = 0;
 
-	/* FIXME: copy up sparse files efficiently */
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -175,6 +177,32 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 			break;
 		}
 
+		/*
+		 * Skip over holes in the lower file instead of splicing
+		 * zeroes; this both keeps the upper file sparse and avoids
+		 * copying potentially huge unwritten ranges. Relies on
+		 * SEEK_DATA in the lower fs - if that is not supported,
+		 * fall back to a plain copy. Partial holes that SEEK_DATA
+		 * does not report are simply copied as data.
+		 */
+		if (skip_hole && data_pos < old_pos) {
+			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
+			if (data_pos >= old_pos + len) {
+				/* Rest of the range is a hole */
+				break;
+			} else if (data_pos > old_pos) {
+				hole_len = data_pos - old_pos;
+				len -= hole_len;
+				old_pos = new_pos = data_pos;
+				continue;
+			} else if (data_pos == -ENXIO) {
+				/* Rest of the file is a hole */
+				break;
+			} else if (data_pos < 0) {
+				skip_hole = false;
+			}
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
@@ -186,6 +214,10 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 
 		len -= bytes;
 	}
+
+	/* Extend the upper file over any trailing hole we skipped */
+	if (!error && len > 0)
+		error = vfs_truncate(new, new_pos + len);
 out:
 	if (!error)
 		error = vfs_fsync(new_file, 0);
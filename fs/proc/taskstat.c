@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * /proc/taskstat: packed binary task stat records.
+ *
+ * Monitoring agents that sample every process used to open, read and
+ * parse /proc/PID/stat once per pid per interval.  This file returns
+ * the same numbers as fixed-size binary records, many tasks per
+ * read(2): the file position is a pid cursor, each read starts at the
+ * first thread group leader with pid >= *ppos in the reader's pid
+ * namespace and advances the cursor past the last pid returned.  A
+ * return of zero means the pid space is exhausted.
+ */
+#include <linux/delayacct.h>
+#include <linux/fs.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/mm.h>
+#include <linux/pid_namespace.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/cputime.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/stat.h>
+#include <linux/threads.h>
+#include <linux/uaccess.h>
+#include <linux/proc_taskstat.h>
+#include "internal.h"
+
+static void taskstat_fill(struct proc_taskstat *ts, struct pid_namespace *ns,
+			  struct pid *pid, struct task_struct *task)
+{
+	struct mm_struct *mm;
+	unsigned long flags;
+
+	memset(ts, 0, sizeof(*ts));
+
+	ts->pid = pid_nr_ns(pid, ns);
+	ts->state = task_state_to_char(task);
+	ts->flags = task->flags;
+	ts->priority = task_prio(task);
+	ts->nice = task_nice(task);
+	ts->processor = task_cpu(task);
+	ts->rt_priority = task->rt_priority;
+	ts->policy = task->policy;
+	ts->start_time = nsec_to_clock_t(task->real_start_time);
+	ts->blkio_ticks = delayacct_blkio_ticks(task);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		ts->vsize = task_vsize(mm);
+		ts->rss = get_mm_rss(mm);
+		mmput(mm);
+	}
+
+	if (lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+		struct task_struct *t = task;
+		unsigned long min_flt = sig->min_flt;
+		unsigned long maj_flt = sig->maj_flt;
+		u64 gtime = sig->gtime;
+		u64 utime, stime;
+
+		/* add up live thread stats at the group level */
+		do {
+			min_flt += t->min_flt;
+			maj_flt += t->maj_flt;
+			gtime += task_gtime(t);
+		} while_each_thread(task, t);
+
+		thread_group_cputime_adjusted(task, &utime, &stime);
+
+		ts->num_threads = get_nr_threads(task);
+		ts->min_flt = min_flt;
+		ts->maj_flt = maj_flt;
+		ts->cmin_flt = sig->cmin_flt;
+		ts->cmaj_flt = sig->cmaj_flt;
+		ts->utime = nsec_to_clock_t(utime);
+		ts->stime = nsec_to_clock_t(stime);
+		ts->cutime = nsec_to_clock_t(sig->cutime);
+		ts->cstime = nsec_to_clock_t(sig->cstime);
+		ts->gtime = nsec_to_clock_t(gtime);
+		ts->cgtime = nsec_to_clock_t(sig->cgtime);
+		ts->rsslim = READ_ONCE(sig->rlim[RLIMIT_RSS].rlim_cur);
+
+		ts->sid = task_session_nr_ns(task, ns);
+		ts->ppid = task_tgid_nr_ns(task->real_parent, ns);
+		ts->pgid = task_pgrp_nr_ns(task, ns);
+
+		unlock_task_sighand(task, &flags);
+	}
+}
+
+static ssize_t taskstat_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct pid_namespace *ns = file_inode(file)->i_sb->s_fs_info;
+	struct proc_taskstat ts;
+	ssize_t copied = 0;
+	int next = *ppos;
+
+	if (*ppos < 0 || *ppos > PID_MAX_LIMIT)
+		return -EINVAL;
+
+	while (count >= sizeof(ts)) {
+		struct task_struct *task = NULL;
+		struct pid *pid;
+		int nr;
+
+		rcu_read_lock();
+		pid = find_ge_pid(next, ns);
+		if (!pid) {
+			rcu_read_unlock();
+			break;
+		}
+		nr = pid_nr_ns(pid, ns);
+		task = pid_task(pid, PIDTYPE_PID);
+		if (task && thread_group_leader(task)) {
+			get_pid(pid);
+			get_task_struct(task);
+		} else {
+			task = NULL;
+		}
+		rcu_read_unlock();
+		if (!task) {
+			next = nr + 1;
+			continue;
+		}
+
+		taskstat_fill(&ts, ns, pid, task);
+		put_task_struct(task);
+		put_pid(pid);
+
+		if (copy_to_user(buf + copied, &ts, sizeof(ts))) {
+			if (!copied)
+				copied = -EFAULT;
+			break;
+		}
+		copied += sizeof(ts);
+		count -= sizeof(ts);
+		next = nr + 1;
+	}
+
+	*ppos = next;
+	return copied;
+}
+
+static const struct file_operations taskstat_proc_fops = {
+	.llseek		= default_llseek,
+	.read		= taskstat_read,
+};
+
+static int __init proc_taskstat_init(void)
+{
+	/* 0400: a flat pid listing must not get around hidepid */
+	proc_create("taskstat", S_IRUSR, NULL, &taskstat_proc_fops);
+	return 0;
+}
+fs_initcall(proc_taskstat_init);
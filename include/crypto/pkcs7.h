@@ -15,6 +15,7 @@
 #include <linux/verification.h>
 #include <crypto/public_key.h>
 
+struct asymmetric_key_id;
 struct key;
 struct pkcs7_message;
 
@@ -33,7 +34,8 @@ extern int pkcs7_get_content_data(const struct pkcs7_message *pkcs7,
  * pkcs7_trust.c
  */
 extern int pkcs7_validate_trust(struct pkcs7_message *pkcs7,
-				struct key *trust_keyring);
+				struct key *trust_keyring,
+				struct key **_anchor);
 
 /*
  * pkcs7_verify.c
@@ -44,4 +46,8 @@ extern int pkcs7_verify(struct pkcs7_message *pkcs7,
 extern int pkcs7_supply_detached_data(struct pkcs7_message *pkcs7,
 				      const void *data, size_t datalen);
 
+extern int pkcs7_get_digest(struct pkcs7_message *pkcs7, const u8 **buf,
+			    u32 *len,
+			    const struct asymmetric_key_id **signer);
+
 #endif /* _CRYPTO_PKCS7_H */
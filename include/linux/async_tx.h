@@ -171,10 +171,47 @@ init_async_submit(struct async_submit_ctl *args, enum async_tx_flags flags,
 void async_tx_submit(struct dma_chan *chan, struct dma_async_tx_descriptor *tx,
 		     struct async_submit_ctl *submit);
 
+/**
+ * struct async_xor_batch_op - one xor operation in an async_xor_batch() queue
+ * @dest: destination page
+ * @src_list: array of source pages, following the async_xor() rules
+ * @offset: common src/dst offset to start transaction
+ * @src_cnt: number of source pages
+ * @len: length in bytes
+ */
+struct async_xor_batch_op {
+	struct page *dest;
+	struct page **src_list;
+	unsigned int offset;
+	int src_cnt;
+	size_t len;
+};
+
+/**
+ * struct async_pq_batch_op - one operation in an async_gen_syndrome_batch()
+ *   queue
+ * @blocks: source pages with P and Q destinations at blocks[disks-2] and
+ *	blocks[disks-1], following the async_gen_syndrome() rules
+ * @offset: common offset into each block (src and dest) to start transaction
+ * @disks: number of blocks (including missing P or Q, see
+ *	async_gen_syndrome())
+ * @len: length of operation in bytes
+ */
+struct async_pq_batch_op {
+	struct page **blocks;
+	unsigned int offset;
+	int disks;
+	size_t len;
+};
+
 struct dma_async_tx_descriptor *
 async_xor(struct page *dest, struct page **src_list, unsigned int offset,
 	  int src_cnt, size_t len, struct async_submit_ctl *submit);
 
+struct dma_async_tx_descriptor *
+async_xor_batch(struct async_xor_batch_op *ops, int nr_ops,
+		struct async_submit_ctl *submit);
+
 struct dma_async_tx_descriptor *
 async_xor_val(struct page *dest, struct page **src_list, unsigned int offset,
 	      int src_cnt, size_t len, enum sum_check_flags *result,
@@ -191,6 +228,10 @@ struct dma_async_tx_descriptor *
 async_gen_syndrome(struct page **blocks, unsigned int offset, int src_cnt,
 		   size_t len, struct async_submit_ctl *submit);
 
+struct dma_async_tx_descriptor *
+async_gen_syndrome_batch(struct async_pq_batch_op *ops, int nr_ops,
+			 struct async_submit_ctl *submit);
+
 struct dma_async_tx_descriptor *
 async_syndrome_val(struct page **blocks, unsigned int offset, int src_cnt,
 		   size_t len, enum sum_check_flags *pqres, struct page *spare,
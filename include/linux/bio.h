@@ -410,6 +410,7 @@ extern struct bio_set *bioset_create(unsigned int, unsigned int, int flags);
 enum {
 	BIOSET_NEED_BVECS = BIT(0),
 	BIOSET_NEED_RESCUER = BIT(1),
+	BIOSET_NODE_POOLS = BIT(2),
 };
 extern void bioset_free(struct bio_set *);
 extern mempool_t *biovec_create_pool(int pool_entries);
@@ -718,12 +719,31 @@ static inline void bio_inc_remaining(struct bio *bio)
  */
 #define BIO_POOL_SIZE 2
 
+/*
+ * Size of each per-node front-end cache of a bio_set. Bounded so the
+ * backing mempool's reserve still turns over under memory pressure.
+ */
+#define BIO_NODE_POOL_SIZE	32
+
+struct bio_node_pool {
+	spinlock_t lock;
+	unsigned int nr;
+	void *elems[BIO_NODE_POOL_SIZE];
+};
+
 struct bio_set {
 	struct kmem_cache *bio_slab;
 	unsigned int front_pad;
 
 	mempool_t *bio_pool;
 	mempool_t *bvec_pool;
+
+	/*
+	 * Optional per-node caches in front of @bio_pool, so bios are
+	 * recycled NUMA-locally to the submitting CPU. Allocated when
+	 * the set is created with %BIOSET_NODE_POOLS.
+	 */
+	struct bio_node_pool *node_pools;
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
 	mempool_t *bio_integrity_pool;
 	mempool_t *bvec_integrity_pool;
@@ -49,6 +49,8 @@ struct blk_mq_hw_ctx {
 
 	unsigned int		numa_node;
 	unsigned int		queue_num;
+	/* completion irq for this hctx, -1 if unknown; for hybrid polling */
+	int			poll_irq;
 
 	atomic_t		nr_active;
 	unsigned int		nr_expired;
@@ -60,6 +62,13 @@ struct blk_mq_hw_ctx {
 	unsigned long		poll_invoked;
 	unsigned long		poll_success;
 
+	/*
+	 * Always-on per-cpu log2 histogram of issue-to-complete times,
+	 * in nsecs. Exposed (and reset) through debugfs.
+	 */
+#define BLK_MQ_LAT_HIST_BKTS	32
+	u64 __percpu		*lat_hist;
+
 #ifdef CONFIG_BLK_DEBUG_FS
 	struct dentry		*debugfs_dir;
 	struct dentry		*sched_debugfs_dir;
@@ -287,6 +296,8 @@ void blk_mq_update_nr_hw_queues(struct blk_mq_tag_set *set, int nr_hw_queues);
 
 void blk_mq_quiesce_queue_nowait(struct request_queue *q);
 
+void blk_mq_hctx_set_poll_irq(struct blk_mq_hw_ctx *hctx, int irq);
+
 /*
  * Driver command data is immediately after the request. So subtract request
  * size to get back to the original request, add request size to get the PDU.
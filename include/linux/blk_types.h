@@ -381,12 +381,20 @@ static inline bool blk_qc_t_is_internal(blk_qc_t cookie)
 	return (cookie & BLK_QC_T_INTERNAL) != 0;
 }
 
+/*
+ * Number of log2 latency histogram buckets in a &struct blk_rq_stat.
+ * Bucket i counts samples in [2^i, 2^(i+1)) nsecs, with the last bucket
+ * catching everything above.
+ */
+#define BLK_RQ_STAT_HIST_BKTS	32
+
 struct blk_rq_stat {
 	u64 mean;
 	u64 min;
 	u64 max;
 	u32 nr_samples;
 	u64 batch;
+	u32 hist[BLK_RQ_STAT_HIST_BKTS];
 };
 
 #endif /* __LINUX_BLK_TYPES_H */
@@ -56,7 +56,7 @@ struct blk_stat_callback;
  * Maximum number of blkcg policies allowed to be registered concurrently.
  * Defined here to simplify include dependency.
  */
-#define BLKCG_MAX_POLS		3
+#define BLKCG_MAX_POLS		4
 
 typedef void (rq_end_io_fn)(struct request *, blk_status_t);
 
@@ -407,8 +407,16 @@ struct blk_zone_report_hdr {
 extern int blkdev_report_zones(struct block_device *bdev,
 			       sector_t sector, struct blk_zone *zones,
 			       unsigned int *nr_zones, gfp_t gfp_mask);
+extern int blkdev_report_zones_batch(struct block_device *bdev,
+				     sector_t sector, struct blk_zone *zones,
+				     unsigned int *nr_zones, gfp_t gfp_mask);
 extern int blkdev_reset_zones(struct block_device *bdev, sector_t sectors,
 			      sector_t nr_sectors, gfp_t gfp_mask);
+extern int blk_revalidate_zone_cache(struct block_device *bdev,
+				     gfp_t gfp_mask);
+extern int blk_lookup_zone(struct request_queue *q, sector_t sector,
+			   struct blk_zone *zone);
+extern void blk_zone_cache_free(struct request_queue *q);
 
 extern int blkdev_report_zones_ioctl(struct block_device *bdev, fmode_t mode,
 				     unsigned int cmd, unsigned long arg);
@@ -417,6 +425,10 @@ extern int blkdev_reset_zones_ioctl(struct block_device *bdev, fmode_t mode,
 
 #else /* CONFIG_BLK_DEV_ZONED */
 
+static inline void blk_zone_cache_free(struct request_queue *q)
+{
+}
+
 static inline int blkdev_report_zones_ioctl(struct block_device *bdev,
 					    fmode_t mode, unsigned int cmd,
 					    unsigned long arg)
@@ -581,6 +593,14 @@ struct request_queue {
 	struct blk_stat_callback	*poll_cb;
 	struct blk_rq_stat	poll_stat[BLK_MQ_POLL_STATS_BKTS];
 
+	/*
+	 * Tag wakeup batching control: -1 leaves the sbitmap default
+	 * alone, 0 sizes batches adaptively from the completion rate,
+	 * > 0 pins the batch size.
+	 */
+	int			tag_wake_batch;
+	struct blk_stat_callback	*wake_batch_cb;
+
 	struct timer_list	timeout;
 	struct work_struct	timeout_work;
 	struct list_head	timeout_list;
@@ -610,6 +630,16 @@ struct request_queue {
 	unsigned long		*seq_zones_bitmap;
 	unsigned long		*seq_zones_wlock;
 
+	/*
+	 * Optional cached copy of the zone information of the device,
+	 * built with blk_revalidate_zone_cache() so that zone state can
+	 * be queried with blk_lookup_zone() without issuing any report
+	 * command. NULL until a user builds it.
+	 */
+	struct blk_zone		*zone_cache;
+	unsigned int		zone_cache_nr;
+	spinlock_t		zone_cache_lock;
+
 	/*
 	 * sg stuff
 	 */
@@ -698,6 +728,7 @@ struct request_queue {
 #define QUEUE_FLAG_SCSI_PASSTHROUGH 27	/* queue supports SCSI commands */
 #define QUEUE_FLAG_QUIESCED    28	/* queue has been quiesced */
 #define QUEUE_FLAG_PREEMPT_ONLY	29	/* only process REQ_PREEMPT requests */
+#define QUEUE_FLAG_WAKE_BATCH_STATS 30	/* collecting stats for wake batching */
 
 #define QUEUE_FLAG_DEFAULT	((1 << QUEUE_FLAG_IO_STAT) |		\
 				 (1 << QUEUE_FLAG_SAME_COMP)	|	\
@@ -1360,10 +1391,20 @@ static inline void blk_set_runtime_active(struct request_queue *q) {}
  * the plug list when the task sleeps by itself. For details, please see
  * schedule() where blk_schedule_flush_plug() is called.
  */
+#define BLK_PLUG_MERGE_HASH_SIZE	16
+
 struct blk_plug {
 	struct list_head list; /* requests */
 	struct list_head mq_list; /* blk-mq requests */
 	struct list_head cb_list; /* md requires an unplug callback */
+	/*
+	 * Plugged requests indexed by end sector, so the common
+	 * back-merge candidate is found without rescanning the whole
+	 * plug. Entries are hints: they are revalidated against the
+	 * request before use and cleared whenever requests leave the
+	 * plug.
+	 */
+	struct request *merge_hash[BLK_PLUG_MERGE_HASH_SIZE];
 };
 #define BLK_MAX_REQUEST_COUNT 16
 #define BLK_PLUG_FLUSH_SIZE (128 * 1024)
@@ -1440,6 +1481,15 @@ extern int __blkdev_issue_discard(struct block_device *bdev, sector_t sector,
 		sector_t nr_sects, gfp_t gfp_mask, int flags,
 		struct bio **biop);
 
+struct blkdev_discard_range {
+	sector_t sector;
+	sector_t nr_sects;
+};
+
+extern int blkdev_issue_discard_ranges(struct block_device *bdev,
+		const struct blkdev_discard_range *ranges, unsigned int nr,
+		gfp_t gfp_mask, unsigned long flags);
+
 #define BLKDEV_ZERO_NOUNMAP	(1 << 0)  /* do not free blocks */
 #define BLKDEV_ZERO_NOFALLBACK	(1 << 1)  /* don't write explicit zeroes */
 
@@ -16,6 +16,7 @@
 #include <linux/rbtree_latch.h>
 #include <linux/numa.h>
 #include <linux/wait.h>
+#include <linux/u64_stats_sync.h>
 
 struct bpf_verifier_env;
 struct perf_event;
@@ -238,6 +239,20 @@ struct bpf_prog_offload {
 	u32			jited_len;
 };
 
+/* Per-cpu run-time accounting, currently only filled in by the
+ * tracing attach points (see trace_call_bpf()).  avg_nsecs and skip
+ * implement the ns/invocation budget enforcement and are only ever
+ * touched by the local CPU; cnt/nsecs are read cross-cpu by
+ * BPF_OBJ_GET_INFO_BY_FD under the syncp.
+ */
+struct bpf_prog_stats {
+	u64 cnt;
+	u64 nsecs;
+	u64 avg_nsecs;	/* EWMA of ns per invocation */
+	u32 skip;	/* invocations left to skip while throttled */
+	struct u64_stats_sync syncp;
+} __aligned(2 * sizeof(u64));
+
 struct bpf_prog_aux {
 	atomic_t refcnt;
 	u32 used_map_cnt;
@@ -253,6 +268,7 @@ struct bpf_prog_aux {
 	const struct bpf_prog_ops *ops;
 	struct bpf_map **used_maps;
 	struct bpf_prog *prog;
+	struct bpf_prog_stats __percpu *stats;
 	struct user_struct *user;
 	u64 load_time; /* ns since boottime */
 	char name[BPF_OBJ_NAME_LEN];
@@ -411,6 +427,7 @@ void bpf_map_area_free(void *base);
 void bpf_map_init_from_attr(struct bpf_map *map, union bpf_attr *attr);
 
 extern int sysctl_unprivileged_bpf_disabled;
+extern int sysctl_bpf_trace_budget_ns;
 
 int bpf_map_new_fd(struct bpf_map *map, int flags);
 int bpf_prog_new_fd(struct bpf_prog *prog);
@@ -234,6 +234,14 @@ struct ceph_connection {
 	int out_skip;        /* skip this many bytes */
 	int out_kvec_bytes;  /* total bytes left */
 	int out_more;        /* there is more data after the kvecs */
+
+#define CEPH_MSG_DATA_BVECS	16
+	/* batch of message data pieces for vectored zero-copy sends */
+	struct bio_vec out_data_bvecs[CEPH_MSG_DATA_BVECS];
+	int out_data_bvec_cnt;
+	size_t out_data_bvec_bytes;	/* bytes in out_data_bvecs */
+	size_t out_data_bvec_sent;	/* of which already sent */
+
 	__le64 out_temp_ack; /* for writing an ack */
 	struct ceph_timespec out_temp_keepalive2; /* for writing keepalive2
 						     stamp */
@@ -241,8 +241,12 @@ static inline int ceph_decode_pgid(void **p, void *end, struct ceph_pg *pgid)
 
 struct ceph_osdmap *ceph_osdmap_alloc(void);
 extern struct ceph_osdmap *ceph_osdmap_decode(void **p, void *end);
+int ceph_osdmap_inc_predecode(void *p, void *end,
+			      struct ceph_osdmap **pfullmap,
+			      struct crush_map **pcrush);
 struct ceph_osdmap *osdmap_apply_incremental(void **p, void *end,
-					     struct ceph_osdmap *map);
+					     struct ceph_osdmap *map,
+					     struct crush_map **precrush);
 extern void ceph_osdmap_destroy(struct ceph_osdmap *map);
 
 struct ceph_osds {
@@ -299,6 +299,16 @@ struct cgroup_cpu_stat {
 	 */
 	struct cgroup *updated_children;	/* terminated by self cgroup */
 	struct cgroup *updated_next;		/* NULL iff not on the list */
+
+	/*
+	 * ->dirty_epoch is bumped whenever this cgroup enters the updated
+	 * tree on this cpu and ->flushed_epoch records the epoch consumed
+	 * by the last flush which had this cgroup as its root.  A reader
+	 * can thus tell without taking cgroup_cpu_stat_lock that a subtree
+	 * has seen no updates on a cpu and skip it entirely.
+	 */
+	u64 dirty_epoch;
+	u64 flushed_epoch;
 };
 
 struct cgroup_stat {
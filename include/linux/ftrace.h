@@ -194,6 +194,8 @@ struct ftrace_ops {
 	unsigned long			flags;
 	void				*private;
 	ftrace_func_t			saved_func;
+	/* slot + 1 in the list-func dispatch bitmap, 0 = no slot */
+	int				dispatch_slot;
 #ifdef CONFIG_DYNAMIC_FTRACE
 	struct ftrace_ops_hash		local_hash;
 	struct ftrace_ops_hash		*func_hash;
@@ -101,9 +101,12 @@ enum hrtimer_restart {
  *		was armed.
  * @function:	timer expiry callback function
  * @base:	pointer to the timer base (per cpu and per clock)
+ * @wheel_entry: list node while the timer sits in a wheel bucket of
+ *		the clock base instead of the timerqueue
  * @state:	state information (See bit values above)
  * @is_rel:	Set if the timer was armed relative
  * @is_soft:	Set if hrtimer will be expired in soft interrupt context.
+ * @is_wheeled:	Set if the timer is queued in a wheel bucket
  *
  * The hrtimer structure must be initialized by hrtimer_init()
  */
@@ -112,9 +115,11 @@ struct hrtimer {
 	ktime_t				_softexpires;
 	enum hrtimer_restart		(*function)(struct hrtimer *);
 	struct hrtimer_clock_base	*base;
+	struct list_head		wheel_entry;
 	u8				state;
 	u8				is_rel;
 	u8				is_soft;
+	u8				is_wheeled;
 };
 
 /**
@@ -135,6 +140,16 @@ struct hrtimer_sleeper {
 # define __hrtimer_clock_base_align
 #endif
 
+/*
+ * Short-horizon range timers bypass the timerqueue and go into a
+ * small hashed wheel, one per clock base, so a whole bucket expires
+ * off a single clock event.  The resolution is a power of two so
+ * bucket selection is mask arithmetic, and the wheel spans
+ * HRTIMER_WHEEL_SLOTS * HRTIMER_WHEEL_RES (~16ms) of horizon.
+ */
+#define HRTIMER_WHEEL_RES	(1UL << 20)	/* ~1.05ms in ns */
+#define HRTIMER_WHEEL_SLOTS	16
+
 /**
  * struct hrtimer_clock_base - the timer base for a specific clock
  * @cpu_base:		per cpu clock base
@@ -146,6 +161,9 @@ struct hrtimer_sleeper {
  * @active:		red black tree root node for the active timers
  * @get_time:		function to retrieve the current time of the clock
  * @offset:		offset of this clock to the monotonic base
+ * @wheel_occupied:	bitmap of non-empty wheel buckets
+ * @wheel_deadline:	absolute expiry of each wheel bucket
+ * @wheel:		bucket lists for short-horizon range timers
  */
 struct hrtimer_clock_base {
 	struct hrtimer_cpu_base	*cpu_base;
@@ -156,6 +174,9 @@ struct hrtimer_clock_base {
 	struct timerqueue_head	active;
 	ktime_t			(*get_time)(void);
 	ktime_t			offset;
+	unsigned int		wheel_occupied;
+	ktime_t			wheel_deadline[HRTIMER_WHEEL_SLOTS];
+	struct list_head	wheel[HRTIMER_WHEEL_SLOTS];
 } __hrtimer_clock_base_align;
 
 enum  hrtimer_base_type {
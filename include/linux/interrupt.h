@@ -349,6 +349,24 @@ irq_calc_affinity_vectors(int minvec, int maxvec, const struct irq_affinity *aff
 
 #endif /* CONFIG_SMP */
 
+/*
+ * Interrupt timing instrumentation. Recording is gated by a static key
+ * which consumers of the prediction API enable on first use; see
+ * kernel/irq/timings.c.
+ */
+#ifdef CONFIG_IRQ_TIMINGS
+extern void irq_timings_enable(void);
+extern void irq_timings_disable(void);
+extern u64 irq_timings_next_irq(unsigned int irq, u64 now);
+#else
+static inline void irq_timings_enable(void) { }
+static inline void irq_timings_disable(void) { }
+static inline u64 irq_timings_next_irq(unsigned int irq, u64 now)
+{
+	return U64_MAX;
+}
+#endif
+
 /*
  * Special lockdep variants of irq disabling/enabling.
  * These should be used for locking constructs that
@@ -27,6 +27,7 @@
 #include <linux/journal-head.h>
 #include <linux/stddef.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/timer.h>
 #include <linux/slab.h>
 #include <linux/bit_spinlock.h>
@@ -710,6 +711,18 @@ struct transaction_s
 	struct list_head	t_private_list;
 };
 
+/*
+ * Per-CPU cache of credits already charged to the running transaction.
+ * Handles that fit are served from the cache without touching
+ * t_outstanding_credits; credits left over from an older transaction
+ * are simply discarded (they were accounted to a transaction which has
+ * since committed).
+ */
+struct jbd2_credit_cache {
+	tid_t			cc_tid;
+	int			cc_credits;
+};
+
 struct transaction_run_stats_s {
 	unsigned long		rs_wait;
 	unsigned long		rs_request_delay;
@@ -944,6 +957,15 @@ struct journal_s
 	 */
 	atomic_t		j_reserved_credits;
 
+	/**
+	 * @j_credit_cache:
+	 *
+	 * Per-CPU caches of credits batch-charged to the running
+	 * transaction, used to serve small handles without contending
+	 * on t_outstanding_credits.
+	 */
+	struct jbd2_credit_cache __percpu *j_credit_cache;
+
 	/**
 	 * @j_list_lock: Protects the buffer lists and internal buffer state.
 	 */
@@ -27,12 +27,15 @@
 #include <linux/irqbypass.h>
 #include <linux/swait.h>
 #include <linux/refcount.h>
+#include <linux/hashtable.h>
+#include <linux/llist.h>
 #include <asm/signal.h>
 
 #include <linux/kvm.h>
 #include <linux/kvm_para.h>
 
 #include <linux/kvm_types.h>
+#include <linux/kvm_dirty_ring.h>
 
 #include <asm/kvm_host.h>
 
@@ -180,12 +183,14 @@ struct kvm_io_device *kvm_io_bus_get_dev(struct kvm *kvm, enum kvm_bus bus_idx,
 #ifdef CONFIG_KVM_ASYNC_PF
 struct kvm_async_pf {
 	struct work_struct work;
+	struct llist_node dlink;
 	struct list_head link;
 	struct list_head queue;
 	struct kvm_vcpu *vcpu;
 	struct mm_struct *mm;
 	gva_t gva;
 	unsigned long addr;
+	unsigned long nr_pages;
 	struct kvm_arch_async_pf arch;
 	bool   wakeup_all;
 };
@@ -254,8 +259,10 @@ struct kvm_vcpu {
 	struct {
 		u32 queued;
 		struct list_head queue;
-		struct list_head done;
-		spinlock_t lock;
+		struct llist_head done;	/* lock-free completion posting */
+		struct list_head ready;	/* harvested, only touched by the vcpu */
+		u64 next_page;		/* hva page following the last fault */
+		u32 prefetch;		/* current fault-in window, in pages */
 	} async_pf;
 #endif
 
@@ -272,6 +279,7 @@ struct kvm_vcpu {
 	} spin_loop;
 #endif
 	bool preempted;
+	struct kvm_dirty_ring dirty_ring;
 	struct kvm_vcpu_arch arch;
 	struct dentry *debugfs_dentry;
 };
@@ -301,6 +309,7 @@ struct kvm_memory_slot {
 	unsigned long userspace_addr;
 	u32 flags;
 	short id;
+	short as_id;
 };
 
 static inline unsigned long kvm_dirty_bitmap_bytes(struct kvm_memory_slot *memslot)
@@ -413,6 +422,8 @@ struct kvm {
 		struct mutex      resampler_lock;
 	} irqfds;
 	struct list_head ioeventfds;
+	DECLARE_HASHTABLE(ioeventfd_hash, 7);
+	u64 ioeventfd_kicks[KVM_NR_BUSES];
 #endif
 	struct kvm_vm_stat stat;
 	struct kvm_arch arch;
@@ -446,6 +457,7 @@ struct kvm {
 	struct srcu_struct srcu;
 	struct srcu_struct irq_srcu;
 	pid_t userspace_pid;
+	u32 dirty_ring_size;
 };
 
 #define kvm_err(fmt, ...) \
@@ -696,6 +708,9 @@ bool kvm_is_visible_gfn(struct kvm *kvm, gfn_t gfn);
 unsigned long kvm_host_page_size(struct kvm *kvm, gfn_t gfn);
 void mark_page_dirty(struct kvm *kvm, gfn_t gfn);
 
+struct kvm_vcpu *kvm_get_running_vcpu(void);
+int kvm_vm_ioctl_enable_dirty_log_ring(struct kvm *kvm, u32 size);
+
 struct kvm_memslots *kvm_vcpu_memslots(struct kvm_vcpu *vcpu);
 struct kvm_memory_slot *kvm_vcpu_gfn_to_memslot(struct kvm_vcpu *vcpu, gfn_t gfn);
 kvm_pfn_t kvm_vcpu_gfn_to_pfn_atomic(struct kvm_vcpu *vcpu, gfn_t gfn);
@@ -1075,6 +1090,8 @@ int kvm_send_userspace_msi(struct kvm *kvm, struct kvm_msi *msi);
 
 void kvm_eventfd_init(struct kvm *kvm);
 int kvm_ioeventfd(struct kvm *kvm, struct kvm_ioeventfd *args);
+int kvm_ioeventfd_write(struct kvm_vcpu *vcpu, enum kvm_bus bus_idx,
+			gpa_t addr, int len, const void *val);
 
 #ifdef CONFIG_HAVE_KVM_IRQFD
 int kvm_irqfd(struct kvm *kvm, struct kvm_irqfd *args);
@@ -1111,6 +1128,13 @@ static inline int kvm_ioeventfd(struct kvm *kvm, struct kvm_ioeventfd *args)
 	return -ENOSYS;
 }
 
+static inline int kvm_ioeventfd_write(struct kvm_vcpu *vcpu,
+				      enum kvm_bus bus_idx, gpa_t addr,
+				      int len, const void *val)
+{
+	return -EOPNOTSUPP;
+}
+
 #endif /* CONFIG_HAVE_KVM_EVENTFD */
 
 void kvm_arch_irq_routing_update(struct kvm *kvm);
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Lightweight lock contention sampler.
+ *
+ * Unlike CONFIG_LOCK_STAT this does not depend on lockdep and is cheap
+ * enough to stay enabled in production: when the sample rate is zero
+ * (the default) the slowpath cost is a single per-CPU load.
+ */
+#ifndef _LINUX_LOCK_SAMPLE_H
+#define _LINUX_LOCK_SAMPLE_H
+
+#include <linux/types.h>
+
+/*
+ * Call _start() on entry to a lock slowpath; it returns a nonzero
+ * timestamp cookie if this contention event was selected for sampling,
+ * 0 otherwise. Once the lock has been acquired, pass the cookie to
+ * _end(), which records the sample; a zero cookie is ignored, so the
+ * call may be made unconditionally.
+ */
+extern u64 lock_contention_sample_start(void);
+extern void lock_contention_sample_end(void *lock, u64 start,
+				       unsigned long ip);
+
+#endif /* _LINUX_LOCK_SAMPLE_H */
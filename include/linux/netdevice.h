@@ -301,6 +301,12 @@ struct netdev_boot_setup {
 
 int __init netdev_boot_setup(char *str);
 
+/*
+ * Held GRO packets are bucketed by flow hash; each bucket holds up to
+ * MAX_GRO_SKBS flows, so unrelated flows stop evicting each other.
+ */
+#define GRO_HASH_BUCKETS	8
+
 /*
  * Structure for NAPI scheduling similar to tasklet but with weighting
  */
@@ -321,7 +327,7 @@ struct napi_struct {
 	int			poll_owner;
 #endif
 	struct net_device	*dev;
-	struct sk_buff		*gro_list;
+	struct sk_buff		*gro_hash[GRO_HASH_BUCKETS];
 	struct sk_buff		*skb;
 	struct hrtimer		timer;
 	struct list_head	dev_list;
@@ -645,11 +651,21 @@ struct rps_dev_flow_table {
  * possible CPUs : rps_cpu_mask = roundup_pow_of_two(nr_cpu_ids) - 1
  * For example, if 64 CPUs are possible, rps_cpu_mask = 0x3f,
  * meaning we use 32-6=26 bits for the hash.
+ *
+ * Each entry also records the (truncated) jiffies of the last time an
+ * application thread refreshed it, so that get_rps_cpu() can ignore
+ * entries left behind by dead flows instead of mis-steering colliding
+ * flows to an unrelated CPU (see rps_sock_flow_expire).
  */
+struct rps_sock_flow_ent {
+	u32	val;		/* upper flow hash bits | CPU number */
+	u32	time;		/* low jiffies bits at last record */
+};
+
 struct rps_sock_flow_table {
 	u32	mask;
 
-	u32	ents[0] ____cacheline_aligned_in_smp;
+	struct rps_sock_flow_ent ents[0] ____cacheline_aligned_in_smp;
 };
 #define	RPS_SOCK_FLOW_TABLE_SIZE(_num) (offsetof(struct rps_sock_flow_table, ents[_num]))
 
@@ -657,19 +673,24 @@ struct rps_sock_flow_table {
 
 extern u32 rps_cpu_mask;
 extern struct rps_sock_flow_table __rcu *rps_sock_flow_table;
+extern int rps_sock_flow_expire;
+extern int rps_numa_steering;
 
 static inline void rps_record_sock_flow(struct rps_sock_flow_table *table,
 					u32 hash)
 {
 	if (table && hash) {
-		unsigned int index = hash & table->mask;
+		struct rps_sock_flow_ent *ent = &table->ents[hash & table->mask];
 		u32 val = hash & ~rps_cpu_mask;
+		u32 now = (u32)jiffies;
 
 		/* We only give a hint, preemption can change CPU under us */
 		val |= raw_smp_processor_id();
 
-		if (table->ents[index] != val)
-			table->ents[index] = val;
+		if (ent->val != val)
+			ent->val = val;
+		if (ent->time != now)
+			ent->time = now;
 	}
 }
 
@@ -1664,6 +1685,10 @@ enum netdev_priv_flags {
  *			switch driver and used to set the phys state of the
  *			switch port.
  *
+ *	@ifinfo_gen:	generation of the last rtnetlink link notification
+ *			sent for this device, used to filter delta dumps
+ *
+
  *	FIXME: cleanup struct net_device such that network protocol info
  *	moves out.
  */
@@ -1936,6 +1961,7 @@ struct net_device {
 	struct lock_class_key	*qdisc_tx_busylock;
 	struct lock_class_key	*qdisc_running_key;
 	bool			proto_down;
+	u32			ifinfo_gen;
 };
 #define to_net_dev(d) container_of(d, struct net_device, dev)
 
@@ -3302,6 +3328,7 @@ int netif_rx(struct sk_buff *skb);
 int netif_rx_ni(struct sk_buff *skb);
 int netif_receive_skb(struct sk_buff *skb);
 int netif_receive_skb_core(struct sk_buff *skb);
+void netif_receive_skb_list(struct list_head *head);
 gro_result_t napi_gro_receive(struct napi_struct *napi, struct sk_buff *skb);
 void napi_gro_flush(struct napi_struct *napi, bool flush_old);
 struct sk_buff *napi_get_frags(struct napi_struct *napi);
@@ -3326,6 +3353,7 @@ int dev_ioctl(struct net *net, unsigned int cmd, struct ifreq *ifr,
 		bool *need_copyout);
 int dev_ifconf(struct net *net, struct ifconf *, int);
 int dev_ethtool(struct net *net, struct ifreq *);
+int dev_ethtool_snapshot(struct net *net, struct ifreq *);
 unsigned int dev_get_flags(const struct net_device *);
 int __dev_change_flags(struct net_device *, unsigned int flags);
 int dev_change_flags(struct net_device *, unsigned int);
@@ -15,20 +15,40 @@ struct percpu_rw_semaphore {
 	struct rw_semaphore	rw_sem; /* slowpath */
 	struct rcuwait          writer; /* blocked writer */
 	int			readers_block;
+	int			fast_writer; /* set at init, never changes */
 };
 
-#define DEFINE_STATIC_PERCPU_RWSEM(name)				\
+#define __DEFINE_PERCPU_RWSEM(name, fw)					\
 static DEFINE_PER_CPU(unsigned int, __percpu_rwsem_rc_##name);		\
 static struct percpu_rw_semaphore name = {				\
 	.rss = __RCU_SYNC_INITIALIZER(name.rss, RCU_SCHED_SYNC),	\
 	.read_count = &__percpu_rwsem_rc_##name,			\
 	.rw_sem = __RWSEM_INITIALIZER(name.rw_sem),			\
 	.writer = __RCUWAIT_INITIALIZER(name.writer),			\
+	.fast_writer = (fw),						\
 }
+#define DEFINE_STATIC_PERCPU_RWSEM(name)				\
+	__DEFINE_PERCPU_RWSEM(name, 0)
+#define DEFINE_STATIC_PERCPU_RWSEM_FAST_WRITER(name)			\
+	__DEFINE_PERCPU_RWSEM(name, 1)
 
 extern int __percpu_down_read(struct percpu_rw_semaphore *, int);
 extern void __percpu_up_read(struct percpu_rw_semaphore *);
 
+/*
+ * In fast-writer mode the readers always run the full memory-barrier
+ * protocol in __percpu_down_read()/__percpu_up_read(); in exchange the
+ * writers need not wait for an RCU-sched grace period to flip the
+ * readers onto it, bounding writer latency by the longest reader-side
+ * critical section instead. The extra load is of a never-written field,
+ * so the cacheline stays shared and readers still avoid contended
+ * atomics entirely.
+ */
+static inline bool percpu_rwsem_readers_fast(struct percpu_rw_semaphore *sem)
+{
+	return rcu_sync_is_idle(&sem->rss) && likely(!sem->fast_writer);
+}
+
 static inline void percpu_down_read_preempt_disable(struct percpu_rw_semaphore *sem)
 {
 	might_sleep();
@@ -45,7 +65,7 @@ static inline void percpu_down_read_preempt_disable(struct percpu_rw_semaphore *
 	 * anything we did within this RCU-sched read-size critical section.
 	 */
 	__this_cpu_inc(*sem->read_count);
-	if (unlikely(!rcu_sync_is_idle(&sem->rss)))
+	if (unlikely(!percpu_rwsem_readers_fast(sem)))
 		__percpu_down_read(sem, false); /* Unconditional memory barrier */
 	barrier();
 	/*
@@ -69,7 +89,7 @@ static inline int percpu_down_read_trylock(struct percpu_rw_semaphore *sem)
 	 * Same as in percpu_down_read().
 	 */
 	__this_cpu_inc(*sem->read_count);
-	if (unlikely(!rcu_sync_is_idle(&sem->rss)))
+	if (unlikely(!percpu_rwsem_readers_fast(sem)))
 		ret = __percpu_down_read(sem, true); /* Unconditional memory barrier */
 	preempt_enable();
 	/*
@@ -93,7 +113,7 @@ static inline void percpu_up_read_preempt_enable(struct percpu_rw_semaphore *sem
 	/*
 	 * Same as in percpu_down_read().
 	 */
-	if (likely(rcu_sync_is_idle(&sem->rss)))
+	if (likely(percpu_rwsem_readers_fast(sem)))
 		__this_cpu_dec(*sem->read_count);
 	else
 		__percpu_up_read(sem); /* Unconditional memory barrier */
@@ -113,6 +133,8 @@ extern void percpu_up_write(struct percpu_rw_semaphore *);
 
 extern int __percpu_init_rwsem(struct percpu_rw_semaphore *,
 				const char *, struct lock_class_key *);
+extern int __percpu_init_rwsem_fast_writer(struct percpu_rw_semaphore *,
+				const char *, struct lock_class_key *);
 
 extern void percpu_free_rwsem(struct percpu_rw_semaphore *);
 
@@ -122,6 +144,16 @@ extern void percpu_free_rwsem(struct percpu_rw_semaphore *);
 	__percpu_init_rwsem(sem, #sem, &rwsem_key);		\
 })
 
+/*
+ * For read-mostly semaphores whose writers care about latency more
+ * than throughput; see percpu_rwsem_readers_fast().
+ */
+#define percpu_init_rwsem_fast_writer(sem)			\
+({								\
+	static struct lock_class_key rwsem_key;			\
+	__percpu_init_rwsem_fast_writer(sem, #sem, &rwsem_key);	\
+})
+
 #define percpu_rwsem_is_held(sem) lockdep_is_held(&(sem)->rw_sem)
 
 #define percpu_rwsem_assert_held(sem)				\
@@ -187,6 +187,24 @@ void ring_buffer_free_read_page(struct ring_buffer *buffer, int cpu, void *data)
 int ring_buffer_read_page(struct ring_buffer *buffer, void **data_page,
 			  size_t len, int cpu, int full);
 
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+int ring_buffer_compress_page(struct ring_buffer *buffer, void *src,
+			      void *dst, size_t len);
+int ring_buffer_decompress_page(void *dst, size_t dst_len,
+				const void *src, size_t src_len);
+#else
+static inline int ring_buffer_compress_page(struct ring_buffer *buffer,
+					    void *src, void *dst, size_t len)
+{
+	return -ENODEV;
+}
+static inline int ring_buffer_decompress_page(void *dst, size_t dst_len,
+					      const void *src, size_t src_len)
+{
+	return -ENODEV;
+}
+#endif
+
 struct trace_seq;
 
 int ring_buffer_print_entry_header(struct trace_seq *s);
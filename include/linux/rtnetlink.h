@@ -4,6 +4,7 @@
 
 
 #include <linux/mutex.h>
+#include <linux/rwsem.h>
 #include <linux/netdevice.h>
 #include <linux/wait.h>
 #include <uapi/linux/rtnetlink.h>
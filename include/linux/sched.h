@@ -440,6 +440,15 @@ struct sched_dl_entity {
 	u64				dl_runtime;	/* Maximum runtime for each instance	*/
 	u64				dl_deadline;	/* Relative deadline of each instance	*/
 	u64				dl_period;	/* Separation of two instances (period) */
+
+#ifdef CONFIG_CGROUP_SCHED
+	/*
+	 * Group whose deadline bandwidth pool this entity is charged
+	 * to (holding a css reference), or NULL when admission went
+	 * against the root domain bandwidth only.
+	 */
+	struct task_group		*dl_pool_tg;
+#endif
 	u64				dl_bw;		/* dl_runtime / dl_period		*/
 	u64				dl_density;	/* dl_runtime / dl_deadline		*/
 
@@ -565,6 +574,13 @@ struct task_struct {
 	int				recent_used_cpu;
 	int				wake_cpu;
 #endif
+	/*
+	 * Wakeup pairing hint set with sched_setattr(SCHED_FLAG_PAIR_HINT):
+	 * wakeups of this task prefer the cache domain of the referenced
+	 * task. NULL when no hint is set.
+	 */
+	struct pid			*pair_hint;
+
 	int				on_rq;
 
 	int				prio;
@@ -1094,6 +1110,8 @@ struct task_struct {
 #endif
 #ifdef CONFIG_LIVEPATCH
 	int patch_state;
+	/* context switch count at the last failed patch-state switch */
+	unsigned long patch_csw;
 #endif
 #ifdef CONFIG_SECURITY
 	/* Used by LSM modules for access restriction: */
@@ -59,6 +59,9 @@ struct task_cputime_atomic {
  *			@cputime_atomic receives updates.
  * @checking_timer:	true when a thread in the group is in the
  *			process of checking for thread group timers.
+ * @caching:		true once a process-wide clock read has primed
+ *			@cputime_atomic; keeps @running set so later
+ *			reads are O(1) instead of a thread group walk.
  *
  * This structure contains the version of task_cputime, above, that is
  * used for thread group CPU timer calculations.
@@ -67,6 +70,7 @@ struct thread_group_cputimer {
 	struct task_cputime_atomic cputime_atomic;
 	bool running;
 	bool checking_timer;
+	bool caching;
 };
 
 /*
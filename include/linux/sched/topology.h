@@ -72,8 +72,21 @@ struct sched_domain_shared {
 	atomic_t	ref;
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
+
+	/*
+	 * Mask of CPUs in the domain currently believed to be idle.
+	 * Maintained lock-free from the idle entry/exit paths so that
+	 * wakeups can pick an idle CPU without scanning the whole LLC;
+	 * a set bit is a hint, not a guarantee.
+	 */
+	unsigned long	idle_cpus_span[0];
 };
 
+static inline struct cpumask *sds_idle_cpus(struct sched_domain_shared *sds)
+{
+	return to_cpumask(sds->idle_cpus_span);
+}
+
 struct sched_domain {
 	/* These fields must be setup */
 	struct sched_domain *parent;	/* top domain must be null terminated */
@@ -7,6 +7,8 @@
 #include <uapi/linux/shm.h>
 #include <asm/shmparam.h>
 
+struct mempolicy;
+
 struct shmid_kernel /* private to the kernel */
 {	
 	struct kern_ipc_perm	shm_perm;
@@ -23,6 +25,11 @@ struct shmid_kernel /* private to the kernel */
 	/* The task created the shm object.  NULL if the task is dead. */
 	struct task_struct	*shm_creator;
 	struct list_head	shm_clist;	/* list by creator */
+#ifdef CONFIG_NUMA
+	/* segment-wide placement policy, pushed into the backing file
+	 * at attach time */
+	struct mempolicy	*shm_policy;
+#endif
 } __randomize_layout;
 
 /* shm_mode upper byte flags */
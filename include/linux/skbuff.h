@@ -588,6 +588,7 @@ typedef unsigned char *sk_buff_data_t;
  *	@prev: Previous buffer in list
  *	@tstamp: Time we arrived/left
  *	@rbnode: RB tree node, alternative to next/prev for netem/tcp
+ *	@list: queue head as a list_head, alternative to next/prev for RX lists
  *	@sk: Socket we are owned by
  *	@dev: Device we arrived on/are leaving by
  *	@cb: Control buffer. Free for use by every layer. Put private vars here
@@ -672,6 +673,7 @@ struct sk_buff {
 			};
 		};
 		struct rb_node	rbnode; /* used in netem & tcp stack */
+		struct list_head	list;
 	};
 	struct sock		*sk;
 
@@ -1324,6 +1326,19 @@ static inline void skb_zcopy_abort(struct sk_buff *skb)
 	}
 }
 
+/**
+ *	skb_list_del_init - remove an skb from a list_head based list
+ *	@skb: buffer to unlink
+ *
+ *	Removes @skb from a list built on &sk_buff.list and resets ->next,
+ *	so code that still inspects skb->next (e.g. GSO) sees a lone skb.
+ */
+static inline void skb_list_del_init(struct sk_buff *skb)
+{
+	__list_del_entry(&skb->list);
+	skb->next = NULL;
+}
+
 /**
  *	skb_queue_empty - check if a queue is empty
  *	@list: queue head
@@ -2644,7 +2659,6 @@ static inline struct sk_buff *napi_alloc_skb(struct napi_struct *napi,
 }
 void napi_consume_skb(struct sk_buff *skb, int budget);
 
-void __kfree_skb_flush(void);
 void __kfree_skb_defer(struct sk_buff *skb);
 
 /**
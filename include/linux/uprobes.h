@@ -58,6 +58,15 @@ struct uprobe_consumer {
 	struct uprobe_consumer *next;
 };
 
+/*
+ * One probe of a uprobe_register_batch()/uprobe_unregister_batch()
+ * call; all probes of a batch live in the same file.
+ */
+struct uprobe_batch_entry {
+	loff_t			offset;
+	struct uprobe_consumer	*uc;
+};
+
 #ifdef CONFIG_UPROBES
 #include <asm/uprobes.h>
 
@@ -123,8 +132,10 @@ extern unsigned long uprobe_get_swbp_addr(struct pt_regs *regs);
 extern unsigned long uprobe_get_trap_addr(struct pt_regs *regs);
 extern int uprobe_write_opcode(struct mm_struct *mm, unsigned long vaddr, uprobe_opcode_t);
 extern int uprobe_register(struct inode *inode, loff_t offset, struct uprobe_consumer *uc);
+extern int uprobe_register_batch(struct inode *inode, unsigned int cnt, struct uprobe_batch_entry *entries);
 extern int uprobe_apply(struct inode *inode, loff_t offset, struct uprobe_consumer *uc, bool);
 extern void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc);
+extern void uprobe_unregister_batch(struct inode *inode, unsigned int cnt, struct uprobe_batch_entry *entries);
 extern int uprobe_mmap(struct vm_area_struct *vma);
 extern void uprobe_munmap(struct vm_area_struct *vma, unsigned long start, unsigned long end);
 extern void uprobe_start_dup_mmap(void);
@@ -161,6 +172,12 @@ uprobe_register(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
 	return -ENOSYS;
 }
 static inline int
+uprobe_register_batch(struct inode *inode, unsigned int cnt,
+		      struct uprobe_batch_entry *entries)
+{
+	return -ENOSYS;
+}
+static inline int
 uprobe_apply(struct inode *inode, loff_t offset, struct uprobe_consumer *uc, bool add)
 {
 	return -ENOSYS;
@@ -169,6 +186,11 @@ static inline void
 uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
 {
 }
+static inline void
+uprobe_unregister_batch(struct inode *inode, unsigned int cnt,
+			struct uprobe_batch_entry *entries)
+{
+}
 static inline int uprobe_mmap(struct vm_area_struct *vma)
 {
 	return 0;
@@ -233,6 +233,32 @@ XZ_EXTERN void xz_dec_reset(struct xz_dec *s);
  */
 XZ_EXTERN void xz_dec_end(struct xz_dec *s);
 
+#ifdef CONFIG_XZ_DEC_MT
+/**
+ * xz_dec_mt_run() - Decode a whole stream, using several CPUs if possible
+ * @b:          Input and output buffers. The whole compressed stream and
+ *              room for the whole uncompressed output must be present at
+ *              once, like in single-call mode.
+ * @dict_max:   Maximum allowed LZMA2 dictionary size, as for multi-call
+ *              xz_dec_init(). The worker threads decode with their own
+ *              dictionaries, so unlike single-call mode this limit
+ *              matters here.
+ *
+ * The blocks of the stream are decoded in parallel on the online CPUs
+ * when the block headers carry the size fields that block splitting
+ * (e.g. xz --block-size or -T) produces. Streams without them, and
+ * systems with a single CPU, are handled with an internal fall back to
+ * sequential single-call decoding, so this can be called for any stream.
+ *
+ * Must be called from process context; not usable in the preboot
+ * environment.
+ *
+ * Return:      XZ_STREAM_END on success, otherwise an error code with
+ *              the same meanings as in xz_dec_run().
+ */
+XZ_EXTERN enum xz_ret xz_dec_mt_run(struct xz_buf *b, uint32_t dict_max);
+#endif
+
 /*
  * Standalone build (userspace build or in-kernel build for boot time use)
  * needs a CRC32 implementation. For normal in-kernel use, kernel's own
@@ -650,6 +650,61 @@ size_t ZSTD_CStreamOutSize(void);
 
 
 
+/*-*****************************************************************************
+ * Per-CPU compression context pool
+ *
+ * The pool keeps one lazily allocated workspace per CPU, sized for the
+ * largest set of compression parameters used on that CPU so far, so that
+ * frequent callers do not re-allocate multi-megabyte workspaces for every
+ * operation. A context taken from the pool is only valid until the matching
+ * put call; preemption is disabled in between, so the caller must not sleep
+ * and should compress one source (possibly in several streaming chunks)
+ * before releasing the context. Process context only.
+ ******************************************************************************/
+
+/**
+ * ZSTD_getPerCPUCCtx() - take this CPU's pooled compression context
+ * @params: The parameters to use for compression. The workspace is sized
+ *          for params.cParams and grown if a previous user left a smaller
+ *          one behind.
+ *
+ * Return:  An initialized compression context, valid until
+ *          ZSTD_putPerCPUCCtx() is called, or NULL if the workspace
+ *          allocation failed. On failure no put call must be made.
+ */
+ZSTD_CCtx *ZSTD_getPerCPUCCtx(ZSTD_parameters params);
+
+/**
+ * ZSTD_putPerCPUCCtx() - release the context taken by ZSTD_getPerCPUCCtx()
+ */
+void ZSTD_putPerCPUCCtx(void);
+
+/**
+ * ZSTD_getPerCPUCStream() - take this CPU's pooled streaming context
+ * @params:         The zstd compression parameters.
+ * @pledgedSrcSize: The source size, or zero if unknown, as for
+ *                  ZSTD_initCStream().
+ *
+ * The returned stream keeps its window across ZSTD_compressStream() calls,
+ * so a multi-page extent fed in page-sized chunks is matched against the
+ * whole history instead of restarting on every chunk.
+ *
+ * Return:          An initialized streaming compression context, valid until
+ *                  ZSTD_putPerCPUCStream() is called, or NULL if the
+ *                  workspace allocation failed. On failure no put call must
+ *                  be made.
+ */
+ZSTD_CStream *ZSTD_getPerCPUCStream(ZSTD_parameters params,
+	unsigned long long pledgedSrcSize);
+
+/**
+ * ZSTD_putPerCPUCStream() - release the context taken by
+ *                           ZSTD_getPerCPUCStream()
+ */
+void ZSTD_putPerCPUCStream(void);
+
+
+
 /*-*****************************************************************************
  * Streaming decompression - HowTo
  *
@@ -27,10 +27,18 @@
 #define NET_9P_CLIENT_H
 
 #include <linux/utsname.h>
+#include <linux/percpu_ida.h>
 
 /* Number of requests per row */
 #define P9_ROW_MAXTAG 255
 
+/*
+ * Size of the transaction tag space.  The wire format allows 64k tags,
+ * but in-flight requests are bounded by the transport anyway and a
+ * smaller pool keeps the percpu freelists compact.
+ */
+#define P9_MAX_TAG 1024
+
 /** enum p9_proto_versions - 9P protocol versions
  * @p9_proto_legacy: 9P Legacy mode, pre-9P2000.u
  * @p9_proto_2000u: 9P2000.u extension
@@ -130,7 +138,7 @@ struct p9_req_t {
  * @trans: tranport instance state and API
  * @fidpool: fid handle accounting for session
  * @fidlist: List of active fid handles
- * @tagpool - transaction id accounting for session
+ * @tagpool - percpu transaction id accounting for session
  * @reqs - 2D array of requests
  * @max_tag - current maximum tag id allocated
  * @name - node name used as client id
@@ -143,8 +151,9 @@ struct p9_req_t {
  * transactions, we make this a 2D array, allocating new rows
  * when we need to grow the total number of the transactions.
  *
- * Each row is 256 requests and we'll support up to 256 rows for
- * a total of 64k concurrent requests per session.
+ * Each row is 256 requests; rows are allocated on demand as tags
+ * handed out by the percpu pool grow past the current table, up to
+ * P9_MAX_TAG concurrent requests per session.
  *
  * Bugs: duplicated data and potentially unnecessary elements.
  */
@@ -172,7 +181,7 @@ struct p9_client {
 	struct p9_idpool *fidpool;
 	struct list_head fidlist;
 
-	struct p9_idpool *tagpool;
+	struct percpu_ida tagpool;
 	struct p9_req_t *reqs[P9_ROW_MAXTAG];
 	int max_tag;
 
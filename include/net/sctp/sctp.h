@@ -216,6 +216,7 @@ int sctp_send_add_streams(struct sctp_association *asoc,
   * sctp/protocol.c
   */
 extern struct kmem_cache *sctp_chunk_cachep __read_mostly;
+extern struct kmem_cache *sctp_datamsg_cachep __read_mostly;
 extern struct kmem_cache *sctp_bucket_cachep __read_mostly;
 extern long sysctl_sctp_mem[3];
 extern int sysctl_sctp_rmem[3];
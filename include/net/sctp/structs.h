@@ -670,6 +670,7 @@ void sctp_chunk_put(struct sctp_chunk *);
 int sctp_user_addto_chunk(struct sctp_chunk *chunk, int len,
 			  struct iov_iter *from);
 void sctp_chunk_free(struct sctp_chunk *);
+void sctp_chunk_cache_purge(struct sctp_association *asoc);
 void  *sctp_addto_chunk(struct sctp_chunk *, int len, const void *data);
 struct sctp_chunk *sctp_chunkify(struct sk_buff *,
 				 const struct sctp_association *,
@@ -2019,6 +2020,16 @@ struct sctp_association {
 
 	struct sctp_chunk *strreset_chunk; /* save request chunk */
 
+	/* A small pool of chunk structures recycled as chunks are
+	 * released on SACK, so steady state transmission does not go
+	 * back to the slab allocator for every DATA chunk.  It has its
+	 * own lock because inbound chunks are carved off before the
+	 * socket is locked.
+	 */
+	spinlock_t chunk_cache_lock;
+	struct list_head chunk_cache;
+	int chunk_cache_len;
+
 	struct sctp_priv_assoc_stats stats;
 
 	int sent_cnt_removable;
@@ -1564,6 +1564,8 @@ struct ib_cq {
 	atomic_t          	usecnt; /* count number of work queues */
 	enum ib_poll_context	poll_ctx;
 	struct ib_wc		*wc;
+	int			comp_batch; /* adaptive WCs per ib_poll_cq() */
+	struct cpumask		*comp_cpumask; /* see ib_cq_set_affinity() */
 	union {
 		struct irq_poll		iop;
 		struct work_struct	work;
@@ -3154,6 +3156,7 @@ struct ib_cq *__ib_alloc_cq(struct ib_device *dev, void *private,
 
 void ib_free_cq(struct ib_cq *cq);
 int ib_process_cq_direct(struct ib_cq *cq, int budget);
+int ib_cq_set_affinity(struct ib_cq *cq, const struct cpumask *mask);
 
 /**
  * ib_create_cq - Creates a CQ on the specified device.
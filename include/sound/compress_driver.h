@@ -43,6 +43,9 @@ struct snd_compr_ops;
  * @buffer_size: size of the above buffer
  * @fragment_size: size of buffer fragment in bytes
  * @fragments: number of such fragments
+ * @wake_threshold: bytes that must be writable (playback) before poll
+ *	reports the stream ready and fragment wakeups are delivered,
+ *	defaults to one fragment
  * @total_bytes_available: cumulative number of bytes made available in
  *	the ring buffer
  * @total_bytes_transferred: cumulative bytes transferred by offload DSP
@@ -56,6 +59,7 @@ struct snd_compr_runtime {
 	u64 buffer_size;
 	u32 fragment_size;
 	u32 fragments;
+	u32 wake_threshold;
 	u64 total_bytes_available;
 	u64 total_bytes_transferred;
 	wait_queue_head_t sleep;
@@ -178,7 +182,21 @@ int snd_compress_new(struct snd_card *card, int device,
  */
 static inline void snd_compr_fragment_elapsed(struct snd_compr_stream *stream)
 {
-	wake_up(&stream->runtime->sleep);
+	struct snd_compr_runtime *runtime = stream->runtime;
+
+	if (stream->direction == SND_COMPRESS_PLAYBACK &&
+	    runtime->state == SNDRV_PCM_STATE_RUNNING) {
+		u64 queued = runtime->total_bytes_available -
+			     runtime->total_bytes_transferred;
+
+		/* aggregate wakeups until a threshold's worth of the ring
+		 * has been consumed; the next elapsed fragment re-checks,
+		 * so a stale snapshot only delays the wakeup by a fragment
+		 */
+		if (runtime->buffer_size - queued < runtime->wake_threshold)
+			return;
+	}
+	wake_up(&runtime->sleep);
 }
 
 static inline void snd_compr_drain_notify(struct snd_compr_stream *stream)
@@ -651,6 +651,76 @@ unsigned long _snd_pcm_stream_lock_irqsave(struct snd_pcm_substream *substream);
 void snd_pcm_stream_unlock_irqrestore(struct snd_pcm_substream *substream,
 				      unsigned long flags);
 
+/*
+ * The mmap'ed status record carries a sequence count so that the
+ * (state, hw_ptr, tstamp, audio_tstamp) tuple can be read consistently
+ * without taking the stream lock; the count is odd while an update is in
+ * flight.  Writers always hold the stream lock, hence plain increments
+ * suffice; the begin/end pair must not nest.
+ */
+
+/**
+ * snd_pcm_status_seq_begin - open a status update window
+ * @runtime: PCM runtime instance
+ *
+ * Mark the mmap'ed status record as being updated.  Must be called with
+ * the stream lock held, paired with snd_pcm_status_seq_end().
+ */
+static inline void snd_pcm_status_seq_begin(struct snd_pcm_runtime *runtime)
+{
+	volatile struct snd_pcm_mmap_status *s = runtime->status;
+
+	WRITE_ONCE(s->seq, s->seq + 1);
+	smp_wmb(); /* seq bump before the payload writes */
+}
+
+/**
+ * snd_pcm_status_seq_end - close a status update window
+ * @runtime: PCM runtime instance
+ */
+static inline void snd_pcm_status_seq_end(struct snd_pcm_runtime *runtime)
+{
+	volatile struct snd_pcm_mmap_status *s = runtime->status;
+
+	smp_wmb(); /* payload writes before the seq bump */
+	WRITE_ONCE(s->seq, s->seq + 1);
+}
+
+/**
+ * snd_pcm_status_snapshot - read the status record without the stream lock
+ * @runtime: PCM runtime instance
+ * @dst: status record to fill
+ *
+ * Copy the timestamped position fields published by the update sites in
+ * pcm_lib.c, retrying while an update is in flight.
+ */
+static inline void snd_pcm_status_snapshot(struct snd_pcm_runtime *runtime,
+					   struct snd_pcm_mmap_status *dst)
+{
+	volatile struct snd_pcm_mmap_status *s = runtime->status;
+	u32 seq;
+
+	for (;;) {
+		seq = READ_ONCE(s->seq);
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+		smp_rmb(); /* seq check before the payload reads */
+		dst->state = s->state;
+		dst->hw_ptr = s->hw_ptr;
+		dst->tstamp.tv_sec = s->tstamp.tv_sec;
+		dst->tstamp.tv_nsec = s->tstamp.tv_nsec;
+		dst->suspended_state = s->suspended_state;
+		dst->audio_tstamp.tv_sec = s->audio_tstamp.tv_sec;
+		dst->audio_tstamp.tv_nsec = s->audio_tstamp.tv_nsec;
+		smp_rmb(); /* payload reads before the seq re-check */
+		if (READ_ONCE(s->seq) == seq)
+			return;
+		cpu_relax();
+	}
+}
+
 /**
  * snd_pcm_group_for_each_entry - iterate over the linked substreams
  * @s: the iterator
@@ -81,6 +81,32 @@ DEFINE_EVENT(lock, lock_acquired,
 #endif
 #endif
 
+/*
+ * Fired by the lightweight contention sampler in
+ * kernel/locking/lock_sample.c; available without lockdep.
+ */
+TRACE_EVENT(lock_contention_sample,
+
+	TP_PROTO(void *lock, unsigned long ip, u64 wait_ns),
+
+	TP_ARGS(lock, ip, wait_ns),
+
+	TP_STRUCT__entry(
+		__field(	void *,		lock	)
+		__field(	unsigned long,	ip	)
+		__field(	u64,		wait_ns	)
+	),
+
+	TP_fast_assign(
+		__entry->lock = lock;
+		__entry->ip = ip;
+		__entry->wait_ns = wait_ns;
+	),
+
+	TP_printk("lock=%p caller=%pS wait_ns=%llu",
+		  __entry->lock, (void *)__entry->ip, __entry->wait_ns)
+);
+
 #endif /* _TRACE_LOCK_H */
 
 /* This part must be outside protection */
@@ -107,4 +107,7 @@
 
 #define SO_ZEROCOPY		60
 
+#define SO_RCVBATCH_PKTS	61
+#define SO_RCVBATCH_USECS	62
+
 #endif /* __ASM_GENERIC_SOCKET_H */
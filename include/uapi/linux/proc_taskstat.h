@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_PROC_TASKSTAT_H
+#define _UAPI_LINUX_PROC_TASKSTAT_H
+
+#include <linux/types.h>
+
+/*
+ * Packed per-process record returned by /proc/taskstat.
+ *
+ * The fields carry the same values as their /proc/PID/stat
+ * counterparts: times are in clock ticks, vsize is in bytes and rss
+ * in pages.
+ */
+struct proc_taskstat {
+	__s32 pid;
+	__s32 ppid;
+	__s32 pgid;
+	__s32 sid;
+	__u32 state;		/* same letter as /proc/PID/stat */
+	__u32 flags;
+	__u64 min_flt;
+	__u64 cmin_flt;
+	__u64 maj_flt;
+	__u64 cmaj_flt;
+	__u64 utime;
+	__u64 stime;
+	__s64 cutime;
+	__s64 cstime;
+	__s32 priority;
+	__s32 nice;
+	__u32 num_threads;
+	__u32 processor;
+	__u64 start_time;
+	__u64 vsize;
+	__u64 rss;
+	__u64 rsslim;
+	__u64 gtime;
+	__s64 cgtime;
+	__u64 blkio_ticks;
+	__u32 rt_priority;
+	__u32 policy;
+};
+
+#endif /* _UAPI_LINUX_PROC_TASKSTAT_H */
@@ -9,6 +9,7 @@ struct sched_param {
 };
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
+#define SCHED_ATTR_SIZE_VER1	52	/* add: sched_pair_pid */
 
 /*
  * Extended scheduling parameters data structure.
@@ -70,6 +71,9 @@ struct sched_attr {
 	__u64 sched_runtime;
 	__u64 sched_deadline;
 	__u64 sched_period;
+
+	/* SCHED_FLAG_PAIR_HINT */
+	__u32 sched_pair_pid;
 };
 
 #endif /* _UAPI_LINUX_SCHED_TYPES_H */
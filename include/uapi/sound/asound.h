@@ -153,7 +153,7 @@ struct snd_hwdep_dsp_image {
  *                                                                           *
  *****************************************************************************/
 
-#define SNDRV_PCM_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 14)
+#define SNDRV_PCM_VERSION		SNDRV_PROTOCOL_VERSION(2, 0, 15)
 
 typedef unsigned long snd_pcm_uframes_t;
 typedef signed long snd_pcm_sframes_t;
@@ -479,6 +479,12 @@ struct snd_pcm_mmap_status {
 	struct timespec tstamp;		/* Timestamp */
 	snd_pcm_state_t suspended_state; /* RO: suspended stream state */
 	struct timespec audio_tstamp;	/* from sample counter or wall clock */
+	__u32 seq;			/* RO: sequence count, odd while the
+					 * fields above are being updated;
+					 * re-read when it changed or is odd
+					 * (req. proto >= 2.0.15)
+					 */
+	__u32 pad2;
 };
 
 struct snd_pcm_mmap_control {
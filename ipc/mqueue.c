@@ -38,6 +38,7 @@
 #include <linux/sched/wake_q.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/user.h>
+#include <linux/ptr_ring.h>
 
 #include <net/sock.h>
 #include "util.h"
@@ -74,6 +75,22 @@ struct mqueue_inode_info {
 	struct posix_msg_tree_node *node_cache;
 	struct mq_attr attr;
 
+	/*
+	 * MQ_RING: equal-priority FIFO mode. Messages flow through a
+	 * preallocated pointer ring instead of the rb-tree, and the two
+	 * ends synchronize on the ring's own producer/consumer locks
+	 * instead of info->lock. See mq_ring_send()/mq_ring_recv().
+	 */
+	struct ptr_ring msg_ring;
+	wait_queue_head_t ring_wait[2];	/* blocked senders/receivers */
+	atomic_t ring_waiters[2];
+	/* written by senders, under msg_ring.producer_lock */
+	unsigned long ring_sent ____cacheline_aligned_in_smp;
+	unsigned long ring_sent_bytes;
+	/* written by receivers, under msg_ring.consumer_lock */
+	unsigned long ring_recvd ____cacheline_aligned_in_smp;
+	unsigned long ring_recvd_bytes;
+
 	struct sigevent notify;
 	struct pid *notify_owner;
 	struct user_namespace *notify_user_ns;
@@ -101,6 +118,21 @@ static inline struct mqueue_inode_info *MQUEUE_I(struct inode *inode)
 	return container_of(inode, struct mqueue_inode_info, vfs_inode);
 }
 
+static inline bool mq_ring_mode(struct mqueue_inode_info *info)
+{
+	return info->attr.mq_flags & MQ_RING;
+}
+
+/*
+ * The counters are updated under the respective ring lock; unlocked
+ * readers may see a slightly stale count, which is fine for the sleep
+ * conditions, poll and attribute reporting they serve.
+ */
+static inline long mq_ring_curmsgs(struct mqueue_inode_info *info)
+{
+	return READ_ONCE(info->ring_sent) - READ_ONCE(info->ring_recvd);
+}
+
 /*
  * This routine should be called with the mq_lock held.
  */
@@ -248,6 +280,13 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		info->user = NULL;	/* set when all is ok */
 		info->msg_tree = RB_ROOT;
 		info->node_cache = NULL;
+		info->msg_ring.queue = NULL;
+		init_waitqueue_head(&info->ring_wait[SEND]);
+		init_waitqueue_head(&info->ring_wait[RECV]);
+		atomic_set(&info->ring_waiters[SEND], 0);
+		atomic_set(&info->ring_waiters[RECV], 0);
+		info->ring_sent = info->ring_sent_bytes = 0;
+		info->ring_recvd = info->ring_recvd_bytes = 0;
 		memset(&info->attr, 0, sizeof(info->attr));
 		info->attr.mq_maxmsg = min(ipc_ns->mq_msg_max,
 					   ipc_ns->mq_msg_default);
@@ -256,6 +295,7 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		if (attr) {
 			info->attr.mq_maxmsg = attr->mq_maxmsg;
 			info->attr.mq_msgsize = attr->mq_msgsize;
+			info->attr.mq_flags = attr->mq_flags & MQ_RING;
 		}
 		/*
 		 * We used to allocate a static array of pointers and account
@@ -287,6 +327,12 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		/* check for overflow */
 		if (info->attr.mq_msgsize > ULONG_MAX/info->attr.mq_maxmsg)
 			goto out_inode;
+		if (mq_ring_mode(info)) {
+			ret = ptr_ring_init(&info->msg_ring,
+					    info->attr.mq_maxmsg, GFP_KERNEL);
+			if (ret)
+				goto out_inode;
+		}
 		mq_treesize = info->attr.mq_maxmsg * sizeof(struct msg_msg) +
 			min_t(unsigned int, info->attr.mq_maxmsg, MQ_PRIO_MAX) *
 			sizeof(struct posix_msg_tree_node);
@@ -433,6 +479,12 @@ static void mqueue_evict_inode(struct inode *inode)
 	kfree(info->node_cache);
 	spin_unlock(&info->lock);
 
+	if (mq_ring_mode(info) && info->msg_ring.queue) {
+		while ((msg = ptr_ring_consume(&info->msg_ring)) != NULL)
+			free_msg(msg);
+		ptr_ring_cleanup(&info->msg_ring, NULL);
+	}
+
 	/* Total amount of bytes accounted for the mqueue */
 	mq_treesize = info->attr.mq_maxmsg * sizeof(struct msg_msg) +
 		min_t(unsigned int, info->attr.mq_maxmsg, MQ_PRIO_MAX) *
@@ -539,6 +591,9 @@ static ssize_t mqueue_read_file(struct file *filp, char __user *u_data,
 	spin_lock(&info->lock);
 	snprintf(buffer, sizeof(buffer),
 			"QSIZE:%-10lu NOTIFY:%-5d SIGNO:%-5d NOTIFY_PID:%-6d\n",
+			mq_ring_mode(info) ?
+				READ_ONCE(info->ring_sent_bytes) -
+				READ_ONCE(info->ring_recvd_bytes) :
 			info->qsize,
 			info->notify_owner ? info->notify.sigev_notify : 0,
 			(info->notify_owner &&
@@ -576,6 +631,16 @@ static __poll_t mqueue_poll_file(struct file *filp, struct poll_table_struct *po
 
 	poll_wait(filp, &info->wait_q, poll_tab);
 
+	if (mq_ring_mode(info)) {
+		long curmsgs = mq_ring_curmsgs(info);
+
+		if (curmsgs)
+			retval = EPOLLIN | EPOLLRDNORM;
+		if (curmsgs < info->attr.mq_maxmsg)
+			retval |= EPOLLOUT | EPOLLWRNORM;
+		return retval;
+	}
+
 	spin_lock(&info->lock);
 	if (info->attr.mq_curmsgs)
 		retval = EPOLLIN | EPOLLRDNORM;
@@ -679,9 +744,10 @@ static void __do_notify(struct mqueue_inode_info *info)
 	 * invoked when there is registered process and there isn't process
 	 * waiting synchronously for message AND state of queue changed from
 	 * empty to not empty. Here we are sure that no one is waiting
-	 * synchronously. */
+	 * synchronously. In ring mode the caller checked the transition,
+	 * mq_curmsgs is not maintained there. */
 	if (info->notify_owner &&
-	    info->attr.mq_curmsgs == 1) {
+	    (mq_ring_mode(info) || info->attr.mq_curmsgs == 1)) {
 		struct siginfo sig_i;
 		switch (info->notify.sigev_notify) {
 		case SIGEV_NONE:
@@ -940,6 +1006,132 @@ static inline void pipelined_receive(struct wake_q_head *wake_q,
 	sender->state = STATE_READY;
 }
 
+/*
+ * Wait until the ring may have room (SEND) or a message (RECV) again.
+ * Unlike wq_sleep() this runs without info->lock; the waiter count plus
+ * the barrier implied by prepare_to_wait() pair with the smp_mb() after
+ * the ring update on the other side, so a concurrent producer/consumer
+ * either sees our waiter count or we see its counter update.
+ */
+static int mq_ring_sleep(struct mqueue_inode_info *info, int sr,
+			 ktime_t *timeout)
+{
+	DEFINE_WAIT(wait);
+	signed long time = 1;
+	int ret = 0;
+
+	atomic_inc(&info->ring_waiters[sr]);
+	for (;;) {
+		prepare_to_wait(&info->ring_wait[sr], &wait,
+				TASK_INTERRUPTIBLE);
+		if (sr == SEND ?
+		    mq_ring_curmsgs(info) < info->attr.mq_maxmsg :
+		    mq_ring_curmsgs(info) > 0)
+			break;
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		if (time == 0) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+		time = schedule_hrtimeout_range_clock(timeout, 0,
+			HRTIMER_MODE_ABS, CLOCK_REALTIME);
+	}
+	finish_wait(&info->ring_wait[sr], &wait);
+	atomic_dec(&info->ring_waiters[sr]);
+	return ret;
+}
+
+/*
+ * MQ_RING send fast path. The producer lock is private to the sending
+ * side, so an SPSC workload never bounces a lock line between the two
+ * ends, and wakeups are batched: a wakeup is only issued on the
+ * empty->non-empty transition or when a blocked receiver is registered.
+ * Inode timestamps are not maintained on this path, they would dirty a
+ * shared cache line for every message.
+ */
+static int mq_ring_send(struct mqueue_inode_info *info, struct file *filp,
+			struct msg_msg *msg, ktime_t *timeout)
+{
+	bool was_empty;
+	int ret;
+
+	for (;;) {
+		spin_lock(&info->msg_ring.producer_lock);
+		was_empty = info->ring_sent == READ_ONCE(info->ring_recvd);
+		ret = __ptr_ring_produce(&info->msg_ring, msg);
+		if (!ret) {
+			info->ring_sent++;
+			info->ring_sent_bytes += msg->m_ts;
+		}
+		spin_unlock(&info->msg_ring.producer_lock);
+
+		if (!ret)
+			break;
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = mq_ring_sleep(info, SEND, timeout);
+		if (ret)
+			return ret;
+	}
+
+	/* Pairs with the barrier in mq_ring_sleep(). */
+	smp_mb();
+	if (atomic_read(&info->ring_waiters[RECV]))
+		wake_up_interruptible(&info->ring_wait[RECV]);
+
+	if (unlikely(was_empty)) {
+		/* also wakes poll waiters, see __do_notify() */
+		spin_lock(&info->lock);
+		__do_notify(info);
+		spin_unlock(&info->lock);
+	}
+	return 0;
+}
+
+/* MQ_RING receive fast path, the mirror image of mq_ring_send(). */
+static int mq_ring_recv(struct mqueue_inode_info *info, struct file *filp,
+			struct msg_msg **msg, ktime_t *timeout)
+{
+	struct msg_msg *ptr;
+	bool was_full;
+	int ret;
+
+	for (;;) {
+		spin_lock(&info->msg_ring.consumer_lock);
+		was_full = READ_ONCE(info->ring_sent) - info->ring_recvd ==
+			   info->attr.mq_maxmsg;
+		ptr = __ptr_ring_consume(&info->msg_ring);
+		if (ptr) {
+			info->ring_recvd++;
+			info->ring_recvd_bytes += ptr->m_ts;
+		}
+		spin_unlock(&info->msg_ring.consumer_lock);
+
+		if (ptr)
+			break;
+		if (filp->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = mq_ring_sleep(info, RECV, timeout);
+		if (ret)
+			return ret;
+	}
+
+	/* Pairs with the barrier in mq_ring_sleep(). */
+	smp_mb();
+	if (atomic_read(&info->ring_waiters[SEND]))
+		wake_up_interruptible(&info->ring_wait[SEND]);
+
+	if (unlikely(was_full) && wq_has_sleeper(&info->wait_q))
+		wake_up_interruptible_poll(&info->wait_q,
+					   EPOLLOUT | EPOLLWRNORM);
+
+	*msg = ptr;
+	return 0;
+}
+
 static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		size_t msg_len, unsigned int msg_prio,
 		struct timespec64 *ts)
@@ -999,6 +1191,15 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 	msg_ptr->m_ts = msg_len;
 	msg_ptr->m_type = msg_prio;
 
+	if (mq_ring_mode(info)) {
+		/* the ring carries no priorities */
+		if (unlikely(msg_prio))
+			ret = -EINVAL;
+		else
+			ret = mq_ring_send(info, f.file, msg_ptr, timeout);
+		goto out_free;
+	}
+
 	/*
 	 * msg_insert really wants us to have a valid, spare node struct so
 	 * it doesn't have to kmalloc a GFP_ATOMIC allocation, but it will
@@ -1103,6 +1304,11 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 		goto out_fput;
 	}
 
+	if (mq_ring_mode(info)) {
+		ret = mq_ring_recv(info, f.file, &msg_ptr, timeout);
+		goto out_copy;
+	}
+
 	/*
 	 * msg_insert really wants us to have a valid, spare node struct so
 	 * it doesn't have to kmalloc a GFP_ATOMIC allocation, but it will
@@ -1145,6 +1351,7 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 		wake_up_q(&wake_q);
 		ret = 0;
 	}
+out_copy:
 	if (ret == 0) {
 		ret = msg_ptr->m_ts;
 
@@ -1337,7 +1544,8 @@ static int do_mq_getsetattr(int mqdes, struct mq_attr *new, struct mq_attr *old)
 	struct inode *inode;
 	struct mqueue_inode_info *info;
 
-	if (new && (new->mq_flags & (~O_NONBLOCK)))
+	/* MQ_RING is fixed at creation time and ignored here */
+	if (new && (new->mq_flags & ~(O_NONBLOCK | MQ_RING)))
 		return -EINVAL;
 
 	f = fdget(mqdes);
@@ -1356,7 +1564,10 @@ static int do_mq_getsetattr(int mqdes, struct mq_attr *new, struct mq_attr *old)
 
 	if (old) {
 		*old = info->attr;
-		old->mq_flags = f.file->f_flags & O_NONBLOCK;
+		old->mq_flags = (f.file->f_flags & O_NONBLOCK) |
+				(info->attr.mq_flags & MQ_RING);
+		if (mq_ring_mode(info))
+			old->mq_curmsgs = mq_ring_curmsgs(info);
 	}
 	if (new) {
 		audit_mq_getsetattr(mqdes, new);
@@ -177,6 +177,13 @@ static int sysvipc_sem_proc_show(struct seq_file *s, void *it);
  * this smp_load_acquire(), this is guaranteed because the smp_load_acquire()
  * is inside a spin_lock() and after a write from 0 to non-zero a
  * spin_lock()+spin_unlock() is done.
+ *
+ * Additionally, simple alter operations without SEM_UNDO may update
+ * sems[i].semval with cmpxchg() while holding no lock at all, see
+ * perform_fast_semop(). Therefore every writer that only holds the
+ * per-semaphore lock must update semval with cmpxchg() as well; writers
+ * that hold the global lock are excluded from concurrent lockless
+ * updates by the sems[i].fast_refs drain in complexmode_enter().
  */
 
 #define sc_semmsl	sem_ctls[0]
@@ -289,10 +296,23 @@ static void complexmode_enter(struct sem_array *sma)
 	}
 	sma->use_global_lock = USE_GLOBAL_LOCK_HYSTERESIS;
 
+	/*
+	 * Order the use_global_lock store before the fast_refs reads
+	 * below; pairs with the barrier in perform_fast_semop().
+	 */
+	smp_mb();
+
 	for (i = 0; i < sma->sem_nsems; i++) {
 		sem = &sma->sems[i];
 		spin_lock(&sem->lock);
 		spin_unlock(&sem->lock);
+
+		/*
+		 * Wait for lockless operations that started before
+		 * use_global_lock became visible to them.
+		 */
+		while (atomic_read(&sem->fast_refs))
+			cpu_relax();
 	}
 }
 
@@ -505,6 +525,7 @@ static int newary(struct ipc_namespace *ns, struct ipc_params *params)
 		INIT_LIST_HEAD(&sma->sems[i].pending_alter);
 		INIT_LIST_HEAD(&sma->sems[i].pending_const);
 		spin_lock_init(&sma->sems[i].lock);
+		atomic_set(&sma->sems[i].fast_refs, 0);
 	}
 
 	sma->complex_count = 0;
@@ -681,6 +702,47 @@ static int perform_atomic_semop(struct sem_array *sma, struct sem_queue *q)
 	if (unlikely(q->dupsop))
 		return perform_atomic_semop_slow(sma, q);
 
+	/*
+	 * A single alter operation: the per-semaphore lock does not exclude
+	 * perform_fast_semop(), thus the check and the update must be one
+	 * atomic step.
+	 */
+	if (nsops == 1 && sops->sem_op != 0) {
+		curr = &sma->sems[sops->sem_num];
+		sem_op = sops->sem_op;
+
+		if (sops->sem_flg & SEM_UNDO) {
+			int undo = un->semadj[sops->sem_num] - sem_op;
+
+			/* Exceeding the undo range is an error. */
+			if (undo < (-SEMAEM - 1) || undo > SEMAEM)
+				return -ERANGE;
+		}
+
+		for (;;) {
+			int old = READ_ONCE(curr->semval);
+
+			result = old + sem_op;
+			if (result < 0)
+				goto would_block_one;
+			if (result > SEMVMX)
+				return -ERANGE;
+			if (cmpxchg(&curr->semval, old, result) == old)
+				break;
+			cpu_relax();
+		}
+
+		if (sops->sem_flg & SEM_UNDO)
+			un->semadj[sops->sem_num] -= sem_op;
+		curr->sempid = q->pid;
+
+		return 0;
+
+would_block_one:
+		q->blocking = sops;
+		return sops->sem_flg & IPC_NOWAIT ? -EAGAIN : 1;
+	}
+
 	/*
 	 * We scan the semaphore set twice, first to ensure that the entire
 	 * operation can succeed, therefore avoiding any pointless writes
@@ -721,7 +783,13 @@ static int perform_atomic_semop(struct sem_array *sma, struct sem_queue *q)
 
 			un->semadj[sop->sem_num] = undo;
 		}
-		curr->semval += sem_op;
+		/*
+		 * No store for wait-for-zero operations: under only the
+		 * per-semaphore lock, rewriting the unchanged value could
+		 * clobber a concurrent perform_fast_semop() update.
+		 */
+		if (sem_op)
+			curr->semval += sem_op;
 		curr->sempid = q->pid;
 	}
 
@@ -1016,6 +1084,101 @@ static void do_smart_update(struct sem_array *sma, struct sembuf *sops, int nsop
 		set_semotime(sma, sops);
 }
 
+/**
+ * perform_fast_semop - lockless attempt at a simple alter operation
+ * @sma: semaphore array
+ * @sop: the operation; the caller checked nsops == 1, sem_op != 0 and
+ *       that SEM_UNDO is not set.
+ *
+ * Called under the RCU read lock, without holding any semaphore lock.
+ * The update is done with cmpxchg(), the same primitive that locked
+ * single-sop updates use, so no update is ever lost. Writers that hold
+ * the global lock are excluded: use_global_lock is checked after we
+ * made ourselves visible in fast_refs, and complexmode_enter() drains
+ * fast_refs after setting use_global_lock.
+ *
+ * Preemption is disabled while fast_refs is elevated: the drain in
+ * complexmode_enter() spins with the array lock held, so a fast-path
+ * task preempted with its reference raised would deadlock the array.
+ *
+ * Returns 0 if the operation was performed, 1 if the caller must fall
+ * back to the locked path.
+ */
+static int perform_fast_semop(struct sem_array *sma, struct sembuf *sop)
+{
+	struct sem *curr = &sma->sems[sop->sem_num];
+	int sem_op = sop->sem_op;
+	int result;
+
+	preempt_disable();
+	atomic_inc(&curr->fast_refs);
+	/* Pairs with the barrier in complexmode_enter(). */
+	smp_mb__after_atomic();
+
+	if (unlikely(READ_ONCE(sma->use_global_lock)))
+		goto fail;
+
+	/*
+	 * Sleepers must observe our update before going to sleep. If any
+	 * might exist, use the locked path, it performs the wakeups.
+	 */
+	if (unlikely(!list_empty(&curr->pending_alter) ||
+		     !list_empty(&curr->pending_const)))
+		goto fail;
+
+	for (;;) {
+		int old = READ_ONCE(curr->semval);
+
+		result = old + sem_op;
+		if (result < 0 || result > SEMVMX)
+			goto fail;
+		if (cmpxchg(&curr->semval, old, result) == old)
+			break;
+		cpu_relax();
+	}
+
+	curr->sempid = task_tgid_vnr(current);
+	curr->sem_otime = get_seconds();
+
+	/*
+	 * cmpxchg() is a full barrier, thus the re-check below cannot be
+	 * reordered before the update. A task that queued itself
+	 * concurrently either sees the new semval when it re-evaluates
+	 * its operation after queueing (see do_semtimedop()), or its
+	 * queue insertion is visible here and we wake it up.
+	 */
+	if (unlikely(!list_empty(&curr->pending_alter) ||
+		     !list_empty(&curr->pending_const))) {
+		DEFINE_WAKE_Q(wake_q);
+		int locknum;
+
+		/*
+		 * Drop the reference first: whoever holds the global lock
+		 * may be spinning on fast_refs in complexmode_enter().
+		 */
+		atomic_dec(&curr->fast_refs);
+		preempt_enable();
+
+		locknum = sem_lock(sma, sop, 1);
+		/* if the array was removed, freeary() wakes all sleepers */
+		if (ipc_valid_object(&sma->sem_perm))
+			do_smart_update(sma, sop, 1, 1, &wake_q);
+		sem_unlock(sma, locknum);
+		wake_up_q(&wake_q);
+
+		return 0;
+	}
+
+	atomic_dec(&curr->fast_refs);
+	preempt_enable();
+	return 0;
+
+fail:
+	atomic_dec(&curr->fast_refs);
+	preempt_enable();
+	return 1;
+}
+
 /*
  * check_qop: Test if a queued operation sleeps on the semaphore semnum
  */
@@ -1968,6 +2131,17 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 		goto out_free;
 	}
 
+	/*
+	 * An uncontended simple alter operation without SEM_UNDO can
+	 * usually be performed without taking any lock at all.
+	 */
+	if (nsops == 1 && !undos && sops->sem_op != 0 &&
+	    !perform_fast_semop(sma, sops)) {
+		rcu_read_unlock();
+		error = 0;
+		goto out_free;
+	}
+
 	error = -EIDRM;
 	locknum = sem_lock(sma, sops, nsops);
 	/*
@@ -1998,26 +2172,8 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 	queue.dupsop = dupsop;
 
 	error = perform_atomic_semop(sma, &queue);
-	if (error == 0) { /* non-blocking succesfull path */
-		DEFINE_WAKE_Q(wake_q);
-
-		/*
-		 * If the operation was successful, then do
-		 * the required updates.
-		 */
-		if (alter)
-			do_smart_update(sma, sops, nsops, 1, &wake_q);
-		else
-			set_semotime(sma, sops);
-
-		sem_unlock(sma, locknum);
-		rcu_read_unlock();
-		wake_up_q(&wake_q);
-
-		goto out_free;
-	}
-	if (error < 0) /* non-blocking error path */
-		goto out_unlock_free;
+	if (error <= 0)
+		goto done;
 
 	/*
 	 * We need to sleep on this operation, so we put the current
@@ -2051,6 +2207,23 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 		sma->complex_count++;
 	}
 
+	if (locknum != SEM_GLOBAL_LOCK) {
+		/*
+		 * A lockless update may hit the window between the failed
+		 * attempt above and our queue insertion becoming visible;
+		 * such an update only re-checks the pending lists after
+		 * altering the semaphore. Make the insertion visible and
+		 * give the operation one more try; pairs with the
+		 * cmpxchg() in perform_fast_semop().
+		 */
+		smp_mb();
+		error = perform_atomic_semop(sma, &queue);
+		if (error <= 0) {
+			unlink_queue(sma, &queue);
+			goto done;
+		}
+	}
+
 	do {
 		queue.status = -EINTR;
 		queue.sleeper = current;
@@ -2111,6 +2284,26 @@ static long do_semtimedop(int semid, struct sembuf __user *tsops,
 
 	unlink_queue(sma, &queue);
 
+done:
+	if (error == 0) { /* non-blocking succesfull path */
+		DEFINE_WAKE_Q(wake_q);
+
+		/*
+		 * If the operation was successful, then do
+		 * the required updates.
+		 */
+		if (alter)
+			do_smart_update(sma, sops, nsops, 1, &wake_q);
+		else
+			set_semotime(sma, sops);
+
+		sem_unlock(sma, locknum);
+		rcu_read_unlock();
+		wake_up_q(&wake_q);
+
+		goto out_free;
+	}
+	/* non-blocking error path */
 out_unlock_free:
 	sem_unlock(sma, locknum);
 	rcu_read_unlock();
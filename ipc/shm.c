@@ -43,6 +43,7 @@
 #include <linux/nsproxy.h>
 #include <linux/mount.h>
 #include <linux/ipc_namespace.h>
+#include <linux/mempolicy.h>
 
 #include <linux/uaccess.h>
 
@@ -182,6 +183,9 @@ static void shm_rcu_free(struct rcu_head *head)
 	struct shmid_kernel *shp = container_of(ptr, struct shmid_kernel,
 							shm_perm);
 	security_shm_free(shp);
+#ifdef CONFIG_NUMA
+	mpol_put(shp->shm_policy);
+#endif
 	kvfree(shp);
 }
 
@@ -412,6 +416,35 @@ static struct mempolicy *shm_get_policy(struct vm_area_struct *vma,
 
 	return pol;
 }
+
+/*
+ * Push the segment-wide policy set by shmget(SHM_INTERLEAVE) or
+ * shmctl(SHM_SET_POLICY) into the backing file's shared policy tree.
+ * Called for every attach; mappings created before the policy was set
+ * keep their existing placement.
+ */
+static void shm_apply_segment_policy(struct shm_file_data *sfd,
+				     struct vm_area_struct *vma)
+{
+	struct shmid_kernel *shp;
+	struct mempolicy *pol;
+
+	shp = shm_lock(sfd->ns, sfd->id);
+	if (IS_ERR(shp))
+		return;
+	pol = shp->shm_policy;
+	mpol_get(pol);
+	shm_unlock(shp);
+
+	if (pol && sfd->vm_ops->set_policy)
+		sfd->vm_ops->set_policy(vma, pol);
+	mpol_put(pol);
+}
+#else
+static inline void shm_apply_segment_policy(struct shm_file_data *sfd,
+					    struct vm_area_struct *vma)
+{
+}
 #endif
 
 static int shm_mmap(struct file *file, struct vm_area_struct *vma)
@@ -437,6 +470,7 @@ static int shm_mmap(struct file *file, struct vm_area_struct *vma)
 	WARN_ON(!sfd->vm_ops->fault);
 #endif
 	vma->vm_ops = &shm_vm_ops;
+	shm_apply_segment_policy(sfd, vma);
 	return 0;
 }
 
@@ -552,6 +586,9 @@ static int newseg(struct ipc_namespace *ns, struct ipc_params *params)
 	shp->shm_perm.key = key;
 	shp->shm_perm.mode = (shmflg & S_IRWXUGO);
 	shp->mlock_user = NULL;
+#ifdef CONFIG_NUMA
+	shp->shm_policy = NULL;
+#endif
 
 	shp->shm_perm.security = NULL;
 	error = security_shm_alloc(shp);
@@ -560,6 +597,18 @@ static int newseg(struct ipc_namespace *ns, struct ipc_params *params)
 		return error;
 	}
 
+#if defined(CONFIG_NUMA) && defined(CONFIG_TMPFS)
+	if (shmflg & SHM_INTERLEAVE) {
+		/* interleave over all memory nodes */
+		char policy[] = "interleave";
+
+		if (mpol_parse_str(policy, &shp->shm_policy)) {
+			error = -EINVAL;
+			goto no_file;
+		}
+	}
+#endif
+
 	sprintf(name, "SYSV%08x", key);
 	if (shmflg & SHM_HUGETLB) {
 		struct hstate *hs;
@@ -1040,6 +1089,112 @@ out_unlock1:
 	return err;
 }
 
+#if defined(CONFIG_NUMA) && defined(CONFIG_TMPFS)
+/*
+ * Longest policy string accepted and produced by SHM_SET_POLICY and
+ * SHM_GET_POLICY; matches what /proc/<pid>/numa_maps works with.
+ */
+#define SHM_POLICY_MAX	64
+
+/*
+ * Replace the segment-wide placement policy. The policy is given in
+ * the tmpfs mount-option grammar understood by mpol_parse_str(), e.g.
+ * "interleave:0-3", "prefer:1", "bind:0,2" or "default", and takes
+ * effect for subsequent attaches.
+ */
+static int shmctl_set_policy(struct ipc_namespace *ns, int shmid,
+			     const char __user *buf)
+{
+	char str[SHM_POLICY_MAX];
+	struct mempolicy *new = NULL, *old = NULL;
+	struct kern_ipc_perm *ipcp;
+	struct shmid_kernel *shp;
+	int err;
+
+	if (strncpy_from_user(str, buf, sizeof(str)) < 0)
+		return -EFAULT;
+	str[sizeof(str) - 1] = '\0';
+
+	if (mpol_parse_str(str, &new))
+		return -EINVAL;
+
+	down_write(&shm_ids(ns).rwsem);
+	rcu_read_lock();
+
+	ipcp = ipcctl_pre_down_nolock(ns, &shm_ids(ns), shmid,
+				      SHM_SET_POLICY, NULL, 0);
+	if (IS_ERR(ipcp)) {
+		err = PTR_ERR(ipcp);
+		goto out_unlock;
+	}
+	shp = container_of(ipcp, struct shmid_kernel, shm_perm);
+
+	err = security_shm_shmctl(shp, SHM_SET_POLICY);
+	if (err)
+		goto out_unlock;
+
+	ipc_lock_object(&shp->shm_perm);
+	old = shp->shm_policy;
+	shp->shm_policy = new;
+	new = NULL;
+	shp->shm_ctim = ktime_get_real_seconds();
+	ipc_unlock_object(&shp->shm_perm);
+	err = 0;
+out_unlock:
+	rcu_read_unlock();
+	up_write(&shm_ids(ns).rwsem);
+	mpol_put(new);
+	mpol_put(old);
+	return err;
+}
+
+static int shmctl_get_policy(struct ipc_namespace *ns, int shmid,
+			     char __user *buf)
+{
+	char str[SHM_POLICY_MAX];
+	struct mempolicy *pol;
+	struct shmid_kernel *shp;
+	int err;
+
+	rcu_read_lock();
+	shp = shm_obtain_object_check(ns, shmid);
+	if (IS_ERR(shp)) {
+		err = PTR_ERR(shp);
+		goto out_unlock;
+	}
+
+	err = -EACCES;
+	if (ipcperms(ns, &shp->shm_perm, S_IRUGO))
+		goto out_unlock;
+
+	err = security_shm_shmctl(shp, SHM_GET_POLICY);
+	if (err)
+		goto out_unlock;
+
+	ipc_lock_object(&shp->shm_perm);
+	if (!ipc_valid_object(&shp->shm_perm)) {
+		ipc_unlock_object(&shp->shm_perm);
+		err = -EIDRM;
+		goto out_unlock;
+	}
+	pol = shp->shm_policy;
+	mpol_get(pol);
+	ipc_unlock_object(&shp->shm_perm);
+	rcu_read_unlock();
+
+	mpol_to_str(str, sizeof(str), pol);
+	mpol_put(pol);
+
+	if (copy_to_user(buf, str, strlen(str) + 1))
+		return -EFAULT;
+	return 0;
+
+out_unlock:
+	rcu_read_unlock();
+	return err;
+}
+#endif /* CONFIG_NUMA && CONFIG_TMPFS */
+
 SYSCALL_DEFINE3(shmctl, int, shmid, int, cmd, struct shmid_ds __user *, buf)
 {
 	int err, version;
@@ -1089,6 +1244,12 @@ SYSCALL_DEFINE3(shmctl, int, shmid, int, cmd, struct shmid_ds __user *, buf)
 	case SHM_LOCK:
 	case SHM_UNLOCK:
 		return shmctl_do_lock(ns, shmid, cmd);
+#if defined(CONFIG_NUMA) && defined(CONFIG_TMPFS)
+	case SHM_SET_POLICY:
+		return shmctl_set_policy(ns, shmid, (const char __user *)buf);
+	case SHM_GET_POLICY:
+		return shmctl_get_policy(ns, shmid, (char __user *)buf);
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -1262,7 +1423,12 @@ COMPAT_SYSCALL_DEFINE3(shmctl, int, shmid, int, cmd, void __user *, uptr)
 	case SHM_LOCK:
 	case SHM_UNLOCK:
 		return shmctl_do_lock(ns, shmid, cmd);
-		break;
+#if defined(CONFIG_NUMA) && defined(CONFIG_TMPFS)
+	case SHM_SET_POLICY:
+		return shmctl_set_policy(ns, shmid, uptr);
+	case SHM_GET_POLICY:
+		return shmctl_get_policy(ns, shmid, uptr);
+#endif
 	default:
 		return -EINVAL;
 	}
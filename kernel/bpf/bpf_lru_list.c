@@ -5,8 +5,10 @@
  * License as published by the Free Software Foundation.
  */
 #include <linux/cpumask.h>
+#include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/percpu.h>
+#include <linux/topology.h>
 
 #include "bpf_lru_list.h"
 
@@ -30,6 +32,24 @@ static int get_next_cpu(int cpu)
 	return cpu;
 }
 
+/* A CPU refills from (and a node frees back to) the shard of its NUMA
+ * node.  Nodes sitting on a shard's active/inactive/free lists keep
+ * node->cpu pointing at a CPU of that shard, so the shard can always
+ * be re-derived from the node itself.
+ */
+static unsigned int common_lru_shard_idx(int cpu)
+{
+	int node = cpu_to_node(cpu);
+
+	return node < 0 ? 0 : node;
+}
+
+static struct bpf_lru_list *common_lru_shard(struct bpf_common_lru *clru,
+					     int cpu)
+{
+	return &clru->lru_lists[common_lru_shard_idx(cpu)];
+}
+
 /* Local list helpers */
 static struct list_head *local_free_list(struct bpf_lru_locallist *loc_l)
 {
@@ -318,19 +338,13 @@ static void bpf_lru_list_push_free(struct bpf_lru_list *l,
 	raw_spin_unlock_irqrestore(&l->lock, flags);
 }
 
-static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
-					   struct bpf_lru_locallist *loc_l)
+static unsigned int __bpf_lru_shard_pop_free(struct bpf_lru *lru,
+					     struct bpf_lru_list *l,
+					     struct bpf_lru_locallist *loc_l)
 {
-	struct bpf_lru_list *l = &lru->common_lru.lru_list;
 	struct bpf_lru_node *node, *tmp_node;
 	unsigned int nfree = 0;
 
-	raw_spin_lock(&l->lock);
-
-	__local_list_flush(l, loc_l);
-
-	__bpf_lru_list_rotate(lru, l);
-
 	list_for_each_entry_safe(node, tmp_node, &l->lists[BPF_LRU_LIST_T_FREE],
 				 list) {
 		__bpf_lru_node_move_to_free(l, node, local_free_list(loc_l),
@@ -340,11 +354,54 @@ static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
 	}
 
 	if (nfree < LOCAL_FREE_TARGET)
-		__bpf_lru_list_shrink(lru, l, LOCAL_FREE_TARGET - nfree,
-				      local_free_list(loc_l),
-				      BPF_LRU_LOCAL_LIST_T_FREE);
+		nfree += __bpf_lru_list_shrink(lru, l,
+					       LOCAL_FREE_TARGET - nfree,
+					       local_free_list(loc_l),
+					       BPF_LRU_LOCAL_LIST_T_FREE);
+
+	return nfree;
+}
+
+static void bpf_lru_list_pop_free_to_local(struct bpf_lru *lru,
+					   struct bpf_lru_locallist *loc_l,
+					   int cpu)
+{
+	struct bpf_common_lru *clru = &lru->common_lru;
+	unsigned int home = common_lru_shard_idx(cpu);
+	struct bpf_lru_list *l = &clru->lru_lists[home];
+	unsigned int shard = home;
+	unsigned int nfree;
+
+	raw_spin_lock(&l->lock);
+
+	__local_list_flush(l, loc_l);
+
+	__bpf_lru_list_rotate(lru, l);
+
+	nfree = __bpf_lru_shard_pop_free(lru, l, loc_l);
 
 	raw_spin_unlock(&l->lock);
+
+	/* The home shard ran dry: steal from the other shards in RR.
+	 * Stolen nodes go through the local pending list and pick up
+	 * this CPU, so they free back to the home shard and a stable
+	 * imbalance corrects itself instead of thrashing remote locks.
+	 */
+	while (!nfree) {
+		shard = shard + 1 == clru->nr_shards ? 0 : shard + 1;
+		if (shard == home)
+			break;
+
+		l = &clru->lru_lists[shard];
+
+		raw_spin_lock(&l->lock);
+
+		__bpf_lru_list_rotate(lru, l);
+
+		nfree = __bpf_lru_shard_pop_free(lru, l, loc_l);
+
+		raw_spin_unlock(&l->lock);
+	}
 }
 
 static void __local_list_add_pending(struct bpf_lru *lru,
@@ -447,7 +504,7 @@ static struct bpf_lru_node *bpf_common_lru_pop_free(struct bpf_lru *lru,
 
 	node = __local_list_pop_free(loc_l);
 	if (!node) {
-		bpf_lru_list_pop_free_to_local(lru, loc_l);
+		bpf_lru_list_pop_free_to_local(lru, loc_l, cpu);
 		node = __local_list_pop_free(loc_l);
 	}
 
@@ -532,7 +589,9 @@ static void bpf_common_lru_push_free(struct bpf_lru *lru,
 	}
 
 check_lru_list:
-	bpf_lru_list_push_free(&lru->common_lru.lru_list, node);
+	/* The node sits on the shard of its owning CPU's NUMA node */
+	bpf_lru_list_push_free(common_lru_shard(&lru->common_lru, node->cpu),
+			       node);
 }
 
 static void bpf_percpu_lru_push_free(struct bpf_lru *lru,
@@ -562,17 +621,24 @@ static void bpf_common_lru_populate(struct bpf_lru *lru, void *buf,
 				    u32 node_offset, u32 elem_size,
 				    u32 nr_elems)
 {
-	struct bpf_lru_list *l = &lru->common_lru.lru_list;
+	struct bpf_common_lru *clru = &lru->common_lru;
+	int cpu = cpumask_first(cpu_possible_mask);
 	u32 i;
 
+	/* Round-robin over the possible CPUs, so each shard starts
+	 * with a share of the free nodes proportional to its CPUs.
+	 */
 	for (i = 0; i < nr_elems; i++) {
+		struct bpf_lru_list *l = common_lru_shard(clru, cpu);
 		struct bpf_lru_node *node;
 
 		node = (struct bpf_lru_node *)(buf + node_offset);
+		node->cpu = cpu;
 		node->type = BPF_LRU_LIST_T_FREE;
 		node->ref = 0;
 		list_add(&node->list, &l->lists[BPF_LRU_LIST_T_FREE]);
 		buf += elem_size;
+		cpu = get_next_cpu(cpu);
 	}
 }
 
@@ -664,10 +730,23 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 		lru->nr_scans = PERCPU_NR_SCANS;
 	} else {
 		struct bpf_common_lru *clru = &lru->common_lru;
+		unsigned int i;
+
+		clru->nr_shards = nr_node_ids;
+		clru->lru_lists = kmalloc_array(clru->nr_shards,
+						sizeof(*clru->lru_lists),
+						GFP_KERNEL);
+		if (!clru->lru_lists)
+			return -ENOMEM;
+
+		for (i = 0; i < clru->nr_shards; i++)
+			bpf_lru_list_init(&clru->lru_lists[i]);
 
 		clru->local_list = alloc_percpu(struct bpf_lru_locallist);
-		if (!clru->local_list)
+		if (!clru->local_list) {
+			kfree(clru->lru_lists);
 			return -ENOMEM;
+		}
 
 		for_each_possible_cpu(cpu) {
 			struct bpf_lru_locallist *loc_l;
@@ -676,7 +755,6 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 			bpf_lru_locallist_init(loc_l, cpu);
 		}
 
-		bpf_lru_list_init(&clru->lru_list);
 		lru->nr_scans = LOCAL_NR_SCANS;
 	}
 
@@ -690,8 +768,10 @@ int bpf_lru_init(struct bpf_lru *lru, bool percpu, u32 hash_offset,
 
 void bpf_lru_destroy(struct bpf_lru *lru)
 {
-	if (lru->percpu)
+	if (lru->percpu) {
 		free_percpu(lru->percpu_lru);
-	else
+	} else {
 		free_percpu(lru->common_lru.local_list);
+		kfree(lru->common_lru.lru_lists);
+	}
 }
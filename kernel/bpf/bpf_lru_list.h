@@ -46,7 +46,11 @@ struct bpf_lru_locallist {
 };
 
 struct bpf_common_lru {
-	struct bpf_lru_list lru_list;
+	/* The global list is sharded per NUMA node to keep the
+	 * refill slow path off one box-wide lock.
+	 */
+	struct bpf_lru_list *lru_lists;
+	unsigned int nr_shards;
 	struct bpf_lru_locallist __percpu *local_list;
 };
 
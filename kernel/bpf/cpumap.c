@@ -28,6 +28,7 @@
 
 #include <linux/netdevice.h>   /* netif_receive_skb_core */
 #include <linux/etherdevice.h> /* eth_type_trans */
+#include <net/xdp.h>
 
 /* General idea: XDP packets getting XDP redirected to another CPU,
  * will maximum be stored/queued for one driver ->poll() call.  It is
@@ -36,10 +37,22 @@
  * which queue in bpf_cpu_map_entry contains packets.
  */
 
+/* The per-producer bulk queue amortizes the ptr_ring producer lock:
+ * the enqueue path fills q[] locklessly and only bq_flush_to_queue()
+ * takes the lock.  With several RX queues feeding the same remote CPU
+ * the lock gets hotter, so the batch size adapts: it starts at
+ * CPU_MAP_BULK_SIZE, doubles each time a NAPI poll fills the batch
+ * before the end-of-poll flush, and decays again when polls stop
+ * filling it.  A full ring resets the limit, as larger batches only
+ * delay the point where the consumer sees new work.
+ */
 #define CPU_MAP_BULK_SIZE 8  /* 8 == one cacheline on 64-bit archs */
+#define CPU_MAP_BULK_MAX  64
 struct xdp_bulk_queue {
-	void *q[CPU_MAP_BULK_SIZE];
+	void *q[CPU_MAP_BULK_MAX];
 	unsigned int count;
+	unsigned int limit;    /* current batch size, adapted at flush time */
+	unsigned int in_ring;  /* frames flushed since last kthread wakeup */
 };
 
 /* Struct for every remote "destination" CPU in map */
@@ -145,7 +158,7 @@ static void __cpu_map_queue_destructor(void *ptr)
 	 * gracefully and warn once.
 	 */
 	if (WARN_ON_ONCE(ptr))
-		page_frag_free(ptr);
+		xdp_return_frame(ptr);
 }
 
 static void put_cpu_map_entry(struct bpf_cpu_map_entry *rcpu)
@@ -179,22 +192,12 @@ static void cpu_map_kthread_stop(struct work_struct *work)
 	kthread_stop(rcpu->kthread);
 }
 
-/* For now, xdp_pkt is a cpumap internal data structure, with info
- * carried between enqueue to dequeue. It is mapped into the top
- * headroom of the packet, to avoid allocating separate mem.
+/* Convert xdp_buff to xdp_frame, stored in the top headroom of the
+ * packet to avoid allocating separate mem.
  */
-struct xdp_pkt {
-	void *data;
-	u16 len;
-	u16 headroom;
-	u16 metasize;
-	struct net_device *dev_rx;
-};
-
-/* Convert xdp_buff to xdp_pkt */
-static struct xdp_pkt *convert_to_xdp_pkt(struct xdp_buff *xdp)
+static struct xdp_frame *convert_to_xdp_frame(struct xdp_buff *xdp)
 {
-	struct xdp_pkt *xdp_pkt;
+	struct xdp_frame *xdpf;
 	int metasize;
 	int headroom;
 
@@ -202,22 +205,22 @@ static struct xdp_pkt *convert_to_xdp_pkt(struct xdp_buff *xdp)
 	headroom = xdp->data - xdp->data_hard_start;
 	metasize = xdp->data - xdp->data_meta;
 	metasize = metasize > 0 ? metasize : 0;
-	if (unlikely((headroom - metasize) < sizeof(*xdp_pkt)))
+	if (unlikely((headroom - metasize) < sizeof(*xdpf)))
 		return NULL;
 
 	/* Store info in top of packet */
-	xdp_pkt = xdp->data_hard_start;
+	xdpf = xdp->data_hard_start;
 
-	xdp_pkt->data = xdp->data;
-	xdp_pkt->len  = xdp->data_end - xdp->data;
-	xdp_pkt->headroom = headroom - sizeof(*xdp_pkt);
-	xdp_pkt->metasize = metasize;
+	xdpf->data = xdp->data;
+	xdpf->len  = xdp->data_end - xdp->data;
+	xdpf->headroom = headroom - sizeof(*xdpf);
+	xdpf->metasize = metasize;
 
-	return xdp_pkt;
+	return xdpf;
 }
 
 static struct sk_buff *cpu_map_build_skb(struct bpf_cpu_map_entry *rcpu,
-					 struct xdp_pkt *xdp_pkt)
+					 struct xdp_frame *xdpf)
 {
 	unsigned int frame_size;
 	void *pkt_data_start;
@@ -232,7 +235,7 @@ static struct sk_buff *cpu_map_build_skb(struct bpf_cpu_map_entry *rcpu,
 	 * would be preferred to set frame_size to 2048 or 4096
 	 * depending on the driver.
 	 *   frame_size = 2048;
-	 *   frame_len  = frame_size - sizeof(*xdp_pkt);
+	 *   frame_len  = frame_size - sizeof(*xdpf);
 	 *
 	 * Instead, with info avail, skb_shared_info in placed after
 	 * packet len.  This, unfortunately fakes the truesize.
@@ -240,21 +243,21 @@ static struct sk_buff *cpu_map_build_skb(struct bpf_cpu_map_entry *rcpu,
 	 * is not at a fixed memory location, with mixed length
 	 * packets, which is bad for cache-line hotness.
 	 */
-	frame_size = SKB_DATA_ALIGN(xdp_pkt->len) + xdp_pkt->headroom +
+	frame_size = SKB_DATA_ALIGN(xdpf->len) + xdpf->headroom +
 		SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 
-	pkt_data_start = xdp_pkt->data - xdp_pkt->headroom;
+	pkt_data_start = xdpf->data - xdpf->headroom;
 	skb = build_skb(pkt_data_start, frame_size);
 	if (!skb)
 		return NULL;
 
-	skb_reserve(skb, xdp_pkt->headroom);
-	__skb_put(skb, xdp_pkt->len);
-	if (xdp_pkt->metasize)
-		skb_metadata_set(skb, xdp_pkt->metasize);
+	skb_reserve(skb, xdpf->headroom);
+	__skb_put(skb, xdpf->len);
+	if (xdpf->metasize)
+		skb_metadata_set(skb, xdpf->metasize);
 
 	/* Essential SKB info: protocol and skb->dev */
-	skb->protocol = eth_type_trans(skb, xdp_pkt->dev_rx);
+	skb->protocol = eth_type_trans(skb, xdpf->dev_rx);
 
 	/* Optional SKB info, currently missing:
 	 * - HW checksum info		(skb->ip_summed)
@@ -278,7 +281,7 @@ static int cpu_map_kthread_run(void *data)
 	 */
 	while (!kthread_should_stop() || !__ptr_ring_empty(rcpu->queue)) {
 		unsigned int processed = 0, drops = 0, sched = 0;
-		struct xdp_pkt *xdp_pkt;
+		struct xdp_frame *xdpf;
 
 		/* Release CPU reschedule checks */
 		if (__ptr_ring_empty(rcpu->queue)) {
@@ -301,13 +304,13 @@ static int cpu_map_kthread_run(void *data)
 		 * kthread CPU pinned. Lockless access to ptr_ring
 		 * consume side valid as no-resize allowed of queue.
 		 */
-		while ((xdp_pkt = __ptr_ring_consume(rcpu->queue))) {
+		while ((xdpf = __ptr_ring_consume(rcpu->queue))) {
 			struct sk_buff *skb;
 			int ret;
 
-			skb = cpu_map_build_skb(rcpu, xdp_pkt);
+			skb = cpu_map_build_skb(rcpu, xdpf);
 			if (!skb) {
-				page_frag_free(xdp_pkt);
+				xdp_return_frame(xdpf);
 				continue;
 			}
 
@@ -336,7 +339,7 @@ static struct bpf_cpu_map_entry *__cpu_map_entry_alloc(u32 qsize, u32 cpu,
 {
 	gfp_t gfp = GFP_KERNEL | __GFP_NOWARN;
 	struct bpf_cpu_map_entry *rcpu;
-	int numa, err;
+	int numa, err, i;
 
 	/* Have map->numa_node, but choose node of redirect target CPU */
 	numa = cpu_to_node(cpu);
@@ -351,6 +354,12 @@ static struct bpf_cpu_map_entry *__cpu_map_entry_alloc(u32 qsize, u32 cpu,
 	if (!rcpu->bulkq)
 		goto free_rcu;
 
+	for_each_possible_cpu(i) {
+		struct xdp_bulk_queue *bq = per_cpu_ptr(rcpu->bulkq, i);
+
+		bq->limit = CPU_MAP_BULK_SIZE;
+	}
+
 	/* Alloc queue */
 	rcpu->queue = kzalloc_node(sizeof(*rcpu->queue), gfp, numa);
 	if (!rcpu->queue)
@@ -589,9 +598,13 @@ const struct bpf_map_ops cpu_map_ops = {
 	.map_get_next_key	= cpu_map_get_next_key,
 };
 
+/* Returns the number of frames actually moved into the ptr_ring, so
+ * the enqueue path can tell a clean batch from one the ring cut short.
+ */
 static int bq_flush_to_queue(struct bpf_cpu_map_entry *rcpu,
 			     struct xdp_bulk_queue *bq)
 {
+	struct xdp_frame *dropped[CPU_MAP_BULK_MAX];
 	unsigned int processed = 0, drops = 0;
 	const int to_cpu = rcpu->cpu;
 	struct ptr_ring *q;
@@ -604,60 +617,80 @@ static int bq_flush_to_queue(struct bpf_cpu_map_entry *rcpu,
 	spin_lock(&q->producer_lock);
 
 	for (i = 0; i < bq->count; i++) {
-		void *xdp_pkt = bq->q[i];
+		void *xdpf = bq->q[i];
 		int err;
 
-		err = __ptr_ring_produce(q, xdp_pkt);
-		if (err) {
-			drops++;
-			page_frag_free(xdp_pkt); /* Free xdp_pkt */
-		}
+		err = __ptr_ring_produce(q, xdpf);
+		if (err)
+			dropped[drops++] = xdpf;
 		processed++;
 	}
 	bq->count = 0;
 	spin_unlock(&q->producer_lock);
 
+	/* Return dropped frames in one go, outside the producer lock */
+	if (unlikely(drops))
+		xdp_return_frame_bulk(dropped, drops);
+
+	/* Ring full: the consumer is behind, so larger batches only add
+	 * queueing delay before it can see new work.  Start over small.
+	 */
+	if (unlikely(drops))
+		bq->limit = CPU_MAP_BULK_SIZE;
+
+	bq->in_ring += processed - drops;
+
 	/* Feedback loop via tracepoints */
 	trace_xdp_cpumap_enqueue(rcpu->map_id, processed, drops, to_cpu);
-	return 0;
+	return processed - drops;
 }
 
 /* Runs under RCU-read-side, plus in softirq under NAPI protection.
  * Thus, safe percpu variable access.
  */
-static int bq_enqueue(struct bpf_cpu_map_entry *rcpu, struct xdp_pkt *xdp_pkt)
+static int bq_enqueue(struct bpf_cpu_map_entry *rcpu, struct xdp_frame *xdpf)
 {
 	struct xdp_bulk_queue *bq = this_cpu_ptr(rcpu->bulkq);
 
-	if (unlikely(bq->count == CPU_MAP_BULK_SIZE))
-		bq_flush_to_queue(rcpu, bq);
+	if (unlikely(bq->count == bq->limit)) {
+		unsigned int limit = bq->limit;
+
+		/* Filling the batch within one napi->poll means this
+		 * producer is in a burst; take the lock less often.
+		 * Skip growing when the ring pushed back (flush came up
+		 * short and reset the limit).
+		 */
+		if (bq_flush_to_queue(rcpu, bq) == limit &&
+		    limit < CPU_MAP_BULK_MAX)
+			bq->limit = limit << 1;
+	}
 
 	/* Notice, xdp_buff/page MUST be queued here, long enough for
 	 * driver to code invoking us to finished, due to driver
 	 * (e.g. ixgbe) recycle tricks based on page-refcnt.
 	 *
-	 * Thus, incoming xdp_pkt is always queued here (else we race
+	 * Thus, incoming xdp_frame is always queued here (else we race
 	 * with another CPU on page-refcnt and remaining driver code).
 	 * Queue time is very short, as driver will invoke flush
 	 * operation, when completing napi->poll call.
 	 */
-	bq->q[bq->count++] = xdp_pkt;
+	bq->q[bq->count++] = xdpf;
 	return 0;
 }
 
 int cpu_map_enqueue(struct bpf_cpu_map_entry *rcpu, struct xdp_buff *xdp,
 		    struct net_device *dev_rx)
 {
-	struct xdp_pkt *xdp_pkt;
+	struct xdp_frame *xdpf;
 
-	xdp_pkt = convert_to_xdp_pkt(xdp);
-	if (unlikely(!xdp_pkt))
+	xdpf = convert_to_xdp_frame(xdp);
+	if (unlikely(!xdpf))
 		return -EOVERFLOW;
 
 	/* Info needed when constructing SKB on remote CPU */
-	xdp_pkt->dev_rx = dev_rx;
+	xdpf->dev_rx = dev_rx;
 
-	bq_enqueue(rcpu, xdp_pkt);
+	bq_enqueue(rcpu, xdpf);
 	return 0;
 }
 
@@ -691,11 +724,26 @@ void __cpu_map_flush(struct bpf_map *map)
 
 		__clear_bit(bit, bitmap);
 
-		/* Flush all frames in bulkq to real queue */
 		bq = this_cpu_ptr(rcpu->bulkq);
+
+		/* The burst is over when a poll ends with the batch less
+		 * than half full; decay towards the latency-friendly
+		 * minimum again.
+		 */
+		if (bq->limit > CPU_MAP_BULK_SIZE &&
+		    bq->count < (bq->limit >> 1))
+			bq->limit >>= 1;
+
+		/* Flush all frames in bulkq to real queue */
 		bq_flush_to_queue(rcpu, bq);
 
-		/* If already running, costs spin_lock_irqsave + smb_mb */
-		wake_up_process(rcpu->kthread);
+		/* Only wake when this poll actually put frames in the
+		 * ring, counting earlier limit-triggered flushes too.
+		 * If already running, costs spin_lock_irqsave + smb_mb.
+		 */
+		if (bq->in_ring) {
+			bq->in_ring = 0;
+			wake_up_process(rcpu->kthread);
+		}
 	}
 }
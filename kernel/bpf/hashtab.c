@@ -13,6 +13,7 @@
 #include <linux/bpf.h>
 #include <linux/jhash.h>
 #include <linux/filter.h>
+#include <linux/irq_work.h>
 #include <linux/rculist_nulls.h>
 #include "percpu_freelist.h"
 #include "bpf_lru_list.h"
@@ -27,9 +28,20 @@ struct bucket {
 	raw_spinlock_t lock;
 };
 
+/* The bucket array plus the table it is superseding.  While a grow is
+ * migrating elements the old table stays reachable through tbl->old, so
+ * lookups get at both tables via a single dependency-ordered load of
+ * htab->tbl and need no extra barriers.
+ */
+struct htab_table {
+	u32 n_buckets;	/* number of hash buckets, power of 2 */
+	struct htab_table __rcu *old;	/* table being migrated from */
+	struct bucket buckets[0];
+};
+
 struct bpf_htab {
 	struct bpf_map map;
-	struct bucket *buckets;
+	struct htab_table __rcu *tbl;
 	void *elems;
 	union {
 		struct pcpu_freelist freelist;
@@ -37,8 +49,10 @@ struct bpf_htab {
 	};
 	struct htab_elem *__percpu *extra_elems;
 	atomic_t count;	/* number of elements in this hashtable */
-	u32 n_buckets;	/* number of hash buckets */
+	u32 max_buckets;	/* bucket table size limit */
 	u32 elem_size;	/* size of each element in bytes */
+	struct irq_work grow_irq_work;	/* kicks grow_work from any context */
+	struct work_struct grow_work;	/* grows and migrates the table */
 };
 
 /* each htab element is struct htab_elem + key + value */
@@ -62,6 +76,8 @@ struct htab_elem {
 };
 
 static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node);
+static void htab_grow_kick(struct irq_work *work);
+static void htab_grow_work(struct work_struct *work);
 
 static bool htab_is_lru(const struct bpf_htab *htab)
 {
@@ -80,6 +96,20 @@ static bool htab_is_prealloc(const struct bpf_htab *htab)
 	return !(htab->map.map_flags & BPF_F_NO_PREALLOC);
 }
 
+/* Growing the bucket table in place needs dual-table lookups and a
+ * worker migrating entries, so keep it to the plain and per-cpu hash
+ * variants that allocate elements on demand.  Preallocated maps pin
+ * their worst-case footprint anyway, the LRU flavours imply prealloc,
+ * and fd maps walk the buckets on free without waiting for a migration
+ * to settle.
+ */
+static bool htab_is_resizable(const struct bpf_htab *htab)
+{
+	return (htab->map.map_type == BPF_MAP_TYPE_HASH ||
+		htab->map.map_type == BPF_MAP_TYPE_PERCPU_HASH) &&
+	       !htab_is_prealloc(htab);
+}
+
 static inline void htab_elem_set_ptr(struct htab_elem *l, u32 key_size,
 				     void __percpu *pptr)
 {
@@ -291,6 +321,32 @@ static int htab_map_alloc_check(union bpf_attr *attr)
 	return 0;
 }
 
+/* Initial bucket count for resizable tables; doubled on demand up to
+ * max_buckets.
+ */
+#define HTAB_INIT_BUCKETS 512
+
+static struct htab_table *htab_alloc_table(struct bpf_htab *htab,
+					   u32 n_buckets)
+{
+	struct htab_table *t;
+	u32 i;
+
+	t = bpf_map_area_alloc(offsetof(struct htab_table,
+					buckets[n_buckets]),
+			       htab->map.numa_node);
+	if (!t)
+		return NULL;
+
+	t->n_buckets = n_buckets;
+	RCU_INIT_POINTER(t->old, NULL);
+	for (i = 0; i < n_buckets; i++) {
+		INIT_HLIST_NULLS_HEAD(&t->buckets[i].head, i);
+		raw_spin_lock_init(&t->buckets[i].lock);
+	}
+	return t;
+}
+
 static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 {
 	bool percpu = (attr->map_type == BPF_MAP_TYPE_PERCPU_HASH ||
@@ -305,7 +361,9 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	bool percpu_lru = (attr->map_flags & BPF_F_NO_COMMON_LRU);
 	bool prealloc = !(attr->map_flags & BPF_F_NO_PREALLOC);
 	struct bpf_htab *htab;
-	int err, i;
+	struct htab_table *t;
+	u32 n_buckets;
+	int err;
 	u64 cost;
 
 	htab = kzalloc(sizeof(*htab), GFP_USER);
@@ -327,7 +385,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 	}
 
 	/* hash table size must be power of 2 */
-	htab->n_buckets = roundup_pow_of_two(htab->map.max_entries);
+	htab->max_buckets = roundup_pow_of_two(htab->map.max_entries);
 
 	htab->elem_size = sizeof(struct htab_elem) +
 			  round_up(htab->map.key_size, 8);
@@ -338,11 +396,15 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 
 	err = -E2BIG;
 	/* prevent zero size kmalloc and check for u32 overflow */
-	if (htab->n_buckets == 0 ||
-	    htab->n_buckets > U32_MAX / sizeof(struct bucket))
+	if (htab->max_buckets == 0 ||
+	    htab->max_buckets > (U32_MAX - sizeof(struct htab_table)) /
+				sizeof(struct bucket))
 		goto free_htab;
 
-	cost = (u64) htab->n_buckets * sizeof(struct bucket) +
+	/* charge the worst case up front even when the table starts
+	 * small, so a later grow cannot run into the memlock limit
+	 */
+	cost = (u64) htab->max_buckets * sizeof(struct bucket) +
 	       (u64) htab->elem_size * htab->map.max_entries;
 
 	if (percpu)
@@ -363,16 +425,17 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 		goto free_htab;
 
 	err = -ENOMEM;
-	htab->buckets = bpf_map_area_alloc(htab->n_buckets *
-					   sizeof(struct bucket),
-					   htab->map.numa_node);
-	if (!htab->buckets)
+	n_buckets = htab->max_buckets;
+	if (htab_is_resizable(htab))
+		n_buckets = min_t(u32, n_buckets, HTAB_INIT_BUCKETS);
+
+	t = htab_alloc_table(htab, n_buckets);
+	if (!t)
 		goto free_htab;
+	RCU_INIT_POINTER(htab->tbl, t);
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		INIT_HLIST_NULLS_HEAD(&htab->buckets[i].head, i);
-		raw_spin_lock_init(&htab->buckets[i].lock);
-	}
+	init_irq_work(&htab->grow_irq_work, htab_grow_kick);
+	INIT_WORK(&htab->grow_work, htab_grow_work);
 
 	if (prealloc) {
 		err = prealloc_init(htab);
@@ -394,7 +457,7 @@ static struct bpf_map *htab_map_alloc(union bpf_attr *attr)
 free_prealloc:
 	prealloc_destroy(htab);
 free_buckets:
-	bpf_map_area_free(htab->buckets);
+	bpf_map_area_free(t);
 free_htab:
 	kfree(htab);
 	return ERR_PTR(err);
@@ -405,14 +468,14 @@ static inline u32 htab_map_hash(const void *key, u32 key_len)
 	return jhash(key, key_len, 0);
 }
 
-static inline struct bucket *__select_bucket(struct bpf_htab *htab, u32 hash)
+static inline struct bucket *__tbl_bucket(struct htab_table *t, u32 hash)
 {
-	return &htab->buckets[hash & (htab->n_buckets - 1)];
+	return &t->buckets[hash & (t->n_buckets - 1)];
 }
 
-static inline struct hlist_nulls_head *select_bucket(struct bpf_htab *htab, u32 hash)
+static inline struct bucket *__select_bucket(struct bpf_htab *htab, u32 hash)
 {
-	return &__select_bucket(htab, hash)->head;
+	return __tbl_bucket(rcu_dereference_raw(htab->tbl), hash);
 }
 
 /* this lookup function can only be called with bucket lock taken */
@@ -459,9 +522,10 @@ again:
 static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
-	struct hlist_nulls_head *head;
+	struct htab_table *t, *old;
 	struct htab_elem *l;
 	u32 hash, key_size;
+	bool retried = false;
 
 	/* Must be called with rcu_read_lock. */
 	WARN_ON_ONCE(!rcu_read_lock_held());
@@ -470,11 +534,29 @@ static void *__htab_map_lookup_elem(struct bpf_map *map, void *key)
 
 	hash = htab_map_hash(key, key_size);
 
-	head = select_bucket(htab, hash);
+again:
+	t = rcu_dereference_raw(htab->tbl);
+	l = lookup_nulls_elem_raw(&__tbl_bucket(t, hash)->head, hash, key,
+				  key_size, t->n_buckets);
+	if (l)
+		return l;
 
-	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
+	old = rcu_dereference_raw(t->old);
+	if (unlikely(old)) {
+		l = lookup_nulls_elem_raw(&__tbl_bucket(old, hash)->head, hash,
+					  key, key_size, old->n_buckets);
+		if (l)
+			return l;
+		/* the element may have migrated between the two walks;
+		 * it moves at most once, so one retry is enough
+		 */
+		if (!retried) {
+			retried = true;
+			goto again;
+		}
+	}
 
-	return l;
+	return NULL;
 }
 
 static void *htab_map_lookup_elem(struct bpf_map *map, void *key)
@@ -579,24 +661,35 @@ static bool htab_lru_map_delete_node(void *arg, struct bpf_lru_node *node)
 static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	struct htab_table *t, *old;
 	struct hlist_nulls_head *head;
 	struct htab_elem *l, *next_l;
 	u32 hash, key_size;
-	int i = 0;
+	u32 i = 0;
 
 	WARN_ON_ONCE(!rcu_read_lock_held());
 
 	key_size = map->key_size;
 
+	t = rcu_dereference_raw(htab->tbl);
+	old = rcu_dereference_raw(t->old);
+
 	if (!key)
 		goto find_first_elem;
 
 	hash = htab_map_hash(key, key_size);
 
-	head = select_bucket(htab, hash);
-
-	/* lookup the key */
-	l = lookup_nulls_elem_raw(head, hash, key, key_size, htab->n_buckets);
+	/* lookup the key, falling back to the table a grow is migrating
+	 * away from
+	 */
+	l = lookup_nulls_elem_raw(&__tbl_bucket(t, hash)->head, hash, key,
+				  key_size, t->n_buckets);
+	if (!l && old) {
+		t = old;
+		old = NULL;
+		l = lookup_nulls_elem_raw(&__tbl_bucket(t, hash)->head, hash,
+					  key, key_size, t->n_buckets);
+	}
 
 	if (!l)
 		goto find_first_elem;
@@ -612,13 +705,14 @@ static int htab_map_get_next_key(struct bpf_map *map, void *key, void *next_key)
 	}
 
 	/* no more elements in this hash list, go to the next bucket */
-	i = hash & (htab->n_buckets - 1);
+	i = hash & (t->n_buckets - 1);
 	i++;
 
 find_first_elem:
-	/* iterate over buckets */
-	for (; i < htab->n_buckets; i++) {
-		head = select_bucket(htab, i);
+	/* iterate over buckets, appending the old table's during a grow */
+again:
+	for (; i < t->n_buckets; i++) {
+		head = &t->buckets[i].head;
 
 		/* pick first element in the bucket */
 		next_l = hlist_nulls_entry_safe(rcu_dereference_raw(hlist_nulls_first_rcu(head)),
@@ -630,6 +724,13 @@ find_first_elem:
 		}
 	}
 
+	if (old) {
+		t = old;
+		old = NULL;
+		i = 0;
+		goto again;
+	}
+
 	/* iterated over all buckets and all elements */
 	return -ENOENT;
 }
@@ -746,6 +847,18 @@ static struct htab_elem *alloc_htab_elem(struct bpf_htab *htab, void *key,
 				atomic_dec(&htab->count);
 				return ERR_PTR(-E2BIG);
 			}
+		if (htab_is_resizable(htab)) {
+			struct htab_table *t = rcu_dereference_raw(htab->tbl);
+
+			/* grow at 75% load; the worker ignores
+			 * spurious kicks
+			 */
+			if (t->n_buckets < htab->max_buckets &&
+			    !rcu_access_pointer(t->old) &&
+			    atomic_read(&htab->count) >
+			    t->n_buckets - (t->n_buckets >> 2))
+				irq_work_queue(&htab->grow_irq_work);
+		}
 		l_new = kmalloc_node(htab->elem_size, GFP_ATOMIC | __GFP_NOWARN,
 				     htab->map.numa_node);
 		if (!l_new)
@@ -778,6 +891,109 @@ static struct htab_elem *alloc_htab_elem(struct bpf_htab *htab, void *key,
 	return l_new;
 }
 
+/* Lock the bucket(s) covering @hash for modification.  While a grow is
+ * migrating elements the one for a key may sit in either table, so take
+ * the old table's bucket lock first - matching htab_grow_work()'s order
+ * - and then the current one.  New elements always go into the current
+ * table.
+ */
+static struct bucket *htab_lock_bucket(struct bpf_htab *htab, u32 hash,
+				       struct bucket **pold_b,
+				       unsigned long *pflags)
+{
+	struct htab_table *t, *old;
+	struct bucket *b, *old_b = NULL;
+	unsigned long flags;
+
+	t = rcu_dereference_raw(htab->tbl);
+	old = rcu_dereference_raw(t->old);
+	b = __tbl_bucket(t, hash);
+	if (unlikely(old)) {
+		old_b = __tbl_bucket(old, hash);
+		raw_spin_lock_irqsave(&old_b->lock, flags);
+		raw_spin_lock(&b->lock);
+	} else {
+		raw_spin_lock_irqsave(&b->lock, flags);
+	}
+
+	*pold_b = old_b;
+	*pflags = flags;
+	return b;
+}
+
+static void htab_unlock_bucket(struct bucket *b, struct bucket *old_b,
+			       unsigned long flags)
+{
+	if (unlikely(old_b)) {
+		raw_spin_unlock(&b->lock);
+		raw_spin_unlock_irqrestore(&old_b->lock, flags);
+	} else {
+		raw_spin_unlock_irqrestore(&b->lock, flags);
+	}
+}
+
+static void htab_grow_kick(struct irq_work *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab,
+					     grow_irq_work);
+
+	/* updates may run in any context, including NMI; bounce the
+	 * actual grow to process context
+	 */
+	schedule_work(&htab->grow_work);
+}
+
+static void htab_grow_work(struct work_struct *work)
+{
+	struct bpf_htab *htab = container_of(work, struct bpf_htab, grow_work);
+	struct htab_table *t, *nt;
+	u32 n_buckets, i;
+
+	t = rcu_dereference_raw(htab->tbl);
+	n_buckets = min(t->n_buckets * 2, htab->max_buckets);
+	if (n_buckets <= t->n_buckets)
+		return;
+
+	nt = htab_alloc_table(htab, n_buckets);
+	if (!nt)
+		/* the next update over the watermark will kick us again */
+		return;
+
+	/* publish the new table; from now on writers lock the old
+	 * bucket first and insert into the new table only
+	 */
+	rcu_assign_pointer(nt->old, t);
+	rcu_assign_pointer(htab->tbl, nt);
+
+	/* wait for writers that still treat the old table as current */
+	synchronize_rcu();
+
+	for (i = 0; i < t->n_buckets; i++) {
+		struct bucket *old_b = &t->buckets[i];
+		struct hlist_nulls_node *n;
+		struct htab_elem *l;
+		unsigned long flags;
+
+		raw_spin_lock_irqsave(&old_b->lock, flags);
+		hlist_nulls_for_each_entry_safe(l, n, &old_b->head, hash_node) {
+			struct bucket *b = __tbl_bucket(nt, l->hash);
+
+			raw_spin_lock(&b->lock);
+			hlist_nulls_del_rcu(&l->hash_node);
+			hlist_nulls_add_head_rcu(&l->hash_node, &b->head);
+			raw_spin_unlock(&b->lock);
+		}
+		raw_spin_unlock_irqrestore(&old_b->lock, flags);
+		cond_resched();
+	}
+
+	rcu_assign_pointer(nt->old, NULL);
+
+	/* wait for lookups that may still walk the old buckets */
+	synchronize_rcu();
+	bpf_map_area_free(t);
+}
+
 static int check_flags(struct bpf_htab *htab, struct htab_elem *l_old,
 		       u64 map_flags)
 {
@@ -800,7 +1016,7 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 	struct htab_elem *l_new = NULL, *l_old;
 	struct hlist_nulls_head *head;
 	unsigned long flags;
-	struct bucket *b;
+	struct bucket *b, *old_b;
 	u32 key_size, hash;
 	int ret;
 
@@ -814,13 +1030,13 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 
 	hash = htab_map_hash(key, key_size);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* bpf_map_update_elem() can be called in_irq() */
-	raw_spin_lock_irqsave(&b->lock, flags);
+	b = htab_lock_bucket(htab, hash, &old_b, &flags);
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
+	if (!l_old && old_b)
+		l_old = lookup_elem_raw(&old_b->head, hash, key, key_size);
 
 	ret = check_flags(htab, l_old, map_flags);
 	if (ret)
@@ -845,7 +1061,7 @@ static int htab_map_update_elem(struct bpf_map *map, void *key, void *value,
 	}
 	ret = 0;
 err:
-	raw_spin_unlock_irqrestore(&b->lock, flags);
+	htab_unlock_bucket(b, old_b, flags);
 	return ret;
 }
 
@@ -921,7 +1137,7 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 	struct htab_elem *l_new = NULL, *l_old;
 	struct hlist_nulls_head *head;
 	unsigned long flags;
-	struct bucket *b;
+	struct bucket *b, *old_b;
 	u32 key_size, hash;
 	int ret;
 
@@ -935,13 +1151,13 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 
 	hash = htab_map_hash(key, key_size);
 
-	b = __select_bucket(htab, hash);
-	head = &b->head;
-
 	/* bpf_map_update_elem() can be called in_irq() */
-	raw_spin_lock_irqsave(&b->lock, flags);
+	b = htab_lock_bucket(htab, hash, &old_b, &flags);
+	head = &b->head;
 
 	l_old = lookup_elem_raw(head, hash, key, key_size);
+	if (!l_old && old_b)
+		l_old = lookup_elem_raw(&old_b->head, hash, key, key_size);
 
 	ret = check_flags(htab, l_old, map_flags);
 	if (ret)
@@ -962,7 +1178,7 @@ static int __htab_percpu_map_update_elem(struct bpf_map *map, void *key,
 	}
 	ret = 0;
 err:
-	raw_spin_unlock_irqrestore(&b->lock, flags);
+	htab_unlock_bucket(b, old_b, flags);
 	return ret;
 }
 
@@ -1048,8 +1264,7 @@ static int htab_lru_percpu_map_update_elem(struct bpf_map *map, void *key,
 static int htab_map_delete_elem(struct bpf_map *map, void *key)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
-	struct hlist_nulls_head *head;
-	struct bucket *b;
+	struct bucket *b, *old_b;
 	struct htab_elem *l;
 	unsigned long flags;
 	u32 hash, key_size;
@@ -1060,12 +1275,12 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 	key_size = map->key_size;
 
 	hash = htab_map_hash(key, key_size);
-	b = __select_bucket(htab, hash);
-	head = &b->head;
 
-	raw_spin_lock_irqsave(&b->lock, flags);
+	b = htab_lock_bucket(htab, hash, &old_b, &flags);
 
-	l = lookup_elem_raw(head, hash, key, key_size);
+	l = lookup_elem_raw(&b->head, hash, key, key_size);
+	if (!l && old_b)
+		l = lookup_elem_raw(&old_b->head, hash, key, key_size);
 
 	if (l) {
 		hlist_nulls_del_rcu(&l->hash_node);
@@ -1073,7 +1288,7 @@ static int htab_map_delete_elem(struct bpf_map *map, void *key)
 		ret = 0;
 	}
 
-	raw_spin_unlock_irqrestore(&b->lock, flags);
+	htab_unlock_bucket(b, old_b, flags);
 	return ret;
 }
 
@@ -1112,10 +1327,11 @@ static int htab_lru_map_delete_elem(struct bpf_map *map, void *key)
 
 static void delete_all_elements(struct bpf_htab *htab)
 {
-	int i;
+	struct htab_table *t = rcu_dereference_raw(htab->tbl);
+	u32 i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		struct hlist_nulls_head *head = select_bucket(htab, i);
+	for (i = 0; i < t->n_buckets; i++) {
+		struct hlist_nulls_head *head = &t->buckets[i].head;
 		struct hlist_nulls_node *n;
 		struct htab_elem *l;
 
@@ -1138,6 +1354,12 @@ static void htab_map_free(struct bpf_map *map)
 	 */
 	synchronize_rcu();
 
+	/* a kicked grow may still be queued or in flight; once it is
+	 * done the current table is the only one left
+	 */
+	irq_work_sync(&htab->grow_irq_work);
+	cancel_work_sync(&htab->grow_work);
+
 	/* some of free_htab_elem() callbacks for elements of this map may
 	 * not have executed. Wait for them.
 	 */
@@ -1148,7 +1370,7 @@ static void htab_map_free(struct bpf_map *map)
 		prealloc_destroy(htab);
 
 	free_percpu(htab->extra_elems);
-	bpf_map_area_free(htab->buckets);
+	bpf_map_area_free(rcu_dereference_raw(htab->tbl));
 	kfree(htab);
 }
 
@@ -1277,13 +1499,14 @@ static int fd_htab_map_alloc_check(union bpf_attr *attr)
 static void fd_htab_map_free(struct bpf_map *map)
 {
 	struct bpf_htab *htab = container_of(map, struct bpf_htab, map);
+	struct htab_table *t = rcu_dereference_raw(htab->tbl);
 	struct hlist_nulls_node *n;
 	struct hlist_nulls_head *head;
 	struct htab_elem *l;
-	int i;
+	u32 i;
 
-	for (i = 0; i < htab->n_buckets; i++) {
-		head = select_bucket(htab, i);
+	for (i = 0; i < t->n_buckets; i++) {
+		head = &t->buckets[i].head;
 
 		hlist_nulls_for_each_entry_safe(l, n, head, hash_node) {
 			void *ptr = fd_htab_map_get_ptr(map, l);
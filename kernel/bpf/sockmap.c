@@ -44,6 +44,9 @@
 #define SOCK_CREATE_FLAG_MASK \
 	(BPF_F_NUMA_NODE | BPF_F_RDONLY | BPF_F_WRONLY)
 
+/* max redirected skbs accumulated before the batch is spliced to the peer */
+#define SMAP_REDIR_BATCH_MAX 32
+
 struct bpf_stab {
 	struct bpf_map map;
 	struct sock **sock_map;
@@ -69,6 +72,13 @@ struct smap_psock {
 	struct sk_buff_head rxqueue;
 	bool strp_enabled;
 
+	/* verdict redirect batch; only touched from the strparser callpath,
+	 * which is serialized per psock, so no locking is needed.  redir_sk
+	 * holds a sock reference while the batch is non-empty.
+	 */
+	struct sk_buff_head redir_batch;
+	struct sock *redir_sk;
+
 	/* datapath error path cache across tx work invocations */
 	int save_rem;
 	int save_off;
@@ -220,6 +230,40 @@ static int smap_verdict_func(struct smap_psock *psock, struct sk_buff *skb)
 		__SK_DROP;
 }
 
+/* Deliver the accumulated redirect batch to its peer socket: one check of
+ * the peer's state, one acquisition of its queue lock, and one tx work
+ * wakeup for the whole burst.  Called under rcu_read_lock() from the
+ * strparser callpath.
+ */
+static void smap_redir_flush(struct smap_psock *psock)
+{
+	struct sock *sk = psock->redir_sk;
+	struct smap_psock *peer;
+	struct sk_buff *skb;
+	unsigned long flags;
+
+	if (!sk)
+		return;
+	psock->redir_sk = NULL;
+
+	peer = smap_psock_sk(sk);
+	if (likely(peer &&
+		   test_bit(SMAP_TX_RUNNING, &peer->state) &&
+		   !sock_flag(sk, SOCK_DEAD) &&
+		   sock_writeable(sk))) {
+		skb_queue_walk(&psock->redir_batch, skb)
+			skb_set_owner_w(skb, sk);
+		spin_lock_irqsave(&peer->rxqueue.lock, flags);
+		skb_queue_splice_tail_init(&psock->redir_batch,
+					   &peer->rxqueue);
+		spin_unlock_irqrestore(&peer->rxqueue.lock, flags);
+		schedule_work(&peer->tx_work);
+	} else {
+		__skb_queue_purge(&psock->redir_batch);
+	}
+	sock_put(sk);
+}
+
 static void smap_do_verdict(struct smap_psock *psock, struct sk_buff *skb)
 {
 	struct sock *sk;
@@ -230,17 +274,21 @@ static void smap_do_verdict(struct smap_psock *psock, struct sk_buff *skb)
 	case __SK_REDIRECT:
 		sk = do_sk_redirect_map(skb);
 		if (likely(sk)) {
-			struct smap_psock *peer = smap_psock_sk(sk);
-
-			if (likely(peer &&
-				   test_bit(SMAP_TX_RUNNING, &peer->state) &&
-				   !sock_flag(sk, SOCK_DEAD) &&
-				   sock_writeable(sk))) {
-				skb_set_owner_w(skb, sk);
-				skb_queue_tail(&peer->rxqueue, skb);
-				schedule_work(&peer->tx_work);
-				break;
+			/* Batch consecutive redirects to the same peer; the
+			 * batch is flushed when the peer changes, when it
+			 * grows too large, or at the end of the strparser
+			 * read burst via smap_read_sock_done().
+			 */
+			if (psock->redir_sk != sk) {
+				smap_redir_flush(psock);
+				sock_hold(sk);
+				psock->redir_sk = sk;
 			}
+			__skb_queue_tail(&psock->redir_batch, skb);
+			if (skb_queue_len(&psock->redir_batch) >=
+			    SMAP_REDIR_BATCH_MAX)
+				smap_redir_flush(psock);
+			break;
 		}
 	/* Fall through and free skb otherwise */
 	case __SK_DROP:
@@ -418,6 +466,14 @@ static int smap_parse_func_strparser(struct strparser *strp,
 
 static int smap_read_sock_done(struct strparser *strp, int err)
 {
+	struct smap_psock *psock;
+
+	/* end of a read burst; deliver whatever redirects it produced */
+	rcu_read_lock();
+	psock = container_of(strp, struct smap_psock, strp);
+	smap_redir_flush(psock);
+	rcu_read_unlock();
+
 	return err;
 }
 
@@ -480,6 +536,13 @@ static void smap_gc_work(struct work_struct *w)
 	cancel_work_sync(&psock->tx_work);
 	__skb_queue_purge(&psock->rxqueue);
 
+	/* strparser is done, so no flush can race with this */
+	__skb_queue_purge(&psock->redir_batch);
+	if (psock->redir_sk) {
+		sock_put(psock->redir_sk);
+		psock->redir_sk = NULL;
+	}
+
 	/* At this point all strparser and xmit work must be complete */
 	if (psock->bpf_parse)
 		bpf_prog_put(psock->bpf_parse);
@@ -508,6 +571,7 @@ static struct smap_psock *smap_init_psock(struct sock *sock,
 
 	psock->sock = sock;
 	skb_queue_head_init(&psock->rxqueue);
+	skb_queue_head_init(&psock->redir_batch);
 	INIT_WORK(&psock->tx_work, smap_tx_work);
 	INIT_WORK(&psock->gc_work, smap_gc_work);
 	INIT_LIST_HEAD(&psock->maps);
@@ -22,6 +22,7 @@
 #include <linux/stringify.h>
 #include <linux/bsearch.h>
 #include <linux/sort.h>
+#include <linux/jhash.h>
 
 #include "disasm.h"
 
@@ -5576,6 +5577,306 @@ patch_call_imm:
 	return 0;
 }
 
+/* Verification cache.
+ *
+ * Loaders that set up the same programs over and over (container CNIs,
+ * daemons restarting) pay the full do_check() walk for byte-identical
+ * instructions on every load.  Cache the verdict: after a successful
+ * verification the rewritten image and the flags the verifier set on
+ * the program are remembered, keyed by the program tag plus everything
+ * else the outcome depends on - program type, privilege, alignment
+ * mode, whether a JIT is requested and the shape of every map the
+ * program uses.  The tag only prefilters: the full pre-verification
+ * image is compared as well, so a tag collision (truncated SHA-1) can
+ * never hand out another program's rewritten body.  A later load that
+ * matches replays the image instead
+ * of verifying again; only the embedded map and prog->aux addresses
+ * are patched for the new load.
+ *
+ * The image still has to go through the JIT: it embeds per-load
+ * addresses, so a compiled body cannot be shared.
+ *
+ * Everything here runs under bpf_verifier_lock.
+ */
+struct bpf_verif_cache_reloc {
+	u32 insn_idx;
+	u32 map_idx;	/* BPF_VERIF_RELOC_PROG_AUX for prog->aux loads */
+};
+
+#define BPF_VERIF_RELOC_PROG_AUX	U32_MAX
+
+struct bpf_verif_cache_entry {
+	struct list_head list;
+	/* lookup key; orig_insnsi is the pre-verification image with the
+	 * per-load map addresses canonicalized, compared in full so a
+	 * (truncated) tag collision can never replay a foreign image
+	 */
+	u8 tag[BPF_TAG_SIZE];
+	struct bpf_insn *orig_insnsi;
+	enum bpf_prog_type type;
+	u32 orig_len;
+	u32 map_fp;
+	u32 used_map_cnt;
+	bool priv;
+	bool jit_requested;
+	bool strict_alignment;
+	/* cached verdict */
+	struct bpf_insn *insnsi;
+	u32 len;
+	struct bpf_verif_cache_reloc *relocs;
+	u32 nr_relocs;
+	u32 stack_depth;
+	u32 max_ctx_offset;
+	bool cb_access;
+	bool dst_needed;
+	bool kprobe_override;
+};
+
+static LIST_HEAD(bpf_verif_cache);
+static unsigned int bpf_verif_cache_cnt;
+
+#define BPF_VERIF_CACHE_MAX_ENTRIES	64
+
+/* hash of everything about the used maps that the verification outcome
+ * or the rewritten image depends on
+ */
+static u32 bpf_verif_cache_map_fp(struct bpf_verifier_env *env)
+{
+	u32 fp = 0;
+	int i;
+
+	for (i = 0; i < env->used_map_cnt; i++) {
+		const struct bpf_map *map = env->used_maps[i];
+
+		do {
+			u32 desc[6] = { map->map_type, map->key_size,
+					map->value_size, map->max_entries,
+					map->map_flags, map->unpriv_array };
+
+			fp = jhash2(desc, ARRAY_SIZE(desc), fp);
+			map = map->inner_map_meta;
+		} while (map);
+	}
+	return fp;
+}
+
+/* Snapshot the image before verification rewrites it, with the per-load
+ * map address in each pseudo ld_imm64 replaced by its used_maps index,
+ * so two loads of byte-identical bytecode compare equal with memcmp().
+ */
+static struct bpf_insn *bpf_verif_cache_snapshot(struct bpf_verifier_env *env)
+{
+	struct bpf_prog *prog = env->prog;
+	struct bpf_insn *insnsi;
+	u32 i, j;
+
+	insnsi = kmemdup(prog->insnsi, prog->len * sizeof(struct bpf_insn),
+			 GFP_KERNEL);
+	if (!insnsi)
+		return NULL;
+
+	for (i = 0; i + 1 < prog->len; i++) {
+		struct bpf_insn *insn = &insnsi[i];
+		u64 addr;
+
+		if (insn->code != (BPF_LD | BPF_IMM | BPF_DW))
+			continue;
+		if (insn->src_reg == BPF_PSEUDO_MAP_FD) {
+			addr = (u32)insn[0].imm | ((u64)insn[1].imm << 32);
+			for (j = 0; j < env->used_map_cnt; j++)
+				if ((u64)(unsigned long)env->used_maps[j] ==
+				    addr)
+					break;
+			insn[0].imm = j;
+			insn[1].imm = 0;
+		}
+		i++;	/* skip the second half of the ld_imm64 */
+	}
+	return insnsi;
+}
+
+static bool bpf_verif_cache_match(struct bpf_verifier_env *env,
+				  struct bpf_verif_cache_entry *e, u32 map_fp,
+				  const struct bpf_insn *orig_insnsi)
+{
+	struct bpf_prog *prog = env->prog;
+
+	return e->type == prog->type &&
+	       e->orig_len == prog->len &&
+	       !memcmp(e->tag, prog->tag, BPF_TAG_SIZE) &&
+	       e->priv == env->allow_ptr_leaks &&
+	       e->jit_requested == prog->jit_requested &&
+	       e->strict_alignment == env->strict_alignment &&
+	       e->used_map_cnt == env->used_map_cnt &&
+	       e->map_fp == map_fp &&
+	       !memcmp(e->orig_insnsi, orig_insnsi,
+		       e->orig_len * sizeof(struct bpf_insn));
+}
+
+/* Replay a cached verdict: install the rewritten image and patch in the
+ * addresses belonging to this load.  Returns -ENOENT when no entry
+ * matches and the caller has to run the full verifier.
+ */
+static int bpf_verif_cache_lookup(struct bpf_verifier_env *env,
+				  const struct bpf_insn *orig_insnsi)
+{
+	struct bpf_verif_cache_entry *e;
+	struct bpf_prog *prog;
+	u32 map_fp, i;
+
+	if (bpf_prog_is_dev_bound(env->prog->aux))
+		return -ENOENT;
+
+	map_fp = bpf_verif_cache_map_fp(env);
+	list_for_each_entry(e, &bpf_verif_cache, list)
+		if (bpf_verif_cache_match(env, e, map_fp, orig_insnsi))
+			goto found;
+	return -ENOENT;
+
+found:
+	prog = env->prog;
+	if (e->len != prog->len) {
+		prog = bpf_prog_realloc(prog, bpf_prog_size(e->len), GFP_USER);
+		if (!prog)
+			return -ENOENT;
+		prog->len = e->len;
+		env->prog = prog;
+	}
+	memcpy(prog->insnsi, e->insnsi, e->len * sizeof(struct bpf_insn));
+
+	for (i = 0; i < e->nr_relocs; i++) {
+		const struct bpf_verif_cache_reloc *r = &e->relocs[i];
+		struct bpf_insn *insn = &prog->insnsi[r->insn_idx];
+		u64 addr;
+
+		if (r->map_idx == BPF_VERIF_RELOC_PROG_AUX)
+			addr = (unsigned long)prog->aux;
+		else
+			addr = (unsigned long)env->used_maps[r->map_idx];
+		insn[0].imm = (u32)addr;
+		insn[1].imm = addr >> 32;
+	}
+
+	prog->cb_access = e->cb_access;
+	prog->dst_needed = e->dst_needed;
+	prog->kprobe_override = e->kprobe_override;
+	prog->aux->stack_depth = e->stack_depth;
+	prog->aux->max_ctx_offset = e->max_ctx_offset;
+
+	/* fixup_bpf_calls() seeds the prandom state as a side effect;
+	 * give a replayed program the same treatment
+	 */
+	bpf_user_rnd_init_once();
+
+	list_move(&e->list, &bpf_verif_cache);
+	return 0;
+}
+
+/* called after a successful verification, before the pseudo ld_imm64
+ * markers are converted away
+ */
+static void bpf_verif_cache_store(struct bpf_verifier_env *env, u32 orig_len,
+				  const struct bpf_insn *orig_insnsi)
+{
+	struct bpf_verif_cache_reloc *relocs;
+	struct bpf_verif_cache_entry *e;
+	struct bpf_prog *prog = env->prog;
+	u32 nr_ld_imm64 = 0, nr_relocs = 0;
+	u32 i;
+
+	/* bpf-to-bpf calls get their subprogs compiled inside
+	 * fixup_call_args(); such images cannot be replayed
+	 */
+	if (bpf_prog_is_dev_bound(prog->aux) || env->subprog_cnt)
+		return;
+
+	for (i = 0; i < prog->len; i++)
+		if (prog->insnsi[i].code == (BPF_LD | BPF_IMM | BPF_DW))
+			nr_ld_imm64++;
+
+	e = kzalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return;
+
+	e->insnsi = kmemdup(prog->insnsi, prog->len * sizeof(struct bpf_insn),
+			    GFP_KERNEL);
+	e->orig_insnsi = kmemdup(orig_insnsi,
+				 orig_len * sizeof(struct bpf_insn),
+				 GFP_KERNEL);
+	relocs = kmalloc_array(nr_ld_imm64, sizeof(*relocs), GFP_KERNEL);
+	if (!e->insnsi || !e->orig_insnsi || (nr_ld_imm64 && !relocs))
+		goto free_entry;
+
+	for (i = 0; i < prog->len; i++) {
+		const struct bpf_insn *insn = &prog->insnsi[i];
+		u64 addr;
+		u32 j;
+
+		if (insn->code != (BPF_LD | BPF_IMM | BPF_DW))
+			continue;
+		addr = (u32)insn[0].imm | ((u64)insn[1].imm << 32);
+		if (insn->src_reg == BPF_PSEUDO_MAP_FD) {
+			for (j = 0; j < env->used_map_cnt; j++)
+				if ((u64)(unsigned long)env->used_maps[j] ==
+				    addr)
+					break;
+			if (j == env->used_map_cnt)
+				goto free_entry;
+			relocs[nr_relocs].map_idx = j;
+		} else if (addr == (unsigned long)prog->aux) {
+			/* fixup_bpf_calls() embedded prog->aux for
+			 * bpf_redirect_map(); it differs per load
+			 */
+			relocs[nr_relocs].map_idx = BPF_VERIF_RELOC_PROG_AUX;
+		} else {
+			i++;
+			continue;
+		}
+		relocs[nr_relocs++].insn_idx = i;
+		i++;	/* skip the second half of the ld_imm64 */
+	}
+
+	memcpy(e->tag, prog->tag, BPF_TAG_SIZE);
+	e->type = prog->type;
+	e->orig_len = orig_len;
+	e->map_fp = bpf_verif_cache_map_fp(env);
+	e->used_map_cnt = env->used_map_cnt;
+	e->priv = env->allow_ptr_leaks;
+	e->jit_requested = prog->jit_requested;
+	e->strict_alignment = env->strict_alignment;
+
+	e->len = prog->len;
+	e->relocs = relocs;
+	e->nr_relocs = nr_relocs;
+	e->stack_depth = prog->aux->stack_depth;
+	e->max_ctx_offset = prog->aux->max_ctx_offset;
+	e->cb_access = prog->cb_access;
+	e->dst_needed = prog->dst_needed;
+	e->kprobe_override = prog->kprobe_override;
+
+	if (bpf_verif_cache_cnt >= BPF_VERIF_CACHE_MAX_ENTRIES) {
+		struct bpf_verif_cache_entry *old;
+
+		old = list_last_entry(&bpf_verif_cache,
+				      struct bpf_verif_cache_entry, list);
+		list_del(&old->list);
+		kfree(old->orig_insnsi);
+		kfree(old->insnsi);
+		kfree(old->relocs);
+		kfree(old);
+		bpf_verif_cache_cnt--;
+	}
+	list_add(&e->list, &bpf_verif_cache);
+	bpf_verif_cache_cnt++;
+	return;
+
+free_entry:
+	kfree(relocs);
+	kfree(e->orig_insnsi);
+	kfree(e->insnsi);
+	kfree(e);
+}
+
 static void free_states(struct bpf_verifier_env *env)
 {
 	struct bpf_verifier_state_list *sl, *sln;
@@ -5601,8 +5902,11 @@ static void free_states(struct bpf_verifier_env *env)
 
 int bpf_check(struct bpf_prog **prog, union bpf_attr *attr)
 {
+	u32 orig_len = (*prog)->len;
+	struct bpf_insn *orig_insnsi = NULL;
 	struct bpf_verifier_env *env;
 	struct bpf_verifer_log *log;
+	bool cache_hit = false;
 	int ret = -EINVAL;
 
 	/* no program is valid */
@@ -5666,6 +5970,17 @@ int bpf_check(struct bpf_prog **prog, union bpf_attr *attr)
 
 	env->allow_ptr_leaks = capable(CAP_SYS_ADMIN);
 
+	/* a load asking for a verifier log wants the full walk; without a
+	 * snapshot of the incoming image the cache is skipped entirely
+	 */
+	orig_insnsi = bpf_verif_cache_snapshot(env);
+	if (!log->level && orig_insnsi &&
+	    !bpf_verif_cache_lookup(env, orig_insnsi)) {
+		cache_hit = true;
+		ret = 0;
+		goto skip_full_check;
+	}
+
 	ret = check_cfg(env);
 	if (ret < 0)
 		goto skip_full_check;
@@ -5680,22 +5995,25 @@ skip_full_check:
 	while (!pop_stack(env, NULL, NULL));
 	free_states(env);
 
-	if (ret == 0)
+	if (ret == 0 && !cache_hit)
 		sanitize_dead_code(env);
 
-	if (ret == 0)
+	if (ret == 0 && !cache_hit)
 		ret = check_max_stack_depth(env);
 
-	if (ret == 0)
+	if (ret == 0 && !cache_hit)
 		/* program is valid, convert *(u32*)(ctx + off) accesses */
 		ret = convert_ctx_accesses(env);
 
-	if (ret == 0)
+	if (ret == 0 && !cache_hit)
 		ret = fixup_bpf_calls(env);
 
-	if (ret == 0)
+	if (ret == 0 && !cache_hit)
 		ret = fixup_call_args(env);
 
+	if (ret == 0 && !cache_hit && orig_insnsi)
+		bpf_verif_cache_store(env, orig_len, orig_insnsi);
+
 	if (log->level && bpf_verifier_log_full(log))
 		ret = -ENOSPC;
 	if (log->level && !log->ubuf) {
@@ -5732,6 +6050,7 @@ err_release_maps:
 		release_maps(env);
 	*prog = env->prog;
 err_unlock:
+	kfree(orig_insnsi);
 	mutex_unlock(&bpf_verifier_lock);
 	vfree(env->insn_aux_data);
 err_free_env:
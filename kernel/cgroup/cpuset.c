@@ -861,6 +861,26 @@ void rebuild_sched_domains(void)
 	mutex_unlock(&cpuset_mutex);
 }
 
+static void cpuset_rebuild_workfn(struct work_struct *work)
+{
+	rebuild_sched_domains();
+}
+
+static DECLARE_WORK(cpuset_rebuild_work, cpuset_rebuild_workfn);
+
+/*
+ * Rebuilding sched domains can take tens of milliseconds on a big box
+ * and the config write paths do it with cpuset_mutex held, so container
+ * churn ends up serializing on it.  Defer the rebuild to a work item
+ * instead; rebuilds requested while one is pending are coalesced into a
+ * single pass.  The cpu hotplug path keeps rebuilding synchronously as
+ * it is the authority on stale domains after cpu masks change.
+ */
+static void rebuild_sched_domains_deferred(void)
+{
+	schedule_work(&cpuset_rebuild_work);
+}
+
 /**
  * update_tasks_cpumask - Update the cpumasks of tasks in the cpuset.
  * @cs: the cpuset in which each task's cpus_allowed mask needs to be changed
@@ -944,7 +964,7 @@ static void update_cpumasks_hier(struct cpuset *cs, struct cpumask *new_cpus)
 	rcu_read_unlock();
 
 	if (need_rebuild_sched_domains)
-		rebuild_sched_domains_locked();
+		rebuild_sched_domains_deferred();
 }
 
 /**
@@ -1276,7 +1296,7 @@ static int update_relax_domain_level(struct cpuset *cs, s64 val)
 		cs->relax_domain_level = val;
 		if (!cpumask_empty(cs->cpus_allowed) &&
 		    is_sched_load_balance(cs))
-			rebuild_sched_domains_locked();
+			rebuild_sched_domains_deferred();
 	}
 
 	return 0;
@@ -1342,7 +1362,7 @@ static int update_flag(cpuset_flagbits_t bit, struct cpuset *cs,
 	spin_unlock_irq(&callback_lock);
 
 	if (!cpumask_empty(trialcs->cpus_allowed) && balance_flag_changed)
-		rebuild_sched_domains_locked();
+		rebuild_sched_domains_deferred();
 
 	if (spread_flag_changed)
 		update_tasks_flags(cs);
@@ -2034,7 +2054,7 @@ out_unlock:
 /*
  * If the cpuset being removed has its flag 'sched_load_balance'
  * enabled, then simulate turning sched_load_balance off, which
- * will call rebuild_sched_domains_locked().
+ * will queue a deferred sched domain rebuild.
  */
 
 static void cpuset_css_offline(struct cgroup_subsys_state *css)
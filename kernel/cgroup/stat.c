@@ -5,6 +5,9 @@
 static DEFINE_MUTEX(cgroup_stat_mutex);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_cpu_stat_lock);
 
+/* when the whole hierarchy was last flushed, protected by cgroup_stat_mutex */
+static unsigned long cgroup_stat_last_bulk_flush = INITIAL_JIFFIES;
+
 static struct cgroup_cpu_stat *cgroup_cpu_stat(struct cgroup *cgrp, int cpu)
 {
 	return per_cpu_ptr(cgrp->cpu_stat, cpu);
@@ -53,6 +56,15 @@ static void cgroup_cpu_stat_updated(struct cgroup *cgrp, int cpu)
 
 		cstat->updated_next = pcstat->updated_children;
 		pcstat->updated_children = cgrp;
+		cstat->dirty_epoch++;
+
+		/*
+		 * The root cgroup never links anywhere itself.  Bump its
+		 * epoch when a chain first reaches it so that flushes
+		 * rooted at it can see subtree updates too.
+		 */
+		if (!cgroup_parent(parent))
+			pcstat->dirty_epoch++;
 	}
 
 	raw_spin_unlock_irqrestore(cpu_lock, flags);
@@ -179,9 +191,20 @@ static void cgroup_stat_flush_locked(struct cgroup *cgrp)
 
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_cpu_stat_lock, cpu);
+		struct cgroup_cpu_stat *cstat = cgroup_cpu_stat(cgrp, cpu);
 		struct cgroup *pos = NULL;
 
+		/*
+		 * Nothing in @cgrp's subtree entered the updated tree on
+		 * @cpu since the last flush rooted at @cgrp.  The test is
+		 * speculative; an update racing with it stays linked and
+		 * gets picked up by the next flush.
+		 */
+		if (READ_ONCE(cstat->dirty_epoch) == cstat->flushed_epoch)
+			continue;
+
 		raw_spin_lock_irq(cpu_lock);
+		cstat->flushed_epoch = cstat->dirty_epoch;
 		while ((pos = cgroup_cpu_stat_pop_updated(pos, cgrp, cpu)))
 			cgroup_cpu_stat_flush_one(pos, cpu);
 		raw_spin_unlock_irq(cpu_lock);
@@ -266,6 +289,17 @@ void cgroup_stat_show_cputime(struct seq_file *seq)
 
 	mutex_lock(&cgroup_stat_mutex);
 
+	/*
+	 * Monitoring tends to read a lot of cpu.stat files back to back.
+	 * Flush the whole hierarchy once per jiffy so that the targeted
+	 * flushes below mostly find their subtrees clean and only need to
+	 * pick up what got dirtied since the bulk flush.
+	 */
+	if (time_is_before_jiffies(cgroup_stat_last_bulk_flush)) {
+		cgroup_stat_last_bulk_flush = jiffies;
+		cgroup_stat_flush_locked(&cgrp_dfl_root.cgrp);
+	}
+
 	cgroup_stat_flush_locked(cgrp);
 
 	usage = cgrp->stat.cputime.sum_exec_runtime;
@@ -11,6 +11,8 @@
 
 #include <linux/perf_event.h>
 #include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/moduleparam.h>
 #include <linux/sched/task_stack.h>
 
 #include "internal.h"
@@ -20,6 +22,29 @@ struct callchain_cpus_entries {
 	struct perf_callchain_entry	*cpu_entries[0];
 };
 
+/*
+ * Optional callchain interning.  Hot stacks repeat across samples by
+ * orders of magnitude; when enabled, a sampled chain whose hash was
+ * seen before on this CPU is replaced by a two-word reference
+ * (PERF_CONTEXT_INTERN_REF, id) and first occurrences carry a
+ * (PERF_CONTEXT_INTERN_DEF, id) prefix that lets the consumer build
+ * the id->stack dictionary.  Opt-in, since consumers must understand
+ * the markers; the per-CPU tables start empty whenever the callchain
+ * buffers are (re)allocated, i.e. when the first event attaches.
+ */
+static bool callchain_intern_enabled __read_mostly;
+module_param_named(intern, callchain_intern_enabled, bool, 0644);
+
+#define CALLCHAIN_INTERN_SHIFT	10
+#define CALLCHAIN_INTERN_SIZE	(1 << CALLCHAIN_INTERN_SHIFT)
+
+struct callchain_intern_cpus {
+	struct rcu_head			rcu_head;
+	void				*cpu_state[0];
+};
+
+static struct callchain_intern_cpus *callchain_intern_cpus;
+
 int sysctl_perf_event_max_stack __read_mostly = PERF_MAX_STACK_DEPTH;
 int sysctl_perf_event_max_contexts_per_stack __read_mostly = PERF_MAX_CONTEXTS_PER_STACK;
 
@@ -46,6 +71,60 @@ __weak void perf_callchain_user(struct perf_callchain_entry_ctx *entry,
 {
 }
 
+static inline size_t callchain_intern_scratch__sizeof(void)
+{
+	/* a DEF record prepends two words to a maximally deep chain */
+	return perf_callchain_entry__sizeof() + 2 * sizeof(__u64);
+}
+
+static inline size_t callchain_intern_state__sizeof(void)
+{
+	return CALLCHAIN_INTERN_SIZE * sizeof(u64) +
+	       callchain_intern_scratch__sizeof() * PERF_NR_CONTEXTS;
+}
+
+static void release_callchain_intern_rcu(struct rcu_head *head)
+{
+	struct callchain_intern_cpus *intern;
+	int cpu;
+
+	intern = container_of(head, struct callchain_intern_cpus, rcu_head);
+
+	for_each_possible_cpu(cpu)
+		kfree(intern->cpu_state[cpu]);
+
+	kfree(intern);
+}
+
+/*
+ * Best effort: interning quietly stays unavailable if the tables
+ * can't be allocated.  Called under callchain_mutex.
+ */
+static void alloc_callchain_intern(void)
+{
+	struct callchain_intern_cpus *intern;
+	int cpu;
+
+	intern = kzalloc(offsetof(struct callchain_intern_cpus,
+				  cpu_state[nr_cpu_ids]), GFP_KERNEL);
+	if (!intern)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		intern->cpu_state[cpu] =
+			kzalloc_node(callchain_intern_state__sizeof(),
+				     GFP_KERNEL, cpu_to_node(cpu));
+		if (!intern->cpu_state[cpu]) {
+			for_each_possible_cpu(cpu)
+				kfree(intern->cpu_state[cpu]);
+			kfree(intern);
+			return;
+		}
+	}
+
+	rcu_assign_pointer(callchain_intern_cpus, intern);
+}
+
 static void release_callchain_buffers_rcu(struct rcu_head *head)
 {
 	struct callchain_cpus_entries *entries;
@@ -62,10 +141,17 @@ static void release_callchain_buffers_rcu(struct rcu_head *head)
 static void release_callchain_buffers(void)
 {
 	struct callchain_cpus_entries *entries;
+	struct callchain_intern_cpus *intern;
 
 	entries = callchain_cpus_entries;
 	RCU_INIT_POINTER(callchain_cpus_entries, NULL);
 	call_rcu(&entries->rcu_head, release_callchain_buffers_rcu);
+
+	intern = callchain_intern_cpus;
+	if (intern) {
+		RCU_INIT_POINTER(callchain_intern_cpus, NULL);
+		call_rcu(&intern->rcu_head, release_callchain_intern_rcu);
+	}
 }
 
 static int alloc_callchain_buffers(void)
@@ -96,6 +182,8 @@ static int alloc_callchain_buffers(void)
 
 	rcu_assign_pointer(callchain_cpus_entries, entries);
 
+	alloc_callchain_intern();
+
 	return 0;
 
 fail:
@@ -235,6 +323,71 @@ exit_put:
 	return entry;
 }
 
+/*
+ * Replace @entry by its interned form when the feature is on.  Runs
+ * in the same execution context as the unwind (up to NMI); all state
+ * is per CPU and per recursion context, and a lost race on the hash
+ * table merely re-emits a DEF record.
+ */
+struct perf_callchain_entry *
+perf_callchain_intern(struct perf_callchain_entry *entry)
+{
+	struct callchain_intern_cpus *intern;
+	struct perf_callchain_entry *scratch;
+	u64 *hashes, h = 0xcbf29ce484222325ULL;
+	unsigned int i, idx;
+	int rctx;
+	void *state;
+
+	if (!READ_ONCE(callchain_intern_enabled) || !entry->nr)
+		return entry;
+
+	intern = rcu_dereference(callchain_intern_cpus);
+	if (!intern)
+		return entry;
+
+	/* same classification as get_recursion_context() */
+	if (unlikely(in_nmi()))
+		rctx = 3;
+	else if (in_irq())
+		rctx = 2;
+	else if (in_softirq())
+		rctx = 1;
+	else
+		rctx = 0;
+
+	state = intern->cpu_state[smp_processor_id()];
+	hashes = state;
+	scratch = state + CALLCHAIN_INTERN_SIZE * sizeof(u64) +
+		  rctx * callchain_intern_scratch__sizeof();
+
+	/* FNV-1a over the IP array; the hash doubles as the chain id */
+	for (i = 0; i < entry->nr; i++) {
+		h ^= entry->ip[i];
+		h *= 0x100000001b3ULL;
+	}
+	if (!h)		/* 0 marks an empty table slot */
+		return entry;
+
+	idx = hash_64(h, CALLCHAIN_INTERN_SHIFT);
+
+	if (READ_ONCE(hashes[idx]) == h) {
+		scratch->nr = 2;
+		scratch->ip[0] = PERF_CONTEXT_INTERN_REF;
+		scratch->ip[1] = h;
+		return scratch;
+	}
+
+	WRITE_ONCE(hashes[idx], h);
+
+	scratch->nr = entry->nr + 2;
+	scratch->ip[0] = PERF_CONTEXT_INTERN_DEF;
+	scratch->ip[1] = h;
+	memcpy(&scratch->ip[2], entry->ip, entry->nr * sizeof(__u64));
+
+	return scratch;
+}
+
 /*
  * Used for sysctl_perf_event_max_stack and
  * sysctl_perf_event_max_contexts_per_stack.
@@ -6004,6 +6004,8 @@ perf_callchain(struct perf_event *event, struct pt_regs *regs)
 
 	callchain = get_perf_callchain(regs, 0, kernel, user,
 				       max_stack, crosstask, true);
+	if (callchain)
+		callchain = perf_callchain_intern(callchain);
 	return callchain ?: &__empty_callchain;
 }
 
@@ -3,6 +3,8 @@
 #define _KERNEL_EVENTS_INTERNAL_H
 
 #include <linux/hardirq.h>
+#include <linux/hrtimer.h>
+#include <linux/irq_work.h>
 #include <linux/uaccess.h>
 
 /* Buffer handling */
@@ -22,6 +24,10 @@ struct ring_buffer {
 
 	atomic_t			poll;		/* POLL_ for wakeups */
 
+	u64				wakeup_stamp;	/* last coalesced wakeup, ns */
+	struct irq_work			wakeup_work;	/* coalesced wakeup path */
+	struct hrtimer			wakeup_timer;	/* delayed coalesced wakeup */
+
 	local_t				head;		/* write position    */
 	local_t				nest;		/* nested writers    */
 	local_t				events;		/* event limit       */
@@ -63,6 +69,12 @@ static inline void rb_free_rcu(struct rcu_head *rcu_head)
 	struct ring_buffer *rb;
 
 	rb = container_of(rcu_head, struct ring_buffer, rcu_head);
+	/*
+	 * No new wakeups can be queued once the last reference is
+	 * gone; wait out any in flight before the pages go away.
+	 */
+	irq_work_sync(&rb->wakeup_work);
+	hrtimer_cancel(&rb->wakeup_timer);
 	rb_free(rb);
 }
 
@@ -77,6 +89,18 @@ static inline void rb_toggle_paused(struct ring_buffer *rb, bool pause)
 extern struct ring_buffer *
 rb_alloc(int nr_pages, long watermark, int cpu, int flags);
 extern void perf_event_wakeup(struct perf_event *event);
+
+/*
+ * Pseudo context markers for interned callchains (see callchain.c):
+ * a DEF-prefixed chain defines id->stack, a REF chain is just
+ * (marker, id).  Values sit in the PERF_CONTEXT_ range, above
+ * PERF_CONTEXT_MAX.
+ */
+#define PERF_CONTEXT_INTERN_DEF		((__u64)-3968)
+#define PERF_CONTEXT_INTERN_REF		((__u64)-3969)
+
+extern struct perf_callchain_entry *
+perf_callchain_intern(struct perf_callchain_entry *entry);
 extern int rb_alloc_aux(struct ring_buffer *rb, struct perf_event *event,
 			pgoff_t pgoff, int nr_pages, long watermark, int flags);
 extern void rb_free_aux(struct ring_buffer *rb);
@@ -14,12 +14,70 @@
 #include <linux/slab.h>
 #include <linux/circ_buf.h>
 #include <linux/poll.h>
+#include <linux/moduleparam.h>
 
 #include "internal.h"
 
+/*
+ * Upper bound on consumer wakeup latency, in nanoseconds.  When set,
+ * wakeups are rate-limited per ring buffer instead of being issued on
+ * every watermark crossing, so many events redirected into one buffer
+ * (PERF_EVENT_IOC_SET_OUTPUT) share a single wakeup budget.  0 keeps
+ * the historic wake-on-every-crossing behavior.
+ */
+static unsigned int wakeup_coalesce_ns __read_mostly;
+module_param(wakeup_coalesce_ns, uint, 0644);
+
+static void perf_rb_do_wakeup(struct ring_buffer *rb)
+{
+	struct perf_event *event;
+
+	WRITE_ONCE(rb->wakeup_stamp, ktime_get_mono_fast_ns());
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(event, &rb->event_list, rb_entry)
+		perf_event_wakeup(event);
+	rcu_read_unlock();
+}
+
+static enum hrtimer_restart perf_rb_wakeup_timer(struct hrtimer *timer)
+{
+	struct ring_buffer *rb;
+
+	rb = container_of(timer, struct ring_buffer, wakeup_timer);
+	perf_rb_do_wakeup(rb);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Runs in hardirq context, where hrtimer_start() is allowed; the
+ * NMI-safe perf_output_wakeup() below may only queue irq_work.
+ */
+static void perf_rb_wakeup_work(struct irq_work *work)
+{
+	struct ring_buffer *rb = container_of(work, struct ring_buffer,
+					      wakeup_work);
+	u64 ns = READ_ONCE(wakeup_coalesce_ns);
+	u64 delta = ktime_get_mono_fast_ns() - READ_ONCE(rb->wakeup_stamp);
+
+	if (!ns || delta >= ns)
+		perf_rb_do_wakeup(rb);
+	else if (!hrtimer_active(&rb->wakeup_timer))
+		hrtimer_start(&rb->wakeup_timer, ns_to_ktime(ns - delta),
+			      HRTIMER_MODE_REL);
+}
+
 static void perf_output_wakeup(struct perf_output_handle *handle)
 {
-	atomic_set(&handle->rb->poll, EPOLLIN);
+	struct ring_buffer *rb = handle->rb;
+
+	atomic_set(&rb->poll, EPOLLIN);
+
+	if (READ_ONCE(wakeup_coalesce_ns)) {
+		irq_work_queue(&rb->wakeup_work);
+		return;
+	}
 
 	handle->event->pending_wakeup = 1;
 	irq_work_queue(&handle->event->pending);
@@ -289,6 +347,10 @@ ring_buffer_init(struct ring_buffer *rb, long watermark, int flags)
 	INIT_LIST_HEAD(&rb->event_list);
 	spin_lock_init(&rb->event_lock);
 
+	init_irq_work(&rb->wakeup_work, perf_rb_wakeup_work);
+	hrtimer_init(&rb->wakeup_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	rb->wakeup_timer.function = perf_rb_wakeup_timer;
+
 	/*
 	 * perf_output_begin() only checks rb->paused, therefore
 	 * rb->paused must be true if we have no pages for output.
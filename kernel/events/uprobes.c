@@ -39,6 +39,7 @@
 #include <linux/percpu-rwsem.h>
 #include <linux/task_work.h>
 #include <linux/shmem_fs.h>
+#include <linux/hashtable.h>
 
 #include <linux/uprobes.h>
 
@@ -54,6 +55,19 @@ static struct rb_root uprobes_tree = RB_ROOT;
 
 static DEFINE_SPINLOCK(uprobes_treelock);	/* serialize rbtree access */
 
+/*
+ * Mirror of uprobes_tree for the breakpoint-hit fast path: an RCU
+ * hash keyed on inode:offset, so handle_swbp() doesn't bounce
+ * uprobes_treelock on every hit.  Updated under uprobes_treelock.
+ */
+#define UPROBES_HASH_BITS	10
+static DEFINE_HASHTABLE(uprobes_hashtable, UPROBES_HASH_BITS);
+
+static u64 uprobe_hash_key(struct inode *inode, loff_t offset)
+{
+	return (u64)(unsigned long)inode + offset;
+}
+
 #define UPROBES_HASH_SZ	13
 /* serialize uprobe->pending_list */
 static struct mutex uprobes_mmap_mutex[UPROBES_HASH_SZ];
@@ -66,6 +80,8 @@ static struct percpu_rw_semaphore dup_mmap_sem;
 
 struct uprobe {
 	struct rb_node		rb_node;	/* node in the rb tree */
+	struct hlist_node	hash_node;	/* node in uprobes_hashtable */
+	struct rcu_head		rcu;
 	atomic_t		ref;
 	struct rw_semaphore	register_rwsem;
 	struct rw_semaphore	consumer_rwsem;
@@ -377,8 +393,13 @@ static struct uprobe *get_uprobe(struct uprobe *uprobe)
 
 static void put_uprobe(struct uprobe *uprobe)
 {
+	/*
+	 * The RCU delay keeps the lockless hash walk in find_uprobe()
+	 * safe against a racing delete_uprobe(); such a walker sees
+	 * ref == 0 and skips the node.
+	 */
 	if (atomic_dec_and_test(&uprobe->ref))
-		kfree(uprobe);
+		kfree_rcu(uprobe, rcu);
 }
 
 static int match_uprobe(struct uprobe *l, struct uprobe *r)
@@ -420,18 +441,29 @@ static struct uprobe *__find_uprobe(struct inode *inode, loff_t offset)
 }
 
 /*
- * Find a uprobe corresponding to a given inode:offset
- * Acquires uprobes_treelock
+ * Find a uprobe corresponding to a given inode:offset.
+ *
+ * Lockless: walks uprobes_hashtable under rcu_read_lock() and takes a
+ * reference via atomic_inc_not_zero().  A node whose last reference
+ * is gone is still hashed until delete_uprobe() runs, but fails the
+ * refcount check and is skipped; kfree is RCU-delayed (put_uprobe()).
  */
 static struct uprobe *find_uprobe(struct inode *inode, loff_t offset)
 {
 	struct uprobe *uprobe;
 
-	spin_lock(&uprobes_treelock);
-	uprobe = __find_uprobe(inode, offset);
-	spin_unlock(&uprobes_treelock);
+	rcu_read_lock();
+	hash_for_each_possible_rcu(uprobes_hashtable, uprobe, hash_node,
+				   uprobe_hash_key(inode, offset)) {
+		if (uprobe->inode == inode && uprobe->offset == offset &&
+		    atomic_inc_not_zero(&uprobe->ref)) {
+			rcu_read_unlock();
+			return uprobe;
+		}
+	}
+	rcu_read_unlock();
 
-	return uprobe;
+	return NULL;
 }
 
 static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
@@ -460,6 +492,9 @@ static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 	rb_insert_color(&uprobe->rb_node, &uprobes_tree);
 	/* get access + creation ref */
 	atomic_set(&uprobe->ref, 2);
+	/* publish for lockless lookup only after the refs are set */
+	hash_add_rcu(uprobes_hashtable, &uprobe->hash_node,
+		     uprobe_hash_key(uprobe->inode, uprobe->offset));
 
 	return u;
 }
@@ -699,6 +734,7 @@ static void delete_uprobe(struct uprobe *uprobe)
 
 	spin_lock(&uprobes_treelock);
 	rb_erase(&uprobe->rb_node, &uprobes_tree);
+	hash_del_rcu(&uprobe->hash_node);
 	spin_unlock(&uprobes_treelock);
 	RB_CLEAR_NODE(&uprobe->rb_node); /* for uprobe_is_active() */
 	iput(uprobe->inode);
@@ -788,6 +824,7 @@ build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
 	return curr;
 }
 
+/* Caller holds dup_mmap_sem for writing */
 static int
 register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 {
@@ -795,13 +832,10 @@ register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 	struct map_info *info;
 	int err = 0;
 
-	percpu_down_write(&dup_mmap_sem);
 	info = build_map_info(uprobe->inode->i_mapping,
 					uprobe->offset, is_register);
-	if (IS_ERR(info)) {
-		err = PTR_ERR(info);
-		goto out;
-	}
+	if (IS_ERR(info))
+		return PTR_ERR(info);
 
 	while (info) {
 		struct mm_struct *mm = info->mm;
@@ -837,8 +871,7 @@ register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 		mmput(mm);
 		info = free_map_info(info);
 	}
- out:
-	percpu_up_write(&dup_mmap_sem);
+
 	return err;
 }
 
@@ -861,24 +894,9 @@ static void __uprobe_unregister(struct uprobe *uprobe, struct uprobe_consumer *u
 		delete_uprobe(uprobe);
 }
 
-/*
- * uprobe_register - register a probe
- * @inode: the file in which the probe has to be placed.
- * @offset: offset from the start of the file.
- * @uc: information on howto handle the probe..
- *
- * Apart from the access refcount, uprobe_register() takes a creation
- * refcount (thro alloc_uprobe) if and only if this @uprobe is getting
- * inserted into the rbtree (i.e first consumer for a @inode:@offset
- * tuple).  Creation refcount stops uprobe_unregister from freeing the
- * @uprobe even before the register operation is complete. Creation
- * refcount is released when the last @uc for the @uprobe
- * unregisters.
- *
- * Return errno if it cannot successully install probes
- * else return 0 (success)
- */
-int uprobe_register(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
+/* Caller holds dup_mmap_sem for writing */
+static int __uprobe_register_inode(struct inode *inode, loff_t offset,
+				   struct uprobe_consumer *uc)
 {
 	struct uprobe *uprobe;
 	int ret;
@@ -916,8 +934,88 @@ int uprobe_register(struct inode *inode, loff_t offset, struct uprobe_consumer *
 		goto retry;
 	return ret;
 }
+
+/* Caller holds dup_mmap_sem for writing */
+static void __uprobe_unregister_inode(struct inode *inode, loff_t offset,
+				      struct uprobe_consumer *uc)
+{
+	struct uprobe *uprobe;
+
+	uprobe = find_uprobe(inode, offset);
+	if (WARN_ON(!uprobe))
+		return;
+
+	down_write(&uprobe->register_rwsem);
+	__uprobe_unregister(uprobe, uc);
+	up_write(&uprobe->register_rwsem);
+	put_uprobe(uprobe);
+}
+
+/*
+ * uprobe_register - register a probe
+ * @inode: the file in which the probe has to be placed.
+ * @offset: offset from the start of the file.
+ * @uc: information on howto handle the probe..
+ *
+ * Apart from the access refcount, uprobe_register() takes a creation
+ * refcount (thro alloc_uprobe) if and only if this @uprobe is getting
+ * inserted into the rbtree (i.e first consumer for a @inode:@offset
+ * tuple).  Creation refcount stops uprobe_unregister from freeing the
+ * @uprobe even before the register operation is complete. Creation
+ * refcount is released when the last @uc for the @uprobe
+ * unregisters.
+ *
+ * Return errno if it cannot successully install probes
+ * else return 0 (success)
+ */
+int uprobe_register(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
+{
+	int ret;
+
+	percpu_down_write(&dup_mmap_sem);
+	ret = __uprobe_register_inode(inode, offset, uc);
+	percpu_up_write(&dup_mmap_sem);
+
+	return ret;
+}
 EXPORT_SYMBOL_GPL(uprobe_register);
 
+/*
+ * uprobe_register_batch - register several probes on one file
+ * @inode: the file in which the probes have to be placed.
+ * @cnt: number of entries in @entries.
+ * @entries: offset/consumer pair for each probe.
+ *
+ * Equivalent to calling uprobe_register() for each entry, but the
+ * write side of dup_mmap_sem - by far the most expensive part of a
+ * registration - is taken once for the whole batch instead of once
+ * per probe.  On error, probes already installed by this call are
+ * rolled back, again without dropping dup_mmap_sem in between.
+ */
+int uprobe_register_batch(struct inode *inode, unsigned int cnt,
+			  struct uprobe_batch_entry *entries)
+{
+	unsigned int i;
+	int ret = 0;
+
+	percpu_down_write(&dup_mmap_sem);
+	for (i = 0; i < cnt; i++) {
+		ret = __uprobe_register_inode(inode, entries[i].offset,
+					      entries[i].uc);
+		if (ret)
+			break;
+	}
+	if (ret) {
+		while (i--)
+			__uprobe_unregister_inode(inode, entries[i].offset,
+						  entries[i].uc);
+	}
+	percpu_up_write(&dup_mmap_sem);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(uprobe_register_batch);
+
 /*
  * uprobe_apply - unregister a already registered probe.
  * @inode: the file in which the probe has to be removed.
@@ -936,12 +1034,14 @@ int uprobe_apply(struct inode *inode, loff_t offset,
 	if (WARN_ON(!uprobe))
 		return ret;
 
+	percpu_down_write(&dup_mmap_sem);
 	down_write(&uprobe->register_rwsem);
 	for (con = uprobe->consumers; con && con != uc ; con = con->next)
 		;
 	if (con)
 		ret = register_for_each_vma(uprobe, add ? uc : NULL);
 	up_write(&uprobe->register_rwsem);
+	percpu_up_write(&dup_mmap_sem);
 	put_uprobe(uprobe);
 
 	return ret;
@@ -955,18 +1055,33 @@ int uprobe_apply(struct inode *inode, loff_t offset,
  */
 void uprobe_unregister(struct inode *inode, loff_t offset, struct uprobe_consumer *uc)
 {
-	struct uprobe *uprobe;
+	percpu_down_write(&dup_mmap_sem);
+	__uprobe_unregister_inode(inode, offset, uc);
+	percpu_up_write(&dup_mmap_sem);
+}
+EXPORT_SYMBOL_GPL(uprobe_unregister);
 
-	uprobe = find_uprobe(inode, offset);
-	if (WARN_ON(!uprobe))
-		return;
+/*
+ * uprobe_unregister_batch - unregister several probes on one file
+ * @inode: the file in which the probes have to be removed.
+ * @cnt: number of entries in @entries.
+ * @entries: offset/consumer pair for each probe.
+ *
+ * Counterpart of uprobe_register_batch(); removes all breakpoints
+ * within a single dup_mmap_sem write section.
+ */
+void uprobe_unregister_batch(struct inode *inode, unsigned int cnt,
+			     struct uprobe_batch_entry *entries)
+{
+	unsigned int i;
 
-	down_write(&uprobe->register_rwsem);
-	__uprobe_unregister(uprobe, uc);
-	up_write(&uprobe->register_rwsem);
-	put_uprobe(uprobe);
+	percpu_down_write(&dup_mmap_sem);
+	for (i = 0; i < cnt; i++)
+		__uprobe_unregister_inode(inode, entries[i].offset,
+					  entries[i].uc);
+	percpu_up_write(&dup_mmap_sem);
 }
-EXPORT_SYMBOL_GPL(uprobe_unregister);
+EXPORT_SYMBOL_GPL(uprobe_unregister_batch);
 
 static int unapply_uprobe(struct uprobe *uprobe, struct mm_struct *mm)
 {
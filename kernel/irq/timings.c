@@ -225,6 +225,97 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
 	irqs->next_evt = ts + irqs->avg;
 }
 
+/*
+ * Inject the timestamps accumulated in the circular buffer since the
+ * last flush into the statistical model. Must be called with the local
+ * irq disabled in order to prevent the buffer from being updated while
+ * we are consuming it.
+ */
+static void irq_timings_flush(void)
+{
+	struct irq_timings *irqts = this_cpu_ptr(&irq_timings);
+	struct irqt_stat __percpu *s;
+	u64 ts;
+	int i, irq;
+
+	lockdep_assert_irqs_disabled();
+
+	/*
+	 * Number of elements in the circular buffer: If it happens it
+	 * was flushed before, then the number of elements could be
+	 * smaller than IRQ_TIMINGS_SIZE, so the count is used,
+	 * otherwise the array size is used as we wrapped. The index
+	 * begins from zero when we did not wrap. That could be done
+	 * in a nicer way with the proper circular array structure
+	 * type but with the cost of extra computation in the
+	 * interrupt handler hot path. We choose efficiency.
+	 *
+	 * Inject measured irq/timestamp to the statistical model
+	 * while decrementing the counter because we consume the data
+	 * from our circular buffer.
+	 */
+	for (i = irqts->count & IRQ_TIMINGS_MASK,
+		     irqts->count = min(IRQ_TIMINGS_SIZE, irqts->count);
+	     irqts->count > 0; irqts->count--, i = (i + 1) & IRQ_TIMINGS_MASK) {
+
+		irq = irq_timing_decode(irqts->values[i], &ts);
+
+		s = idr_find(&irqt_stats, irq);
+		if (s)
+			irqs_update(this_cpu_ptr(s), ts);
+	}
+}
+
+/**
+ * irq_timings_next_irq - Predicted occurrence of @irq on this CPU
+ *
+ * @irq: the interrupt number
+ * @now: the current timestamp, in nanoseconds (local_clock() domain)
+ *
+ * Pollers willing to sleep until an interrupt use this to get a per-irq
+ * estimate instead of the CPU-wide earliest event. The prediction is
+ * only handed out when the interrupt's interval pattern is stable and
+ * narrow: the 3 sigma interval must be smaller than the average
+ * interval itself, otherwise sleeping on it is no better than guessing.
+ *
+ * Returns the predicted timestamp of the next occurrence of @irq, @now
+ * when the prediction has already passed, or U64_MAX when there is no
+ * confident prediction.
+ */
+u64 irq_timings_next_irq(unsigned int irq, u64 now)
+{
+	struct irqt_stat __percpu *s;
+	struct irqt_stat *irqs;
+	u64 next_evt = U64_MAX;
+	unsigned long flags;
+	u64 variance;
+
+	if (!static_branch_likely(&irq_timing_enabled))
+		return U64_MAX;
+
+	local_irq_save(flags);
+
+	irq_timings_flush();
+
+	s = idr_find(&irqt_stats, irq);
+	if (!s)
+		goto out;
+
+	irqs = this_cpu_ptr(s);
+	if (!irqs->valid)
+		goto out;
+
+	variance = irqs->variance >> IRQ_TIMINGS_SHIFT;
+	if (9 * variance >= (u64)irqs->avg * irqs->avg)
+		goto out;
+
+	next_evt = max(irqs->next_evt, now);
+out:
+	local_irq_restore(flags);
+
+	return next_evt;
+}
+
 /**
  * irq_timings_next_event - Return when the next event is supposed to arrive
  *
@@ -253,45 +344,12 @@ static void irqs_update(struct irqt_stat *irqs, u64 ts)
  */
 u64 irq_timings_next_event(u64 now)
 {
-	struct irq_timings *irqts = this_cpu_ptr(&irq_timings);
 	struct irqt_stat *irqs;
 	struct irqt_stat __percpu *s;
-	u64 ts, next_evt = U64_MAX;
+	u64 next_evt = U64_MAX;
 	int i, irq = 0;
 
-	/*
-	 * This function must be called with the local irq disabled in
-	 * order to prevent the timings circular buffer to be updated
-	 * while we are reading it.
-	 */
-	lockdep_assert_irqs_disabled();
-
-	/*
-	 * Number of elements in the circular buffer: If it happens it
-	 * was flushed before, then the number of elements could be
-	 * smaller than IRQ_TIMINGS_SIZE, so the count is used,
-	 * otherwise the array size is used as we wrapped. The index
-	 * begins from zero when we did not wrap. That could be done
-	 * in a nicer way with the proper circular array structure
-	 * type but with the cost of extra computation in the
-	 * interrupt handler hot path. We choose efficiency.
-	 *
-	 * Inject measured irq/timestamp to the statistical model
-	 * while decrementing the counter because we consume the data
-	 * from our circular buffer.
-	 */
-	for (i = irqts->count & IRQ_TIMINGS_MASK,
-		     irqts->count = min(IRQ_TIMINGS_SIZE, irqts->count);
-	     irqts->count > 0; irqts->count--, i = (i + 1) & IRQ_TIMINGS_MASK) {
-
-		irq = irq_timing_decode(irqts->values[i], &ts);
-
-		s = idr_find(&irqt_stats, irq);
-		if (s) {
-			irqs = this_cpu_ptr(s);
-			irqs_update(irqs, ts);
-		}
-	}
+	irq_timings_flush();
 
 	/*
 	 * Look in the list of interrupts' statistics, the earliest
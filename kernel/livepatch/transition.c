@@ -29,12 +29,20 @@
 #define MAX_STACK_ENTRIES  100
 #define STACK_ERR_BUF_SIZE 128
 
+/* wake pending kthreads every this many failed transition attempts */
+#define KLP_KTHREAD_WAKE_RETRIES 10
+
 struct klp_patch *klp_transition_patch;
 
 static int klp_target_state = KLP_UNDEFINED;
 
 static bool klp_forced = false;
 
+/* number of tasks not yet in the target patch state, for sysfs */
+unsigned int klp_nr_pending;
+
+static unsigned int klp_transition_retries;
+
 /*
  * This work can be performed periodically to finish patching or unpatching any
  * "straggler" tasks which failed to transition in the first attempt.
@@ -145,6 +153,8 @@ static void klp_complete_transition(void)
 
 	klp_target_state = KLP_UNDEFINED;
 	klp_transition_patch = NULL;
+	klp_nr_pending = 0;
+	klp_transition_retries = 0;
 }
 
 /*
@@ -299,6 +309,7 @@ static bool klp_try_switch_task(struct task_struct *task)
 {
 	struct rq *rq;
 	struct rq_flags flags;
+	unsigned long csw;
 	int ret;
 	bool success = false;
 	char err_buf[STACK_ERR_BUF_SIZE];
@@ -316,6 +327,17 @@ static bool klp_try_switch_task(struct task_struct *task)
 	if (!klp_have_reliable_stack())
 		return false;
 
+	/*
+	 * A task which hasn't been through a context switch since its last
+	 * failed check is either still running or still blocked in exactly
+	 * the same place, so rechecking its stack can't succeed.  This keeps
+	 * the periodic retries from rescanning stacks of stuck tasks over
+	 * and over.
+	 */
+	csw = task->nvcsw + task->nivcsw;
+	if (csw == task->patch_csw)
+		return false;
+
 	/*
 	 * Now try to check the stack for any to-be-patched or to-be-unpatched
 	 * functions.  If all goes well, switch the task to the target patch
@@ -340,6 +362,8 @@ static bool klp_try_switch_task(struct task_struct *task)
 	task->patch_state = klp_target_state;
 
 done:
+	if (!success)
+		task->patch_csw = csw;
 	task_rq_unlock(rq, task, &flags);
 
 	/*
@@ -354,6 +378,26 @@ done:
 
 }
 
+/*
+ * Wake up kthreads in transition which sleep interruptibly in their main
+ * loops.  Cycling through the loop takes them through a context switch at
+ * a different place, giving the next stack check a chance to switch them
+ * without the fake-signal disturbance that klp_send_signals() inflicts on
+ * user tasks.
+ */
+static void klp_wake_pending_kthreads(void)
+{
+	struct task_struct *g, *task;
+
+	pr_debug("waking remaining kthreads in transition\n");
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, task)
+		if (klp_patch_pending(task) && (task->flags & PF_KTHREAD))
+			wake_up_state(task, TASK_INTERRUPTIBLE);
+	read_unlock(&tasklist_lock);
+}
+
 /*
  * Try to switch all remaining tasks to the target patch state by walking the
  * stacks of sleeping tasks and looking for any to-be-patched or
@@ -366,7 +410,7 @@ void klp_try_complete_transition(void)
 {
 	unsigned int cpu;
 	struct task_struct *g, *task;
-	bool complete = true;
+	unsigned int nr_pending = 0;
 
 	WARN_ON_ONCE(klp_target_state == KLP_UNDEFINED);
 
@@ -382,7 +426,7 @@ void klp_try_complete_transition(void)
 	read_lock(&tasklist_lock);
 	for_each_process_thread(g, task)
 		if (!klp_try_switch_task(task))
-			complete = false;
+			nr_pending++;
 	read_unlock(&tasklist_lock);
 
 	/*
@@ -393,7 +437,7 @@ void klp_try_complete_transition(void)
 		task = idle_task(cpu);
 		if (cpu_online(cpu)) {
 			if (!klp_try_switch_task(task))
-				complete = false;
+				nr_pending++;
 		} else if (task->patch_state != klp_target_state) {
 			/* offline idle tasks can be switched immediately */
 			clear_tsk_thread_flag(task, TIF_PATCH_PENDING);
@@ -402,7 +446,16 @@ void klp_try_complete_transition(void)
 	}
 	put_online_cpus();
 
-	if (!complete) {
+	klp_nr_pending = nr_pending;
+
+	if (nr_pending) {
+		/*
+		 * Kthreads never leave the kernel, so every once in a while
+		 * give the stuck ones a nudge through their main loops.
+		 */
+		if (++klp_transition_retries % KLP_KTHREAD_WAKE_RETRIES == 0)
+			klp_wake_pending_kthreads();
+
 		/*
 		 * Some tasks weren't able to be switched over.  Try again
 		 * later and/or wait for other methods like kernel exit
@@ -489,6 +542,7 @@ void klp_init_transition(struct klp_patch *patch, int state)
 	for_each_process_thread(g, task) {
 		WARN_ON_ONCE(task->patch_state != KLP_UNDEFINED);
 		task->patch_state = initial_state;
+		task->patch_csw = ULONG_MAX;
 	}
 	read_unlock(&tasklist_lock);
 
@@ -499,6 +553,7 @@ void klp_init_transition(struct klp_patch *patch, int state)
 		task = idle_task(cpu);
 		WARN_ON_ONCE(task->patch_state != KLP_UNDEFINED);
 		task->patch_state = initial_state;
+		task->patch_csw = ULONG_MAX;
 	}
 
 	/*
@@ -571,6 +626,7 @@ void klp_reverse_transition(void)
 void klp_copy_process(struct task_struct *child)
 {
 	child->patch_state = current->patch_state;
+	child->patch_csw = ULONG_MAX;
 
 	/* TIF_PATCH_PENDING gets copied in setup_thread_stack() */
 }
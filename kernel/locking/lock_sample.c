@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Lightweight lock contention sampler.
+ *
+ * Records every rate-th contended lock acquisition per CPU into a small
+ * per-CPU ring of (lock address, caller, wait time) triples, fed from
+ * the qspinlock, mutex and rwsem slowpaths. Each sample also fires the
+ * lock_contention_sample tracepoint; the most recent samples can be read
+ * from /proc/lock_contention.
+ *
+ * Sampling is off by default (lock_sample.rate == 0), in which case the
+ * only cost left in the slowpaths is one per-CPU load and branch.
+ */
+#include <linux/lock_sample.h>
+#include <linux/moduleparam.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/lock.h>
+
+/*
+ * Sample one out of every @rate contended acquisitions on each CPU;
+ * 0 disables sampling altogether.
+ */
+static unsigned int rate;
+module_param(rate, uint, 0644);
+
+#define LOCK_SAMPLE_RING_SIZE	64
+
+struct lock_sample {
+	void		*lock;
+	unsigned long	ip;
+	u64		wait_ns;
+};
+
+struct lock_sample_ring {
+	struct lock_sample	ent[LOCK_SAMPLE_RING_SIZE];
+	unsigned int		head;
+	unsigned int		skipped;
+};
+
+static DEFINE_PER_CPU(struct lock_sample_ring, lock_sample_rings);
+
+u64 lock_contention_sample_start(void)
+{
+	unsigned int r = READ_ONCE(rate);
+
+	if (likely(!r))
+		return 0;
+	if (__this_cpu_inc_return(lock_sample_rings.skipped) < r)
+		return 0;
+	__this_cpu_write(lock_sample_rings.skipped, 0);
+
+	/*
+	 * Force the bottom bit so that a zero clock reading cannot be
+	 * mistaken for "not sampled".
+	 */
+	return local_clock() | 1;
+}
+
+void lock_contention_sample_end(void *lock, u64 start, unsigned long ip)
+{
+	struct lock_sample_ring *ring;
+	struct lock_sample *s;
+	unsigned long flags;
+	u64 wait_ns;
+
+	if (likely(!start))
+		return;
+	wait_ns = local_clock() - start;
+
+	trace_lock_contention_sample(lock, ip, wait_ns);
+
+	/*
+	 * The ring is only ever written by its own CPU; disabling
+	 * interrupts keeps nested slowpaths from interleaving updates.
+	 */
+	local_irq_save(flags);
+	ring = this_cpu_ptr(&lock_sample_rings);
+	s = &ring->ent[ring->head++ % LOCK_SAMPLE_RING_SIZE];
+	s->lock = lock;
+	s->ip = ip;
+	s->wait_ns = wait_ns;
+	local_irq_restore(flags);
+}
+
+static int lock_contention_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	seq_puts(m, "# cpu lock wait_ns caller\n");
+	for_each_online_cpu(cpu) {
+		struct lock_sample_ring *ring = &per_cpu(lock_sample_rings,
+							 cpu);
+
+		for (i = 0; i < LOCK_SAMPLE_RING_SIZE; i++) {
+			struct lock_sample *s = &ring->ent[i];
+
+			if (!s->lock)
+				continue;
+			seq_printf(m, "cpu%d %px %llu %pS\n",
+				   cpu, s->lock, s->wait_ns, (void *)s->ip);
+		}
+	}
+	return 0;
+}
+
+static int lock_contention_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, lock_contention_show, NULL);
+}
+
+static const struct file_operations lock_contention_fops = {
+	.open		= lock_contention_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_lock_contention_procfs(void)
+{
+	proc_create("lock_contention", 0400, NULL, &lock_contention_fops);
+	return 0;
+}
+__initcall(init_lock_contention_procfs);
@@ -55,7 +55,7 @@
 
 #include "lockdep_internals.h"
 
-#define CREATE_TRACE_POINTS
+/* The lock tracepoints are created in lock_sample.c. */
 #include <trace/events/lock.h>
 
 #ifdef CONFIG_PROVE_LOCKING
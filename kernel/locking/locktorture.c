@@ -39,6 +39,7 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/percpu-rwsem.h>
+#include <linux/topology.h>
 #include <linux/torture.h>
 
 MODULE_LICENSE("GPL");
@@ -72,6 +73,16 @@ static struct task_struct **reader_tasks;
 static bool lock_is_write_held;
 static bool lock_is_read_held;
 
+/*
+ * NUMA node of the previous write-lock holder plus handover counts,
+ * only ever updated under the write lock. Quantifies how often a
+ * contended lock's ownership migrates across nodes, which is what
+ * NUMA-aware handover schemes try to minimize.
+ */
+static int lock_last_node = NUMA_NO_NODE;
+static long n_lock_handovers;
+static long n_lock_cross_node;
+
 struct lock_stress_stats {
 	long n_lock_fail;
 	long n_lock_acquired;
@@ -635,6 +646,8 @@ static int lock_torture_writer(void *arg)
 	set_user_nice(current, MAX_NICE);
 
 	do {
+		int node;
+
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
@@ -647,6 +660,13 @@ static int lock_torture_writer(void *arg)
 			lwsp->n_lock_fail++; /* rare, but... */
 
 		lwsp->n_lock_acquired++;
+		node = numa_node_id();
+		if (lock_last_node != NUMA_NO_NODE) {
+			n_lock_handovers++;
+			if (node != lock_last_node)
+				n_lock_cross_node++;
+		}
+		lock_last_node = node;
 		cxt.cur_ops->write_delay(&rand);
 		lock_is_write_held = 0;
 		cxt.cur_ops->writeunlock();
@@ -717,6 +737,10 @@ static void __torture_print_stats(char *page,
 			write ? "Writes" : "Reads ",
 			sum, max, min, max / 2 > min ? "???" : "",
 			fail, fail ? "!!!" : "");
+	if (write)
+		page += sprintf(page,
+				"Cross-node handovers: %ld/%ld\n",
+				n_lock_cross_node, n_lock_handovers);
 	if (fail)
 		atomic_inc(&cxt.n_lock_torture_errors);
 }
@@ -18,6 +18,7 @@
  * Also see Documentation/locking/mutex-design.txt.
  */
 #include <linux/mutex.h>
+#include <linux/lock_sample.h>
 #include <linux/ww_mutex.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/rt.h>
@@ -28,6 +29,11 @@
 #include <linux/interrupt.h>
 #include <linux/debug_locks.h>
 #include <linux/osq_lock.h>
+#include <linux/hash.h>
+#include <linux/moduleparam.h>
+#include <linux/proc_fs.h>
+#include <linux/sched/clock.h>
+#include <linux/seq_file.h>
 
 #ifdef CONFIG_DEBUG_MUTEXES
 # include "mutex-debug.h"
@@ -372,6 +378,134 @@ ww_mutex_set_context_slowpath(struct ww_mutex *lock, struct ww_acquire_ctx *ctx)
 
 #ifdef CONFIG_MUTEX_SPIN_ON_OWNER
 
+/*
+ * Spin-wait deadline steering.
+ *
+ * Spinning only pays off while the expected remaining hold time is
+ * shorter than a schedule() round trip; on mutexes that are typically
+ * held for long stretches the spinners just burn cycles. Track an EWMA
+ * of the observed spin-wait time per mutex and convert spinning into
+ * sleeping whenever it exceeds the spin_deadline_ns tunable (0, the
+ * default, disables the heuristic and keeps the historic behaviour).
+ *
+ * The state is kept in a fixed hash table keyed by mutex address, so
+ * struct mutex does not grow; hash collisions merely merge statistics,
+ * which only perturbs the heuristic. All updates are racy by design.
+ */
+#define MUTEX_SPIN_STATS_BITS	8
+#define MUTEX_SPIN_STATS_SIZE	(1 << MUTEX_SPIN_STATS_BITS)
+
+struct mutex_spin_stat {
+	struct mutex	*lock;		/* last mutex hashed here */
+	u64		ewma_wait_ns;	/* expected spin-wait time */
+	unsigned long	spins;		/* spin attempts */
+	unsigned long	skips;		/* spins converted to sleeps */
+	unsigned long	aborts;		/* spins abandoned mid-way */
+};
+
+static struct mutex_spin_stat mutex_spin_stats[MUTEX_SPIN_STATS_SIZE];
+
+/*
+ * Expected spin-wait, in nanoseconds, above which sleeping is cheaper
+ * than spinning; roughly the cost of a schedule() round trip.
+ */
+static unsigned long spin_deadline_ns;
+module_param(spin_deadline_ns, ulong, 0644);
+
+static struct mutex_spin_stat *mutex_to_spin_stat(struct mutex *lock)
+{
+	return &mutex_spin_stats[hash_ptr(lock, MUTEX_SPIN_STATS_BITS)];
+}
+
+static void mutex_spin_ewma_update(struct mutex_spin_stat *ms, u64 wait_ns)
+{
+	u64 ewma = READ_ONCE(ms->ewma_wait_ns);
+
+	WRITE_ONCE(ms->ewma_wait_ns, ewma - (ewma >> 3) + (wait_ns >> 3));
+}
+
+/*
+ * Returns 0 if the expected wait already exceeds the deadline and the
+ * caller should sleep instead, otherwise a timestamp cookie to pass to
+ * mutex_spin_finish(). Skips slowly decay the EWMA so that a mutex
+ * whose hold times improve is re-probed eventually.
+ */
+static u64 mutex_spin_begin(struct mutex_spin_stat *ms, struct mutex *lock)
+{
+	u64 deadline = READ_ONCE(spin_deadline_ns);
+	u64 ewma;
+
+	if (likely(!deadline))
+		return 1;
+
+	WRITE_ONCE(ms->lock, lock);
+	ewma = READ_ONCE(ms->ewma_wait_ns);
+	if (ewma > deadline) {
+		ms->skips++;
+		WRITE_ONCE(ms->ewma_wait_ns, ewma - (ewma >> 6));
+		return 0;
+	}
+	ms->spins++;
+	return local_clock() | 1;
+}
+
+/*
+ * An abandoned spin means the owner held on longer than we were
+ * willing to wait; feed a penalty sample on top of the time already
+ * burnt so that repeated failures push the mutex over the deadline.
+ */
+static void mutex_spin_finish(struct mutex_spin_stat *ms, u64 start,
+			      bool acquired)
+{
+	u64 wait_ns;
+
+	if (!READ_ONCE(spin_deadline_ns) || start <= 1)
+		return;
+
+	wait_ns = local_clock() - start;
+	if (!acquired) {
+		ms->aborts++;
+		wait_ns += READ_ONCE(spin_deadline_ns);
+	}
+	mutex_spin_ewma_update(ms, wait_ns);
+}
+
+static int mutex_spin_stats_show(struct seq_file *m, void *v)
+{
+	int i;
+
+	seq_puts(m, "# lock ewma_ns spins skips aborts\n");
+	for (i = 0; i < MUTEX_SPIN_STATS_SIZE; i++) {
+		struct mutex_spin_stat *ms = &mutex_spin_stats[i];
+
+		if (!ms->spins && !ms->skips)
+			continue;
+		seq_printf(m, "%px %llu %lu %lu %lu\n",
+			   ms->lock, ms->ewma_wait_ns,
+			   ms->spins, ms->skips, ms->aborts);
+	}
+	return 0;
+}
+
+static int mutex_spin_stats_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, mutex_spin_stats_show, NULL);
+}
+
+static const struct file_operations mutex_spin_stats_fops = {
+	.open		= mutex_spin_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_mutex_spin_stats_procfs(void)
+{
+	proc_create("mutex_spin_stats", 0400, NULL, &mutex_spin_stats_fops);
+	return 0;
+}
+__initcall(init_mutex_spin_stats_procfs);
+
 static inline
 bool ww_mutex_spin_on_owner(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 			    struct mutex_waiter *waiter)
@@ -512,6 +646,13 @@ static __always_inline bool
 mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 		      const bool use_ww_ctx, struct mutex_waiter *waiter)
 {
+	struct mutex_spin_stat *ms = mutex_to_spin_stat(lock);
+	u64 start;
+
+	start = mutex_spin_begin(ms, lock);
+	if (!start)
+		goto fail;
+
 	if (!waiter) {
 		/*
 		 * The purpose of the mutex_can_spin_on_owner() function is
@@ -559,6 +700,7 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 	if (!waiter)
 		osq_unlock(&lock->osq);
 
+	mutex_spin_finish(ms, start, true);
 	return true;
 
 
@@ -566,6 +708,8 @@ fail_unlock:
 	if (!waiter)
 		osq_unlock(&lock->osq);
 
+	mutex_spin_finish(ms, start, false);
+
 fail:
 	/*
 	 * If we fell out of the spin path because of need_resched(),
@@ -742,6 +886,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	struct mutex_waiter waiter;
 	bool first = false;
 	struct ww_mutex *ww;
+	u64 lc = 0;
 	int ret;
 
 	might_sleep();
@@ -780,6 +925,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	debug_mutex_add_waiter(lock, &waiter, current);
 
 	lock_contended(&lock->dep_map, ip);
+	lc = lock_contention_sample_start();
 
 	if (!use_ww_ctx) {
 		/* add waiting tasks to the end of the waitqueue (FIFO): */
@@ -857,6 +1003,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 	spin_lock(&lock->wait_lock);
 acquired:
 	__set_current_state(TASK_RUNNING);
+	lock_contention_sample_end(lock, lc, ip);
 
 	mutex_remove_waiter(lock, &waiter, current);
 	if (likely(list_empty(&lock->wait_list)))
@@ -19,10 +19,27 @@ int __percpu_init_rwsem(struct percpu_rw_semaphore *sem,
 	__init_rwsem(&sem->rw_sem, name, rwsem_key);
 	rcuwait_init(&sem->writer);
 	sem->readers_block = 0;
+	sem->fast_writer = 0;
 	return 0;
 }
 EXPORT_SYMBOL_GPL(__percpu_init_rwsem);
 
+int __percpu_init_rwsem_fast_writer(struct percpu_rw_semaphore *sem,
+			const char *name, struct lock_class_key *rwsem_key)
+{
+	int ret = __percpu_init_rwsem(sem, name, rwsem_key);
+
+	/*
+	 * Keep the readers on the __percpu_down_read() protocol
+	 * permanently so that writers need not go through rcu_sync;
+	 * see percpu_rwsem_readers_fast().
+	 */
+	if (!ret)
+		sem->fast_writer = 1;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(__percpu_init_rwsem_fast_writer);
+
 void percpu_free_rwsem(struct percpu_rw_semaphore *sem)
 {
 	/*
@@ -139,8 +156,14 @@ static bool readers_active_check(struct percpu_rw_semaphore *sem)
 
 void percpu_down_write(struct percpu_rw_semaphore *sem)
 {
-	/* Notify readers to take the slow path. */
-	rcu_sync_enter(&sem->rss);
+	/*
+	 * Notify readers to take the slow path. Fast-writer semaphores
+	 * keep their readers there permanently, so the grace periods
+	 * implied by rcu_sync_enter() are not needed and writer latency
+	 * is bounded by the readers' critical sections.
+	 */
+	if (!sem->fast_writer)
+		rcu_sync_enter(&sem->rss);
 
 	down_write(&sem->rw_sem);
 
@@ -187,6 +210,7 @@ void percpu_up_write(struct percpu_rw_semaphore *sem)
 	 * reader fast path will be available again. Safe to use outside the
 	 * exclusive write lock because its counting.
 	 */
-	rcu_sync_exit(&sem->rss);
+	if (!sem->fast_writer)
+		rcu_sync_exit(&sem->rss);
 }
 EXPORT_SYMBOL_GPL(percpu_up_write);
@@ -27,8 +27,12 @@
 #include <linux/cpumask.h>
 #include <linux/percpu.h>
 #include <linux/hardirq.h>
+#include <linux/jump_label.h>
+#include <linux/lock_sample.h>
+#include <linux/moduleparam.h>
 #include <linux/mutex.h>
 #include <linux/prefetch.h>
+#include <linux/topology.h>
 #include <asm/byteorder.h>
 #include <asm/qspinlock.h>
 
@@ -70,21 +74,29 @@
 
 #include "mcs_spinlock.h"
 
-#ifdef CONFIG_PARAVIRT_SPINLOCKS
-#define MAX_NODES	8
-#else
 #define MAX_NODES	4
+
+/*
+ * On 64-bit architectures, the mcs_spinlock structure will be 16 bytes in
+ * size and four of them will fit nicely in one 64-byte cacheline. For
+ * pv_node and cna_node, however, we need more space for extra data. To
+ * accommodate that, we reserve 16 more bytes, padding it up to 32 bytes.
+ * IOW, a 64-byte cacheline will contain two queue nodes in these cases.
+ */
+struct qnode {
+	struct mcs_spinlock mcs;
+#if defined(CONFIG_PARAVIRT_SPINLOCKS) || defined(CONFIG_NUMA)
+	u32 reserved[4];
 #endif
+};
 
 /*
  * Per-CPU queue node structures; we can never have more than 4 nested
  * contexts: task, softirq, hardirq, nmi.
  *
- * Exactly fits one 64-byte cacheline on a 64-bit architecture.
- *
- * PV doubles the storage and uses the second cacheline for PV state.
+ * PV and the NUMA-aware mode use the reserved space for their own state.
  */
-static DEFINE_PER_CPU_ALIGNED(struct mcs_spinlock, mcs_nodes[MAX_NODES]);
+static DEFINE_PER_CPU_ALIGNED(struct qnode, qnodes[MAX_NODES]);
 
 /*
  * We must be able to distinguish between no-tail and the tail at 0:0,
@@ -109,7 +121,13 @@ static inline __pure struct mcs_spinlock *decode_tail(u32 tail)
 	int cpu = (tail >> _Q_TAIL_CPU_OFFSET) - 1;
 	int idx = (tail &  _Q_TAIL_IDX_MASK) >> _Q_TAIL_IDX_OFFSET;
 
-	return per_cpu_ptr(&mcs_nodes[idx], cpu);
+	return per_cpu_ptr(&qnodes[idx].mcs, cpu);
+}
+
+static inline __pure
+struct mcs_spinlock *grab_mcs_node(struct mcs_spinlock *base, int idx)
+{
+	return &((struct qnode *)base + idx)->mcs;
 }
 
 #define _Q_LOCKED_PENDING_MASK (_Q_LOCKED_MASK | _Q_PENDING_MASK)
@@ -242,6 +260,209 @@ static __always_inline void set_locked(struct qspinlock *lock)
 	WRITE_ONCE(l->locked, _Q_LOCKED_VAL);
 }
 
+#ifdef CONFIG_NUMA
+/*
+ * Compact NUMA-aware (CNA) lock handover.
+ *
+ * On a multi-socket system the strict FIFO order of the MCS queue makes a
+ * contended lock's cacheline migrate across sockets on almost every
+ * handover. When enabled with the "numa_spinlock=on" boot option, the
+ * queue head instead prefers a waiter on its own NUMA node as its
+ * successor and moves the waiters it skipped over to a secondary queue.
+ * To keep the lock starvation free, at most cna_intra_max consecutive
+ * intra-node handovers are allowed before the secondary queue is spliced
+ * back in front of the main queue.
+ *
+ * The extra per-waiter state lives in the reserved space of the queue
+ * node and is handed to the successor before the MCS handover store, so
+ * no additional atomic operations are needed.
+ *
+ * The paravirt slowpath stays strictly FIFO: pv_wait_node() monitors the
+ * predecessor node, which the CNA reordering would pull out from under
+ * it. See the overrides at the bottom of this file.
+ */
+static DEFINE_STATIC_KEY_FALSE(cna_lock_key);
+
+/*
+ * Upper bound on consecutive same-node handovers before fairness is
+ * restored by handing the lock to the secondary queue.
+ */
+static unsigned int cna_intra_max = 256;
+module_param(cna_intra_max, uint, 0644);
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	u16			numa_node;
+	u16			intra_count;	/* consecutive local handovers */
+	u32			encoded_tail;	/* tail code of this node */
+	u32			peer_head;	/* secondary queue of remote */
+	u32			peer_tail;	/*  waiters, as tail codes */
+};
+
+static bool cna_lock_requested __initdata;
+
+static int __init cna_lock_setup(char *str)
+{
+	if (str && !strcmp(str, "on"))
+		cna_lock_requested = true;
+	return 1;
+}
+__setup("numa_spinlock=", cna_lock_setup);
+
+/*
+ * Flipping the static key is safe only while the secondary CPUs have not
+ * been brought up and no queueing can be in flight.
+ */
+static int __init cna_lock_init(void)
+{
+	if (cna_lock_requested && nr_node_ids > 1)
+		static_branch_enable(&cna_lock_key);
+	return 0;
+}
+early_initcall(cna_lock_init);
+
+static void __cna_init_node(struct mcs_spinlock *node, u32 tail)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	if (!static_branch_unlikely(&cna_lock_key))
+		return;
+
+	cn->numa_node = numa_node_id();
+	cn->intra_count = 0;
+	cn->encoded_tail = tail;
+	cn->peer_head = 0;
+	cn->peer_tail = 0;
+}
+
+/*
+ * Move the chain [head, tail] of remote waiters from the main queue to
+ * @cn's secondary queue. The stale ->next of the old secondary tail is
+ * always rewritten before the secondary queue is walked again.
+ */
+static void __cna_stash_peers(struct cna_node *cn, struct cna_node *head,
+			      struct cna_node *tail)
+{
+	if (!cn->peer_head)
+		cn->peer_head = head->encoded_tail;
+	else
+		decode_tail(cn->peer_tail)->next = &head->mcs;
+	cn->peer_tail = tail->encoded_tail;
+}
+
+/*
+ * Choose the next queue head. Called by the current head once it holds
+ * the lock, with @next pointing to its immediate successor. All stores
+ * to the chosen successor's node are ordered before the handover by the
+ * release in arch_mcs_spin_unlock_contended().
+ */
+static struct mcs_spinlock *__cna_select_next(struct mcs_spinlock *node,
+					      struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	struct cna_node *cni, *last = NULL, *found = NULL;
+
+	if (!static_branch_unlikely(&cna_lock_key))
+		return next;
+
+	/*
+	 * Scan the main queue for a waiter on this NUMA node, unless the
+	 * intra-node handover budget is exhausted. The scan races with
+	 * enqueues and may miss a just-arrived local waiter; that is
+	 * harmless, it will be found on a later handover.
+	 */
+	if (cn->intra_count < cna_intra_max) {
+		for (cni = (struct cna_node *)next; cni;
+		     cni = (struct cna_node *)READ_ONCE(cni->mcs.next)) {
+			if (cni->numa_node == cn->numa_node) {
+				found = cni;
+				break;
+			}
+			last = cni;
+		}
+	}
+
+	if (found) {
+		if (found != (struct cna_node *)next)
+			__cna_stash_peers(cn, (struct cna_node *)next, last);
+		found->peer_head = cn->peer_head;
+		found->peer_tail = cn->peer_tail;
+		found->intra_count = cn->intra_count + 1;
+		return &found->mcs;
+	}
+
+	/*
+	 * No local waiter, or the budget is used up: splice the secondary
+	 * queue back in front of the main queue and hand over to its
+	 * head. The new head starts with a zeroed intra-node count.
+	 */
+	if (cn->peer_head) {
+		struct mcs_spinlock *head = decode_tail(cn->peer_head);
+
+		WRITE_ONCE(decode_tail(cn->peer_tail)->next, next);
+		return head;
+	}
+
+	return next;
+}
+
+/*
+ * The queue head is about to claim an uncontended lock (it is also the
+ * queue tail) but still holds a secondary queue, which must not be
+ * abandoned: make it the new main queue and promote its head instead of
+ * clearing the tail code. Returns true if the lock was taken and the
+ * handover performed.
+ */
+static bool __cna_pass_secondary(struct qspinlock *lock,
+				 struct mcs_spinlock *node, u32 val)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	struct mcs_spinlock *head, *ptail;
+
+	if (!static_branch_unlikely(&cna_lock_key) || !cn->peer_head)
+		return false;
+
+	head = decode_tail(cn->peer_head);
+	ptail = decode_tail(cn->peer_tail);
+
+	/*
+	 * The secondary tail becomes the queue tail; clear its stale
+	 * ->next. The release cmpxchg orders this store before the new
+	 * tail code can be observed by an enqueuer.
+	 */
+	WRITE_ONCE(ptail->next, NULL);
+
+	if (atomic_cmpxchg_release(&lock->val, val,
+				   cn->peer_tail | _Q_LOCKED_VAL) != val)
+		return false;
+
+	arch_mcs_spin_unlock_contended(&head->locked);
+	return true;
+}
+
+#else /* CONFIG_NUMA */
+
+static __always_inline void __cna_init_node(struct mcs_spinlock *node,
+					    u32 tail) { }
+static __always_inline struct mcs_spinlock *
+__cna_select_next(struct mcs_spinlock *node, struct mcs_spinlock *next)
+{
+	return next;
+}
+static __always_inline bool __cna_pass_secondary(struct qspinlock *lock,
+						 struct mcs_spinlock *node,
+						 u32 val)
+{
+	return false;
+}
+
+#endif /* CONFIG_NUMA */
+
+#define cna_init_node		__cna_init_node
+#define cna_select_next		__cna_select_next
+#define cna_pass_secondary	__cna_pass_secondary
 
 /*
  * Generate the native code for queued_spin_unlock_slowpath(); provide NOPs for
@@ -295,6 +516,7 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 {
 	struct mcs_spinlock *prev, *next, *node;
 	u32 new, old, tail;
+	u64 lc;
 	int idx;
 
 	BUILD_BUG_ON(CONFIG_NR_CPUS >= (1U << _Q_TAIL_CPU_BITS));
@@ -374,11 +596,12 @@ void queued_spin_lock_slowpath(struct qspinlock *lock, u32 val)
 	 * queuing.
 	 */
 queue:
-	node = this_cpu_ptr(&mcs_nodes[0]);
+	lc = lock_contention_sample_start();
+	node = this_cpu_ptr(&qnodes[0].mcs);
 	idx = node->count++;
 	tail = encode_tail(smp_processor_id(), idx);
 
-	node += idx;
+	node = grab_mcs_node(node, idx);
 
 	/*
 	 * Ensure that we increment the head node->count before initialising
@@ -389,6 +612,7 @@ queue:
 
 	node->locked = 0;
 	node->next = NULL;
+	cna_init_node(node, tail);
 	pv_init_node(node);
 
 	/*
@@ -483,6 +707,12 @@ locked:
 			set_locked(lock);
 			break;
 		}
+		/*
+		 * A pending secondary queue must not be abandoned; pass
+		 * the queue-head role to it along with the tail code.
+		 */
+		if (cna_pass_secondary(lock, node, val))
+			goto release;
 		/*
 		 * The smp_cond_load_acquire() call above has provided the
 		 * necessary acquire semantics required for locking. At most
@@ -503,14 +733,17 @@ locked:
 			cpu_relax();
 	}
 
+	next = cna_select_next(node, next);
 	arch_mcs_spin_unlock_contended(&next->locked);
 	pv_kick_node(lock, next);
 
 release:
+	lock_contention_sample_end(lock, lc, _RET_IP_);
+
 	/*
 	 * release the node
 	 */
-	__this_cpu_dec(mcs_nodes[0].count);
+	__this_cpu_dec(qnodes[0].mcs.count);
 }
 EXPORT_SYMBOL(queued_spin_lock_slowpath);
 
@@ -523,6 +756,18 @@ EXPORT_SYMBOL(queued_spin_lock_slowpath);
 #undef  pv_enabled
 #define pv_enabled()	true
 
+/*
+ * The NUMA-aware handover reorders waiters behind the back of
+ * pv_wait_node(), which monitors its predecessor node; keep the
+ * paravirt slowpath strictly FIFO.
+ */
+#undef  cna_init_node
+#undef  cna_select_next
+#undef  cna_pass_secondary
+#define cna_init_node(node, tail)		do { } while (0)
+#define cna_select_next(node, next)		(next)
+#define cna_pass_secondary(lock, node, val)	false
+
 #undef pv_init_node
 #undef pv_wait_node
 #undef pv_kick_node
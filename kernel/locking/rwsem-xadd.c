@@ -13,6 +13,7 @@
 #include <linux/rwsem.h>
 #include <linux/init.h>
 #include <linux/export.h>
+#include <linux/lock_sample.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/rt.h>
 #include <linux/sched/wake_q.h>
@@ -227,6 +228,7 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 {
 	long count, adjustment = -RWSEM_ACTIVE_READ_BIAS;
 	struct rwsem_waiter waiter;
+	u64 lc = lock_contention_sample_start();
 	DEFINE_WAKE_Q(wake_q);
 
 	waiter.task = current;
@@ -270,6 +272,7 @@ __rwsem_down_read_failed_common(struct rw_semaphore *sem, int state)
 	}
 
 	__set_current_state(TASK_RUNNING);
+	lock_contention_sample_end(sem, lc, _RET_IP_);
 	return sem;
 out_nolock:
 	list_del(&waiter.list);
@@ -497,6 +500,7 @@ __rwsem_down_write_failed_common(struct rw_semaphore *sem, int state)
 	long count;
 	bool waiting = true; /* any queued threads before us */
 	struct rwsem_waiter waiter;
+	u64 lc = lock_contention_sample_start();
 	struct rw_semaphore *ret = sem;
 	DEFINE_WAKE_Q(wake_q);
 
@@ -572,6 +576,7 @@ __rwsem_down_write_failed_common(struct rw_semaphore *sem, int state)
 	__set_current_state(TASK_RUNNING);
 	list_del(&waiter.list);
 	raw_spin_unlock_irq(&sem->wait_lock);
+	lock_contention_sample_end(sem, lc, _RET_IP_);
 
 	return ret;
 
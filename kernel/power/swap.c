@@ -517,8 +517,12 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
-/* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+/*
+ * Maximum number of threads for compression/decompression.  Each thread
+ * costs about 70 pages of buffers, which bounds the memory footprint of
+ * raising this.
+ */
+#define LZO_THREADS	8
 
 /* Minimum/maximum number of pages for read buffering. */
 #define LZO_MIN_RD_PAGES	1024
@@ -580,6 +584,7 @@ struct crc_data {
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	unsigned run_threads;                     /* nr current threads */
+	unsigned run_first;                       /* first thread to handle */
 	wait_queue_head_t go;                     /* start crc update */
 	wait_queue_head_t done;                   /* crc update done */
 	u32 *crc32;                               /* points to handle's crc32 */
@@ -593,7 +598,7 @@ struct crc_data {
 static int crc32_threadfn(void *data)
 {
 	struct crc_data *d = data;
-	unsigned i;
+	unsigned i, t;
 
 	while (1) {
 		wait_event(d->go, atomic_read(&d->ready) ||
@@ -606,9 +611,11 @@ static int crc32_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		for (i = 0; i < d->run_threads; i++)
+		for (i = 0; i < d->run_threads; i++) {
+			t = d->run_first + i;
 			*d->crc32 = crc32_le(*d->crc32,
-			                     d->unc[i], *d->unc_len[i]);
+			                     d->unc[t], *d->unc_len[t]);
+		}
 		atomic_set(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -677,6 +684,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	ktime_t start;
 	ktime_t stop;
 	size_t off;
+	u64 cmp_bytes;
 	unsigned thr, run_threads, nr_threads;
 	unsigned char *page = NULL;
 	struct cmp_data *data = NULL;
@@ -767,9 +775,23 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	if (!m)
 		m = 1;
 	nr_pages = 0;
+	cmp_bytes = 0;
 	start = ktime_get();
+
+	/*
+	 * Software pipeline of depth nr_threads: while a batch is being
+	 * compressed, the main thread retires the oldest in-flight batch,
+	 * submits its pages and refills the freed buffer, instead of
+	 * filling, compressing and draining the whole thread group in
+	 * lockstep.  @thr is the oldest busy thread, batches complete and
+	 * are written out in dispatch order.
+	 */
+	thr = 0;
+	run_threads = 0;
 	for (;;) {
-		for (thr = 0; thr < nr_threads; thr++) {
+		while (run_threads < nr_threads) {
+			unsigned fill = (thr + run_threads) % nr_threads;
+
 			for (off = 0; off < LZO_UNC_SIZE; off += PAGE_SIZE) {
 				ret = snapshot_read_next(snapshot);
 				if (ret < 0)
@@ -778,7 +800,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 				if (!ret)
 					break;
 
-				memcpy(data[thr].unc + off,
+				memcpy(data[fill].unc + off,
 				       data_of(*snapshot), PAGE_SIZE);
 
 				if (!(nr_pages % m))
@@ -789,62 +811,74 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			if (!off)
 				break;
 
-			data[thr].unc_len = off;
+			data[fill].unc_len = off;
 
-			atomic_set(&data[thr].ready, 1);
-			wake_up(&data[thr].go);
+			atomic_set(&data[fill].ready, 1);
+			wake_up(&data[fill].go);
+			run_threads++;
 		}
 
-		if (!thr)
+		if (!run_threads)
 			break;
 
-		crc->run_threads = thr;
-		atomic_set(&crc->ready, 1);
-		wake_up(&crc->go);
+		/* retire the oldest batch */
+		wait_event(data[thr].done,
+		           atomic_read(&data[thr].stop));
+		atomic_set(&data[thr].stop, 0);
 
-		for (run_threads = thr, thr = 0; thr < run_threads; thr++) {
-			wait_event(data[thr].done,
-			           atomic_read(&data[thr].stop));
-			atomic_set(&data[thr].stop, 0);
+		ret = data[thr].ret;
 
-			ret = data[thr].ret;
+		if (ret < 0) {
+			pr_err("LZO compression failed\n");
+			goto out_finish;
+		}
 
-			if (ret < 0) {
-				pr_err("LZO compression failed\n");
-				goto out_finish;
-			}
+		if (unlikely(!data[thr].cmp_len ||
+		             data[thr].cmp_len >
+		             lzo1x_worst_compress(data[thr].unc_len))) {
+			pr_err("Invalid LZO compressed length\n");
+			ret = -1;
+			goto out_finish;
+		}
 
-			if (unlikely(!data[thr].cmp_len ||
-			             data[thr].cmp_len >
-			             lzo1x_worst_compress(data[thr].unc_len))) {
-				pr_err("Invalid LZO compressed length\n");
-				ret = -1;
-				goto out_finish;
-			}
+		/*
+		 * The CRC runs in stream order, which is the order batches
+		 * are retired in.  It works on the uncompressed buffer
+		 * concurrently with the page submission below; the wait
+		 * before the buffer is refilled is at the end of this
+		 * iteration.
+		 */
+		crc->run_first = thr;
+		crc->run_threads = 1;
+		atomic_set(&crc->ready, 1);
+		wake_up(&crc->go);
 
-			*(size_t *)data[thr].cmp = data[thr].cmp_len;
+		*(size_t *)data[thr].cmp = data[thr].cmp_len;
+		cmp_bytes += LZO_HEADER + data[thr].cmp_len;
 
-			/*
-			 * Given we are writing one page at a time to disk, we
-			 * copy that much from the buffer, although the last
-			 * bit will likely be smaller than full page. This is
-			 * OK - we saved the length of the compressed data, so
-			 * any garbage at the end will be discarded when we
-			 * read it.
-			 */
-			for (off = 0;
-			     off < LZO_HEADER + data[thr].cmp_len;
-			     off += PAGE_SIZE) {
-				memcpy(page, data[thr].cmp + off, PAGE_SIZE);
+		/*
+		 * Given we are writing one page at a time to disk, we
+		 * copy that much from the buffer, although the last
+		 * bit will likely be smaller than full page. This is
+		 * OK - we saved the length of the compressed data, so
+		 * any garbage at the end will be discarded when we
+		 * read it.
+		 */
+		for (off = 0;
+		     off < LZO_HEADER + data[thr].cmp_len;
+		     off += PAGE_SIZE) {
+			memcpy(page, data[thr].cmp + off, PAGE_SIZE);
 
-				ret = swap_write_page(handle, page, &hb);
-				if (ret)
-					goto out_finish;
-			}
+			ret = swap_write_page(handle, page, &hb);
+			if (ret)
+				goto out_finish;
 		}
 
 		wait_event(crc->done, atomic_read(&crc->stop));
 		atomic_set(&crc->stop, 0);
+
+		thr = (thr + 1) % nr_threads;
+		run_threads--;
 	}
 
 out_finish:
@@ -855,6 +889,10 @@ out_finish:
 	if (!ret)
 		pr_info("Image saving done\n");
 	swsusp_show_speed(start, stop, nr_to_write, "Wrote");
+	if (!ret)
+		swsusp_show_speed(start, stop,
+				  DIV_ROUND_UP(cmp_bytes, PAGE_SIZE),
+				  "Compressed stream:");
 out_clean:
 	if (crc) {
 		if (crc->thr)
@@ -1208,6 +1208,12 @@ static inline void boot_delay_msec(int level)
 static bool printk_time = IS_ENABLED(CONFIG_PRINTK_TIME);
 module_param_named(time, printk_time, bool, S_IRUGO | S_IWUSR);
 
+bool printk_offload_interrupts;
+module_param_named(offload_interrupts, printk_offload_interrupts, bool,
+		   S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(offload_interrupts,
+		 "stage interrupt-context messages in per-CPU buffers drained by a kthread");
+
 static size_t print_time(u64 ts, char *buf)
 {
 	unsigned long rem_nsec;
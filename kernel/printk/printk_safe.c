@@ -18,6 +18,8 @@
 #include <linux/preempt.h>
 #include <linux/spinlock.h>
 #include <linux/debug_locks.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
 #include <linux/smp.h>
 #include <linux/cpumask.h>
 #include <linux/irq_work.h>
@@ -60,10 +62,32 @@ static DEFINE_PER_CPU(int, printk_context);
 static DEFINE_PER_CPU(struct printk_safe_seq_buf, nmi_print_seq);
 #endif
 
+static struct task_struct *printk_safe_kthread;
+
+static void printk_safe_offload_wake(struct irq_work *work)
+{
+	if (printk_safe_kthread)
+		wake_up_process(printk_safe_kthread);
+}
+
+static DEFINE_IRQ_WORK(printk_safe_offload_work, printk_safe_offload_wake);
+
 /* Get flushed in a more safe context. */
 static void queue_flush_work(struct printk_safe_seq_buf *s)
 {
-	if (printk_safe_irq_ready)
+	if (!printk_safe_irq_ready)
+		return;
+
+	/*
+	 * With interrupt offloading, the regular per-CPU buffer is
+	 * drained by the dedicated kthread.  Waking it still has to go
+	 * through irq_work because the scheduler may not be safe to
+	 * call from the printk() caller's context.
+	 */
+	if (printk_offload_interrupts && printk_safe_kthread &&
+	    s == this_cpu_ptr(&safe_print_seq))
+		irq_work_queue(&printk_safe_offload_work);
+	else
 		irq_work_queue(&s->work);
 }
 
@@ -262,6 +286,52 @@ void printk_safe_flush(void)
 	}
 }
 
+static bool printk_safe_any_pending(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct printk_safe_seq_buf *s = &per_cpu(safe_print_seq, cpu);
+
+		if (atomic_read(&s->len) || atomic_read(&s->message_lost))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Drain the per-CPU buffers filled by offloaded interrupt-context
+ * printk().  Doing this from a single kthread keeps logbuf_lock
+ * contention and console time off the CPUs taking interrupts.
+ */
+static int printk_safe_kthread_func(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_safe_any_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		printk_safe_flush();
+	}
+
+	return 0;
+}
+
+static int __init printk_safe_kthread_init(void)
+{
+	struct task_struct *thread;
+
+	thread = kthread_run(printk_safe_kthread_func, NULL, "printk_safe");
+	if (IS_ERR(thread))
+		return PTR_ERR(thread);
+
+	printk_safe_kthread = thread;
+	return 0;
+}
+late_initcall(printk_safe_kthread_init);
+
 /**
  * printk_safe_flush_on_panic - flush all per-cpu nmi buffers when the system
  *	goes down.
@@ -368,6 +438,17 @@ __printf(1, 0) int vprintk_func(const char *fmt, va_list args)
 	if (this_cpu_read(printk_context) & PRINTK_SAFE_CONTEXT_MASK)
 		return vprintk_safe(fmt, args);
 
+	/*
+	 * Optionally stage interrupt-context messages in the per-CPU
+	 * buffer so that neither a contended logbuf_lock nor a slow
+	 * console can add latency to interrupt handlers.  Emergencies
+	 * keep the direct path so nothing is stuck in a buffer when
+	 * the system goes down.
+	 */
+	if (printk_offload_interrupts && !oops_in_progress &&
+	    (in_irq() || in_serving_softirq()))
+		return vprintk_safe(fmt, args);
+
 	/*
 	 * Use the main logbuf when logbuf_lock is available in NMI.
 	 * But avoid calling console drivers that might have their own locks.
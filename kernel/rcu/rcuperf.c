@@ -61,6 +61,8 @@ MODULE_AUTHOR("Paul E. McKenney <paulmck@linux.vnet.ibm.com>");
 #define VERBOSE_PERFOUT_ERRSTRING(s) \
 	do { if (verbose) pr_alert("%s" PERF_FLAG "!!! %s\n", perf_type, s); } while (0)
 
+torture_param(int, cbflood_n_burst, 0, "# callbacks per flood burst, zero to disable");
+torture_param(int, cbflood_holdoff, 10, "Holdoff (jiffies) between flood bursts");
 torture_param(bool, gp_async, false, "Use asynchronous GP wait primitives");
 torture_param(int, gp_async_max, 1000, "Max # outstanding waits per reader");
 torture_param(bool, gp_exp, false, "Use expedited GP wait primitives");
@@ -81,6 +83,8 @@ static int nrealwriters;
 static struct task_struct **writer_tasks;
 static struct task_struct **reader_tasks;
 static struct task_struct *shutdown_task;
+static struct task_struct *cbflood_task;
+static unsigned long n_cbfloods;
 
 static u64 **writer_durations;
 static int *writer_n_durations;
@@ -384,6 +388,45 @@ rcu_perf_reader(void *arg)
 	return 0;
 }
 
+/* Callback for the callback-flood kthread; does nothing on purpose. */
+static void rcu_perf_cbflood_cb(struct rcu_head *rhp)
+{
+}
+
+/*
+ * RCU perf callback-flood kthread.  Repeatedly posts large bursts of
+ * callbacks to emulate a misbehaving tenant, so that the effect of the
+ * floods on the readers and writers can be measured.
+ */
+static int
+rcu_perf_cbflood(void *arg)
+{
+	int i;
+	struct rcu_head *rhp;
+
+	VERBOSE_PERFOUT_STRING("rcu_perf_cbflood task started");
+	rhp = vmalloc(cbflood_n_burst * sizeof(*rhp));
+	if (!rhp || !cur_ops->async || !cur_ops->gp_barrier) {
+		VERBOSE_PERFOUT_ERRSTRING("cbflood disabled: no memory or no async ops");
+		vfree(rhp);
+		rhp = NULL;
+	}
+	set_user_nice(current, MAX_NICE);
+	do {
+		if (rhp) {
+			n_cbfloods++;
+			for (i = 0; i < cbflood_n_burst; i++)
+				cur_ops->async(&rhp[i], rcu_perf_cbflood_cb);
+			cur_ops->gp_barrier();
+		}
+		schedule_timeout_interruptible(cbflood_holdoff);
+		rcu_perf_wait_shutdown();
+	} while (!torture_must_stop());
+	vfree(rhp);
+	torture_kthread_stopping("rcu_perf_cbflood");
+	return 0;
+}
+
 /*
  * Callback function for asynchronous grace periods from rcu_perf_writer().
  */
@@ -539,6 +582,11 @@ rcu_perf_cleanup(void)
 	if (torture_cleanup_begin())
 		return;
 
+	torture_stop_kthread(rcu_perf_cbflood, cbflood_task);
+	if (cbflood_n_burst > 0)
+		pr_alert("%s%s cbflood bursts: %lu\n",
+			 perf_type, PERF_FLAG, n_cbfloods);
+
 	if (reader_tasks) {
 		for (i = 0; i < nrealreaders; i++)
 			torture_stop_kthread(rcu_perf_reader,
@@ -721,6 +769,12 @@ rcu_perf_init(void)
 		if (firsterr)
 			goto unwind;
 	}
+	if (cbflood_n_burst > 0) {
+		firsterr = torture_create_kthread(rcu_perf_cbflood, NULL,
+						  cbflood_task);
+		if (firsterr)
+			goto unwind;
+	}
 	torture_init_end();
 	return 0;
 
@@ -183,6 +183,8 @@ static int init_srcu_struct_fields(struct srcu_struct *sp, bool is_static)
 	if (!is_static)
 		sp->sda = alloc_percpu(struct srcu_data);
 	init_srcu_struct_nodes(sp, is_static);
+	if (!is_static)	/* Static structs may already have readers. */
+		bitmap_zero(sp->sda_seen, NR_CPUS);
 	sp->srcu_gp_seq_needed_exp = 0;
 	sp->srcu_last_gp_end = ktime_get_mono_fast_ns();
 	smp_store_release(&sp->srcu_gp_seq_needed, 0); /* Init done. */
@@ -255,7 +257,7 @@ static unsigned long srcu_readers_lock_idx(struct srcu_struct *sp, int idx)
 	int cpu;
 	unsigned long sum = 0;
 
-	for_each_possible_cpu(cpu) {
+	for_each_set_bit(cpu, sp->sda_seen, nr_cpu_ids) {
 		struct srcu_data *cpuc = per_cpu_ptr(sp->sda, cpu);
 
 		sum += READ_ONCE(cpuc->srcu_lock_count[idx]);
@@ -272,7 +274,7 @@ static unsigned long srcu_readers_unlock_idx(struct srcu_struct *sp, int idx)
 	int cpu;
 	unsigned long sum = 0;
 
-	for_each_possible_cpu(cpu) {
+	for_each_set_bit(cpu, sp->sda_seen, nr_cpu_ids) {
 		struct srcu_data *cpuc = per_cpu_ptr(sp->sda, cpu);
 
 		sum += READ_ONCE(cpuc->srcu_unlock_count[idx]);
@@ -341,7 +343,7 @@ static bool srcu_readers_active(struct srcu_struct *sp)
 	int cpu;
 	unsigned long sum = 0;
 
-	for_each_possible_cpu(cpu) {
+	for_each_set_bit(cpu, sp->sda_seen, nr_cpu_ids) {
 		struct srcu_data *cpuc = per_cpu_ptr(sp->sda, cpu);
 
 		sum += READ_ONCE(cpuc->srcu_lock_count[0]);
@@ -394,6 +396,22 @@ void cleanup_srcu_struct(struct srcu_struct *sp)
 }
 EXPORT_SYMBOL_GPL(cleanup_srcu_struct);
 
+/*
+ * Note that the current CPU's reader counters are now in use, so that
+ * the grace-period scans will visit them.  The ->sda_seen bit must be
+ * visible before the counter increment that follows, as the scans rely
+ * on it to skip CPUs that have never used this srcu_struct.  Called
+ * with preemption disabled so that the bit and the flag refer to the
+ * same CPU as the counter increment; both stores are idempotent, so a
+ * racing irq-context reader on this CPU is harmless.
+ */
+static void srcu_note_reader(struct srcu_struct *sp)
+{
+	set_bit(smp_processor_id(), sp->sda_seen);
+	this_cpu_write(sp->sda->srcu_reader_seen, true);
+	smp_mb__after_atomic(); /* Set bit before counting reader. */
+}
+
 /*
  * Counts the new reader in the appropriate per-CPU element of the
  * srcu_struct.
@@ -404,7 +422,11 @@ int __srcu_read_lock(struct srcu_struct *sp)
 	int idx;
 
 	idx = READ_ONCE(sp->srcu_idx) & 0x1;
-	this_cpu_inc(sp->sda->srcu_lock_count[idx]);
+	preempt_disable();
+	if (unlikely(!this_cpu_read(sp->sda->srcu_reader_seen)))
+		srcu_note_reader(sp);
+	this_cpu_inc(sp->sda->srcu_lock_count[idx]);  /* irq-safe RMW. */
+	preempt_enable();
 	smp_mb(); /* B */  /* Avoid leaking the critical section. */
 	return idx;
 }
@@ -413,12 +435,17 @@ EXPORT_SYMBOL_GPL(__srcu_read_lock);
 /*
  * Removes the count for the old reader from the appropriate per-CPU
  * element of the srcu_struct.  Note that this may well be a different
- * CPU than that which was incremented by the corresponding srcu_read_lock().
+ * CPU than that which was incremented by the corresponding srcu_read_lock(),
+ * which is why the unlock path must mark the CPU as seen as well.
  */
 void __srcu_read_unlock(struct srcu_struct *sp, int idx)
 {
 	smp_mb(); /* C */  /* Avoid leaking the critical section. */
-	this_cpu_inc(sp->sda->srcu_unlock_count[idx]);
+	preempt_disable();
+	if (unlikely(!this_cpu_read(sp->sda->srcu_reader_seen)))
+		srcu_note_reader(sp);
+	this_cpu_inc(sp->sda->srcu_unlock_count[idx]);  /* irq-safe RMW. */
+	preempt_enable();
 }
 EXPORT_SYMBOL_GPL(__srcu_read_unlock);
 
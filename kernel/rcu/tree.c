@@ -58,6 +58,7 @@
 #include <linux/trace_events.h>
 #include <linux/suspend.h>
 #include <linux/ftrace.h>
+#include <linux/sched/isolation.h>
 
 #include "tree.h"
 #include "rcu.h"
@@ -504,10 +505,16 @@ static long blimit = DEFAULT_RCU_BLIMIT;
 static long qhimark = DEFAULT_RCU_QHIMARK;
 #define DEFAULT_RCU_QLOMARK 100   /* Once only this many pending, use blimit. */
 static long qlowmark = DEFAULT_RCU_QLOMARK;
+#define DEFAULT_RCU_QUARMARK 20000 /* If this many pending, quarantine excess. */
+static long qquarmark = DEFAULT_RCU_QUARMARK;
 
 module_param(blimit, long, 0444);
 module_param(qhimark, long, 0444);
 module_param(qlowmark, long, 0444);
+module_param(qquarmark, long, 0444);
+
+/* Invokes quarantined callbacks, keeping softirq batches shallow. */
+static struct workqueue_struct *rcu_quarantine_wq;
 
 static ulong jiffies_till_first_fqs = ULONG_MAX;
 static ulong jiffies_till_next_fqs = ULONG_MAX;
@@ -2635,6 +2642,67 @@ static void rcu_cleanup_dead_cpu(int cpu, struct rcu_state *rsp)
  * Invoke any RCU callbacks that have made it to the end of their grace
  * period.  Thottle as specified by rdp->blimit.
  */
+/*
+ * Shunt the not-yet-invoked remainder of a ready-callback batch onto the
+ * quarantine list and kick the workqueue that will invoke it.  The
+ * callbacks' counts intentionally stay in ->cblist until they have been
+ * invoked so that rcu_barrier() and the callback-count heuristics remain
+ * conservative.  Called with interrupts disabled on the CPU owning @rdp.
+ */
+static void rcu_quarantine_cbs(struct rcu_data *rdp, struct rcu_cblist *rclp)
+{
+	if (!rclp->head)
+		return;
+	*rdp->quarantine.tail = rclp->head;
+	rdp->quarantine.tail = rclp->tail;
+	rclp->head = NULL;
+	rclp->tail = &rclp->head;
+	queue_work_on(rdp->cpu, rcu_quarantine_wq, &rdp->quarantine_work);
+}
+
+/*
+ * Invoke quarantined callbacks on behalf of the softirq path.  Runs bound
+ * to the CPU owning @rdp so that the segmented-list counts can be updated
+ * with interrupts disabled, just like rcu_do_batch().
+ */
+static void rcu_quarantine_work_func(struct work_struct *work)
+{
+	struct rcu_data *rdp = container_of(work, struct rcu_data,
+					    quarantine_work);
+	struct rcu_state *rsp = rdp->rsp;
+	struct rcu_cblist rcl = RCU_CBLIST_INITIALIZER(rcl);
+	struct rcu_head *rhp;
+	unsigned long flags;
+	long count;
+
+	local_irq_save(flags);
+	if (rdp->quarantine.head) {
+		rcl.head = rdp->quarantine.head;
+		rcl.tail = rdp->quarantine.tail;
+		rcu_cblist_init(&rdp->quarantine);
+	}
+	local_irq_restore(flags);
+	if (!rcl.head)
+		return;
+
+	/* Invoke callbacks.  No batch limit: that is the whole point. */
+	rhp = rcu_cblist_dequeue(&rcl);
+	for (; rhp; rhp = rcu_cblist_dequeue(&rcl)) {
+		debug_rcu_head_unqueue(rhp);
+		if (__rcu_reclaim(rsp->name, rhp))
+			rcu_cblist_dequeued_lazy(&rcl);
+		cond_resched();
+	}
+
+	local_irq_save(flags);
+	count = -rcl.len;
+	rdp->n_cbs_invoked += count;
+	rdp->n_cbs_quarantined += count;
+	smp_mb(); /* List handling before counting for rcu_barrier(). */
+	rcu_segcblist_insert_count(&rdp->cblist, &rcl);
+	local_irq_restore(flags);
+}
+
 static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 {
 	unsigned long flags;
@@ -2688,8 +2756,16 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	trace_rcu_batch_end(rsp->name, count, !!rcl.head, need_resched(),
 			    is_idle_task(current), rcu_is_callbacks_kthread());
 
-	/* Update counts and requeue any remaining callbacks. */
-	rcu_segcblist_insert_done_cbs(&rdp->cblist, &rcl);
+	/*
+	 * Update counts and requeue any remaining callbacks.  If this CPU
+	 * is being flooded with callbacks, shunt the remainder to the
+	 * quarantine workqueue instead so the softirq path stays shallow.
+	 */
+	if (qquarmark > 0 && rcl.head && rcu_quarantine_wq &&
+	    rcu_segcblist_n_cbs(&rdp->cblist) > qquarmark)
+		rcu_quarantine_cbs(rdp, &rcl);
+	else
+		rcu_segcblist_insert_done_cbs(&rdp->cblist, &rcl);
 	smp_mb(); /* List handling before counting for rcu_barrier(). */
 	rdp->n_cbs_invoked += count;
 	rcu_segcblist_insert_count(&rdp->cblist, &rcl);
@@ -2709,8 +2785,11 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	/*
 	 * The following usually indicates a double call_rcu().  To track
 	 * this down, try building with CONFIG_DEBUG_OBJECTS_RCU_HEAD=y.
+	 * Quarantined callbacks are counted in ->cblist but no longer
+	 * linked there, so skip the check while any are outstanding.
 	 */
-	WARN_ON_ONCE(rcu_segcblist_empty(&rdp->cblist) != (count == 0));
+	WARN_ON_ONCE(!rdp->quarantine.head &&
+		     rcu_segcblist_empty(&rdp->cblist) != (count == 0));
 
 	local_irq_restore(flags);
 
@@ -3581,6 +3660,17 @@ static void _rcu_barrier(struct rcu_state *rsp)
 	/* Wait for all rcu_barrier_callback() callbacks to be invoked. */
 	wait_for_completion(&rsp->barrier_completion);
 
+	/*
+	 * Quarantined callbacks are invoked from workqueue context, so
+	 * some that were posted before this barrier started might still
+	 * be running even though all of the barrier callbacks have been
+	 * invoked.  Wait for them as well.
+	 */
+	for_each_possible_cpu(cpu) {
+		rdp = per_cpu_ptr(rsp->rda, cpu);
+		flush_work(&rdp->quarantine_work);
+	}
+
 	/* Mark the end of the barrier operation. */
 	_rcu_barrier_trace(rsp, TPS("Inc2"), -1, rsp->barrier_sequence);
 	rcu_seq_end(&rsp->barrier_sequence);
@@ -3648,6 +3738,8 @@ rcu_boot_init_percpu_data(int cpu, struct rcu_state *rsp)
 	WARN_ON_ONCE(rcu_dynticks_in_eqs(rcu_dynticks_snap(rdp->dynticks)));
 	rdp->cpu = cpu;
 	rdp->rsp = rsp;
+	rcu_cblist_init(&rdp->quarantine);
+	INIT_WORK(&rdp->quarantine_work, rcu_quarantine_work_func);
 	rcu_boot_init_nocb_percpu_data(rdp);
 	raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
 }
@@ -3888,6 +3980,12 @@ static void rcu_migrate_callbacks(int cpu, struct rcu_state *rsp)
 	struct rcu_data *rdp = per_cpu_ptr(rsp->rda, cpu);
 	struct rcu_node *rnp_root = rcu_get_root(rdp->rsp);
 
+	/*
+	 * Quarantined callbacks are ready to invoke; make sure they have
+	 * all run before counting and migrating what is left.
+	 */
+	flush_work(&rdp->quarantine_work);
+
 	if (rcu_is_nocb_cpu(cpu) || rcu_segcblist_empty(&rdp->cblist))
 		return;  /* No callbacks to migrate. */
 
@@ -3986,6 +4084,8 @@ static int __init rcu_spawn_gp_kthread(void)
 		raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
 		wake_up_process(t);
 	}
+	rcu_quarantine_wq = alloc_workqueue("rcu_quar", WQ_MEM_RECLAIM, 0);
+	WARN_ON_ONCE(!rcu_quarantine_wq);
 	rcu_spawn_nocb_kthreads();
 	rcu_spawn_boost_kthreads();
 	return 0;
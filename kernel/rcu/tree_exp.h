@@ -20,6 +20,14 @@
  * Authors: Paul E. McKenney <paulmck@linux.vnet.ibm.com>
  */
 
+/* Limit on expedited grace periods per second; zero or less is no limit. */
+static int rcu_exp_budget;
+module_param(rcu_exp_budget, int, 0644);
+
+/* Jiffies before a polled non-housekeeping CPU gets the IPI after all. */
+static int rcu_exp_defer_timeout = HZ / 10;
+module_param(rcu_exp_defer_timeout, int, 0644);
+
 /*
  * Record the start of an expedited grace period.
  */
@@ -134,6 +142,7 @@ static void __maybe_unused sync_exp_reset_tree(struct rcu_state *rsp)
 		raw_spin_lock_irqsave_rcu_node(rnp, flags);
 		WARN_ON_ONCE(rnp->expmask);
 		rnp->expmask = rnp->expmaskinit;
+		rnp->expdeferred = 0;
 		raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
 	}
 }
@@ -366,6 +375,7 @@ static void sync_rcu_exp_select_cpus(struct rcu_state *rsp,
 	int ret;
 	struct rcu_node *rnp;
 
+	rsp->exp_func = func;
 	sync_exp_reset_tree(rsp);
 	rcu_for_each_leaf_node(rsp, rnp) {
 		raw_spin_lock_irqsave_rcu_node(rnp, flags);
@@ -400,6 +410,18 @@ static void sync_rcu_exp_select_cpus(struct rcu_state *rsp,
 
 			if (!(mask_ofl_ipi & mask))
 				continue;
+			if (!housekeeping_cpu(cpu, HK_FLAG_RCU)) {
+				/*
+				 * Never IPI an isolated CPU.  Instead poll
+				 * it for an extended quiescent state from
+				 * synchronize_sched_expedited_wait().
+				 */
+				raw_spin_lock_irqsave_rcu_node(rnp, flags);
+				rnp->expdeferred |= mask;
+				raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
+				mask_ofl_ipi &= ~mask;
+				continue;
+			}
 retry_ipi:
 			if (rcu_dynticks_in_eqs_since(rdp->dynticks,
 						      rdp->exp_dynticks_snap)) {
@@ -432,6 +454,71 @@ retry_ipi:
 	}
 }
 
+/* Are any non-housekeeping CPUs being polled rather than IPIed? */
+static bool sync_rcu_exp_has_deferred(struct rcu_state *rsp)
+{
+	struct rcu_node *rnp;
+
+	rcu_for_each_leaf_node(rsp, rnp)
+		if (READ_ONCE(rnp->expdeferred))
+			return true;
+	return false;
+}
+
+/*
+ * Check deferred (non-housekeeping) CPUs for an expedited quiescent
+ * state, reporting those that have passed through one since their
+ * dynticks snapshot was taken.  A CPU that instead stays in the kernel
+ * past rcu_exp_defer_timeout jiffies gets the IPI after all: an
+ * expedited stall is worse than one perturbed isolated CPU.
+ *
+ * Caller must hold the rcu_state's exp_mutex.
+ */
+static void sync_rcu_exp_poll_deferred(struct rcu_state *rsp,
+				       unsigned long jiffies_start)
+{
+	int cpu;
+	unsigned long flags;
+	unsigned long mask;
+	unsigned long mask_ofl_test;
+	unsigned long mask_ofl_ipi;
+	struct rcu_node *rnp;
+
+	rcu_for_each_leaf_node(rsp, rnp) {
+		if (!READ_ONCE(rnp->expdeferred))
+			continue;
+		raw_spin_lock_irqsave_rcu_node(rnp, flags);
+		rnp->expdeferred &= rnp->expmask;
+		mask = rnp->expdeferred;
+		raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
+		mask_ofl_test = 0;
+		mask_ofl_ipi = 0;
+		for_each_leaf_node_possible_cpu(rnp, cpu) {
+			unsigned long bit = leaf_node_cpu_bit(rnp, cpu);
+			struct rcu_data *rdp = per_cpu_ptr(rsp->rda, cpu);
+
+			if (!(mask & bit))
+				continue;
+			if (rcu_dynticks_in_eqs_since(rdp->dynticks,
+						      rdp->exp_dynticks_snap)) {
+				mask_ofl_test |= bit;
+			} else if (time_after(jiffies, jiffies_start +
+					      rcu_exp_defer_timeout) &&
+				   !smp_call_function_single(cpu, rsp->exp_func,
+							     rsp, 0)) {
+				mask_ofl_ipi |= bit;
+			}
+		}
+		if (!(mask_ofl_test | mask_ofl_ipi))
+			continue;
+		raw_spin_lock_irqsave_rcu_node(rnp, flags);
+		rnp->expdeferred &= ~(mask_ofl_test | mask_ofl_ipi);
+		raw_spin_unlock_irqrestore_rcu_node(rnp, flags);
+		if (mask_ofl_test)
+			rcu_report_exp_cpu_mult(rsp, rnp, mask_ofl_test, false);
+	}
+}
+
 static void synchronize_sched_expedited_wait(struct rcu_state *rsp)
 {
 	int cpu;
@@ -447,13 +534,21 @@ static void synchronize_sched_expedited_wait(struct rcu_state *rsp)
 	jiffies_start = jiffies;
 
 	for (;;) {
+		unsigned long jwait = jiffies_stall;
+
+		/* Poll deferred CPUs frequently; they get no IPI. */
+		if (sync_rcu_exp_has_deferred(rsp))
+			jwait = 2;
 		ret = swait_event_timeout(
 				rsp->expedited_wq,
 				sync_rcu_preempt_exp_done(rnp_root),
-				jiffies_stall);
+				jwait);
 		if (ret > 0 || sync_rcu_preempt_exp_done(rnp_root))
 			return;
 		WARN_ON(ret < 0);  /* workqueues should not be signaled. */
+		sync_rcu_exp_poll_deferred(rsp, jiffies_start);
+		if (time_before(jiffies, jiffies_start + jiffies_stall))
+			continue;
 		if (rcu_cpu_stall_suppress)
 			continue;
 		panic_on_rcu_stall();
@@ -573,6 +668,35 @@ static void wait_rcu_exp_gp(struct work_struct *wp)
 	rcu_exp_sel_wait_wake(rewp->rew_rsp, rewp->rew_func, rewp->rew_s);
 }
 
+/*
+ * Debit the expedited-grace-period budget, a token bucket refilled with
+ * rcu_exp_budget tokens per second.  Returns true if the budget is
+ * exhausted, in which case the caller gets a normal grace period: slower,
+ * but with no IPIs.  A budget of zero or less means no limit.
+ */
+static bool rcu_exp_over_budget(void)
+{
+	static DEFINE_RAW_SPINLOCK(rcu_exp_budget_lock);
+	static unsigned long last_refill;
+	static int tokens;
+	unsigned long flags;
+	bool over = false;
+
+	if (rcu_exp_budget <= 0)
+		return false;
+	raw_spin_lock_irqsave(&rcu_exp_budget_lock, flags);
+	if (time_after(jiffies, last_refill + HZ)) {
+		tokens = rcu_exp_budget;
+		last_refill = jiffies;
+	}
+	if (tokens > 0)
+		tokens--;
+	else
+		over = true;
+	raw_spin_unlock_irqrestore(&rcu_exp_budget_lock, flags);
+	return over;
+}
+
 /*
  * Given an rcu_state pointer and a smp_call_function() handler, kick
  * off the specified flavor of expedited grace period.
@@ -585,8 +709,11 @@ static void _synchronize_rcu_expedited(struct rcu_state *rsp,
 	struct rcu_node *rnp;
 	unsigned long s;
 
-	/* If expedited grace periods are prohibited, fall back to normal. */
-	if (rcu_gp_is_normal()) {
+	/*
+	 * If expedited grace periods are prohibited or over budget, fall
+	 * back to normal.
+	 */
+	if (rcu_gp_is_normal() || rcu_exp_over_budget()) {
 		wait_rcu_gp(rsp->call);
 		return;
 	}
@@ -2168,6 +2168,9 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 {
 	p->on_rq			= 0;
 
+	/* The pairing hint reference is not inherited over fork. */
+	p->pair_hint			= NULL;
+
 	p->se.on_rq			= 0;
 	p->se.exec_start		= 0;
 	p->se.sum_exec_runtime		= 0;
@@ -2712,6 +2715,17 @@ static struct rq *finish_task_switch(struct task_struct *prev)
 	vtime_task_switch(prev);
 	perf_event_task_sched_in(prev, current);
 	finish_task(prev);
+
+	/*
+	 * Drop a dying task's pairing hint while rq->lock is still held:
+	 * sched_getattr() and __setscheduler_pair_hint() access it under
+	 * the rq lock, and put_pid() frees the struct pid right away.
+	 */
+	if (unlikely(prev_state == TASK_DEAD)) {
+		put_pid(prev->pair_hint);
+		prev->pair_hint = NULL;
+	}
+
 	finish_lock_switch(rq);
 	finish_arch_post_lock_switch();
 
@@ -4014,6 +4028,26 @@ static struct task_struct *find_process_by_pid(pid_t pid)
  */
 #define SETPARAM_POLICY	-1
 
+/*
+ * Install or clear the wakeup pairing hint. The pid is resolved in the
+ * caller's namespace at set time; a pid that no longer exists simply
+ * clears the hint, since it is only ever a soft preference.
+ */
+static void __setscheduler_pair_hint(struct task_struct *p,
+				     const struct sched_attr *attr)
+{
+	struct pid *pair = NULL;
+
+	if (!(attr->sched_flags & SCHED_FLAG_PAIR_HINT))
+		return;
+
+	if (attr->sched_pair_pid)
+		pair = find_get_pid(attr->sched_pair_pid);
+
+	put_pid(p->pair_hint);
+	p->pair_hint = pair;
+}
+
 static void __setscheduler_params(struct task_struct *p,
 		const struct sched_attr *attr)
 {
@@ -4105,7 +4139,8 @@ recheck:
 			return -EINVAL;
 	}
 
-	if (attr->sched_flags & ~(SCHED_FLAG_ALL | SCHED_FLAG_SUGOV))
+	if (attr->sched_flags &
+	    ~(SCHED_FLAG_ALL | SCHED_FLAG_SUGOV | SCHED_FLAG_PAIR_HINT))
 		return -EINVAL;
 
 	/*
@@ -4211,6 +4246,7 @@ recheck:
 			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
+		__setscheduler_pair_hint(p, attr);
 		task_rq_unlock(rq, p, &rf);
 		return 0;
 	}
@@ -4266,6 +4302,7 @@ change:
 	}
 
 	p->sched_reset_on_fork = reset_on_fork;
+	__setscheduler_pair_hint(p, attr);
 	oldprio = p->prio;
 
 	if (pi) {
@@ -4686,6 +4723,24 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	else
 		attr.sched_nice = task_nice(p);
 
+	if (READ_ONCE(p->pair_hint)) {
+		struct rq_flags rf;
+		struct rq *rq;
+
+		/*
+		 * The hint is dropped in finish_task_switch() while the
+		 * rq lock is still held when the task dies, and put_pid()
+		 * frees the struct pid right away, so it can only be
+		 * dereferenced under the rq lock, not under RCU alone.
+		 */
+		rq = task_rq_lock(p, &rf);
+		if (p->pair_hint) {
+			attr.sched_flags |= SCHED_FLAG_PAIR_HINT;
+			attr.sched_pair_pid = pid_vnr(p->pair_hint);
+		}
+		task_rq_unlock(rq, p, &rf);
+	}
+
 	rcu_read_unlock();
 
 	retval = sched_read_attr(uattr, &attr, size);
@@ -5951,6 +6006,8 @@ void __init sched_init(void)
 #ifdef CONFIG_CGROUP_SCHED
 	task_group_cache = KMEM_CACHE(task_group, 0);
 
+	raw_spin_lock_init(&root_task_group.dl_pool_lock);
+	root_task_group.dl_pool_period = NSEC_PER_SEC;
 	list_add(&root_task_group.list, &task_groups);
 	INIT_LIST_HEAD(&root_task_group.children);
 	INIT_LIST_HEAD(&root_task_group.siblings);
@@ -6250,6 +6307,9 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+	raw_spin_lock_init(&tg->dl_pool_lock);
+	tg->dl_pool_period = NSEC_PER_SEC;
+
 	return tg;
 
 err:
@@ -6762,6 +6822,36 @@ static u64 cpu_rt_period_read_uint(struct cgroup_subsys_state *css,
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+static u64 cpu_dl_runtime_read(struct cgroup_subsys_state *css,
+			       struct cftype *cft)
+{
+	return div_u64(css_tg(css)->dl_pool_runtime, NSEC_PER_USEC);
+}
+
+static int cpu_dl_runtime_write(struct cgroup_subsys_state *css,
+				struct cftype *cft, u64 val)
+{
+	struct task_group *tg = css_tg(css);
+
+	return sched_group_set_dl_pool(tg, val * NSEC_PER_USEC,
+				       tg->dl_pool_period);
+}
+
+static u64 cpu_dl_period_read(struct cgroup_subsys_state *css,
+			      struct cftype *cft)
+{
+	return div_u64(css_tg(css)->dl_pool_period, NSEC_PER_USEC);
+}
+
+static int cpu_dl_period_write(struct cgroup_subsys_state *css,
+			       struct cftype *cft, u64 val)
+{
+	struct task_group *tg = css_tg(css);
+
+	return sched_group_set_dl_pool(tg, tg->dl_pool_runtime,
+				       val * NSEC_PER_USEC);
+}
+
 static struct cftype cpu_legacy_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -6798,6 +6888,16 @@ static struct cftype cpu_legacy_files[] = {
 		.write_u64 = cpu_rt_period_write_uint,
 	},
 #endif
+	{
+		.name = "dl_runtime_us",
+		.read_u64 = cpu_dl_runtime_read,
+		.write_u64 = cpu_dl_runtime_write,
+	},
+	{
+		.name = "dl_period_us",
+		.read_u64 = cpu_dl_period_read,
+		.write_u64 = cpu_dl_period_write,
+	},
 	{ }	/* Terminate */
 };
 
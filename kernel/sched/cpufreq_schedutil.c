@@ -12,6 +12,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/cpufreq.h>
+#include <linux/interrupt.h>
 #include <linux/kthread.h>
 #include <uapi/linux/sched/types.h>
 #include <linux/slab.h>
@@ -22,6 +23,7 @@
 struct sugov_tunables {
 	struct gov_attr_set attr_set;
 	unsigned int rate_limit_us;
+	unsigned int batch_window_us;
 };
 
 struct sugov_policy {
@@ -33,6 +35,7 @@ struct sugov_policy {
 	raw_spinlock_t update_lock;  /* For shared policies */
 	u64 last_freq_update_time;
 	s64 freq_update_delay_ns;
+	s64 batch_window_ns;
 	unsigned int next_freq;
 	unsigned int cached_raw_freq;
 
@@ -73,6 +76,67 @@ static DEFINE_PER_CPU(struct sugov_cpu, sugov_cpu);
 
 /************************ Governor internals ***********************/
 
+/*
+ * Batch mode: instead of evaluating the frequency on every utilization
+ * update, coalesce all updates of a policy within batch_window_us and
+ * take one decision per window. While batching, the interrupt timings
+ * predictor is used to avoid ramping down right before a predicted
+ * interrupt burst, so the decision anticipates the burst instead of
+ * trailing it by a window.
+ */
+#ifdef CONFIG_IRQ_TIMINGS
+static atomic_t sugov_irq_timings_users;
+
+static void sugov_batch_set_window(struct sugov_policy *sg_policy, s64 window_ns)
+{
+	bool was_on = sg_policy->batch_window_ns;
+
+	sg_policy->batch_window_ns = window_ns;
+
+	if (window_ns && !was_on) {
+		if (atomic_inc_return(&sugov_irq_timings_users) == 1)
+			irq_timings_enable();
+	} else if (!window_ns && was_on) {
+		if (atomic_dec_and_test(&sugov_irq_timings_users))
+			irq_timings_disable();
+	}
+}
+
+static bool sugov_next_event_soon(struct sugov_policy *sg_policy, u64 time)
+{
+	/* Called with interrupts disabled, as irq_timings requires. */
+	u64 next_evt = irq_timings_next_event(time);
+
+	return next_evt != U64_MAX &&
+	       (s64)(next_evt - time) < sg_policy->batch_window_ns;
+}
+#else /* !CONFIG_IRQ_TIMINGS */
+static void sugov_batch_set_window(struct sugov_policy *sg_policy, s64 window_ns)
+{
+	sg_policy->batch_window_ns = window_ns;
+}
+
+static inline bool sugov_next_event_soon(struct sugov_policy *sg_policy,
+					 u64 time)
+{
+	return false;
+}
+#endif /* CONFIG_IRQ_TIMINGS */
+
+static unsigned int sugov_batch_filter(struct sugov_policy *sg_policy, u64 time,
+				       unsigned int next_f)
+{
+	if (!sg_policy->batch_window_ns || next_f >= sg_policy->next_freq)
+		return next_f;
+
+	if (!sugov_next_event_soon(sg_policy, time))
+		return next_f;
+
+	/* Reset cached freq as next_freq is kept */
+	sg_policy->cached_raw_freq = 0;
+	return sg_policy->next_freq;
+}
+
 static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
 {
 	s64 delta_ns;
@@ -111,6 +175,8 @@ static bool sugov_should_update_freq(struct sugov_policy *sg_policy, u64 time)
 	}
 
 	delta_ns = time - sg_policy->last_freq_update_time;
+	if (sg_policy->batch_window_ns)
+		return delta_ns >= sg_policy->batch_window_ns;
 	return delta_ns >= sg_policy->freq_update_delay_ns;
 }
 
@@ -296,6 +362,7 @@ static void sugov_update_single(struct update_util_data *hook, u64 time,
 			/* Reset cached freq as next_freq has changed */
 			sg_policy->cached_raw_freq = 0;
 		}
+		next_f = sugov_batch_filter(sg_policy, time, next_f);
 	}
 	sugov_update_commit(sg_policy, time, next_f);
 }
@@ -361,10 +428,12 @@ static void sugov_update_shared(struct update_util_data *hook, u64 time,
 	sg_cpu->last_update = time;
 
 	if (sugov_should_update_freq(sg_policy, time)) {
-		if (flags & SCHED_CPUFREQ_RT)
+		if (flags & SCHED_CPUFREQ_RT) {
 			next_f = sg_policy->policy->cpuinfo.max_freq;
-		else
+		} else {
 			next_f = sugov_next_freq_shared(sg_cpu, time);
+			next_f = sugov_batch_filter(sg_policy, time, next_f);
+		}
 
 		sugov_update_commit(sg_policy, time, next_f);
 	}
@@ -443,8 +512,37 @@ static ssize_t rate_limit_us_store(struct gov_attr_set *attr_set, const char *bu
 
 static struct governor_attr rate_limit_us = __ATTR_RW(rate_limit_us);
 
+static ssize_t batch_window_us_show(struct gov_attr_set *attr_set, char *buf)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+
+	return sprintf(buf, "%u\n", tunables->batch_window_us);
+}
+
+static ssize_t batch_window_us_store(struct gov_attr_set *attr_set,
+				     const char *buf, size_t count)
+{
+	struct sugov_tunables *tunables = to_sugov_tunables(attr_set);
+	struct sugov_policy *sg_policy;
+	unsigned int batch_window_us;
+
+	if (kstrtouint(buf, 10, &batch_window_us))
+		return -EINVAL;
+
+	tunables->batch_window_us = batch_window_us;
+
+	list_for_each_entry(sg_policy, &attr_set->policy_list, tunables_hook)
+		sugov_batch_set_window(sg_policy,
+				       batch_window_us * NSEC_PER_USEC);
+
+	return count;
+}
+
+static struct governor_attr batch_window_us = __ATTR_RW(batch_window_us);
+
 static struct attribute *sugov_attributes[] = {
 	&rate_limit_us.attr,
+	&batch_window_us.attr,
 	NULL
 };
 
@@ -664,6 +762,8 @@ static int sugov_start(struct cpufreq_policy *policy)
 	unsigned int cpu;
 
 	sg_policy->freq_update_delay_ns = sg_policy->tunables->rate_limit_us * NSEC_PER_USEC;
+	sugov_batch_set_window(sg_policy,
+			sg_policy->tunables->batch_window_us * NSEC_PER_USEC);
 	sg_policy->last_freq_update_time = 0;
 	sg_policy->next_freq = UINT_MAX;
 	sg_policy->work_in_progress = false;
@@ -699,6 +799,8 @@ static void sugov_stop(struct cpufreq_policy *policy)
 	for_each_cpu(cpu, policy->cpus)
 		cpufreq_remove_update_util_hook(cpu);
 
+	sugov_batch_set_window(sg_policy, 0);
+
 	synchronize_sched();
 
 	if (!policy->fast_switch_enabled) {
@@ -279,6 +279,7 @@ static void task_non_contending(struct task_struct *p)
 
 			if (p->state == TASK_DEAD)
 				sub_rq_bw(&p->dl, &rq->dl);
+			dl_pool_release(p);
 			raw_spin_lock(&dl_b->lock);
 			__dl_sub(dl_b, p->dl.dl_bw, dl_bw_cpus(task_cpu(p)));
 			__dl_clear_params(p);
@@ -1272,6 +1273,7 @@ static enum hrtimer_restart inactive_task_timer(struct hrtimer *timer)
 			dl_se->dl_non_contending = 0;
 		}
 
+		dl_pool_release(p);
 		raw_spin_lock(&dl_b->lock);
 		__dl_sub(dl_b, p->dl.dl_bw, dl_bw_cpus(task_cpu(p)));
 		raw_spin_unlock(&dl_b->lock);
@@ -2481,6 +2483,139 @@ void sched_dl_do_global(void)
 	}
 }
 
+#ifdef CONFIG_CGROUP_SCHED
+/*
+ * Hierarchical SCHED_DEADLINE bandwidth pools.
+ *
+ * A group may reserve a fraction of the global -deadline bandwidth
+ * through cpu.dl_runtime_us/cpu.dl_period_us. Tasks are charged to the
+ * nearest ancestor group with a pool configured when they are admitted;
+ * the charge follows sched_setattr() parameter changes and is dropped
+ * when the task leaves SCHED_DEADLINE, not when it changes cgroups.
+ * Configuration guarantees that the fractions of all pools together fit
+ * in the global limit, so each pool can actually be served.
+ */
+static DEFINE_MUTEX(dl_pool_mutex);
+
+static struct task_group *dl_pool_find(struct task_group *tg)
+{
+	for (; tg && tg != &root_task_group; tg = tg->parent)
+		if (READ_ONCE(tg->dl_pool_bw))
+			return tg;
+
+	return NULL;
+}
+
+int sched_group_set_dl_pool(struct task_group *tg, u64 runtime_ns,
+			    u64 period_ns)
+{
+	struct task_group *iter;
+	u64 new_bw = 0, pools = 0;
+	int err = 0;
+
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (runtime_ns) {
+		if (!period_ns || runtime_ns > period_ns)
+			return -EINVAL;
+		new_bw = to_ratio(period_ns, runtime_ns);
+	}
+
+	mutex_lock(&dl_pool_mutex);
+
+	/*
+	 * Pools of nested groups overlap by construction; summing them
+	 * all is pessimistic but keeps every pool servable even in the
+	 * worst nesting.
+	 */
+	if (new_bw && global_rt_runtime() != RUNTIME_INF) {
+		rcu_read_lock();
+		list_for_each_entry_rcu(iter, &task_groups, list) {
+			if (iter != tg)
+				pools += iter->dl_pool_bw;
+		}
+		rcu_read_unlock();
+
+		if (pools + new_bw >
+		    to_ratio(global_rt_period(), global_rt_runtime()))
+			err = -EBUSY;
+	}
+
+	if (!err) {
+		raw_spin_lock_irq(&tg->dl_pool_lock);
+		if (tg->dl_pool_in_use > new_bw * num_online_cpus()) {
+			err = -EBUSY;
+		} else {
+			tg->dl_pool_runtime = runtime_ns;
+			tg->dl_pool_period = period_ns;
+			tg->dl_pool_bw = new_bw;
+		}
+		raw_spin_unlock_irq(&tg->dl_pool_lock);
+	}
+
+	mutex_unlock(&dl_pool_mutex);
+
+	return err;
+}
+
+/*
+ * Charge @new_bw - @old_bw to the pool the task draws from, if any.
+ * Called under the root dl_bw lock, mirroring its admission test:
+ * the pool fraction scales with the number of CPUs the task can use.
+ * Returns 0 if the pool admits the change (or there is no pool).
+ */
+static int dl_pool_charge(struct task_struct *p, int cpus, u64 old_bw,
+			  u64 new_bw)
+{
+	struct task_group *tg = p->dl.dl_pool_tg;
+	int err = 0;
+
+	if (!tg) {
+		tg = dl_pool_find(task_group(p));
+		if (!tg)
+			return 0;
+		old_bw = 0;
+	}
+
+	raw_spin_lock(&tg->dl_pool_lock);
+	if (tg->dl_pool_bw * cpus < tg->dl_pool_in_use - old_bw + new_bw) {
+		err = -1;
+	} else {
+		tg->dl_pool_in_use += new_bw - old_bw;
+		if (!p->dl.dl_pool_tg) {
+			css_get(&tg->css);
+			p->dl.dl_pool_tg = tg;
+		}
+	}
+	raw_spin_unlock(&tg->dl_pool_lock);
+
+	return err;
+}
+
+static void dl_pool_release(struct task_struct *p)
+{
+	struct task_group *tg = p->dl.dl_pool_tg;
+
+	if (!tg)
+		return;
+
+	raw_spin_lock(&tg->dl_pool_lock);
+	tg->dl_pool_in_use -= p->dl.dl_bw;
+	raw_spin_unlock(&tg->dl_pool_lock);
+	css_put(&tg->css);
+	p->dl.dl_pool_tg = NULL;
+}
+#else /* !CONFIG_CGROUP_SCHED */
+static inline int dl_pool_charge(struct task_struct *p, int cpus, u64 old_bw,
+				 u64 new_bw)
+{
+	return 0;
+}
+
+static inline void dl_pool_release(struct task_struct *p) { }
+#endif /* CONFIG_CGROUP_SCHED */
+
 /*
  * We must be sure that accepting a new task (or allowing changing the
  * parameters of an existing one) is consistent with the bandwidth
@@ -2513,13 +2648,15 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 	raw_spin_lock(&dl_b->lock);
 	cpus = dl_bw_cpus(task_cpu(p));
 	if (dl_policy(policy) && !task_has_dl_policy(p) &&
-	    !__dl_overflow(dl_b, cpus, 0, new_bw)) {
+	    !__dl_overflow(dl_b, cpus, 0, new_bw) &&
+	    !dl_pool_charge(p, cpus, 0, new_bw)) {
 		if (hrtimer_active(&p->dl.inactive_timer))
 			__dl_sub(dl_b, p->dl.dl_bw, cpus);
 		__dl_add(dl_b, new_bw, cpus);
 		err = 0;
 	} else if (dl_policy(policy) && task_has_dl_policy(p) &&
-		   !__dl_overflow(dl_b, cpus, p->dl.dl_bw, new_bw)) {
+		   !__dl_overflow(dl_b, cpus, p->dl.dl_bw, new_bw) &&
+		   !dl_pool_charge(p, cpus, p->dl.dl_bw, new_bw)) {
 		/*
 		 * XXX this is slightly incorrect: when the task
 		 * utilization decreases, we should delay the total
@@ -2535,8 +2672,11 @@ int sched_dl_overflow(struct task_struct *p, int policy,
 		/*
 		 * Do not decrease the total deadline utilization here,
 		 * switched_from_dl() will take care to do it at the correct
-		 * (0-lag) time.
+		 * (0-lag) time. The pool charge however is dropped right
+		 * away, so the group's reservation frees up for other
+		 * tasks immediately.
 		 */
+		dl_pool_release(p);
 		err = 0;
 	}
 	raw_spin_unlock(&dl_b->lock);
@@ -2637,6 +2777,9 @@ void __dl_clear_params(struct task_struct *p)
 	dl_se->dl_yielded = 0;
 	dl_se->dl_non_contending = 0;
 	dl_se->dl_overrun = 0;
+#ifdef CONFIG_CGROUP_SCHED
+	dl_se->dl_pool_tg = NULL;
+#endif
 }
 
 bool dl_param_changed(struct task_struct *p, const struct sched_attr *attr)
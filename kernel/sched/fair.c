@@ -34,6 +34,8 @@
 #include <linux/migrate.h>
 #include <linux/task_work.h>
 #include <linux/sched/isolation.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 
 #include <trace/events/sched.h>
 
@@ -5416,6 +5418,8 @@ decay_load_missed(unsigned long load, unsigned long missed_updates, int idx)
  * see decay_load_misses(). For NOHZ_FULL we get to subtract and add the extra
  * term.
  */
+static void lb_cpu_stats_publish(struct rq *rq);
+
 static void cpu_load_update(struct rq *this_rq, unsigned long this_load,
 			    unsigned long pending_updates)
 {
@@ -5457,6 +5461,7 @@ static void cpu_load_update(struct rq *this_rq, unsigned long this_load,
 	}
 
 	sched_avg_update(this_rq);
+	lb_cpu_stats_publish(this_rq);
 }
 
 /* Used instead of source_load when we know the type == 0 */
@@ -5611,6 +5616,98 @@ static unsigned long target_load(int cpu, int type)
 	return max(rq->cpu_load[type-1], total);
 }
 
+static unsigned long cpu_util(int cpu);
+
+/*
+ * Packed snapshot of the per-rq fields consumed by load balancing.
+ * update_sg_lb_stats() walks every CPU of a group on each rebalance
+ * and touching the scattered rq cachelines of hundreds of CPUs is the
+ * dominant cost on large machines; reading one snapshot line per CPU
+ * instead touches a single cacheline where the rq walk touched
+ * several. Per-CPU storage keeps each entry on its owner's node and
+ * the publishing stores from different CPUs off each other's lines.
+ * Entries are published from the load update tick and are only
+ * trusted while their stamp is current, so CPUs whose tick is stopped
+ * are still read from their runqueue directly (which is also what
+ * makes freshly idled CPUs show up as idle).
+ */
+struct lb_cpu_stats {
+	unsigned long	stamp;
+	unsigned long	weighted_load;
+	unsigned long	cpu_load[CPU_LOAD_IDX_MAX];
+	unsigned long	util;
+	unsigned int	nr_running;
+	unsigned int	h_nr_running;
+#ifdef CONFIG_NUMA_BALANCING
+	unsigned int	nr_numa_running;
+	unsigned int	nr_preferred_running;
+#endif
+};
+
+static DEFINE_PER_CPU(struct lb_cpu_stats, lb_cpu_stats);
+
+/*
+ * All of this is lockless, like the existing cpu_load[] readers; a
+ * torn snapshot is no worse than the mixed-age values the rq walk
+ * used to produce.
+ */
+static void lb_cpu_stats_read(struct rq *rq, struct lb_cpu_stats *stats)
+{
+	int i;
+
+	stats->weighted_load = weighted_cpuload(rq);
+	for (i = 0; i < CPU_LOAD_IDX_MAX; i++)
+		stats->cpu_load[i] = rq->cpu_load[i];
+	stats->util = cpu_util(cpu_of(rq));
+	stats->nr_running = rq->nr_running;
+	stats->h_nr_running = rq->cfs.h_nr_running;
+#ifdef CONFIG_NUMA_BALANCING
+	stats->nr_numa_running = rq->nr_numa_running;
+	stats->nr_preferred_running = rq->nr_preferred_running;
+#endif
+}
+
+static void lb_cpu_stats_publish(struct rq *rq)
+{
+	struct lb_cpu_stats *lcs = &per_cpu(lb_cpu_stats, cpu_of(rq));
+
+	lb_cpu_stats_read(rq, lcs);
+	WRITE_ONCE(lcs->stamp, jiffies);
+}
+
+static void lb_cpu_stats_get(int cpu, struct lb_cpu_stats *stats)
+{
+	struct lb_cpu_stats *lcs = &per_cpu(lb_cpu_stats, cpu);
+
+	if (READ_ONCE(lcs->stamp) == jiffies) {
+		*stats = *lcs;
+		return;
+	}
+
+	lb_cpu_stats_read(cpu_rq(cpu), stats);
+}
+
+/* Snapshot variants of source_load()/target_load() */
+static unsigned long lb_source_load(const struct lb_cpu_stats *stats, int type)
+{
+	unsigned long total = stats->weighted_load;
+
+	if (type == 0 || !sched_feat(LB_BIAS))
+		return total;
+
+	return min(stats->cpu_load[type - 1], total);
+}
+
+static unsigned long lb_target_load(const struct lb_cpu_stats *stats, int type)
+{
+	unsigned long total = stats->weighted_load;
+
+	if (type == 0 || !sched_feat(LB_BIAS))
+		return total;
+
+	return max(stats->cpu_load[type - 1], total);
+}
+
 static unsigned long capacity_of(int cpu)
 {
 	return cpu_rq(cpu)->cpu_capacity;
@@ -6013,6 +6110,55 @@ static inline int find_idlest_cpu(struct sched_domain *sd, struct task_struct *p
 	return new_cpu;
 }
 
+/*
+ * Propagate the idle state of a CPU to the idle mask shared by its LLC
+ * domain. Called from the idle task entry/exit paths, so the cost of a
+ * remote atomic is paid by CPUs that have nothing better to do, not by
+ * the wakeup path.
+ */
+void update_idle_cpumask(int cpu, bool idle)
+{
+	struct sched_domain_shared *sds;
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds) {
+		if (idle)
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		else
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Try to pop an idle CPU from the mask maintained by
+ * update_idle_cpumask() instead of scanning the LLC domain. Claiming
+ * the bit with test_and_clear makes concurrent wakeups pick distinct
+ * CPUs; since the mask is only a hint, the claim is double checked
+ * against idle_cpu() before use.
+ */
+static int select_idle_cached(struct task_struct *p, int target)
+{
+	struct sched_domain_shared *sds;
+	int cpu;
+
+	sds = rcu_dereference(per_cpu(sd_llc_shared, target));
+	if (!sds)
+		return -1;
+
+	for_each_cpu_wrap(cpu, sds_idle_cpus(sds), target) {
+		if (!cpumask_test_cpu(cpu, &p->cpus_allowed))
+			continue;
+		if (!cpumask_test_and_clear_cpu(cpu, sds_idle_cpus(sds)))
+			continue;
+		if (idle_cpu(cpu))
+			return cpu;
+	}
+
+	return -1;
+}
+
 #ifdef CONFIG_SCHED_SMT
 
 static inline void set_idle_cores(int cpu, int val)
@@ -6191,6 +6337,34 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	return cpu;
 }
 
+/*
+ * A task paired with SCHED_FLAG_PAIR_HINT prefers to run in the cache
+ * neighborhood of its partner. Resolve the partner's CPU if the hint is
+ * set and would actually move the wakeup to another cache domain; the
+ * hint is soft, so an unusable partner CPU leaves placement alone.
+ * Must be called under rcu_read_lock().
+ */
+static int pair_hint_cpu(struct task_struct *p, int target)
+{
+	struct task_struct *partner;
+	int cpu = -1;
+
+	if (likely(!p->pair_hint))
+		return -1;
+
+	partner = pid_task(p->pair_hint, PIDTYPE_PID);
+	if (partner && partner != p)
+		cpu = task_cpu(partner);
+
+	if (cpu < 0 || !cpumask_test_cpu(cpu, &p->cpus_allowed))
+		return -1;
+
+	if (cpus_share_cache(cpu, target))
+		return -1;
+
+	return cpu;
+}
+
 /*
  * Try and locate an idle core/thread in the LLC cache domain.
  */
@@ -6227,6 +6401,10 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 	if (!sd)
 		return target;
 
+	i = select_idle_cached(p, target);
+	if ((unsigned)i < nr_cpumask_bits)
+		return i;
+
 	i = select_idle_core(p, sd, target);
 	if ((unsigned)i < nr_cpumask_bits)
 		return i;
@@ -6391,6 +6569,16 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int sd_flag, int wake_f
 	if (!sd) {
 pick_cpu:
 		if (sd_flag & SD_BALANCE_WAKE) { /* XXX always ? */
+			int pair_cpu = pair_hint_cpu(p, new_cpu);
+
+			/*
+			 * The pairing hint overrides the waker/prev
+			 * choice made by wake_affine: hunt for an idle
+			 * CPU around the partner instead.
+			 */
+			if (pair_cpu >= 0)
+				new_cpu = pair_cpu;
+
 			new_cpu = select_idle_sibling(p, prev_cpu, new_cpu);
 
 			if (want_affine)
@@ -7814,27 +8002,29 @@ static inline void update_sg_lb_stats(struct lb_env *env,
 	memset(sgs, 0, sizeof(*sgs));
 
 	for_each_cpu_and(i, sched_group_span(group), env->cpus) {
-		struct rq *rq = cpu_rq(i);
+		struct lb_cpu_stats stats;
+
+		lb_cpu_stats_get(i, &stats);
 
 		/* Bias balancing toward cpus of our domain */
 		if (local_group)
-			load = target_load(i, load_idx);
+			load = lb_target_load(&stats, load_idx);
 		else
-			load = source_load(i, load_idx);
+			load = lb_source_load(&stats, load_idx);
 
 		sgs->group_load += load;
-		sgs->group_util += cpu_util(i);
-		sgs->sum_nr_running += rq->cfs.h_nr_running;
+		sgs->group_util += stats.util;
+		sgs->sum_nr_running += stats.h_nr_running;
 
-		nr_running = rq->nr_running;
+		nr_running = stats.nr_running;
 		if (nr_running > 1)
 			*overload = true;
 
 #ifdef CONFIG_NUMA_BALANCING
-		sgs->nr_numa_running += rq->nr_numa_running;
-		sgs->nr_preferred_running += rq->nr_preferred_running;
+		sgs->nr_numa_running += stats.nr_numa_running;
+		sgs->nr_preferred_running += stats.nr_preferred_running;
 #endif
-		sgs->sum_weighted_load += weighted_cpuload(rq);
+		sgs->sum_weighted_load += stats.weighted_load;
 		/*
 		 * No need to call idle_cpu() if nr_running is not 0
 		 */
@@ -8995,12 +9185,24 @@ static struct {
 	unsigned long next_balance;     /* in jiffy units */
 } nohz ____cacheline_aligned;
 
+/* Number of nohz balance kicks received, indexed by the kicked CPU */
+static DEFINE_PER_CPU(unsigned long, nohz_kick_count);
+
+/*
+ * The idle load balancer does work on behalf of all the other idle
+ * CPUs, so it must run on a housekeeping CPU: waking up an isolated
+ * CPU for it would defeat the isolation the admin asked for. Skip
+ * any idle CPU that isn't allowed to do housekeeping work.
+ */
 static inline int find_new_ilb(void)
 {
-	int ilb = cpumask_first(nohz.idle_cpus_mask);
+	int ilb;
 
-	if (ilb < nr_cpu_ids && idle_cpu(ilb))
-		return ilb;
+	for_each_cpu_and(ilb, nohz.idle_cpus_mask,
+			 housekeeping_cpumask(HK_FLAG_MISC)) {
+		if (idle_cpu(ilb))
+			return ilb;
+	}
 
 	return nr_cpu_ids;
 }
@@ -9023,6 +9225,8 @@ static void nohz_balancer_kick(void)
 
 	if (test_and_set_bit(NOHZ_BALANCE_KICK, nohz_flags(ilb_cpu)))
 		return;
+
+	per_cpu(nohz_kick_count, ilb_cpu)++;
 	/*
 	 * Use smp_send_reschedule() instead of resched_cpu().
 	 * This way we generate a sched IPI on the target cpu which
@@ -9033,6 +9237,38 @@ static void nohz_balancer_kick(void)
 	return;
 }
 
+static int nohz_kicks_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		seq_printf(m, "cpu%d %lu\n", cpu,
+			   per_cpu(nohz_kick_count, cpu));
+
+	return 0;
+}
+
+static int nohz_kicks_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, nohz_kicks_show, NULL);
+}
+
+static const struct file_operations nohz_kicks_fops = {
+	.open		= nohz_kicks_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_nohz_kicks_procfs(void)
+{
+	if (!proc_create("sched_nohz_kicks", 0444, NULL, &nohz_kicks_fops))
+		return -ENOMEM;
+	return 0;
+}
+
+__initcall(init_nohz_kicks_procfs);
+
 void nohz_balance_exit_idle(unsigned int cpu)
 {
 	if (unlikely(test_bit(NOHZ_TICK_STOPPED, nohz_flags(cpu)))) {
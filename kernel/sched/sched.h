@@ -172,6 +172,12 @@ static inline int task_has_dl_policy(struct task_struct *p)
  */
 #define SCHED_FLAG_SUGOV	0x10000000
 
+/*
+ * Soft cache-affinity pairing hint, set through sched_setattr() with
+ * sched_attr::sched_pair_pid. Would be 0x08 in the uapi numbering.
+ */
+#define SCHED_FLAG_PAIR_HINT	0x08
+
 static inline bool dl_entity_is_special(struct sched_dl_entity *dl_se)
 {
 #ifdef CONFIG_CPU_FREQ_GOV_SCHEDUTIL
@@ -356,6 +362,19 @@ struct task_group {
 #endif
 
 	struct cfs_bandwidth cfs_bandwidth;
+
+	/*
+	 * SCHED_DEADLINE bandwidth pool. dl_pool_bw is the per-CPU
+	 * fraction (<< BW_SHIFT) that -deadline tasks in this hierarchy
+	 * may consume, dl_pool_in_use the bandwidth currently drawn by
+	 * admitted tasks. A zero dl_pool_bw means no pool; tasks are
+	 * then only admitted against the root domain bandwidth.
+	 */
+	raw_spinlock_t dl_pool_lock;
+	u64 dl_pool_runtime;
+	u64 dl_pool_period;
+	u64 dl_pool_bw;
+	u64 dl_pool_in_use;
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -416,6 +435,8 @@ extern long sched_group_rt_period(struct task_group *tg);
 extern int sched_rt_can_attach(struct task_group *tg, struct task_struct *tsk);
 
 extern struct task_group *sched_create_group(struct task_group *parent);
+extern int sched_group_set_dl_pool(struct task_group *tg, u64 runtime_ns,
+			u64 period_ns);
 extern void sched_online_group(struct task_group *tg,
 			       struct task_group *parent);
 extern void sched_destroy_group(struct task_group *tg);
@@ -868,6 +889,12 @@ static inline void update_idle_core(struct rq *rq)
 static inline void update_idle_core(struct rq *rq) { }
 #endif
 
+#ifdef CONFIG_SMP
+extern void update_idle_cpumask(int cpu, bool idle);
+#else
+static inline void update_idle_cpumask(int cpu, bool idle) { }
+#endif
+
 DECLARE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
 #define cpu_rq(cpu)		(&per_cpu(runqueues, (cpu)))
@@ -118,9 +118,13 @@ static DECLARE_WORK(watchdog_work, clocksource_watchdog_work);
 static DEFINE_SPINLOCK(watchdog_lock);
 static int watchdog_running;
 static atomic_t watchdog_reset_pending;
+static int watchdog_on_demand;
+static int watchdog_check_passes;
+static unsigned long watchdog_trigger_pending;
 
 static int clocksource_watchdog_kthread(void *data);
 static void __clocksource_change_rating(struct clocksource *cs, int rating);
+static inline void clocksource_reset_watchdog(void);
 
 /*
  * Interval: 0.5sec Threshold: 0.0625s
@@ -128,6 +132,22 @@ static void __clocksource_change_rating(struct clocksource *cs, int rating);
 #define WATCHDOG_INTERVAL (HZ >> 1)
 #define WATCHDOG_THRESHOLD (NSEC_PER_SEC >> 4)
 
+/*
+ * With "clocksource_wd_ondemand" on the command line the watchdog timer
+ * keeps cycling, but the (potentially expensive) hardware reads are only
+ * done when a check has been requested: at boot and on resume to deliver
+ * the high-res verdicts, when a new clocksource is enqueued, and whenever
+ * the timekeeping core trips over a suspicious cycle delta. Known-good
+ * TSC fleets thus avoid the steady-state cost of serialized HPET reads
+ * every half second.
+ */
+static int __init clocksource_wd_ondemand_setup(char *str)
+{
+	watchdog_on_demand = 1;
+	return 1;
+}
+__setup("clocksource_wd_ondemand", clocksource_wd_ondemand_setup);
+
 static void clocksource_watchdog_work(struct work_struct *work)
 {
 	/*
@@ -184,6 +204,24 @@ static void clocksource_watchdog(struct timer_list *unused)
 
 	reset_pending = atomic_read(&watchdog_reset_pending);
 
+	if (watchdog_on_demand) {
+		/*
+		 * A requested check takes two passes: the baselines are
+		 * stale after an idle period - the watchdog hardware may
+		 * have wrapped - so the first pass only re-baselines and
+		 * the second one does the actual comparison.
+		 */
+		if (test_and_clear_bit(0, &watchdog_trigger_pending)) {
+			clocksource_reset_watchdog();
+			watchdog_check_passes = 2;
+		} else if (reset_pending && !watchdog_check_passes) {
+			watchdog_check_passes = 2;
+		}
+		if (!watchdog_check_passes)
+			goto rearm;
+		watchdog_check_passes--;
+	}
+
 	list_for_each_entry(cs, &watchdog_list, wd_list) {
 
 		/* Clocksource already marked unstable? */
@@ -273,6 +311,7 @@ static void clocksource_watchdog(struct timer_list *unused)
 	if (reset_pending)
 		atomic_dec(&watchdog_reset_pending);
 
+rearm:
 	/*
 	 * Cycle through CPUs to check if the CPUs stay synchronized
 	 * to each other.
@@ -317,6 +356,20 @@ static void clocksource_resume_watchdog(void)
 	atomic_inc(&watchdog_reset_pending);
 }
 
+/**
+ * clocksource_watchdog_trigger - request an on-demand watchdog check
+ *
+ * Called by the timekeeping core when a cycle delta looks suspicious.
+ * Lockless, so it is safe from the timer interrupt path; concurrent
+ * requests are merged into one check. A no-op unless the watchdog runs
+ * in on-demand mode.
+ */
+void clocksource_watchdog_trigger(void)
+{
+	if (watchdog_on_demand)
+		set_bit(0, &watchdog_trigger_pending);
+}
+
 static void clocksource_enqueue_watchdog(struct clocksource *cs)
 {
 	unsigned long flags;
@@ -326,6 +379,8 @@ static void clocksource_enqueue_watchdog(struct clocksource *cs)
 		/* cs is a clocksource to be watched. */
 		list_add(&cs->wd_list, &watchdog_list);
 		cs->flags &= ~CLOCK_SOURCE_WATCHDOG;
+		/* Make sure an idle on-demand watchdog delivers a verdict. */
+		clocksource_watchdog_trigger();
 	} else {
 		/* cs is a watchdog. */
 		if (cs->flags & CLOCK_SOURCE_IS_CONTINUOUS)
@@ -446,6 +501,7 @@ static inline void clocksource_resume_watchdog(void) { }
 static inline int __clocksource_watchdog_kthread(void) { return 0; }
 static bool clocksource_is_watchdog(struct clocksource *cs) { return false; }
 void clocksource_mark_unstable(struct clocksource *cs) { }
+void clocksource_watchdog_trigger(void) { }
 
 #endif /* CONFIG_CLOCKSOURCE_WATCHDOG */
 
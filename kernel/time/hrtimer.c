@@ -498,17 +498,45 @@ static ktime_t __hrtimer_next_event_base(struct hrtimer_cpu_base *cpu_base,
 
 	for_each_active_base(base, cpu_base, active) {
 		struct timerqueue_node *next;
+		unsigned int occupied;
 		struct hrtimer *timer;
 
 		next = timerqueue_getnext(&base->active);
-		timer = container_of(next, struct hrtimer, node);
-		expires = ktime_sub(hrtimer_get_expires(timer), base->offset);
-		if (expires < expires_next) {
-			expires_next = expires;
-			if (timer->is_soft)
-				cpu_base->softirq_next_timer = timer;
-			else
-				cpu_base->next_timer = timer;
+		if (next) {
+			timer = container_of(next, struct hrtimer, node);
+			expires = ktime_sub(hrtimer_get_expires(timer),
+					    base->offset);
+			if (expires < expires_next) {
+				expires_next = expires;
+				if (timer->is_soft)
+					cpu_base->softirq_next_timer = timer;
+				else
+					cpu_base->next_timer = timer;
+			}
+		}
+
+		/*
+		 * A wheel bucket expires as a whole at its slot deadline;
+		 * this min() over the occupied slots is what coalesces a
+		 * bucket full of timers onto a single clock event.
+		 */
+		occupied = base->wheel_occupied;
+		while (occupied) {
+			unsigned int slot = __ffs(occupied);
+
+			occupied &= ~(1U << slot);
+			expires = ktime_sub(base->wheel_deadline[slot],
+					    base->offset);
+			if (expires < expires_next) {
+				expires_next = expires;
+				timer = list_first_entry(&base->wheel[slot],
+							 struct hrtimer,
+							 wheel_entry);
+				if (timer->is_soft)
+					cpu_base->softirq_next_timer = timer;
+				else
+					cpu_base->next_timer = timer;
+			}
 		}
 	}
 	/*
@@ -923,6 +951,79 @@ u64 hrtimer_forward(struct hrtimer *timer, ktime_t now, ktime_t interval)
 }
 EXPORT_SYMBOL_GPL(hrtimer_forward);
 
+/*
+ * Hashed wheel front end for short-horizon range timers.
+ *
+ * A timer whose slack is at least HRTIMER_WHEEL_RES can have its
+ * expiry rounded up to the next HRTIMER_WHEEL_RES boundary without
+ * leaving its [softexpires, expires] window.  Such timers hash into a
+ * wheel bucket keyed on the rounded deadline, so a whole bucket is
+ * serviced by one clock event with no per-timer reprogramming and
+ * without touching the rb-tree, which only carries precise or
+ * far-out timers.
+ */
+static inline ktime_t hrtimer_wheel_deadline(const struct hrtimer *timer)
+{
+	return (hrtimer_get_softexpires_tv64(timer) + HRTIMER_WHEEL_RES - 1) &
+		~(s64)(HRTIMER_WHEEL_RES - 1);
+}
+
+static inline unsigned int hrtimer_wheel_slot(ktime_t deadline)
+{
+	return ((u64)deadline / HRTIMER_WHEEL_RES) & (HRTIMER_WHEEL_SLOTS - 1);
+}
+
+static bool hrtimer_wheel_enqueue(struct hrtimer *timer,
+				  struct hrtimer_clock_base *base)
+{
+	ktime_t deadline;
+	unsigned int slot;
+
+	/*
+	 * Rounding the expiry up to the bucket boundary must not push
+	 * it past the hard expiry, so only timers with at least one
+	 * bucket worth of slack are eligible.
+	 */
+	if (ktime_sub(hrtimer_get_expires(timer),
+		      hrtimer_get_softexpires(timer)) < HRTIMER_WHEEL_RES)
+		return false;
+
+	deadline = hrtimer_wheel_deadline(timer);
+	slot = hrtimer_wheel_slot(deadline);
+
+	/*
+	 * The bucket may be claimed by a different deadline already (a
+	 * timer one or more wheel revolutions out hashes to the same
+	 * slot); those timers take the rb-tree instead.
+	 */
+	if (base->wheel_occupied & (1U << slot)) {
+		if (base->wheel_deadline[slot] != deadline)
+			return false;
+	} else {
+		base->wheel_occupied |= 1U << slot;
+		base->wheel_deadline[slot] = deadline;
+	}
+
+	list_add_tail(&timer->wheel_entry, &base->wheel[slot]);
+	timer->is_wheeled = 1;
+
+	return true;
+}
+
+static void hrtimer_wheel_del(struct hrtimer *timer,
+			      struct hrtimer_clock_base *base)
+{
+	unsigned int slot = hrtimer_wheel_slot(hrtimer_wheel_deadline(timer));
+
+	list_del(&timer->wheel_entry);
+	timer->is_wheeled = 0;
+
+	if (list_empty(&base->wheel[slot])) {
+		base->wheel_occupied &= ~(1U << slot);
+		base->wheel_deadline[slot] = KTIME_MAX;
+	}
+}
+
 /*
  * enqueue_hrtimer - internal function to (re)start a timer
  *
@@ -941,6 +1042,14 @@ static int enqueue_hrtimer(struct hrtimer *timer,
 
 	timer->state = HRTIMER_STATE_ENQUEUED;
 
+	/*
+	 * Wheeled timers report "leftmost" unconditionally; the
+	 * comparisons in hrtimer_reprogram() sort out cheaply whether
+	 * the event device or the softirq expiry actually moves.
+	 */
+	if (hrtimer_wheel_enqueue(timer, base))
+		return 1;
+
 	return timerqueue_add(&base->active, &timer->node);
 }
 
@@ -965,7 +1074,12 @@ static void __remove_hrtimer(struct hrtimer *timer,
 	if (!(state & HRTIMER_STATE_ENQUEUED))
 		return;
 
-	if (!timerqueue_del(&base->active, &timer->node))
+	if (timer->is_wheeled)
+		hrtimer_wheel_del(timer, base);
+	else
+		timerqueue_del(&base->active, &timer->node);
+
+	if (!timerqueue_getnext(&base->active) && !base->wheel_occupied)
 		cpu_base->active_bases &= ~(1 << base->index);
 
 	/*
@@ -1376,6 +1490,30 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	base->running = NULL;
 }
 
+static void hrtimer_wheel_run(struct hrtimer_cpu_base *cpu_base,
+			      struct hrtimer_clock_base *base,
+			      ktime_t *basenow, unsigned long flags)
+{
+	unsigned int slot;
+
+	/*
+	 * __run_hrtimer() drops cpu_base->lock, so a callback can
+	 * re-arm into a slot we just drained with a deadline a full
+	 * revolution out. Re-check occupancy and the slot deadline on
+	 * every iteration instead of snapshotting them.
+	 */
+	for (slot = 0; slot < HRTIMER_WHEEL_SLOTS; slot++) {
+		while ((base->wheel_occupied & (1U << slot)) &&
+		       base->wheel_deadline[slot] <= *basenow) {
+			struct hrtimer *timer;
+
+			timer = list_first_entry(&base->wheel[slot],
+						 struct hrtimer, wheel_entry);
+			__run_hrtimer(cpu_base, base, timer, basenow, flags);
+		}
+	}
+}
+
 static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 				 unsigned long flags, unsigned int active_mask)
 {
@@ -1388,6 +1526,8 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 
 		basenow = ktime_add(now, base->offset);
 
+		hrtimer_wheel_run(cpu_base, base, &basenow, flags);
+
 		while ((node = timerqueue_getnext(&base->active))) {
 			struct hrtimer *timer;
 
@@ -1751,11 +1891,16 @@ COMPAT_SYSCALL_DEFINE2(nanosleep, struct compat_timespec __user *, rqtp,
 int hrtimers_prepare_cpu(unsigned int cpu)
 {
 	struct hrtimer_cpu_base *cpu_base = &per_cpu(hrtimer_bases, cpu);
-	int i;
+	int i, j;
 
 	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++) {
 		cpu_base->clock_base[i].cpu_base = cpu_base;
 		timerqueue_init_head(&cpu_base->clock_base[i].active);
+		cpu_base->clock_base[i].wheel_occupied = 0;
+		for (j = 0; j < HRTIMER_WHEEL_SLOTS; j++) {
+			INIT_LIST_HEAD(&cpu_base->clock_base[i].wheel[j]);
+			cpu_base->clock_base[i].wheel_deadline[j] = KTIME_MAX;
+		}
 	}
 
 	cpu_base->cpu = cpu;
@@ -1776,6 +1921,20 @@ static void migrate_hrtimer_list(struct hrtimer_clock_base *old_base,
 {
 	struct hrtimer *timer;
 	struct timerqueue_node *node;
+	int i;
+
+	for (i = 0; i < HRTIMER_WHEEL_SLOTS; i++) {
+		while (!list_empty(&old_base->wheel[i])) {
+			timer = list_first_entry(&old_base->wheel[i],
+						 struct hrtimer, wheel_entry);
+			BUG_ON(hrtimer_callback_running(timer));
+			debug_deactivate(timer);
+			__remove_hrtimer(timer, old_base,
+					 HRTIMER_STATE_ENQUEUED, 0);
+			timer->base = new_base;
+			enqueue_hrtimer(timer, new_base, HRTIMER_MODE_ABS);
+		}
+	}
 
 	while ((node = timerqueue_getnext(&old_base->active))) {
 		timer = container_of(node, struct hrtimer, node);
@@ -236,6 +236,36 @@ void thread_group_cputimer(struct task_struct *tsk, struct task_cputime *times)
 	sample_cputime_atomic(times, &cputimer->cputime_atomic);
 }
 
+/*
+ * Sample the process-wide cputime cache, priming it on the first read.
+ * Unlike thread_group_cputimer() this is for plain clock reads: once a
+ * process has been sampled the tick keeps the atomic sums up to date
+ * and further reads avoid the O(nr_threads) group walk, which matters
+ * for monitoring agents polling CLOCK_PROCESS_CPUTIME_ID on processes
+ * with thousands of threads.
+ */
+static void thread_group_cputime_fast(struct task_struct *tsk,
+				      struct task_cputime *times)
+{
+	struct thread_group_cputimer *cputimer = &tsk->signal->cputimer;
+	struct task_cputime sum;
+
+	if (!READ_ONCE(cputimer->caching)) {
+		thread_group_cputime(tsk, &sum);
+		update_gt_cputime(&cputimer->cputime_atomic, &sum);
+
+		/*
+		 * Once caching is set, stop_process_timers() leaves
+		 * running set so the tick never stops feeding the
+		 * atomic sums again. Ordering doesn't matter here for
+		 * the same reason as in thread_group_cputimer().
+		 */
+		WRITE_ONCE(cputimer->caching, true);
+		WRITE_ONCE(cputimer->running, true);
+	}
+	sample_cputime_atomic(times, &cputimer->cputime_atomic);
+}
+
 /*
  * Sample a process (thread group) clock for the given group_leader task.
  * Must be called with task sighand lock held for safe while_each_thread()
@@ -251,15 +281,15 @@ static int cpu_clock_sample_group(const clockid_t which_clock,
 	default:
 		return -EINVAL;
 	case CPUCLOCK_PROF:
-		thread_group_cputime(p, &cputime);
+		thread_group_cputime_fast(p, &cputime);
 		*sample = cputime.utime + cputime.stime;
 		break;
 	case CPUCLOCK_VIRT:
-		thread_group_cputime(p, &cputime);
+		thread_group_cputime_fast(p, &cputime);
 		*sample = cputime.utime;
 		break;
 	case CPUCLOCK_SCHED:
-		thread_group_cputime(p, &cputime);
+		thread_group_cputime_fast(p, &cputime);
 		*sample = cputime.sum_exec_runtime;
 		break;
 	}
@@ -368,6 +398,8 @@ static int posix_cpu_timer_create(struct k_itimer *new_timer)
  * If we return TIMER_RETRY, it's necessary to release the timer's lock
  * and try again.  (This happens when the timer is in the middle of firing.)
  */
+static void disarm_timer_cache(struct k_itimer *timer);
+
 static int posix_cpu_timer_del(struct k_itimer *timer)
 {
 	int ret = 0;
@@ -389,10 +421,13 @@ static int posix_cpu_timer_del(struct k_itimer *timer)
 		 */
 		WARN_ON_ONCE(!list_empty(&timer->it.cpu.entry));
 	} else {
-		if (timer->it.cpu.firing)
+		if (timer->it.cpu.firing) {
 			ret = TIMER_RETRY;
-		else
+		} else {
 			list_del(&timer->it.cpu.entry);
+			if (timer->it.cpu.expires)
+				disarm_timer_cache(timer);
+		}
 
 		unlock_task_sighand(p, &flags);
 	}
@@ -443,6 +478,83 @@ static inline int expires_gt(u64 expires, u64 new_exp)
 	return expires == 0 || expires > new_exp;
 }
 
+static inline void stop_process_timers(struct signal_struct *sig);
+
+/* Merge an additional deadline into @exp, treating zero as "none". */
+static inline u64 expires_min(u64 exp, u64 new_exp)
+{
+	if (new_exp && expires_gt(exp, new_exp))
+		return new_exp;
+	return exp;
+}
+
+/*
+ * Refresh the expiration cache after a timer has been unlinked from its
+ * list.  The lists are sorted, so the new earliest POSIX 1.b deadline of
+ * the clock is simply the new list head; fold the other cache sources
+ * back in (itimers and RLIMIT_CPU for process timers).  Without this a
+ * disarmed timer leaves its stale deadline behind and the tick fast path
+ * keeps dropping into the full timer scan when it passes.  This must be
+ * called with the sighand lock held.
+ */
+static void disarm_timer_cache(struct k_itimer *timer)
+{
+	struct task_struct *p = timer->it.cpu.task;
+	struct task_cputime *cputime_expires;
+	struct list_head *head;
+	u64 exp = 0;
+
+	if (CPUCLOCK_PERTHREAD(timer->it_clock)) {
+		head = p->cpu_timers;
+		cputime_expires = &p->cputime_expires;
+	} else {
+		head = p->signal->cpu_timers;
+		cputime_expires = &p->signal->cputime_expires;
+	}
+	head += CPUCLOCK_WHICH(timer->it_clock);
+
+	if (!list_empty(head))
+		exp = list_first_entry(head, struct cpu_timer_list,
+				       entry)->expires;
+
+	if (!CPUCLOCK_PERTHREAD(timer->it_clock)) {
+		struct signal_struct *sig = p->signal;
+
+		switch (CPUCLOCK_WHICH(timer->it_clock)) {
+		case CPUCLOCK_PROF: {
+			unsigned long soft = task_rlimit(p, RLIMIT_CPU);
+
+			exp = expires_min(exp, sig->it[CPUCLOCK_PROF].expires);
+			if (soft != RLIM_INFINITY)
+				exp = expires_min(exp, soft * NSEC_PER_SEC);
+			break;
+		}
+		case CPUCLOCK_VIRT:
+			exp = expires_min(exp, sig->it[CPUCLOCK_VIRT].expires);
+			break;
+		}
+	}
+
+	switch (CPUCLOCK_WHICH(timer->it_clock)) {
+	case CPUCLOCK_PROF:
+		cputime_expires->prof_exp = exp;
+		break;
+	case CPUCLOCK_VIRT:
+		cputime_expires->virt_exp = exp;
+		break;
+	case CPUCLOCK_SCHED:
+		cputime_expires->sched_exp = exp;
+		break;
+	}
+
+	if (task_cputime_zero(cputime_expires)) {
+		if (CPUCLOCK_PERTHREAD(timer->it_clock))
+			tick_dep_clear_task(p, TICK_DEP_BIT_POSIX_TIMER);
+		else
+			stop_process_timers(p->signal);
+	}
+}
+
 /*
  * Insert the timer on the appropriate list before any timers that
  * expire later.  This must be called with the sighand lock held.
@@ -612,8 +724,11 @@ static int posix_cpu_timer_set(struct k_itimer *timer, int timer_flags,
 	if (unlikely(timer->it.cpu.firing)) {
 		timer->it.cpu.firing = -1;
 		ret = TIMER_RETRY;
-	} else
+	} else {
 		list_del_init(&timer->it.cpu.entry);
+		if (old_expires)
+			disarm_timer_cache(timer);
+	}
 
 	/*
 	 * We need to sample the current value to convert the new
@@ -876,8 +991,13 @@ static inline void stop_process_timers(struct signal_struct *sig)
 {
 	struct thread_group_cputimer *cputimer = &sig->cputimer;
 
-	/* Turn off cputimer->running. This is done without locking. */
-	WRITE_ONCE(cputimer->running, false);
+	/*
+	 * Turn off cputimer->running. This is done without locking. If
+	 * the sums also back cached process clock reads they must keep
+	 * receiving tick updates, so leave running set in that case.
+	 */
+	if (!READ_ONCE(cputimer->caching))
+		WRITE_ONCE(cputimer->running, false);
 	tick_dep_clear_signal(sig, TICK_DEP_BIT_POSIX_TIMER);
 }
 
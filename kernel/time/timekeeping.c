@@ -2101,6 +2101,14 @@ void update_wall_time(void)
 	/* Do some additional sanity checking */
 	timekeeping_check_update(tk, offset);
 
+	/*
+	 * A delta beyond half of the clocksource's safe range is either a
+	 * very long idle period or a misbehaving clocksource. Worth a
+	 * cross check when the watchdog runs in on-demand mode.
+	 */
+	if (unlikely(offset > (tk->tkr_mono.clock->max_cycles >> 1)))
+		clocksource_watchdog_trigger();
+
 	/*
 	 * With NO_HZ we may have to accumulate many cycle_intervals
 	 * (think "ticks") worth of time at once. To do this efficiently,
@@ -42,6 +42,7 @@
 #include <linux/sched/sysctl.h>
 #include <linux/sched/nohz.h>
 #include <linux/sched/debug.h>
+#include <linux/sched/isolation.h>
 #include <linux/slab.h>
 #include <linux/compat.h>
 
@@ -202,6 +203,7 @@ struct timer_base {
 	unsigned int		cpu;
 	bool			is_idle;
 	bool			must_forward_clk;
+	unsigned long		expiry_count;
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
 } ____cacheline_aligned;
@@ -869,6 +871,19 @@ static inline struct timer_base *get_timer_base(u32 tflags)
 static inline struct timer_base *
 get_target_base(struct timer_base *base, unsigned tflags)
 {
+#ifdef CONFIG_SMP
+	/*
+	 * Keep unpinned timers off isolated CPUs. Expiring them locally
+	 * would drag timer softirqs onto CPUs which are supposed to be
+	 * free of housekeeping work, even while those CPUs are busy, so
+	 * this migrates unconditionally rather than relying on the
+	 * idle-driven NOHZ heuristic below.
+	 */
+	if (!(tflags & TIMER_PINNED) &&
+	    !housekeeping_cpu(smp_processor_id(), HK_FLAG_TIMER))
+		return get_timer_cpu_base(tflags,
+					  housekeeping_any_cpu(HK_FLAG_TIMER));
+#endif
 #if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
 	if (static_branch_likely(&timers_migration_enabled) &&
 	    !(tflags & TIMER_PINNED))
@@ -1350,6 +1365,7 @@ static void expire_timers(struct timer_base *base, struct hlist_head *head)
 		timer = hlist_entry(head->first, struct timer_list, entry);
 
 		base->running_timer = timer;
+		base->expiry_count++;
 		detach_timer(timer, true);
 
 		fn = timer->function;
@@ -1714,6 +1730,21 @@ void run_local_timers(void)
 	raise_softirq(TIMER_SOFTIRQ);
 }
 
+/*
+ * Number of timers which have expired on @cpu since boot. Shown in
+ * /proc/timer_list so that a flat count on the isolated CPUs can prove
+ * that the housekeeping migration in get_target_base() is effective.
+ */
+unsigned long timer_base_expiries(int cpu)
+{
+	unsigned long count = per_cpu(timer_bases[BASE_STD], cpu).expiry_count;
+
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
+		count += per_cpu(timer_bases[BASE_DEF], cpu).expiry_count;
+
+	return count;
+}
+
 /*
  * Since schedule_timeout()'s timer is defined on the stack, it must store
  * the target task on the stack as well.
@@ -17,6 +17,7 @@
 #include <linux/seq_file.h>
 #include <linux/kallsyms.h>
 #include <linux/nmi.h>
+#include <linux/timer.h>
 
 #include <linux/uaccess.h>
 
@@ -162,6 +163,9 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 #undef P
 #undef P_ns
 
+	SEQ_printf(m, "  .%-15s: %lu\n", "timer_expiries",
+		   timer_base_expiries(cpu));
+
 #ifdef CONFIG_TICK_ONESHOT
 # define P(x) \
 	SEQ_printf(m, "  .%-15s: %Lu\n", #x, \
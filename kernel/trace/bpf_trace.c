@@ -15,12 +15,60 @@
 #include <linux/ctype.h>
 #include <linux/kprobes.h>
 #include <linux/error-injection.h>
+#include <linux/sched/clock.h>
 
 #include "trace_probe.h"
 #include "trace.h"
 
 u64 bpf_get_stackid(u64 r1, u64 r2, u64 r3, u64 r4, u64 r5);
 
+/* Budget, in ns per invocation, a program attached to a tracepoint or
+ * kprobe may consume before it is throttled.  Zero disables
+ * enforcement.  Set via the kernel.bpf_trace_budget_ns sysctl.
+ */
+int sysctl_bpf_trace_budget_ns __read_mostly;
+
+/* While over budget, let only one invocation in 128 through */
+#define BPF_TRACE_THROTTLE_SKIP	127
+
+/* Like BPF_PROG_RUN, but feeds the per-cpu run-time accounting in
+ * prog->aux->stats and enforces the ns/invocation budget.  Throttled
+ * invocations are skipped entirely; returning 1 keeps the event, the
+ * same as if the program had not been attached.  The invocations that
+ * do run keep the EWMA fresh, so a program that got cheaper (or a
+ * raised budget) un-throttles on its own.
+ */
+static unsigned int trace_bpf_prog_run(const struct bpf_prog *prog, void *ctx)
+{
+	struct bpf_prog_stats *stats = this_cpu_ptr(prog->aux->stats);
+	unsigned int ret;
+	u64 start, dur;
+	int budget;
+
+	if (unlikely(stats->skip)) {
+		stats->skip--;
+		return 1;
+	}
+
+	start = sched_clock();
+	ret = BPF_PROG_RUN(prog, ctx);
+	dur = sched_clock() - start;
+
+	u64_stats_update_begin(&stats->syncp);
+	stats->cnt++;
+	stats->nsecs += dur;
+	u64_stats_update_end(&stats->syncp);
+
+	stats->avg_nsecs = stats->avg_nsecs ?
+			   (stats->avg_nsecs * 7 + dur) >> 3 : dur;
+
+	budget = READ_ONCE(sysctl_bpf_trace_budget_ns);
+	if (unlikely(budget > 0) && stats->avg_nsecs > budget)
+		stats->skip = BPF_TRACE_THROTTLE_SKIP;
+
+	return ret;
+}
+
 /**
  * trace_call_bpf - invoke BPF program
  * @call: tracepoint event
@@ -70,7 +118,8 @@ unsigned int trace_call_bpf(struct trace_event_call *call, void *ctx)
 	 * out of events when it was updated in between this and the
 	 * rcu_dereference() which is accepted risk.
 	 */
-	ret = BPF_PROG_RUN_ARRAY_CHECK(call->prog_array, ctx, BPF_PROG_RUN);
+	ret = BPF_PROG_RUN_ARRAY_CHECK(call->prog_array, ctx,
+				       trace_bpf_prog_run);
 
  out:
 	__this_cpu_dec(bpf_prog_active);
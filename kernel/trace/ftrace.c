@@ -373,6 +373,61 @@ static int remove_ftrace_ops(struct ftrace_ops __rcu **list,
 
 static void ftrace_update_trampoline(struct ftrace_ops *ops);
 
+/*
+ * When several ops are registered, every traced function hit pays for
+ * a walk of the full ops list with two filter hash lookups per ops in
+ * __ftrace_ops_list_func().  To avoid redoing that work on each hit,
+ * every registered ops is handed a slot in a per-site match bitmap
+ * and the list func caches the compiled bitmap per ip in a small
+ * percpu table.  Any change to the ops list or to a filter hash
+ * invalidates the whole cache by bumping the generation count.
+ */
+#define FTRACE_DISPATCH_BITS	8
+#define FTRACE_DISPATCH_SIZE	(1 << FTRACE_DISPATCH_BITS)
+
+struct ftrace_dispatch_entry {
+	unsigned long		ip;
+	unsigned long		gen;	/* 0 while being filled */
+	unsigned long		match;	/* bit per ops dispatch slot */
+};
+
+static DEFINE_PER_CPU(struct ftrace_dispatch_entry,
+		      ftrace_dispatch_cache[FTRACE_DISPATCH_SIZE]);
+static unsigned long ftrace_dispatch_gen __read_mostly = 1;
+static DECLARE_BITMAP(ftrace_dispatch_slots, BITS_PER_LONG);
+
+/* Invalidate all cached match bitmaps. Called under ftrace_lock */
+static void ftrace_dispatch_bump_gen(void)
+{
+	unsigned long gen = ftrace_dispatch_gen + 1;
+
+	/* gen == 0 marks a cache entry as being filled */
+	if (!gen)
+		gen = 1;
+	WRITE_ONCE(ftrace_dispatch_gen, gen);
+}
+
+static void ftrace_dispatch_alloc_slot(struct ftrace_ops *ops)
+{
+	int slot = find_first_zero_bit(ftrace_dispatch_slots, BITS_PER_LONG);
+
+	/* More ops than slots: this one falls back to hash testing */
+	if (slot >= BITS_PER_LONG) {
+		ops->dispatch_slot = 0;
+		return;
+	}
+
+	__set_bit(slot, ftrace_dispatch_slots);
+	ops->dispatch_slot = slot + 1;
+}
+
+static void ftrace_dispatch_free_slot(struct ftrace_ops *ops)
+{
+	if (ops->dispatch_slot)
+		__clear_bit(ops->dispatch_slot - 1, ftrace_dispatch_slots);
+	ops->dispatch_slot = 0;
+}
+
 static int __register_ftrace_function(struct ftrace_ops *ops)
 {
 	if (ops->flags & FTRACE_OPS_FL_DELETED)
@@ -398,6 +453,9 @@ static int __register_ftrace_function(struct ftrace_ops *ops)
 	if (!core_kernel_data((unsigned long)ops))
 		ops->flags |= FTRACE_OPS_FL_DYNAMIC;
 
+	ftrace_dispatch_alloc_slot(ops);
+	ftrace_dispatch_bump_gen();
+
 	add_ftrace_ops(&ftrace_ops_list, ops);
 
 	/* Always save the function, and reset at unregistering */
@@ -426,6 +484,9 @@ static int __unregister_ftrace_function(struct ftrace_ops *ops)
 	if (ret < 0)
 		return ret;
 
+	ftrace_dispatch_free_slot(ops);
+	ftrace_dispatch_bump_gen();
+
 	if (ftrace_enabled)
 		update_ftrace_function();
 
@@ -1514,6 +1575,9 @@ ftrace_hash_move(struct ftrace_ops *ops, int enable,
 
 	ftrace_hash_rec_enable_modify(ops, enable);
 
+	/* The cached list-func match bitmaps are stale now */
+	ftrace_dispatch_bump_gen();
+
 	return 0;
 }
 
@@ -1544,12 +1608,19 @@ static bool hash_contains_ip(unsigned long ip,
  * This needs to be called with preemption disabled as
  * the hashes are freed with call_rcu_sched().
  */
-static int
-ftrace_ops_test(struct ftrace_ops *ops, unsigned long ip, void *regs)
+static bool ftrace_ops_hash_test(struct ftrace_ops *ops, unsigned long ip)
 {
 	struct ftrace_ops_hash hash;
-	int ret;
 
+	rcu_assign_pointer(hash.filter_hash, ops->func_hash->filter_hash);
+	rcu_assign_pointer(hash.notrace_hash, ops->func_hash->notrace_hash);
+
+	return hash_contains_ip(ip, &hash);
+}
+
+static int
+ftrace_ops_test(struct ftrace_ops *ops, unsigned long ip, void *regs)
+{
 #ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
 	/*
 	 * There's a small race when adding ops that the ftrace handler
@@ -1560,15 +1631,7 @@ ftrace_ops_test(struct ftrace_ops *ops, unsigned long ip, void *regs)
 		return 0;
 #endif
 
-	rcu_assign_pointer(hash.filter_hash, ops->func_hash->filter_hash);
-	rcu_assign_pointer(hash.notrace_hash, ops->func_hash->notrace_hash);
-
-	if (hash_contains_ip(ip, &hash))
-		ret = 1;
-	else
-		ret = 0;
-
-	return ret;
+	return ftrace_ops_hash_test(ops, ip);
 }
 
 /*
@@ -6259,6 +6322,12 @@ ftrace_ops_test(struct ftrace_ops *ops, unsigned long ip, void *regs)
 	return 1;
 }
 
+static inline bool
+ftrace_ops_hash_test(struct ftrace_ops *ops, unsigned long ip)
+{
+	return true;
+}
+
 static void ftrace_update_trampoline(struct ftrace_ops *ops)
 {
 }
@@ -6293,7 +6362,10 @@ static inline void
 __ftrace_ops_list_func(unsigned long ip, unsigned long parent_ip,
 		       struct ftrace_ops *ignored, struct pt_regs *regs)
 {
+	struct ftrace_dispatch_entry *ent;
+	unsigned long gen, match = 0;
 	struct ftrace_ops *op;
+	bool cached;
 	int bit;
 
 	bit = trace_test_and_set_recursion(TRACE_LIST_START, TRACE_LIST_MAX);
@@ -6306,25 +6378,67 @@ __ftrace_ops_list_func(unsigned long ip, unsigned long parent_ip,
 	 */
 	preempt_disable_notrace();
 
+	ent = this_cpu_ptr(&ftrace_dispatch_cache[hash_long(ip,
+						  FTRACE_DISPATCH_BITS)]);
+	gen = READ_ONCE(ftrace_dispatch_gen);
+	cached = ent->gen == gen && ent->ip == ip;
+	if (cached)
+		match = ent->match;
+
 	do_for_each_ftrace_op(op, ftrace_ops_list) {
+		int slot = op->dispatch_slot;
+		bool hit;
+
 		/*
-		 * Check the following for each ops before calling their func:
+		 * The filter hash verdict for this ip comes from the
+		 * dispatch cache when valid, otherwise it is computed
+		 * and compiled into the bitmap for the next hit.
+		 */
+		if (cached && slot) {
+			hit = match & (1UL << (slot - 1));
+		} else {
+			hit = ftrace_ops_hash_test(op, ip);
+			if (hit && slot)
+				match |= 1UL << (slot - 1);
+		}
+
+		if (!hit)
+			continue;
+
+		/*
+		 * These constraints are per call, not per site, so they
+		 * stay outside the cached verdict:
 		 *  if RCU flag is set, then rcu_is_watching() must be true
-		 *  if PER_CPU is set, then ftrace_function_local_disable()
-		 *                          must be false
-		 *  Otherwise test if the ip matches the ops filter
-		 *
-		 * If any of the above fails then the op->func() is not executed.
+		 *  if the ops wants regs, they must have been saved
 		 */
-		if ((!(op->flags & FTRACE_OPS_FL_RCU) || rcu_is_watching()) &&
-		    ftrace_ops_test(op, ip, regs)) {
-			if (FTRACE_WARN_ON(!op->func)) {
-				pr_warn("op=%p %pS\n", op, op);
-				goto out;
-			}
-			op->func(ip, parent_ip, op, regs);
+		if ((op->flags & FTRACE_OPS_FL_RCU) && !rcu_is_watching())
+			continue;
+#ifdef CONFIG_DYNAMIC_FTRACE_WITH_REGS
+		if (regs == NULL && (op->flags & FTRACE_OPS_FL_SAVE_REGS))
+			continue;
+#endif
+
+		if (FTRACE_WARN_ON(!op->func)) {
+			pr_warn("op=%p %pS\n", op, op);
+			goto out;
 		}
+		op->func(ip, parent_ip, op, regs);
 	} while_for_each_ftrace_op(op);
+
+	/*
+	 * Only process context fills the cache, so a nested list func
+	 * from irq/NMI cannot interleave with a fill in progress.
+	 * gen == 0 keeps same-cpu readers away until the entry is
+	 * complete.
+	 */
+	if (!cached && !in_interrupt()) {
+		WRITE_ONCE(ent->gen, 0);
+		barrier();
+		WRITE_ONCE(ent->ip, ip);
+		WRITE_ONCE(ent->match, match);
+		barrier();
+		WRITE_ONCE(ent->gen, gen);
+	}
 out:
 	preempt_enable_notrace();
 	trace_clear_recursion(bit);
@@ -23,6 +23,10 @@
 #include <linux/list.h>
 #include <linux/cpu.h>
 
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+#include <linux/lz4.h>
+#endif
+
 #include <asm/local.h>
 
 static void update_pages_handler(struct work_struct *work);
@@ -488,6 +492,11 @@ struct ring_buffer {
 	u64				(*clock)(void);
 
 	struct rb_irq_work		irq_work;
+
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+	struct mutex			lz4_mutex;
+	void				*lz4_state; /* LZ4 workmem, lazy */
+#endif
 };
 
 struct ring_buffer_iter {
@@ -1336,6 +1345,9 @@ struct ring_buffer *__ring_buffer_alloc(unsigned long size, unsigned flags,
 		goto fail_free_buffers;
 
 	mutex_init(&buffer->mutex);
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+	mutex_init(&buffer->lz4_mutex);
+#endif
 
 	return buffer;
 
@@ -1372,6 +1384,9 @@ ring_buffer_free(struct ring_buffer *buffer)
 	kfree(buffer->buffers);
 	free_cpumask_var(buffer->cpumask);
 
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+	kfree(buffer->lz4_state);
+#endif
 	kfree(buffer);
 }
 EXPORT_SYMBOL_GPL(ring_buffer_free);
@@ -4651,6 +4666,103 @@ int ring_buffer_read_page(struct ring_buffer *buffer,
 }
 EXPORT_SYMBOL_GPL(ring_buffer_read_page);
 
+#ifdef CONFIG_RING_BUFFER_COMPRESS
+/*
+ * Compressed sub-buffer format: the page starts with this header,
+ * immediately followed by an LZ4 block. Sub-buffers are compressed
+ * once they have been closed and extracted by ring_buffer_read_page();
+ * earlier than that the lock-free writer protocol does not allow
+ * touching them from the side.
+ */
+#define RB_LZ4_MAGIC	0x4c5a3452	/* "R4ZL" */
+
+struct buffer_data_page_lz4 {
+	u32	magic;
+	u32	comp_len;	/* LZ4 block bytes following the header */
+	u32	orig_len;	/* uncompressed sub-buffer bytes */
+};
+
+/**
+ * ring_buffer_compress_page - compress an extracted sub-buffer
+ * @buffer: the buffer the sub-buffer was read from
+ * @src: data page filled in by ring_buffer_read_page()
+ * @dst: destination buffer of @len bytes
+ * @len: size of @dst
+ *
+ * Only the used part of the sub-buffer (header plus committed data) is
+ * compressed. Compressions on @buffer are serialized internally; the
+ * LZ4 working memory is allocated on first use. May sleep.
+ *
+ * Returns the number of bytes written to @dst, -EFBIG when the data
+ * did not fit (i.e. did not compress), otherwise a negative errno.
+ */
+int ring_buffer_compress_page(struct ring_buffer *buffer, void *src,
+			      void *dst, size_t len)
+{
+	struct buffer_data_page *bpage = src;
+	struct buffer_data_page_lz4 *hdr = dst;
+	size_t orig_len = BUF_PAGE_HDR_SIZE +
+			  (local_read(&bpage->commit) & ~RB_MISSED_FLAGS);
+	int comp_len;
+
+	if (len <= sizeof(*hdr))
+		return -EINVAL;
+
+	mutex_lock(&buffer->lz4_mutex);
+	if (!buffer->lz4_state) {
+		buffer->lz4_state = kmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+		if (!buffer->lz4_state) {
+			mutex_unlock(&buffer->lz4_mutex);
+			return -ENOMEM;
+		}
+	}
+	comp_len = LZ4_compress_default(src, dst + sizeof(*hdr), orig_len,
+					len - sizeof(*hdr),
+					buffer->lz4_state);
+	mutex_unlock(&buffer->lz4_mutex);
+
+	if (comp_len <= 0)
+		return -EFBIG;
+
+	hdr->magic = RB_LZ4_MAGIC;
+	hdr->comp_len = comp_len;
+	hdr->orig_len = orig_len;
+	return sizeof(*hdr) + comp_len;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_compress_page);
+
+/**
+ * ring_buffer_decompress_page - expand a compressed sub-buffer
+ * @dst: destination for the data page, @dst_len bytes
+ * @dst_len: size of @dst; at least the original sub-buffer size
+ * @src: compressed sub-buffer from ring_buffer_compress_page()
+ * @src_len: number of valid bytes at @src
+ *
+ * The result is a data page as ring_buffer_read_page() would have
+ * produced it. Stateless, and usable on any context's data.
+ *
+ * Returns the uncompressed size, or -EINVAL on malformed input.
+ */
+int ring_buffer_decompress_page(void *dst, size_t dst_len,
+				const void *src, size_t src_len)
+{
+	const struct buffer_data_page_lz4 *hdr = src;
+	int ret;
+
+	if (src_len < sizeof(*hdr) || hdr->magic != RB_LZ4_MAGIC ||
+	    hdr->comp_len > src_len - sizeof(*hdr) ||
+	    hdr->orig_len > dst_len)
+		return -EINVAL;
+
+	ret = LZ4_decompress_safe(src + sizeof(*hdr), dst, hdr->comp_len,
+				  hdr->orig_len);
+	if (ret != hdr->orig_len)
+		return -EINVAL;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(ring_buffer_decompress_page);
+#endif /* CONFIG_RING_BUFFER_COMPRESS */
+
 /*
  * We only allocate new buffers, never free them if the CPU goes down.
  * If we were to free the buffer, then the user would lose any trace that was in
@@ -9,6 +9,9 @@
 #include <uapi/linux/sched/types.h>
 #include <linux/module.h>
 #include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched/clock.h>
+#include <linux/slab.h>
 #include <asm/local.h>
 
 struct rb_page {
@@ -59,8 +62,19 @@ MODULE_PARM_DESC(producer_fifo, "fifo prio for producer");
 module_param(consumer_fifo, int, 0644);
 MODULE_PARM_DESC(consumer_fifo, "fifo prio for consumer");
 
+static unsigned int test_compress;
+module_param(test_compress, uint, 0644);
+MODULE_PARM_DESC(test_compress, "also compress read pages and report raw vs compressed volume");
+
 static int read_events;
 
+static void *compress_buf;
+static void *decompress_buf;
+static u64 compress_in;
+static u64 compress_out;
+static u64 compress_time;
+static unsigned long compress_fail;
+
 static int test_error;
 
 #define TEST_ERROR()				\
@@ -171,6 +185,28 @@ static enum event_status read_page(int cpu)
 			}
 		}
 	}
+
+	if (test_compress && compress_buf && ret >= 0) {
+		u64 t0 = local_clock();
+		int csize;
+
+		csize = ring_buffer_compress_page(buffer, bpage,
+						  compress_buf, PAGE_SIZE);
+		compress_time += local_clock() - t0;
+		if (csize > 0) {
+			compress_in += commit + offsetof(struct rb_page, data);
+			compress_out += csize;
+			/* verify the round trip while we are at it */
+			if (decompress_buf &&
+			    ring_buffer_decompress_page(decompress_buf,
+							PAGE_SIZE, compress_buf,
+							csize) < 0)
+				TEST_ERROR();
+		} else {
+			compress_fail++;
+		}
+	}
+
 	ring_buffer_free_read_page(buffer, cpu, bpage);
 
 	if (ret < 0)
@@ -342,6 +378,17 @@ static void ring_buffer_producer(void)
 
 	trace_printk("Entries per millisec: %ld\n", hit);
 
+	if (test_compress && compress_in) {
+		u64 usecs = compress_time;
+
+		do_div(usecs, NSEC_PER_USEC);
+		trace_printk("Compressed: %llu -> %llu bytes (ratio: %llu%%)\n",
+			     compress_in, compress_out,
+			     div64_u64(compress_out * 100, compress_in));
+		trace_printk("Compression time: %llu usecs  failures: %lu\n",
+			     usecs, compress_fail);
+	}
+
 	if (hit) {
 		/* Calculate the average time in nanosecs */
 		avg = NSEC_PER_MSEC / hit;
@@ -435,6 +482,11 @@ static int __init ring_buffer_benchmark_init(void)
 	if (!buffer)
 		return -ENOMEM;
 
+	if (test_compress) {
+		compress_buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+		decompress_buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	}
+
 	if (!disable_reader) {
 		consumer = kthread_create(ring_buffer_consumer_thread,
 					  NULL, "rb_consumer");
@@ -478,6 +530,8 @@ static int __init ring_buffer_benchmark_init(void)
 		kthread_stop(consumer);
 
  out_fail:
+	kfree(decompress_buf);
+	kfree(compress_buf);
 	ring_buffer_free(buffer);
 	return ret;
 }
@@ -487,6 +541,8 @@ static void __exit ring_buffer_benchmark_exit(void)
 	kthread_stop(producer);
 	if (consumer)
 		kthread_stop(consumer);
+	kfree(decompress_buf);
+	kfree(compress_buf);
 	ring_buffer_free(buffer);
 }
 
@@ -4661,6 +4661,7 @@ static const char readme_msg[] =
 	"\t            [:values=<field1[,field2,...]>]\n"
 	"\t            [:sort=<field1[,field2,...]>]\n"
 	"\t            [:size=#entries]\n"
+	"\t            [:numa]\n"
 	"\t            [:pause][:continue][:clear]\n"
 	"\t            [:name=histname1]\n"
 	"\t            [if <filter>]\n\n"
@@ -4676,6 +4677,10 @@ static const char readme_msg[] =
 	"\t    be modified by appending '.descending' or '.ascending' to a\n"
 	"\t    sort field.  The 'size' parameter can be used to specify more\n"
 	"\t    or fewer than the default 2048 entries for the hashtable size.\n"
+	"\t    The 'numa' parameter partitions the hashtable into one\n"
+	"\t    sub-table of 'size' entries per NUMA node, keeping the\n"
+	"\t    aggregation atomics node-local on hot events; the partial\n"
+	"\t    per-node sums are merged when the histogram is read.\n"
 	"\t    If a hist trigger is given a name using the 'name' parameter,\n"
 	"\t    its histogram data will be shared with other triggers of the\n"
 	"\t    same name, and trigger hits will update this common data.\n\n"
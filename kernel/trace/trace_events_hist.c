@@ -18,6 +18,8 @@
 #include <linux/kallsyms.h>
 #include <linux/mutex.h>
 #include <linux/slab.h>
+#include <linux/ctype.h>
+#include <linux/sched/clock.h>
 #include <linux/stacktrace.h>
 #include <linux/rculist.h>
 
@@ -115,6 +117,12 @@ DEFINE_HIST_FIELD_FN(u8);
 #define HITCOUNT_IDX		0
 #define HIST_KEY_SIZE_MAX	(MAX_FILTER_STR_VAL + HIST_STACKTRACE_SIZE)
 
+/* a .log2 key on a u64 field can produce at most 64 distinct buckets */
+#define HIST_LOG2_BUCKETS	64
+
+/* minimum interval between percentile alarm evaluations */
+#define HIST_PALARM_PERIOD	(HZ / 10)
+
 enum hist_field_flags {
 	HIST_FIELD_FL_HITCOUNT		= 1 << 0,
 	HIST_FIELD_FL_KEY		= 1 << 1,
@@ -133,10 +141,14 @@ struct hist_trigger_attrs {
 	char		*vals_str;
 	char		*sort_key_str;
 	char		*name;
+	char		*palarm_str;
 	bool		pause;
 	bool		cont;
 	bool		clear;
+	bool		numa;
 	unsigned int	map_bits;
+	unsigned int	palarm_pct;	/* tenths of a percent, 1..999 */
+	unsigned int	palarm_bucket;
 };
 
 struct hist_trigger_data {
@@ -150,6 +162,12 @@ struct hist_trigger_data {
 	struct trace_event_file		*event_file;
 	struct hist_trigger_attrs	*attrs;
 	struct tracing_map		*map;
+	int				log2_key_idx;
+	u64				last_hits;
+	u64				last_show_ts;
+	u64				*palarm_counts;
+	unsigned long			palarm_last_check;
+	bool				palarm_on;
 };
 
 static const char *hist_field_name(struct hist_field *field,
@@ -235,6 +253,7 @@ static void destroy_hist_trigger_attrs(struct hist_trigger_attrs *attrs)
 	if (!attrs)
 		return;
 
+	kfree(attrs->palarm_str);
 	kfree(attrs->name);
 	kfree(attrs->sort_key_str);
 	kfree(attrs->keys_str);
@@ -242,6 +261,57 @@ static void destroy_hist_trigger_attrs(struct hist_trigger_attrs *attrs)
 	kfree(attrs);
 }
 
+/*
+ * palarm=<pct>,<bucket>
+ *
+ * <pct> is a percentile with at most one fractional digit (e.g. 50,
+ * 99, 99.9), <bucket> is a log2 bucket.  Whenever the <pct>'th
+ * percentile of the histogram reaches bucket <bucket> or above, an
+ * alarm is written to the trace stream.  Requires a single .log2 key.
+ */
+static int parse_palarm(struct hist_trigger_attrs *attrs, char *str)
+{
+	char *pct_str, *sep;
+	unsigned int pct, frac = 0, bucket;
+	int ret;
+
+	attrs->palarm_str = kstrdup(str, GFP_KERNEL);
+	if (!attrs->palarm_str)
+		return -ENOMEM;
+
+	strsep(&str, "=");
+	if (!str)
+		return -EINVAL;
+
+	pct_str = strsep(&str, ",");
+	if (!pct_str || !str)
+		return -EINVAL;
+
+	sep = strchr(pct_str, '.');
+	if (sep) {
+		*sep++ = '\0';
+		if (strlen(sep) != 1 || !isdigit(*sep))
+			return -EINVAL;
+		frac = *sep - '0';
+	}
+
+	ret = kstrtouint(pct_str, 10, &pct);
+	if (ret)
+		return ret;
+
+	ret = kstrtouint(str, 10, &bucket);
+	if (ret)
+		return ret;
+
+	if (pct >= 100 || (!pct && !frac) || bucket >= HIST_LOG2_BUCKETS)
+		return -EINVAL;
+
+	attrs->palarm_pct = pct * 10 + frac;
+	attrs->palarm_bucket = bucket;
+
+	return 0;
+}
+
 static struct hist_trigger_attrs *parse_hist_trigger_attrs(char *trigger_str)
 {
 	struct hist_trigger_attrs *attrs;
@@ -272,7 +342,13 @@ static struct hist_trigger_attrs *parse_hist_trigger_attrs(char *trigger_str)
 			attrs->cont = true;
 		else if (strcmp(str, "clear") == 0)
 			attrs->clear = true;
-		else if (strncmp(str, "size=", strlen("size=")) == 0) {
+		else if (strcmp(str, "numa") == 0)
+			attrs->numa = true;
+		else if (strncmp(str, "palarm=", strlen("palarm=")) == 0) {
+			ret = parse_palarm(attrs, str);
+			if (ret)
+				goto free;
+		} else if (strncmp(str, "size=", strlen("size=")) == 0) {
 			int map_bits = parse_map_size(str);
 
 			if (map_bits < 0) {
@@ -773,6 +849,7 @@ static void destroy_hist_data(struct hist_trigger_data *hist_data)
 	destroy_hist_trigger_attrs(hist_data->attrs);
 	destroy_hist_fields(hist_data);
 	tracing_map_destroy(hist_data->map);
+	kfree(hist_data->palarm_counts);
 	kfree(hist_data);
 }
 
@@ -849,6 +926,25 @@ create_hist_data(unsigned int map_bits,
 	if (ret)
 		goto free;
 
+	hist_data->log2_key_idx = -1;
+	if (hist_data->n_keys == 1 &&
+	    (hist_data->fields[hist_data->n_vals]->flags & HIST_FIELD_FL_LOG2))
+		hist_data->log2_key_idx = hist_data->n_vals;
+
+	if (attrs->palarm_str) {
+		if (hist_data->log2_key_idx < 0) {
+			ret = -EINVAL;
+			goto free;
+		}
+		hist_data->palarm_counts =
+			kcalloc(HIST_LOG2_BUCKETS, sizeof(u64), GFP_KERNEL);
+		if (!hist_data->palarm_counts) {
+			ret = -ENOMEM;
+			goto free;
+		}
+		hist_data->palarm_last_check = jiffies;
+	}
+
 	if (need_tracing_map_ops(hist_data))
 		map_ops = &hist_trigger_elt_comm_ops;
 
@@ -864,6 +960,12 @@ create_hist_data(unsigned int map_bits,
 	if (ret)
 		goto free;
 
+	if (attrs->numa) {
+		ret = tracing_map_numa_partition(hist_data->map);
+		if (ret)
+			goto free;
+	}
+
 	ret = tracing_map_init(hist_data->map);
 	if (ret)
 		goto free;
@@ -920,6 +1022,114 @@ static inline void add_to_key(char *compound_key, void *key,
 	memcpy(compound_key + key_field->offset, key, size);
 }
 
+/*
+ * Collect the per-bucket hitcounts of a single-.log2-key histogram.
+ *
+ * This walks the claimed map elements directly rather than going
+ * through tracing_map_sort_entries(), so it can run from the event
+ * path without allocating.  The walk races with concurrent inserts;
+ * an element claimed but not yet filled in contributes nothing of
+ * consequence since out-of-range buckets are skipped and sums read
+ * atomically.
+ */
+static u64 hist_log2_dist_map(struct tracing_map *map, u64 *counts)
+{
+	struct tracing_map_elt *elt;
+	unsigned int i, n_elts;
+	u64 bucket, hits, total = 0;
+
+	n_elts = min_t(unsigned int, atomic_read(&map->next_elt) + 1,
+		       map->max_elts);
+
+	for (i = 0; i < n_elts; i++) {
+		elt = *TRACING_MAP_ELT(map->elts, i);
+		bucket = *(u64 *)elt->key;
+		if (bucket >= HIST_LOG2_BUCKETS)
+			continue;
+		hits = tracing_map_read_sum(elt, HITCOUNT_IDX);
+		counts[bucket] += hits;
+		total += hits;
+	}
+
+	return total;
+}
+
+static u64 hist_log2_dist(struct hist_trigger_data *hist_data, u64 *counts)
+{
+	struct tracing_map *map = hist_data->map;
+	unsigned int i;
+	u64 total = 0;
+
+	memset(counts, 0, HIST_LOG2_BUCKETS * sizeof(*counts));
+
+	/* a NUMA-partitioned map holds its elements in per-node sub-maps */
+	if (map->n_node_maps) {
+		for (i = 0; i < map->n_node_maps; i++)
+			if (map->node_maps[i])
+				total += hist_log2_dist_map(map->node_maps[i],
+							    counts);
+	} else {
+		total = hist_log2_dist_map(map, counts);
+	}
+
+	return total;
+}
+
+/* pct_tenths is a percentile in tenths of a percent (p99.9 == 999) */
+static unsigned int hist_log2_percentile(const u64 *counts, u64 total,
+					 unsigned int pct_tenths)
+{
+	u64 thresh = div64_u64(total * pct_tenths + 999, 1000);
+	u64 cum = 0;
+	unsigned int i;
+
+	for (i = 0; i < HIST_LOG2_BUCKETS; i++) {
+		cum += counts[i];
+		if (cum >= thresh)
+			break;
+	}
+
+	return i < HIST_LOG2_BUCKETS ? i : HIST_LOG2_BUCKETS - 1;
+}
+
+static void hist_palarm_check(struct hist_trigger_data *hist_data)
+{
+	unsigned long last = READ_ONCE(hist_data->palarm_last_check);
+	struct hist_trigger_attrs *attrs = hist_data->attrs;
+	unsigned int bucket;
+	u64 total;
+
+	if (time_before(jiffies, last + HIST_PALARM_PERIOD))
+		return;
+
+	/* only the winner scans; palarm_counts is not otherwise locked */
+	if (cmpxchg(&hist_data->palarm_last_check, last, jiffies) != last)
+		return;
+
+	total = hist_log2_dist(hist_data, hist_data->palarm_counts);
+	if (!total)
+		return;
+
+	bucket = hist_log2_percentile(hist_data->palarm_counts, total,
+				      attrs->palarm_pct);
+
+	if (bucket < attrs->palarm_bucket) {
+		hist_data->palarm_on = false;
+		return;
+	}
+
+	/* fire once per crossing, not once per check period */
+	if (hist_data->palarm_on)
+		return;
+	hist_data->palarm_on = true;
+
+	trace_array_printk(hist_data->event_file->tr, _THIS_IP_,
+			   "hist palarm: %s: p%u.%u reached ~ 2^%u (threshold 2^%u)\n",
+			   trace_event_name(hist_data->event_file->event_call),
+			   attrs->palarm_pct / 10, attrs->palarm_pct % 10,
+			   bucket, attrs->palarm_bucket);
+}
+
 static void event_hist_trigger(struct event_trigger_data *data, void *rec)
 {
 	struct hist_trigger_data *hist_data = data->private_data;
@@ -967,6 +1177,9 @@ static void event_hist_trigger(struct event_trigger_data *data, void *rec)
 	elt = tracing_map_insert(hist_data->map, key);
 	if (elt)
 		hist_trigger_elt_update(hist_data, elt, rec);
+
+	if (hist_data->palarm_counts)
+		hist_palarm_check(hist_data);
 }
 
 static void hist_trigger_stacktrace_print(struct seq_file *m,
@@ -1102,6 +1315,44 @@ static int print_entries(struct seq_file *m,
 	return n_entries;
 }
 
+/*
+ * Percentiles are derived from the log2 buckets at read-out time, and
+ * the hit rate from the hits delta since the previous read of this
+ * file, so neither adds any cost to the event path.  Caller holds
+ * event_mutex, which serializes updates of last_hits/last_show_ts.
+ */
+static void hist_trigger_show_stats(struct seq_file *m,
+				    struct hist_trigger_data *hist_data)
+{
+	u64 hits = tracing_map_hits(hist_data->map);
+	u64 now = local_clock();
+
+	if (hist_data->log2_key_idx >= 0) {
+		u64 counts[HIST_LOG2_BUCKETS];
+		u64 total = hist_log2_dist(hist_data, counts);
+
+		if (total)
+			seq_printf(m, "    p50: ~ 2^%-2u p99: ~ 2^%-2u p99.9: ~ 2^%-2u\n",
+				   hist_log2_percentile(counts, total, 500),
+				   hist_log2_percentile(counts, total, 990),
+				   hist_log2_percentile(counts, total, 999));
+	}
+
+	/* hits can move backwards across a clear; skip that window */
+	if (hist_data->last_show_ts && now > hist_data->last_show_ts &&
+	    hits >= hist_data->last_hits) {
+		u64 win_ns = now - hist_data->last_show_ts;
+		u64 rate = div64_u64((hits - hist_data->last_hits) *
+				     NSEC_PER_SEC, win_ns);
+
+		seq_printf(m, "    Rate: %llu hits/sec (%llu ms window)\n",
+			   rate, div64_u64(win_ns, NSEC_PER_MSEC));
+	}
+
+	hist_data->last_show_ts = now;
+	hist_data->last_hits = hits;
+}
+
 static void hist_trigger_show(struct seq_file *m,
 			      struct event_trigger_data *data, int n)
 {
@@ -1121,8 +1372,10 @@ static void hist_trigger_show(struct seq_file *m,
 		n_entries = 0;
 
 	seq_printf(m, "\nTotals:\n    Hits: %llu\n    Entries: %u\n    Dropped: %llu\n",
-		   (u64)atomic64_read(&hist_data->map->hits),
-		   n_entries, (u64)atomic64_read(&hist_data->map->drops));
+		   tracing_map_hits(hist_data->map),
+		   n_entries, tracing_map_drops(hist_data->map));
+
+	hist_trigger_show_stats(m, hist_data);
 }
 
 static int hist_show(struct seq_file *m, void *v)
@@ -1260,6 +1513,12 @@ static int event_hist_trigger_print(struct seq_file *m,
 
 	seq_printf(m, ":size=%u", (1 << hist_data->map->map_bits));
 
+	if (hist_data->attrs->numa)
+		seq_puts(m, ":numa");
+
+	if (hist_data->attrs->palarm_str)
+		seq_printf(m, ":%s", hist_data->attrs->palarm_str);
+
 	if (data->filter_str)
 		seq_printf(m, " if %s", data->filter_str);
 
@@ -1409,6 +1668,14 @@ static bool hist_trigger_match(struct event_trigger_data *data,
 	    hist_data->n_sort_keys != hist_data_test->n_sort_keys)
 		return false;
 
+	if (hist_data->attrs->palarm_pct != hist_data_test->attrs->palarm_pct ||
+	    hist_data->attrs->palarm_bucket !=
+	    hist_data_test->attrs->palarm_bucket)
+		return false;
+
+	if (hist_data->attrs->numa != hist_data_test->attrs->numa)
+		return false;
+
 	if (!ignore_filter) {
 		if ((data->filter_str && !data_test->filter_str) ||
 		   (!data->filter_str && data_test->filter_str))
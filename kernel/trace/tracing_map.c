@@ -24,6 +24,7 @@
 #include <linux/jhash.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
+#include <linux/topology.h>
 
 #include "tracing_map.h"
 #include "trace.h"
@@ -237,12 +238,14 @@ void tracing_map_array_free(struct tracing_map_array *a)
 }
 
 struct tracing_map_array *tracing_map_array_alloc(unsigned int n_elts,
-						  unsigned int entry_size)
+						  unsigned int entry_size,
+						  int node)
 {
 	struct tracing_map_array *a;
+	struct page *page;
 	unsigned int i;
 
-	a = kzalloc(sizeof(*a), GFP_KERNEL);
+	a = kzalloc_node(sizeof(*a), GFP_KERNEL, node);
 	if (!a)
 		return NULL;
 
@@ -254,14 +257,15 @@ struct tracing_map_array *tracing_map_array_alloc(unsigned int n_elts,
 	a->entry_shift = fls(a->entries_per_page) - 1;
 	a->entry_mask = (1 << a->entry_shift) - 1;
 
-	a->pages = kcalloc(a->n_pages, sizeof(void *), GFP_KERNEL);
+	a->pages = kcalloc_node(a->n_pages, sizeof(void *), GFP_KERNEL, node);
 	if (!a->pages)
 		goto free;
 
 	for (i = 0; i < a->n_pages; i++) {
-		a->pages[i] = (void *)get_zeroed_page(GFP_KERNEL);
-		if (!a->pages[i])
+		page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+		if (!page)
 			goto free;
+		a->pages[i] = page_address(page);
 	}
  out:
 	return a;
@@ -315,19 +319,20 @@ static struct tracing_map_elt *tracing_map_elt_alloc(struct tracing_map *map)
 	struct tracing_map_elt *elt;
 	int err = 0;
 
-	elt = kzalloc(sizeof(*elt), GFP_KERNEL);
+	elt = kzalloc_node(sizeof(*elt), GFP_KERNEL, map->node);
 	if (!elt)
 		return ERR_PTR(-ENOMEM);
 
 	elt->map = map;
 
-	elt->key = kzalloc(map->key_size, GFP_KERNEL);
+	elt->key = kzalloc_node(map->key_size, GFP_KERNEL, map->node);
 	if (!elt->key) {
 		err = -ENOMEM;
 		goto free;
 	}
 
-	elt->fields = kcalloc(map->n_fields, sizeof(*elt->fields), GFP_KERNEL);
+	elt->fields = kcalloc_node(map->n_fields, sizeof(*elt->fields),
+				   GFP_KERNEL, map->node);
 	if (!elt->fields) {
 		err = -ENOMEM;
 		goto free;
@@ -383,7 +388,8 @@ static int tracing_map_alloc_elts(struct tracing_map *map)
 	unsigned int i;
 
 	map->elts = tracing_map_array_alloc(map->max_elts,
-					    sizeof(struct tracing_map_elt *));
+					    sizeof(struct tracing_map_elt *),
+					    map->node);
 	if (!map->elts)
 		return -ENOMEM;
 
@@ -400,6 +406,85 @@ static int tracing_map_alloc_elts(struct tracing_map *map)
 	return 0;
 }
 
+static struct tracing_map *tracing_map_create_node(unsigned int map_bits,
+						   unsigned int key_size,
+						   const struct tracing_map_ops *ops,
+						   void *private_data,
+						   int node);
+
+static void tracing_map_free_node_maps(struct tracing_map *map)
+{
+	unsigned int i;
+
+	if (!map->node_maps)
+		return;
+
+	for (i = 0; i < nr_node_ids; i++)
+		tracing_map_destroy(map->node_maps[i]);
+
+	kfree(map->node_maps);
+	map->node_maps = NULL;
+	map->n_node_maps = 0;
+}
+
+static int tracing_map_init_node_maps(struct tracing_map *map)
+{
+	struct tracing_map *node_map;
+	int node, err;
+
+	map->node_maps = kcalloc(nr_node_ids, sizeof(*map->node_maps),
+				 GFP_KERNEL);
+	if (!map->node_maps)
+		return -ENOMEM;
+
+	for_each_node(node) {
+		node_map = tracing_map_create_node(map->map_bits,
+						   map->key_size,
+						   map->ops,
+						   map->private_data,
+						   node);
+		if (IS_ERR(node_map)) {
+			err = PTR_ERR(node_map);
+			goto free;
+		}
+
+		memcpy(node_map->fields, map->fields, sizeof(map->fields));
+		node_map->n_fields = map->n_fields;
+		memcpy(node_map->key_idx, map->key_idx, sizeof(map->key_idx));
+		node_map->n_keys = map->n_keys;
+
+		map->node_maps[node] = node_map;
+
+		err = tracing_map_init(node_map);
+		if (err)
+			goto free;
+	}
+	map->n_node_maps = nr_node_ids;
+
+	/* all insertions go to the sub-maps; the front-end table is unused */
+	tracing_map_array_free(map->map);
+	map->map = NULL;
+
+	return 0;
+ free:
+	tracing_map_free_node_maps(map);
+
+	return err;
+}
+
+static struct tracing_map *tracing_map_node_map(struct tracing_map *map)
+{
+	struct tracing_map *node_map = NULL;
+	int node = numa_node_id();
+
+	if (likely((unsigned int)node < map->n_node_maps))
+		node_map = map->node_maps[node];
+	if (unlikely(!node_map))
+		node_map = map->node_maps[first_node(node_possible_map)];
+
+	return node_map;
+}
+
 static inline bool keys_match(void *key, void *test_key, unsigned key_size)
 {
 	bool match = true;
@@ -500,6 +585,9 @@ __tracing_map_insert(struct tracing_map *map, void *key, bool lookup_only)
  */
 struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
 {
+	if (map->n_node_maps)
+		map = tracing_map_node_map(map);
+
 	return __tracing_map_insert(map, key, false);
 }
 
@@ -522,7 +610,27 @@ struct tracing_map_elt *tracing_map_insert(struct tracing_map *map, void *key)
  */
 struct tracing_map_elt *tracing_map_lookup(struct tracing_map *map, void *key)
 {
-	return __tracing_map_insert(map, key, true);
+	struct tracing_map_elt *elt;
+	unsigned int i;
+
+	if (!map->n_node_maps)
+		return __tracing_map_insert(map, key, true);
+
+	/*
+	 * A NUMA-partitioned map can hold the key on any node; return
+	 * the first sub-map's element.  Its sums are that node's
+	 * partial aggregate only - fully merged values are available
+	 * via tracing_map_sort_entries().
+	 */
+	for (i = 0; i < map->n_node_maps; i++) {
+		if (!map->node_maps[i])
+			continue;
+		elt = __tracing_map_insert(map->node_maps[i], key, true);
+		if (elt)
+			return elt;
+	}
+
+	return NULL;
 }
 
 /**
@@ -540,6 +648,7 @@ void tracing_map_destroy(struct tracing_map *map)
 	if (!map)
 		return;
 
+	tracing_map_free_node_maps(map);
 	tracing_map_free_elts(map);
 
 	tracing_map_array_free(map->map);
@@ -565,6 +674,13 @@ void tracing_map_clear(struct tracing_map *map)
 	atomic64_set(&map->hits, 0);
 	atomic64_set(&map->drops, 0);
 
+	if (map->n_node_maps) {
+		for (i = 0; i < map->n_node_maps; i++)
+			if (map->node_maps[i])
+				tracing_map_clear(map->node_maps[i]);
+		return;
+	}
+
 	tracing_map_array_clear(map->map);
 
 	for (i = 0; i < map->max_elts; i++)
@@ -574,7 +690,59 @@ void tracing_map_clear(struct tracing_map *map)
 static void set_sort_key(struct tracing_map *map,
 			 struct tracing_map_sort_key *sort_key)
 {
+	unsigned int i;
+
 	map->sort_key = *sort_key;
+
+	/* the cmp functions reach the sort key through elt->map */
+	for (i = 0; i < map->n_node_maps; i++)
+		if (map->node_maps[i])
+			map->node_maps[i]->sort_key = *sort_key;
+}
+
+static struct tracing_map *tracing_map_create_node(unsigned int map_bits,
+						   unsigned int key_size,
+						   const struct tracing_map_ops *ops,
+						   void *private_data,
+						   int node)
+{
+	struct tracing_map *map;
+	unsigned int i;
+
+	if (map_bits < TRACING_MAP_BITS_MIN ||
+	    map_bits > TRACING_MAP_BITS_MAX)
+		return ERR_PTR(-EINVAL);
+
+	map = kzalloc_node(sizeof(*map), GFP_KERNEL, node);
+	if (!map)
+		return ERR_PTR(-ENOMEM);
+
+	map->map_bits = map_bits;
+	map->max_elts = (1 << map_bits);
+	atomic_set(&map->next_elt, -1);
+	map->node = node;
+
+	map->map_size = (1 << (map_bits + 1));
+	map->ops = ops;
+
+	map->private_data = private_data;
+
+	map->map = tracing_map_array_alloc(map->map_size,
+					   sizeof(struct tracing_map_entry),
+					   map->node);
+	if (!map->map)
+		goto free;
+
+	map->key_size = key_size;
+	for (i = 0; i < TRACING_MAP_KEYS_MAX; i++)
+		map->key_idx[i] = -1;
+ out:
+	return map;
+ free:
+	tracing_map_destroy(map);
+	map = ERR_PTR(-ENOMEM);
+
+	goto out;
 }
 
 /**
@@ -632,41 +800,8 @@ struct tracing_map *tracing_map_create(unsigned int map_bits,
 				       const struct tracing_map_ops *ops,
 				       void *private_data)
 {
-	struct tracing_map *map;
-	unsigned int i;
-
-	if (map_bits < TRACING_MAP_BITS_MIN ||
-	    map_bits > TRACING_MAP_BITS_MAX)
-		return ERR_PTR(-EINVAL);
-
-	map = kzalloc(sizeof(*map), GFP_KERNEL);
-	if (!map)
-		return ERR_PTR(-ENOMEM);
-
-	map->map_bits = map_bits;
-	map->max_elts = (1 << map_bits);
-	atomic_set(&map->next_elt, -1);
-
-	map->map_size = (1 << (map_bits + 1));
-	map->ops = ops;
-
-	map->private_data = private_data;
-
-	map->map = tracing_map_array_alloc(map->map_size,
-					   sizeof(struct tracing_map_entry));
-	if (!map->map)
-		goto free;
-
-	map->key_size = key_size;
-	for (i = 0; i < TRACING_MAP_KEYS_MAX; i++)
-		map->key_idx[i] = -1;
- out:
-	return map;
- free:
-	tracing_map_destroy(map);
-	map = ERR_PTR(-ENOMEM);
-
-	goto out;
+	return tracing_map_create_node(map_bits, key_size, ops, private_data,
+				       NUMA_NO_NODE);
 }
 
 /**
@@ -695,6 +830,9 @@ int tracing_map_init(struct tracing_map *map)
 	if (map->n_fields < 2)
 		return -EINVAL; /* need at least 1 key and 1 val */
 
+	if (map->numa_partition)
+		return tracing_map_init_node_maps(map);
+
 	err = tracing_map_alloc_elts(map);
 	if (err)
 		return err;
@@ -704,6 +842,77 @@ int tracing_map_init(struct tracing_map *map)
 	return err;
 }
 
+/**
+ * tracing_map_numa_partition - Request per-NUMA-node map partitioning
+ * @map: The tracing_map to partition
+ *
+ * Arrange for the map to be split into one complete sub-map per
+ * possible NUMA node when tracing_map_init() is called, each sized
+ * according to the map_bits the map was created with and allocated on
+ * its node.  tracing_map_insert() then keeps both the entry-claiming
+ * cmpxchg and the per-element sum atomics local to the inserting
+ * CPU's node, and tracing_map_sort_entries() merges the per-node
+ * partial sums when the map is read.
+ *
+ * Must be called after tracing_map_create() but before
+ * tracing_map_init().  On a single-node system this is a no-op and
+ * the map stays unpartitioned.
+ *
+ * Return: 0 if successful, -EBUSY if the map is already initialized.
+ */
+int tracing_map_numa_partition(struct tracing_map *map)
+{
+	if (map->elts || map->n_node_maps)
+		return -EBUSY;
+
+	if (nr_node_ids > 1)
+		map->numa_partition = true;
+
+	return 0;
+}
+
+/**
+ * tracing_map_hits - Return the total number of hits for a map
+ * @map: The tracing_map
+ *
+ * Sums the per-node hit counts of a NUMA-partitioned map; for an
+ * unpartitioned map this is simply the map's hits counter.
+ *
+ * Return: The number of hits.
+ */
+u64 tracing_map_hits(struct tracing_map *map)
+{
+	u64 hits = atomic64_read(&map->hits);
+	unsigned int i;
+
+	for (i = 0; i < map->n_node_maps; i++)
+		if (map->node_maps[i])
+			hits += atomic64_read(&map->node_maps[i]->hits);
+
+	return hits;
+}
+
+/**
+ * tracing_map_drops - Return the total number of drops for a map
+ * @map: The tracing_map
+ *
+ * Sums the per-node drop counts of a NUMA-partitioned map; for an
+ * unpartitioned map this is simply the map's drops counter.
+ *
+ * Return: The number of drops.
+ */
+u64 tracing_map_drops(struct tracing_map *map)
+{
+	u64 drops = atomic64_read(&map->drops);
+	unsigned int i;
+
+	for (i = 0; i < map->n_node_maps; i++)
+		if (map->node_maps[i])
+			drops += atomic64_read(&map->node_maps[i]->drops);
+
+	return drops;
+}
+
 static int cmp_entries_dup(const struct tracing_map_sort_entry **a,
 			   const struct tracing_map_sort_entry **b)
 {
@@ -994,6 +1203,29 @@ static void sort_secondary(struct tracing_map *map,
  * Return: the number of sort_entries in the struct tracing_map_sort_entry
  * array, negative on error
  */
+static int gather_entries(struct tracing_map *map,
+			  struct tracing_map_sort_entry **entries,
+			  int *n_entries)
+{
+	unsigned int i;
+
+	for (i = 0; i < map->map_size; i++) {
+		struct tracing_map_entry *entry;
+
+		entry = TRACING_MAP_ENTRY(map->map, i);
+
+		if (!entry->key || !entry->val)
+			continue;
+
+		entries[*n_entries] = create_sort_entry(entry->val->key,
+							entry->val);
+		if (!entries[(*n_entries)++])
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
 int tracing_map_sort_entries(struct tracing_map *map,
 			     struct tracing_map_sort_key *sort_keys,
 			     unsigned int n_sort_keys,
@@ -1002,26 +1234,36 @@ int tracing_map_sort_entries(struct tracing_map *map,
 	int (*cmp_entries_fn)(const struct tracing_map_sort_entry **,
 			      const struct tracing_map_sort_entry **);
 	struct tracing_map_sort_entry *sort_entry, **entries;
+	unsigned int n_alloc = map->n_node_maps ? 0 : map->max_elts;
 	int i, n_entries, ret;
 
-	entries = vmalloc(map->max_elts * sizeof(sort_entry));
+	for (i = 0; i < map->n_node_maps; i++)
+		if (map->node_maps[i])
+			n_alloc += map->node_maps[i]->max_elts;
+
+	entries = vmalloc(n_alloc * sizeof(sort_entry));
 	if (!entries)
 		return -ENOMEM;
 
-	for (i = 0, n_entries = 0; i < map->map_size; i++) {
-		struct tracing_map_entry *entry;
-
-		entry = TRACING_MAP_ENTRY(map->map, i);
-
-		if (!entry->key || !entry->val)
-			continue;
-
-		entries[n_entries] = create_sort_entry(entry->val->key,
-						       entry->val);
-		if (!entries[n_entries++]) {
-			ret = -ENOMEM;
-			goto free;
+	n_entries = 0;
+	if (map->n_node_maps) {
+		/*
+		 * Gathering all sub-maps and letting merge_dups() below
+		 * combine cross-node duplicates is what merges the
+		 * per-node partial sums of a NUMA-partitioned map.
+		 */
+		for (i = 0; i < map->n_node_maps; i++) {
+			if (!map->node_maps[i])
+				continue;
+			ret = gather_entries(map->node_maps[i], entries,
+					     &n_entries);
+			if (ret < 0)
+				goto free;
 		}
+	} else {
+		ret = gather_entries(map, entries, &n_entries);
+		if (ret < 0)
+			goto free;
 	}
 
 	if (n_entries == 0) {
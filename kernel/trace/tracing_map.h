@@ -94,6 +94,18 @@ typedef int (*tracing_map_cmp_fn_t) (void *val_a, void *val_b);
  * tracing_map_elts is allocated as a single block and is stored in
  * the elts field of struct tracing_map.
  *
+ * A map can optionally be partitioned per NUMA node (see
+ * tracing_map_numa_partition()).  In that mode the tracing_map created
+ * by the user becomes a front-end holding one complete sub-map per
+ * possible node; tracing_map_insert() directs each insertion to the
+ * inserting CPU's node's sub-map, so both the entry-claiming cmpxchg
+ * and the per-element sum atomics stay node-local.  The same logical
+ * key can therefore be claimed independently on several nodes; nothing
+ * is merged on the insert path.  Instead, tracing_map_sort_entries()
+ * gathers the entries of all sub-maps and relies on its existing
+ * duplicate-merging pass to combine the per-node partial sums, so
+ * readers see the same aggregated view as with an unpartitioned map.
+ *
  * There is also a set of structures used for sorting that might
  * benefit from some minimal explanation.
  *
@@ -185,6 +197,10 @@ struct tracing_map {
 	atomic_t			next_elt;
 	struct tracing_map_array	*elts;
 	struct tracing_map_array	*map;
+	int				node;
+	bool				numa_partition;
+	unsigned int			n_node_maps;
+	struct tracing_map		**node_maps;
 	const struct tracing_map_ops	*ops;
 	void				*private_data;
 	struct tracing_map_field	fields[TRACING_MAP_FIELDS_MAX];
@@ -246,6 +262,7 @@ tracing_map_create(unsigned int map_bits,
 		   const struct tracing_map_ops *ops,
 		   void *private_data);
 extern int tracing_map_init(struct tracing_map *map);
+extern int tracing_map_numa_partition(struct tracing_map *map);
 
 extern int tracing_map_add_sum_field(struct tracing_map *map);
 extern int tracing_map_add_key_field(struct tracing_map *map,
@@ -265,6 +282,9 @@ extern tracing_map_cmp_fn_t tracing_map_cmp_num(int field_size,
 extern int tracing_map_cmp_string(void *val_a, void *val_b);
 extern int tracing_map_cmp_none(void *val_a, void *val_b);
 
+extern u64 tracing_map_hits(struct tracing_map *map);
+extern u64 tracing_map_drops(struct tracing_map *map);
+
 extern void tracing_map_update_sum(struct tracing_map_elt *elt,
 				   unsigned int i, u64 n);
 extern u64 tracing_map_read_sum(struct tracing_map_elt *elt, unsigned int i);
@@ -56,6 +56,15 @@ static u8 decomp_ops[OPS_MAX][4] = {
 	{ I8, N0, N0, N0 }
 };
 
+/*
+ * Bit widths of the args of each template, and their totals, precomputed
+ * from decomp_ops at init time. With these the whole arg section of a
+ * template (at most 64 bits) can be fetched from the bitstream at once
+ * instead of one branchy next_bits() round trip per arg.
+ */
+static u8 decomp_ops_bits[OPS_MAX][4];
+static u8 decomp_ops_nbits[OPS_MAX];
+
 struct sw842_param {
 	u8 *in;
 	u8 bit;
@@ -169,14 +178,9 @@ static int do_data(struct sw842_param *p, u8 n)
 	return 0;
 }
 
-static int __do_index(struct sw842_param *p, u8 size, u8 bits, u64 fsize)
+static int do_index_ref(struct sw842_param *p, u64 index, u8 size, u64 fsize)
 {
-	u64 index, offset, total = round_down(p->out - p->ostart, 8);
-	int ret;
-
-	ret = next_bits(p, &index, bits);
-	if (ret)
-		return ret;
+	u64 offset, total = round_down(p->out - p->ostart, 8);
 
 	offset = index * size;
 
@@ -218,6 +222,18 @@ static int __do_index(struct sw842_param *p, u8 size, u8 bits, u64 fsize)
 	return 0;
 }
 
+static int __do_index(struct sw842_param *p, u8 size, u8 bits, u64 fsize)
+{
+	u64 index;
+	int ret;
+
+	ret = next_bits(p, &index, bits);
+	if (ret)
+		return ret;
+
+	return do_index_ref(p, index, size, fsize);
+}
+
 static int do_index(struct sw842_param *p, u8 n)
 {
 	switch (n) {
@@ -232,6 +248,120 @@ static int do_index(struct sw842_param *p, u8 n)
 	}
 }
 
+/*
+ * Fill in decomp_ops_bits/decomp_ops_nbits from decomp_ops. Called on
+ * the first decompression rather than from an initcall, because built-in
+ * users (the crypto self-test in particular) can run before our initcall.
+ * Concurrent first calls are harmless: they store identical values, and
+ * the template 0 total (D8, 64 bits) doubles as the "built" flag.
+ */
+static void sw842_build_ops_bits(void)
+{
+	int o, i;
+
+	for (o = 0; o < OPS_MAX; o++) {
+		u8 nbits = 0;
+
+		for (i = 0; i < 4; i++) {
+			u8 op = decomp_ops[o][i];
+			u8 bits = 0;
+
+			if ((op & OP_ACTION) == OP_ACTION_DATA)
+				bits = (op & OP_AMOUNT) * 8;
+			else if ((op & OP_ACTION) == OP_ACTION_INDEX)
+				bits = (op & OP_AMOUNT) == OP_AMOUNT_2 ?
+					I2_BITS :
+					(op & OP_AMOUNT) == OP_AMOUNT_4 ?
+					I4_BITS : I8_BITS;
+
+			decomp_ops_bits[o][i] = bits;
+			nbits += bits;
+		}
+
+		decomp_ops_nbits[o] = nbits;
+	}
+}
+
+/*
+ * Fast path for a regular template: fetch the whole arg section with one
+ * unaligned 64 bit load and carve the args out of it with shifts, so the
+ * bitstream state is updated once per template instead of once per arg.
+ * Requires at least 9 readable input bytes (the load may cross a byte
+ * boundary) and 8 output bytes (every template expands to exactly 8).
+ */
+static int do_op_fast(struct sw842_param *p, u8 o)
+{
+	u64 v;
+	int i, ret;
+
+	if (o >= OPS_MAX)
+		return -EINVAL;
+
+	if (p->olen < 8)
+		return -ENOSPC;
+
+	v = be64_to_cpu(get_unaligned((__be64 *)p->in)) << p->bit;
+	if (p->bit)
+		v |= p->in[8] >> (8 - p->bit);
+
+	for (i = 0; i < 4; i++) {
+		u8 op = decomp_ops[o][i];
+		u8 bits = decomp_ops_bits[o][i];
+		u64 arg;
+
+		if (op == N0)
+			break;
+
+		arg = v >> (64 - bits);
+		v <<= bits;
+
+		pr_debug("op is %x arg %lx\n", op, (unsigned long)arg);
+
+		if ((op & OP_ACTION) == OP_ACTION_DATA) {
+			switch (op & OP_AMOUNT) {
+			case OP_AMOUNT_2:
+				put_unaligned(cpu_to_be16((u16)arg),
+					      (__be16 *)p->out);
+				break;
+			case OP_AMOUNT_4:
+				put_unaligned(cpu_to_be32((u32)arg),
+					      (__be32 *)p->out);
+				break;
+			case OP_AMOUNT_8:
+				put_unaligned(cpu_to_be64(arg),
+					      (__be64 *)p->out);
+				break;
+			}
+			p->out += op & OP_AMOUNT;
+			p->olen -= op & OP_AMOUNT;
+		} else {
+			switch (op & OP_AMOUNT) {
+			case OP_AMOUNT_2:
+				ret = do_index_ref(p, arg, 2, I2_FIFO_SIZE);
+				break;
+			case OP_AMOUNT_4:
+				ret = do_index_ref(p, arg, 4, I4_FIFO_SIZE);
+				break;
+			default:
+				ret = do_index_ref(p, arg, 8, I8_FIFO_SIZE);
+				break;
+			}
+			if (ret)
+				return ret;
+		}
+	}
+
+	p->bit += decomp_ops_nbits[o];
+	p->in += p->bit / 8;
+	p->ilen -= p->bit / 8;
+	p->bit %= 8;
+
+	if (sw842_template_counts)
+		atomic_inc(&template_count[o]);
+
+	return 0;
+}
+
 static int do_op(struct sw842_param *p, u8 o)
 {
 	int i, ret = 0;
@@ -291,6 +421,9 @@ int sw842_decompress(const u8 *in, unsigned int ilen,
 	u64 op, rep, tmp, bytes, total;
 	u64 crc;
 
+	if (unlikely(!decomp_ops_nbits[0]))
+		sw842_build_ops_bits();
+
 	p.in = (u8 *)in;
 	p.bit = 0;
 	p.ilen = ilen;
@@ -373,7 +506,10 @@ int sw842_decompress(const u8 *in, unsigned int ilen,
 
 			break;
 		default: /* use template */
-			ret = do_op(&p, op);
+			if (p.ilen >= 9)
+				ret = do_op_fast(&p, op);
+			else
+				ret = do_op(&p, op);
 			if (ret)
 				return ret;
 			break;
@@ -38,6 +38,9 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/preempt.h>
+#include <linux/slab.h>
 #include <asm/unaligned.h>
 
 /*-*****************************
@@ -71,7 +74,9 @@ static FORCE_INLINE int LZ4_decompress_generic(
 	 /* only if dict == usingExtDict */
 	 const BYTE * const dictStart,
 	 /* note : = 0 if noDict */
-	 const size_t dictSize
+	 const size_t dictSize,
+	 /* copy8, copy16 */
+	 int copyWidth
 	 )
 {
 	/* Local Variables */
@@ -188,7 +193,17 @@ static FORCE_INLINE int LZ4_decompress_generic(
 			break;
 		}
 
-		LZ4_wildCopy(op, ip, cpy);
+		/*
+		 * The wide copy loop reads up to 15 bytes past the run of
+		 * literals, so it is only safe when the input bound is
+		 * known and both buffers leave enough headroom.
+		 */
+		if ((copyWidth == copy16) && (endOnInput)
+			&& likely((cpy <= oend - 16)
+				&& (ip + length <= iend - 16)))
+			LZ4_wildCopy16(op, ip, cpy);
+		else
+			LZ4_wildCopy(op, ip, cpy);
 		ip += length;
 		op = cpy;
 
@@ -274,6 +289,20 @@ static FORCE_INLINE int LZ4_decompress_generic(
 		/* copy match within block */
 		cpy = op + length;
 
+		/*
+		 * A match that is at least 16 bytes away cannot overlap a
+		 * 16 byte step, and with 16 bytes of room at the end of
+		 * the buffer the overshoot of the wide copy loop stays
+		 * inside the output, both for the store and for the load
+		 * from the already decoded data.
+		 */
+		if ((copyWidth == copy16) && likely((offset >= 16)
+			&& (cpy <= oend - 16))) {
+			LZ4_wildCopy16(op, match, cpy);
+			op = cpy;
+			continue;
+		}
+
 		if (unlikely(offset < 8)) {
 			const int dec64 = dec64table[offset];
 
@@ -334,12 +363,76 @@ _output_error:
 	return -1;
 }
 
-int LZ4_decompress_safe(const char *source, char *dest,
+/*
+ * The hot entry points are instantiated once per copy width and the
+ * variant to use is picked at boot by lz4_select_decompress() below,
+ * the same way lib/raid6/algos.c selects its syndrome routines. The
+ * streaming and dictionary entry points are cold enough that they
+ * always use the portable 8 byte copy loops.
+ */
+static int LZ4_decompress_safe_copy8(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	return LZ4_decompress_generic(source, dest, compressedSize,
+		maxDecompressedSize, endOnInputSize, full, 0,
+		noDict, (BYTE *)dest, NULL, 0, copy8);
+}
+
+static int LZ4_decompress_safe_copy16(const char *source, char *dest,
 	int compressedSize, int maxDecompressedSize)
 {
 	return LZ4_decompress_generic(source, dest, compressedSize,
 		maxDecompressedSize, endOnInputSize, full, 0,
-		noDict, (BYTE *)dest, NULL, 0);
+		noDict, (BYTE *)dest, NULL, 0, copy16);
+}
+
+static int LZ4_decompress_fast_copy8(const char *source, char *dest,
+	int originalSize)
+{
+	return LZ4_decompress_generic(source, dest, 0, originalSize,
+		endOnOutputSize, full, 0, withPrefix64k,
+		(BYTE *)(dest - 64 * KB), NULL, 64 * KB, copy8);
+}
+
+static int LZ4_decompress_fast_copy16(const char *source, char *dest,
+	int originalSize)
+{
+	return LZ4_decompress_generic(source, dest, 0, originalSize,
+		endOnOutputSize, full, 0, withPrefix64k,
+		(BYTE *)(dest - 64 * KB), NULL, 64 * KB, copy16);
+}
+
+struct lz4_decompress_calls {
+	int (*decompress_safe)(const char *source, char *dest,
+		int compressedSize, int maxDecompressedSize);
+	int (*decompress_fast)(const char *source, char *dest,
+		int originalSize);
+	const char *name;
+};
+
+static const struct lz4_decompress_calls lz4_copy8_calls = {
+	.decompress_safe	= LZ4_decompress_safe_copy8,
+	.decompress_fast	= LZ4_decompress_fast_copy8,
+	.name			= "generic",
+};
+
+static const struct lz4_decompress_calls lz4_copy16_calls = {
+	.decompress_safe	= LZ4_decompress_safe_copy16,
+	.decompress_fast	= LZ4_decompress_fast_copy16,
+	.name			= "wide",
+};
+
+/*
+ * Default to the portable loops so that decompression works before the
+ * selection initcall has run.
+ */
+static const struct lz4_decompress_calls *lz4_calls = &lz4_copy8_calls;
+
+int LZ4_decompress_safe(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	return lz4_calls->decompress_safe(source, dest, compressedSize,
+		maxDecompressedSize);
 }
 
 int LZ4_decompress_safe_partial(const char *source, char *dest,
@@ -347,14 +440,12 @@ int LZ4_decompress_safe_partial(const char *source, char *dest,
 {
 	return LZ4_decompress_generic(source, dest, compressedSize,
 		maxDecompressedSize, endOnInputSize, partial,
-		targetOutputSize, noDict, (BYTE *)dest, NULL, 0);
+		targetOutputSize, noDict, (BYTE *)dest, NULL, 0, copy8);
 }
 
 int LZ4_decompress_fast(const char *source, char *dest, int originalSize)
 {
-	return LZ4_decompress_generic(source, dest, 0, originalSize,
-		endOnOutputSize, full, 0, withPrefix64k,
-		(BYTE *)(dest - 64 * KB), NULL, 64 * KB);
+	return lz4_calls->decompress_fast(source, dest, originalSize);
 }
 
 int LZ4_setStreamDecode(LZ4_streamDecode_t *LZ4_streamDecode,
@@ -392,7 +483,7 @@ int LZ4_decompress_safe_continue(LZ4_streamDecode_t *LZ4_streamDecode,
 			endOnInputSize, full, 0,
 			usingExtDict, lz4sd->prefixEnd - lz4sd->prefixSize,
 			lz4sd->externalDict,
-			lz4sd->extDictSize);
+			lz4sd->extDictSize, copy8);
 
 		if (result <= 0)
 			return result;
@@ -406,7 +497,7 @@ int LZ4_decompress_safe_continue(LZ4_streamDecode_t *LZ4_streamDecode,
 			compressedSize, maxOutputSize,
 			endOnInputSize, full, 0,
 			usingExtDict, (BYTE *)dest,
-			lz4sd->externalDict, lz4sd->extDictSize);
+			lz4sd->externalDict, lz4sd->extDictSize, copy8);
 		if (result <= 0)
 			return result;
 		lz4sd->prefixSize = result;
@@ -427,7 +518,7 @@ int LZ4_decompress_fast_continue(LZ4_streamDecode_t *LZ4_streamDecode,
 			endOnOutputSize, full, 0,
 			usingExtDict,
 			lz4sd->prefixEnd - lz4sd->prefixSize,
-			lz4sd->externalDict, lz4sd->extDictSize);
+			lz4sd->externalDict, lz4sd->extDictSize, copy8);
 
 		if (result <= 0)
 			return result;
@@ -440,7 +531,7 @@ int LZ4_decompress_fast_continue(LZ4_streamDecode_t *LZ4_streamDecode,
 		result = LZ4_decompress_generic(source, dest, 0, originalSize,
 			endOnOutputSize, full, 0,
 			usingExtDict, (BYTE *)dest,
-			lz4sd->externalDict, lz4sd->extDictSize);
+			lz4sd->externalDict, lz4sd->extDictSize, copy8);
 		if (result <= 0)
 			return result;
 		lz4sd->prefixSize = originalSize;
@@ -463,19 +554,20 @@ static FORCE_INLINE int LZ4_decompress_usingDict_generic(const char *source,
 	if (dictSize == 0)
 		return LZ4_decompress_generic(source, dest,
 			compressedSize, maxOutputSize, safe, full, 0,
-			noDict, (BYTE *)dest, NULL, 0);
+			noDict, (BYTE *)dest, NULL, 0, copy8);
 	if (dictStart + dictSize == dest) {
 		if (dictSize >= (int)(64 * KB - 1))
 			return LZ4_decompress_generic(source, dest,
 				compressedSize, maxOutputSize, safe, full, 0,
-				withPrefix64k, (BYTE *)dest - 64 * KB, NULL, 0);
+				withPrefix64k, (BYTE *)dest - 64 * KB, NULL, 0,
+				copy8);
 		return LZ4_decompress_generic(source, dest, compressedSize,
 			maxOutputSize, safe, full, 0, noDict,
-			(BYTE *)dest - dictSize, NULL, 0);
+			(BYTE *)dest - dictSize, NULL, 0, copy8);
 	}
 	return LZ4_decompress_generic(source, dest, compressedSize,
 		maxOutputSize, safe, full, 0, usingExtDict,
-		(BYTE *)dest, (const BYTE *)dictStart, dictSize);
+		(BYTE *)dest, (const BYTE *)dictStart, dictSize, copy8);
 }
 
 int LZ4_decompress_safe_usingDict(const char *source, char *dest,
@@ -494,6 +586,111 @@ int LZ4_decompress_fast_usingDict(const char *source, char *dest,
 }
 
 #ifndef STATIC
+/*-*****************************
+ *	Variant selection
+ *******************************/
+#define LZ4_BENCH_IN_SIZE 2048
+#define LZ4_BENCH_JIFFIES_LG2 2
+
+/* The fastest variant first, so that it wins ties on the benchmark. */
+static const struct lz4_decompress_calls *const lz4_decompress_algos[] = {
+	&lz4_copy16_calls,
+	&lz4_copy8_calls,
+	NULL
+};
+
+static char lz4_decompress_fastest[16] = "generic";
+module_param_string(decompress_fastest, lz4_decompress_fastest,
+		    sizeof(lz4_decompress_fastest), 0444);
+MODULE_PARM_DESC(decompress_fastest,
+		 "Decompression variant selected at load time");
+
+/*
+ * Hand-build a compressed block for the selection benchmark: sequences
+ * of 8 literals followed by an 18 byte match at offset 8, closed by the
+ * literal-only sequence the format requires at the end of a block. The
+ * compressor lives in a separate module, so it cannot be used here.
+ */
+static int lz4_bench_block(BYTE *in, int *decompressedSize)
+{
+	int nseq = (LZ4_BENCH_IN_SIZE - 13) / 11;
+	BYTE *p = in;
+	int i;
+
+	for (i = 0; i < nseq; i++) {
+		*p++ = (8 << ML_BITS) | 14;
+		memcpy(p, "abcdefgh", 8);
+		p += 8;
+		LZ4_writeLE16(p, 8);
+		p += 2;
+	}
+	*p++ = 12 << ML_BITS;
+	memcpy(p, "ijklmnopqrst", 12);
+	p += 12;
+
+	*decompressedSize = nseq * 26 + 12;
+	return p - in;
+}
+
+static int __init lz4_select_decompress(void)
+{
+	const struct lz4_decompress_calls *const *algo;
+	const struct lz4_decompress_calls *best = NULL;
+	unsigned long bestperf = 0;
+	int compressedSize, decompressedSize;
+	BYTE *in, *out;
+
+	in = kmalloc(LZ4_BENCH_IN_SIZE, GFP_KERNEL);
+	out = kmalloc(LZ4_BENCH_IN_SIZE * 3, GFP_KERNEL);
+	if (!in || !out)
+		goto done;
+
+	compressedSize = lz4_bench_block(in, &decompressedSize);
+
+	for (algo = lz4_decompress_algos; *algo; algo++) {
+		unsigned long perf = 0;
+		unsigned long j0, j1;
+
+		if ((*algo)->decompress_safe(in, out, compressedSize,
+					     decompressedSize)
+		    != decompressedSize)
+			continue;
+
+		preempt_disable();
+		j0 = jiffies;
+		while ((j1 = jiffies) == j0)
+			cpu_relax();
+		while (time_before(jiffies,
+				   j1 + (1 << LZ4_BENCH_JIFFIES_LG2))) {
+			(*algo)->decompress_safe(in, out, compressedSize,
+						 decompressedSize);
+			perf++;
+		}
+		preempt_enable();
+
+		pr_info("lz4: %-8s %5ld MB/s\n", (*algo)->name,
+			(perf * HZ * decompressedSize) >>
+			(20 + LZ4_BENCH_JIFFIES_LG2));
+
+		if (perf > bestperf) {
+			bestperf = perf;
+			best = *algo;
+		}
+	}
+
+	if (best) {
+		lz4_calls = best;
+		strlcpy(lz4_decompress_fastest, best->name,
+			sizeof(lz4_decompress_fastest));
+		pr_info("lz4: using %s decompression\n", best->name);
+	}
+done:
+	kfree(in);
+	kfree(out);
+	return 0;
+}
+subsys_initcall(lz4_select_decompress);
+
 EXPORT_SYMBOL(LZ4_decompress_safe);
 EXPORT_SYMBOL(LZ4_decompress_safe_partial);
 EXPORT_SYMBOL(LZ4_decompress_fast);
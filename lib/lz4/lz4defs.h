@@ -165,6 +165,32 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+static FORCE_INLINE void LZ4_copy16(void *dst, const void *src)
+{
+	LZ4_copy8(dst, src);
+	LZ4_copy8((BYTE *)dst + 8, (const BYTE *)src + 8);
+}
+
+/*
+ * 16 byte stepped variant of LZ4_wildCopy; may overwrite up to 15 bytes
+ * beyond dstEnd and read as far beyond the end of the source. Compilers
+ * turn the double 8 byte copy into a single vector load/store pair on
+ * architectures that have unaligned 128 bit accesses.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	do {
+		LZ4_copy16(d, s);
+		d += 16;
+		s += 16;
+	} while (d < e);
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
@@ -224,4 +250,6 @@ typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
 typedef enum { endOnOutputSize = 0, endOnInputSize = 1 } endCondition_directive;
 typedef enum { full = 0, partial = 1 } earlyEnd_directive;
 
+typedef enum { copy8 = 0, copy16 = 1 } copyWidth_directive;
+
 #endif
@@ -20,6 +20,7 @@
 #ifndef __KERNEL__
 #include <sys/mman.h>
 #include <stdio.h>
+#include <string.h>
 #else
 #include <linux/module.h>
 #include <linux/gfp.h>
@@ -128,24 +129,83 @@ const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #define time_before(x, y) ((x) < (y))
 #endif
 
-static inline const struct raid6_recov_calls *raid6_choose_recov(void)
+static inline const struct raid6_recov_calls *raid6_choose_recov(
+	void *(*const dptrs)[(65536/PAGE_SIZE)+2], const int disks)
 {
+	unsigned long perf, bestperf, j0, j1;
+	const int faila = 1, failb = 2;	/* any two data disks will do */
 	const struct raid6_recov_calls *const *algo;
 	const struct raid6_recov_calls *best;
+	void *rptrs[(65536/PAGE_SIZE)+2];
+	char *fail_pages;
+
+	/*
+	 * Recovery rewrites the two "failed" data disks, so they must not
+	 * point into the gfmul table like the rest of the scratch array.
+	 * If no pages are available, fall back to the priority ranking.
+	 */
+	fail_pages = (void *) __get_free_pages(GFP_KERNEL, 1);
+	if (!fail_pages) {
+		for (best = NULL, algo = raid6_recov_algos; *algo; algo++)
+			if (!best || (*algo)->priority > best->priority)
+				if (!(*algo)->valid || (*algo)->valid())
+					best = *algo;
+
+		if (best) {
+			raid6_2data_recov = best->data2;
+			raid6_datap_recov = best->datap;
+
+			pr_info("raid6: using %s recovery algorithm\n",
+				best->name);
+		} else
+			pr_err("raid6: Yikes! No recovery algorithm found!\n");
+
+		return best;
+	}
 
-	for (best = NULL, algo = raid6_recov_algos; *algo; algo++)
-		if (!best || (*algo)->priority > best->priority)
-			if (!(*algo)->valid || (*algo)->valid())
-				best = *algo;
+	memcpy(rptrs, *dptrs, disks * sizeof(void *));
+	rptrs[faila] = fail_pages;
+	rptrs[failb] = fail_pages + PAGE_SIZE;
+
+	/* The gen benchmark has already left valid syndromes behind */
+	for (bestperf = 0, best = NULL, algo = raid6_recov_algos; *algo; algo++) {
+		if ((*algo)->valid && !(*algo)->valid())
+			continue;
+
+		perf = 0;
+
+		preempt_disable();
+		j0 = jiffies;
+		while ((j1 = jiffies) == j0)
+			cpu_relax();
+		while (time_before(jiffies,
+				    j1 + (1<<RAID6_TIME_JIFFIES_LG2))) {
+			(*algo)->data2(disks, PAGE_SIZE, faila, failb,
+				       rptrs);
+			perf++;
+		}
+		preempt_enable();
+
+		if (perf > bestperf) {
+			bestperf = perf;
+			best = *algo;
+		}
+		pr_info("raid6: %-8s recov() %5ld MB/s\n", (*algo)->name,
+			(perf*HZ) >> (20-16+RAID6_TIME_JIFFIES_LG2));
+	}
 
 	if (best) {
 		raid6_2data_recov = best->data2;
 		raid6_datap_recov = best->datap;
 
-		pr_info("raid6: using %s recovery algorithm\n", best->name);
+		pr_info("raid6: using %s recovery algorithm (%ld MB/s)\n",
+			best->name,
+			(bestperf*HZ) >> (20-16+RAID6_TIME_JIFFIES_LG2));
 	} else
 		pr_err("raid6: Yikes! No recovery algorithm found!\n");
 
+	free_pages((unsigned long)fail_pages, 1);
+
 	return best;
 }
 
@@ -253,7 +313,7 @@ int __init raid6_select_algo(void)
 	gen_best = raid6_choose_gen(&dptrs, disks);
 
 	/* select raid recover functions */
-	rec_best = raid6_choose_recov();
+	rec_best = raid6_choose_recov(&dptrs, disks);
 
 	free_pages((unsigned long)syndromes, 1);
 
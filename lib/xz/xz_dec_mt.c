@@ -0,0 +1,479 @@
+/*
+ * .xz block-parallel decoder
+ *
+ * Decodes the Blocks of a .xz Stream on several CPUs at once. This only
+ * works on Streams whose Block Headers carry both the Compressed Size
+ * and the Uncompressed Size fields (xz writes them when block splitting
+ * is requested, e.g. with --block-size or -T), because only then can the
+ * Blocks be located without decoding them. Anything else falls back to
+ * plain single-call decoding, so callers may use this unconditionally.
+ *
+ * This file is not usable in the preboot environment: it needs the
+ * scheduler for its worker threads. The early decompression wrapper
+ * must keep using the sequential decoder.
+ */
+
+#include "xz_private.h"
+#include "xz_stream.h"
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
+#include <linux/mm.h>
+
+/* See check_sizes[] in xz_dec_stream.c */
+static const uint8_t mt_check_sizes[16] = {
+	0,
+	4, 4, 4,
+	8, 8, 8,
+	16, 16, 16,
+	32, 32, 32,
+	64, 64, 64
+};
+
+/*
+ * Largest Index + Stream Footer a single-Block synthetic Stream can
+ * need: indicator + count + two VLIs + padding + CRC32 + footer.
+ */
+#define MT_TAIL_MAX (1 + 1 + 2 * VLI_BYTES_MAX + 3 + 4 + STREAM_HEADER_SIZE)
+
+/* One Block as located by the Block Header walk */
+struct xz_mt_block {
+	/* Offset and size of Block Header + Compressed Data + padding + Check */
+	size_t in_off;
+	size_t in_size;
+
+	/* Offset and size of the Block's slice of the output buffer */
+	size_t out_off;
+	size_t out_size;
+
+	/* Unpadded Size as recorded in the Index */
+	vli_type unpadded;
+};
+
+struct xz_dec_mt {
+	const uint8_t *in;
+
+	/* Stream Header of the original Stream, reused for every Block */
+	const uint8_t *header;
+
+	uint8_t *out;
+
+	struct xz_mt_block *blocks;
+	unsigned int nblocks;
+
+	uint32_t dict_max;
+
+	/* Next Block to be claimed by a worker */
+	atomic_t next;
+
+	/* First error seen by any worker, as enum xz_ret (XZ_OK if none) */
+	atomic_t error;
+
+	/* Workers still running, including the caller itself */
+	atomic_t running;
+	struct completion finished;
+};
+
+static size_t mt_dec_vli(const uint8_t *in, size_t in_size, vli_type *v)
+{
+	size_t pos = 0;
+
+	*v = 0;
+	do {
+		if (pos == in_size || pos == VLI_BYTES_MAX)
+			return 0;
+
+		*v |= (vli_type)(in[pos] & 0x7F) << (pos * 7);
+	} while (in[pos++] & 0x80);
+
+	return pos;
+}
+
+static size_t mt_enc_vli(uint8_t *out, vli_type v)
+{
+	size_t pos = 0;
+
+	while (v >= 0x80) {
+		out[pos++] = (uint8_t)v | 0x80;
+		v >>= 7;
+	}
+
+	out[pos++] = (uint8_t)v;
+	return pos;
+}
+
+/*
+ * Build the Index and Stream Footer of a synthetic Stream containing
+ * just one Block, so that the regular Stream decoder can verify it.
+ */
+static size_t mt_build_tail(uint8_t *tail, const struct xz_mt_block *block,
+			    const uint8_t *header)
+{
+	size_t pos;
+	size_t index_size;
+	uint32_t crc;
+
+	tail[0] = 0;		/* Index Indicator */
+	pos = 1;
+	pos += mt_enc_vli(tail + pos, 1);	/* Number of Records */
+	pos += mt_enc_vli(tail + pos, block->unpadded);
+	pos += mt_enc_vli(tail + pos, block->out_size);
+
+	while (pos & 3)
+		tail[pos++] = 0;	/* Index Padding */
+
+	crc = xz_crc32(tail, pos, 0);
+	put_unaligned_le32(crc, tail + pos);
+	pos += 4;
+	index_size = pos;
+
+	/* Stream Footer: CRC32, Backward Size, Stream Flags, Footer Magic */
+	put_unaligned_le32(index_size / 4 - 1, tail + pos + 4);
+	tail[pos + 8] = header[6];
+	tail[pos + 9] = header[7];
+	crc = xz_crc32(tail + pos + 4, 6, 0);
+	put_unaligned_le32(crc, tail + pos);
+	pos += 10;
+	tail[pos++] = FOOTER_MAGIC[0];
+	tail[pos++] = FOOTER_MAGIC[1];
+
+	return pos;
+}
+
+static void mt_set_error(struct xz_dec_mt *mt, enum xz_ret ret)
+{
+	atomic_cmpxchg(&mt->error, XZ_OK, ret);
+}
+
+/* Feed one piece of the synthetic Stream to the decoder */
+static enum xz_ret mt_run_piece(struct xz_dec *s, struct xz_buf *b,
+				const uint8_t *in, size_t in_size)
+{
+	enum xz_ret ret;
+
+	b->in = in;
+	b->in_pos = 0;
+	b->in_size = in_size;
+
+	do {
+		ret = xz_dec_run(s, b);
+	} while (ret == XZ_UNSUPPORTED_CHECK);
+
+	if (ret == XZ_OK && b->in_pos != b->in_size) {
+		/*
+		 * The decoder stopped inside the Block even though the
+		 * output slice is sized exactly for it.
+		 */
+		ret = XZ_DATA_ERROR;
+	}
+
+	return ret;
+}
+
+static void xz_dec_mt_work(struct xz_dec_mt *mt)
+{
+	uint8_t tail[MT_TAIL_MAX];
+	struct xz_dec *s;
+	struct xz_buf b;
+	unsigned int i;
+
+	s = xz_dec_init(XZ_DYNALLOC, mt->dict_max);
+	if (s == NULL) {
+		mt_set_error(mt, XZ_MEM_ERROR);
+		return;
+	}
+
+	while ((i = atomic_fetch_inc(&mt->next)) < mt->nblocks) {
+		const struct xz_mt_block *block = &mt->blocks[i];
+		size_t tail_size;
+		enum xz_ret ret;
+
+		if (atomic_read(&mt->error) != XZ_OK)
+			break;
+
+		tail_size = mt_build_tail(tail, block, mt->header);
+
+		xz_dec_reset(s);
+		b.out = mt->out + block->out_off;
+		b.out_pos = 0;
+		b.out_size = block->out_size;
+
+		ret = mt_run_piece(s, &b, mt->header, STREAM_HEADER_SIZE);
+		if (ret == XZ_OK)
+			ret = mt_run_piece(s, &b, mt->in + block->in_off,
+					   block->in_size);
+		if (ret == XZ_OK)
+			ret = mt_run_piece(s, &b, tail, tail_size);
+
+		if (ret == XZ_STREAM_END && b.out_pos != block->out_size)
+			ret = XZ_DATA_ERROR;
+
+		if (ret != XZ_STREAM_END) {
+			mt_set_error(mt, ret == XZ_OK ? XZ_DATA_ERROR : ret);
+			break;
+		}
+	}
+
+	xz_dec_end(s);
+}
+
+static int xz_dec_mt_thread(void *data)
+{
+	struct xz_dec_mt *mt = data;
+
+	xz_dec_mt_work(mt);
+
+	if (atomic_dec_and_test(&mt->running))
+		complete(&mt->finished);
+
+	return 0;
+}
+
+/*
+ * Walk the Block Headers. When blocks is NULL only count them; otherwise
+ * fill in one entry per Block. Returns XZ_OK and the number of Blocks,
+ * or an error. XZ_OPTIONS_ERROR is returned when a Block Header lacks
+ * the size fields needed for parallel decoding; that is not a broken
+ * Stream, just one the sequential decoder must handle.
+ */
+static enum xz_ret mt_walk_blocks(const uint8_t *in, size_t in_size,
+				  uint8_t check_type,
+				  struct xz_mt_block *blocks,
+				  unsigned int *nblocks, size_t *index_pos,
+				  size_t *out_total)
+{
+	size_t pos = STREAM_HEADER_SIZE;
+	size_t out_pos = 0;
+	unsigned int n = 0;
+
+	while (true) {
+		size_t header_size, p, len, comp_padded;
+		vli_type comp, uncomp;
+
+		if (pos >= in_size)
+			return XZ_DATA_ERROR;
+
+		if (in[pos] == 0)
+			break;	/* Index Indicator */
+
+		header_size = ((size_t)in[pos] + 1) * 4;
+		if (in_size - pos < header_size)
+			return XZ_DATA_ERROR;
+
+		/* Both size fields must be present */
+		if ((in[pos + 1] & 0xC0) != 0xC0)
+			return XZ_OPTIONS_ERROR;
+
+		p = pos + 2;
+		len = mt_dec_vli(in + p, pos + header_size - p, &comp);
+		if (len == 0)
+			return XZ_DATA_ERROR;
+		p += len;
+		len = mt_dec_vli(in + p, pos + header_size - p, &uncomp);
+		if (len == 0)
+			return XZ_DATA_ERROR;
+
+		/* Also keeps the size_t arithmetic below from wrapping */
+		if (comp > in_size || uncomp > VLI_MAX)
+			return XZ_DATA_ERROR;
+
+		comp_padded = ((size_t)comp + 3) & ~(size_t)3;
+		if (in_size - pos < header_size + comp_padded +
+				mt_check_sizes[check_type])
+			return XZ_DATA_ERROR;
+
+		if (blocks != NULL) {
+			blocks[n].in_off = pos;
+			blocks[n].in_size = header_size + comp_padded +
+					    mt_check_sizes[check_type];
+			blocks[n].out_off = out_pos;
+			blocks[n].out_size = uncomp;
+			blocks[n].unpadded = header_size + comp +
+					     mt_check_sizes[check_type];
+		}
+
+		if (out_pos + uncomp < out_pos)
+			return XZ_DATA_ERROR;
+
+		out_pos += uncomp;
+		pos += header_size + comp_padded + mt_check_sizes[check_type];
+		n++;
+	}
+
+	*nblocks = n;
+	*index_pos = pos;
+	*out_total = out_pos;
+	return XZ_OK;
+}
+
+/*
+ * Verify the Index and Stream Footer against the Block Header walk, so
+ * the parallel path rejects everything the sequential decoder would.
+ * Returns the position right after the Stream Footer.
+ */
+static enum xz_ret mt_check_index(const uint8_t *in, size_t in_size,
+				  const struct xz_mt_block *blocks,
+				  unsigned int nblocks, size_t index_pos,
+				  size_t *end_pos)
+{
+	size_t pos = index_pos + 1;
+	vli_type v;
+	size_t len;
+	unsigned int i;
+	size_t index_size;
+
+	len = mt_dec_vli(in + pos, in_size - pos, &v);
+	if (len == 0 || v != nblocks)
+		return XZ_DATA_ERROR;
+	pos += len;
+
+	for (i = 0; i < nblocks; i++) {
+		len = mt_dec_vli(in + pos, in_size - pos, &v);
+		if (len == 0 || v != blocks[i].unpadded)
+			return XZ_DATA_ERROR;
+		pos += len;
+
+		len = mt_dec_vli(in + pos, in_size - pos, &v);
+		if (len == 0 || v != blocks[i].out_size)
+			return XZ_DATA_ERROR;
+		pos += len;
+	}
+
+	while (pos & 3) {
+		if (pos >= in_size || in[pos++] != 0)
+			return XZ_DATA_ERROR;
+	}
+
+	if (in_size - pos < 4 + STREAM_HEADER_SIZE)
+		return XZ_DATA_ERROR;
+
+	if (xz_crc32(in + index_pos, pos - index_pos, 0)
+			!= get_le32(in + pos))
+		return XZ_DATA_ERROR;
+	pos += 4;
+	index_size = pos - index_pos;
+
+	/* Stream Footer */
+	if (xz_crc32(in + pos + 4, 6, 0) != get_le32(in + pos))
+		return XZ_DATA_ERROR;
+	if (get_le32(in + pos + 4) != index_size / 4 - 1)
+		return XZ_DATA_ERROR;
+	if (in[pos + 8] != in[6] || in[pos + 9] != in[7])
+		return XZ_DATA_ERROR;
+	if (!memeq(in + pos + 10, FOOTER_MAGIC, FOOTER_MAGIC_SIZE))
+		return XZ_DATA_ERROR;
+
+	*end_pos = pos + STREAM_HEADER_SIZE;
+	return XZ_OK;
+}
+
+/* Single-call decoding of the whole Stream on one CPU */
+static enum xz_ret xz_dec_mt_fallback(struct xz_buf *b)
+{
+	struct xz_dec *s;
+	enum xz_ret ret;
+
+	s = xz_dec_init(XZ_SINGLE, 0);
+	if (s == NULL)
+		return XZ_MEM_ERROR;
+
+	ret = xz_dec_run(s, b);
+	xz_dec_end(s);
+	return ret;
+}
+
+XZ_EXTERN enum xz_ret xz_dec_mt_run(struct xz_buf *b, uint32_t dict_max)
+{
+	const uint8_t *in = b->in + b->in_pos;
+	size_t in_size = b->in_size - b->in_pos;
+	struct xz_dec_mt mt;
+	struct xz_mt_block *blocks;
+	unsigned int nblocks, nthreads, i;
+	size_t index_pos, out_total, end_pos;
+	enum xz_ret ret;
+
+	if (in_size < STREAM_HEADER_SIZE)
+		return XZ_FORMAT_ERROR;
+	if (!memeq(in, HEADER_MAGIC, HEADER_MAGIC_SIZE))
+		return XZ_FORMAT_ERROR;
+	if (xz_crc32(in + HEADER_MAGIC_SIZE, 2, 0)
+			!= get_le32(in + HEADER_MAGIC_SIZE + 2))
+		return XZ_DATA_ERROR;
+	if (in[HEADER_MAGIC_SIZE] != 0
+			|| in[HEADER_MAGIC_SIZE + 1] > XZ_CHECK_MAX)
+		return XZ_OPTIONS_ERROR;
+
+	ret = mt_walk_blocks(in, in_size, in[HEADER_MAGIC_SIZE + 1], NULL,
+			     &nblocks, &index_pos, &out_total);
+	if (ret == XZ_OPTIONS_ERROR)
+		return xz_dec_mt_fallback(b);
+	if (ret != XZ_OK)
+		return ret;
+
+	nthreads = min_t(unsigned int, num_online_cpus(), nblocks);
+	if (nthreads < 2)
+		return xz_dec_mt_fallback(b);
+
+	if (out_total > b->out_size - b->out_pos)
+		return XZ_BUF_ERROR;
+
+	blocks = kvmalloc_array(nblocks, sizeof(*blocks), GFP_KERNEL);
+	if (blocks == NULL)
+		return xz_dec_mt_fallback(b);
+
+	mt_walk_blocks(in, in_size, in[HEADER_MAGIC_SIZE + 1], blocks,
+		       &nblocks, &index_pos, &out_total);
+
+	ret = mt_check_index(in, in_size, blocks, nblocks, index_pos,
+			     &end_pos);
+	if (ret != XZ_OK)
+		goto out_free;
+
+	mt.in = in;
+	mt.header = in;
+	mt.out = b->out + b->out_pos;
+	mt.blocks = blocks;
+	mt.nblocks = nblocks;
+	mt.dict_max = dict_max;
+	atomic_set(&mt.next, 0);
+	atomic_set(&mt.error, XZ_OK);
+	atomic_set(&mt.running, 1);
+	init_completion(&mt.finished);
+
+	for (i = 1; i < nthreads; i++) {
+		struct task_struct *tsk;
+
+		atomic_inc(&mt.running);
+		tsk = kthread_run(xz_dec_mt_thread, &mt, "xz_dec_mt/%u", i);
+		if (IS_ERR(tsk)) {
+			/* The remaining workers pick up the Blocks */
+			atomic_dec(&mt.running);
+			break;
+		}
+	}
+
+	/* The caller is a worker too */
+	xz_dec_mt_work(&mt);
+
+	if (!atomic_dec_and_test(&mt.running))
+		wait_for_completion(&mt.finished);
+
+	ret = atomic_read(&mt.error);
+	if (ret == XZ_MEM_ERROR) {
+		/* Retry sequentially; XZ_SINGLE allocates nothing big */
+		ret = xz_dec_mt_fallback(b);
+		goto out_free;
+	}
+
+	if (ret == XZ_OK) {
+		b->in_pos += end_pos;
+		b->out_pos += out_total;
+		ret = XZ_STREAM_END;
+	}
+
+out_free:
+	kvfree(blocks);
+	return ret;
+}
@@ -0,0 +1,125 @@
+/*
+ * Per-CPU compression context pool for the zstd library.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+
+/*-*************************************
+*  Dependencies
+***************************************/
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/zstd.h>
+
+/*-*************************************
+*  Per-CPU workspaces
+***************************************/
+
+/*
+ * One lazily allocated workspace per CPU, shared by the pooled CCtx and
+ * CStream interfaces. A workspace only ever grows, so once it is large
+ * enough for the biggest set of parameters used on a CPU it is never
+ * reallocated again.
+ */
+struct zstd_cpu_workspace {
+	void *workspace;
+	size_t workspaceSize;
+};
+
+static DEFINE_PER_CPU(struct zstd_cpu_workspace, zstd_cpu_workspace);
+
+/*
+ * Return this CPU's workspace, grown to at least `need` bytes, with
+ * preemption disabled until ZSTD_putPerCPUCCtx()/ZSTD_putPerCPUCStream().
+ * The buffer is replaced, never freed, while preemption is disabled, so
+ * the caller's workspace cannot go away under it. Returns NULL with
+ * preemption enabled if the allocation fails.
+ */
+static void *zstd_get_cpu_workspace(size_t need)
+{
+	struct zstd_cpu_workspace *ws;
+	void *mem;
+
+	for (;;) {
+		ws = get_cpu_ptr(&zstd_cpu_workspace);
+		if (likely(ws->workspaceSize >= need))
+			return ws->workspace;
+		put_cpu_ptr(&zstd_cpu_workspace);
+
+		mem = kvmalloc(need, GFP_KERNEL);
+		if (!mem)
+			return NULL;
+
+		/*
+		 * Install the buffer on whatever CPU the task runs on by
+		 * now. If that slot has grown large enough in the meantime
+		 * the new buffer is dropped instead; either way the loop
+		 * re-claims the slot with preemption disabled.
+		 */
+		preempt_disable();
+		ws = this_cpu_ptr(&zstd_cpu_workspace);
+		if (ws->workspaceSize < need) {
+			swap(ws->workspace, mem);
+			ws->workspaceSize = need;
+		}
+		preempt_enable();
+		kvfree(mem);
+	}
+}
+
+ZSTD_CCtx *ZSTD_getPerCPUCCtx(ZSTD_parameters params)
+{
+	size_t const need = ZSTD_CCtxWorkspaceBound(params.cParams);
+	void *workspace;
+
+	workspace = zstd_get_cpu_workspace(need);
+	if (!workspace)
+		return NULL;
+	return ZSTD_initCCtx(workspace, need);
+}
+EXPORT_SYMBOL(ZSTD_getPerCPUCCtx);
+
+void ZSTD_putPerCPUCCtx(void)
+{
+	put_cpu_ptr(&zstd_cpu_workspace);
+}
+EXPORT_SYMBOL(ZSTD_putPerCPUCCtx);
+
+ZSTD_CStream *ZSTD_getPerCPUCStream(ZSTD_parameters params,
+	unsigned long long pledgedSrcSize)
+{
+	size_t const need = ZSTD_CStreamWorkspaceBound(params.cParams);
+	void *workspace;
+
+	workspace = zstd_get_cpu_workspace(need);
+	if (!workspace)
+		return NULL;
+	return ZSTD_initCStream(params, pledgedSrcSize, workspace, need);
+}
+EXPORT_SYMBOL(ZSTD_getPerCPUCStream);
+
+void ZSTD_putPerCPUCStream(void)
+{
+	put_cpu_ptr(&zstd_cpu_workspace);
+}
+EXPORT_SYMBOL(ZSTD_putPerCPUCStream);
+
+static void __exit zstd_cctx_pool_exit(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct zstd_cpu_workspace *ws =
+			per_cpu_ptr(&zstd_cpu_workspace, cpu);
+
+		kvfree(ws->workspace);
+		ws->workspace = NULL;
+		ws->workspaceSize = 0;
+	}
+}
+module_exit(zstd_cctx_pool_exit);
@@ -360,21 +360,13 @@ EXPORT_SYMBOL(p9_tag_lookup);
 
 static int p9_tag_init(struct p9_client *c)
 {
-	int err = 0;
+	int err;
 
-	c->tagpool = p9_idpool_create();
-	if (IS_ERR(c->tagpool)) {
-		err = PTR_ERR(c->tagpool);
-		goto error;
-	}
-	err = p9_idpool_get(c->tagpool); /* reserve tag 0 */
-	if (err < 0) {
-		p9_idpool_destroy(c->tagpool);
-		goto error;
-	}
+	err = percpu_ida_init(&c->tagpool, P9_MAX_TAG);
+	if (err)
+		return err;
 	c->max_tag = 0;
-error:
-	return err;
+	return 0;
 }
 
 /**
@@ -401,10 +393,7 @@ static void p9_tag_cleanup(struct p9_client *c)
 		}
 	}
 
-	if (c->tagpool) {
-		p9_idpool_put(0, c->tagpool); /* free reserved tag 0 */
-		p9_idpool_destroy(c->tagpool);
-	}
+	percpu_ida_destroy(&c->tagpool);
 
 	/* free requests associated with tags */
 	for (row = 0; row < (c->max_tag/P9_ROW_MAXTAG); row++) {
@@ -431,8 +420,8 @@ static void p9_free_req(struct p9_client *c, struct p9_req_t *r)
 	p9_debug(P9_DEBUG_MUX, "clnt %p req %p tag: %d\n", c, r, tag);
 
 	r->status = REQ_STATUS_IDLE;
-	if (tag != P9_NOTAG && p9_idpool_check(tag, c->tagpool))
-		p9_idpool_put(tag, c->tagpool);
+	if (tag != P9_NOTAG)
+		percpu_ida_free(&c->tagpool, tag);
 }
 
 /**
@@ -714,9 +703,13 @@ static struct p9_req_t *p9_client_prepare_req(struct p9_client *c,
 
 	tag = P9_NOTAG;
 	if (type != P9_TVERSION) {
-		tag = p9_idpool_get(c->tagpool);
+		/*
+		 * Comes off the local cpu's freelist in the common case;
+		 * sleeps for a recycled tag if all P9_MAX_TAG are in flight.
+		 */
+		tag = percpu_ida_alloc(&c->tagpool, TASK_KILLABLE);
 		if (tag < 0)
-			return ERR_PTR(-ENOMEM);
+			return ERR_PTR(tag);
 	}
 
 	req = p9_tag_alloc(c, tag, req_size);
@@ -1077,7 +1070,7 @@ destroy_fidpool:
 put_trans:
 	v9fs_put_trans(clnt->trans_mod);
 destroy_tagpool:
-	p9_idpool_destroy(clnt->tagpool);
+	percpu_ida_destroy(&clnt->tagpool);
 free_client:
 	kfree(clnt);
 	return ERR_PTR(err);
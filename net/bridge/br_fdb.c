@@ -36,11 +36,28 @@ static const struct rhashtable_params br_fdb_rht_params = {
 	.locks_mul = 1,
 };
 
+/* A queued rtnetlink notification: the entry state is snapshotted at the
+ * time of the event, so the notification keeps its meaning even when the
+ * entry is modified or freed before the batch is sent out.
+ */
+struct br_fdb_event {
+	struct list_head list;
+	struct net_bridge_fdb_key key;
+	int ifindex;
+	int type;			/* RTM_NEWNEIGH/RTM_DELNEIGH */
+	u16 state;
+	u8 ndm_flags;
+	unsigned long updated;
+	unsigned long used;
+};
+
 static struct kmem_cache *br_fdb_cache __read_mostly;
+static struct kmem_cache *br_fdb_event_cache __read_mostly;
 static int fdb_insert(struct net_bridge *br, struct net_bridge_port *source,
 		      const unsigned char *addr, u16 vid);
 static void fdb_notify(struct net_bridge *br,
 		       const struct net_bridge_fdb_entry *, int);
+static void fdb_notify_work(struct work_struct *work);
 
 int __init br_fdb_init(void)
 {
@@ -51,21 +68,45 @@ int __init br_fdb_init(void)
 	if (!br_fdb_cache)
 		return -ENOMEM;
 
+	br_fdb_event_cache = kmem_cache_create("bridge_fdb_event_cache",
+					       sizeof(struct br_fdb_event),
+					       0, 0, NULL);
+	if (!br_fdb_event_cache) {
+		kmem_cache_destroy(br_fdb_cache);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
 void br_fdb_fini(void)
 {
+	kmem_cache_destroy(br_fdb_event_cache);
 	kmem_cache_destroy(br_fdb_cache);
 }
 
 int br_fdb_hash_init(struct net_bridge *br)
 {
+	spin_lock_init(&br->fdb_notify_lock);
+	INIT_LIST_HEAD(&br->fdb_notify_list);
+	INIT_WORK(&br->fdb_notify_work, fdb_notify_work);
+
 	return rhashtable_init(&br->fdb_hash_tbl, &br_fdb_rht_params);
 }
 
 void br_fdb_hash_fini(struct net_bridge *br)
 {
+	struct br_fdb_event *ev, *tmp;
+
+	/* The device is going away, drop the not yet sent notifications */
+	cancel_work_sync(&br->fdb_notify_work);
+	list_for_each_entry_safe(ev, tmp, &br->fdb_notify_list, list)
+		kmem_cache_free(br_fdb_event_cache, ev);
+
+	if (br->gc_iter_active) {
+		rhashtable_walk_exit(&br->gc_iter);
+		br->gc_iter_active = false;
+	}
 	rhashtable_destroy(&br->fdb_hash_tbl);
 }
 
@@ -309,28 +350,55 @@ out:
 	spin_unlock_bh(&br->hash_lock);
 }
 
+/* Max number of entries to examine per aging pass, so that a huge table
+ * is aged in several short passes instead of one unbounded walk
+ */
+#define BR_FDB_CLEANUP_BATCH	8192
+
 void br_fdb_cleanup(struct work_struct *work)
 {
 	struct net_bridge *br = container_of(work, struct net_bridge,
 					     gc_work.work);
-	struct net_bridge_fdb_entry *f = NULL;
+	struct net_bridge_fdb_entry *f;
 	unsigned long delay = hold_time(br);
+	unsigned int budget = BR_FDB_CLEANUP_BATCH;
 	unsigned long work_delay = delay;
 	unsigned long now = jiffies;
+	bool done = false;
 
-	/* this part is tricky, in order to avoid blocking learning and
-	 * consequently forwarding, we rely on rcu to delete objects with
-	 * delayed freeing allowing us to continue traversing
+	/* The sweep is incremental: the walker survives between the work
+	 * invocations and each pass examines a bounded number of entries.
+	 * A table resize restarts the sweep, which only costs examining
+	 * some entries twice. Learning and forwarding are never blocked,
+	 * expired entries are deleted under the hash lock one by one.
 	 */
-	rcu_read_lock();
-	hlist_for_each_entry_rcu(f, &br->fdb_list, fdb_node) {
+	if (!br->gc_iter_active) {
+		rhashtable_walk_enter(&br->fdb_hash_tbl, &br->gc_iter);
+		br->gc_iter_active = true;
+		br->gc_next_expiry = now + delay;
+	}
+
+	rhashtable_walk_start(&br->gc_iter);
+	while (budget--) {
 		unsigned long this_timer;
 
+		f = rhashtable_walk_next(&br->gc_iter);
+		if (IS_ERR(f)) {
+			/* -EAGAIN: the table was resized and the sweep
+			 * restarted, continue in the next pass
+			 */
+			break;
+		}
+		if (!f) {
+			done = true;
+			break;
+		}
 		if (f->is_static || f->added_by_external_learn)
 			continue;
 		this_timer = f->updated + delay;
 		if (time_after(this_timer, now)) {
-			work_delay = min(work_delay, this_timer - now);
+			if (time_before(this_timer, br->gc_next_expiry))
+				br->gc_next_expiry = this_timer;
 		} else {
 			spin_lock_bh(&br->hash_lock);
 			if (!hlist_unhashed(&f->fdb_node))
@@ -338,7 +406,18 @@ void br_fdb_cleanup(struct work_struct *work)
 			spin_unlock_bh(&br->hash_lock);
 		}
 	}
-	rcu_read_unlock();
+	rhashtable_walk_stop(&br->gc_iter);
+
+	if (done) {
+		rhashtable_walk_exit(&br->gc_iter);
+		br->gc_iter_active = false;
+		if (time_after(br->gc_next_expiry, now))
+			work_delay = min(work_delay,
+					 br->gc_next_expiry - now);
+	} else {
+		/* Sweep unfinished, continue shortly */
+		work_delay = 0;
+	}
 
 	/* Cleanup minimum 10 milliseconds apart */
 	work_delay = max_t(unsigned long, work_delay, msecs_to_jiffies(10));
@@ -605,9 +684,11 @@ static int fdb_to_nud(const struct net_bridge *br,
 		return NUD_REACHABLE;
 }
 
-static int fdb_fill_info(struct sk_buff *skb, const struct net_bridge *br,
-			 const struct net_bridge_fdb_entry *fdb,
-			 u32 portid, u32 seq, int type, unsigned int flags)
+static int fdb_fill_one(struct sk_buff *skb, const struct net_bridge *br,
+			const struct net_bridge_fdb_key *key, int ifindex,
+			u16 state, u8 ndm_flags, unsigned long updated,
+			unsigned long used, u32 portid, u32 seq, int type,
+			unsigned int flags)
 {
 	unsigned long now = jiffies;
 	struct nda_cacheinfo ci;
@@ -622,29 +703,24 @@ static int fdb_fill_info(struct sk_buff *skb, const struct net_bridge *br,
 	ndm->ndm_family	 = AF_BRIDGE;
 	ndm->ndm_pad1    = 0;
 	ndm->ndm_pad2    = 0;
-	ndm->ndm_flags	 = 0;
+	ndm->ndm_flags	 = ndm_flags;
 	ndm->ndm_type	 = 0;
-	ndm->ndm_ifindex = fdb->dst ? fdb->dst->dev->ifindex : br->dev->ifindex;
-	ndm->ndm_state   = fdb_to_nud(br, fdb);
-
-	if (fdb->offloaded)
-		ndm->ndm_flags |= NTF_OFFLOADED;
-	if (fdb->added_by_external_learn)
-		ndm->ndm_flags |= NTF_EXT_LEARNED;
+	ndm->ndm_ifindex = ifindex;
+	ndm->ndm_state   = state;
 
-	if (nla_put(skb, NDA_LLADDR, ETH_ALEN, &fdb->key.addr))
+	if (nla_put(skb, NDA_LLADDR, ETH_ALEN, &key->addr))
 		goto nla_put_failure;
 	if (nla_put_u32(skb, NDA_MASTER, br->dev->ifindex))
 		goto nla_put_failure;
-	ci.ndm_used	 = jiffies_to_clock_t(now - fdb->used);
+	ci.ndm_used	 = jiffies_to_clock_t(now - used);
 	ci.ndm_confirmed = 0;
-	ci.ndm_updated	 = jiffies_to_clock_t(now - fdb->updated);
+	ci.ndm_updated	 = jiffies_to_clock_t(now - updated);
 	ci.ndm_refcnt	 = 0;
 	if (nla_put(skb, NDA_CACHEINFO, sizeof(ci), &ci))
 		goto nla_put_failure;
 
-	if (fdb->key.vlan_id && nla_put(skb, NDA_VLAN, sizeof(u16),
-					&fdb->key.vlan_id))
+	if (key->vlan_id && nla_put(skb, NDA_VLAN, sizeof(u16),
+				    &key->vlan_id))
 		goto nla_put_failure;
 
 	nlmsg_end(skb, nlh);
@@ -655,6 +731,29 @@ nla_put_failure:
 	return -EMSGSIZE;
 }
 
+static u8 fdb_ndm_flags(const struct net_bridge_fdb_entry *fdb)
+{
+	u8 ndm_flags = 0;
+
+	if (fdb->offloaded)
+		ndm_flags |= NTF_OFFLOADED;
+	if (fdb->added_by_external_learn)
+		ndm_flags |= NTF_EXT_LEARNED;
+
+	return ndm_flags;
+}
+
+static int fdb_fill_info(struct sk_buff *skb, const struct net_bridge *br,
+			 const struct net_bridge_fdb_entry *fdb,
+			 u32 portid, u32 seq, int type, unsigned int flags)
+{
+	int ifindex = fdb->dst ? fdb->dst->dev->ifindex : br->dev->ifindex;
+
+	return fdb_fill_one(skb, br, &fdb->key, ifindex, fdb_to_nud(br, fdb),
+			    fdb_ndm_flags(fdb), fdb->updated, fdb->used,
+			    portid, seq, type, flags);
+}
+
 static inline size_t fdb_nlmsg_size(void)
 {
 	return NLMSG_ALIGN(sizeof(struct ndmsg))
@@ -664,30 +763,91 @@ static inline size_t fdb_nlmsg_size(void)
 		+ nla_total_size(sizeof(struct nda_cacheinfo));
 }
 
+/* Queue an rtnetlink notification for the entry. The notifications are
+ * sent out by fdb_notify_work(), many packed into one message, so that a
+ * learning or move storm does not allocate and send a separate skb per
+ * MAC address. The switchdev notifiers are still called inline: drivers
+ * rely on seeing the add/del before the entry changes again.
+ */
 static void fdb_notify(struct net_bridge *br,
 		       const struct net_bridge_fdb_entry *fdb, int type)
 {
-	struct net *net = dev_net(br->dev);
-	struct sk_buff *skb;
-	int err = -ENOBUFS;
+	struct br_fdb_event *ev;
 
 	br_switchdev_fdb_notify(fdb, type);
 
-	skb = nlmsg_new(fdb_nlmsg_size(), GFP_ATOMIC);
-	if (skb == NULL)
-		goto errout;
+	ev = kmem_cache_alloc(br_fdb_event_cache, GFP_ATOMIC);
+	if (!ev) {
+		rtnl_set_sk_err(dev_net(br->dev), RTNLGRP_NEIGH, -ENOBUFS);
+		return;
+	}
+
+	ev->key = fdb->key;
+	ev->ifindex = fdb->dst ? fdb->dst->dev->ifindex : br->dev->ifindex;
+	ev->type = type;
+	ev->state = fdb_to_nud(br, fdb);
+	ev->ndm_flags = fdb_ndm_flags(fdb);
+	ev->updated = fdb->updated;
+	ev->used = fdb->used;
+
+	spin_lock(&br->fdb_notify_lock);
+	list_add_tail(&ev->list, &br->fdb_notify_list);
+	spin_unlock(&br->fdb_notify_lock);
+	schedule_work(&br->fdb_notify_work);
+}
 
-	err = fdb_fill_info(skb, br, fdb, 0, 0, type, 0);
-	if (err < 0) {
-		/* -EMSGSIZE implies BUG in fdb_nlmsg_size() */
-		WARN_ON(err == -EMSGSIZE);
-		kfree_skb(skb);
-		goto errout;
+static void fdb_notify_work(struct work_struct *work)
+{
+	struct net_bridge *br = container_of(work, struct net_bridge,
+					     fdb_notify_work);
+	struct net *net = dev_net(br->dev);
+	struct br_fdb_event *ev, *tmp;
+	struct sk_buff *skb = NULL;
+	LIST_HEAD(list);
+
+	spin_lock_bh(&br->fdb_notify_lock);
+	list_splice_init(&br->fdb_notify_list, &list);
+	spin_unlock_bh(&br->fdb_notify_lock);
+
+	list_for_each_entry_safe(ev, tmp, &list, list) {
+		if (!skb) {
+			skb = nlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+			if (!skb) {
+				rtnl_set_sk_err(net, RTNLGRP_NEIGH, -ENOBUFS);
+				break;
+			}
+		}
+		if (fdb_fill_one(skb, br, &ev->key, ev->ifindex, ev->state,
+				 ev->ndm_flags, ev->updated, ev->used,
+				 0, 0, ev->type, 0) < 0) {
+			/* Full, send it out and retry on a fresh one */
+			rtnl_notify(skb, net, 0, RTNLGRP_NEIGH, NULL,
+				    GFP_KERNEL);
+			skb = nlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+			if (!skb) {
+				rtnl_set_sk_err(net, RTNLGRP_NEIGH, -ENOBUFS);
+				break;
+			}
+			/* -EMSGSIZE on an empty skb implies BUG in
+			 * fdb_nlmsg_size()
+			 */
+			WARN_ON(fdb_fill_one(skb, br, &ev->key, ev->ifindex,
+					     ev->state, ev->ndm_flags,
+					     ev->updated, ev->used,
+					     0, 0, ev->type, 0) < 0);
+		}
+		list_del(&ev->list);
+		kmem_cache_free(br_fdb_event_cache, ev);
+	}
+	if (skb)
+		rtnl_notify(skb, net, 0, RTNLGRP_NEIGH, NULL, GFP_KERNEL);
+
+	/* Put back what was not sent */
+	if (!list_empty(&list)) {
+		spin_lock_bh(&br->fdb_notify_lock);
+		list_splice(&list, &br->fdb_notify_list);
+		spin_unlock_bh(&br->fdb_notify_lock);
 	}
-	rtnl_notify(skb, net, 0, RTNLGRP_NEIGH, NULL, GFP_ATOMIC);
-	return;
-errout:
-	rtnl_set_sk_err(net, RTNLGRP_NEIGH, err);
 }
 
 /* Dump information about entries, in response to GETNEIGH */
@@ -403,6 +403,14 @@ struct net_bridge {
 	struct timer_list		tcn_timer;
 	struct timer_list		topology_change_timer;
 	struct delayed_work		gc_work;
+	/* aging sweep state, only used by gc_work; see br_fdb_cleanup() */
+	struct rhashtable_iter		gc_iter;
+	bool				gc_iter_active;
+	unsigned long			gc_next_expiry;
+	/* batching of fdb rtnetlink notifications */
+	spinlock_t			fdb_notify_lock;
+	struct list_head		fdb_notify_list;
+	struct work_struct		fdb_notify_work;
 	struct kobject			*ifobj;
 	u32				auto_cnt;
 
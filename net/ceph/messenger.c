@@ -492,6 +492,21 @@ static int ceph_tcp_connect(struct ceph_connection *con)
 
 	set_sock_callbacks(sock, con);
 
+	/* Message data pages stay pinned by the owning request until it
+	 * completes, so data sends can reference them with MSG_ZEROCOPY.
+	 * Must be set before connect(); if it fails the flag is simply
+	 * ignored on sendmsg and TCP copies as before.
+	 */
+	{
+		int optval = 1;
+
+		ret = kernel_setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY,
+					(char *)&optval, sizeof(optval));
+		if (ret)
+			dout("kernel_setsockopt(SO_ZEROCOPY) failed: %d\n",
+			     ret);
+	}
+
 	dout("connect %s\n", ceph_pr_addr(&con->peer_addr.in_addr));
 
 	con_sock_state_connecting(con);
@@ -617,6 +632,45 @@ static int ceph_tcp_sendpage(struct socket *sock, struct page *page,
 	return ret;
 }
 
+/*
+ * Send a batch of message data pieces in one vectored zero-copy call.
+ * @sent bytes at the front of the batch have already been pushed to the
+ * socket by a previous, partial attempt.
+ */
+static int ceph_tcp_send_bvecs(struct socket *sock, struct bio_vec *bvecs,
+			       int cnt, size_t bytes, size_t sent, bool more)
+{
+	struct msghdr msg = {
+		.msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL | MSG_ZEROCOPY,
+	};
+	int ret;
+
+	if (more)
+		msg.msg_flags |= MSG_MORE;
+	else
+		msg.msg_flags |= MSG_EOR;  /* superfluous, but what the hell */
+
+	iov_iter_bvec(&msg.msg_iter, WRITE | ITER_BVEC, bvecs, cnt, bytes);
+	iov_iter_advance(&msg.msg_iter, sent);
+	ret = sock_sendmsg(sock, &msg);
+	if (ret == -EAGAIN)
+		ret = 0;
+	return ret;
+}
+
+/*
+ * Throw away MSG_ZEROCOPY completion notifications. We don't need
+ * them - the data pages are held by the owning request until it
+ * completes - but left unread they would pin receive memory.
+ */
+static void ceph_tcp_drain_errqueue(struct socket *sock)
+{
+	struct sk_buff *skb;
+
+	while ((skb = skb_dequeue(&sock->sk->sk_error_queue)))
+		kfree_skb(skb);
+}
+
 /*
  * Shutdown/close the socket for the given connection.
  */
@@ -1333,6 +1387,9 @@ static void prepare_write_message(struct ceph_connection *con)
 	con->out_msg->footer.data_crc = 0;
 	if (m->data_length) {
 		prepare_message_data(con->out_msg, m->data_length);
+		con->out_data_bvec_cnt = 0;
+		con->out_data_bvec_bytes = 0;
+		con->out_data_bvec_sent = 0;
 		con->out_more = 1;  /* data + footer will follow */
 	} else {
 		/* no, queue up footer too and be done */
@@ -1566,35 +1623,55 @@ static int write_partial_message_data(struct ceph_connection *con)
 	if (list_empty(&msg->data))
 		return -EINVAL;
 
+	ceph_tcp_drain_errqueue(con->sock);
+
 	/*
-	 * Iterate through each page that contains data to be
-	 * written, and send as much as possible for each.
-	 *
-	 * If we are calculating the data crc (the default), we will
-	 * need to map the page.  If we have no pages, they have
-	 * been revoked, so use the zero page.
+	 * Batch up the pages that contain data to be written and hand
+	 * each batch to the socket as one vectored zero-copy send. The
+	 * crc of a piece (the default) is folded in as it is batched,
+	 * so it is computed once per piece no matter how the socket
+	 * fragments the sends.
 	 */
 	crc = do_datacrc ? le32_to_cpu(msg->footer.data_crc) : 0;
-	while (cursor->resid) {
-		struct page *page;
-		size_t page_offset;
-		size_t length;
-		bool last_piece;
+	while (cursor->resid || con->out_data_bvec_cnt) {
 		int ret;
 
-		page = ceph_msg_data_next(cursor, &page_offset, &length,
-					  &last_piece);
-		ret = ceph_tcp_sendpage(con->sock, page, page_offset,
-					length, !last_piece);
+		while (cursor->resid &&
+		       con->out_data_bvec_cnt < CEPH_MSG_DATA_BVECS) {
+			struct bio_vec *bv =
+				&con->out_data_bvecs[con->out_data_bvec_cnt];
+			size_t page_offset;
+			size_t length;
+
+			bv->bv_page = ceph_msg_data_next(cursor, &page_offset,
+							 &length, NULL);
+			bv->bv_offset = page_offset;
+			bv->bv_len = length;
+			con->out_data_bvec_cnt++;
+			con->out_data_bvec_bytes += length;
+			if (do_datacrc && cursor->need_crc)
+				crc = ceph_crc32c_page(crc, bv->bv_page,
+						       page_offset, length);
+			ceph_msg_data_advance(cursor, length);
+		}
+
+		ret = ceph_tcp_send_bvecs(con->sock, con->out_data_bvecs,
+					  con->out_data_bvec_cnt,
+					  con->out_data_bvec_bytes,
+					  con->out_data_bvec_sent,
+					  cursor->resid != 0);
 		if (ret <= 0) {
 			if (do_datacrc)
 				msg->footer.data_crc = cpu_to_le32(crc);
 
 			return ret;
 		}
-		if (do_datacrc && cursor->need_crc)
-			crc = ceph_crc32c_page(crc, page, page_offset, length);
-		ceph_msg_data_advance(cursor, (size_t)ret);
+		con->out_data_bvec_sent += ret;
+		if (con->out_data_bvec_sent == con->out_data_bvec_bytes) {
+			con->out_data_bvec_cnt = 0;
+			con->out_data_bvec_bytes = 0;
+			con->out_data_bvec_sent = 0;
+		}
 	}
 
 	dout("%s %p msg %p done\n", __func__, con, msg);
@@ -3114,8 +3191,15 @@ void ceph_msg_revoke(struct ceph_msg *msg)
 			con->out_skip += sizeof_footer(con);
 		}
 		/* data, middle, front */
-		if (msg->data_length)
+		if (msg->data_length) {
 			con->out_skip += msg->cursor.total_resid;
+			/* batched but not yet pushed to the socket */
+			con->out_skip += con->out_data_bvec_bytes -
+					 con->out_data_bvec_sent;
+			con->out_data_bvec_cnt = 0;
+			con->out_data_bvec_bytes = 0;
+			con->out_data_bvec_sent = 0;
+		}
 		if (msg->middle)
 			con->out_skip += con_out_kvec_skip(con);
 		con->out_skip += con_out_kvec_skip(con);
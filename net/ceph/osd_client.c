@@ -3620,8 +3620,147 @@ static void scan_requests(struct ceph_osd *osd,
 	}
 }
 
+/*
+ * A map from an osdmap message whose expensive, base-map-independent
+ * parts (a full map, or the crush map of an incremental) were decoded
+ * before osdc->lock was taken.
+ */
+struct ceph_osdmap_predec {
+	u32 epoch;
+	struct ceph_osdmap *fullmap;
+	struct crush_map *crush;
+};
+
+/*
+ * Walk the maps in an osdmap message and decode the parts that don't
+ * depend on the current map: embedded/standalone full maps and new
+ * crush maps.  These account for almost all of the decode cost, so
+ * doing them here keeps multi-ms decodes from stalling submissions
+ * behind down_write(&osdc->lock).  Best effort - on any failure the
+ * apply phase simply decodes inline under the lock, as it always did.
+ */
+static struct ceph_osdmap_predec *predecode_maps(void *p, void *end,
+						 u32 have_epoch, u32 *pnr)
+{
+	struct ceph_osdmap_predec *predec;
+	u32 nr_inc, nr_full, epoch, maplen;
+	void *q = p;
+	u32 nr = 0;
+	u32 i;
+
+	*pnr = 0;
+
+	/* fsid */
+	ceph_decode_need(&q, end, sizeof(struct ceph_fsid), bad);
+	q += sizeof(struct ceph_fsid);
+
+	/* count maps to size the array */
+	ceph_decode_32_safe(&q, end, nr_inc, bad);
+	for (i = 0; i < nr_inc; i++) {
+		ceph_decode_need(&q, end, 2*sizeof(u32), bad);
+		q += sizeof(u32); /* epoch */
+		maplen = ceph_decode_32(&q);
+		ceph_decode_need(&q, end, maplen, bad);
+		q += maplen;
+	}
+	ceph_decode_32_safe(&q, end, nr_full, bad);
+
+	if (!nr_inc && !nr_full)
+		return NULL;
+
+	predec = kcalloc(nr_inc + (nr_full ? 1 : 0), sizeof(*predec),
+			 GFP_NOIO);
+	if (!predec)
+		return NULL;
+
+	/* incremental maps */
+	q = p + sizeof(struct ceph_fsid) + sizeof(u32);
+	for (i = 0; i < nr_inc; i++) {
+		epoch = ceph_decode_32(&q);
+		maplen = ceph_decode_32(&q);
+		if (epoch == have_epoch + 1) {
+			struct ceph_osdmap_predec *pd = &predec[nr];
+
+			if (!ceph_osdmap_inc_predecode(q, q + maplen,
+						       &pd->fullmap,
+						       &pd->crush) &&
+			    (pd->fullmap || pd->crush)) {
+				pd->epoch = epoch;
+				nr++;
+			}
+			/* follow the chain the apply phase will walk */
+			have_epoch = epoch;
+		}
+		q += maplen;
+	}
+
+	/* only the latest full map is ever taken */
+	if (nr_full) {
+		q += sizeof(u32);
+		for (i = 0; i < nr_full; i++) {
+			ceph_decode_need(&q, end, 2*sizeof(u32), bad_partial);
+			epoch = ceph_decode_32(&q);
+			maplen = ceph_decode_32(&q);
+			ceph_decode_need(&q, end, maplen, bad_partial);
+			if (i == nr_full - 1 && epoch > have_epoch) {
+				struct ceph_osdmap_predec *pd = &predec[nr];
+				void *mp = q;
+				struct ceph_osdmap *map;
+
+				map = ceph_osdmap_decode(&mp, q + maplen);
+				if (!IS_ERR(map)) {
+					pd->epoch = epoch;
+					pd->fullmap = map;
+					nr++;
+				}
+			}
+			q += maplen;
+		}
+	}
+
+bad_partial:
+	*pnr = nr;
+	return predec;
+
+bad:
+	return NULL;
+}
+
+static void predec_take(struct ceph_osdmap_predec *predec, u32 nr, u32 epoch,
+			struct ceph_osdmap **fullmap, struct crush_map **crush)
+{
+	u32 i;
+
+	*fullmap = NULL;
+	*crush = NULL;
+	for (i = 0; i < nr; i++) {
+		if (predec[i].epoch == epoch) {
+			*fullmap = predec[i].fullmap;
+			*crush = predec[i].crush;
+			predec[i].fullmap = NULL;
+			predec[i].crush = NULL;
+			return;
+		}
+	}
+}
+
+static void predec_free(struct ceph_osdmap_predec *predec, u32 nr)
+{
+	u32 i;
+
+	for (i = 0; i < nr; i++) {
+		if (predec[i].fullmap)
+			ceph_osdmap_destroy(predec[i].fullmap);
+		if (predec[i].crush)
+			crush_destroy(predec[i].crush);
+	}
+	kfree(predec);
+}
+
 static int handle_one_map(struct ceph_osd_client *osdc,
 			  void *p, void *end, bool incremental,
+			  struct ceph_osdmap *prefull,
+			  struct crush_map **precrush,
 			  struct rb_root *need_resend,
 			  struct list_head *need_resend_linger)
 {
@@ -3633,8 +3772,11 @@ static int handle_one_map(struct ceph_osd_client *osdc,
 	was_full = ceph_osdmap_flag(osdc, CEPH_OSDMAP_FULL);
 	set_pool_was_full(osdc);
 
-	if (incremental)
-		newmap = osdmap_apply_incremental(&p, end, osdc->osdmap);
+	if (prefull)
+		newmap = prefull;
+	else if (incremental)
+		newmap = osdmap_apply_incremental(&p, end, osdc->osdmap,
+						  precrush);
 	else
 		newmap = ceph_osdmap_decode(&p, end);
 	if (IS_ERR(newmap))
@@ -3758,9 +3900,22 @@ void ceph_osdc_handle_map(struct ceph_osd_client *osdc, struct ceph_msg *msg)
 	bool handled_incremental = false;
 	bool was_pauserd, was_pausewr;
 	bool pauserd, pausewr;
+	struct ceph_osdmap_predec *predec;
+	u32 nr_predec = 0;
 	int err;
 
 	dout("%s have %u\n", __func__, osdc->osdmap->epoch);
+
+	/*
+	 * Decode the expensive parts of the new maps before taking the
+	 * lock, so that in-flight submissions don't stall behind epoch
+	 * churn.  ->epoch is read unlocked, but it only ever grows: at
+	 * worst we predecode maps that turn out to be stale and free
+	 * them below.
+	 */
+	predec = predecode_maps(p, end, READ_ONCE(osdc->osdmap->epoch),
+				&nr_predec);
+
 	down_write(&osdc->lock);
 
 	/* verify fsid */
@@ -3784,10 +3939,18 @@ void ceph_osdc_handle_map(struct ceph_osd_client *osdc, struct ceph_msg *msg)
 		ceph_decode_need(&p, end, maplen, bad);
 		if (osdc->osdmap->epoch &&
 		    osdc->osdmap->epoch + 1 == epoch) {
+			struct ceph_osdmap *prefull;
+			struct crush_map *precrush;
+
+			predec_take(predec, nr_predec, epoch, &prefull,
+				    &precrush);
 			dout("applying incremental map %u len %d\n",
 			     epoch, maplen);
 			err = handle_one_map(osdc, p, p + maplen, true,
+					     prefull, &precrush,
 					     &need_resend, &need_resend_linger);
+			if (precrush)
+				crush_destroy(precrush);
 			if (err)
 				goto bad;
 			handled_incremental = true;
@@ -3817,9 +3980,17 @@ void ceph_osdc_handle_map(struct ceph_osd_client *osdc, struct ceph_msg *msg)
 			     "older than our %u\n", epoch, maplen,
 			     osdc->osdmap->epoch);
 		} else {
+			struct ceph_osdmap *prefull;
+			struct crush_map *precrush;
+
+			predec_take(predec, nr_predec, epoch, &prefull,
+				    &precrush);
 			dout("taking full map %u len %d\n", epoch, maplen);
 			err = handle_one_map(osdc, p, p + maplen, false,
+					     prefull, NULL,
 					     &need_resend, &need_resend_linger);
+			if (precrush)
+				crush_destroy(precrush);
 			if (err)
 				goto bad;
 		}
@@ -3847,6 +4018,7 @@ done:
 	ceph_monc_got_map(&osdc->client->monc, CEPH_SUB_OSDMAP,
 			  osdc->osdmap->epoch);
 	up_write(&osdc->lock);
+	predec_free(predec, nr_predec);
 	wake_up_all(&osdc->client->auth_wq);
 	return;
 
@@ -3854,6 +4026,7 @@ bad:
 	pr_err("osdc handle_map corrupt msg\n");
 	ceph_msg_dump(msg);
 	up_write(&osdc->lock);
+	predec_free(predec, nr_predec);
 }
 
 /*
@@ -1715,11 +1715,76 @@ e_inval:
 	return -EINVAL;
 }
 
+/*
+ * Pre-decode the parts of an incremental map that do not depend on the
+ * map it will be applied to: an embedded full map or a new crush map.
+ * These dominate the decode cost, so pulling them out lets the caller
+ * do the expensive work before taking any submission-blocking locks.
+ *
+ * At most one of *pfullmap and *pcrush is set on success; the caller
+ * owns whatever comes back.  Returns 0 also when there is nothing to
+ * pre-decode.  Does not consume the buffer.
+ */
+int ceph_osdmap_inc_predecode(void *p, void *end,
+			      struct ceph_osdmap **pfullmap,
+			      struct crush_map **pcrush)
+{
+	s32 len;
+	int err;
+	u8 struct_v;
+
+	*pfullmap = NULL;
+	*pcrush = NULL;
+
+	err = get_osdmap_client_data_v(&p, end, "inc", &struct_v);
+	if (err)
+		return err;
+
+	/* skip fsid, epoch, modified, new_pool_max, new_flags */
+	ceph_decode_need(&p, end, sizeof(struct ceph_fsid) + sizeof(u32) +
+			 sizeof(struct ceph_timespec) + sizeof(u64) +
+			 sizeof(u32), e_inval);
+	p += sizeof(struct ceph_fsid) + sizeof(u32) +
+	     sizeof(struct ceph_timespec) + sizeof(u64) + sizeof(u32);
+
+	/* full map? */
+	ceph_decode_32_safe(&p, end, len, e_inval);
+	if (len > 0) {
+		struct ceph_osdmap *fullmap;
+
+		fullmap = ceph_osdmap_decode(&p, min(p + len, end));
+		if (IS_ERR(fullmap))
+			return PTR_ERR(fullmap);
+		*pfullmap = fullmap;
+		return 0;
+	}
+
+	/* new crush? */
+	ceph_decode_32_safe(&p, end, len, e_inval);
+	if (len > 0) {
+		struct crush_map *crush;
+
+		crush = crush_decode(p, min(p + len, end));
+		if (IS_ERR(crush))
+			return PTR_ERR(crush);
+		*pcrush = crush;
+	}
+
+	return 0;
+
+e_inval:
+	return -EINVAL;
+}
+
 /*
  * decode and apply an incremental map update.
+ *
+ * If the caller pre-decoded the new crush map (ceph_osdmap_inc_predecode),
+ * *precrush is consumed (and cleared) instead of decoding it here.
  */
 struct ceph_osdmap *osdmap_apply_incremental(void **p, void *end,
-					     struct ceph_osdmap *map)
+					     struct ceph_osdmap *map,
+					     struct crush_map **precrush)
 {
 	struct ceph_fsid fsid;
 	u32 epoch = 0;
@@ -1759,8 +1824,15 @@ struct ceph_osdmap *osdmap_apply_incremental(void **p, void *end,
 	/* new crush? */
 	ceph_decode_32_safe(p, end, len, e_inval);
 	if (len > 0) {
-		err = osdmap_set_crush(map,
-				       crush_decode(*p, min(*p + len, end)));
+		struct crush_map *crush;
+
+		if (precrush && *precrush) {
+			crush = *precrush;
+			*precrush = NULL;
+		} else {
+			crush = crush_decode(*p, min(*p + len, end));
+		}
+		err = osdmap_set_crush(map, crush);
 		if (err)
 			goto bad;
 		*p += len;
@@ -9,6 +9,7 @@
  * (at your option) any later version.
  */
 
+#include <linux/hash.h>
 #include <linux/kernel.h>
 #include <linux/percpu.h>
 #include <net/dst_cache.h>
@@ -18,6 +19,14 @@
 #endif
 #include <uapi/linux/in.h>
 
+/* Each cpu holds a small destination-indexed array of entries, so that a
+ * single dst_cache instance shared by many remotes (multipoint tunnels)
+ * still hits.  The keyless legacy API always uses way 0.  The two styles
+ * must not be mixed on one instance.
+ */
+#define DST_CACHE_WAYS_BITS	3
+#define DST_CACHE_WAYS		(1 << DST_CACHE_WAYS_BITS)
+
 struct dst_cache_pcpu {
 	unsigned long refresh_ts;
 	struct dst_entry *dst;
@@ -26,6 +35,10 @@ struct dst_cache_pcpu {
 		struct in_addr in_saddr;
 		struct in6_addr in6_saddr;
 	};
+	union {
+		struct in_addr in_daddr;
+		struct in6_addr in6_daddr;
+	};
 };
 
 static void dst_cache_per_cpu_dst_set(struct dst_cache_pcpu *dst_cache,
@@ -39,6 +52,12 @@ static void dst_cache_per_cpu_dst_set(struct dst_cache_pcpu *dst_cache,
 	dst_cache->dst = dst;
 }
 
+static struct dst_cache_pcpu *dst_cache_per_cpu_way(struct dst_cache *dst_cache,
+						    u32 hash)
+{
+	return this_cpu_ptr(dst_cache->cache) + (hash & (DST_CACHE_WAYS - 1));
+}
+
 static struct dst_entry *dst_cache_per_cpu_get(struct dst_cache *dst_cache,
 					       struct dst_cache_pcpu *idst)
 {
@@ -105,6 +124,53 @@ void dst_cache_set_ip4(struct dst_cache *dst_cache, struct dst_entry *dst,
 }
 EXPORT_SYMBOL_GPL(dst_cache_set_ip4);
 
+struct rtable *dst_cache_get_ip4_key(struct dst_cache *dst_cache, __be32 daddr,
+				     __be32 *saddr)
+{
+	struct dst_cache_pcpu *idst;
+	struct dst_entry *dst;
+
+	if (!dst_cache->cache)
+		return NULL;
+
+	idst = dst_cache_per_cpu_way(dst_cache,
+				     hash_32((__force u32)daddr,
+					     DST_CACHE_WAYS_BITS));
+	if (idst->in_daddr.s_addr != daddr)
+		return NULL;
+
+	dst = dst_cache_per_cpu_get(dst_cache, idst);
+	if (!dst)
+		return NULL;
+
+	*saddr = idst->in_saddr.s_addr;
+	return container_of(dst, struct rtable, dst);
+}
+EXPORT_SYMBOL_GPL(dst_cache_get_ip4_key);
+
+void dst_cache_set_ip4_key(struct dst_cache *dst_cache, __be32 daddr,
+			   struct dst_entry *dst, __be32 saddr)
+{
+	struct dst_cache_pcpu *idst;
+
+	if (!dst_cache->cache)
+		return;
+
+	idst = dst_cache_per_cpu_way(dst_cache,
+				     hash_32((__force u32)daddr,
+					     DST_CACHE_WAYS_BITS));
+	dst_cache_per_cpu_dst_set(idst, dst, 0);
+
+	/* a keyed lookup may miss on the way key without touching the entry,
+	 * so the refresh timestamp must be taken here for the generation
+	 * check in dst_cache_per_cpu_get() to pass
+	 */
+	idst->refresh_ts = jiffies;
+	idst->in_daddr.s_addr = daddr;
+	idst->in_saddr.s_addr = saddr;
+}
+EXPORT_SYMBOL_GPL(dst_cache_set_ip4_key);
+
 #if IS_ENABLED(CONFIG_IPV6)
 void dst_cache_set_ip6(struct dst_cache *dst_cache, struct dst_entry *dst,
 		       const struct in6_addr *addr)
@@ -139,12 +205,60 @@ struct dst_entry *dst_cache_get_ip6(struct dst_cache *dst_cache,
 	return dst;
 }
 EXPORT_SYMBOL_GPL(dst_cache_get_ip6);
+
+struct dst_entry *dst_cache_get_ip6_key(struct dst_cache *dst_cache,
+					const struct in6_addr *daddr,
+					struct in6_addr *saddr)
+{
+	struct dst_cache_pcpu *idst;
+	struct dst_entry *dst;
+
+	if (!dst_cache->cache)
+		return NULL;
+
+	idst = dst_cache_per_cpu_way(dst_cache,
+				     hash_32(ipv6_addr_hash(daddr),
+					     DST_CACHE_WAYS_BITS));
+	if (!ipv6_addr_equal(&idst->in6_daddr, daddr))
+		return NULL;
+
+	dst = dst_cache_per_cpu_get(dst_cache, idst);
+	if (!dst)
+		return NULL;
+
+	*saddr = idst->in6_saddr;
+	return dst;
+}
+EXPORT_SYMBOL_GPL(dst_cache_get_ip6_key);
+
+void dst_cache_set_ip6_key(struct dst_cache *dst_cache,
+			   const struct in6_addr *daddr,
+			   struct dst_entry *dst,
+			   const struct in6_addr *saddr)
+{
+	struct dst_cache_pcpu *idst;
+
+	if (!dst_cache->cache)
+		return;
+
+	idst = dst_cache_per_cpu_way(dst_cache,
+				     hash_32(ipv6_addr_hash(daddr),
+					     DST_CACHE_WAYS_BITS));
+	dst_cache_per_cpu_dst_set(idst, dst,
+				  rt6_get_cookie((struct rt6_info *)dst));
+	idst->refresh_ts = jiffies;
+	idst->in6_daddr = *daddr;
+	idst->in6_saddr = *saddr;
+}
+EXPORT_SYMBOL_GPL(dst_cache_set_ip6_key);
 #endif
 
 int dst_cache_init(struct dst_cache *dst_cache, gfp_t gfp)
 {
-	dst_cache->cache = alloc_percpu_gfp(struct dst_cache_pcpu,
-					    gfp | __GFP_ZERO);
+	dst_cache->cache = __alloc_percpu_gfp(DST_CACHE_WAYS *
+					      sizeof(struct dst_cache_pcpu),
+					      __alignof__(struct dst_cache_pcpu),
+					      gfp | __GFP_ZERO);
 	if (!dst_cache->cache)
 		return -ENOMEM;
 
@@ -155,13 +269,14 @@ EXPORT_SYMBOL_GPL(dst_cache_init);
 
 void dst_cache_destroy(struct dst_cache *dst_cache)
 {
-	int i;
+	int i, way;
 
 	if (!dst_cache->cache)
 		return;
 
 	for_each_possible_cpu(i)
-		dst_release(per_cpu_ptr(dst_cache->cache, i)->dst);
+		for (way = 0; way < DST_CACHE_WAYS; way++)
+			dst_release(per_cpu_ptr(dst_cache->cache, i)[way].dst);
 
 	free_percpu(dst_cache->cache);
 }
@@ -1954,6 +1954,131 @@ static int ethtool_get_stats(struct net_device *dev, void __user *useraddr)
 	return ret;
 }
 
+/* Sample one device for ETHTOOL_GSTATSSNAP.  Takes rtnl only for the
+ * duration of the ethtool calls on this one device: drivers implement
+ * get_sset_count() and get_ethtool_stats() assuming rtnl protection, and
+ * may walk ring state that is torn down under rtnl elsewhere.  The user
+ * copies happen in the caller with rtnl dropped.
+ *
+ * Return: the number of counters written to data, or -errno; -EMSGSIZE
+ * means the caller's per-device buffer is too small and the string set
+ * should be re-fetched.
+ */
+static int ethtool_snapshot_one(struct net *net, u32 ifindex, u64 *data,
+				u32 n_stats_max)
+{
+	struct ethtool_stats stats = { .cmd = ETHTOOL_GSTATS };
+	const struct ethtool_ops *ops;
+	struct net_device *dev;
+	int n_stats, ret = 0;
+
+	rtnl_lock();
+	dev = __dev_get_by_index(net, ifindex);
+	if (!dev || !netif_device_present(dev)) {
+		ret = -ENODEV;
+		goto out_unlock;
+	}
+
+	ops = dev->ethtool_ops;
+	if (!ops->get_ethtool_stats || !ops->get_sset_count) {
+		ret = -EOPNOTSUPP;
+		goto out_unlock;
+	}
+
+	if (ops->begin) {
+		ret = ops->begin(dev);
+		if (ret < 0)
+			goto out_unlock;
+	}
+
+	n_stats = ops->get_sset_count(dev, ETH_SS_STATS);
+	if (n_stats < 0) {
+		ret = n_stats;
+	} else if (n_stats > n_stats_max) {
+		ret = -EMSGSIZE;
+	} else {
+		stats.n_stats = n_stats;
+		ops->get_ethtool_stats(dev, &stats, data);
+		ret = n_stats;
+	}
+
+	if (ops->complete)
+		ops->complete(dev);
+out_unlock:
+	rtnl_unlock();
+	return ret;
+}
+
+/* ETHTOOL_GSTATSSNAP: sample the ETH_SS_STATS counters of many devices in
+ * one call, taking rtnl per device rather than across the whole batch, so
+ * the user copies and allocations never hold it.  The user buffer is a struct
+ * ethtool_stats_snapshot followed by n_devs struct ethtool_stats_snap_dev
+ * records and then n_devs packed blocks of n_stats_max u64 counters, one
+ * per device in devs[] order.  Counter i of a block corresponds to string
+ * i of the device's ETHTOOL_GSTRINGS table, which only needs to be
+ * fetched when a device's reported n_stats changes.
+ *
+ * Called from dev_ioctl() before rtnl is taken; returns -ENOIOCTLCMD for
+ * every other ethtool command so the caller falls back to dev_ethtool().
+ */
+int dev_ethtool_snapshot(struct net *net, struct ifreq *ifr)
+{
+	void __user *useraddr = ifr->ifr_data;
+	struct ethtool_stats_snapshot snap;
+	struct ethtool_stats_snap_dev sdev;
+	void __user *devp, *datap;
+	size_t block_size;
+	u64 *data;
+	int ret = 0;
+	u32 i;
+
+	if (copy_from_user(&snap.cmd, useraddr, sizeof(snap.cmd)))
+		return -EFAULT;
+	if (snap.cmd != ETHTOOL_GSTATSSNAP)
+		return -ENOIOCTLCMD;
+
+	if (copy_from_user(&snap, useraddr, sizeof(snap)))
+		return -EFAULT;
+
+	if (!snap.n_devs || !snap.n_stats_max ||
+	    snap.n_stats_max > S32_MAX / sizeof(u64))
+		return -EINVAL;
+
+	block_size = snap.n_stats_max * sizeof(u64);
+	data = vzalloc(block_size);
+	if (!data)
+		return -ENOMEM;
+
+	devp = useraddr + sizeof(snap);
+	datap = devp + (size_t)snap.n_devs * sizeof(sdev);
+
+	for (i = 0; i < snap.n_devs; i++) {
+		if (copy_from_user(&sdev, devp, sizeof(sdev))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		sdev.n_stats = ethtool_snapshot_one(net, sdev.ifindex, data,
+						    snap.n_stats_max);
+
+		if (sdev.n_stats > 0 &&
+		    copy_to_user(datap, data, sdev.n_stats * sizeof(u64))) {
+			ret = -EFAULT;
+			break;
+		}
+		if (copy_to_user(devp, &sdev, sizeof(sdev))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		devp += sizeof(sdev);
+		datap += block_size;
+	}
+
+	vfree(data);
+	return ret;
+}
+
 static int ethtool_get_phy_stats(struct net_device *dev, void __user *useraddr)
 {
 	struct ethtool_stats stats;
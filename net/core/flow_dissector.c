@@ -559,6 +559,121 @@ static bool skb_flow_dissect_allowed(int *num_hdrs)
 	return (*num_hdrs <= MAX_FLOW_DISSECT_HDRS);
 }
 
+/* Keys a dissector may declare and still be eligible for the specialized
+ * fast paths below: the keys the fast paths fill themselves, plus keys the
+ * generic walker could only fill from headers (VLAN, TIPC, GRE, MPLS) that
+ * make the fast paths decline the packet anyway.
+ */
+#define FLOW_DISSECT_FAST_KEYS				\
+	((1 << FLOW_DISSECTOR_KEY_CONTROL) |		\
+	 (1 << FLOW_DISSECTOR_KEY_BASIC) |		\
+	 (1 << FLOW_DISSECTOR_KEY_IPV4_ADDRS) |		\
+	 (1 << FLOW_DISSECTOR_KEY_IPV6_ADDRS) |		\
+	 (1 << FLOW_DISSECTOR_KEY_PORTS) |		\
+	 (1 << FLOW_DISSECTOR_KEY_FLOW_LABEL) |		\
+	 (1 << FLOW_DISSECTOR_KEY_VLAN) |		\
+	 (1 << FLOW_DISSECTOR_KEY_TIPC) |		\
+	 (1 << FLOW_DISSECTOR_KEY_GRE_KEYID) |		\
+	 (1 << FLOW_DISSECTOR_KEY_MPLS_ENTROPY))
+
+/* Specialized dissection of plain TCP/UDP over IPv4 or IPv6: no IP options,
+ * no fragments, no extension headers, no encapsulation.  Returns false on
+ * anything else, leaving a partially written target that the generic walker
+ * overwrites from scratch.  Must fill exactly the keys the walker would for
+ * an accepted packet, so that flow hashes do not depend on which path ran.
+ */
+static bool __skb_flow_dissect_fast(const struct sk_buff *skb,
+				    struct flow_dissector *flow_dissector,
+				    void *target_container, void *data,
+				    __be16 proto, int nhoff, int hlen,
+				    struct flow_dissector_key_control *key_control,
+				    struct flow_dissector_key_basic *key_basic)
+{
+	struct flow_dissector_key_addrs *key_addrs;
+	u8 ip_proto;
+
+	switch (proto) {
+	case htons(ETH_P_IP): {
+		const struct iphdr *iph;
+		struct iphdr _iph;
+
+		iph = __skb_header_pointer(skb, nhoff, sizeof(_iph), data,
+					   hlen, &_iph);
+		if (!iph || iph->ihl != 5 || ip_is_fragment(iph) ||
+		    (iph->protocol != IPPROTO_TCP &&
+		     iph->protocol != IPPROTO_UDP))
+			return false;
+
+		ip_proto = iph->protocol;
+		nhoff += sizeof(_iph);
+
+		if (dissector_uses_key(flow_dissector,
+				       FLOW_DISSECTOR_KEY_IPV4_ADDRS)) {
+			key_addrs = skb_flow_dissector_target(flow_dissector,
+							      FLOW_DISSECTOR_KEY_IPV4_ADDRS,
+							      target_container);
+			memcpy(&key_addrs->v4addrs, &iph->saddr,
+			       sizeof(key_addrs->v4addrs));
+			key_control->addr_type = FLOW_DISSECTOR_KEY_IPV4_ADDRS;
+		}
+		break;
+	}
+	case htons(ETH_P_IPV6): {
+		const struct ipv6hdr *iph;
+		struct ipv6hdr _iph;
+
+		iph = __skb_header_pointer(skb, nhoff, sizeof(_iph), data,
+					   hlen, &_iph);
+		if (!iph || (iph->nexthdr != IPPROTO_TCP &&
+			     iph->nexthdr != IPPROTO_UDP))
+			return false;
+
+		ip_proto = iph->nexthdr;
+		nhoff += sizeof(_iph);
+
+		if (dissector_uses_key(flow_dissector,
+				       FLOW_DISSECTOR_KEY_IPV6_ADDRS)) {
+			key_addrs = skb_flow_dissector_target(flow_dissector,
+							      FLOW_DISSECTOR_KEY_IPV6_ADDRS,
+							      target_container);
+			memcpy(&key_addrs->v6addrs, &iph->saddr,
+			       sizeof(key_addrs->v6addrs));
+			key_control->addr_type = FLOW_DISSECTOR_KEY_IPV6_ADDRS;
+		}
+
+		if (dissector_uses_key(flow_dissector,
+				       FLOW_DISSECTOR_KEY_FLOW_LABEL) &&
+		    ip6_flowlabel(iph)) {
+			struct flow_dissector_key_tags *key_tags;
+
+			key_tags = skb_flow_dissector_target(flow_dissector,
+							     FLOW_DISSECTOR_KEY_FLOW_LABEL,
+							     target_container);
+			key_tags->flow_label = ntohl(ip6_flowlabel(iph));
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+
+	if (dissector_uses_key(flow_dissector, FLOW_DISSECTOR_KEY_PORTS)) {
+		struct flow_dissector_key_ports *key_ports;
+
+		key_ports = skb_flow_dissector_target(flow_dissector,
+						      FLOW_DISSECTOR_KEY_PORTS,
+						      target_container);
+		key_ports->ports = __skb_flow_get_ports(skb, nhoff, ip_proto,
+							data, hlen);
+	}
+
+	key_control->thoff = min_t(u16, nhoff, skb ? skb->len : hlen);
+	key_basic->n_proto = proto;
+	key_basic->ip_proto = ip_proto;
+
+	return true;
+}
+
 /**
  * __skb_flow_dissect - extract the flow_keys struct and return it
  * @skb: sk_buff to extract the flow from, can be NULL if the rest are specified
@@ -629,6 +744,19 @@ bool __skb_flow_dissect(const struct sk_buff *skb,
 					      FLOW_DISSECTOR_KEY_BASIC,
 					      target_container);
 
+	/* The dominant traffic on most devices is plain TCP/UDP over
+	 * IPv4/IPv6, and the dissectors behind skb_get_hash() (RPS, GRO,
+	 * socket steering) only consume 5-tuple keys.  Take a specialized
+	 * path for that combination; anything unusual in the dissector or
+	 * the packet falls back to the generic walker below.
+	 */
+	if (!flags &&
+	    !(flow_dissector->used_keys & ~FLOW_DISSECT_FAST_KEYS) &&
+	    __skb_flow_dissect_fast(skb, flow_dissector, target_container,
+				    data, proto, nhoff, hlen,
+				    key_control, key_basic))
+		return true;
+
 	if (dissector_uses_key(flow_dissector,
 			       FLOW_DISSECTOR_KEY_ETH_ADDRS)) {
 		struct ethhdr *eth = eth_hdr(skb);
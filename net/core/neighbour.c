@@ -162,22 +162,43 @@ bool neigh_remove_one(struct neighbour *ndel, struct neigh_table *tbl)
 	return false;
 }
 
+/* Upper bound of hash buckets a single forced gc run may scan, unless the
+ * table is above gc_thresh3 and allocation failure is imminent.
+ */
+#define NEIGH_FORCED_GC_BUCKETS	256
+
 static int neigh_forced_gc(struct neigh_table *tbl)
 {
-	int shrunk = 0;
-	int i;
+	int max_clean = atomic_read(&tbl->entries) - tbl->gc_thresh2;
 	struct neigh_hash_table *nht;
+	unsigned int size, budget, i;
+	int shrunk = 0;
 
 	NEIGH_CACHE_STAT_INC(tbl, forced_gc_runs);
 
+	if (max_clean < 1)
+		max_clean = 1;
+
 	write_lock_bh(&tbl->lock);
 	nht = rcu_dereference_protected(tbl->nht,
 					lockdep_is_held(&tbl->lock));
-	for (i = 0; i < (1 << nht->hash_shift); i++) {
+	size = 1 << nht->hash_shift;
+
+	/* Scan a bounded slice of the table per run, resuming at the bucket
+	 * where the previous run stopped, so that on a large table writers
+	 * are never stalled behind a full walk.  Only when the table has
+	 * grown past gc_thresh3, where finding nothing means failing the
+	 * pending allocation, may the walk cover all buckets.
+	 */
+	budget = min_t(unsigned int, size, NEIGH_FORCED_GC_BUCKETS);
+	if (atomic_read(&tbl->entries) >= tbl->gc_thresh3)
+		budget = size;
+
+	for (i = 0; i < budget && shrunk < max_clean; i++) {
 		struct neighbour *n;
 		struct neighbour __rcu **np;
 
-		np = &nht->hash_buckets[i];
+		np = &nht->hash_buckets[tbl->forced_gc_rotor++ & (size - 1)];
 		while ((n = rcu_dereference_protected(*np,
 					lockdep_is_held(&tbl->lock))) != NULL) {
 			/* Neighbour record may be discarded if:
@@ -185,7 +206,7 @@ static int neigh_forced_gc(struct neigh_table *tbl)
 			 * - it is not permanent
 			 */
 			if (neigh_del(n, NUD_PERMANENT, np, tbl)) {
-				shrunk = 1;
+				shrunk++;
 				continue;
 			}
 			np = &n->next;
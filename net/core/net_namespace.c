@@ -29,7 +29,23 @@
 
 static LIST_HEAD(pernet_list);
 static struct list_head *first_device = &pernet_list;
-DEFINE_MUTEX(net_mutex);
+
+/*
+ * Protects pernet_list against concurrent setup_net()/cleanup_net().
+ * The (un)register_pernet_*() paths take it for writing; setup and
+ * cleanup only take it for reading, so independent namespaces can be
+ * built and torn down in parallel.  Pernet operations that carry the
+ * async annotation promise not to depend on such serialization; as
+ * long as any non-async operation is registered, setup and cleanup
+ * additionally serialize on net_mutex, preserving the old behaviour.
+ */
+DECLARE_RWSEM(net_sem);
+static DEFINE_MUTEX(net_mutex);
+
+/* Number of registered pernet operations lacking the async annotation.
+ * Modified under net_sem held for writing, stable under it for reading.
+ */
+static unsigned int nr_sync_pernet_ops;
 
 LIST_HEAD(net_namespace_list);
 EXPORT_SYMBOL_GPL(net_namespace_list);
@@ -65,11 +81,11 @@ static int net_assign_generic(struct net *net, unsigned int id, void *data)
 {
 	struct net_generic *ng, *old_ng;
 
-	BUG_ON(!mutex_is_locked(&net_mutex));
+	BUG_ON(!rwsem_is_locked(&net_sem));
 	BUG_ON(id < MIN_PERNET_OPS_ID);
 
 	old_ng = rcu_dereference_protected(net->gen,
-					   lockdep_is_held(&net_mutex));
+					   lockdep_is_held(&net_sem));
 	if (old_ng->s.len > id) {
 		old_ng->ptr[id] = data;
 		return 0;
@@ -286,7 +302,9 @@ struct net *get_net_ns_by_id(struct net *net, int id)
  */
 static __net_init int setup_net(struct net *net, struct user_namespace *user_ns)
 {
-	/* Must be called with net_mutex held */
+	/* Must be called with net_sem held for reading (and net_mutex
+	 * while non-async pernet operations are registered).
+	 */
 	const struct pernet_operations *ops, *saved_ops;
 	int error = 0;
 	LIST_HEAD(net_exit_list);
@@ -331,6 +349,7 @@ static int __net_init net_defaults_init_net(struct net *net)
 
 static struct pernet_operations net_defaults_ops = {
 	.init = net_defaults_init_net,
+	.async = true,
 };
 
 static __init int net_defaults_init(void)
@@ -414,13 +433,23 @@ struct net *copy_net_ns(unsigned long flags,
 
 	get_user_ns(user_ns);
 
-	rv = mutex_lock_killable(&net_mutex);
+	rv = down_read_killable(&net_sem);
 	if (rv < 0) {
 		net_free(net);
 		dec_net_namespaces(ucounts);
 		put_user_ns(user_ns);
 		return ERR_PTR(rv);
 	}
+	if (nr_sync_pernet_ops) {
+		rv = mutex_lock_killable(&net_mutex);
+		if (rv < 0) {
+			up_read(&net_sem);
+			net_free(net);
+			dec_net_namespaces(ucounts);
+			put_user_ns(user_ns);
+			return ERR_PTR(rv);
+		}
+	}
 
 	net->ucounts = ucounts;
 	rv = setup_net(net, user_ns);
@@ -429,7 +458,9 @@ struct net *copy_net_ns(unsigned long flags,
 		list_add_tail_rcu(&net->list, &net_namespace_list);
 		rtnl_unlock();
 	}
-	mutex_unlock(&net_mutex);
+	if (nr_sync_pernet_ops)
+		mutex_unlock(&net_mutex);
+	up_read(&net_sem);
 	if (rv < 0) {
 		dec_net_namespaces(ucounts);
 		put_user_ns(user_ns);
@@ -442,11 +473,12 @@ struct net *copy_net_ns(unsigned long flags,
 static void unhash_nsid(struct net *net, struct net *last)
 {
 	struct net *tmp;
-	/* This function is only called from cleanup_net() work,
-	 * and this work is the only process, that may delete
-	 * a net from net_namespace_list. So, when the below
-	 * is executing, the list may only grow. Thus, we do not
-	 * use for_each_net_rcu() or rtnl_lock().
+	/* This function is only called from the unhash phase of a
+	 * cleanup_net() work, which net_unhash_mutex serializes across
+	 * the cleanup shards, so nothing else may delete a net from
+	 * net_namespace_list while the below is executing and the list
+	 * may only grow. Thus, we do not use for_each_net_rcu() or
+	 * rtnl_lock().
 	 */
 	for_each_net(tmp) {
 		int id;
@@ -466,24 +498,50 @@ static void unhash_nsid(struct net *net, struct net *last)
 	spin_unlock_bh(&net->nsid_lock);
 }
 
-static DEFINE_SPINLOCK(cleanup_list_lock);
-static LIST_HEAD(cleanup_list);  /* Must hold cleanup_list_lock to touch */
+/*
+ * Dying namespaces are spread round-robin over a small set of cleanup
+ * shards, each with its own work item, so that one slow ->exit (e.g. a
+ * conntrack-style flush) only delays the namespaces queued behind it on
+ * the same shard instead of convoying every teardown in the system.
+ */
+#define NETNS_CLEANUP_SHARDS	8
+
+struct netns_cleanup_shard {
+	spinlock_t		lock;
+	struct list_head	list;	/* Must hold lock to touch */
+	struct work_struct	work;
+};
+
+static struct netns_cleanup_shard netns_cleanup_shards[NETNS_CLEANUP_SHARDS];
+static atomic_t netns_cleanup_seq;
+
+/* Only one shard at a time may unlink namespaces from
+ * net_namespace_list and drop their nsids; unhash_nsid() walks the
+ * list locklessly and relies on nothing being removed underneath it.
+ */
+static DEFINE_MUTEX(net_unhash_mutex);
 
 static void cleanup_net(struct work_struct *work)
 {
+	struct netns_cleanup_shard *shard;
 	const struct pernet_operations *ops;
 	struct net *net, *tmp, *last;
 	struct list_head net_kill_list;
 	LIST_HEAD(net_exit_list);
 
+	shard = container_of(work, struct netns_cleanup_shard, work);
+
 	/* Atomically snapshot the list of namespaces to cleanup */
-	spin_lock_irq(&cleanup_list_lock);
-	list_replace_init(&cleanup_list, &net_kill_list);
-	spin_unlock_irq(&cleanup_list_lock);
+	spin_lock_irq(&shard->lock);
+	list_replace_init(&shard->list, &net_kill_list);
+	spin_unlock_irq(&shard->lock);
 
-	mutex_lock(&net_mutex);
+	down_read(&net_sem);
+	if (nr_sync_pernet_ops)
+		mutex_lock(&net_mutex);
 
 	/* Don't let anyone else find us. */
+	mutex_lock(&net_unhash_mutex);
 	rtnl_lock();
 	list_for_each_entry(net, &net_kill_list, cleanup_list)
 		list_del_rcu(&net->list);
@@ -504,6 +562,7 @@ static void cleanup_net(struct work_struct *work)
 		unhash_nsid(net, last);
 		list_add_tail(&net->exit_list, &net_exit_list);
 	}
+	mutex_unlock(&net_unhash_mutex);
 
 	/*
 	 * Another CPU might be rcu-iterating the list, wait for it.
@@ -520,7 +579,9 @@ static void cleanup_net(struct work_struct *work)
 	list_for_each_entry_reverse(ops, &pernet_list, list)
 		ops_free_list(ops, &net_exit_list);
 
-	mutex_unlock(&net_mutex);
+	if (nr_sync_pernet_ops)
+		mutex_unlock(&net_mutex);
+	up_read(&net_sem);
 
 	/* Ensure there are no outstanding rcu callbacks using this
 	 * network namespace.
@@ -547,23 +608,25 @@ static void cleanup_net(struct work_struct *work)
  */
 void net_ns_barrier(void)
 {
-	mutex_lock(&net_mutex);
-	mutex_unlock(&net_mutex);
+	down_write(&net_sem);
+	up_write(&net_sem);
 }
 EXPORT_SYMBOL(net_ns_barrier);
 
-static DECLARE_WORK(net_cleanup_work, cleanup_net);
-
 void __put_net(struct net *net)
 {
 	/* Cleanup the network namespace in process context */
+	struct netns_cleanup_shard *shard;
 	unsigned long flags;
 
-	spin_lock_irqsave(&cleanup_list_lock, flags);
-	list_add(&net->cleanup_list, &cleanup_list);
-	spin_unlock_irqrestore(&cleanup_list_lock, flags);
+	shard = &netns_cleanup_shards[atomic_inc_return(&netns_cleanup_seq) %
+				      NETNS_CLEANUP_SHARDS];
+
+	spin_lock_irqsave(&shard->lock, flags);
+	list_add(&net->cleanup_list, &shard->list);
+	spin_unlock_irqrestore(&shard->lock, flags);
 
-	queue_work(netns_wq, &net_cleanup_work);
+	queue_work(netns_wq, &shard->work);
 }
 EXPORT_SYMBOL_GPL(__put_net);
 
@@ -633,6 +696,7 @@ static __net_exit void net_ns_net_exit(struct net *net)
 static struct pernet_operations __net_initdata net_ns_ops = {
 	.init = net_ns_net_init,
 	.exit = net_ns_net_exit,
+	.async = true,
 };
 
 static const struct nla_policy rtnl_net_policy[NETNSA_MAX + 1] = {
@@ -857,16 +921,26 @@ out:
 static int __init net_ns_init(void)
 {
 	struct net_generic *ng;
-
 #ifdef CONFIG_NET_NS
+	int i;
+
 	net_cachep = kmem_cache_create("net_namespace", sizeof(struct net),
 					SMP_CACHE_BYTES,
 					SLAB_PANIC, NULL);
 
 	/* Create workqueue for cleanup */
-	netns_wq = create_singlethread_workqueue("netns");
+	netns_wq = alloc_workqueue("netns", WQ_UNBOUND | WQ_MEM_RECLAIM,
+				   NETNS_CLEANUP_SHARDS);
 	if (!netns_wq)
 		panic("Could not create netns workq");
+
+	for (i = 0; i < NETNS_CLEANUP_SHARDS; i++) {
+		struct netns_cleanup_shard *shard = &netns_cleanup_shards[i];
+
+		spin_lock_init(&shard->lock);
+		INIT_LIST_HEAD(&shard->list);
+		INIT_WORK(&shard->work, cleanup_net);
+	}
 #endif
 
 	ng = net_alloc_generic();
@@ -875,7 +949,7 @@ static int __init net_ns_init(void)
 
 	rcu_assign_pointer(init_net.gen, ng);
 
-	mutex_lock(&net_mutex);
+	down_read(&net_sem);
 	if (setup_net(&init_net, &init_user_ns))
 		panic("Could not setup the initial network namespace");
 
@@ -885,7 +959,7 @@ static int __init net_ns_init(void)
 	list_add_tail_rcu(&init_net.list, &net_namespace_list);
 	rtnl_unlock();
 
-	mutex_unlock(&net_mutex);
+	up_read(&net_sem);
 
 	register_pernet_subsys(&net_ns_ops);
 
@@ -989,6 +1063,8 @@ again:
 		rcu_barrier();
 		if (ops->id)
 			ida_remove(&net_generic_ids, *ops->id);
+	} else if (!ops->async) {
+		nr_sync_pernet_ops++;
 	}
 
 	return error;
@@ -996,7 +1072,8 @@ again:
 
 static void unregister_pernet_operations(struct pernet_operations *ops)
 {
-	
+	if (!ops->async)
+		nr_sync_pernet_ops--;
 	__unregister_pernet_operations(ops);
 	rcu_barrier();
 	if (ops->id)
@@ -1025,9 +1102,9 @@ static void unregister_pernet_operations(struct pernet_operations *ops)
 int register_pernet_subsys(struct pernet_operations *ops)
 {
 	int error;
-	mutex_lock(&net_mutex);
+	down_write(&net_sem);
 	error =  register_pernet_operations(first_device, ops);
-	mutex_unlock(&net_mutex);
+	up_write(&net_sem);
 	return error;
 }
 EXPORT_SYMBOL_GPL(register_pernet_subsys);
@@ -1043,9 +1120,9 @@ EXPORT_SYMBOL_GPL(register_pernet_subsys);
  */
 void unregister_pernet_subsys(struct pernet_operations *ops)
 {
-	mutex_lock(&net_mutex);
+	down_write(&net_sem);
 	unregister_pernet_operations(ops);
-	mutex_unlock(&net_mutex);
+	up_write(&net_sem);
 }
 EXPORT_SYMBOL_GPL(unregister_pernet_subsys);
 
@@ -1071,11 +1148,11 @@ EXPORT_SYMBOL_GPL(unregister_pernet_subsys);
 int register_pernet_device(struct pernet_operations *ops)
 {
 	int error;
-	mutex_lock(&net_mutex);
+	down_write(&net_sem);
 	error = register_pernet_operations(&pernet_list, ops);
 	if (!error && (first_device == &pernet_list))
 		first_device = &ops->list;
-	mutex_unlock(&net_mutex);
+	up_write(&net_sem);
 	return error;
 }
 EXPORT_SYMBOL_GPL(register_pernet_device);
@@ -1091,11 +1168,11 @@ EXPORT_SYMBOL_GPL(register_pernet_device);
  */
 void unregister_pernet_device(struct pernet_operations *ops)
 {
-	mutex_lock(&net_mutex);
+	down_write(&net_sem);
 	if (&ops->list == first_device)
 		first_device = first_device->next;
 	unregister_pernet_operations(ops);
-	mutex_unlock(&net_mutex);
+	up_write(&net_sem);
 }
 EXPORT_SYMBOL_GPL(unregister_pernet_device);
 
@@ -243,6 +243,9 @@ static char *pkt_flag_names[] = {
 #define PG_PROC_DIR "pktgen"
 #define PGCTRL	    "pgctrl"
 
+/* Receiver mode: log2(ns) latency histogram buckets */
+#define PG_RX_HIST_BUCKETS 32
+
 #define MAX_CFLOWS  65536
 
 #define VLAN_TAG_SIZE(x) ((x)->vlan_id == 0xffff ? 0 : 4)
@@ -431,6 +434,24 @@ struct pktgen_hdr {
 	__be32 tv_usec;
 };
 
+/* Receiver-mode counters, kept per cpu.  Sequence tracking is per cpu as
+ * well: with RSS a flow sticks to one cpu, so each cpu effectively tracks
+ * its own flows, and exact cross-cpu gap accounting would put a lock into
+ * the very path being benchmarked.
+ */
+struct pktgen_rx_stats {
+	u64	packets;
+	u64	bytes;
+	u64	seq_lost;
+	u64	seq_ooo;
+	u64	lat_pkts;
+	u64	lat_sum;	/* ns */
+	u64	lat_min;	/* ns, ~0 when no sample yet */
+	u64	lat_max;	/* ns */
+	u64	lat_hist[PG_RX_HIST_BUCKETS];
+	u32	next_seq;
+	bool	seq_valid;
+};
 
 static unsigned int pg_net_id __read_mostly;
 
@@ -439,6 +460,12 @@ struct pktgen_net {
 	struct proc_dir_entry	*proc_dir;
 	struct list_head	pktgen_threads;
 	bool			pktgen_exiting;
+
+	/* receiver mode, controlled through pgctrl */
+	struct net_device	*rx_dev;
+	struct packet_type	rx_pt;
+	struct pktgen_rx_stats __percpu *rx_stats;
+	bool			rx_enabled;
 };
 
 struct pktgen_thread {
@@ -490,6 +517,194 @@ static struct notifier_block pktgen_notifier_block = {
 	.notifier_call = pktgen_device_event,
 };
 
+/*
+ * Receiver mode.  A packet_type tap on one device recognizes pktgen-format
+ * packets (UDP payload starting with PKTGEN_MAGIC), tracks loss from the
+ * sequence numbers and builds a latency histogram from the embedded
+ * timestamps, for closed-loop single-box forwarding benchmarks.
+ */
+
+static int pktgen_rx_rcv(struct sk_buff *skb, struct net_device *dev,
+			 struct packet_type *pt, struct net_device *orig_dev)
+{
+	struct pktgen_net *pn = container_of(pt, struct pktgen_net, rx_pt);
+	const struct pktgen_hdr *pgh;
+	struct pktgen_rx_stats *rs;
+	struct pktgen_hdr _pgh;
+	unsigned int offset;
+	u32 seq;
+
+	if (skb->protocol == htons(ETH_P_IP)) {
+		const struct iphdr *iph;
+		struct iphdr _iph;
+
+		iph = skb_header_pointer(skb, 0, sizeof(_iph), &_iph);
+		if (!iph || iph->protocol != IPPROTO_UDP ||
+		    ip_is_fragment(iph))
+			goto out;
+		offset = iph->ihl * 4 + sizeof(struct udphdr);
+	} else if (skb->protocol == htons(ETH_P_IPV6)) {
+		const struct ipv6hdr *ip6h;
+		struct ipv6hdr _ip6h;
+
+		ip6h = skb_header_pointer(skb, 0, sizeof(_ip6h), &_ip6h);
+		if (!ip6h || ip6h->nexthdr != IPPROTO_UDP)
+			goto out;
+		offset = sizeof(_ip6h) + sizeof(struct udphdr);
+	} else {
+		goto out;
+	}
+
+	pgh = skb_header_pointer(skb, offset, sizeof(_pgh), &_pgh);
+	if (!pgh || pgh->pgh_magic != htonl(PKTGEN_MAGIC))
+		goto out;
+
+	rs = this_cpu_ptr(pn->rx_stats);
+	rs->packets++;
+	rs->bytes += skb->len;
+
+	seq = ntohl(pgh->seq_num);
+	if (rs->seq_valid) {
+		s32 dist = seq - rs->next_seq;
+
+		if (dist > 0) {
+			rs->seq_lost += dist;
+		} else if (dist < 0) {
+			/* late arrival was counted as lost above */
+			rs->seq_ooo++;
+			if (rs->seq_lost)
+				rs->seq_lost--;
+		}
+	}
+	if (!rs->seq_valid || (s32)(seq - rs->next_seq) >= 0) {
+		rs->next_seq = seq + 1;
+		rs->seq_valid = true;
+	}
+
+	if (pgh->tv_sec | pgh->tv_usec) {
+		struct timespec64 now;
+		s64 lat;
+
+		ktime_get_real_ts64(&now);
+		lat = (now.tv_sec - (time64_t)ntohl(pgh->tv_sec)) *
+			NSEC_PER_SEC + now.tv_nsec -
+			(s64)ntohl(pgh->tv_usec) * NSEC_PER_USEC;
+		if (lat >= 0) {
+			int bucket = lat ? min(fls64(lat) - 1,
+					       PG_RX_HIST_BUCKETS - 1) : 0;
+
+			rs->lat_hist[bucket]++;
+			rs->lat_pkts++;
+			rs->lat_sum += lat;
+			if (lat < rs->lat_min)
+				rs->lat_min = lat;
+			if (lat > rs->lat_max)
+				rs->lat_max = lat;
+		}
+	}
+out:
+	consume_skb(skb);
+	return 0;
+}
+
+static void pktgen_rx_clear_stats(struct pktgen_net *pn)
+{
+	int cpu;
+
+	/* Not synchronized against a live tap; a reset while traffic is
+	 * flowing may miss a packet or two, like the transmit counters.
+	 */
+	for_each_possible_cpu(cpu) {
+		struct pktgen_rx_stats *rs = per_cpu_ptr(pn->rx_stats, cpu);
+
+		memset(rs, 0, sizeof(*rs));
+		rs->lat_min = ~0ULL;
+	}
+}
+
+/* Called under pktgen_thread_lock */
+static int pktgen_rx_enable(struct pktgen_net *pn, const char *ifname)
+{
+	struct net_device *dev;
+
+	if (pn->rx_enabled)
+		return -EBUSY;
+
+	dev = dev_get_by_name(pn->net, ifname);
+	if (!dev)
+		return -ENODEV;
+
+	pn->rx_stats = alloc_percpu(struct pktgen_rx_stats);
+	if (!pn->rx_stats) {
+		dev_put(dev);
+		return -ENOMEM;
+	}
+	pktgen_rx_clear_stats(pn);
+
+	pn->rx_dev = dev;
+	pn->rx_pt.type = htons(ETH_P_ALL);
+	pn->rx_pt.dev = dev;
+	pn->rx_pt.func = pktgen_rx_rcv;
+	dev_add_pack(&pn->rx_pt);
+	pn->rx_enabled = true;
+
+	pr_info("receiver enabled on %s\n", ifname);
+	return 0;
+}
+
+/* Called under pktgen_thread_lock */
+static void pktgen_rx_disable(struct pktgen_net *pn)
+{
+	if (!pn->rx_enabled)
+		return;
+
+	dev_remove_pack(&pn->rx_pt);	/* synchronizes against the tap */
+	dev_put(pn->rx_dev);
+	pn->rx_dev = NULL;
+	pn->rx_enabled = false;
+	free_percpu(pn->rx_stats);
+	pn->rx_stats = NULL;
+}
+
+static void pktgen_rx_show(struct seq_file *seq, struct pktgen_net *pn)
+{
+	struct pktgen_rx_stats sum;
+	unsigned int i;
+	int cpu;
+
+	memset(&sum, 0, sizeof(sum));
+	sum.lat_min = ~0ULL;
+
+	for_each_possible_cpu(cpu) {
+		struct pktgen_rx_stats *rs = per_cpu_ptr(pn->rx_stats, cpu);
+
+		sum.packets += rs->packets;
+		sum.bytes += rs->bytes;
+		sum.seq_lost += rs->seq_lost;
+		sum.seq_ooo += rs->seq_ooo;
+		sum.lat_pkts += rs->lat_pkts;
+		sum.lat_sum += rs->lat_sum;
+		sum.lat_min = min(sum.lat_min, rs->lat_min);
+		sum.lat_max = max(sum.lat_max, rs->lat_max);
+		for (i = 0; i < PG_RX_HIST_BUCKETS; i++)
+			sum.lat_hist[i] += rs->lat_hist[i];
+	}
+
+	seq_printf(seq, "Receiver: %s\n", pn->rx_dev->name);
+	seq_printf(seq, "  pkts: %llu  bytes: %llu  lost: %llu  ooo: %llu\n",
+		   sum.packets, sum.bytes, sum.seq_lost, sum.seq_ooo);
+	if (sum.lat_pkts)
+		seq_printf(seq,
+			   "  lat_avg_ns: %llu  lat_min_ns: %llu  lat_max_ns: %llu\n",
+			   div64_u64(sum.lat_sum, sum.lat_pkts),
+			   sum.lat_min, sum.lat_max);
+	for (i = 0; i < PG_RX_HIST_BUCKETS; i++) {
+		if (!sum.lat_hist[i])
+			continue;
+		seq_printf(seq, "  lat_2^%u_ns: %llu\n", i, sum.lat_hist[i]);
+	}
+}
+
 /*
  * /proc handling functions
  *
@@ -497,7 +712,16 @@ static struct notifier_block pktgen_notifier_block = {
 
 static int pgctrl_show(struct seq_file *seq, void *v)
 {
+	struct pktgen_net *pn = net_generic(current->nsproxy->net_ns,
+					    pg_net_id);
+
 	seq_puts(seq, version);
+
+	mutex_lock(&pktgen_thread_lock);
+	if (pn->rx_enabled)
+		pktgen_rx_show(seq, pn);
+	mutex_unlock(&pktgen_thread_lock);
+
 	return 0;
 }
 
@@ -530,6 +754,29 @@ static ssize_t pgctrl_write(struct file *file, const char __user *buf,
 	else if (!strcmp(data, "reset"))
 		pktgen_reset_all_threads(pn);
 
+	else if (!strncmp(data, "rx ", 3)) {
+		int err;
+
+		mutex_lock(&pktgen_thread_lock);
+		err = pktgen_rx_enable(pn, data + 3);
+		mutex_unlock(&pktgen_thread_lock);
+		if (err)
+			return err;
+	}
+
+	else if (!strcmp(data, "rx_stop")) {
+		mutex_lock(&pktgen_thread_lock);
+		pktgen_rx_disable(pn);
+		mutex_unlock(&pktgen_thread_lock);
+	}
+
+	else if (!strcmp(data, "rx_reset")) {
+		mutex_lock(&pktgen_thread_lock);
+		if (pn->rx_enabled)
+			pktgen_rx_clear_stats(pn);
+		mutex_unlock(&pktgen_thread_lock);
+	}
+
 	else
 		return -EINVAL;
 
@@ -1965,6 +2212,10 @@ static int pktgen_device_event(struct notifier_block *unused,
 
 	case NETDEV_UNREGISTER:
 		pktgen_mark_device(pn, dev->name);
+		mutex_lock(&pktgen_thread_lock);
+		if (pn->rx_enabled && dev == pn->rx_dev)
+			pktgen_rx_disable(pn);
+		mutex_unlock(&pktgen_thread_lock);
 		break;
 	}
 
@@ -3831,6 +4082,7 @@ static void __net_exit pg_net_exit(struct net *net)
 	pn->pktgen_exiting = true;
 
 	mutex_lock(&pktgen_thread_lock);
+	pktgen_rx_disable(pn);
 	list_splice_init(&pn->pktgen_threads, &list);
 	mutex_unlock(&pktgen_thread_lock);
 
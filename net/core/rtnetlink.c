@@ -454,11 +454,11 @@ static void rtnl_lock_unregistering_all(void)
 void rtnl_link_unregister(struct rtnl_link_ops *ops)
 {
 	/* Close the race with cleanup_net() */
-	mutex_lock(&net_mutex);
+	down_write(&net_sem);
 	rtnl_lock_unregistering_all();
 	__rtnl_link_unregister(ops);
 	rtnl_unlock();
-	mutex_unlock(&net_mutex);
+	up_write(&net_sem);
 }
 EXPORT_SYMBOL_GPL(rtnl_link_unregister);
 
@@ -993,6 +993,7 @@ static noinline size_t if_nlmsg_size(const struct net_device *dev,
 	       + nla_total_size(4)  /* IFLA_IF_NETNSID */
 	       + nla_total_size(4)  /* IFLA_CARRIER_UP_COUNT */
 	       + nla_total_size(4)  /* IFLA_CARRIER_DOWN_COUNT */
+	       + nla_total_size(4)  /* IFLA_CHANGE_GEN */
 	       + 0;
 }
 
@@ -1134,11 +1135,19 @@ static int rtnl_phys_switch_id_fill(struct sk_buff *skb, struct net_device *dev)
 }
 
 static noinline_for_stack int rtnl_fill_stats(struct sk_buff *skb,
-					      struct net_device *dev)
+					      struct net_device *dev,
+					      u32 ext_filter_mask)
 {
 	struct rtnl_link_stats64 *sp;
 	struct nlattr *attr;
 
+	/* Folding the per-cpu counters of thousands of virtual devices
+	 * dominates the time a full link dump holds rtnl; let callers that
+	 * fetch stats separately (RTM_GETSTATS) opt out.
+	 */
+	if (ext_filter_mask & RTEXT_FILTER_SKIP_STATS)
+		return 0;
+
 	attr = nla_reserve_64bit(skb, IFLA_STATS64,
 				 sizeof(struct rtnl_link_stats64), IFLA_PAD);
 	if (!attr)
@@ -1561,7 +1570,8 @@ static int rtnl_fill_ifinfo(struct sk_buff *skb,
 	    nla_put_u32(skb, IFLA_CARRIER_UP_COUNT,
 			atomic_read(&dev->carrier_up_count)) ||
 	    nla_put_u32(skb, IFLA_CARRIER_DOWN_COUNT,
-			atomic_read(&dev->carrier_down_count)))
+			atomic_read(&dev->carrier_down_count)) ||
+	    nla_put_u32(skb, IFLA_CHANGE_GEN, READ_ONCE(dev->ifinfo_gen)))
 		goto nla_put_failure;
 
 	if (event != IFLA_EVENT_NONE) {
@@ -1587,7 +1597,7 @@ static int rtnl_fill_ifinfo(struct sk_buff *skb,
 	if (rtnl_phys_switch_id_fill(skb, dev))
 		goto nla_put_failure;
 
-	if (rtnl_fill_stats(skb, dev))
+	if (rtnl_fill_stats(skb, dev, ext_filter_mask))
 		goto nla_put_failure;
 
 	if (rtnl_fill_vf(skb, dev, ext_filter_mask))
@@ -1671,6 +1681,7 @@ static const struct nla_policy ifla_policy[IFLA_MAX+1] = {
 	[IFLA_IF_NETNSID]	= { .type = NLA_S32 },
 	[IFLA_CARRIER_UP_COUNT]	= { .type = NLA_U32 },
 	[IFLA_CARRIER_DOWN_COUNT] = { .type = NLA_U32 },
+	[IFLA_CHANGE_GEN]	= { .type = NLA_U32 },
 };
 
 static const struct nla_policy ifla_info_policy[IFLA_INFO_MAX+1] = {
@@ -1804,6 +1815,8 @@ static int rtnl_dump_ifinfo(struct sk_buff *skb, struct netlink_callback *cb)
 	u32 ext_filter_mask = 0;
 	const struct rtnl_link_ops *kind_ops = NULL;
 	unsigned int flags = NLM_F_MULTI;
+	bool have_change_gen = false;
+	u32 change_gen = 0;
 	int master_idx = 0;
 	int netnsid = -1;
 	int err;
@@ -1842,7 +1855,12 @@ static int rtnl_dump_ifinfo(struct sk_buff *skb, struct netlink_callback *cb)
 		if (tb[IFLA_LINKINFO])
 			kind_ops = linkinfo_to_kind_ops(tb[IFLA_LINKINFO]);
 
-		if (master_idx || kind_ops)
+		if (tb[IFLA_CHANGE_GEN]) {
+			change_gen = nla_get_u32(tb[IFLA_CHANGE_GEN]);
+			have_change_gen = true;
+		}
+
+		if (master_idx || kind_ops || have_change_gen)
 			flags |= NLM_F_DUMP_FILTERED;
 	}
 
@@ -1852,6 +1870,12 @@ static int rtnl_dump_ifinfo(struct sk_buff *skb, struct netlink_callback *cb)
 		hlist_for_each_entry(dev, head, index_hlist) {
 			if (link_dump_filtered(dev, master_idx, kind_ops))
 				goto cont;
+			/* Delta mode: only dump devices whose last link
+			 * notification is newer than the caller's cookie.
+			 */
+			if (have_change_gen &&
+			    (s32)(READ_ONCE(dev->ifinfo_gen) - change_gen) <= 0)
+				goto cont;
 			if (idx < s_idx)
 				goto cont;
 			err = rtnl_fill_ifinfo(skb, dev, net,
@@ -3226,11 +3250,19 @@ struct sk_buff *rtmsg_ifinfo_build_skb(int type, struct net_device *dev,
 				       u32 event, gfp_t flags, int *new_nsid,
 				       int new_ifindex)
 {
+	static atomic_t rtnl_ifinfo_gen;
 	struct net *net = dev_net(dev);
 	struct sk_buff *skb;
 	int err = -ENOBUFS;
 	size_t if_info_size;
 
+	/* Every link notification funnels through here; stamp the device so
+	 * delta dumps can tell which interfaces changed since a cookie.
+	 * Generation 0 is reserved for "never notified".
+	 */
+	WRITE_ONCE(dev->ifinfo_gen,
+		   (u32)atomic_inc_return(&rtnl_ifinfo_gen) ?: 1);
+
 	skb = nlmsg_new((if_info_size = if_nlmsg_size(dev, 0)), flags);
 	if (skb == NULL)
 		goto errout;
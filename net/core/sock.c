@@ -145,6 +145,11 @@
 static DEFINE_MUTEX(proto_list_mutex);
 static LIST_HEAD(proto_list);
 
+/* Longest a queued datagram may wait for SO_RCVBATCH_USECS aggregation */
+#define SK_RCVBATCH_MAX_USECS	(2 * USEC_PER_SEC)
+
+static enum hrtimer_restart sock_rcvbatch_expired(struct hrtimer *timer);
+
 static void sock_inuse_add(struct net *net, int val);
 
 /**
@@ -1049,16 +1054,34 @@ set_rcvbuf:
 		break;
 
 	case SO_ZEROCOPY:
-		if (sk->sk_family != PF_INET && sk->sk_family != PF_INET6)
-			ret = -ENOTSUPP;
-		else if (sk->sk_protocol != IPPROTO_TCP)
+		if (sk->sk_family == PF_INET || sk->sk_family == PF_INET6) {
+			if (sk->sk_protocol != IPPROTO_TCP)
+				ret = -ENOTSUPP;
+			else if (sk->sk_state != TCP_CLOSE)
+				ret = -EBUSY;
+		} else if (sk->sk_family != PF_TIPC) {
 			ret = -ENOTSUPP;
-		else if (sk->sk_state != TCP_CLOSE)
-			ret = -EBUSY;
-		else if (val < 0 || val > 1)
+		}
+		if (!ret) {
+			if (val < 0 || val > 1)
+				ret = -EINVAL;
+			else
+				sock_valbool_flag(sk, SOCK_ZEROCOPY, valbool);
+		}
+		break;
+
+	case SO_RCVBATCH_PKTS:
+		if (val < 1)
 			ret = -EINVAL;
 		else
-			sock_valbool_flag(sk, SOCK_ZEROCOPY, valbool);
+			WRITE_ONCE(sk->sk_rcvbatch_pkts, val);
+		break;
+
+	case SO_RCVBATCH_USECS:
+		if (val < 0 || val > SK_RCVBATCH_MAX_USECS)
+			ret = -EINVAL;
+		else
+			WRITE_ONCE(sk->sk_rcvbatch_usecs, val);
 		break;
 
 	default:
@@ -1393,6 +1416,14 @@ int sock_getsockopt(struct socket *sock, int level, int optname,
 		v.val = sock_flag(sk, SOCK_ZEROCOPY);
 		break;
 
+	case SO_RCVBATCH_PKTS:
+		v.val = READ_ONCE(sk->sk_rcvbatch_pkts);
+		break;
+
+	case SO_RCVBATCH_USECS:
+		v.val = READ_ONCE(sk->sk_rcvbatch_usecs);
+		break;
+
 	default:
 		/* We implement the SO_SNDLOWAT etc to not be settable
 		 * (1003.1g 7).
@@ -1559,6 +1590,8 @@ static void __sk_destruct(struct rcu_head *head)
 	struct sock *sk = container_of(head, struct sock, sk_rcu);
 	struct sk_filter *filter;
 
+	hrtimer_cancel(&sk->sk_rcvbatch_timer);
+
 	if (sk->sk_destruct)
 		sk->sk_destruct(sk);
 
@@ -1688,6 +1721,11 @@ struct sock *sk_clone_lock(const struct sock *sk, const gfp_t priority)
 		newsk->sk_userlocks	= sk->sk_userlocks & ~SOCK_BINDPORT_LOCK;
 		atomic_set(&newsk->sk_zckey, 0);
 
+		/* sock_copy() took a snapshot of the parent's timer */
+		hrtimer_init(&newsk->sk_rcvbatch_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		newsk->sk_rcvbatch_timer.function = sock_rcvbatch_expired;
+
 		sock_reset_flag(newsk, SOCK_DONE);
 		mem_cgroup_sk_alloc(newsk);
 		cgroup_sk_alloc(&newsk->sk_cgrp_data);
@@ -2624,7 +2662,7 @@ static void sock_def_error_report(struct sock *sk)
 	rcu_read_unlock();
 }
 
-static void sock_def_readable(struct sock *sk)
+static void __sock_def_readable(struct sock *sk)
 {
 	struct socket_wq *wq;
 
@@ -2637,6 +2675,51 @@ static void sock_def_readable(struct sock *sk)
 	rcu_read_unlock();
 }
 
+static enum hrtimer_restart sock_rcvbatch_expired(struct hrtimer *timer)
+{
+	struct sock *sk = container_of(timer, struct sock, sk_rcvbatch_timer);
+
+	/* The burst deadline passed; deliver the wakeup that was held back */
+	if (!skb_queue_empty(&sk->sk_receive_queue))
+		__sock_def_readable(sk);
+	return HRTIMER_NORESTART;
+}
+
+/* Decide whether this wakeup may be held back for more datagrams.  The
+ * wakeup is deferred until either sk_rcvbatch_pkts datagrams sit in the
+ * receive queue or sk_rcvbatch_usecs have passed since the deadline timer
+ * was armed, whichever comes first.  An armed wakeup cannot be lost: the
+ * timer is started before this function returns, and its handler re-checks
+ * the queue.  A concurrent hrtimer_start() merely resets the deadline.
+ */
+static bool sock_rcvbatch_defer(struct sock *sk)
+{
+	u32 usecs = READ_ONCE(sk->sk_rcvbatch_usecs);
+
+	if (likely(!usecs))
+		return false;
+
+	if (skb_queue_len(&sk->sk_receive_queue) >=
+	    READ_ONCE(sk->sk_rcvbatch_pkts)) {
+		hrtimer_try_to_cancel(&sk->sk_rcvbatch_timer);
+		return false;
+	}
+
+	if (!hrtimer_is_queued(&sk->sk_rcvbatch_timer))
+		hrtimer_start(&sk->sk_rcvbatch_timer,
+			      ns_to_ktime((u64)usecs * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	return true;
+}
+
+static void sock_def_readable(struct sock *sk)
+{
+	if (sock_rcvbatch_defer(sk))
+		return;
+
+	__sock_def_readable(sk);
+}
+
 static void sock_def_write_space(struct sock *sk)
 {
 	struct socket_wq *wq;
@@ -2741,6 +2824,11 @@ void sock_init_data(struct socket *sock, struct sock *sk)
 	sk->sk_rcvtimeo		=	MAX_SCHEDULE_TIMEOUT;
 	sk->sk_sndtimeo		=	MAX_SCHEDULE_TIMEOUT;
 
+	sk->sk_rcvbatch_pkts	=	1;
+	sk->sk_rcvbatch_usecs	=	0;
+	hrtimer_init(&sk->sk_rcvbatch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sk->sk_rcvbatch_timer.function = sock_rcvbatch_expired;
+
 	sk->sk_stamp = SK_DEFAULT_STAMP;
 	atomic_set(&sk->sk_zckey, 0);
 
@@ -12,6 +12,12 @@
 
 #define INIT_SOCKS 128
 
+/* Prefer sockets whose worker runs on (or near) the RX cpu when picking
+ * from a reuseport group.  Default off, tuned via
+ * net.core.reuseport_numa_steering.
+ */
+int reuseport_numa_steering __read_mostly;
+
 static DEFINE_SPINLOCK(reuseport_lock);
 
 static struct sock_reuseport *__reuseport_alloc(unsigned int max_socks)
@@ -205,6 +211,55 @@ static struct sock *run_bpf(struct sock_reuseport *reuse, u16 socks,
 	return reuse->socks[index];
 }
 
+/* Steer towards a socket whose worker runs on the RX cpu's NUMA node,
+ * using sk_incoming_cpu as published by SO_INCOMING_CPU (or by the stack
+ * once traffic has flowed).  An exact cpu match wins over a node match;
+ * ties are spread by hash.  Returns NULL when no socket advertises a
+ * usable cpu, in which case the caller falls back to plain hashing.
+ */
+static struct sock *reuseport_select_local(struct sock_reuseport *reuse,
+					   u16 socks, u32 hash)
+{
+	int cpu = raw_smp_processor_id();
+	int node = cpu_to_node(cpu);
+	u16 cpu_hits = 0, node_hits = 0;
+	u16 i;
+
+	for (i = 0; i < socks; i++) {
+		int scpu = READ_ONCE(reuse->socks[i]->sk_incoming_cpu);
+
+		if ((unsigned int)scpu >= nr_cpu_ids)
+			continue;
+		if (scpu == cpu)
+			cpu_hits++;
+		else if (cpu_to_node(scpu) == node)
+			node_hits++;
+	}
+
+	if (cpu_hits) {
+		cpu_hits = reciprocal_scale(hash, cpu_hits);
+		for (i = 0; i < socks; i++) {
+			if (READ_ONCE(reuse->socks[i]->sk_incoming_cpu) == cpu &&
+			    !cpu_hits--)
+				return reuse->socks[i];
+		}
+	} else if (node_hits) {
+		node_hits = reciprocal_scale(hash, node_hits);
+		for (i = 0; i < socks; i++) {
+			int scpu = READ_ONCE(reuse->socks[i]->sk_incoming_cpu);
+
+			if ((unsigned int)scpu < nr_cpu_ids &&
+			    cpu_to_node(scpu) == node && !node_hits--)
+				return reuse->socks[i];
+		}
+	}
+
+	/* sk_incoming_cpu may have changed under us between the two
+	 * passes; just let the caller use the hash then.
+	 */
+	return NULL;
+}
+
 /**
  *  reuseport_select_sock - Select a socket from an SO_REUSEPORT group.
  *  @sk: First socket in the group.
@@ -241,7 +296,9 @@ struct sock *reuseport_select_sock(struct sock *sk,
 		if (prog && skb)
 			sk2 = run_bpf(reuse, socks, prog, skb, hdr_len);
 
-		/* no bpf or invalid bpf result: fall back to hash usage */
+		/* no bpf or invalid bpf result: try locality, then hash */
+		if (!sk2 && reuseport_numa_steering)
+			sk2 = reuseport_select_local(reuse, socks, hash);
 		if (!sk2)
 			sk2 = reuse->socks[reciprocal_scale(hash, socks)];
 	}
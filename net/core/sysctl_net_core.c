@@ -22,6 +22,7 @@
 #include <net/net_ratelimit.h>
 #include <net/busy_poll.h>
 #include <net/pkt_sched.h>
+#include <net/sock_reuseport.h>
 
 static int zero = 0;
 static int one = 1;
@@ -74,8 +75,10 @@ static int rps_sock_flow_sysctl(struct ctl_table *table, int write,
 			} else
 				sock_table = orig_sock_table;
 
-			for (i = 0; i < size; i++)
-				sock_table->ents[i] = RPS_NO_CPU;
+			for (i = 0; i < size; i++) {
+				sock_table->ents[i].val = RPS_NO_CPU;
+				sock_table->ents[i].time = 0;
+			}
 		} else
 			sock_table = NULL;
 
@@ -440,7 +443,32 @@ static struct ctl_table net_core_table[] = {
 		.mode		= 0644,
 		.proc_handler	= rps_sock_flow_sysctl
 	},
+	{
+		.procname	= "rps_sock_flow_expire_ms",
+		.data		= &rps_sock_flow_expire,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_ms_jiffies
+	},
+	{
+		.procname	= "rps_numa_steering",
+		.data		= &rps_numa_steering,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one
+	},
 #endif
+	{
+		.procname	= "reuseport_numa_steering",
+		.data		= &reuseport_numa_steering,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &one
+	},
 #ifdef CONFIG_NET_FLOW_LIMIT
 	{
 		.procname	= "flow_limit_cpu_bitmap",
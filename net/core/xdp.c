@@ -71,3 +71,27 @@ bool xdp_rxq_info_is_reg(struct xdp_rxq_info *xdp_rxq)
 	return (xdp_rxq->reg_state == REG_STATE_REGISTERED);
 }
 EXPORT_SYMBOL_GPL(xdp_rxq_info_is_reg);
+
+/* Return the memory backing an xdp_frame.  All XDP frames are page_frag
+ * based (order-0 pages or page frags from the driver RX-ring), and the
+ * xdp_frame struct sits at the very start of the frame memory, so
+ * returning boils down to a page_frag_free() on the frame itself.
+ */
+void xdp_return_frame(struct xdp_frame *xdpf)
+{
+	page_frag_free(xdpf);
+}
+EXPORT_SYMBOL_GPL(xdp_return_frame);
+
+/* Bulk return for callers that complete redirected frames in batches,
+ * like the cpumap flush path or driver TX completion rings, so one call
+ * covers a whole batch instead of a call per frame.
+ */
+void xdp_return_frame_bulk(struct xdp_frame **frames, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		xdp_return_frame(frames[i]);
+}
+EXPORT_SYMBOL_GPL(xdp_return_frame_bulk);
@@ -40,6 +40,8 @@
 
 static struct kmem_cache *fib6_node_kmem __read_mostly;
 
+static void fib6_lookup_cache_flush(void);
+
 struct fib6_cleaner {
 	struct fib6_walker w;
 	struct net *net;
@@ -98,6 +100,11 @@ static int fib6_new_sernum(struct net *net)
 		new = old < INT_MAX ? old + 1 : 1;
 	} while (atomic_cmpxchg(&net->ipv6.fib6_sernum,
 				old, new) != old);
+
+	/* every writer that invalidates walk results comes through here,
+	 * except route deletion (see fib6_del_route())
+	 */
+	fib6_lookup_cache_flush();
 	return new;
 }
 
@@ -1302,6 +1309,104 @@ failure:
  *
  */
 
+/* Small per-cpu cache of recent fib6_lookup() results.  An entry is only
+ * trusted while the generation counter is unchanged, and the counter is
+ * bumped on every tree modification (see fib6_lookup_cache_flush()
+ * callers), so a hit can never return a node that has been freed or
+ * re-fitted since it was stored.  The counter is global rather than
+ * per-net: a table change in one namespace spuriously flushes the
+ * others, which only costs a tree walk.
+ *
+ * Entries are keyed by the destination (and, with subtrees, the source)
+ * plus the root node pointer, which disambiguates both table and
+ * namespace.  Accesses must be made with BHs disabled so that an entry
+ * is never read or written half-way through an update.
+ */
+#define FIB6_LOOKUP_CACHE_SIZE	16
+
+struct fib6_lookup_cache_ent {
+	struct in6_addr		daddr;
+#ifdef CONFIG_IPV6_SUBTREES
+	struct in6_addr		saddr;
+#endif
+	struct fib6_node	*root;
+	struct fib6_node	*fn;
+	int			gen;
+};
+
+static DEFINE_PER_CPU(struct fib6_lookup_cache_ent
+		      [FIB6_LOOKUP_CACHE_SIZE], fib6_lookup_cache);
+static atomic_t fib6_lookup_cache_gen = ATOMIC_INIT(1);
+
+static void fib6_lookup_cache_flush(void)
+{
+	/* fully ordered, so a lookup that observes the new generation is
+	 * also guaranteed to observe the tree change it stands for
+	 */
+	atomic_inc_return(&fib6_lookup_cache_gen);
+}
+
+static struct fib6_lookup_cache_ent *
+fib6_lookup_cache_ent(const struct fib6_node *root,
+		      const struct in6_addr *daddr)
+{
+	u32 hash = ipv6_addr_hash(daddr) ^ (u32)(unsigned long)root;
+
+	return this_cpu_ptr(fib6_lookup_cache) +
+	       (hash % FIB6_LOOKUP_CACHE_SIZE);
+}
+
+static struct fib6_node *fib6_lookup_cache_get(struct fib6_node *root,
+					       const struct in6_addr *daddr,
+					       const struct in6_addr *saddr)
+{
+	struct fib6_lookup_cache_ent *ent;
+	struct fib6_node *fn = NULL;
+
+	local_bh_disable();
+	ent = fib6_lookup_cache_ent(root, daddr);
+	if (ent->gen == atomic_read(&fib6_lookup_cache_gen) &&
+	    ent->root == root &&
+	    ipv6_addr_equal(&ent->daddr, daddr)
+#ifdef CONFIG_IPV6_SUBTREES
+	    && ipv6_addr_equal(&ent->saddr, saddr)
+#endif
+	   )
+		fn = ent->fn;
+	local_bh_enable();
+
+	return fn;
+}
+
+/* @gen must have been sampled before the tree walk that produced @fn, so
+ * that a modification racing with the walk leaves the entry stale instead
+ * of trusted.
+ */
+static void fib6_lookup_cache_set(struct fib6_node *root,
+				  const struct in6_addr *daddr,
+				  const struct in6_addr *saddr,
+				  struct fib6_node *fn, int gen)
+{
+	struct fib6_lookup_cache_ent *ent;
+
+	local_bh_disable();
+	ent = fib6_lookup_cache_ent(root, daddr);
+	/* invalidate first so a softirq peeking between the stores below
+	 * cannot mix the old and the new entry
+	 */
+	ent->gen = 0;
+	barrier();
+	ent->daddr = *daddr;
+#ifdef CONFIG_IPV6_SUBTREES
+	ent->saddr = *saddr;
+#endif
+	ent->root = root;
+	ent->fn = fn;
+	barrier();
+	ent->gen = gen;
+	local_bh_enable();
+}
+
 struct lookup_args {
 	int			offset;		/* key offset on rt6_info	*/
 	const struct in6_addr	*addr;		/* search key			*/
@@ -1395,10 +1500,31 @@ struct fib6_node *fib6_lookup(struct fib6_node *root, const struct in6_addr *dad
 		}
 	};
 
+	bool cacheable = !!daddr;
+	int gen = 0;
+
+#ifdef CONFIG_IPV6_SUBTREES
+	cacheable = cacheable && saddr;
+#endif
+	if (cacheable) {
+		fn = fib6_lookup_cache_get(root, daddr, saddr);
+		if (fn)
+			return fn;
+
+		gen = atomic_read(&fib6_lookup_cache_gen);
+		/* order the generation sample before the walk; pairs with
+		 * the fully ordered bump in fib6_lookup_cache_flush()
+		 */
+		smp_rmb();
+	}
+
 	fn = fib6_lookup_1(root, daddr ? args : args + 1);
 	if (!fn || fn->fn_flags & RTN_TL_ROOT)
 		fn = root;
 
+	if (cacheable)
+		fib6_lookup_cache_set(root, daddr, saddr, fn, gen);
+
 	return fn;
 }
 
@@ -1672,6 +1798,11 @@ static void fib6_del_route(struct fib6_table *table, struct fib6_node *fn,
 	net->ipv6.rt6_stats->fib_rt_entries--;
 	net->ipv6.rt6_stats->fib_discarded_routes++;
 
+	/* deletion does not go through fib6_new_sernum(), invalidate the
+	 * lookup cache by hand before the node can be repaired away
+	 */
+	fib6_lookup_cache_flush();
+
 	/* Flush all cached dst in exception table */
 	rt6_flush_exceptions(rt);
 
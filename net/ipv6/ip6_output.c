@@ -174,6 +174,130 @@ int ip6_output(struct net *net, struct sock *sk, struct sk_buff *skb)
 			    !(IP6CB(skb)->flags & IP6SKB_REROUTED));
 }
 
+static bool ip6_post_routing_hooked(struct net *net)
+{
+#ifdef CONFIG_NETFILTER
+	bool hooked;
+
+#ifdef HAVE_JUMP_LABEL
+	if (!static_key_false(&nf_hooks_needed[NFPROTO_IPV6][NF_INET_POST_ROUTING]))
+		return false;
+#endif
+	rcu_read_lock();
+	hooked = rcu_access_pointer(net->nf.hooks_ipv6[NF_INET_POST_ROUTING]);
+	rcu_read_unlock();
+	return hooked;
+#else
+	return false;
+#endif
+}
+
+/**
+ *	ip6_output_train - transmit a train of packets sharing one route
+ *	@net: network namespace
+ *	@sk: transmitting socket, may be %NULL
+ *	@head: list of skbs linked through skb->list
+ *
+ *	Every packet on the list must carry the same dst and the same
+ *	destination address; already-segmented bursts from a tunnel then
+ *	pay for the netfilter hook probe, the dst checks and the neighbour
+ *	resolution once instead of once per packet.  When POST_ROUTING
+ *	hooks are registered, or the route needs per-packet treatment
+ *	(multicast, lwtunnel redirect, xfrm), the train degrades to
+ *	ip6_output() per packet, so hook semantics are never bypassed.
+ */
+int ip6_output_train(struct net *net, struct sock *sk, struct list_head *head)
+{
+	struct sk_buff *skb, *next;
+	struct inet6_dev *idev;
+	struct in6_addr *nexthop;
+	struct neighbour *neigh;
+	struct dst_entry *dst;
+	struct net_device *dev;
+	unsigned int mtu;
+	bool allfrag;
+	int err = 0, ret;
+
+	if (list_empty(head))
+		return 0;
+
+	skb = list_first_entry(head, struct sk_buff, list);
+	dst = skb_dst(skb);
+	dev = dst->dev;
+	idev = ip6_dst_idev(dst);
+
+	if (unlikely(idev->cnf.disable_ipv6)) {
+		list_for_each_entry_safe(skb, next, head, list) {
+			skb_list_del_init(skb);
+			IP6_INC_STATS(net, idev, IPSTATS_MIB_OUTDISCARDS);
+			kfree_skb(skb);
+		}
+		return 0;
+	}
+
+	if (ip6_post_routing_hooked(net) ||
+	    ipv6_addr_is_multicast(&ipv6_hdr(skb)->daddr) ||
+	    lwtunnel_xmit_redirect(dst->lwtstate) ||
+#if defined(CONFIG_NETFILTER) && defined(CONFIG_XFRM)
+	    dst->xfrm ||
+#endif
+	    false) {
+		list_for_each_entry_safe(skb, next, head, list) {
+			skb_list_del_init(skb);
+			ret = ip6_output(net, sk, skb);
+			if (ret)
+				err = ret;
+		}
+		return err;
+	}
+
+	mtu = ip6_skb_dst_mtu(skb);
+	allfrag = dst_allfrag(dst);
+
+	rcu_read_lock_bh();
+	nexthop = rt6_nexthop((struct rt6_info *)dst, &ipv6_hdr(skb)->daddr);
+	neigh = __ipv6_neigh_lookup_noref(dev, nexthop);
+	if (unlikely(!neigh))
+		neigh = __neigh_create(&nd_tbl, nexthop, dev, false);
+	if (IS_ERR(neigh)) {
+		rcu_read_unlock_bh();
+		list_for_each_entry_safe(skb, next, head, list) {
+			skb_list_del_init(skb);
+			IP6_INC_STATS(net, idev, IPSTATS_MIB_OUTNOROUTES);
+			kfree_skb(skb);
+		}
+		return -EINVAL;
+	}
+
+	list_for_each_entry_safe(skb, next, head, list) {
+		skb_list_del_init(skb);
+		skb->protocol = htons(ETH_P_IPV6);
+		skb->dev = dev;
+
+		ret = BPF_CGROUP_RUN_PROG_INET_EGRESS(sk, skb);
+		if (ret) {
+			kfree_skb(skb);
+			err = ret;
+			continue;
+		}
+
+		if ((skb->len > mtu && !skb_is_gso(skb)) || allfrag ||
+		    (IP6CB(skb)->frag_max_size &&
+		     skb->len > IP6CB(skb)->frag_max_size)) {
+			ret = ip6_fragment(net, sk, skb, ip6_finish_output2);
+		} else {
+			sock_confirm_neigh(skb, neigh);
+			ret = neigh_output(neigh, skb);
+		}
+		if (ret)
+			err = ret;
+	}
+	rcu_read_unlock_bh();
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(ip6_output_train);
+
 bool ip6_autoflowlabel(struct net *net, const struct ipv6_pinfo *np)
 {
 	if (!np->autoflowlabel_set)
@@ -76,6 +76,22 @@ static u8 ip6_frag_ecn(const struct ipv6hdr *ipv6h)
 
 static struct inet_frags ip6_frags;
 
+/* The flow dissector hashes fragments over the addresses only (ports are
+ * never dissected once a fragment header is seen), so RPS/RSS steer all
+ * fragments of one datagram to the same cpu.  Exploit that: remember the
+ * queue the last fragment on this cpu went to and short-circuit the
+ * shared hash table, whose bucket locks are what a fragment flood
+ * actually contends on.  The per-cpu lock below is only ever taken by
+ * the owning cpu and by netns teardown, so it is effectively free.
+ */
+struct ip6_frag_cpu_cache {
+	spinlock_t		lock;
+	struct net		*net;
+	struct frag_queue	*fq;	/* owns a reference */
+};
+
+static DEFINE_PER_CPU(struct ip6_frag_cpu_cache, ip6_frag_cache);
+
 static int ip6_frag_reasm(struct frag_queue *fq, struct sk_buff *prev,
 			  struct net_device *dev);
 
@@ -186,10 +202,34 @@ static struct frag_queue *
 fq_find(struct net *net, __be32 id, const struct in6_addr *src,
 	const struct in6_addr *dst, int iif, u8 ecn)
 {
+	struct ip6_frag_cpu_cache *cache;
+	struct frag_queue *fq, *old;
 	struct inet_frag_queue *q;
 	struct ip6_create_arg arg;
 	unsigned int hash;
 
+	/* Fast path: the queue the previous fragment on this cpu matched.
+	 * The key test mirrors ip6_frag_match(); the unlocked COMPLETE
+	 * check is racy, but a stale hit is caught again under the queue
+	 * lock in ip6_frag_queue().
+	 */
+	cache = this_cpu_ptr(&ip6_frag_cache);
+	spin_lock(&cache->lock);
+	fq = cache->fq;
+	if (fq && cache->net == net && fq->id == id &&
+	    fq->user == IP6_DEFRAG_LOCAL_DELIVER &&
+	    ipv6_addr_equal(&fq->saddr, src) &&
+	    ipv6_addr_equal(&fq->daddr, dst) &&
+	    (fq->iif == iif ||
+	     !(ipv6_addr_type(dst) & (IPV6_ADDR_MULTICAST |
+				      IPV6_ADDR_LINKLOCAL))) &&
+	    !(fq->q.flags & INET_FRAG_COMPLETE)) {
+		refcount_inc(&fq->q.refcnt);
+		spin_unlock(&cache->lock);
+		return fq;
+	}
+	spin_unlock(&cache->lock);
+
 	arg.id = id;
 	arg.user = IP6_DEFRAG_LOCAL_DELIVER;
 	arg.src = src;
@@ -204,7 +244,21 @@ fq_find(struct net *net, __be32 id, const struct in6_addr *src,
 		inet_frag_maybe_warn_overflow(q, pr_fmt());
 		return NULL;
 	}
-	return container_of(q, struct frag_queue, q);
+	fq = container_of(q, struct frag_queue, q);
+
+	/* Remember the queue for the next fragment.  At worst this pins
+	 * one dead queue per cpu until another datagram replaces it.
+	 */
+	refcount_inc(&fq->q.refcnt);
+	spin_lock(&cache->lock);
+	old = cache->fq;
+	cache->fq = fq;
+	cache->net = net;
+	spin_unlock(&cache->lock);
+	if (old)
+		inet_frag_put(&old->q, &ip6_frags);
+
+	return fq;
 }
 
 static int ip6_frag_queue(struct frag_queue *fq, struct sk_buff *skb,
@@ -724,9 +778,34 @@ static int __net_init ipv6_frags_init_net(struct net *net)
 	return ip6_frags_ns_sysctl_register(net);
 }
 
+/* Drop cached queue references belonging to @net; they must not outlive
+ * the namespace whose mem limit counters they point into.
+ */
+static void ip6_frag_cache_flush(struct net *net)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ip6_frag_cpu_cache *cache =
+			per_cpu_ptr(&ip6_frag_cache, cpu);
+		struct frag_queue *fq = NULL;
+
+		spin_lock_bh(&cache->lock);
+		if (cache->net == net) {
+			fq = cache->fq;
+			cache->fq = NULL;
+			cache->net = NULL;
+		}
+		spin_unlock_bh(&cache->lock);
+		if (fq)
+			inet_frag_put(&fq->q, &ip6_frags);
+	}
+}
+
 static void __net_exit ipv6_frags_exit_net(struct net *net)
 {
 	ip6_frags_ns_sysctl_unregister(net);
+	ip6_frag_cache_flush(net);
 	inet_frags_exit_net(&net->ipv6.frags, &ip6_frags);
 }
 
@@ -737,7 +816,10 @@ static struct pernet_operations ip6_frags_ops = {
 
 int __init ipv6_frag_init(void)
 {
-	int ret;
+	int ret, cpu;
+
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(&ip6_frag_cache, cpu)->lock);
 
 	ret = inet6_add_protocol(&frag_protocol, IPPROTO_FRAGMENT);
 	if (ret)
@@ -4068,6 +4068,7 @@ static int ip6_route_multipath_add(struct fib6_config *cfg,
 {
 	struct rt6_info *rt_notif = NULL, *rt_last = NULL;
 	struct nl_info *info = &cfg->fc_nlinfo;
+	struct fib6_table *table = NULL;
 	struct fib6_config r_cfg;
 	struct rtnexthop *rtnh;
 	struct rt6_info *rt;
@@ -4140,7 +4141,20 @@ static int ip6_route_multipath_add(struct fib6_config *cfg,
 	err_nh = NULL;
 	list_for_each_entry(nh, &rt6_nh_list, next) {
 		rt_last = nh->rt6_info;
-		err = __ip6_ins_rt(nh->rt6_info, info, &nh->mxc, extack);
+
+		/* Take the table lock once for the whole batch instead of
+		 * once per nexthop; large multipath routes otherwise hammer
+		 * the lock during convergence.  All nexthops normally share
+		 * cfg->fc_table, but re-take the lock if one does not.
+		 */
+		if (table != nh->rt6_info->rt6i_table) {
+			if (table)
+				spin_unlock_bh(&table->tb6_lock);
+			table = nh->rt6_info->rt6i_table;
+			spin_lock_bh(&table->tb6_lock);
+		}
+		err = fib6_add(&table->tb6_root, nh->rt6_info, info, &nh->mxc,
+			       extack);
 		/* save reference to first route for notification */
 		if (!rt_notif && !err)
 			rt_notif = nh->rt6_info;
@@ -4148,6 +4162,8 @@ static int ip6_route_multipath_add(struct fib6_config *cfg,
 		/* nh->rt6_info is used or freed at this point, reset to NULL*/
 		nh->rt6_info = NULL;
 		if (err) {
+			spin_unlock_bh(&table->tb6_lock);
+			table = NULL;
 			if (replace && nhn)
 				ip6_print_replace_route_err(&rt6_nh_list);
 			err_nh = nh;
@@ -4166,6 +4182,9 @@ static int ip6_route_multipath_add(struct fib6_config *cfg,
 		nhn++;
 	}
 
+	if (table)
+		spin_unlock_bh(&table->tb6_lock);
+
 	/* success ... tell user about new route */
 	ip6_route_mpath_notify(rt_notif, rt_last, info, nlflags);
 	goto cleanup;
@@ -115,7 +115,8 @@ static void kcm_update_tx_mux_stats(struct kcm_mux *mux,
 	psock->saved_tx_bytes = psock->stats.tx_bytes;
 }
 
-static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb);
+static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb,
+			     bool wakeup);
 
 /* KCM is ready to receive messages on its queue-- either the KCM is new or
  * has become unblocked after being blocked on full socket buffer. Queue any
@@ -131,7 +132,7 @@ static void kcm_rcv_ready(struct kcm_sock *kcm)
 		return;
 
 	while (unlikely((skb = __skb_dequeue(&mux->rx_hold_queue)))) {
-		if (kcm_queue_rcv_skb(&kcm->sk, skb)) {
+		if (kcm_queue_rcv_skb(&kcm->sk, skb, true)) {
 			/* Assuming buffer limit has been reached */
 			skb_queue_head(&mux->rx_hold_queue, skb);
 			WARN_ON(!sk_rmem_alloc_get(&kcm->sk));
@@ -143,7 +144,7 @@ static void kcm_rcv_ready(struct kcm_sock *kcm)
 		psock = list_first_entry(&mux->psocks_ready, struct kcm_psock,
 					 psock_ready_list);
 
-		if (kcm_queue_rcv_skb(&kcm->sk, psock->ready_rx_msg)) {
+		if (kcm_queue_rcv_skb(&kcm->sk, psock->ready_rx_msg, true)) {
 			/* Assuming buffer limit has been reached */
 			WARN_ON(!sk_rmem_alloc_get(&kcm->sk));
 			return;
@@ -188,7 +189,13 @@ static void kcm_rfree(struct sk_buff *skb)
 	}
 }
 
-static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+/* Queue a message on a kcm socket's receive queue. Callers on the
+ * strparser delivery path pass wakeup false and leave waking the
+ * socket to unreserve_rx_kcm(), so a burst of parsed messages costs
+ * one sk_data_ready call instead of one per message.
+ */
+static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb,
+			     bool wakeup)
 {
 	struct sk_buff_head *list = &sk->sk_receive_queue;
 
@@ -208,7 +215,7 @@ static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 
 	skb_queue_tail(list, skb);
 
-	if (!sock_flag(sk, SOCK_DEAD))
+	if (wakeup && !sock_flag(sk, SOCK_DEAD))
 		sk->sk_data_ready(sk);
 
 	return 0;
@@ -236,7 +243,7 @@ try_again:
 		kcm = list_first_entry(&mux->kcm_rx_waiters,
 				       struct kcm_sock, wait_rx_list);
 
-		if (kcm_queue_rcv_skb(&kcm->sk, skb)) {
+		if (kcm_queue_rcv_skb(&kcm->sk, skb, true)) {
 			/* Should mean socket buffer full */
 			list_del(&kcm->wait_rx_list);
 			kcm->rx_wait = false;
@@ -309,6 +316,14 @@ static void unreserve_rx_kcm(struct kcm_psock *psock,
 	if (!kcm)
 		return;
 
+	/* Wake the kcm socket once for everything queued to it while the
+	 * reservation was held.  The strparser delivery path queues with
+	 * wakeup false and relies on this.
+	 */
+	if (!sock_flag(&kcm->sk, SOCK_DEAD) &&
+	    !skb_queue_empty(&kcm->sk.sk_receive_queue))
+		kcm->sk.sk_data_ready(&kcm->sk);
+
 	spin_lock_bh(&mux->rx_lock);
 
 	psock->rx_kcm = NULL;
@@ -370,7 +385,7 @@ try_queue:
 		return;
 	}
 
-	if (kcm_queue_rcv_skb(&kcm->sk, skb)) {
+	if (kcm_queue_rcv_skb(&kcm->sk, skb, false)) {
 		/* Should mean socket buffer full */
 		unreserve_rx_kcm(psock, false);
 		goto try_queue;
@@ -10,6 +10,7 @@
 
 #include <linux/rcupdate.h>
 #include <linux/jhash.h>
+#include <linux/bitmap.h>
 #include <linux/types.h>
 #include <linux/netfilter/ipset/ip_set_timeout.h>
 
@@ -27,9 +28,15 @@
  * Readers and resizing
  *
  * Resizing can be triggered by userspace command only, and those
- * are serialized by the nfnl mutex. During resizing the set is
- * read-locked, so the only possible concurrent operations are
- * the kernel side readers. Those must be protected by proper RCU locking.
+ * are serialized by the nfnl mutex. Resizing is done incrementally:
+ * the buckets are migrated to the new table in batches and the set
+ * lock is released between the batches, so that add/del operations
+ * and the packet path are stalled for a bounded time only. Buckets
+ * modified while the lock was released are recorded in a dirty bitmap
+ * and migrated again before the new table is published; this is safe
+ * because a bucket of the old table feeds a disjoint group of buckets
+ * of the new one. Kernel side readers must be protected by proper RCU
+ * locking and see the old, intact table until the switch.
  */
 
 /* Number of elements to store in an initial array block */
@@ -38,6 +45,8 @@
 #define AHASH_MAX_SIZE			(3 * AHASH_INIT_SIZE)
 /* Max muber of elements in the array block when tuned */
 #define AHASH_MAX_TUNED			64
+/* Number of buckets to migrate per set lock hold during resize */
+#define AHASH_RESIZE_BATCH		256
 
 /* Max number of elements can be tuned */
 #ifdef IP_SET_HASH_WITH_MULTI
@@ -72,10 +81,21 @@ struct hbucket {
 	DECLARE_BITMAP(used, AHASH_MAX_TUNED);
 	u8 size;		/* size of the array */
 	u8 pos;			/* position of the first free entry */
+	/* Hash signatures of the stored elements: a probe compares these
+	 * first and touches the value array only on a signature match, so
+	 * a miss is usually resolved from the bucket head cacheline
+	 * instead of walking dsize-strided elements with their extensions.
+	 */
+	u8 sig[AHASH_MAX_TUNED];
 	unsigned char value[0]	/* the array of the values */
 		__aligned(__alignof__(u64));
 };
 
+/* Signature of an element: the top byte of the full jhash value,
+ * independent of the bucket index for tables below 2^24 buckets
+ */
+#define AHASH_SIG(hash)		((u8)((hash) >> 24))
+
 /* The hash table: the table size stored here in order to make resizing easy */
 struct htable {
 	atomic_t ref;		/* References for resizing */
@@ -211,6 +231,8 @@ htable_bits(u32 hashsize)
 #undef mtype_uref
 #undef mtype_expire
 #undef mtype_resize
+#undef mtype_resize_bucket
+#undef mtype_resize_dirty
 #undef mtype_head
 #undef mtype_list
 #undef mtype_gc
@@ -220,6 +242,7 @@ htable_bits(u32 hashsize)
 
 #undef htype
 #undef HKEY
+#undef HKEY_FULL
 
 #define mtype_data_equal	IPSET_TOKEN(MTYPE, _data_equal)
 #ifdef IP_SET_HASH_WITH_NETS
@@ -253,6 +276,8 @@ htable_bits(u32 hashsize)
 #define mtype_uref		IPSET_TOKEN(MTYPE, _uref)
 #define mtype_expire		IPSET_TOKEN(MTYPE, _expire)
 #define mtype_resize		IPSET_TOKEN(MTYPE, _resize)
+#define mtype_resize_bucket	IPSET_TOKEN(MTYPE, _resize_bucket)
+#define mtype_resize_dirty	IPSET_TOKEN(MTYPE, _resize_dirty)
 #define mtype_head		IPSET_TOKEN(MTYPE, _head)
 #define mtype_list		IPSET_TOKEN(MTYPE, _list)
 #define mtype_gc		IPSET_TOKEN(MTYPE, _gc)
@@ -266,19 +291,26 @@ htable_bits(u32 hashsize)
 
 #define htype			MTYPE
 
-#define HKEY(data, initval, htable_bits)			\
+#define HKEY_FULL(data, initval)				\
 ({								\
 	const u32 *__k = (const u32 *)data;			\
 	u32 __l = HKEY_DATALEN / sizeof(u32);			\
 								\
 	BUILD_BUG_ON(HKEY_DATALEN % sizeof(u32) != 0);		\
 								\
-	jhash2(__k, __l, initval) & jhash_mask(htable_bits);	\
+	jhash2(__k, __l, initval);				\
 })
 
+#define HKEY(data, initval, htable_bits)			\
+	(HKEY_FULL(data, initval) & jhash_mask(htable_bits))
+
 /* The generic hash structure */
 struct htype {
 	struct htable __rcu *table; /* the hash table */
+	/* Buckets modified while an incremental resize had the set lock
+	 * released, see mtype_resize(); protected by the set lock
+	 */
+	unsigned long *resize_dirty;
 	struct timer_list gc;	/* garbage collection when timeout enabled */
 	struct ip_set *set;	/* attached to this ip_set */
 	u32 maxelem;		/* max elements in the hash */
@@ -356,6 +388,16 @@ mtype_ahash_memsize(const struct htype *h, const struct htable *t)
 #define ahash_data(n, i, dsize)	\
 	((struct mtype_elem *)((n)->value + ((i) * (dsize))))
 
+/* Record a modified bucket so that an incremental resize running in
+ * parallel migrates it again, caller must hold the set lock
+ */
+static inline void
+mtype_resize_dirty(struct htype *h, u32 key)
+{
+	if (unlikely(h->resize_dirty))
+		set_bit(key, h->resize_dirty);
+}
+
 static void
 mtype_ext_cleanup(struct ip_set *set, struct hbucket *n)
 {
@@ -495,6 +537,7 @@ mtype_expire(struct ip_set *set, struct htype *h)
 #endif
 			ip_set_ext_destroy(set, data);
 			set->elements--;
+			mtype_resize_dirty(h, i);
 			d++;
 		}
 		if (d >= AHASH_INIT_SIZE) {
@@ -515,6 +558,7 @@ mtype_expire(struct ip_set *set, struct htype *h)
 					continue;
 				data = ahash_data(n, j, dsize);
 				memcpy(tmp->value + d * dsize, data, dsize);
+				tmp->sig[d] = n->sig[j];
 				set_bit(d, tmp->used);
 				d++;
 			}
@@ -541,9 +585,100 @@ mtype_gc(struct timer_list *t)
 	add_timer(&h->gc);
 }
 
+/* Migrate one bucket of the original table into the not yet published
+ * new table. A bucket of the original table feeds only the group of
+ * new buckets with the same index modulo the original table size, so
+ * the migration can be repeated for a bucket modified in the meantime:
+ * the derived buckets are simply rebuilt from scratch. The new table
+ * is invisible to readers, so its buckets can be freed directly.
+ */
+static int
+mtype_resize_bucket(struct ip_set *set, struct htable *orig, struct htable *t,
+		    u32 i, struct mtype_elem *tmp, size_t *extsize)
+{
+	struct htype *h = set->data;
+	struct hbucket *n, *m;
+	struct mtype_elem *data;
+	struct mtype_elem *d;
+	size_t dsize = set->dsize;
+#ifdef IP_SET_HASH_WITH_NETS
+	u8 flags;
+#endif
+	u32 j, key, hash;
+
+	for (key = i; key < jhash_size(t->htable_bits);
+	     key += jhash_size(orig->htable_bits)) {
+		m = __ipset_dereference_protected(hbucket(t, key), 1);
+		if (!m)
+			continue;
+		*extsize -= (m->size / AHASH_INIT_SIZE) *
+			    ext_size(AHASH_INIT_SIZE, dsize);
+		RCU_INIT_POINTER(hbucket(t, key), NULL);
+		kfree(m);
+	}
+	n = __ipset_dereference_protected(hbucket(orig, i), 1);
+	if (!n)
+		return 0;
+	for (j = 0; j < n->pos; j++) {
+		if (!test_bit(j, n->used))
+			continue;
+		data = ahash_data(n, j, dsize);
+#ifdef IP_SET_HASH_WITH_NETS
+		/* We have readers running parallel with us,
+		 * so the live data cannot be modified.
+		 */
+		flags = 0;
+		memcpy(tmp, data, dsize);
+		data = tmp;
+		mtype_data_reset_flags(data, &flags);
+#endif
+		hash = HKEY_FULL(data, h->initval);
+		key = hash & jhash_mask(t->htable_bits);
+		m = __ipset_dereference_protected(hbucket(t, key), 1);
+		if (!m) {
+			m = kzalloc(sizeof(*m) +
+				    AHASH_INIT_SIZE * dsize,
+				    GFP_ATOMIC);
+			if (!m)
+				return -ENOMEM;
+			m->size = AHASH_INIT_SIZE;
+			*extsize += ext_size(AHASH_INIT_SIZE, dsize);
+			RCU_INIT_POINTER(hbucket(t, key), m);
+		} else if (m->pos >= m->size) {
+			struct hbucket *ht;
+
+			if (m->size >= AHASH_MAX(h))
+				return -EAGAIN;
+			ht = kzalloc(sizeof(*ht) +
+				     (m->size + AHASH_INIT_SIZE) * dsize,
+				     GFP_ATOMIC);
+			if (!ht)
+				return -ENOMEM;
+			memcpy(ht, m, sizeof(struct hbucket) +
+				      m->size * dsize);
+			ht->size = m->size + AHASH_INIT_SIZE;
+			*extsize += ext_size(AHASH_INIT_SIZE, dsize);
+			kfree(m);
+			m = ht;
+			RCU_INIT_POINTER(hbucket(t, key), ht);
+		}
+		d = ahash_data(m, m->pos, dsize);
+		memcpy(d, data, dsize);
+		m->sig[m->pos] = AHASH_SIG(hash);
+		set_bit(m->pos++, m->used);
+#ifdef IP_SET_HASH_WITH_NETS
+		mtype_data_reset_flags(d, &flags);
+#endif
+	}
+	return 0;
+}
+
 /* Resize a hash: create a new hash table with doubling the hashsize
  * and inserting the elements to it. Repeat until we succeed or
- * fail due to memory pressures.
+ * fail due to memory pressures. The set lock is released between
+ * bucket batches; add/del running in those windows mark the touched
+ * buckets in the dirty bitmap and we migrate them again before the
+ * new table goes live.
  */
 static int
 mtype_resize(struct ip_set *set, bool retried)
@@ -552,14 +687,14 @@ mtype_resize(struct ip_set *set, bool retried)
 	struct htable *t, *orig;
 	u8 htable_bits;
 	size_t extsize, dsize = set->dsize;
+	unsigned long *dirty;
+	u32 orig_hsize;
 #ifdef IP_SET_HASH_WITH_NETS
-	u8 flags;
 	struct mtype_elem *tmp;
+#else
+	struct mtype_elem *tmp = NULL;
 #endif
-	struct mtype_elem *data;
-	struct mtype_elem *d;
-	struct hbucket *n, *m;
-	u32 i, j, key;
+	u32 i;
 	int ret;
 
 #ifdef IP_SET_HASH_WITH_NETS
@@ -572,6 +707,14 @@ mtype_resize(struct ip_set *set, bool retried)
 	htable_bits = orig->htable_bits;
 	rcu_read_unlock_bh();
 
+	orig_hsize = jhash_size(htable_bits);
+	dirty = kcalloc(BITS_TO_LONGS(orig_hsize), sizeof(unsigned long),
+			GFP_KERNEL);
+	if (!dirty) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
 retry:
 	ret = 0;
 	htable_bits++;
@@ -595,69 +738,30 @@ retry:
 	atomic_set(&orig->ref, 1);
 	atomic_inc(&orig->uref);
 	extsize = 0;
+	h->resize_dirty = dirty;
 	pr_debug("attempt to resize set %s from %u to %u, t %p\n",
 		 set->name, orig->htable_bits, htable_bits, orig);
-	for (i = 0; i < jhash_size(orig->htable_bits); i++) {
-		n = __ipset_dereference_protected(hbucket(orig, i), 1);
-		if (!n)
-			continue;
-		for (j = 0; j < n->pos; j++) {
-			if (!test_bit(j, n->used))
-				continue;
-			data = ahash_data(n, j, dsize);
-#ifdef IP_SET_HASH_WITH_NETS
-			/* We have readers running parallel with us,
-			 * so the live data cannot be modified.
-			 */
-			flags = 0;
-			memcpy(tmp, data, dsize);
-			data = tmp;
-			mtype_data_reset_flags(data, &flags);
-#endif
-			key = HKEY(data, h->initval, htable_bits);
-			m = __ipset_dereference_protected(hbucket(t, key), 1);
-			if (!m) {
-				m = kzalloc(sizeof(*m) +
-					    AHASH_INIT_SIZE * dsize,
-					    GFP_ATOMIC);
-				if (!m) {
-					ret = -ENOMEM;
-					goto cleanup;
-				}
-				m->size = AHASH_INIT_SIZE;
-				extsize = ext_size(AHASH_INIT_SIZE, dsize);
-				RCU_INIT_POINTER(hbucket(t, key), m);
-			} else if (m->pos >= m->size) {
-				struct hbucket *ht;
-
-				if (m->size >= AHASH_MAX(h)) {
-					ret = -EAGAIN;
-				} else {
-					ht = kzalloc(sizeof(*ht) +
-						(m->size + AHASH_INIT_SIZE)
-						* dsize,
-						GFP_ATOMIC);
-					if (!ht)
-						ret = -ENOMEM;
-				}
-				if (ret < 0)
-					goto cleanup;
-				memcpy(ht, m, sizeof(struct hbucket) +
-					      m->size * dsize);
-				ht->size = m->size + AHASH_INIT_SIZE;
-				extsize += ext_size(AHASH_INIT_SIZE, dsize);
-				kfree(m);
-				m = ht;
-				RCU_INIT_POINTER(hbucket(t, key), ht);
-			}
-			d = ahash_data(m, m->pos, dsize);
-			memcpy(d, data, dsize);
-			set_bit(m->pos++, m->used);
-#ifdef IP_SET_HASH_WITH_NETS
-			mtype_data_reset_flags(d, &flags);
-#endif
+	for (i = 0; i < orig_hsize; i++) {
+		ret = mtype_resize_bucket(set, orig, t, i, tmp, &extsize);
+		if (ret < 0)
+			goto cleanup;
+		/* Let packets and add/del in between the batches */
+		if ((i + 1) % AHASH_RESIZE_BATCH == 0) {
+			spin_unlock_bh(&set->lock);
+			cond_resched();
+			spin_lock_bh(&set->lock);
 		}
 	}
+	/* Catch up with the buckets modified while the lock was released.
+	 * We hold the lock from here on, so the dirty set cannot grow.
+	 */
+	while ((i = find_first_bit(dirty, orig_hsize)) < orig_hsize) {
+		clear_bit(i, dirty);
+		ret = mtype_resize_bucket(set, orig, t, i, tmp, &extsize);
+		if (ret < 0)
+			goto cleanup;
+	}
+	h->resize_dirty = NULL;
 	rcu_assign_pointer(h->table, t);
 	set->ext_size = extsize;
 
@@ -675,18 +779,22 @@ retry:
 	}
 
 out:
+	kfree(dirty);
 #ifdef IP_SET_HASH_WITH_NETS
 	kfree(tmp);
 #endif
 	return ret;
 
 cleanup:
+	h->resize_dirty = NULL;
 	atomic_set(&orig->ref, 0);
 	atomic_dec(&orig->uref);
 	spin_unlock_bh(&set->lock);
 	mtype_ahash_destroy(set, t, false);
-	if (ret == -EAGAIN)
+	if (ret == -EAGAIN) {
+		bitmap_zero(dirty, orig_hsize);
 		goto retry;
+	}
 	goto out;
 }
 
@@ -705,7 +813,8 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	int i, j = -1;
 	bool flag_exist = flags & IPSET_FLAG_EXIST;
 	bool deleted = false, forceadd = false, reuse = false;
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
+	u8 sig;
 
 	if (set->elements >= h->maxelem) {
 		if (SET_WITH_TIMEOUT(set))
@@ -716,7 +825,9 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	}
 
 	t = ipset_dereference_protected(h->table, set);
-	key = HKEY(value, h->initval, t->htable_bits);
+	hash = HKEY_FULL(value, h->initval);
+	key = hash & jhash_mask(t->htable_bits);
+	sig = AHASH_SIG(hash);
 	n = __ipset_dereference_protected(hbucket(t, key), 1);
 	if (!n) {
 		if (forceadd || set->elements >= h->maxelem)
@@ -740,7 +851,7 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 			continue;
 		}
 		data = ahash_data(n, i, set->dsize);
-		if (mtype_data_equal(data, d, &multi)) {
+		if (n->sig[i] == sig && mtype_data_equal(data, d, &multi)) {
 			if (flag_exist ||
 			    (SET_WITH_TIMEOUT(set) &&
 			     ip_set_timeout_expired(ext_timeout(data, set)))) {
@@ -804,6 +915,7 @@ copy_data:
 		mtype_add_cidr(h, NCIDR_PUT(DCIDR_GET(d->cidr, i)), i);
 #endif
 	memcpy(data, d, sizeof(struct mtype_elem));
+	n->sig[j] = sig;
 overwrite_extensions:
 #ifdef IP_SET_HASH_WITH_NETS
 	mtype_data_set_flags(data, flags);
@@ -824,6 +936,7 @@ overwrite_extensions:
 		if (old)
 			kfree_rcu(old, rcu);
 	}
+	mtype_resize_dirty(h, key);
 
 	return 0;
 set_full:
@@ -845,11 +958,12 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	struct mtype_elem *data;
 	struct hbucket *n;
 	int i, j, k, ret = -IPSET_ERR_EXIST;
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
 	size_t dsize = set->dsize;
 
 	t = ipset_dereference_protected(h->table, set);
-	key = HKEY(value, h->initval, t->htable_bits);
+	hash = HKEY_FULL(value, h->initval);
+	key = hash & jhash_mask(t->htable_bits);
 	n = __ipset_dereference_protected(hbucket(t, key), 1);
 	if (!n)
 		goto out;
@@ -858,6 +972,8 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 			k++;
 			continue;
 		}
+		if (n->sig[i] != AHASH_SIG(hash))
+			continue;
 		data = ahash_data(n, i, dsize);
 		if (!mtype_data_equal(data, d, &multi))
 			continue;
@@ -871,6 +987,7 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 		if (i + 1 == n->pos)
 			n->pos--;
 		set->elements--;
+		mtype_resize_dirty(h, key);
 #ifdef IP_SET_HASH_WITH_NETS
 		for (j = 0; j < IPSET_NET_COUNT; j++)
 			mtype_del_cidr(h, NCIDR_PUT(DCIDR_GET(d->cidr, j)),
@@ -898,6 +1015,7 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 					continue;
 				data = ahash_data(n, j, dsize);
 				memcpy(tmp->value + k * dsize, data, dsize);
+				tmp->sig[k] = n->sig[j];
 				set_bit(k, tmp->used);
 				k++;
 			}
@@ -942,7 +1060,7 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 #else
 	int ret, i, j = 0;
 #endif
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
 
 	pr_debug("test by nets\n");
 	for (; j < NLEN && h->nets[j].cidr[0] && !multi; j++) {
@@ -956,13 +1074,16 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 #else
 		mtype_data_netmask(d, NCIDR_GET(h->nets[j].cidr[0]));
 #endif
-		key = HKEY(d, h->initval, t->htable_bits);
+		hash = HKEY_FULL(d, h->initval);
+		key = hash & jhash_mask(t->htable_bits);
 		n =  rcu_dereference_bh(hbucket(t, key));
 		if (!n)
 			continue;
 		for (i = 0; i < n->pos; i++) {
 			if (!test_bit(i, n->used))
 				continue;
+			if (n->sig[i] != AHASH_SIG(hash))
+				continue;
 			data = ahash_data(n, i, set->dsize);
 			if (!mtype_data_equal(data, d, &multi))
 				continue;
@@ -993,7 +1114,7 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	struct hbucket *n;
 	struct mtype_elem *data;
 	int i, ret = 0;
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
 
 	t = rcu_dereference_bh(h->table);
 #ifdef IP_SET_HASH_WITH_NETS
@@ -1009,7 +1130,8 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	}
 #endif
 
-	key = HKEY(d, h->initval, t->htable_bits);
+	hash = HKEY_FULL(d, h->initval);
+	key = hash & jhash_mask(t->htable_bits);
 	n = rcu_dereference_bh(hbucket(t, key));
 	if (!n) {
 		ret = 0;
@@ -1018,6 +1140,8 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	for (i = 0; i < n->pos; i++) {
 		if (!test_bit(i, n->used))
 			continue;
+		if (n->sig[i] != AHASH_SIG(hash))
+			continue;
 		data = ahash_data(n, i, set->dsize);
 		if (!mtype_data_equal(data, d, &multi))
 			continue;
@@ -36,6 +36,7 @@
 #include <linux/slab.h>
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
+#include <linux/log2.h>
 #include <linux/random.h>
 
 #include <net/net_namespace.h>
@@ -72,11 +73,13 @@ static atomic_t ip_vs_conn_no_cport_cnt = ATOMIC_INIT(0);
 static unsigned int ip_vs_conn_rnd __read_mostly;
 
 /*
- *  Fine locking granularity for big connection hash table
+ *  Fine locking granularity for big connection hash table.
+ *  CT_LOCKARRAY_BITS is only the minimum; the array is scaled with the
+ *  number of cpus at init time so that writers on different cpus rarely
+ *  share a lock.
  */
 #define CT_LOCKARRAY_BITS  5
-#define CT_LOCKARRAY_SIZE  (1<<CT_LOCKARRAY_BITS)
-#define CT_LOCKARRAY_MASK  (CT_LOCKARRAY_SIZE-1)
+#define CT_LOCKARRAY_MAX_BITS  12
 
 /* We need an addrstrlen that works with or without v6 */
 #ifdef CONFIG_IP_VS_IPV6
@@ -90,20 +93,39 @@ struct ip_vs_aligned_lock
 	spinlock_t	l;
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
-/* lock array for conn table */
-static struct ip_vs_aligned_lock
-__ip_vs_conntbl_lock_array[CT_LOCKARRAY_SIZE] __cacheline_aligned;
+/* lock array for conn table, sized in ip_vs_conn_init() */
+static struct ip_vs_aligned_lock *__ip_vs_conntbl_lock_array __read_mostly;
+static unsigned int ip_vs_conntbl_lock_mask __read_mostly;
 
 static inline void ct_write_lock_bh(unsigned int key)
 {
-	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_lock_bh(&__ip_vs_conntbl_lock_array[key&ip_vs_conntbl_lock_mask].l);
 }
 
 static inline void ct_write_unlock_bh(unsigned int key)
 {
-	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
+	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&ip_vs_conntbl_lock_mask].l);
 }
 
+/*
+ *  Per-cpu cache of recently looked up connections.  With RSS/RPS
+ *  steering all packets of a connection to one cpu, the entry for a flow
+ *  lives in that cpu's slots only, so neither the slot cachelines nor the
+ *  slot lock ever bounce between cpus on the fast path.  A cached
+ *  connection holds a reference and is therefore always safe to examine;
+ *  it is evicted when another flow hashes onto its slot, or by
+ *  ip_vs_conn_cache_flush().
+ */
+#define IP_VS_CONN_CACHE_BITS	8
+#define IP_VS_CONN_CACHE_SIZE	(1 << IP_VS_CONN_CACHE_BITS)
+
+struct ip_vs_conn_cache {
+	spinlock_t		lock;
+	struct ip_vs_conn	*tab[IP_VS_CONN_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct ip_vs_conn_cache, ip_vs_conn_cache);
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
 /*
@@ -294,11 +316,90 @@ __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 	return NULL;
 }
 
+static bool ip_vs_conn_cache_match(const struct ip_vs_conn_param *p,
+				   const struct ip_vs_conn *cp)
+{
+	return p->cport == cp->cport && p->vport == cp->vport &&
+	       cp->af == p->af &&
+	       ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+	       ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
+	       ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+	       p->protocol == cp->protocol &&
+	       cp->ipvs == p->ipvs;
+}
+
+static struct ip_vs_conn *
+ip_vs_conn_cache_get(const struct ip_vs_conn_param *p, unsigned int hash)
+{
+	struct ip_vs_conn_cache *c = this_cpu_ptr(&ip_vs_conn_cache);
+	struct ip_vs_conn *cp;
+
+	spin_lock_bh(&c->lock);
+	cp = c->tab[hash & (IP_VS_CONN_CACHE_SIZE - 1)];
+	if (cp && (cp->flags & IP_VS_CONN_F_HASHED) &&
+	    ip_vs_conn_cache_match(p, cp))
+		refcount_inc(&cp->refcnt);
+	else
+		cp = NULL;
+	spin_unlock_bh(&c->lock);
+
+	return cp;
+}
+
+static void ip_vs_conn_cache_set(struct ip_vs_conn *cp, unsigned int hash)
+{
+	struct ip_vs_conn_cache *c = this_cpu_ptr(&ip_vs_conn_cache);
+	unsigned int slot = hash & (IP_VS_CONN_CACHE_SIZE - 1);
+	struct ip_vs_conn *old;
+
+	refcount_inc(&cp->refcnt);
+	spin_lock_bh(&c->lock);
+	old = c->tab[slot];
+	c->tab[slot] = cp;
+	spin_unlock_bh(&c->lock);
+	if (old)
+		__ip_vs_conn_put(old);
+}
+
+/* Drop the cached references of one netns (all for NULL ipvs), so that
+ * the connections can expire.  Rare operation, may take foreign cpus'
+ * cache locks.
+ */
+static void ip_vs_conn_cache_flush(struct netns_ipvs *ipvs)
+{
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		struct ip_vs_conn_cache *c = per_cpu_ptr(&ip_vs_conn_cache,
+							 cpu);
+
+		for (i = 0; i < IP_VS_CONN_CACHE_SIZE; i++) {
+			struct ip_vs_conn *cp;
+
+			spin_lock_bh(&c->lock);
+			cp = c->tab[i];
+			if (cp && (!ipvs || cp->ipvs == ipvs))
+				c->tab[i] = NULL;
+			else
+				cp = NULL;
+			spin_unlock_bh(&c->lock);
+			if (cp)
+				__ip_vs_conn_put(cp);
+		}
+	}
+}
+
 struct ip_vs_conn *ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
+	unsigned int hash = ip_vs_conn_hashkey_param(p, false);
 	struct ip_vs_conn *cp;
 
-	cp = __ip_vs_conn_in_get(p);
+	cp = ip_vs_conn_cache_get(p, hash);
+	if (!cp) {
+		cp = __ip_vs_conn_in_get(p);
+		if (cp)
+			ip_vs_conn_cache_set(cp, hash);
+	}
 	if (!cp && atomic_read(&ip_vs_conn_no_cport_cnt)) {
 		struct ip_vs_conn_param cport_zero_p = *p;
 		cport_zero_p.cport = 0;
@@ -1351,6 +1452,9 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 	struct ip_vs_conn *cp, *cp_c;
 
 flush_again:
+	/* drop cached references so the entries below can expire */
+	ip_vs_conn_cache_flush(ipvs);
+
 	rcu_read_lock();
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
 
@@ -1401,12 +1505,24 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
-	int idx;
+	int lock_bits;
+	int lock_size;
+	int idx, cpu;
 
 	/* Compute size and mask */
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
 	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
 
+	/* Scale the lock array with the machine, so that writers on
+	 * different cpus rarely contend on the same lock.
+	 */
+	lock_bits = max_t(int, CT_LOCKARRAY_BITS,
+			  order_base_2(num_possible_cpus() * 8));
+	lock_bits = min(lock_bits, CT_LOCKARRAY_MAX_BITS);
+	lock_bits = min(lock_bits, ip_vs_conn_tab_bits);
+	lock_size = 1 << lock_bits;
+	ip_vs_conntbl_lock_mask = lock_size - 1;
+
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
@@ -1414,29 +1530,41 @@ int __init ip_vs_conn_init(void)
 	if (!ip_vs_conn_tab)
 		return -ENOMEM;
 
+	__ip_vs_conntbl_lock_array =
+		vmalloc(lock_size * sizeof(*__ip_vs_conntbl_lock_array));
+	if (!__ip_vs_conntbl_lock_array) {
+		vfree(ip_vs_conn_tab);
+		return -ENOMEM;
+	}
+
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
+		vfree(__ip_vs_conntbl_lock_array);
 		vfree(ip_vs_conn_tab);
 		return -ENOMEM;
 	}
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
+		"(size=%d, memory=%ldKbytes, locks=%d)\n",
 		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024);
+		(long)(ip_vs_conn_tab_size*sizeof(struct list_head))/1024,
+		lock_size);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
 	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
 		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
 
-	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
+	for (idx = 0; idx < lock_size; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
 	}
 
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(&ip_vs_conn_cache, cpu)->lock);
+
 	/* calculate the random value for connection hash */
 	get_random_bytes(&ip_vs_conn_rnd, sizeof(ip_vs_conn_rnd));
 
@@ -1445,9 +1573,14 @@ int __init ip_vs_conn_init(void)
 
 void ip_vs_conn_cleanup(void)
 {
+	/* All netns are gone by now, but make sure no cached references
+	 * are left behind.
+	 */
+	ip_vs_conn_cache_flush(NULL);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
+	vfree(__ip_vs_conntbl_lock_array);
 	vfree(ip_vs_conn_tab);
 }
@@ -757,14 +757,15 @@ ip_vs_copy_stats(struct ip_vs_kstats *dst, struct ip_vs_stats *src)
 
 	spin_lock_bh(&src->lock);
 
+	/* brings src->kstats up to date from the per-cpu counters */
+	ip_vs_read_estimator(dst, src);
+
 	IP_VS_SHOW_STATS_COUNTER(conns);
 	IP_VS_SHOW_STATS_COUNTER(inpkts);
 	IP_VS_SHOW_STATS_COUNTER(outpkts);
 	IP_VS_SHOW_STATS_COUNTER(inbytes);
 	IP_VS_SHOW_STATS_COUNTER(outbytes);
 
-	ip_vs_read_estimator(dst, src);
-
 	spin_unlock_bh(&src->lock);
 }
 
@@ -790,6 +791,9 @@ ip_vs_zero_stats(struct ip_vs_stats *stats)
 
 	/* get current counters as zero point, rates are zeroed */
 
+	/* brings stats->kstats up to date from the per-cpu counters */
+	ip_vs_zero_estimator(stats);
+
 #define IP_VS_ZERO_STATS_COUNTER(c) stats->kstats0.c = stats->kstats.c
 
 	IP_VS_ZERO_STATS_COUNTER(conns);
@@ -798,8 +802,6 @@ ip_vs_zero_stats(struct ip_vs_stats *stats)
 	IP_VS_ZERO_STATS_COUNTER(inbytes);
 	IP_VS_ZERO_STATS_COUNTER(outbytes);
 
-	ip_vs_zero_estimator(stats);
-
 	spin_unlock_bh(&stats->lock);
 }
 
@@ -21,6 +21,7 @@
 
 #include <linux/kernel.h>
 #include <linux/jiffies.h>
+#include <linux/math64.h>
 #include <linux/types.h>
 #include <linux/interrupt.h>
 #include <linux/sysctl.h>
@@ -34,10 +35,14 @@
   long interval, it is easy to implement a user level daemon which
   periodically reads those statistical counters and measure rate.
 
-  Currently, the measurement is activated by slow timer handler. Hope
-  this measurement will not introduce too much load.
+  The measurement is done lazily when the stats are actually read: the
+  per-cpu counters are summed on demand and the moving average is
+  brought up to date by replaying the 2-second intervals that elapsed
+  since the last read. This way the estimation cost scales with the
+  rate at which the stats are consumed, not with the number of
+  services and destinations.
 
-  We measure rate during the last 8 seconds every 2 seconds:
+  We measure rate during the last 8 seconds in 2 second intervals:
 
     avgrate = avgrate*(1-W) + rate*W
 
@@ -97,45 +102,64 @@ static void ip_vs_read_cpu_stats(struct ip_vs_kstats *sum,
 }
 
 
-static void estimation_timer(struct timer_list *t)
+/* Length of one estimation interval */
+#define IP_VS_EST_TICK		(2 * HZ)
+
+/* With W = 2^(-2) the average converges to within 1% of a steady rate
+ * after 16 steps, so longer idle periods simply load the current rate.
+ */
+#define IP_VS_EST_MAX_TICKS	16
+
+static void ip_vs_est_ewma(u64 *avg, u64 rate, unsigned int ticks)
+{
+	if (ticks >= IP_VS_EST_MAX_TICKS) {
+		*avg = rate;
+		return;
+	}
+	while (ticks--)
+		*avg += ((s64)rate - (s64)*avg) >> 2;
+}
+
+/* Bring the counter summary and the rate estimates of one stats block
+ * up to date. Replaces the periodic walk over every estimator: the
+ * per-cpu counters are summed here, on read, and the moving average is
+ * advanced by as many 2-second intervals as have elapsed, assuming the
+ * traffic was spread evenly across them. Caller must hold stats->lock.
+ */
+static void ip_vs_est_update(struct ip_vs_stats *s)
 {
-	struct ip_vs_estimator *e;
-	struct ip_vs_stats *s;
+	struct ip_vs_estimator *e = &s->est;
+	unsigned int ticks;
 	u64 rate;
-	struct netns_ipvs *ipvs = from_timer(ipvs, t, est_timer);
 
-	spin_lock(&ipvs->est_lock);
-	list_for_each_entry(e, &ipvs->est_list, list) {
-		s = container_of(e, struct ip_vs_stats, est);
+	ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
 
-		spin_lock(&s->lock);
-		ip_vs_read_cpu_stats(&s->kstats, s->cpustats);
+	ticks = (jiffies - e->last_jiffies) / IP_VS_EST_TICK;
+	if (!ticks)
+		return;
+	e->last_jiffies += (unsigned long)ticks * IP_VS_EST_TICK;
 
-		/* scaled by 2^10, but divided 2 seconds */
-		rate = (s->kstats.conns - e->last_conns) << 9;
-		e->last_conns = s->kstats.conns;
-		e->cps += ((s64)rate - (s64)e->cps) >> 2;
+	/* scaled by 2^10, but divided 2 seconds */
+	rate = div_u64((s->kstats.conns - e->last_conns) << 9, ticks);
+	e->last_conns = s->kstats.conns;
+	ip_vs_est_ewma(&e->cps, rate, ticks);
 
-		rate = (s->kstats.inpkts - e->last_inpkts) << 9;
-		e->last_inpkts = s->kstats.inpkts;
-		e->inpps += ((s64)rate - (s64)e->inpps) >> 2;
+	rate = div_u64((s->kstats.inpkts - e->last_inpkts) << 9, ticks);
+	e->last_inpkts = s->kstats.inpkts;
+	ip_vs_est_ewma(&e->inpps, rate, ticks);
 
-		rate = (s->kstats.outpkts - e->last_outpkts) << 9;
-		e->last_outpkts = s->kstats.outpkts;
-		e->outpps += ((s64)rate - (s64)e->outpps) >> 2;
+	rate = div_u64((s->kstats.outpkts - e->last_outpkts) << 9, ticks);
+	e->last_outpkts = s->kstats.outpkts;
+	ip_vs_est_ewma(&e->outpps, rate, ticks);
 
-		/* scaled by 2^5, but divided 2 seconds */
-		rate = (s->kstats.inbytes - e->last_inbytes) << 4;
-		e->last_inbytes = s->kstats.inbytes;
-		e->inbps += ((s64)rate - (s64)e->inbps) >> 2;
+	/* scaled by 2^5, but divided 2 seconds */
+	rate = div_u64((s->kstats.inbytes - e->last_inbytes) << 4, ticks);
+	e->last_inbytes = s->kstats.inbytes;
+	ip_vs_est_ewma(&e->inbps, rate, ticks);
 
-		rate = (s->kstats.outbytes - e->last_outbytes) << 4;
-		e->last_outbytes = s->kstats.outbytes;
-		e->outbps += ((s64)rate - (s64)e->outbps) >> 2;
-		spin_unlock(&s->lock);
-	}
-	spin_unlock(&ipvs->est_lock);
-	mod_timer(&ipvs->est_timer, jiffies + 2*HZ);
+	rate = div_u64((s->kstats.outbytes - e->last_outbytes) << 4, ticks);
+	e->last_outbytes = s->kstats.outbytes;
+	ip_vs_est_ewma(&e->outbps, rate, ticks);
 }
 
 void ip_vs_start_estimator(struct netns_ipvs *ipvs, struct ip_vs_stats *stats)
@@ -143,6 +167,7 @@ void ip_vs_start_estimator(struct netns_ipvs *ipvs, struct ip_vs_stats *stats)
 	struct ip_vs_estimator *est = &stats->est;
 
 	INIT_LIST_HEAD(&est->list);
+	est->last_jiffies = jiffies;
 
 	spin_lock_bh(&ipvs->est_lock);
 	list_add(&est->list, &ipvs->est_list);
@@ -164,6 +189,8 @@ void ip_vs_zero_estimator(struct ip_vs_stats *stats)
 	struct ip_vs_kstats *k = &stats->kstats;
 
 	/* reset counters, caller must hold the stats->lock lock */
+	ip_vs_read_cpu_stats(k, stats->cpustats);
+	est->last_jiffies = jiffies;
 	est->last_inbytes = k->inbytes;
 	est->last_outbytes = k->outbytes;
 	est->last_conns = k->conns;
@@ -176,11 +203,13 @@ void ip_vs_zero_estimator(struct ip_vs_stats *stats)
 	est->outbps = 0;
 }
 
-/* Get decoded rates */
+/* Get decoded rates, caller must hold the stats->lock lock */
 void ip_vs_read_estimator(struct ip_vs_kstats *dst, struct ip_vs_stats *stats)
 {
 	struct ip_vs_estimator *e = &stats->est;
 
+	ip_vs_est_update(stats);
+
 	dst->cps = (e->cps + 0x1FF) >> 10;
 	dst->inpps = (e->inpps + 0x1FF) >> 10;
 	dst->outpps = (e->outpps + 0x1FF) >> 10;
@@ -192,12 +221,9 @@ int __net_init ip_vs_estimator_net_init(struct netns_ipvs *ipvs)
 {
 	INIT_LIST_HEAD(&ipvs->est_list);
 	spin_lock_init(&ipvs->est_lock);
-	timer_setup(&ipvs->est_timer, estimation_timer, 0);
-	mod_timer(&ipvs->est_timer, jiffies + 2 * HZ);
 	return 0;
 }
 
 void __net_exit ip_vs_estimator_net_cleanup(struct netns_ipvs *ipvs)
 {
-	del_timer_sync(&ipvs->est_timer);
 }
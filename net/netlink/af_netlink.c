@@ -1704,6 +1704,13 @@ static int netlink_setsockopt(struct socket *sock, int level, int optname,
 			nlk->flags &= ~NETLINK_F_EXT_ACK;
 		err = 0;
 		break;
+	case NETLINK_DUMP_BATCH:
+		if (val)
+			nlk->flags |= NETLINK_F_DUMP_BATCH;
+		else
+			nlk->flags &= ~NETLINK_F_DUMP_BATCH;
+		err = 0;
+		break;
 	default:
 		err = -ENOPROTOOPT;
 	}
@@ -1797,6 +1804,15 @@ static int netlink_getsockopt(struct socket *sock, int level, int optname,
 			return -EFAULT;
 		err = 0;
 		break;
+	case NETLINK_DUMP_BATCH:
+		if (len < sizeof(int))
+			return -EINVAL;
+		len = sizeof(int);
+		val = nlk->flags & NETLINK_F_DUMP_BATCH ? 1 : 0;
+		if (put_user(len, optlen) || put_user(val, optval))
+			return -EFAULT;
+		err = 0;
+		break;
 	default:
 		err = -ENOPROTOOPT;
 	}
@@ -1910,6 +1926,7 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	int noblock = flags&MSG_DONTWAIT;
 	size_t copied;
 	struct sk_buff *skb, *data_skb;
+	bool batch;
 	int err, ret;
 
 	if (flags&MSG_OOB)
@@ -1973,8 +1990,46 @@ static int netlink_recvmsg(struct socket *sock, struct msghdr *msg, size_t len,
 	if (flags & MSG_TRUNC)
 		copied = data_skb->len;
 
+	batch = nlk->flags & NETLINK_F_DUMP_BATCH && nlk->cb_running &&
+		!err && data_skb == skb && copied == data_skb->len &&
+		!(flags & (MSG_PEEK | MSG_TRUNC));
+
 	skb_free_datagram(sk, skb);
 
+	/* A dump consumer that opted in gets its buffer filled with as
+	 * many whole dump chunks as fit, each a self-contained run of
+	 * NLM_F_MULTI messages, so one large recvmsg() replaces a syscall
+	 * per chunk.  The dump is re-run as the queue drains; a chunk that
+	 * does not fit stays queued for the next call, which is also what
+	 * bounds the work done here.
+	 */
+	while (batch && msg_data_left(msg)) {
+		struct sk_buff *skb2;
+
+		if (nlk->cb_running &&
+		    atomic_read(&sk->sk_rmem_alloc) <= sk->sk_rcvbuf / 2) {
+			ret = netlink_dump(sk);
+			if (ret) {
+				sk->sk_err = -ret;
+				sk->sk_error_report(sk);
+				break;
+			}
+		}
+
+		skb2 = skb_dequeue(&sk->sk_receive_queue);
+		if (!skb2)
+			break;
+
+		if (skb2->len > msg_data_left(msg) ||
+		    skb_copy_datagram_msg(skb2, 0, msg, skb2->len)) {
+			skb_queue_head(&sk->sk_receive_queue, skb2);
+			break;
+		}
+
+		copied += skb2->len;
+		skb_free_datagram(sk, skb2);
+	}
+
 	if (nlk->cb_running &&
 	    atomic_read(&sk->sk_rmem_alloc) <= sk->sk_rcvbuf / 2) {
 		ret = netlink_dump(sk);
@@ -140,15 +140,19 @@ struct dp_upcall_info {
  * struct ovs_net - Per net-namespace data for ovs.
  * @dps: List of datapaths to enable dumping them all out.
  * Protected by genl_mutex.
+ * @masks_rebalance: Deferred work for periodic mask rebalance.
  */
 struct ovs_net {
 	struct list_head dps;
 	struct work_struct dp_notify_work;
+	struct delayed_work masks_rebalance;
 
 	/* Module reference for configuring conntrack. */
 	bool xt_label;
 };
 
+#define OVS_MASKS_REBALANCE_INTERVAL	4000	/* ms */
+
 extern unsigned int ovs_net_id;
 void ovs_lock(void);
 void ovs_unlock(void);
@@ -169,6 +169,8 @@ union tpacket_uhdr {
 
 static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		int closing, int tx_ring);
+static int packet_umem_reg(struct sock *sk, u64 addr, u64 len);
+static void packet_umem_free(struct packet_umem *umem);
 
 #define V3_ALIGNMENT	(8)
 
@@ -3018,6 +3020,11 @@ static int packet_release(struct socket *sock)
 		packet_set_ring(sk, &req_u, 1, 1);
 	}
 
+	if (po->umem) {
+		packet_umem_free(po->umem);
+		po->umem = NULL;
+	}
+
 	f = fanout_release(sk);
 
 	synchronize_net();
@@ -3662,6 +3669,16 @@ packet_setsockopt(struct socket *sock, int level, int optname, char __user *optv
 		return packet_set_ring(sk, &req_u, 0,
 			optname == PACKET_TX_RING);
 	}
+	case PACKET_UMEM_REG:
+	{
+		struct tpacket_umem_req req;
+
+		if (optlen != sizeof(req))
+			return -EINVAL;
+		if (copy_from_user(&req, optval, sizeof(req)))
+			return -EFAULT;
+		return packet_umem_reg(sk, req.tur_addr, req.tur_len);
+	}
 	case PACKET_COPY_THRESH:
 	{
 		int val;
@@ -4172,6 +4189,133 @@ static char *alloc_one_pg_vec_page(unsigned long order)
 	return NULL;
 }
 
+/* User-registered memory backing for the pgvec rings.  The pages stay
+ * pinned for the lifetime of the registration; ring blocks are vmap()ed
+ * windows over them, so every existing V1/V2/V3 ring operation works on
+ * them unchanged and the frames land directly in the registering
+ * process's memory without it having to mmap the ring.  This is the
+ * copy path; true NIC DMA into the region needs driver support on top.
+ */
+struct packet_umem {
+	struct page		**pages;
+	unsigned int		npages;
+	struct mm_struct	*mm;	/* pinned_vm accounting */
+};
+
+static void packet_umem_free(struct packet_umem *umem)
+{
+	unsigned int i;
+
+	for (i = 0; i < umem->npages; i++) {
+		set_page_dirty_lock(umem->pages[i]);
+		put_page(umem->pages[i]);
+	}
+	down_write(&umem->mm->mmap_sem);
+	umem->mm->pinned_vm -= umem->npages;
+	up_write(&umem->mm->mmap_sem);
+	mmdrop(umem->mm);
+	kvfree(umem->pages);
+	kfree(umem);
+}
+
+static int packet_umem_reg(struct sock *sk, u64 addr, u64 len)
+{
+	struct packet_sock *po = pkt_sk(sk);
+	unsigned long lock_limit;
+	struct packet_umem *umem;
+	unsigned int npages;
+	long pinned;
+	int err;
+
+	if (!PAGE_ALIGNED(addr) || !PAGE_ALIGNED(len) || !len ||
+	    len > UINT_MAX || addr + len < addr)
+		return -EINVAL;
+	npages = len >> PAGE_SHIFT;
+
+	lock_sock(sk);
+	err = -EBUSY;
+	if (po->umem || po->rx_ring.pg_vec || po->tx_ring.pg_vec)
+		goto out;
+
+	err = -ENOBUFS;
+	lock_limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	down_write(&current->mm->mmap_sem);
+	if (current->mm->pinned_vm + npages > lock_limit &&
+	    !capable(CAP_IPC_LOCK)) {
+		up_write(&current->mm->mmap_sem);
+		goto out;
+	}
+	current->mm->pinned_vm += npages;
+	up_write(&current->mm->mmap_sem);
+
+	err = -ENOMEM;
+	umem = kzalloc(sizeof(*umem), GFP_KERNEL);
+	if (!umem)
+		goto out_unaccount;
+	umem->pages = kvmalloc_array(npages, sizeof(struct page *),
+				     GFP_KERNEL | __GFP_ZERO);
+	if (!umem->pages)
+		goto out_free;
+
+	pinned = get_user_pages_fast(addr, npages, 1, umem->pages);
+	if (pinned != npages) {
+		umem->npages = pinned > 0 ? pinned : 0;
+		err = pinned < 0 ? pinned : -EFAULT;
+		goto out_put;
+	}
+	umem->npages = npages;
+	umem->mm = current->mm;
+	mmgrab(umem->mm);
+
+	po->umem = umem;
+	release_sock(sk);
+	return 0;
+
+out_put:
+	while (umem->npages)
+		put_page(umem->pages[--umem->npages]);
+	kvfree(umem->pages);
+out_free:
+	kfree(umem);
+out_unaccount:
+	down_write(&current->mm->mmap_sem);
+	current->mm->pinned_vm -= npages;
+	up_write(&current->mm->mmap_sem);
+out:
+	release_sock(sk);
+	return err;
+}
+
+/* Build a pg_vec whose blocks are vmap()ed windows over the registered
+ * region.  free_pg_vec() tears these mappings down via vfree(), which
+ * for a VM_MAP area only removes the mapping; the pinned pages are
+ * released by packet_umem_free() at unregistration.
+ */
+static struct pgv *umem_pg_vec(struct packet_umem *umem,
+			       struct tpacket_req *req)
+{
+	unsigned int pages_per_block = req->tp_block_size / PAGE_SIZE;
+	unsigned int block_nr = req->tp_block_nr;
+	struct pgv *pg_vec;
+	unsigned int i;
+
+	pg_vec = kcalloc(block_nr, sizeof(struct pgv), GFP_KERNEL);
+	if (unlikely(!pg_vec))
+		return NULL;
+
+	for (i = 0; i < block_nr; i++) {
+		pg_vec[i].buffer = vmap(&umem->pages[i * pages_per_block],
+					pages_per_block, VM_MAP, PAGE_KERNEL);
+		if (unlikely(!pg_vec[i].buffer))
+			goto out_free_pgvec;
+	}
+	return pg_vec;
+
+out_free_pgvec:
+	free_pg_vec(pg_vec, 0, block_nr);
+	return NULL;
+}
+
 static struct pgv *alloc_pg_vec(struct tpacket_req *req, int order)
 {
 	unsigned int block_nr = req->tp_block_nr;
@@ -4265,9 +4409,16 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 					req->tp_frame_nr))
 			goto out;
 
+		err = -EINVAL;
+		if (po->umem &&
+		    (u64)req->tp_block_size * req->tp_block_nr !=
+		    (u64)po->umem->npages << PAGE_SHIFT)
+			goto out;
+
 		err = -ENOMEM;
 		order = get_order(req->tp_block_size);
-		pg_vec = alloc_pg_vec(req, order);
+		pg_vec = po->umem ? umem_pg_vec(po->umem, req) :
+				    alloc_pg_vec(req, order);
 		if (unlikely(!pg_vec))
 			goto out;
 		switch (po->tp_version) {
@@ -141,6 +141,12 @@ struct rds_ib_connection {
 	struct rds_ib_send_work *i_sends;
 	atomic_t		i_signaled_sends;
 
+	/* send WRs chained but not yet posted, waiting for the doorbell */
+	struct ib_send_wr	*i_batch_first;
+	struct ib_send_wr	*i_batch_last;
+	struct rds_ib_send_work	*i_batch_last_send;
+	u32			i_batch_wrs;
+
 	/* rx */
 	struct mutex		i_recv_mutex;
 	struct rds_ib_work_ring	i_recv_ring;
@@ -255,6 +261,7 @@ struct rds_ib_statistics {
 	uint64_t	s_ib_tx_sg_mapping_failure;
 	uint64_t	s_ib_tx_stalled;
 	uint64_t	s_ib_tx_credit_updates;
+	uint64_t	s_ib_tx_batch_posts;
 	uint64_t	s_ib_rx_cq_event;
 	uint64_t	s_ib_rx_ring_empty;
 	uint64_t	s_ib_rx_refill_from_cq;
@@ -406,6 +413,7 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 void rds_ib_send_cqe_handler(struct rds_ib_connection *ic, struct ib_wc *wc);
 void rds_ib_send_init_ring(struct rds_ib_connection *ic);
 void rds_ib_send_clear_ring(struct rds_ib_connection *ic);
+int rds_ib_send_flush_batch(struct rds_ib_connection *ic);
 int rds_ib_xmit_rdma(struct rds_connection *conn, struct rm_rdma_op *op);
 void rds_ib_send_add_credits(struct rds_connection *conn, unsigned int credits);
 void rds_ib_advertise_credits(struct rds_connection *conn, unsigned int posted);
@@ -427,6 +435,7 @@ void rds_ib_sysctl_exit(void);
 extern unsigned long rds_ib_sysctl_max_send_wr;
 extern unsigned long rds_ib_sysctl_max_recv_wr;
 extern unsigned long rds_ib_sysctl_max_unsig_wrs;
+extern unsigned long rds_ib_sysctl_max_batch_wrs;
 extern unsigned long rds_ib_sysctl_max_unsig_bytes;
 extern unsigned long rds_ib_sysctl_max_recv_allocation;
 extern unsigned int rds_ib_sysctl_flow_control;
@@ -898,6 +898,14 @@ void rds_ib_conn_path_shutdown(struct rds_conn_path *cp)
 	}
 	BUG_ON(ic->rds_ibdev);
 
+	/* The send path flushes its WR batch before dropping RDS_IN_XMIT,
+	 * so nothing should be waiting for the doorbell by now.
+	 */
+	BUG_ON(ic->i_batch_first);
+	ic->i_batch_last = NULL;
+	ic->i_batch_last_send = NULL;
+	ic->i_batch_wrs = 0;
+
 	/* Clear pending transmit */
 	if (ic->i_data_op) {
 		struct rds_message *rm;
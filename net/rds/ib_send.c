@@ -471,6 +471,87 @@ static inline int rds_ib_set_wr_signal_state(struct rds_ib_connection *ic,
 	return 0;
 }
 
+/*
+ * A batch of WRs was chained up by rds_ib_xmit() but never made it to the
+ * hardware.  No completion will ever arrive for them, so do here what the
+ * completion handler would have done: unmap the ops, drop the message
+ * references and return the ring entries.  The failed batch is always the
+ * tail of the ring (every other allocator flushes it first), so the
+ * unalloc below only touches unposted entries.
+ */
+static void rds_ib_send_batch_error(struct rds_ib_connection *ic,
+				    struct ib_send_wr *first, u32 nr_wrs)
+{
+	struct ib_send_wr *wr;
+	int nr_sig = 0;
+
+	for (wr = first; wr; wr = wr->next) {
+		struct rds_ib_send_work *send =
+			container_of(wr, struct rds_ib_send_work, s_wr);
+		struct rds_message *rm;
+
+		if (wr->send_flags & IB_SEND_SIGNALED)
+			nr_sig++;
+
+		rm = rds_ib_send_unmap_op(ic, send, IB_WC_WR_FLUSH_ERR);
+		if (send->s_op) {
+			if (send->s_op == rm->m_final_op)
+				rds_message_unmapped(rm);
+			rds_message_put(rm);
+			send->s_op = NULL;
+		}
+	}
+
+	rds_ib_ring_unalloc(&ic->i_send_ring, nr_wrs);
+	rds_ib_sub_signaled(ic, nr_sig);
+}
+
+/*
+ * Ring the doorbell once for everything rds_ib_xmit() chained up since
+ * the last flush.  The final WR of the batch is always signaled, so the
+ * ring is reclaimed at least once per batch even when the periodic
+ * unsignaled counter didn't fire for any of the chained WRs.
+ *
+ * Like the xmit paths this runs under RDS_IN_XMIT, which is what keeps
+ * the pending chain consistent.
+ */
+int rds_ib_send_flush_batch(struct rds_ib_connection *ic)
+{
+	struct ib_send_wr *first = ic->i_batch_first;
+	struct rds_ib_send_work *last = ic->i_batch_last_send;
+	struct ib_send_wr *failed_wr;
+	u32 nr_wrs = ic->i_batch_wrs;
+	int ret;
+
+	if (!first)
+		return 0;
+
+	ic->i_batch_first = NULL;
+	ic->i_batch_last = NULL;
+	ic->i_batch_last_send = NULL;
+	ic->i_batch_wrs = 0;
+
+	if (!(last->s_wr.send_flags & IB_SEND_SIGNALED)) {
+		last->s_wr.send_flags |= IB_SEND_SIGNALED;
+		ic->i_unsignaled_wrs = rds_ib_sysctl_max_unsig_wrs;
+		atomic_inc(&ic->i_signaled_sends);
+	}
+
+	rds_ib_stats_inc(s_ib_tx_batch_posts);
+
+	failed_wr = first;
+	ret = ib_post_send(ic->i_cm_id->qp, first, &failed_wr);
+	rdsdebug("ic %p first %p ret %d wr %p\n", ic, first, ret, failed_wr);
+	BUG_ON(failed_wr != first);
+	if (ret) {
+		printk(KERN_WARNING "RDS/IB: ib_post_send to %pI4 "
+		       "returned %d\n", &ic->conn->c_faddr, ret);
+		rds_ib_send_batch_error(ic, first, nr_wrs);
+		rds_ib_conn_error(ic->conn, "ib_post_send failed\n");
+	}
+	return ret;
+}
+
 /*
  * This can be called multiple times for a given message.  The first time
  * we see a message we map its scatterlist into the IB device so that
@@ -492,7 +573,6 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 	struct rds_ib_send_work *send = NULL;
 	struct rds_ib_send_work *first;
 	struct rds_ib_send_work *prev;
-	struct ib_send_wr *failed_wr;
 	struct scatterlist *scat;
 	u32 pos;
 	u32 i;
@@ -703,12 +783,15 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 	if (hdr_off == 0)
 		bytes_sent += sizeof(struct rds_header);
 
-	/* if we finished the message then send completion owns it */
+	/* if we finished the message then send completion owns it.  The
+	 * final fragment is no longer signaled unconditionally; the
+	 * periodic counter in rds_ib_set_wr_signal_state() and the
+	 * batch flush keep completions coming often enough to reclaim
+	 * the ring.
+	 */
 	if (scat == &rm->data.op_sg[rm->data.op_count]) {
 		prev->s_op = ic->i_data_op;
 		prev->s_wr.send_flags |= IB_SEND_SOLICITED;
-		if (!(prev->s_wr.send_flags & IB_SEND_SIGNALED))
-			nr_sig += rds_ib_set_wr_signal_state(ic, prev, true);
 		ic->i_data_op = NULL;
 	}
 
@@ -723,24 +806,25 @@ int rds_ib_xmit(struct rds_connection *conn, struct rds_message *rm,
 	if (nr_sig)
 		atomic_add(nr_sig, &ic->i_signaled_sends);
 
-	/* XXX need to worry about failed_wr and partial sends. */
-	failed_wr = &first->s_wr;
-	ret = ib_post_send(ic->i_cm_id->qp, &first->s_wr, &failed_wr);
-	rdsdebug("ic %p first %p (wr %p) ret %d wr %p\n", ic,
-		 first, &first->s_wr, ret, failed_wr);
-	BUG_ON(failed_wr != &first->s_wr);
-	if (ret) {
-		printk(KERN_WARNING "RDS/IB: ib_post_send to %pI4 "
-		       "returned %d\n", &conn->c_faddr, ret);
-		rds_ib_ring_unalloc(&ic->i_send_ring, work_alloc);
-		rds_ib_sub_signaled(ic, nr_sig);
-		if (prev->s_op) {
-			ic->i_data_op = prev->s_op;
-			prev->s_op = NULL;
-		}
-
-		rds_ib_conn_error(ic->conn, "ib_post_send failed\n");
-		goto out;
+	/*
+	 * Chain behind any WRs still waiting for the doorbell instead of
+	 * posting right away; rds_ib_send_flush_batch() rings it once for
+	 * the whole batch, either here when enough WRs have accumulated
+	 * or from rds_ib_xmit_path_complete() when the send worker runs
+	 * out of messages.
+	 */
+	if (ic->i_batch_last)
+		ic->i_batch_last->next = &first->s_wr;
+	else
+		ic->i_batch_first = &first->s_wr;
+	ic->i_batch_last = &prev->s_wr;
+	ic->i_batch_last_send = prev;
+	ic->i_batch_wrs += work_alloc;
+
+	if (ic->i_batch_wrs >= rds_ib_sysctl_max_batch_wrs) {
+		ret = rds_ib_send_flush_batch(ic);
+		if (ret)
+			goto out;
 	}
 
 	ret = bytes_sent;
@@ -767,6 +851,13 @@ int rds_ib_xmit_atomic(struct rds_connection *conn, struct rm_atomic_op *op)
 
 	rds_ibdev = ib_get_client_data(ic->i_cm_id->device, &rds_ib_client);
 
+	/* Flush batched sends so the failure path below only ever
+	 * unallocs the tail of the ring.
+	 */
+	ret = rds_ib_send_flush_batch(ic);
+	if (ret)
+		goto out;
+
 	work_alloc = rds_ib_ring_alloc(&ic->i_send_ring, 1, &pos);
 	if (work_alloc != 1) {
 		rds_ib_stats_inc(s_ib_tx_ring_full);
@@ -863,6 +954,13 @@ int rds_ib_xmit_rdma(struct rds_connection *conn, struct rm_rdma_op *op)
 	int num_sge;
 	int nr_sig = 0;
 
+	/* Flush batched sends so the failure path below only ever
+	 * unallocs the tail of the ring.
+	 */
+	ret = rds_ib_send_flush_batch(ic);
+	if (ret)
+		goto out;
+
 	/* map the op the first time we see it */
 	if (!op->op_mapped) {
 		op->op_count = ib_dma_map_sg(ic->i_cm_id->device,
@@ -989,6 +1087,9 @@ void rds_ib_xmit_path_complete(struct rds_conn_path *cp)
 	struct rds_connection *conn = cp->cp_conn;
 	struct rds_ib_connection *ic = conn->c_transport_data;
 
+	/* Ring the doorbell for everything the send worker queued */
+	rds_ib_send_flush_batch(ic);
+
 	/* We may have a pending ACK or window update we were unable
 	 * to send previously (due to flow control). Try again. */
 	rds_ib_attempt_ack(ic);
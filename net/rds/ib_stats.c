@@ -50,6 +50,7 @@ static const char *const rds_ib_stat_names[] = {
 	"ib_tx_sg_mapping_failure",
 	"ib_tx_stalled",
 	"ib_tx_credit_updates",
+	"ib_tx_batch_posts",
 	"ib_rx_cq_event",
 	"ib_rx_ring_empty",
 	"ib_rx_refill_from_cq",
@@ -49,6 +49,15 @@ unsigned long rds_ib_sysctl_max_unsig_wrs = 16;
 static unsigned long rds_ib_sysctl_max_unsig_wr_min = 1;
 static unsigned long rds_ib_sysctl_max_unsig_wr_max = 64;
 
+/*
+ * How many send WRs we chain up behind one doorbell before forcing a
+ * flush.  Setting this to 1 posts every message separately, as the
+ * send path did historically.
+ */
+unsigned long rds_ib_sysctl_max_batch_wrs = 32;
+static unsigned long rds_ib_sysctl_max_batch_wr_min = 1;
+static unsigned long rds_ib_sysctl_max_batch_wr_max = 128;
+
 /*
  * This sysctl does nothing.
  *
@@ -89,6 +98,15 @@ static struct ctl_table rds_ib_sysctl_table[] = {
 		.extra1		= &rds_ib_sysctl_max_unsig_wr_min,
 		.extra2		= &rds_ib_sysctl_max_unsig_wr_max,
 	},
+	{
+		.procname       = "max_batched_wr",
+		.data		= &rds_ib_sysctl_max_batch_wrs,
+		.maxlen         = sizeof(unsigned long),
+		.mode           = 0644,
+		.proc_handler   = proc_doulongvec_minmax,
+		.extra1		= &rds_ib_sysctl_max_batch_wr_min,
+		.extra2		= &rds_ib_sysctl_max_batch_wr_max,
+	},
 	{
 		.procname       = "max_recv_allocation",
 		.data		= &rds_ib_sysctl_max_recv_allocation,
@@ -61,16 +61,44 @@ struct fl_flow_mask_range {
 struct fl_flow_mask {
 	struct fl_flow_key key;
 	struct fl_flow_mask_range range;
-	struct rcu_head	rcu;
+	struct rhashtable ht;
+	struct rhashtable_params filter_ht_params;
+	struct flow_dissector dissector;
+	unsigned int refcnt;
+	struct list_head list;
+	union {
+		struct work_struct work;
+		struct rcu_head	rcu;
+	};
 };
 
-struct cls_fl_head {
-	struct rhashtable ht;
-	struct fl_flow_mask mask;
+/* Exact-match cache in front of the mask walk, in the spirit of a hardware
+ * megaflow cache.  An entry records the outcome of a full walk for one
+ * dissected flow, keyed on the union of all fields any installed mask
+ * consults, and is only trusted while its generation matches the head's.
+ * The generation is bumped on every filter or mask change.
+ */
+struct fl_cache_dissector {
 	struct flow_dissector dissector;
-	bool mask_assigned;
+	struct rcu_head rcu;
+};
+
+struct fl_cache_entry {
+	struct rhash_head ht_node;
+	struct fl_flow_key key;
+	u32 gen;
+	struct cls_fl_filter *f;
+	struct rcu_head rcu;
+};
+
+struct cls_fl_head {
+	struct list_head masks;
+	unsigned int masks_cnt;
+	struct fl_cache_dissector __rcu *cache_dissector;
+	struct rhashtable cache_ht;
+	atomic_t cache_count;
+	u32 cache_gen;
 	struct list_head filters;
-	struct rhashtable_params ht_params;
 	union {
 		struct work_struct work;
 		struct rcu_head	rcu;
@@ -79,6 +107,7 @@ struct cls_fl_head {
 };
 
 struct cls_fl_filter {
+	struct fl_flow_mask *mask;
 	struct rhash_head ht_node;
 	struct fl_flow_key mkey;
 	struct tcf_exts exts;
@@ -140,41 +169,158 @@ static void fl_clear_masked_range(struct fl_flow_key *key,
 	memset(fl_key_get_start(key, mask), 0, fl_mask_range(mask));
 }
 
-static struct cls_fl_filter *fl_lookup(struct cls_fl_head *head,
+static struct cls_fl_filter *fl_lookup(struct fl_flow_mask *mask,
 				       struct fl_flow_key *mkey)
 {
-	return rhashtable_lookup_fast(&head->ht,
-				      fl_key_get_start(mkey, &head->mask),
-				      head->ht_params);
+	return rhashtable_lookup_fast(&mask->ht,
+				      fl_key_get_start(mkey, mask),
+				      mask->filter_ht_params);
+}
+
+#define FL_CACHE_MAX_ENTRIES	8192
+
+static const struct rhashtable_params fl_cache_ht_params = {
+	.key_offset = offsetof(struct fl_cache_entry, key),
+	.key_len = sizeof(struct fl_flow_key),
+	.head_offset = offsetof(struct fl_cache_entry, ht_node),
+	.automatic_shrinking = true,
+};
+
+static void fl_cache_insert(struct cls_fl_head *head, struct fl_flow_key *key,
+			    struct cls_fl_filter *f, u32 gen)
+{
+	struct fl_cache_entry *e;
+
+	if (atomic_inc_return(&head->cache_count) > FL_CACHE_MAX_ENTRIES)
+		goto out_dec;
+
+	e = kmalloc(sizeof(*e), GFP_ATOMIC);
+	if (!e)
+		goto out_dec;
+
+	memcpy(&e->key, key, sizeof(e->key));
+	e->f = f;
+	/* @gen was sampled before the mask walk, so a change racing with us
+	 * has already made (or will make) this entry fail the generation
+	 * check instead of serving a stale result.
+	 */
+	e->gen = gen;
+	if (rhashtable_lookup_insert_fast(&head->cache_ht, &e->ht_node,
+					  fl_cache_ht_params)) {
+		kfree(e);
+		goto out_dec;
+	}
+	return;
+
+out_dec:
+	atomic_dec(&head->cache_count);
+}
+
+/* Invalidate the exact cache after a filter or mask change.  Bumping the
+ * generation takes effect immediately for lookups; the walk below reclaims
+ * the stale entries.  Called under rtnl.
+ */
+static void fl_cache_flush(struct cls_fl_head *head)
+{
+	struct rhashtable_iter iter;
+	struct fl_cache_entry *e;
+	u32 gen = head->cache_gen + 1;
+
+	/* Order the rule update before the new generation, paired with the
+	 * read barrier in fl_classify().
+	 */
+	smp_wmb();
+	WRITE_ONCE(head->cache_gen, gen);
+
+	rhashtable_walk_enter(&head->cache_ht, &iter);
+	rhashtable_walk_start(&iter);
+	while ((e = rhashtable_walk_next(&iter))) {
+		if (IS_ERR(e))
+			continue;
+		if (e->gen == gen)
+			continue;
+		if (!rhashtable_remove_fast(&head->cache_ht, &e->ht_node,
+					    fl_cache_ht_params)) {
+			atomic_dec(&head->cache_count);
+			kfree_rcu(e, rcu);
+		}
+	}
+	rhashtable_walk_stop(&iter);
+	rhashtable_walk_exit(&iter);
+}
+
+static void fl_cache_free_ent(void *ptr, void *arg)
+{
+	kfree(ptr);
 }
 
 static int fl_classify(struct sk_buff *skb, const struct tcf_proto *tp,
 		       struct tcf_result *res)
 {
 	struct cls_fl_head *head = rcu_dereference_bh(tp->root);
+	struct fl_cache_dissector *cd;
+	struct fl_flow_mask *mask;
 	struct cls_fl_filter *f;
 	struct fl_flow_key skb_key;
 	struct fl_flow_key skb_mkey;
+	u32 gen = 0;
 
-	if (!atomic_read(&head->ht.nelems))
+	if (list_empty(&head->masks))
 		return -1;
 
-	fl_clear_masked_range(&skb_key, &head->mask);
-
-	skb_key.indev_ifindex = skb->skb_iif;
-	/* skb_flow_dissect() does not set n_proto in case an unknown protocol,
-	 * so do it rather here.
+	/* With more than one mask installed, dissect once with the union of
+	 * all consulted fields and try the exact cache before walking the
+	 * masks; the per-mask masked keys are then derived from the union
+	 * key without re-dissecting.
 	 */
-	skb_key.basic.n_proto = skb->protocol;
-	skb_flow_dissect_tunnel_info(skb, &head->dissector, &skb_key);
-	skb_flow_dissect(skb, &head->dissector, &skb_key, 0);
+	cd = rcu_dereference_bh(head->cache_dissector);
+	if (cd) {
+		struct fl_cache_entry *e;
+
+		gen = READ_ONCE(head->cache_gen);
+		smp_rmb();
+
+		memset(&skb_key, 0, sizeof(skb_key));
+		skb_key.indev_ifindex = skb->skb_iif;
+		/* skb_flow_dissect() does not set n_proto in case an unknown
+		 * protocol, so do it rather here.
+		 */
+		skb_key.basic.n_proto = skb->protocol;
+		skb_flow_dissect_tunnel_info(skb, &cd->dissector, &skb_key);
+		skb_flow_dissect(skb, &cd->dissector, &skb_key, 0);
+
+		e = rhashtable_lookup_fast(&head->cache_ht, &skb_key,
+					   fl_cache_ht_params);
+		if (e && e->gen == gen) {
+			f = e->f;
+			*res = f->res;
+			return tcf_exts_exec(skb, &f->exts, res);
+		}
+	}
 
-	fl_set_masked_key(&skb_mkey, &skb_key, &head->mask);
+	list_for_each_entry_rcu(mask, &head->masks, list) {
+		if (!cd) {
+			fl_clear_masked_range(&skb_key, mask);
+
+			skb_key.indev_ifindex = skb->skb_iif;
+			/* skb_flow_dissect() does not set n_proto in case an
+			 * unknown protocol, so do it rather here.
+			 */
+			skb_key.basic.n_proto = skb->protocol;
+			skb_flow_dissect_tunnel_info(skb, &mask->dissector,
+						     &skb_key);
+			skb_flow_dissect(skb, &mask->dissector, &skb_key, 0);
+		}
 
-	f = fl_lookup(head, &skb_mkey);
-	if (f && !tc_skip_sw(f->flags)) {
-		*res = f->res;
-		return tcf_exts_exec(skb, &f->exts, res);
+		fl_set_masked_key(&skb_mkey, &skb_key, mask);
+
+		f = fl_lookup(mask, &skb_mkey);
+		if (f && !tc_skip_sw(f->flags)) {
+			if (cd)
+				fl_cache_insert(head, &skb_key, f, gen);
+			*res = f->res;
+			return tcf_exts_exec(skb, &f->exts, res);
+		}
 	}
 	return -1;
 }
@@ -182,11 +328,19 @@ static int fl_classify(struct sk_buff *skb, const struct tcf_proto *tp,
 static int fl_init(struct tcf_proto *tp)
 {
 	struct cls_fl_head *head;
+	int err;
 
 	head = kzalloc(sizeof(*head), GFP_KERNEL);
 	if (!head)
 		return -ENOBUFS;
 
+	err = rhashtable_init(&head->cache_ht, &fl_cache_ht_params);
+	if (err) {
+		kfree(head);
+		return err;
+	}
+
+	INIT_LIST_HEAD_RCU(&head->masks);
 	INIT_LIST_HEAD_RCU(&head->filters);
 	rcu_assign_pointer(tp->root, head);
 	idr_init(&head->handle_idr);
@@ -283,6 +437,8 @@ static void fl_hw_update_stats(struct tcf_proto *tp, struct cls_fl_filter *f)
 			 &cls_flower, false);
 }
 
+static void fl_mask_put(struct cls_fl_head *head, struct fl_flow_mask *mask);
+
 static void __fl_delete(struct tcf_proto *tp, struct cls_fl_filter *f,
 			struct netlink_ext_ack *extack)
 {
@@ -290,6 +446,7 @@ static void __fl_delete(struct tcf_proto *tp, struct cls_fl_filter *f,
 
 	idr_remove(&head->handle_idr, f->handle);
 	list_del_rcu(&f->list);
+	fl_mask_put(head, f->mask);
 	if (!tc_skip_hw(f->flags))
 		fl_hw_destroy_filter(tp, f, extack);
 	tcf_unbind_filter(tp, &f->res);
@@ -303,8 +460,11 @@ static void fl_destroy_sleepable(struct work_struct *work)
 {
 	struct cls_fl_head *head = container_of(work, struct cls_fl_head,
 						work);
-	if (head->mask_assigned)
-		rhashtable_destroy(&head->ht);
+	struct fl_cache_dissector *cd;
+
+	rhashtable_free_and_destroy(&head->cache_ht, fl_cache_free_ent, NULL);
+	cd = rcu_dereference_protected(head->cache_dissector, 1);
+	kfree(cd);
 	kfree(head);
 	module_put(THIS_MODULE);
 }
@@ -728,14 +888,13 @@ static const struct rhashtable_params fl_ht_params = {
 	.automatic_shrinking = true,
 };
 
-static int fl_init_hashtable(struct cls_fl_head *head,
-			     struct fl_flow_mask *mask)
+static int fl_init_mask_hashtable(struct fl_flow_mask *mask)
 {
-	head->ht_params = fl_ht_params;
-	head->ht_params.key_len = fl_mask_range(mask);
-	head->ht_params.key_offset += mask->range.start;
+	mask->filter_ht_params = fl_ht_params;
+	mask->filter_ht_params.key_len = fl_mask_range(mask);
+	mask->filter_ht_params.key_offset += mask->range.start;
 
-	return rhashtable_init(&head->ht, &head->ht_params);
+	return rhashtable_init(&mask->ht, &mask->filter_ht_params);
 }
 
 #define FL_KEY_MEMBER_OFFSET(member) offsetof(struct fl_flow_key, member)
@@ -758,73 +917,169 @@ static int fl_init_hashtable(struct cls_fl_head *head,
 			FL_KEY_SET(keys, cnt, id, member);			\
 	} while(0);
 
-static void fl_init_dissector(struct cls_fl_head *head,
-			      struct fl_flow_mask *mask)
+static void fl_init_dissector(struct flow_dissector *dissector,
+			      struct fl_flow_key *mask_key)
 {
 	struct flow_dissector_key keys[FLOW_DISSECTOR_KEY_MAX];
 	size_t cnt = 0;
 
 	FL_KEY_SET(keys, cnt, FLOW_DISSECTOR_KEY_CONTROL, control);
 	FL_KEY_SET(keys, cnt, FLOW_DISSECTOR_KEY_BASIC, basic);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ETH_ADDRS, eth);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_IPV4_ADDRS, ipv4);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_IPV6_ADDRS, ipv6);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_PORTS, tp);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_IP, ip);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_TCP, tcp);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ICMP, icmp);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ARP, arp);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_MPLS, mpls);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_VLAN, vlan);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ENC_KEYID, enc_key_id);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ENC_IPV4_ADDRS, enc_ipv4);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ENC_IPV6_ADDRS, enc_ipv6);
-	if (FL_KEY_IS_MASKED(&mask->key, enc_ipv4) ||
-	    FL_KEY_IS_MASKED(&mask->key, enc_ipv6))
+	if (FL_KEY_IS_MASKED(mask_key, enc_ipv4) ||
+	    FL_KEY_IS_MASKED(mask_key, enc_ipv6))
 		FL_KEY_SET(keys, cnt, FLOW_DISSECTOR_KEY_ENC_CONTROL,
 			   enc_control);
-	FL_KEY_SET_IF_MASKED(&mask->key, keys, cnt,
+	FL_KEY_SET_IF_MASKED(mask_key, keys, cnt,
 			     FLOW_DISSECTOR_KEY_ENC_PORTS, enc_tp);
 
-	skb_flow_dissector_init(&head->dissector, keys, cnt);
+	skb_flow_dissector_init(dissector, keys, cnt);
 }
 
-static int fl_check_assign_mask(struct cls_fl_head *head,
-				struct fl_flow_mask *mask)
+/* Rebuild the dissector covering the union of all fields any installed mask
+ * consults, used to build the exact cache key.  With at most one mask there
+ * is nothing to gain over the plain per-mask lookup, so the cache dissector
+ * is dropped and fl_classify() bypasses the cache entirely.
+ */
+static int fl_rebuild_cache_dissector(struct cls_fl_head *head)
 {
-	int err;
+	struct fl_cache_dissector *cd = NULL, *old;
 
-	if (head->mask_assigned) {
-		if (!fl_mask_eq(&head->mask, mask))
-			return -EINVAL;
-		else
-			return 0;
+	if (head->masks_cnt > 1) {
+		struct fl_flow_key ukey;
+		struct fl_flow_mask *m;
+		u8 *ubytes = (u8 *)&ukey;
+		size_t i;
+
+		cd = kzalloc(sizeof(*cd), GFP_KERNEL);
+		if (!cd)
+			return -ENOMEM;
+
+		memset(&ukey, 0, sizeof(ukey));
+		list_for_each_entry(m, &head->masks, list) {
+			const u8 *mbytes = (const u8 *)&m->key;
+
+			for (i = 0; i < sizeof(ukey); i++)
+				ubytes[i] |= mbytes[i];
+		}
+		fl_init_dissector(&cd->dissector, &ukey);
 	}
 
-	/* Mask is not assigned yet. So assign it and init hashtable
-	 * according to that.
+	old = rtnl_dereference(head->cache_dissector);
+	rcu_assign_pointer(head->cache_dissector, cd);
+	if (old)
+		kfree_rcu(old, rcu);
+	return 0;
+}
+
+static void fl_mask_destroy_work(struct work_struct *work)
+{
+	struct fl_flow_mask *mask = container_of(work, struct fl_flow_mask,
+						 work);
+
+	rhashtable_destroy(&mask->ht);
+	kfree(mask);
+}
+
+static void fl_mask_destroy(struct rcu_head *rcu)
+{
+	struct fl_flow_mask *mask = container_of(rcu, struct fl_flow_mask, rcu);
+
+	INIT_WORK(&mask->work, fl_mask_destroy_work);
+	tcf_queue_work(&mask->work);
+}
+
+static void fl_mask_put(struct cls_fl_head *head, struct fl_flow_mask *mask)
+{
+	if (--mask->refcnt)
+		return;
+
+	list_del_rcu(&mask->list);
+	head->masks_cnt--;
+	/* On failure the old union dissector is kept; it covers a superset
+	 * of the remaining fields, which only costs cache hit rate.
 	 */
-	err = fl_init_hashtable(head, mask);
-	if (err)
-		return err;
-	memcpy(&head->mask, mask, sizeof(head->mask));
-	head->mask_assigned = true;
+	fl_rebuild_cache_dissector(head);
+	call_rcu(&mask->rcu, fl_mask_destroy);
+}
+
+static struct fl_flow_mask *fl_create_new_mask(struct cls_fl_head *head,
+					       struct fl_flow_mask *mask)
+{
+	struct fl_flow_mask *newmask;
+	int err;
+
+	newmask = kzalloc(sizeof(*newmask), GFP_KERNEL);
+	if (!newmask)
+		return ERR_PTR(-ENOMEM);
 
-	fl_init_dissector(head, mask);
+	memcpy(&newmask->key, &mask->key, sizeof(newmask->key));
+	newmask->range = mask->range;
 
+	err = fl_init_mask_hashtable(newmask);
+	if (err) {
+		kfree(newmask);
+		return ERR_PTR(err);
+	}
+	fl_init_dissector(&newmask->dissector, &newmask->key);
+
+	list_add_tail_rcu(&newmask->list, &head->masks);
+	head->masks_cnt++;
+
+	err = fl_rebuild_cache_dissector(head);
+	if (err) {
+		list_del_rcu(&newmask->list);
+		head->masks_cnt--;
+		call_rcu(&newmask->rcu, fl_mask_destroy);
+		return ERR_PTR(err);
+	}
+
+	return newmask;
+}
+
+static int fl_check_assign_mask(struct cls_fl_head *head,
+				struct cls_fl_filter *fnew,
+				struct fl_flow_mask *mask)
+{
+	struct fl_flow_mask *m;
+
+	list_for_each_entry(m, &head->masks, list) {
+		if (fl_mask_eq(m, mask))
+			goto found;
+	}
+
+	m = fl_create_new_mask(head, mask);
+	if (IS_ERR(m))
+		return PTR_ERR(m);
+
+found:
+	m->refcnt++;
+	fnew->mask = m;
 	return 0;
 }
 
@@ -921,30 +1176,30 @@ static int fl_change(struct net *net, struct sk_buff *in_skb,
 	if (err)
 		goto errout_idr;
 
-	err = fl_check_assign_mask(head, &mask);
+	err = fl_check_assign_mask(head, fnew, &mask);
 	if (err)
 		goto errout_idr;
 
 	if (!tc_skip_sw(fnew->flags)) {
-		if (!fold && fl_lookup(head, &fnew->mkey)) {
+		if (!fold && fl_lookup(fnew->mask, &fnew->mkey)) {
 			err = -EEXIST;
-			goto errout_idr;
+			goto errout_mask;
 		}
 
-		err = rhashtable_insert_fast(&head->ht, &fnew->ht_node,
-					     head->ht_params);
+		err = rhashtable_insert_fast(&fnew->mask->ht, &fnew->ht_node,
+					     fnew->mask->filter_ht_params);
 		if (err)
-			goto errout_idr;
+			goto errout_mask;
 	}
 
 	if (!tc_skip_hw(fnew->flags)) {
 		err = fl_hw_replace_filter(tp,
-					   &head->dissector,
-					   &mask.key,
+					   &fnew->mask->dissector,
+					   &fnew->mask->key,
 					   fnew,
 					   extack);
 		if (err)
-			goto errout_idr;
+			goto errout_mask;
 	}
 
 	if (!tc_in_hw(fnew->flags))
@@ -952,8 +1207,9 @@ static int fl_change(struct net *net, struct sk_buff *in_skb,
 
 	if (fold) {
 		if (!tc_skip_sw(fold->flags))
-			rhashtable_remove_fast(&head->ht, &fold->ht_node,
-					       head->ht_params);
+			rhashtable_remove_fast(&fold->mask->ht,
+					       &fold->ht_node,
+					       fold->mask->filter_ht_params);
 		if (!tc_skip_hw(fold->flags))
 			fl_hw_destroy_filter(tp, fold, NULL);
 	}
@@ -963,6 +1219,7 @@ static int fl_change(struct net *net, struct sk_buff *in_skb,
 	if (fold) {
 		idr_replace(&head->handle_idr, fnew, fnew->handle);
 		list_replace_rcu(&fold->list, &fnew->list);
+		fl_mask_put(head, fold->mask);
 		tcf_unbind_filter(tp, &fold->res);
 		tcf_exts_get_net(&fold->exts);
 		call_rcu(&fold->rcu, fl_destroy_filter);
@@ -970,9 +1227,12 @@ static int fl_change(struct net *net, struct sk_buff *in_skb,
 		list_add_tail_rcu(&fnew->list, &head->filters);
 	}
 
+	fl_cache_flush(head);
 	kfree(tb);
 	return 0;
 
+errout_mask:
+	fl_mask_put(head, fnew->mask);
 errout_idr:
 	if (fnew->handle)
 		idr_remove(&head->handle_idr, fnew->handle);
@@ -991,9 +1251,10 @@ static int fl_delete(struct tcf_proto *tp, void *arg, bool *last,
 	struct cls_fl_filter *f = arg;
 
 	if (!tc_skip_sw(f->flags))
-		rhashtable_remove_fast(&head->ht, &f->ht_node,
-				       head->ht_params);
+		rhashtable_remove_fast(&f->mask->ht, &f->ht_node,
+				       f->mask->filter_ht_params);
 	__fl_delete(tp, f, extack);
+	fl_cache_flush(head);
 	*last = list_empty(&head->filters);
 	return 0;
 }
@@ -1144,7 +1405,6 @@ static int fl_dump_key_flags(struct sk_buff *skb, u32 flags_key, u32 flags_mask)
 static int fl_dump(struct net *net, struct tcf_proto *tp, void *fh,
 		   struct sk_buff *skb, struct tcmsg *t)
 {
-	struct cls_fl_head *head = rtnl_dereference(tp->root);
 	struct cls_fl_filter *f = fh;
 	struct nlattr *nest;
 	struct fl_flow_key *key, *mask;
@@ -1163,7 +1423,7 @@ static int fl_dump(struct net *net, struct tcf_proto *tp, void *fh,
 		goto nla_put_failure;
 
 	key = &f->key;
-	mask = &head->mask.key;
+	mask = &f->mask->key;
 
 	if (mask->indev_ifindex) {
 		struct net_device *dev;
@@ -1123,7 +1123,8 @@ static bool some_qdisc_is_busy(struct net_device *dev)
 		q = dev_queue->qdisc_sleeping;
 
 		if (q->flags & TCQ_F_NOLOCK) {
-			val = test_bit(__QDISC_STATE_SCHED, &q->state);
+			val = test_bit(__QDISC_STATE_SCHED, &q->state) ||
+			      test_bit(__QDISC_STATE_RUNNING, &q->state);
 		} else {
 			root_lock = qdisc_lock(q);
 			spin_lock_bh(root_lock);
@@ -168,6 +168,11 @@ struct htb_sched {
 	struct qdisc_skb_head	direct_queue;
 	long			direct_pkts;
 
+	/* already shaped and charged skbs, bulk-dequeued from a leaf
+	 * ahead of time; see htb_dequeue_tree()
+	 */
+	struct qdisc_skb_head	bulk_queue;
+
 	struct qdisc_watchdog	watchdog;
 
 	s64			now;	/* cached dequeue time */
@@ -890,19 +895,36 @@ next:
 	} while (cl != start);
 
 	if (likely(skb != NULL)) {
+		enum htb_cmode cmode = cl->cmode;
+		struct sk_buff *nskb;
+
 		bstats_update(&cl->bstats, skb);
 		cl->un.leaf.deficit[level] -= qdisc_pkt_len(skb);
+		htb_charge_class(q, cl, level, skb);
+
+		/* Bulk dequeue: while the class keeps both its deficit and
+		 * its mode, pull more packets from the same leaf into
+		 * bulk_queue so that the following invocations are served
+		 * without another tree walk.  Bounded by the DRR quantum,
+		 * and the packets are charged here, as if they had been
+		 * dequeued one by one.
+		 */
+		while (cl->un.leaf.deficit[level] >= 0 &&
+		       cl->cmode == cmode &&
+		       (nskb = cl->un.leaf.q->dequeue(cl->un.leaf.q)) != NULL) {
+			bstats_update(&cl->bstats, nskb);
+			cl->un.leaf.deficit[level] -= qdisc_pkt_len(nskb);
+			htb_charge_class(q, cl, level, nskb);
+			htb_enqueue_tail(nskb, q->watchdog.qdisc, &q->bulk_queue);
+		}
+
 		if (cl->un.leaf.deficit[level] < 0) {
 			cl->un.leaf.deficit[level] += cl->quantum;
 			htb_next_rb_node(level ? &cl->parent->un.inner.clprio[prio].ptr :
 						 &q->hlevel[0].hprio[prio].ptr);
 		}
-		/* this used to be after charge_class but this constelation
-		 * gives us slightly better performance
-		 */
 		if (!cl->un.leaf.q->q.qlen)
 			htb_deactivate(q, cl);
-		htb_charge_class(q, cl, level, skb);
 	}
 	return skb;
 }
@@ -917,6 +939,9 @@ static struct sk_buff *htb_dequeue(struct Qdisc *sch)
 
 	/* try to dequeue direct packets as high prio (!) to minimize cpu work */
 	skb = __qdisc_dequeue_head(&q->direct_queue);
+	/* then whatever a previous tree walk has bulk-dequeued already */
+	if (!skb)
+		skb = __qdisc_dequeue_head(&q->bulk_queue);
 	if (skb != NULL) {
 ok:
 		qdisc_bstats_update(sch, skb);
@@ -989,6 +1014,7 @@ static void htb_reset(struct Qdisc *sch)
 	}
 	qdisc_watchdog_cancel(&q->watchdog);
 	__qdisc_reset_queue(&q->direct_queue);
+	__qdisc_reset_queue(&q->bulk_queue);
 	sch->q.qlen = 0;
 	sch->qstats.backlog = 0;
 	memset(q->hlevel, 0, sizeof(q->hlevel));
@@ -1054,6 +1080,7 @@ static int htb_init(struct Qdisc *sch, struct nlattr *opt,
 		INIT_LIST_HEAD(q->drops + i);
 
 	qdisc_skb_head_init(&q->direct_queue);
+	qdisc_skb_head_init(&q->bulk_queue);
 
 	if (tb[TCA_HTB_DIRECT_QLEN])
 		q->direct_qlen = nla_get_u32(tb[TCA_HTB_DIRECT_QLEN]);
@@ -1272,6 +1299,7 @@ static void htb_destroy(struct Qdisc *sch)
 	}
 	qdisc_class_hash_destroy(&q->clhash);
 	__qdisc_reset_queue(&q->direct_queue);
+	__qdisc_reset_queue(&q->bulk_queue);
 }
 
 static int htb_delete(struct Qdisc *sch, unsigned long arg)
@@ -257,6 +257,9 @@ static struct sctp_association *sctp_association_init(
 		asoc->peer.ipv6_address = 1;
 	INIT_LIST_HEAD(&asoc->asocs);
 
+	spin_lock_init(&asoc->chunk_cache_lock);
+	INIT_LIST_HEAD(&asoc->chunk_cache);
+
 	asoc->default_stream = sp->default_stream;
 	asoc->default_ppid = sp->default_ppid;
 	asoc->default_flags = sp->default_flags;
@@ -431,6 +434,8 @@ static void sctp_association_destroy(struct sctp_association *asoc)
 
 	WARN_ON(atomic_read(&asoc->rmem_alloc));
 
+	sctp_chunk_cache_purge(asoc);
+
 	kfree(asoc);
 	SCTP_DBG_OBJCNT_DEC(assoc);
 }
@@ -62,7 +62,7 @@ static void sctp_datamsg_init(struct sctp_datamsg *msg)
 static struct sctp_datamsg *sctp_datamsg_new(gfp_t gfp)
 {
 	struct sctp_datamsg *msg;
-	msg = kmalloc(sizeof(struct sctp_datamsg), gfp);
+	msg = kmem_cache_alloc(sctp_datamsg_cachep, gfp);
 	if (msg) {
 		sctp_datamsg_init(msg);
 		SCTP_DBG_OBJCNT_INC(datamsg);
@@ -131,7 +131,7 @@ static void sctp_datamsg_destroy(struct sctp_datamsg *msg)
 	}
 
 	SCTP_DBG_OBJCNT_DEC(datamsg);
-	kfree(msg);
+	kmem_cache_free(sctp_datamsg_cachep, msg);
 }
 
 /* Hold a reference. */
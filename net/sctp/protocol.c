@@ -74,6 +74,7 @@ static struct sctp_af *sctp_af_v4_specific;
 static struct sctp_af *sctp_af_v6_specific;
 
 struct kmem_cache *sctp_chunk_cachep __read_mostly;
+struct kmem_cache *sctp_datamsg_cachep __read_mostly;
 struct kmem_cache *sctp_bucket_cachep __read_mostly;
 
 long sysctl_sctp_mem[3];
@@ -1385,6 +1386,13 @@ static __init int sctp_init(void)
 	if (!sctp_chunk_cachep)
 		goto err_chunk_cachep;
 
+	sctp_datamsg_cachep = kmem_cache_create("sctp_datamsg",
+						sizeof(struct sctp_datamsg),
+						0, SLAB_HWCACHE_ALIGN,
+						NULL);
+	if (!sctp_datamsg_cachep)
+		goto err_datamsg_cachep;
+
 	status = percpu_counter_init(&sctp_sockets_allocated, 0, GFP_KERNEL);
 	if (status)
 		goto err_percpu_counter_init;
@@ -1553,6 +1561,8 @@ err_thash_alloc:
 err_ehash_alloc:
 	percpu_counter_destroy(&sctp_sockets_allocated);
 err_percpu_counter_init:
+	kmem_cache_destroy(sctp_datamsg_cachep);
+err_datamsg_cachep:
 	kmem_cache_destroy(sctp_chunk_cachep);
 err_chunk_cachep:
 	kmem_cache_destroy(sctp_bucket_cachep);
@@ -1594,6 +1604,7 @@ static __exit void sctp_exit(void)
 
 	rcu_barrier(); /* Wait for completion of call_rcu()'s */
 
+	kmem_cache_destroy(sctp_datamsg_cachep);
 	kmem_cache_destroy(sctp_chunk_cachep);
 	kmem_cache_destroy(sctp_bucket_cachep);
 }
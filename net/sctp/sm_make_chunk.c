@@ -1309,6 +1309,64 @@ struct sctp_chunk *sctp_make_auth(const struct sctp_association *asoc)
  * 2nd Level Abstractions
  ********************************************************************/
 
+/* Number of released chunk structures kept around per association for
+ * reuse.
+ */
+#define SCTP_CHUNK_CACHE_MAX	64
+
+/* Pick up a recycled chunk structure, if one is available. */
+static struct sctp_chunk *sctp_chunk_cache_get(struct sctp_association *asoc)
+{
+	struct sctp_chunk *chunk = NULL;
+
+	spin_lock_bh(&asoc->chunk_cache_lock);
+	if (asoc->chunk_cache_len) {
+		chunk = list_first_entry(&asoc->chunk_cache,
+					 struct sctp_chunk, list);
+		list_del(&chunk->list);
+		asoc->chunk_cache_len--;
+	}
+	spin_unlock_bh(&asoc->chunk_cache_lock);
+
+	if (chunk)
+		memset(chunk, 0, sizeof(*chunk));
+
+	return chunk;
+}
+
+/* Keep a released chunk structure for reuse on this association, unless
+ * the pool is already full.
+ */
+static bool sctp_chunk_cache_put(struct sctp_association *asoc,
+				 struct sctp_chunk *chunk)
+{
+	bool cached = false;
+
+	spin_lock_bh(&asoc->chunk_cache_lock);
+	if (asoc->chunk_cache_len < SCTP_CHUNK_CACHE_MAX) {
+		list_add(&chunk->list, &asoc->chunk_cache);
+		asoc->chunk_cache_len++;
+		cached = true;
+	}
+	spin_unlock_bh(&asoc->chunk_cache_lock);
+
+	return cached;
+}
+
+/* Return the recycled chunk structures to the slab.  Called when the
+ * association is destroyed.
+ */
+void sctp_chunk_cache_purge(struct sctp_association *asoc)
+{
+	struct sctp_chunk *chunk, *tmp;
+
+	list_for_each_entry_safe(chunk, tmp, &asoc->chunk_cache, list) {
+		list_del(&chunk->list);
+		kmem_cache_free(sctp_chunk_cachep, chunk);
+	}
+	asoc->chunk_cache_len = 0;
+}
+
 /* Turn an skb into a chunk.
  * FIXME: Eventually move the structure directly inside the skb->cb[].
  *
@@ -1323,9 +1381,12 @@ struct sctp_chunk *sctp_chunkify(struct sk_buff *skb,
 				 const struct sctp_association *asoc,
 				 struct sock *sk, gfp_t gfp)
 {
-	struct sctp_chunk *retval;
+	struct sctp_chunk *retval = NULL;
 
-	retval = kmem_cache_zalloc(sctp_chunk_cachep, gfp);
+	if (asoc)
+		retval = sctp_chunk_cache_get((struct sctp_association *)asoc);
+	if (!retval)
+		retval = kmem_cache_zalloc(sctp_chunk_cachep, gfp);
 
 	if (!retval)
 		goto nodata;
@@ -1444,14 +1505,27 @@ static struct sctp_chunk *sctp_make_control(const struct sctp_association *asoc,
 /* Release the memory occupied by a chunk.  */
 static void sctp_chunk_destroy(struct sctp_chunk *chunk)
 {
+	struct sctp_association *asoc = chunk->asoc;
+
 	BUG_ON(!list_empty(&chunk->list));
 	list_del_init(&chunk->transmitted_list);
 
+	/* Freeing the skb below may drop the last reference on the
+	 * association, so keep it alive until the chunk structure has
+	 * been parked in its recycle pool.
+	 */
+	if (asoc)
+		sctp_association_hold(asoc);
+
 	consume_skb(chunk->skb);
 	consume_skb(chunk->auth_chunk);
 
 	SCTP_DBG_OBJCNT_DEC(chunk);
-	kmem_cache_free(sctp_chunk_cachep, chunk);
+	if (!asoc || !sctp_chunk_cache_put(asoc, chunk))
+		kmem_cache_free(sctp_chunk_cachep, chunk);
+
+	if (asoc)
+		sctp_association_put(asoc);
 }
 
 /* Possibly, free the chunk.  */
@@ -451,6 +451,14 @@ static int smc_connect_rdma(struct smc_sock *smc)
 	}
 	link = &smc->conn.lgr->lnk[SMC_SINGLE_LINK];
 
+	/* The registered connection keeps the link group alive, and
+	 * buffer slot and rtoken handling are locked on their own, so
+	 * repeat connections to a known peer need not serialize on the
+	 * link group setup any longer.
+	 */
+	if (local_contact == SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
+
 	smc_conn_save_peer_info(smc, &aclc);
 
 	/* create send buffer and rmb */
@@ -509,7 +517,8 @@ static int smc_connect_rdma(struct smc_sock *smc)
 			goto decline_rdma_unlock;
 	}
 
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 	smc_tx_init(smc);
 
 out_connected:
@@ -522,7 +531,8 @@ out_connected:
 decline_rdma_unlock:
 	if (local_contact == SMC_FIRST_CONTACT)
 		smc_lgr_forget(smc->conn.lgr);
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 	smc_conn_free(&smc->conn);
 decline_rdma:
 	/* RDMA setup failed, switch back to TCP */
@@ -537,7 +547,8 @@ decline_rdma:
 out_err_unlock:
 	if (local_contact == SMC_FIRST_CONTACT)
 		smc_lgr_forget(smc->conn.lgr);
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 	smc_conn_free(&smc->conn);
 out_err:
 	if (smc->sk.sk_state == SMC_INIT)
@@ -838,6 +849,14 @@ static void smc_listen_work(struct work_struct *work)
 	}
 	link = &new_smc->conn.lgr->lnk[SMC_SINGLE_LINK];
 
+	/* As on the client side, connections reusing a link group can
+	 * proceed without the global lock; in particular the CLC
+	 * accept/confirm exchange of parallel setups to the same peer
+	 * is no longer serialized.
+	 */
+	if (local_contact == SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
+
 	/* create send buffer and rmb */
 	rc = smc_buf_create(new_smc);
 	if (rc) {
@@ -900,7 +919,8 @@ static void smc_listen_work(struct work_struct *work)
 	}
 
 	smc_tx_init(new_smc);
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 
 out_connected:
 	sk_refcnt_debug_inc(newsmcsk);
@@ -923,7 +943,8 @@ enqueue:
 decline_rdma_unlock:
 	if (local_contact == SMC_FIRST_CONTACT)
 		smc_lgr_forget(new_smc->conn.lgr);
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 decline_rdma:
 	/* RDMA setup failed, switch back to TCP */
 	smc_conn_free(&new_smc->conn);
@@ -937,7 +958,8 @@ decline_rdma:
 out_err_unlock:
 	if (local_contact == SMC_FIRST_CONTACT)
 		smc_lgr_forget(new_smc->conn.lgr);
-	mutex_unlock(&smc_create_lgr_pending);
+	if (local_contact != SMC_REUSE_CONTACT)
+		mutex_unlock(&smc_create_lgr_pending);
 out_err:
 	if (newsmcsk->sk_state == SMC_INIT)
 		sock_put(&new_smc->sk); /* passive closing */
@@ -166,6 +166,7 @@ static int smc_lgr_create(struct smc_sock *smc, __be32 peer_in_addr,
 	lgr->vlan_id = vlan_id;
 	rwlock_init(&lgr->sndbufs_lock);
 	rwlock_init(&lgr->rmbs_lock);
+	spin_lock_init(&lgr->rtokens_lock);
 	for (i = 0; i < SMC_RMBE_SIZES; i++) {
 		INIT_LIST_HEAD(&lgr->sndbufs[i]);
 		INIT_LIST_HEAD(&lgr->rmbs[i]);
@@ -441,6 +442,10 @@ int smc_conn_create(struct smc_sock *smc, __be32 peer_in_addr,
 			conn->lgr = lgr;
 			smc_lgr_register_conn(conn); /* add smc conn to lgr */
 			write_unlock_bh(&lgr->conns_lock);
+			/* peers reconnecting at a high rate find their
+			 * link group at the head of the list
+			 */
+			list_move(&lgr->list, &smc_lgr_list.list);
 			break;
 		}
 		write_unlock_bh(&lgr->conns_lock);
@@ -708,18 +713,24 @@ int smc_rmb_rtoken_handling(struct smc_connection *conn,
 	u32 rkey = ntohl(clc->rmb_rkey);
 	int i;
 
+	/* connections reusing a link group are no longer serialized by
+	 * smc_create_lgr_pending, so guard the rtoken array here
+	 */
+	spin_lock(&lgr->rtokens_lock);
 	for (i = 0; i < SMC_RMBS_PER_LGR_MAX; i++) {
 		if ((lgr->rtokens[i][SMC_SINGLE_LINK].rkey == rkey) &&
 		    (lgr->rtokens[i][SMC_SINGLE_LINK].dma_addr == dma_addr) &&
 		    test_bit(i, lgr->rtokens_used_mask)) {
 			conn->rtoken_idx = i;
-			return 0;
+			goto out;
 		}
 	}
 	conn->rtoken_idx = smc_rmb_reserve_rtoken_idx(lgr);
 	if (conn->rtoken_idx < 0)
-		return conn->rtoken_idx;
+		goto out;
 	lgr->rtokens[conn->rtoken_idx][SMC_SINGLE_LINK].rkey = rkey;
 	lgr->rtokens[conn->rtoken_idx][SMC_SINGLE_LINK].dma_addr = dma_addr;
-	return 0;
+out:
+	spin_unlock(&lgr->rtokens_lock);
+	return conn->rtoken_idx < 0 ? conn->rtoken_idx : 0;
 }
@@ -140,6 +140,9 @@ struct smc_link_group {
 	struct smc_rtoken	rtokens[SMC_RMBS_PER_LGR_MAX]
 				       [SMC_LINKS_PER_LGR_MAX];
 						/* remote addr/key pairs */
+	spinlock_t		rtokens_lock;	/* protects rtokens and
+						 * rtokens_used_mask
+						 */
 	unsigned long		rtokens_used_mask[BITS_TO_LONGS(
 							SMC_RMBS_PER_LGR_MAX)];
 						/* used rtoken elements */
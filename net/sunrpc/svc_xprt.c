@@ -375,6 +375,34 @@ static bool svc_xprt_has_something_to_do(struct svc_xprt *xprt)
 	return false;
 }
 
+/* Cap on wakeups in flight per pool. A burst of ready transports wakes
+ * at most this many threads directly; each thread that dequeues wakes a
+ * successor while work remains, so a deep queue still spins up the
+ * whole pool, just without the thundering herd.
+ */
+#define SVC_POOL_MAX_WAKING	4
+
+/* Wake one idle thread in @pool, if there is one. Returns the thread
+ * woken, or NULL if all of them are busy.
+ */
+static struct svc_rqst *svc_pool_wake_idle_thread(struct svc_pool *pool)
+{
+	struct svc_rqst	*rqstp;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
+		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
+			continue;
+		atomic_inc(&pool->sp_waking);
+		atomic_long_inc(&pool->sp_stats.threads_woken);
+		wake_up_process(rqstp->rq_task);
+		rcu_read_unlock();
+		return rqstp;
+	}
+	rcu_read_unlock();
+	return NULL;
+}
+
 void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 {
 	struct svc_pool *pool;
@@ -401,24 +429,17 @@ void svc_xprt_do_enqueue(struct svc_xprt *xprt)
 	atomic_long_inc(&pool->sp_stats.packets);
 
 	dprintk("svc: transport %p put into queue\n", xprt);
-	spin_lock_bh(&pool->sp_lock);
-	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
+	llist_add(&xprt->xpt_ready_node, &pool->sp_ready);
 	pool->sp_stats.sockets_queued++;
-	spin_unlock_bh(&pool->sp_lock);
 
-	/* find a thread for this xprt */
-	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
-		atomic_long_inc(&pool->sp_stats.threads_woken);
-		wake_up_process(rqstp->rq_task);
-		goto out_unlock;
+	/* find a thread for this xprt, unless enough wakeups are
+	 * already in flight to pick it up
+	 */
+	if (atomic_read(&pool->sp_waking) < SVC_POOL_MAX_WAKING) {
+		rqstp = svc_pool_wake_idle_thread(pool);
+		if (!rqstp)
+			set_bit(SP_CONGESTED, &pool->sp_flags);
 	}
-	set_bit(SP_CONGESTED, &pool->sp_flags);
-	rqstp = NULL;
-out_unlock:
-	rcu_read_unlock();
 	put_cpu();
 out:
 	trace_svc_xprt_do_enqueue(xprt, rqstp);
@@ -438,6 +459,29 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 }
 EXPORT_SYMBOL_GPL(svc_xprt_enqueue);
 
+/*
+ * Move lock-free enqueued transports onto sp_sockets, oldest first.
+ * Caller must hold pool->sp_lock, which keeps the splice atomic wrt
+ * other consumers and so preserves FIFO order.
+ */
+static void svc_pool_splice_ready(struct svc_pool *pool)
+{
+	struct llist_node *node;
+	struct svc_xprt *xprt;
+
+	node = llist_reverse_order(llist_del_all(&pool->sp_ready));
+	while (node) {
+		xprt = llist_entry(node, struct svc_xprt, xpt_ready_node);
+		node = node->next;
+		list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
+	}
+}
+
+static bool svc_pool_has_ready(struct svc_pool *pool)
+{
+	return !list_empty(&pool->sp_sockets) || !llist_empty(&pool->sp_ready);
+}
+
 /*
  * Dequeue the first transport, if there is one.
  */
@@ -445,10 +489,11 @@ static struct svc_xprt *svc_xprt_dequeue(struct svc_pool *pool)
 {
 	struct svc_xprt	*xprt = NULL;
 
-	if (list_empty(&pool->sp_sockets))
+	if (!svc_pool_has_ready(pool))
 		goto out;
 
 	spin_lock_bh(&pool->sp_lock);
+	svc_pool_splice_ready(pool);
 	if (likely(!list_empty(&pool->sp_sockets))) {
 		xprt = list_first_entry(&pool->sp_sockets,
 					struct svc_xprt, xpt_ready);
@@ -464,6 +509,29 @@ out:
 	return xprt;
 }
 
+/*
+ * Nothing pending in our own pool; try to take a ready transport off
+ * another pool's queue. Stolen work runs off-node, but that beats
+ * leaving a whole NUMA node's threads idle while another one drowns.
+ */
+static struct svc_xprt *svc_xprt_steal(struct svc_rqst *rqstp)
+{
+	struct svc_serv *serv = rqstp->rq_server;
+	struct svc_pool *pool = rqstp->rq_pool;
+	struct svc_xprt *xprt;
+	unsigned int i;
+
+	for (i = 1; i < serv->sv_nrpools; i++) {
+		struct svc_pool *victim;
+
+		victim = &serv->sv_pools[(pool->sp_id + i) % serv->sv_nrpools];
+		xprt = svc_xprt_dequeue(victim);
+		if (xprt)
+			return xprt;
+	}
+	return NULL;
+}
+
 /**
  * svc_reserve - change the space reserved for the reply to a request.
  * @rqstp:  The request in question
@@ -671,7 +739,7 @@ rqst_should_sleep(struct svc_rqst *rqstp)
 		return false;
 
 	/* was a socket queued? */
-	if (!list_empty(&pool->sp_sockets))
+	if (svc_pool_has_ready(pool))
 		return false;
 
 	/* are we shutting down? */
@@ -697,6 +765,10 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	if (rqstp->rq_xprt)
 		goto out_found;
 
+	rqstp->rq_xprt = svc_xprt_steal(rqstp);
+	if (rqstp->rq_xprt)
+		goto out_found;
+
 	/*
 	 * We have to be able to interrupt this wait
 	 * to bring down the daemons ...
@@ -716,7 +788,14 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 
 	set_bit(RQ_BUSY, &rqstp->rq_flags);
 	smp_mb__after_atomic();
+	/* Retire our wakeup credit; over-retiring someone else's just
+	 * means an extra wakeup, never a lost one.
+	 */
+	atomic_dec_if_positive(&pool->sp_waking);
 	rqstp->rq_xprt = svc_xprt_dequeue(pool);
+	if (rqstp->rq_xprt)
+		goto out_found;
+	rqstp->rq_xprt = svc_xprt_steal(rqstp);
 	if (rqstp->rq_xprt)
 		goto out_found;
 
@@ -727,6 +806,12 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 		return ERR_PTR(-EINTR);
 	return ERR_PTR(-EAGAIN);
 out_found:
+	/* Wake-ahead: if more transports are ready, get a successor
+	 * spinning up while we process this one.
+	 */
+	if (svc_pool_has_ready(pool) &&
+	    atomic_read(&pool->sp_waking) < SVC_POOL_MAX_WAKING)
+		svc_pool_wake_idle_thread(pool);
 	/* Normally we will wait up to 5 seconds for any required
 	 * cache information to be provided.
 	 */
@@ -1078,6 +1163,7 @@ static struct svc_xprt *svc_dequeue_net(struct svc_serv *serv, struct net *net)
 		pool = &serv->sv_pools[i];
 
 		spin_lock_bh(&pool->sp_lock);
+		svc_pool_splice_ready(pool);
 		list_for_each_entry_safe(xprt, tmp, &pool->sp_sockets, xpt_ready) {
 			if (xprt->xpt_net != net)
 				continue;
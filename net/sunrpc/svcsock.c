@@ -180,6 +180,20 @@ static void svc_set_cmsg_data(struct svc_rqst *rqstp, struct cmsghdr *cmh)
 	}
 }
 
+/*
+ * Send one part of the reply. When the transport supports locked sends
+ * the caller holds the socket lock across the whole reply, so use the
+ * _locked variant; otherwise each call takes the lock itself.
+ */
+static int svc_sendpage(struct socket *sock, bool locked, struct page *page,
+			unsigned long offset, size_t size, int flags)
+{
+	if (locked)
+		return kernel_sendpage_locked(sock->sk, page, offset, size,
+					      flags);
+	return kernel_sendpage(sock, page, offset, size, flags);
+}
+
 /*
  * send routine intended to be shared by the fore- and back-channel
  */
@@ -193,15 +207,24 @@ int svc_send_common(struct socket *sock, struct xdr_buf *xdr,
 	size_t		base = xdr->page_base;
 	unsigned int	pglen = xdr->page_len;
 	unsigned int	flags = MSG_MORE | MSG_SENDPAGE_NOTLAST;
+	bool		locked = sock->ops->sendpage_locked != NULL;
 	int		slen;
 	int		len = 0;
 
 	slen = xdr->len;
 
+	/*
+	 * A large READ reply spans many pages, and taking the socket lock
+	 * once per page is a measurable cost on fast links. Push the whole
+	 * scatter list under a single lock where the protocol allows it.
+	 */
+	if (locked)
+		lock_sock(sock->sk);
+
 	/* send head */
 	if (slen == xdr->head[0].iov_len)
 		flags = 0;
-	len = kernel_sendpage(sock, headpage, headoffset,
+	len = svc_sendpage(sock, locked, headpage, headoffset,
 				  xdr->head[0].iov_len, flags);
 	if (len != xdr->head[0].iov_len)
 		goto out;
@@ -214,7 +237,7 @@ int svc_send_common(struct socket *sock, struct xdr_buf *xdr,
 	while (pglen > 0) {
 		if (slen == size)
 			flags = 0;
-		result = kernel_sendpage(sock, *ppage, base, size, flags);
+		result = svc_sendpage(sock, locked, *ppage, base, size, flags);
 		if (result > 0)
 			len += result;
 		if (result != size)
@@ -228,13 +251,15 @@ int svc_send_common(struct socket *sock, struct xdr_buf *xdr,
 
 	/* send tail */
 	if (xdr->tail[0].iov_len) {
-		result = kernel_sendpage(sock, tailpage, tailoffset,
+		result = svc_sendpage(sock, locked, tailpage, tailoffset,
 				   xdr->tail[0].iov_len, 0);
 		if (result > 0)
 			len += result;
 	}
 
 out:
+	if (locked)
+		release_sock(sock->sk);
 	return len;
 }
 
@@ -1277,7 +1277,11 @@ int tipc_link_rcv(struct tipc_link *l, struct sk_buff *skb,
 		l->stats.recv_pkts++;
 		if (!tipc_data_input(l, skb, l->inputq))
 			rc |= tipc_link_input(l, skb, l->inputq);
-		if (unlikely(++l->rcv_unacked >= TIPC_MIN_LINK_WIN))
+		/* Batch acks: on wide links half a window worth of
+		 * packets may pass between two state messages
+		 */
+		if (unlikely(++l->rcv_unacked >= max_t(u32, TIPC_MIN_LINK_WIN,
+						       l->window / 2)))
 			rc |= tipc_link_build_state_msg(l, xmitq);
 		if (unlikely(rc & ~TIPC_LINK_SND_STATE))
 			break;
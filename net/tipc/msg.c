@@ -359,6 +359,129 @@ error:
 	return rc;
 }
 
+/* tipc_msg_append_pages(): pin user memory and hang it off the fragment
+ * as page frags instead of copying it into the buffer
+ */
+static int tipc_msg_append_pages(struct sk_buff *skb, struct iov_iter *from,
+				 int length)
+{
+	int frag = skb_shinfo(skb)->nr_frags;
+
+	while (length && iov_iter_count(from)) {
+		struct page *pages[MAX_SKB_FRAGS];
+		size_t start;
+		ssize_t copied;
+		int n = 0;
+
+		if (frag == MAX_SKB_FRAGS)
+			return -EMSGSIZE;
+
+		copied = iov_iter_get_pages(from, pages, length,
+					    MAX_SKB_FRAGS - frag, &start);
+		if (copied < 0)
+			return -EFAULT;
+
+		iov_iter_advance(from, copied);
+		length -= copied;
+		skb->len += copied;
+		skb->data_len += copied;
+		skb->truesize += PAGE_ALIGN(copied + start);
+
+		while (copied) {
+			int size = min_t(int, copied, PAGE_SIZE - start);
+
+			skb_fill_page_desc(skb, frag++, pages[n], start, size);
+			start = 0;
+			copied -= size;
+			n++;
+		}
+	}
+	return length ? -EFAULT : 0;
+}
+
+/**
+ * tipc_msg_build_zc - create fragment chain referencing pinned user pages
+ * @sk: socket sending the message
+ * @mhdr: message header, to be prepended to data
+ * @m: user message
+ * @dsz: total length of user data
+ * @pktmax: max packet size that can be used
+ * @list: buffer or chain of buffers to be returned to caller
+ * @uarg: zerocopy completion context, or NULL to force the copying path
+ *
+ * Like tipc_msg_build(), but the fragments carry only the headers in
+ * their linear part and reference the pinned user pages for the data.
+ * The copying path is also taken for messages that do not need
+ * fragmentation, or when the caller cleared @uarg->zerocopy; the
+ * completion notification then reports that the data was copied.
+ *
+ * Returns message data size or errno: -ENOMEM, -EFAULT, -EMSGSIZE
+ */
+int tipc_msg_build_zc(struct sock *sk, struct tipc_msg *mhdr, struct msghdr *m,
+		      int dsz, int pktmax, struct sk_buff_head *list,
+		      struct ubuf_info *uarg)
+{
+	int mhsz = msg_hdr_sz(mhdr);
+	int hsz = INT_H_SIZE + mhsz;
+	int msz = mhsz + dsz;
+	struct tipc_msg pkthdr;
+	struct sk_buff *skb;
+	int drem = dsz;
+	int pktno = 1;
+	int rc;
+
+	if (!uarg || !uarg->zerocopy || msz <= pktmax ||
+	    pktmax - INT_H_SIZE > (MAX_SKB_FRAGS - 1) * (int)PAGE_SIZE) {
+		if (uarg)
+			uarg->zerocopy = 0;
+		return tipc_msg_build(mhdr, m, 0, dsz, pktmax, list);
+	}
+
+	msg_set_size(mhdr, msz);
+
+	/* Prepare reusable fragment header */
+	tipc_msg_init(msg_prevnode(mhdr), &pkthdr, MSG_FRAGMENTER,
+		      FIRST_FRAGMENT, INT_H_SIZE, msg_destnode(mhdr));
+	msg_set_importance(&pkthdr, msg_importance(mhdr));
+
+	do {
+		int data = min(drem, pktmax - hsz);
+
+		if (pktno > 1)
+			msg_set_type(&pkthdr, data == drem ?
+				     LAST_FRAGMENT : FRAGMENT);
+		msg_set_size(&pkthdr, hsz + data);
+		msg_set_fragm_no(&pkthdr, pktno);
+
+		skb = tipc_buf_acquire(hsz, GFP_KERNEL);
+		if (!skb) {
+			rc = -ENOMEM;
+			goto error;
+		}
+		skb_orphan(skb);
+		__skb_queue_tail(list, skb);
+		skb_copy_to_linear_data(skb, &pkthdr, INT_H_SIZE);
+		if (pktno == 1)
+			skb_copy_to_linear_data_offset(skb, INT_H_SIZE,
+						       mhdr, mhsz);
+		rc = tipc_msg_append_pages(skb, &m->msg_iter, data);
+		if (rc)
+			goto error;
+		skb_zcopy_set(skb, uarg);
+
+		drem -= data;
+		pktno++;
+		/* only the first fragment carries the message header */
+		hsz = INT_H_SIZE;
+	} while (drem);
+
+	return dsz;
+error:
+	__skb_queue_purge(list);
+	__skb_queue_head_init(list);
+	return rc;
+}
+
 /**
  * tipc_msg_bundle(): Append contents of a buffer to tail of an existing one
  * @skb: the buffer to append to ("bundle")
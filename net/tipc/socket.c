@@ -1279,6 +1279,7 @@ static int __tipc_sendmsg(struct socket *sock, struct msghdr *m, size_t dlen)
 	bool syn = !tipc_sk_type_connectionless(sk);
 	struct tipc_group *grp = tsk->group;
 	struct tipc_msg *hdr = &tsk->phdr;
+	struct ubuf_info *uarg = NULL;
 	struct tipc_name_seq *seq;
 	struct sk_buff_head pkts;
 	u32 type, inst, domain;
@@ -1360,11 +1361,25 @@ static int __tipc_sendmsg(struct socket *sock, struct msghdr *m, size_t dlen)
 	if (unlikely(rc))
 		return rc;
 
+	if (unlikely(m->msg_flags & MSG_ZEROCOPY) && dlen &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = sock_zerocopy_alloc(sk, dlen);
+		if (unlikely(!uarg))
+			return -ENOBUFS;
+		/* node local delivery may keep the buffers queued for
+		 * arbitrarily long; always copy for it
+		 */
+		if (dnode == tsk_own_node(tsk))
+			uarg->zerocopy = 0;
+	}
+
 	skb_queue_head_init(&pkts);
 	mtu = tipc_node_get_mtu(net, dnode, tsk->portid);
-	rc = tipc_msg_build(hdr, m, 0, dlen, mtu, &pkts);
-	if (unlikely(rc != dlen))
+	rc = tipc_msg_build_zc(sk, hdr, m, dlen, mtu, &pkts, uarg);
+	if (unlikely(rc != dlen)) {
+		sock_zerocopy_put_abort(uarg);
 		return rc;
+	}
 
 	rc = tipc_node_xmit(net, &pkts, dnode, tsk->portid);
 	if (unlikely(rc == -ELINKCONG)) {
@@ -1373,6 +1388,11 @@ static int __tipc_sendmsg(struct socket *sock, struct msghdr *m, size_t dlen)
 		rc = 0;
 	}
 
+	/* The notification fires once the link layer has released all
+	 * fragments, i.e. when the peer has acked them
+	 */
+	sock_zerocopy_put(uarg);
+
 	if (unlikely(syn && !rc))
 		tipc_set_sk_state(sk, TIPC_CONNECTING);
 
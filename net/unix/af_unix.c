@@ -118,6 +118,7 @@
 #include <linux/security.h>
 #include <linux/freezer.h>
 #include <linux/file.h>
+#include <linux/llist.h>
 
 struct hlist_head unix_socket_table[2 * UNIX_HASH_SIZE];
 EXPORT_SYMBOL_GPL(unix_socket_table);
@@ -194,7 +195,47 @@ static inline int unix_may_send(struct sock *sk, struct sock *osk)
 
 static inline int unix_recvq_full(struct sock const *sk)
 {
-	return skb_queue_len(&sk->sk_receive_queue) > sk->sk_max_ack_backlog;
+	return skb_queue_len(&sk->sk_receive_queue) +
+	       atomic_read(&unix_sk(sk)->dgram_backlog_len) >
+	       sk->sk_max_ack_backlog;
+}
+
+/* Datagram senders enqueue into a lock-free backlog instead of taking
+ * sk_receive_queue.lock, which collapses under many-to-one fan-in.
+ * Whoever wants to look at the receive queue splices the backlog into
+ * it first. llist_del_all() runs under the queue lock, so a splice is
+ * atomic wrt other splicers and per-sender ordering is preserved.
+ */
+static struct sk_buff *unix_backlog_node_to_skb(struct llist_node *node)
+{
+	struct unix_skb_parms *parms;
+
+	parms = llist_entry(node, struct unix_skb_parms, llnode);
+	return container_of((void *)parms, struct sk_buff, cb);
+}
+
+static void unix_dgram_splice_backlog(struct sock *sk)
+{
+	struct unix_sock *u = unix_sk(sk);
+	struct llist_node *node;
+	struct sk_buff *skb;
+	int spliced = 0;
+
+	if (llist_empty(&u->dgram_backlog))
+		return;
+
+	spin_lock(&sk->sk_receive_queue.lock);
+	node = llist_reverse_order(llist_del_all(&u->dgram_backlog));
+	while (node) {
+		skb = unix_backlog_node_to_skb(node);
+		node = node->next;
+		__skb_queue_tail(&sk->sk_receive_queue, skb);
+		spliced++;
+	}
+	spin_unlock(&sk->sk_receive_queue.lock);
+
+	if (spliced)
+		atomic_sub(spliced, &u->dgram_backlog_len);
 }
 
 struct sock *unix_peer_get(struct sock *s)
@@ -466,6 +507,7 @@ static void unix_write_space(struct sock *sk)
  * may receive messages only from that peer. */
 static void unix_dgram_disconnected(struct sock *sk, struct sock *other)
 {
+	unix_dgram_splice_backlog(sk);
 	if (!skb_queue_empty(&sk->sk_receive_queue)) {
 		skb_queue_purge(&sk->sk_receive_queue);
 		wake_up_interruptible_all(&unix_sk(sk)->peer_wait);
@@ -485,6 +527,7 @@ static void unix_sock_destructor(struct sock *sk)
 {
 	struct unix_sock *u = unix_sk(sk);
 
+	unix_dgram_splice_backlog(sk);
 	skb_queue_purge(&sk->sk_receive_queue);
 
 	WARN_ON(refcount_read(&sk->sk_wmem_alloc));
@@ -552,6 +595,7 @@ static void unix_release_sock(struct sock *sk, int embrion)
 
 	/* Try to flush out this socket. Throw out buffers at least */
 
+	unix_dgram_splice_backlog(sk);
 	while ((skb = skb_dequeue(&sk->sk_receive_queue)) != NULL) {
 		if (state == TCP_LISTEN)
 			unix_release_sock(skb->sk, 1);
@@ -784,6 +828,8 @@ static struct sock *unix_create1(struct net *net, struct socket *sock, int kern)
 	mutex_init(&u->bindlock); /* single task binding lock */
 	init_waitqueue_head(&u->peer_wait);
 	init_waitqueue_func_entry(&u->peer_wake, unix_dgram_peer_wake_relay);
+	init_llist_head(&u->dgram_backlog);
+	atomic_set(&u->dgram_backlog_len, 0);
 	unix_insert_socket(unix_sockets_unbound(sk), sk);
 out:
 	if (sk == NULL)
@@ -1804,7 +1850,17 @@ restart_locked:
 	if (sock_flag(other, SOCK_RCVTSTAMP))
 		__net_timestamp(skb);
 	maybe_add_creds(skb, sock, other);
-	skb_queue_tail(&other->sk_receive_queue, skb);
+	if (UNIXCB(skb).fp) {
+		/* The garbage collector scans sk_receive_queue for
+		 * in-flight fds; don't let fd-bearing skbs hide in the
+		 * backlog.
+		 */
+		unix_dgram_splice_backlog(other);
+		skb_queue_tail(&other->sk_receive_queue, skb);
+	} else {
+		atomic_inc(&unix_sk(other)->dgram_backlog_len);
+		llist_add(&UNIXCB(skb).llnode, &unix_sk(other)->dgram_backlog);
+	}
 	unix_state_unlock(other);
 	other->sk_data_ready(other);
 	sock_put(other);
@@ -2084,6 +2140,60 @@ static void unix_copy_addr(struct msghdr *msg, struct sock *sk)
 	}
 }
 
+/* Like __skb_wait_for_more_packets(), except that fresh datagrams may
+ * be sitting in the sender backlog rather than in sk_receive_queue, so
+ * the sleep condition has to look at both.
+ */
+static int unix_dgram_wait_for_packets(struct sock *sk, int *err,
+				       long *timeo_p,
+				       const struct sk_buff *last)
+{
+	struct unix_sock *u = unix_sk(sk);
+	int error;
+	DEFINE_WAIT(wait);
+
+	prepare_to_wait_exclusive(sk_sleep(sk), &wait, TASK_INTERRUPTIBLE);
+
+	/* Socket errors? */
+	error = sock_error(sk);
+	if (error)
+		goto out_err;
+
+	if (sk->sk_receive_queue.prev != last ||
+	    !llist_empty(&u->dgram_backlog))
+		goto out;
+
+	/* Socket shut down? */
+	if (sk->sk_shutdown & RCV_SHUTDOWN)
+		goto out_noerr;
+
+	/* Sequenced packets can come disconnected.
+	 * If so we report the problem
+	 */
+	error = -ENOTCONN;
+	if (sk->sk_type == SOCK_SEQPACKET && sk->sk_state != TCP_ESTABLISHED)
+		goto out_err;
+
+	/* handle signals */
+	if (signal_pending(current))
+		goto interrupted;
+
+	error = 0;
+	*timeo_p = schedule_timeout(*timeo_p);
+out:
+	finish_wait(sk_sleep(sk), &wait);
+	return error;
+interrupted:
+	error = sock_intr_errno(*timeo_p);
+out_err:
+	*err = error;
+	goto out;
+out_noerr:
+	*err = 0;
+	error = 1;
+	goto out;
+}
+
 static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 			      size_t size, int flags)
 {
@@ -2104,6 +2214,7 @@ static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 	do {
 		mutex_lock(&u->iolock);
 
+		unix_dgram_splice_backlog(sk);
 		skip = sk_peek_offset(sk, flags);
 		skb = __skb_try_recv_datagram(sk, flags, NULL, &peeked, &skip,
 					      &err, &last);
@@ -2115,7 +2226,7 @@ static int unix_dgram_recvmsg(struct socket *sock, struct msghdr *msg,
 		if (err != -EAGAIN)
 			break;
 	} while (timeo &&
-		 !__skb_wait_for_more_packets(sk, &err, &timeo, last));
+		 !unix_dgram_wait_for_packets(sk, &err, &timeo, last));
 
 	if (!skb) { /* implies iolock unlocked */
 		unix_state_lock(sk);
@@ -2553,6 +2664,7 @@ long unix_inq_len(struct sock *sk)
 	if (sk->sk_state == TCP_LISTEN)
 		return -EINVAL;
 
+	unix_dgram_splice_backlog(sk);
 	spin_lock(&sk->sk_receive_queue.lock);
 	if (sk->sk_type == SOCK_STREAM ||
 	    sk->sk_type == SOCK_SEQPACKET) {
@@ -2696,7 +2808,8 @@ static __poll_t unix_dgram_poll(struct file *file, struct socket *sock,
 		mask |= EPOLLHUP;
 
 	/* readable? */
-	if (!skb_queue_empty(&sk->sk_receive_queue))
+	if (!skb_queue_empty(&sk->sk_receive_queue) ||
+	    !llist_empty(&unix_sk(sk)->dgram_backlog))
 		mask |= EPOLLIN | EPOLLRDNORM;
 
 	/* Connection-based need to check for termination and startup */
@@ -47,6 +47,23 @@ struct xfrm_flo {
 
 static DEFINE_PER_CPU(struct xfrm_dst *, xfrm_last_dst);
 static struct work_struct *xfrm_pcpu_work __read_mostly;
+
+/* Per-CPU cache of the last resolved policy lookup, so established
+ * flows skip the bydst chain walks in xfrm_policy_lookup_bytype().
+ * Entries hold a policy reference, dropped on overwrite or flush, and
+ * are invalidated wholesale by bumping xfrm_policy_flow_genid whenever
+ * a policy is linked or unlinked.
+ */
+struct xfrm_flow_cache_entry {
+	struct net		*net;
+	struct flowi		fl;
+	u32			genid;
+	u16			family;
+	u8			dir;
+	struct xfrm_policy	*pol;
+};
+static DEFINE_PER_CPU(struct xfrm_flow_cache_entry, xfrm_flow_cache);
+static atomic_t xfrm_policy_flow_genid;
 static DEFINE_SPINLOCK(xfrm_policy_afinfo_lock);
 static struct xfrm_policy_afinfo const __rcu *xfrm_policy_afinfo[AF_INET6 + 1]
 						__read_mostly;
@@ -787,6 +804,7 @@ int xfrm_policy_insert(int dir, struct xfrm_policy *policy, int excl)
 	policy->curlft.use_time = 0;
 	if (!mod_timer(&policy->timer, jiffies + HZ))
 		xfrm_pol_hold(policy);
+	atomic_inc(&xfrm_policy_flow_genid);
 	spin_unlock_bh(&net->xfrm.xfrm_policy_lock);
 
 	if (delpol)
@@ -1158,6 +1176,51 @@ xfrm_policy_lookup(struct net *net, const struct flowi *fl, u16 family, u8 dir)
 	return xfrm_policy_lookup_bytype(net, XFRM_POLICY_TYPE_MAIN, fl, family, dir);
 }
 
+/* Front the chain walks with the per-CPU flow cache. Only successful
+ * lookups are cached; the genid snapshot is taken before the walk so a
+ * concurrent policy update can at worst cause one extra miss.
+ */
+static struct xfrm_policy *
+xfrm_policy_lookup_cached(struct net *net, const struct flowi *fl,
+			  u16 family, u8 dir)
+{
+	u32 genid = atomic_read(&xfrm_policy_flow_genid);
+	struct xfrm_flow_cache_entry *cache;
+	struct xfrm_policy *pol, *old;
+
+	local_bh_disable();
+	cache = this_cpu_ptr(&xfrm_flow_cache);
+	if (cache->pol && cache->net == net && cache->genid == genid &&
+	    cache->family == family && cache->dir == dir &&
+	    !memcmp(&cache->fl, fl, sizeof(*fl))) {
+		pol = cache->pol;
+		xfrm_pol_hold(pol);
+		local_bh_enable();
+		return pol;
+	}
+	local_bh_enable();
+
+	pol = xfrm_policy_lookup(net, fl, family, dir);
+	if (!pol || IS_ERR(pol))
+		return pol;
+
+	xfrm_pol_hold(pol);
+	local_bh_disable();
+	cache = this_cpu_ptr(&xfrm_flow_cache);
+	old = cache->pol;
+	cache->net = net;
+	cache->fl = *fl;
+	cache->genid = genid;
+	cache->family = family;
+	cache->dir = dir;
+	cache->pol = pol;
+	local_bh_enable();
+	if (old)
+		xfrm_pol_put(old);
+
+	return pol;
+}
+
 static struct xfrm_policy *xfrm_sk_policy_lookup(const struct sock *sk, int dir,
 						 const struct flowi *fl, u16 family)
 {
@@ -1225,6 +1288,7 @@ static struct xfrm_policy *__xfrm_policy_unlink(struct xfrm_policy *pol,
 
 	list_del_init(&pol->walk.all);
 	net->xfrm.policy_count[dir]--;
+	atomic_inc(&xfrm_policy_flow_genid);
 
 	return pol;
 }
@@ -1724,11 +1788,18 @@ static void xfrm_last_dst_update(struct xfrm_dst *xdst, struct xfrm_dst *old)
 
 static void __xfrm_pcpu_work_fn(void)
 {
+	struct xfrm_flow_cache_entry *cache;
 	struct xfrm_dst *old;
 
 	old = this_cpu_read(xfrm_last_dst);
 	if (old && !xfrm_bundle_ok(old))
 		xfrm_last_dst_update(NULL, old);
+
+	cache = this_cpu_ptr(&xfrm_flow_cache);
+	if (cache->pol) {
+		xfrm_pol_put(cache->pol);
+		cache->pol = NULL;
+	}
 }
 
 static void xfrm_pcpu_work_fn(struct work_struct *work)
@@ -1752,7 +1823,8 @@ void xfrm_policy_cache_flush(void)
 	rcu_read_lock();
 	for_each_possible_cpu(cpu) {
 		old = per_cpu(xfrm_last_dst, cpu);
-		if (old && !xfrm_bundle_ok(old)) {
+		if ((old && !xfrm_bundle_ok(old)) ||
+		    per_cpu(xfrm_flow_cache, cpu).pol) {
 			if (smp_processor_id() == cpu) {
 				__xfrm_pcpu_work_fn();
 				continue;
@@ -1771,14 +1843,16 @@ void xfrm_policy_cache_flush(void)
 	get_online_cpus();
 
 	for_each_possible_cpu(cpu) {
-		bool bundle_release;
+		struct xfrm_flow_cache_entry *cache;
+		bool needs_release;
 
 		rcu_read_lock();
 		old = per_cpu(xfrm_last_dst, cpu);
-		bundle_release = old && !xfrm_bundle_ok(old);
+		needs_release = (old && !xfrm_bundle_ok(old)) ||
+				per_cpu(xfrm_flow_cache, cpu).pol;
 		rcu_read_unlock();
 
-		if (!bundle_release)
+		if (!needs_release)
 			continue;
 
 		if (cpu_online(cpu)) {
@@ -1792,6 +1866,11 @@ void xfrm_policy_cache_flush(void)
 			per_cpu(xfrm_last_dst, cpu) = NULL;
 			dst_release(&old->u.dst);
 		}
+		cache = &per_cpu(xfrm_flow_cache, cpu);
+		if (cache->pol) {
+			xfrm_pol_put(cache->pol);
+			cache->pol = NULL;
+		}
 		rcu_read_unlock();
 	}
 
@@ -2058,7 +2137,7 @@ xfrm_bundle_lookup(struct net *net, const struct flowi *fl, u16 family, u8 dir,
 	/* Resolve policies to use if we couldn't get them from
 	 * previous cache entry */
 	num_pols = 1;
-	pols[0] = xfrm_policy_lookup(net, fl, family, dir);
+	pols[0] = xfrm_policy_lookup_cached(net, fl, family, dir);
 	err = xfrm_expand_policies(fl, family, pols,
 					   &num_pols, &num_xfrms);
 	if (err < 0)
@@ -2431,7 +2510,7 @@ int __xfrm_policy_check(struct sock *sk, int dir, struct sk_buff *skb,
 	}
 
 	if (!pol)
-		pol = xfrm_policy_lookup(net, &fl, family, dir);
+		pol = xfrm_policy_lookup_cached(net, &fl, family, dir);
 
 	if (IS_ERR(pol)) {
 		XFRM_INC_STATS(net, LINUX_MIB_XFRMINPOLERROR);
@@ -0,0 +1 @@
+cmd_scripts/kconfig/zconf.tab.c := bison -oscripts/kconfig/zconf.tab.c -t -l scripts/kconfig/zconf.y
@@ -23,6 +23,9 @@
 #include <linux/skbuff.h>
 #include <linux/percpu.h>
 #include <linux/list.h>
+#include <linux/llist.h>
+#include <linux/sched.h>
+#include <linux/workqueue.h>
 #include <net/sock.h>
 #include <linux/un.h>
 #include <net/af_unix.h>
@@ -38,6 +41,8 @@
 #define AVC_DEF_CACHE_THRESHOLD		512
 #define AVC_CACHE_RECLAIM		16
 
+#define AVC_PCPU_SLOTS			32
+
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
 #define avc_cache_stats_incr(field)	this_cpu_inc(avc_cache_stats.field)
 #else
@@ -54,6 +59,7 @@ struct avc_entry {
 
 struct avc_node {
 	struct avc_entry	ae;
+	u32			epoch; /* avc_cache.epoch at insertion time */
 	struct hlist_node	list; /* anchored in avc_cache->slots[i] */
 	struct rcu_head		rhead;
 };
@@ -73,9 +79,32 @@ struct avc_cache {
 	spinlock_t		slots_lock[AVC_CACHE_SLOTS]; /* lock for writes */
 	atomic_t		lru_hint;	/* LRU hint for reclaim scan */
 	atomic_t		active_nodes;
+	atomic_t		epoch;		/* nodes from older epochs are stale */
 	u32			latest_notif;	/* latest revocation notification */
 };
 
+/*
+ * Small per-CPU front cache of plain (non-extended-permission) decisions,
+ * direct mapped by avc_hash().  Entries are only ever touched by their
+ * owning CPU, so lookup and fill need nothing stronger than compiler
+ * ordering against local interrupts; the seq field follows the usual
+ * seqcount protocol and is odd while a fill is in flight.  Invalidation
+ * is lazy: bumping avc_pcpu_gen makes every entry miss, no CPU is
+ * interrupted or walked.
+ */
+struct avc_pcpu_entry {
+	u32			seq;
+	u32			gen;	/* avc_pcpu_gen when filled */
+	u32			ssid;
+	u32			tsid;
+	u16			tclass;
+	struct av_decision	avd;
+};
+
+struct avc_pcpu_cache {
+	struct avc_pcpu_entry	entries[AVC_PCPU_SLOTS];
+};
+
 struct avc_callback_node {
 	int (*callback) (u32 event);
 	u32 events;
@@ -90,6 +119,9 @@ DEFINE_PER_CPU(struct avc_cache_stats, avc_cache_stats) = { 0 };
 #endif
 
 static struct avc_cache avc_cache;
+static DEFINE_PER_CPU(struct avc_pcpu_cache, avc_pcpu_cache);
+/* starts at 1 so that zero-initialized per-CPU entries never match */
+static atomic_t avc_pcpu_gen = ATOMIC_INIT(1);
 static struct avc_callback_node *avc_callbacks;
 static struct kmem_cache *avc_node_cachep;
 static struct kmem_cache *avc_xperms_data_cachep;
@@ -101,6 +133,85 @@ static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
 	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
 }
 
+static inline u32 avc_epoch(void)
+{
+	return (u32)atomic_read(&avc_cache.epoch);
+}
+
+static inline bool avc_node_stale(struct avc_node *node)
+{
+	return unlikely(node->epoch != avc_epoch());
+}
+
+/**
+ * avc_pcpu_lookup - Look up a decision in this CPU's front cache.
+ * @ssid: source security identifier
+ * @tsid: target security identifier
+ * @tclass: target security class
+ * @avd: access vector decision, filled in on a hit
+ *
+ * Returns true and copies the cached decision into @avd if this CPU
+ * holds a current entry for the triple, false otherwise.  Runs entirely
+ * on CPU-local data; a fill from interrupt context while we copy is
+ * caught by the seq recheck.
+ */
+static bool avc_pcpu_lookup(u32 ssid, u32 tsid, u16 tclass,
+			    struct av_decision *avd)
+{
+	struct avc_pcpu_entry *pe;
+	bool hit = false;
+	u32 seq;
+
+	pe = &get_cpu_ptr(&avc_pcpu_cache)->entries[avc_hash(ssid, tsid, tclass) &
+						    (AVC_PCPU_SLOTS - 1)];
+	seq = READ_ONCE(pe->seq);
+	if (seq & 1)
+		goto out;
+	barrier();
+	if (pe->gen != (u32)atomic_read(&avc_pcpu_gen) ||
+	    pe->ssid != ssid || pe->tsid != tsid || pe->tclass != tclass)
+		goto out;
+	memcpy(avd, &pe->avd, sizeof(*avd));
+	barrier();
+	hit = READ_ONCE(pe->seq) == seq;
+out:
+	put_cpu_ptr(&avc_pcpu_cache);
+	return hit;
+}
+
+/**
+ * avc_pcpu_fill - Store a decision in this CPU's front cache.
+ * @ssid: source security identifier
+ * @tsid: target security identifier
+ * @tclass: target security class
+ * @gen: avc_pcpu_gen sampled before the decision was obtained
+ * @avd: access vector decision
+ *
+ * @gen must be read before looking the decision up or computing it, so
+ * that an invalidation racing with us leaves an entry that is already
+ * stale instead of resurrecting a pre-flush decision.
+ */
+static void avc_pcpu_fill(u32 ssid, u32 tsid, u16 tclass, u32 gen,
+			  struct av_decision *avd)
+{
+	struct avc_pcpu_entry *pe;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	pe = &this_cpu_ptr(&avc_pcpu_cache)->entries[avc_hash(ssid, tsid, tclass) &
+						     (AVC_PCPU_SLOTS - 1)];
+	WRITE_ONCE(pe->seq, pe->seq + 1);
+	barrier();
+	pe->gen = gen;
+	pe->ssid = ssid;
+	pe->tsid = tsid;
+	pe->tclass = tclass;
+	memcpy(&pe->avd, avd, sizeof(pe->avd));
+	barrier();
+	WRITE_ONCE(pe->seq, pe->seq + 1);
+	local_irq_restore(flags);
+}
+
 /**
  * avc_dump_av - Display an access vector in human-readable form.
  * @tclass: target security class
@@ -184,6 +295,7 @@ void __init avc_init(void)
 	}
 	atomic_set(&avc_cache.active_nodes, 0);
 	atomic_set(&avc_cache.lru_hint, 0);
+	atomic_set(&avc_cache.epoch, 0);
 
 	avc_node_cachep = kmem_cache_create("avc_node", sizeof(struct avc_node),
 					0, SLAB_PANIC, NULL);
@@ -565,6 +677,7 @@ static void avc_node_populate(struct avc_node *node, u32 ssid, u32 tsid, u16 tcl
 	node->ae.ssid = ssid;
 	node->ae.tsid = tsid;
 	node->ae.tclass = tclass;
+	node->epoch = avc_epoch();
 	memcpy(&node->ae.avd, avd, sizeof(node->ae.avd));
 }
 
@@ -580,6 +693,10 @@ static inline struct avc_node *avc_search_node(u32 ssid, u32 tsid, u16 tclass)
 		if (ssid == node->ae.ssid &&
 		    tclass == node->ae.tclass &&
 		    tsid == node->ae.tsid) {
+			/* leftover from before avc_flush(), reclaimed by
+			 * the next insert into this slot */
+			if (avc_node_stale(node))
+				break;
 			ret = node;
 			break;
 		}
@@ -659,6 +776,7 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 				struct avc_xperms_node *xp_node)
 {
 	struct avc_node *pos, *node = NULL;
+	struct hlist_node *next;
 	int hvalue;
 	unsigned long flag;
 
@@ -682,7 +800,13 @@ static struct avc_node *avc_insert(u32 ssid, u32 tsid, u16 tclass,
 		lock = &avc_cache.slots_lock[hvalue];
 
 		spin_lock_irqsave(lock, flag);
-		hlist_for_each_entry(pos, head, list) {
+		hlist_for_each_entry_safe(pos, next, head, list) {
+			/* opportunistically reclaim what avc_flush() left
+			 * behind while we hold the slot lock anyway */
+			if (avc_node_stale(pos)) {
+				avc_node_delete(pos);
+				continue;
+			}
 			if (pos->ae.ssid == ssid &&
 			    pos->ae.tsid == tsid &&
 			    pos->ae.tclass == tclass) {
@@ -733,6 +857,81 @@ static void avc_audit_post_callback(struct audit_buffer *ab, void *a)
 	}
 }
 
+/*
+ * Audit records without caller-supplied audit data reference nothing
+ * that outlives the syscall, so their formatting - context lookups and
+ * permission-name expansion included - can be pushed off the hot path
+ * and done in batches from a work item.  Only the fields below are
+ * snapshotted at enqueue time.
+ */
+struct avc_deferred_audit {
+	struct llist_node llnode;
+	u32 ssid;
+	u32 tsid;
+	u16 tclass;
+	u32 audited;
+	u32 denied;
+	int result;
+	pid_t pid;
+	char comm[TASK_COMM_LEN];
+};
+
+static LLIST_HEAD(avc_deferred_audits);
+
+static void avc_deferred_audit_fn(struct work_struct *work)
+{
+	struct avc_deferred_audit *da, *tmp;
+	struct llist_node *list;
+
+	list = llist_del_all(&avc_deferred_audits);
+	list = llist_reverse_order(list);	/* oldest record first */
+
+	llist_for_each_entry_safe(da, tmp, list, llnode) {
+		struct audit_buffer *ab;
+
+		ab = audit_log_start(NULL, GFP_KERNEL, AUDIT_AVC);
+		if (ab) {
+			audit_log_format(ab, "avc:  %s ",
+					 da->denied ? "denied" : "granted");
+			avc_dump_av(ab, da->tclass, da->audited);
+			audit_log_format(ab, " for  pid=%d comm=", da->pid);
+			audit_log_untrustedstring(ab, da->comm);
+			audit_log_format(ab, " ");
+			avc_dump_query(ab, da->ssid, da->tsid, da->tclass);
+			if (da->denied)
+				audit_log_format(ab, " permissive=%u",
+						 da->result ? 0 : 1);
+			audit_log_end(ab);
+		}
+		kfree(da);
+	}
+}
+
+static DECLARE_WORK(avc_deferred_audit_work, avc_deferred_audit_fn);
+
+static int avc_defer_audit(u32 ssid, u32 tsid, u16 tclass,
+		u32 audited, u32 denied, int result)
+{
+	struct avc_deferred_audit *da;
+
+	da = kmalloc(sizeof(*da), GFP_ATOMIC | __GFP_NOWARN);
+	if (!da)
+		return -ENOMEM;
+
+	da->ssid = ssid;
+	da->tsid = tsid;
+	da->tclass = tclass;
+	da->audited = audited;
+	da->denied = denied;
+	da->result = result;
+	da->pid = task_tgid_nr(current);
+	memcpy(da->comm, current->comm, sizeof(da->comm));
+
+	llist_add(&da->llnode, &avc_deferred_audits);
+	schedule_work(&avc_deferred_audit_work);
+	return 0;
+}
+
 /* This is the slow part of avc audit with big stack footprint */
 noinline int slow_avc_audit(u32 ssid, u32 tsid, u16 tclass,
 		u32 requested, u32 audited, u32 denied, int result,
@@ -743,6 +942,10 @@ noinline int slow_avc_audit(u32 ssid, u32 tsid, u16 tclass,
 	struct selinux_audit_data sad;
 
 	if (!a) {
+		/* fall back to synchronous formatting under memory pressure */
+		if (!avc_defer_audit(ssid, tsid, tclass, audited, denied,
+				     result))
+			return 0;
 		a = &stack_data;
 		a->type = LSM_AUDIT_DATA_NONE;
 	}
@@ -842,7 +1045,8 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 		if (ssid == pos->ae.ssid &&
 		    tsid == pos->ae.tsid &&
 		    tclass == pos->ae.tclass &&
-		    seqno == pos->ae.avd.seqno){
+		    seqno == pos->ae.avd.seqno &&
+		    !avc_node_stale(pos)) {
 			orig = pos;
 			break;
 		}
@@ -895,6 +1099,8 @@ static int avc_update_node(u32 event, u32 perms, u8 driver, u8 xperm, u32 ssid,
 		break;
 	}
 	avc_node_replace(node, orig);
+	/* front-cache copies of the old decision must not mask the update */
+	atomic_inc(&avc_pcpu_gen);
 out_unlock:
 	spin_unlock_irqrestore(lock, flag);
 out:
@@ -902,9 +1108,27 @@ out:
 }
 
 /**
- * avc_flush - Flush the cache
+ * avc_flush - Invalidate the cache
+ *
+ * Bump the cache epoch so that every current entry is treated as a miss
+ * and reclaimed lazily on the next insert into its slot, instead of
+ * walking all slots and tearing the nodes down while other CPUs are
+ * busy refilling the cache.  The per-CPU front caches are invalidated
+ * the same way.
  */
 static void avc_flush(void)
+{
+	atomic_inc(&avc_cache.epoch);
+	atomic_inc(&avc_pcpu_gen);
+}
+
+/**
+ * avc_drop - Tear the cache down node by node.
+ *
+ * Only used when the AVC is being disabled; runtime invalidation goes
+ * through avc_flush() instead.
+ */
+static void avc_drop(void)
 {
 	struct hlist_head *head;
 	struct avc_node *node;
@@ -912,6 +1136,8 @@ static void avc_flush(void)
 	unsigned long flag;
 	int i;
 
+	avc_flush();
+
 	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
 		head = &avc_cache.slots[i];
 		lock = &avc_cache.slots_lock[i];
@@ -1100,22 +1326,28 @@ inline int avc_has_perm_noaudit(u32 ssid, u32 tsid,
 	struct avc_xperms_node xp_node;
 	int rc = 0;
 	u32 denied;
+	u32 gen;
 
 	BUG_ON(!requested);
 
-	rcu_read_lock();
-
-	node = avc_lookup(ssid, tsid, tclass);
-	if (unlikely(!node))
-		node = avc_compute_av(ssid, tsid, tclass, avd, &xp_node);
-	else
-		memcpy(avd, &node->ae.avd, sizeof(*avd));
+	gen = (u32)atomic_read(&avc_pcpu_gen);
+	if (likely(avc_pcpu_lookup(ssid, tsid, tclass, avd))) {
+		avc_cache_stats_incr(lookups);
+	} else {
+		rcu_read_lock();
+		node = avc_lookup(ssid, tsid, tclass);
+		if (unlikely(!node))
+			node = avc_compute_av(ssid, tsid, tclass, avd, &xp_node);
+		else
+			memcpy(avd, &node->ae.avd, sizeof(*avd));
+		rcu_read_unlock();
+		avc_pcpu_fill(ssid, tsid, tclass, gen, avd);
+	}
 
 	denied = requested & ~(avd->allowed);
 	if (unlikely(denied))
 		rc = avc_denied(ssid, tsid, tclass, requested, 0, 0, flags, avd);
 
-	rcu_read_unlock();
 	return rc;
 }
 
@@ -1184,7 +1416,7 @@ void avc_disable(void)
 	 * the cache and get that memory back.
 	 */
 	if (avc_node_cachep) {
-		avc_flush();
+		avc_drop();
 		/* kmem_cache_destroy(avc_node_cachep); */
 	}
 }
@@ -20,6 +20,8 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/errno.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include "avtab.h"
 #include "policydb.h"
 
@@ -276,6 +278,103 @@ avtab_search_node_next(struct avtab_node *node, int specified)
 	return NULL;
 }
 
+static struct avtab_flat_entry *avtab_flat_slot(struct avtab *h,
+						struct avtab_key *key)
+{
+	struct avtab_flat_entry *fe;
+	u32 pos = avtab_hash(key, h->flat_mask);
+
+	for (;;) {
+		fe = &h->flat[pos];
+		if (!fe->specified ||
+		    (fe->source_type == key->source_type &&
+		     fe->target_type == key->target_type &&
+		     fe->target_class == key->target_class))
+			return fe;
+		pos = (pos + 1) & h->flat_mask;
+	}
+}
+
+/*
+ * Build the flat access-vector index: a single contiguous (page-aligned
+ * for large policies) open-addressed table with one slot per (source,
+ * target, class) triple, sized to at most half load so linear probing
+ * stays short.  The chained table remains the authoritative
+ * representation - it is still used for the type rules, for duplicate
+ * detection at load and for writing the policy back out - but the hot
+ * access-vector lookups probe only the flat image.  Must be called once
+ * the table is fully populated; the index is read-only afterwards.
+ */
+int avtab_flatten(struct avtab *h)
+{
+	struct avtab_node *cur;
+	u32 nslot;
+	int i;
+
+	if (!h->nel)
+		return 0;
+
+	nslot = roundup_pow_of_two(h->nel * 2);
+	h->flat = kvzalloc(nslot * sizeof(struct avtab_flat_entry),
+			   GFP_KERNEL);
+	if (!h->flat)
+		return -ENOMEM;
+	h->flat_mask = nslot - 1;
+
+	for (i = 0; i < h->nslot; i++) {
+		for (cur = flex_array_get_ptr(h->htable, i); cur;
+		     cur = cur->next) {
+			struct avtab_flat_entry *fe;
+			u16 specified = cur->key.specified &
+					~(AVTAB_ENABLED|AVTAB_ENABLED_OLD);
+
+			if (!(specified & (AVTAB_AV | AVTAB_XPERMS)))
+				continue;
+
+			fe = avtab_flat_slot(h, &cur->key);
+			if (!fe->specified) {
+				fe->source_type = cur->key.source_type;
+				fe->target_type = cur->key.target_type;
+				fe->target_class = cur->key.target_class;
+			}
+			fe->specified |= specified;
+			if (specified & AVTAB_ALLOWED)
+				fe->allowed = cur->datum.u.data;
+			else if (specified & AVTAB_AUDITALLOW)
+				fe->auditallow = cur->datum.u.data;
+			else if (specified & AVTAB_AUDITDENY)
+				fe->auditdeny = cur->datum.u.data;
+			else if (!fe->xperms)
+				/* first xperms node in chain order, the
+				 * rest follow via avtab_search_node_next() */
+				fe->xperms = cur;
+		}
+	}
+	return 0;
+}
+
+const struct avtab_flat_entry *avtab_flat_lookup(struct avtab *h,
+						 struct avtab_key *key)
+{
+	const struct avtab_flat_entry *fe;
+	u32 pos;
+
+	if (!h->flat)
+		return NULL;
+
+	pos = avtab_hash(key, h->flat_mask);
+	for (;;) {
+		fe = &h->flat[pos];
+		if (!fe->specified)
+			return NULL;
+		if (fe->source_type == key->source_type &&
+		    fe->target_type == key->target_type &&
+		    fe->target_class == key->target_class)
+			return fe;
+		pos = (pos + 1) & h->flat_mask;
+	}
+}
+
 void avtab_destroy(struct avtab *h)
 {
 	int i;
@@ -299,12 +398,17 @@ void avtab_destroy(struct avtab *h)
 	h->htable = NULL;
 	h->nslot = 0;
 	h->mask = 0;
+	kvfree(h->flat);
+	h->flat = NULL;
+	h->flat_mask = 0;
 }
 
 int avtab_init(struct avtab *h)
 {
 	h->htable = NULL;
 	h->nel = 0;
+	h->flat = NULL;
+	h->flat_mask = 0;
 	return 0;
 }
 
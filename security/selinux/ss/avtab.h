@@ -83,17 +83,40 @@ struct avtab_node {
 	struct avtab_node *next;
 };
 
+/*
+ * One slot of the flat access-vector index.  All AV specifiers for a
+ * (source, target, class) triple are merged into a single slot so that
+ * one probe of a contiguous, open-addressed table yields the complete
+ * decision, instead of chasing a chain of individually allocated nodes.
+ * A slot with no specifiers is empty.  Extended permissions keep their
+ * chained nodes; xperms points at the first one for the triple.
+ */
+struct avtab_flat_entry {
+	u16 source_type;
+	u16 target_type;
+	u16 target_class;
+	u16 specified;		/* union of the AVTAB_* specifiers present */
+	u32 allowed;
+	u32 auditallow;
+	u32 auditdeny;
+	struct avtab_node *xperms;
+};
+
 struct avtab {
 	struct flex_array *htable;
 	u32 nel;	/* number of elements */
 	u32 nslot;      /* number of hash slots */
 	u32 mask;       /* mask to compute hash func */
-
+	struct avtab_flat_entry *flat;	/* flat AV index, see avtab_flatten() */
+	u32 flat_mask;
 };
 
 int avtab_init(struct avtab *);
 int avtab_alloc(struct avtab *, u32);
+int avtab_flatten(struct avtab *h);
 struct avtab_datum *avtab_search(struct avtab *h, struct avtab_key *k);
+const struct avtab_flat_entry *avtab_flat_lookup(struct avtab *h,
+						 struct avtab_key *k);
 void avtab_destroy(struct avtab *h);
 void avtab_hash_eval(struct avtab *h, char *tag);
 
@@ -2420,6 +2420,10 @@ int policydb_read(struct policydb *p, void *fp)
 	if (rc)
 		goto bad;
 
+	rc = avtab_flatten(&p->te_avtab);
+	if (rc)
+		goto bad;
+
 	if (p->policyvers >= POLICYDB_VERSION_BOOL) {
 		rc = cond_read_list(p, fp);
 		if (rc)
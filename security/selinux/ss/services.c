@@ -642,6 +642,7 @@ static void context_struct_compute_av(struct context *scontext,
 	struct role_allow *ra;
 	struct avtab_key avkey;
 	struct avtab_node *node;
+	const struct avtab_flat_entry *fe;
 	struct class_datum *tclass_datum;
 	struct ebitmap *sattr, *tattr;
 	struct ebitmap_node *snode, *tnode;
@@ -677,17 +678,19 @@ static void context_struct_compute_av(struct context *scontext,
 		ebitmap_for_each_positive_bit(tattr, tnode, j) {
 			avkey.source_type = i + 1;
 			avkey.target_type = j + 1;
-			for (node = avtab_search_node(&policydb.te_avtab, &avkey);
-			     node;
-			     node = avtab_search_node_next(node, avkey.specified)) {
-				if (node->key.specified == AVTAB_ALLOWED)
-					avd->allowed |= node->datum.u.data;
-				else if (node->key.specified == AVTAB_AUDITALLOW)
-					avd->auditallow |= node->datum.u.data;
-				else if (node->key.specified == AVTAB_AUDITDENY)
-					avd->auditdeny &= node->datum.u.data;
-				else if (xperms && (node->key.specified & AVTAB_XPERMS))
-					services_compute_xperms_drivers(xperms, node);
+			fe = avtab_flat_lookup(&policydb.te_avtab, &avkey);
+			if (fe) {
+				if (fe->specified & AVTAB_ALLOWED)
+					avd->allowed |= fe->allowed;
+				if (fe->specified & AVTAB_AUDITALLOW)
+					avd->auditallow |= fe->auditallow;
+				if (fe->specified & AVTAB_AUDITDENY)
+					avd->auditdeny &= fe->auditdeny;
+				if (xperms)
+					for (node = fe->xperms; node;
+					     node = avtab_search_node_next(node,
+								AVTAB_XPERMS))
+						services_compute_xperms_drivers(xperms, node);
 			}
 
 			/* Check conditional av table for additional permissions */
@@ -1010,6 +1013,7 @@ void security_compute_xperms_decision(u32 ssid,
 	struct context *scontext, *tcontext;
 	struct avtab_key avkey;
 	struct avtab_node *node;
+	const struct avtab_flat_entry *fe;
 	struct ebitmap *sattr, *tattr;
 	struct ebitmap_node *snode, *tnode;
 	unsigned int i, j;
@@ -1063,10 +1067,12 @@ void security_compute_xperms_decision(u32 ssid,
 		ebitmap_for_each_positive_bit(tattr, tnode, j) {
 			avkey.source_type = i + 1;
 			avkey.target_type = j + 1;
-			for (node = avtab_search_node(&policydb.te_avtab, &avkey);
-			     node;
-			     node = avtab_search_node_next(node, avkey.specified))
-				services_compute_xperms_decision(xpermd, node);
+			fe = avtab_flat_lookup(&policydb.te_avtab, &avkey);
+			if (fe)
+				for (node = fe->xperms; node;
+				     node = avtab_search_node_next(node,
+								AVTAB_XPERMS))
+					services_compute_xperms_decision(xpermd, node);
 
 			cond_compute_xperms(&policydb.te_cond_avtab,
 						&avkey, xpermd);
@@ -340,6 +340,110 @@ static ssize_t snd_compr_write(struct file *f, const char __user *buf,
 	return retval;
 }
 
+/* like snd_compr_write_data(), but draining an iov_iter and leaving the
+ * DSP notification to the caller so that a vectored write acks once
+ */
+static int snd_compr_copy_iter_data(struct snd_compr_stream *stream,
+				    struct iov_iter *from, size_t count)
+{
+	void *dstn;
+	size_t copy;
+	struct snd_compr_runtime *runtime = stream->runtime;
+	/* 64-bit Modulus */
+	u64 app_pointer = div64_u64(runtime->total_bytes_available,
+				    runtime->buffer_size);
+	app_pointer = runtime->total_bytes_available -
+		      (app_pointer * runtime->buffer_size);
+
+	dstn = runtime->buffer + app_pointer;
+	pr_debug("copying %ld at %lld\n",
+			(unsigned long)count, app_pointer);
+	if (count < runtime->buffer_size - app_pointer) {
+		if (!copy_from_iter_full(dstn, count, from))
+			return -EFAULT;
+	} else {
+		copy = runtime->buffer_size - app_pointer;
+		if (!copy_from_iter_full(dstn, copy, from))
+			return -EFAULT;
+		if (!copy_from_iter_full(runtime->buffer, count - copy, from))
+			return -EFAULT;
+	}
+	return count;
+}
+
+static ssize_t snd_compr_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct snd_compr_file *data = iocb->ki_filp->private_data;
+	struct snd_compr_stream *stream;
+	size_t avail, count, total = 0;
+	int retval = 0;
+
+	if (snd_BUG_ON(!data))
+		return -EFAULT;
+	if (!iter_is_iovec(from))
+		return -EINVAL;
+
+	stream = &data->stream;
+	mutex_lock(&stream->device->lock);
+	/* write is allowed when stream is running or has been steup */
+	switch (stream->runtime->state) {
+	case SNDRV_PCM_STATE_SETUP:
+	case SNDRV_PCM_STATE_PREPARED:
+	case SNDRV_PCM_STATE_RUNNING:
+		break;
+	default:
+		mutex_unlock(&stream->device->lock);
+		return -EBADFD;
+	}
+
+	avail = snd_compr_get_avail(stream);
+	pr_debug("avail returned %ld\n", (unsigned long)avail);
+
+	if (stream->ops->copy) {
+		const struct iovec *iov;
+
+		for (iov = from->iov;
+		     iov < from->iov + from->nr_segs && avail; iov++) {
+			count = min(iov->iov_len, avail);
+			if (!count)
+				continue;
+			retval = stream->ops->copy(stream, iov->iov_base,
+						   count);
+			if (retval <= 0)
+				break;
+			total += retval;
+			avail -= retval;
+			if (retval < count)
+				break;
+		}
+		if (total)
+			stream->runtime->total_bytes_available += total;
+	} else {
+		count = min_t(size_t, iov_iter_count(from), avail);
+		if (count) {
+			retval = snd_compr_copy_iter_data(stream, from, count);
+			if (retval > 0) {
+				total = retval;
+				stream->runtime->total_bytes_available += total;
+				/* one aggregated notification for the whole
+				 * vector, if the DSP cares
+				 */
+				if (stream->ops->ack)
+					stream->ops->ack(stream, total);
+			}
+		}
+	}
+
+	/* while initiating the stream, write should be called before START
+	 * call, so in setup move state */
+	if (total && stream->runtime->state == SNDRV_PCM_STATE_SETUP) {
+		stream->runtime->state = SNDRV_PCM_STATE_PREPARED;
+		pr_debug("stream prepared, Houston we are good to go\n");
+	}
+
+	mutex_unlock(&stream->device->lock);
+	return total ? total : retval;
+}
 
 static ssize_t snd_compr_read(struct file *f, char __user *buf,
 		size_t count, loff_t *offset)
@@ -393,7 +497,19 @@ out:
 
 static int snd_compr_mmap(struct file *f, struct vm_area_struct *vma)
 {
-	return -ENXIO;
+	struct snd_compr_file *data = f->private_data;
+	struct snd_compr_stream *stream;
+
+	if (snd_BUG_ON(!data))
+		return -EFAULT;
+
+	/* mapping the ring is up to the DSP driver; the data path then runs
+	 * syscall-free while pointer exchange stays on the ioctls
+	 */
+	stream = &data->stream;
+	if (!stream->ops->mmap)
+		return -ENXIO;
+	return stream->ops->mmap(stream, vma);
 }
 
 static __poll_t snd_compr_get_poll(struct snd_compr_stream *stream)
@@ -443,7 +559,7 @@ static __poll_t snd_compr_poll(struct file *f, poll_table *wait)
 	case SNDRV_PCM_STATE_RUNNING:
 	case SNDRV_PCM_STATE_PREPARED:
 	case SNDRV_PCM_STATE_PAUSED:
-		if (avail >= stream->runtime->fragment_size)
+		if (avail >= stream->runtime->wake_threshold)
 			retval = snd_compr_get_poll(stream);
 		break;
 	default:
@@ -520,6 +636,7 @@ static int snd_compr_allocate_buffer(struct snd_compr_stream *stream,
 	}
 	stream->runtime->fragment_size = params->buffer.fragment_size;
 	stream->runtime->fragments = params->buffer.fragments;
+	stream->runtime->wake_threshold = params->buffer.fragment_size;
 	stream->runtime->buffer = buffer;
 	stream->runtime->buffer_size = buffer_size;
 	return 0;
@@ -852,6 +969,24 @@ static int snd_compr_partial_drain(struct snd_compr_stream *stream)
 	return snd_compress_wait_for_drain(stream);
 }
 
+static int snd_compr_set_wake_threshold(struct snd_compr_stream *stream,
+					unsigned long arg)
+{
+	u32 threshold;
+
+	/* buffer geometry must be known first */
+	if (stream->runtime->state == SNDRV_PCM_STATE_OPEN)
+		return -EPERM;
+
+	if (get_user(threshold, (__u32 __user *)arg))
+		return -EFAULT;
+	if (threshold == 0 || threshold > stream->runtime->buffer_size)
+		return -EINVAL;
+
+	stream->runtime->wake_threshold = threshold;
+	return 0;
+}
+
 static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 {
 	struct snd_compr_file *data = f->private_data;
@@ -916,6 +1051,9 @@ static long snd_compr_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
 	case _IOC_NR(SNDRV_COMPRESS_NEXT_TRACK):
 		retval = snd_compr_next_track(stream);
 		break;
+	case _IOC_NR(SNDRV_COMPRESS_SET_WAKE_THRESHOLD):
+		retval = snd_compr_set_wake_threshold(stream, arg);
+		break;
 
 	}
 	mutex_unlock(&stream->device->lock);
@@ -936,6 +1074,7 @@ static const struct file_operations snd_compr_file_ops = {
 		.open =		snd_compr_open,
 		.release =	snd_compr_free,
 		.write =	snd_compr_write,
+		.write_iter =	snd_compr_write_iter,
 		.read =		snd_compr_read,
 		.unlocked_ioctl = snd_compr_ioctl,
 #ifdef CONFIG_COMPAT
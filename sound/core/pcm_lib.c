@@ -158,8 +158,11 @@ static void xrun(struct snd_pcm_substream *substream)
 	struct snd_pcm_runtime *runtime = substream->runtime;
 
 	trace_xrun(substream);
-	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE)
+	if (runtime->tstamp_mode == SNDRV_PCM_TSTAMP_ENABLE) {
+		snd_pcm_status_seq_begin(runtime);
 		snd_pcm_gettime(runtime, (struct timespec *)&runtime->status->tstamp);
+		snd_pcm_status_seq_end(runtime);
+	}
 	snd_pcm_stop(substream, SNDRV_PCM_STATE_XRUN);
 	if (xrun_debug(substream, XRUN_DEBUG_BASIC)) {
 		char name[16];
@@ -440,7 +443,9 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 
  no_delta_check:
 	if (runtime->status->hw_ptr == new_hw_ptr) {
+		snd_pcm_status_seq_begin(runtime);
 		update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+		snd_pcm_status_seq_end(runtime);
 		return 0;
 	}
 
@@ -458,6 +463,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 			runtime->hw_ptr_interrupt -= runtime->boundary;
 	}
 	runtime->hw_ptr_base = hw_base;
+	snd_pcm_status_seq_begin(runtime);
 	runtime->status->hw_ptr = new_hw_ptr;
 	runtime->hw_ptr_jiffies = curr_jiffies;
 	if (crossed_boundary) {
@@ -466,6 +472,7 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 	}
 
 	update_audio_tstamp(substream, &curr_tstamp, &audio_tstamp);
+	snd_pcm_status_seq_end(runtime);
 
 	return snd_pcm_update_state(substream, runtime);
 }
@@ -1691,10 +1698,14 @@ static int snd_pcm_lib_ioctl_reset(struct snd_pcm_substream *substream,
 	unsigned long flags;
 	snd_pcm_stream_lock_irqsave(substream, flags);
 	if (snd_pcm_running(substream) &&
-	    snd_pcm_update_hw_ptr(substream) >= 0)
+	    snd_pcm_update_hw_ptr(substream) >= 0) {
+		snd_pcm_status_seq_begin(runtime);
 		runtime->status->hw_ptr %= runtime->buffer_size;
-	else {
+		snd_pcm_status_seq_end(runtime);
+	} else {
+		snd_pcm_status_seq_begin(runtime);
 		runtime->status->hw_ptr = 0;
+		snd_pcm_status_seq_end(runtime);
 		runtime->hw_ptr_wrap = 0;
 	}
 	snd_pcm_stream_unlock_irqrestore(substream, flags);
@@ -2727,6 +2727,27 @@ static int snd_pcm_sync_ptr(struct snd_pcm_substream *substream,
 		if (err < 0)
 			return err;
 	}
+	if ((sync_ptr.flags & SNDRV_PCM_SYNC_PTR_APPL) &&
+	    (sync_ptr.flags & SNDRV_PCM_SYNC_PTR_AVAIL_MIN)) {
+		/*
+		 * Pure position query, nothing to apply: read the control
+		 * record plainly and the status record via its sequence
+		 * count instead of contending on the stream lock with the
+		 * period interrupt.
+		 */
+		struct snd_pcm_mmap_status snap;
+
+		sync_ptr.c.control.appl_ptr = control->appl_ptr;
+		sync_ptr.c.control.avail_min = control->avail_min;
+		snd_pcm_status_snapshot(runtime, &snap);
+		sync_ptr.s.status.state = snap.state;
+		sync_ptr.s.status.hw_ptr = snap.hw_ptr;
+		sync_ptr.s.status.tstamp = snap.tstamp;
+		sync_ptr.s.status.suspended_state = snap.suspended_state;
+		if (copy_to_user(_sync_ptr, &sync_ptr, sizeof(sync_ptr)))
+			return -EFAULT;
+		return 0;
+	}
 	snd_pcm_stream_lock_irq(substream);
 	if (!(sync_ptr.flags & SNDRV_PCM_SYNC_PTR_APPL)) {
 		err = pcm_lib_apply_appl_ptr(substream,
@@ -44,6 +44,12 @@ static inline void kvm_async_page_present_async(struct kvm_vcpu *vcpu,
 #endif
 }
 
+/*
+ * Maximum number of contiguous pages one work item faults in when the
+ * predictor sees a sequential fault stream (see kvm_setup_async_pf()).
+ */
+#define ASYNC_PF_PREFETCH_MAX	16
+
 static struct kmem_cache *async_pf_cache;
 
 int kvm_async_pf_init(void)
@@ -64,9 +70,10 @@ void kvm_async_pf_deinit(void)
 
 void kvm_async_pf_vcpu_init(struct kvm_vcpu *vcpu)
 {
-	INIT_LIST_HEAD(&vcpu->async_pf.done);
+	init_llist_head(&vcpu->async_pf.done);
+	INIT_LIST_HEAD(&vcpu->async_pf.ready);
 	INIT_LIST_HEAD(&vcpu->async_pf.queue);
-	spin_lock_init(&vcpu->async_pf.lock);
+	vcpu->async_pf.prefetch = 1;
 }
 
 static void async_pf_execute(struct work_struct *work)
@@ -87,17 +94,21 @@ static void async_pf_execute(struct work_struct *work)
 	 * access remotely.
 	 */
 	down_read(&mm->mmap_sem);
-	get_user_pages_remote(NULL, mm, addr, 1, FOLL_WRITE, NULL, NULL,
-			&locked);
+	get_user_pages_remote(NULL, mm, addr, apf->nr_pages, FOLL_WRITE, NULL,
+			NULL, &locked);
 	if (locked)
 		up_read(&mm->mmap_sem);
 
 	kvm_async_page_present_sync(vcpu, apf);
 
-	spin_lock(&vcpu->async_pf.lock);
-	list_add_tail(&apf->link, &vcpu->async_pf.done);
+	/*
+	 * Clearing ->vcpu marks the work as completed for
+	 * kvm_clear_async_pf_completion_queue() and must be visible
+	 * before the completion is posted on the done list.
+	 */
 	apf->vcpu = NULL;
-	spin_unlock(&vcpu->async_pf.lock);
+	smp_wmb();
+	llist_add(&apf->dlink, &vcpu->async_pf.done);
 
 	/*
 	 * apf may be freed by kvm_check_async_pf_completion() after
@@ -115,23 +126,25 @@ static void async_pf_execute(struct work_struct *work)
 
 void kvm_clear_async_pf_completion_queue(struct kvm_vcpu *vcpu)
 {
-	spin_lock(&vcpu->async_pf.lock);
+	struct kvm_async_pf *work, *tmp;
+	struct llist_node *posted;
 
 	/* cancel outstanding work queue item */
 	while (!list_empty(&vcpu->async_pf.queue)) {
-		struct kvm_async_pf *work =
-			list_first_entry(&vcpu->async_pf.queue,
-					 typeof(*work), queue);
+		work = list_first_entry(&vcpu->async_pf.queue,
+					typeof(*work), queue);
 		list_del(&work->queue);
 
 		/*
-		 * We know it's present in vcpu->async_pf.done, do
-		 * nothing here.
+		 * The work already completed; wait for its completion
+		 * posting to finish, it is freed from the done list
+		 * below.
 		 */
-		if (!work->vcpu)
+		if (!READ_ONCE(work->vcpu)) {
+			flush_work(&work->work);
 			continue;
+		}
 
-		spin_unlock(&vcpu->async_pf.lock);
 #ifdef CONFIG_KVM_ASYNC_PF_SYNC
 		flush_work(&work->work);
 #else
@@ -141,17 +154,16 @@ void kvm_clear_async_pf_completion_queue(struct kvm_vcpu *vcpu)
 			kmem_cache_free(async_pf_cache, work);
 		}
 #endif
-		spin_lock(&vcpu->async_pf.lock);
 	}
 
-	while (!list_empty(&vcpu->async_pf.done)) {
-		struct kvm_async_pf *work =
-			list_first_entry(&vcpu->async_pf.done,
-					 typeof(*work), link);
+	posted = llist_del_all(&vcpu->async_pf.done);
+	llist_for_each_entry_safe(work, tmp, posted, dlink)
+		kmem_cache_free(async_pf_cache, work);
+
+	list_for_each_entry_safe(work, tmp, &vcpu->async_pf.ready, link) {
 		list_del(&work->link);
 		kmem_cache_free(async_pf_cache, work);
 	}
-	spin_unlock(&vcpu->async_pf.lock);
 
 	vcpu->async_pf.queued = 0;
 }
@@ -159,14 +171,21 @@ void kvm_clear_async_pf_completion_queue(struct kvm_vcpu *vcpu)
 void kvm_check_async_pf_completion(struct kvm_vcpu *vcpu)
 {
 	struct kvm_async_pf *work;
+	struct llist_node *posted;
 
-	while (!list_empty_careful(&vcpu->async_pf.done) &&
+	/*
+	 * Harvest freshly posted completions onto the vcpu-private
+	 * ready list; llist_del_all returns them newest first.
+	 */
+	posted = llist_reverse_order(llist_del_all(&vcpu->async_pf.done));
+	llist_for_each_entry(work, posted, dlink)
+		list_add_tail(&work->link, &vcpu->async_pf.ready);
+
+	while (!list_empty(&vcpu->async_pf.ready) &&
 	      kvm_arch_can_inject_async_page_present(vcpu)) {
-		spin_lock(&vcpu->async_pf.lock);
-		work = list_first_entry(&vcpu->async_pf.done, typeof(*work),
+		work = list_first_entry(&vcpu->async_pf.ready, typeof(*work),
 					      link);
 		list_del(&work->link);
-		spin_unlock(&vcpu->async_pf.lock);
 
 		kvm_arch_async_page_ready(vcpu, work);
 		kvm_async_page_present_async(vcpu, work);
@@ -181,6 +200,7 @@ int kvm_setup_async_pf(struct kvm_vcpu *vcpu, gva_t gva, unsigned long hva,
 		       struct kvm_arch_async_pf *arch)
 {
 	struct kvm_async_pf *work;
+	u64 pg = hva >> PAGE_SHIFT;
 
 	if (vcpu->async_pf.queued >= ASYNC_PF_PER_VCPU)
 		return 0;
@@ -204,13 +224,34 @@ int kvm_setup_async_pf(struct kvm_vcpu *vcpu, gva_t gva, unsigned long hva,
 	mmget(work->mm);
 	kvm_get_kvm(work->vcpu->kvm);
 
+	/*
+	 * Guests backed by slow remote memory fault in long runs of
+	 * neighbouring pages.  Widen the window each work item faults in
+	 * while the stream stays sequential, so neighbouring faults are
+	 * coalesced into one range request instead of one work item per
+	 * page.
+	 */
+	if (pg == vcpu->async_pf.next_page)
+		vcpu->async_pf.prefetch = min_t(u32,
+						vcpu->async_pf.prefetch << 1,
+						ASYNC_PF_PREFETCH_MAX);
+	else
+		vcpu->async_pf.prefetch = 1;
+	vcpu->async_pf.next_page = pg + 1;
+	work->nr_pages = vcpu->async_pf.prefetch;
+
 	/* this can't really happen otherwise gfn_to_pfn_async
 	   would succeed */
 	if (unlikely(kvm_is_error_hva(work->addr)))
 		goto retry_sync;
 
 	INIT_WORK(&work->work, async_pf_execute);
-	if (!schedule_work(&work->work))
+	/*
+	 * Remote-memory faults stall for long; the unbound workqueue
+	 * lets them run concurrently instead of serializing on the
+	 * submitting CPU's worker pool.
+	 */
+	if (!queue_work(system_unbound_wq, &work->work))
 		goto retry_sync;
 
 	list_add_tail(&work->queue, &vcpu->async_pf.queue);
@@ -228,7 +269,8 @@ int kvm_async_pf_wakeup_all(struct kvm_vcpu *vcpu)
 {
 	struct kvm_async_pf *work;
 
-	if (!list_empty_careful(&vcpu->async_pf.done))
+	if (!llist_empty(&vcpu->async_pf.done) ||
+	    !list_empty_careful(&vcpu->async_pf.ready))
 		return 0;
 
 	work = kmem_cache_zalloc(async_pf_cache, GFP_ATOMIC);
@@ -238,9 +280,7 @@ int kvm_async_pf_wakeup_all(struct kvm_vcpu *vcpu)
 	work->wakeup_all = true;
 	INIT_LIST_HEAD(&work->queue); /* for list_del to work */
 
-	spin_lock(&vcpu->async_pf.lock);
-	list_add_tail(&work->link, &vcpu->async_pf.done);
-	spin_unlock(&vcpu->async_pf.lock);
+	llist_add(&work->dlink, &vcpu->async_pf.done);
 
 	vcpu->async_pf.queued++;
 	return 0;
@@ -30,6 +30,8 @@
 #include <linux/poll.h>
 #include <linux/file.h>
 #include <linux/list.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
 #include <linux/eventfd.h>
 #include <linux/kernel.h>
 #include <linux/srcu.h>
@@ -514,6 +516,7 @@ kvm_eventfd_init(struct kvm *kvm)
 	mutex_init(&kvm->irqfds.resampler_lock);
 #endif
 	INIT_LIST_HEAD(&kvm->ioeventfds);
+	hash_init(kvm->ioeventfd_hash);
 }
 
 #ifdef CONFIG_HAVE_KVM_IRQFD
@@ -653,6 +656,7 @@ void kvm_irqfd_exit(void)
 
 struct _ioeventfd {
 	struct list_head     list;
+	struct hlist_node    node;
 	u64                  addr;
 	int                  length;
 	struct eventfd_ctx  *eventfd;
@@ -676,6 +680,27 @@ ioeventfd_release(struct _ioeventfd *p)
 	kfree(p);
 }
 
+static int
+ioeventfd_data_to_u64(const void *val, int len, u64 *data)
+{
+	switch (len) {
+	case 1:
+		*data = *(u8 *)val;
+		return 0;
+	case 2:
+		*data = *(u16 *)val;
+		return 0;
+	case 4:
+		*data = *(u32 *)val;
+		return 0;
+	case 8:
+		*data = *(u64 *)val;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
 static bool
 ioeventfd_in_range(struct _ioeventfd *p, gpa_t addr, int len, const void *val)
 {
@@ -701,22 +726,8 @@ ioeventfd_in_range(struct _ioeventfd *p, gpa_t addr, int len, const void *val)
 
 	BUG_ON(!IS_ALIGNED((unsigned long)val, len));
 
-	switch (len) {
-	case 1:
-		_val = *(u8 *)val;
-		break;
-	case 2:
-		_val = *(u16 *)val;
-		break;
-	case 4:
-		_val = *(u32 *)val;
-		break;
-	case 8:
-		_val = *(u64 *)val;
-		break;
-	default:
+	if (ioeventfd_data_to_u64(val, len, &_val))
 		return false;
-	}
 
 	return _val == p->datamatch ? true : false;
 }
@@ -732,6 +743,76 @@ ioeventfd_write(struct kvm_vcpu *vcpu, struct kvm_io_device *this, gpa_t addr,
 		return -EOPNOTSUPP;
 
 	eventfd_signal(p->eventfd, 1);
+	if (vcpu)
+		vcpu->kvm->ioeventfd_kicks[p->bus_idx]++;
+	return 0;
+}
+
+/*
+ * Besides the bus device list, every ioeventfd is kept in a per-VM hash
+ * indexed by bus, address, length and datamatch value, so that a kick
+ * does not have to probe every eventfd registered on its doorbell
+ * address before finding the one whose data matches.
+ */
+static u32
+ioeventfd_hash_key(u8 bus_idx, u64 addr, int length, u64 datamatch)
+{
+	u32 key = jhash_3words((u32)addr, (u32)(addr >> 32), length, bus_idx);
+
+	return jhash_2words((u32)datamatch, (u32)(datamatch >> 32), key);
+}
+
+static u32
+ioeventfd_entry_key(struct _ioeventfd *p)
+{
+	/* wildcard and zero-length eventfds hash as if matching data 0 */
+	u64 datamatch = (p->wildcard || !p->length) ? 0 : p->datamatch;
+
+	return ioeventfd_hash_key(p->bus_idx, p->addr, p->length, datamatch);
+}
+
+/*
+ * Fast ioeventfd dispatch, called from kvm_io_bus_write() under the
+ * kvm->srcu read lock.  Returns 0 and signals the eventfd on a hit,
+ * -EOPNOTSUPP when no eventfd matches and the bus walk should run.
+ */
+int
+kvm_ioeventfd_write(struct kvm_vcpu *vcpu, enum kvm_bus bus_idx, gpa_t addr,
+		    int len, const void *val)
+{
+	struct kvm *kvm = vcpu->kvm;
+	struct _ioeventfd *p;
+	u64 _val;
+
+	if (ioeventfd_data_to_u64(val, len, &_val))
+		goto wildcard;
+
+	/* exact datamatch at this address and length */
+	hash_for_each_possible_rcu(kvm->ioeventfd_hash, p, node,
+				   ioeventfd_hash_key(bus_idx, addr, len, _val))
+		if (p->bus_idx == bus_idx && p->addr == addr &&
+		    p->length == len && !p->wildcard && p->datamatch == _val)
+			goto found;
+
+wildcard:
+	/* wildcard at this address and length */
+	hash_for_each_possible_rcu(kvm->ioeventfd_hash, p, node,
+				   ioeventfd_hash_key(bus_idx, addr, len, 0))
+		if (p->bus_idx == bus_idx && p->addr == addr &&
+		    p->length == len && p->wildcard)
+			goto found;
+
+	/* zero-length eventfds only look at the address */
+	hash_for_each_possible_rcu(kvm->ioeventfd_hash, p, node,
+				   ioeventfd_hash_key(bus_idx, addr, 0, 0))
+		if (p->bus_idx == bus_idx && p->addr == addr && !p->length)
+			goto found;
+
+	return -EOPNOTSUPP;
+
+found:
+	eventfd_signal(p->eventfd, 1);
+	kvm->ioeventfd_kicks[bus_idx]++;
 	return 0;
 }
 
@@ -744,6 +825,7 @@ ioeventfd_destructor(struct kvm_io_device *this)
 {
 	struct _ioeventfd *p = to_ioeventfd(this);
 
+	hash_del(&p->node);
 	ioeventfd_release(p);
 }
 
@@ -827,6 +909,7 @@ static int kvm_assign_ioeventfd_idx(struct kvm *kvm,
 
 	kvm_get_bus(kvm, bus_idx)->ioeventfd_count++;
 	list_add_tail(&p->list, &kvm->ioeventfds);
+	hash_add_rcu(kvm->ioeventfd_hash, &p->node, ioeventfd_entry_key(p));
 
 	mutex_unlock(&kvm->slots_lock);
 
@@ -870,6 +953,12 @@ kvm_deassign_ioeventfd_idx(struct kvm *kvm, enum kvm_bus bus_idx,
 		if (!p->wildcard && p->datamatch != args->datamatch)
 			continue;
 
+		/*
+		 * Unhash before kvm_io_bus_unregister_dev(); its SRCU
+		 * synchronization also makes sure no reader still sees
+		 * the entry once we free it below.
+		 */
+		hash_del_rcu(&p->node);
 		kvm_io_bus_unregister_dev(kvm, bus_idx, &p->dev);
 		bus = kvm_get_bus(kvm, bus_idx);
 		if (bus)